@@ -35,6 +35,118 @@ void round_number(double *dest, const int decimals)
 		*dest = 0.0;
 }
 
+/*
+ * geohash_column() - Stores the extra column with the geohash of `lat, lon` in 
+ * `buf` when --geohash is used, a space and the geohash for the default 
+ * format, or a comma and an SQL string for the sql format. `buf` must have 
+ * room for GEOHASH_MAX_LEN + 5 bytes. An empty string is stored if --geohash 
+ * isn't used. Returns `buf`.
+ */
+
+static char *geohash_column(const struct Options *o, char *buf,
+                            const double lat, const double lon)
+{
+	char hash[GEOHASH_MAX_LEN + 1];
+
+	assert(o);
+	assert(buf);
+
+	*buf = '\0';
+	if (!o->geohash || geohash_encode(lat, lon, o->geohash, hash))
+		return buf;
+	if (o->outpformat == OF_SQL)
+		sprintf(buf, ", '%s'", hash);
+	else
+		sprintf(buf, " %s", hash);
+
+	return buf;
+}
+
+/*
+ * format_number() - Formats `x` with `decimals` decimals into `buf`, which has 
+ * room for `size` bytes, and removes trailing zeros. Used instead of 
+ * allocstr() in loops that are executed for every position. Returns `buf`.
+ */
+
+static char *format_number(char *buf, const size_t size, const double x,
+                           const int decimals)
+{
+	double n = x;
+
+	assert(buf);
+
+	round_number(&n, decimals);
+	snprintf(buf, size, "%.*f", decimals, n);
+
+	return trim_zeros(buf);
+}
+
+/*
+ * format_utm() - Stores the UTM position in zone `zone` with the easting `e` 
+ * and northing `n` in meters, at the latitude `lat`, in `buf`, which has room 
+ * for `size` bytes. If `mgrs` is true, it's stored as an MGRS reference with 
+ * a precision of 1 meter. Otherwise it's stored as the zone and latitude 
+ * band, the easting and the northing separated by commas, like 
+ * "32V,597868.381,6642681.51". The easting and northing are divided by `div`, 
+ * and have 3 decimals if `div` is 1 and 6 decimals otherwise. Returns `buf`, 
+ * or NULL if the position is outside the MGRS area.
+ */
+
+static char *format_utm(char *buf, const size_t size, const bool mgrs,
+                        const double lat, const int zone, const double e,
+                        const double n, const double div)
+{
+	const int len_dec = div == 1.0 ? 3 : 6;
+	char e_s[16], n_s[16];
+
+	assert(buf);
+
+	if (mgrs) {
+		char ref[MGRS_MAX_LEN + 1];
+
+		if (mgrs_encode(lat, zone, e, n, 5, ref))
+			return NULL; /* gncov */
+		snprintf(buf, size, "%s", ref);
+		return buf;
+	}
+	format_number(e_s, sizeof(e_s), e / div, len_dec);
+	format_number(n_s, sizeof(n_s), n / div, len_dec);
+	snprintf(buf, size, "%d%c,%s,%s", zone, utm_band(lat), e_s, n_s);
+
+	return buf;
+}
+
+/*
+ * utm_coordinate() - Stores the position `lat, lon` in `buf` in the UTM or 
+ * MGRS format from `o->outpformat`, using format_utm(). `buf` must have room 
+ * for 32 bytes. Returns `buf`, or NULL if the position is outside the UTM 
+ * area.
+ */
+
+static char *utm_coordinate(const struct Options *o, char *buf,
+                            const double lat, const double lon)
+{
+	struct tmerc tm;
+	char lat_s[16], lon_s[16];
+	double e, n;
+	int zone;
+
+	assert(o);
+	assert(buf);
+
+	utm_init(&tm, &o->ell);
+	if (utm_forward(&tm, lat, lon, &zone, &e, &n)) {
+		snprintf(lat_s, sizeof(lat_s), "%.6f", lat);
+		snprintf(lon_s, sizeof(lon_s), "%.6f", lon);
+		myerror("%s,%s: Position is outside the UTM area",
+		        trim_zeros(lat_s), trim_zeros(lon_s));
+		return NULL;
+	}
+
+	return format_utm(buf, 32, o->outpformat == OF_MGRS, lat, zone, e, n,
+	                  1.0);
+}
+
 /*
  * print_coordinate() - Prints a coordinate to stdout using the format in 
  * `o->outpformat`. `name` and `cmt` are used for the GPX format. If `cmt` 
@@ -52,7 +164,7 @@ static int print_coordinate(const struct Options *o,
 	round_number(&nlat, 6);
 	round_number(&nlon, 6);
 	if (o->outpformat == OF_DEFAULT) {
-		char *nlat_s, *nlon_s;
+		char *nlat_s, *nlon_s, hash[GEOHASH_MAX_LEN + 5];
 		nlat_s = allocstr("%f", nlat);
 		nlon_s = allocstr("%f", nlon);
 		if (!nlat_s || !nlon_s) {
@@ -63,7 +175,8 @@ static int print_coordinate(const struct Options *o,
 		}
 		trim_zeros(nlat_s);
 		trim_zeros(nlon_s);
-		printf("%s,%s\n", nlat_s, nlon_s);
+		printf("%s,%s%s\n", nlat_s, nlon_s,
+		       geohash_column(o, hash, nlat, nlon));
 		free(nlon_s);
 		free(nlat_s);
 	} else if (o->outpformat == OF_GPX) {
@@ -80,6 +193,12 @@ static int print_coordinate(const struct Options *o,
 		}
 		fputs(s, stdout);
 		free(s);
+	} else if (o->outpformat == OF_MGRS || o->outpformat == OF_UTM) {
+		char buf[32], hash[GEOHASH_MAX_LEN + 5];
+
+		if (!utm_coordinate(o, buf, lat, lon))
+			return 1;
+		printf("%s%s\n", buf, geohash_column(o, hash, nlat, nlon));
 	} else {
 		myerror("%s(): o->outpformat has unknown value:" /* gncov */
 		        " %d", __func__, o->outpformat); /* gncov */
@@ -142,6 +261,11 @@ static int print_eor_coor(const struct Options *o,
 		}
 		printf("%s%s</gpx>\n", GPX_HEADER, s);
 		break;
+	case OF_MGRS:
+	case OF_UTM:
+		if (print_coordinate(o, lat, lon, NULL, NULL))
+			goto cleanup;
+		break;
 	default: /* gncov */
 		goto cleanup; /* gncov */
 	}
@@ -180,6 +304,8 @@ int cmd_anti(const struct Options *o, const char *coor)
 	switch (o->outpformat) {
 	case OF_DEFAULT:
 	case OF_GPX:
+	case OF_MGRS:
+	case OF_UTM:
 		return print_eor_coor(o, nlat, nlon, "anti", coor, "", "")
 		       ? EXIT_FAILURE : EXIT_SUCCESS;
 	case OF_SQL:
@@ -252,9 +378,11 @@ int cmd_bear_dist(const char *cmd, const struct Options *o,
 	}
 
 	if (!strcmp(cmd, "bear"))
-		result = bearing(o->distformula, lat1, lon1, lat2, lon2);
+		result = bearing(o->distformula, &o->ell, lat1, lon1,
+		                 lat2, lon2);
 	else
-		result = distance(o->distformula, lat1, lon1, lat2, lon2);
+		result = distance(o->distformula, &o->ell, lat1, lon1,
+		                  lat2, lon2);
 	if (result == -2.0) {
 		myerror("Antipodal or coincident points, answer is undefined");
 		return EXIT_FAILURE;
@@ -296,9 +424,17 @@ int cmd_bear_dist(const char *cmd, const struct Options *o,
 		lat2_s = allocstr(sql_patt, lat2);
 		lon2_s = allocstr(sql_patt, lon2);
 		sql_patt = !strcmp(cmd, "bear") ? "%f" : "%.8f";
-		ib_s = allocstr(sql_patt, initial_bearing(lat1, lon1,
-		                                          lat2, lon2));
-		hav_s = allocstr(sql_patt, haversine(lat1, lon1, lat2, lon2));
+		if (o->distformula == FRM_RHUMB) {
+			ib_s = allocstr(sql_patt, rhumb_bearing(lat1, lon1,
+			                                        lat2, lon2));
+			hav_s = allocstr(sql_patt, rhumb_distance(lat1, lon1,
+			                                          lat2, lon2));
+		} else {
+			ib_s = allocstr(sql_patt, initial_bearing(lat1, lon1,
+			                                          lat2, lon2));
+			hav_s = allocstr(sql_patt, haversine(lat1, lon1,
+			                                     lat2, lon2));
+		}
 		if (!lat1_s || !lon1_s || !lat2_s || !lon2_s || !ib_s
 		    || !hav_s) {
 			failed("allocstr()"); /* gncov */
@@ -388,14 +524,20 @@ int cmd_bpos(const struct Options *o, const char *coor,
 	}
 	if (o->km)
 		dist *= 1000.0;
-	bearing_position(lat, lon, bearing, dist, &nlat, &nlon);
+	if (o->distformula == FRM_RHUMB) {
+		rhumb_position(lat, lon, bearing, dist, &nlat, &nlon);
+		ib_s = allocstr("%f", rhumb_bearing(lat, lon, nlat, nlon));
+		hav_s = allocstr("%f", rhumb_distance(lat, lon, nlat, nlon));
+	} else {
+		bearing_position(lat, lon, bearing, dist, &nlat, &nlon);
+		ib_s = allocstr("%f", initial_bearing(lat, lon, nlat, nlon));
+		hav_s = allocstr("%f", haversine(lat, lon, nlat, nlon));
+	}
 
 	lat_s = allocstr("%f", lat);
 	lon_s = allocstr("%f", lon);
 	nlat_s = allocstr("%f", nlat);
 	nlon_s = allocstr("%f", nlon);
-	ib_s = allocstr("%f", initial_bearing(lat, lon, nlat, nlon));
-	hav_s = allocstr("%f", haversine(lat, lon, nlat, nlon));
 	if (!lat_s || !lon_s || !nlat_s || !nlon_s || !ib_s || !hav_s) {
 		failed("allocstr()"); /* gncov */
 		goto cleanup; /* gncov */
@@ -409,6 +551,8 @@ int cmd_bpos(const struct Options *o, const char *coor,
 	switch (o->outpformat) {
 	case OF_DEFAULT:
 	case OF_GPX:
+	case OF_MGRS:
+	case OF_UTM:
 		retval = print_eor_coor(o, nlat, nlon, "bpos", coor, bearing_s,
 		                        dist_s)
 		         ? EXIT_FAILURE : EXIT_SUCCESS;
@@ -449,7 +593,8 @@ int cmd_course(const struct Options *o, const char *coor1, const char *coor2,
 {
 	double lat1, lon1, lat2, lon2, numpoints, nlat = 0.0, nlon = 0.0;
 	int i, retval = EXIT_FAILURE;
-	char *nlat_s = NULL, *nlon_s = NULL, *dist_s = NULL, *frac_s = NULL;
+	char *nlat_s = NULL, *nlon_s = NULL, *dist_s = NULL, *frac_s = NULL,
+	     hash[GEOHASH_MAX_LEN + 5];
 
 	assert(o);
 	assert(coor1);
@@ -471,7 +616,8 @@ int cmd_course(const struct Options *o, const char *coor1, const char *coor2,
 		myerror("%s: Invalid number of points", numpoints_s);
 		return EXIT_FAILURE;
 	}
-	if (are_antipodal(lat1, lon1, lat2, lon2)) {
+	if (o->distformula != FRM_RHUMB
+	    && are_antipodal(lat1, lon1, lat2, lon2)) {
 		myerror("Antipodal points, answer is undefined");
 		return EXIT_FAILURE;
 	}
@@ -483,6 +629,9 @@ int cmd_course(const struct Options *o, const char *coor1, const char *coor2,
 
 	switch (o->outpformat) {
 	case OF_DEFAULT:
+	case OF_GEOJSON:
+	case OF_MGRS:
+	case OF_UTM:
 		break;
 	case OF_GPX:
 		fputs(GPX_HEADER, stdout);
@@ -490,16 +639,25 @@ int cmd_course(const struct Options *o, const char *coor1, const char *coor2,
 		break;
 	case OF_SQL:
 		puts("BEGIN;");
-		puts("CREATE TABLE IF NOT EXISTS course (num INTEGER,"
-		     " lat REAL, lon REAL, dist REAL, frac REAL, bear REAL);");
+		printf("CREATE TABLE IF NOT EXISTS course (num INTEGER,"
+		       " lat REAL, lon REAL, dist REAL, frac REAL,"
+		       " bear REAL%s);\n", o->geohash ? ", geohash TEXT" : "");
 		break;
 	}
 
 	for (i = 0; i <= numpoints; i++) {
 		double frac = 1.0 * i / numpoints;
-		char *bear_s = NULL;
+		char *bear_s = NULL, utm[32];
 
-		routepoint(lat1, lon1, lat2, lon2, frac, &nlat, &nlon);
+		if (o->distformula == FRM_RHUMB)
+			rhumb_point(lat1, lon1, lat2, lon2, frac, &nlat,
+			            &nlon);
+		else
+			routepoint(lat1, lon1, lat2, lon2, frac, &nlat,
+			           &nlon);
+		if ((o->outpformat == OF_MGRS || o->outpformat == OF_UTM)
+		    && !utm_coordinate(o, utm, nlat, nlon))
+			goto cleanup;
 		round_number(&nlat, 6);
 		round_number(&nlon, 6);
 		nlat_s = allocstr("%f", nlat);
@@ -512,20 +670,30 @@ int cmd_course(const struct Options *o, const char *coor1, const char *coor2,
 		trim_zeros(nlon_s);
 		switch(o->outpformat) {
 		case OF_DEFAULT:
-			printf("%s,%s\n", nlat_s, nlon_s);
+		case OF_GEOJSON:
+			printf("%s,%s%s\n", nlat_s, nlon_s,
+			       geohash_column(o, hash, nlat, nlon));
 			break;
 		case OF_GPX:
 			printf("    <rtept lat=\"%s\" lon=\"%s\">\n"
 			       "    </rtept>\n", nlat_s, nlon_s);
 			break;
+		case OF_MGRS:
+		case OF_UTM:
+			printf("%s%s\n", utm,
+			       geohash_column(o, hash, nlat, nlon));
+			break;
 		case OF_SQL:
-			dist_s = allocstr("%f", haversine(lat1, lon1,
-			                                  nlat, nlon));
+			dist_s = allocstr("%f", distance(o->distformula,
+			                                 &o->ell,
+			                                 lat1, lon1,
+			                                 nlat, nlon));
 			frac_s = allocstr("%f", frac);
 			if (nlat != lat2 || nlon != lon2) {
-				bear_s = allocstr("%f",
-				                  initial_bearing(nlat, nlon,
-				                                  lat2, lon2));
+				bear_s = allocstr("%f", bearing(o->distformula,
+				                                &o->ell,
+				                                nlat, nlon,
+				                                lat2, lon2));
 			} else {
 				bear_s = allocstr("NULL");
 			}
@@ -537,8 +705,9 @@ int cmd_course(const struct Options *o, const char *coor1, const char *coor2,
 			trim_zeros(frac_s);
 			trim_zeros(bear_s);
 			printf("INSERT INTO course VALUES (%d, %s, %s, %s,"
-			       " %s, %s);\n",
-			       i, nlat_s, nlon_s, dist_s, frac_s, bear_s);
+			       " %s, %s%s);\n",
+			       i, nlat_s, nlon_s, dist_s, frac_s, bear_s,
+			       geohash_column(o, hash, nlat, nlon));
 			free(bear_s); bear_s = NULL;
 			break;
 		}
@@ -550,6 +719,9 @@ int cmd_course(const struct Options *o, const char *coor1, const char *coor2,
 
 	switch (o->outpformat) {
 	case OF_DEFAULT:
+	case OF_GEOJSON:
+	case OF_MGRS:
+	case OF_UTM:
 		break;
 	case OF_GPX:
 		puts("  </rte>");
@@ -605,15 +777,21 @@ int cmd_lpos(const struct Options *o, const char *coor1, const char *coor2,
 		myerror("%s: Invalid fraction", fracdist_p);
 		return EXIT_FAILURE;
 	}
-	if (are_antipodal(lat1, lon1, lat2, lon2)) {
+	if (o->distformula != FRM_RHUMB
+	    && are_antipodal(lat1, lon1, lat2, lon2)) {
 		myerror("Antipodal points, answer is undefined");
 		return EXIT_FAILURE;
 	}
-	routepoint(lat1, lon1, lat2, lon2, fracdist, &nlat, &nlon);
+	if (o->distformula == FRM_RHUMB)
+		rhumb_point(lat1, lon1, lat2, lon2, fracdist, &nlat, &nlon);
+	else
+		routepoint(lat1, lon1, lat2, lon2, fracdist, &nlat, &nlon);
 
 	switch (o->outpformat) {
 	case OF_DEFAULT:
 	case OF_GPX:
+	case OF_MGRS:
+	case OF_UTM:
 		return print_eor_coor(o, nlat, nlon, "lpos",
 		                      coor1, coor2, fracdist_p)
 		       ? EXIT_FAILURE : EXIT_SUCCESS;
@@ -630,8 +808,10 @@ int cmd_lpos(const struct Options *o, const char *coor1, const char *coor2,
 		fracdist_s = allocstr("%f", fracdist);
 		nlat_s = allocstr("%f", nlat);
 		nlon_s = allocstr("%f", nlon);
-		hav_s = allocstr("%f", haversine(lat1, lon1, nlat, nlon));
-		ib_s = allocstr("%f", initial_bearing(lat1, lon1, nlat, nlon));
+		hav_s = allocstr("%f", distance(o->distformula, &o->ell,
+		                                lat1, lon1, nlat, nlon));
+		ib_s = allocstr("%f", bearing(o->distformula, &o->ell,
+		                              lat1, lon1, nlat, nlon));
 
 		if (!lat1_s || !lon1_s || !lat2_s || !lon2_s || !fracdist_s
 		    || !nlat_s || !nlon_s || !hav_s || !ib_s) {
@@ -678,121 +858,192 @@ cleanup:
 }
 
 /*
- * cmd_randpos() - Executes the `randpos` command. Returns `EXIT_SUCCESS` or 
- * `EXIT_FAILURE`.
+ * randpos_print() - Used by cmd_randpos(). Prints the random position number 
+ * `l` at `lat, lon`, where `c_lat, c_lon` is the center position, or the 
+ * latitude is larger than 90 if no center is used. Returns 1 if anything 
+ * failed, otherwise 0.
  */
 
-int cmd_randpos(const struct Options *o, const char *coor,
-                const char *maxdist, const char *mindist)
+static int randpos_print(const struct Options *o, const unsigned long l,
+                         const double lat, const double lon,
+                         const double c_lat, const double c_lon)
 {
-	long l;
-	double c_lat = 1000, c_lon = 1000, maxdist_d = 0, mindist_d = 0;
-
-	assert(o);
+	char *name, *seedstr = NULL;
+	int res = 0;
 
-	if (coor) {
-		if (parse_coordinate(coor, true, &c_lat, &c_lon)) {
-			myerror("%s: Invalid coordinate", coor);
-			return EXIT_FAILURE;
-		}
-		if (maxdist && string_to_double(maxdist, &maxdist_d)) {
-			myerror("%s: Invalid max_dist argument", maxdist);
-			return EXIT_FAILURE;
+	if (o->seed) {
+		seedstr = allocstr(", seed %ld", o->seedval);
+		if (!seedstr) {
+			failed("allocstr()"); /* gncov */
+			return 1; /* gncov */
 		}
-		if (mindist && string_to_double(mindist, &mindist_d)) {
-			myerror("%s: Invalid min_dist argument", mindist);
-			return EXIT_FAILURE;
+	}
+	name = allocstr("Random %lu%s", l, seedstr ? seedstr : "");
+	if (!name) {
+		failed("allocstr()"); /* gncov */
+		free(seedstr); /* gncov */
+		return 1; /* gncov */
+	}
+
+	if (o->outpformat == OF_SQL) {
+		double dist, bear, nlat = lat, nlon = lon;
+		char *lat_s = NULL, *lon_s = NULL, *dist_s = NULL,
+		     *bear_s = NULL, hash[GEOHASH_MAX_LEN + 5];
+
+		dist = haversine(c_lat, c_lon, lat, lon);
+		bear = initial_bearing(c_lat, c_lon, lat, lon);
+		lat_s = allocstr("%f", lat);
+		lon_s = allocstr("%f", lon);
+		dist_s = allocstr("%f", dist);
+		bear_s = allocstr("%f", bear);
+		if (!lat_s || !lon_s || !dist_s || !bear_s) {
+			failed("allocstr()"); /* gncov */
+			return 1; /* gncov */
 		}
-		if (mindist_d < 0 || maxdist_d < 0) {
-			myerror("Distance cannot be negative");
-			return EXIT_FAILURE;
+		trim_zeros(lat_s);
+		trim_zeros(lon_s);
+		trim_zeros(dist_s);
+		trim_zeros(bear_s);
+		round_number(&nlat, 6);
+		round_number(&nlon, 6);
+		geohash_column(o, hash, nlat, nlon);
+		if (c_lat > 90.0) {
+			printf("INSERT INTO randpos VALUES"
+			       " (%ld, %lu, %s, %s, NULL, NULL%s);\n",
+			       o->seedval, l, lat_s, lon_s, hash);
+		} else {
+			printf("INSERT INTO randpos VALUES"
+			       " (%ld, %lu, %s, %s, %s, %s%s);\n",
+			       o->seedval, l, lat_s, lon_s, dist_s,
+			       bear_s, hash);
 		}
-		if (o->km) {
-			mindist_d *= 1000.0;
-			maxdist_d *= 1000.0;
+		free(lat_s);
+		free(lon_s);
+		free(dist_s);
+		free(bear_s);
+	} else {
+		res = print_coordinate(o, lat, lon, name, NULL);
+	}
+
+	free(name);
+	free(seedstr);
+
+	return res;
+}
+
+/*
+ * Where randpos_run() gets the random positions from. Positions are from 
+ * `poly` if it's set, from the box `lat1,lon1` to `lat2,lon2` if `box` is set, 
+ * or else from rand_pos() with the center `c_lat,c_lon`.
+ */
+
+struct randsrc {
+	const struct randpoly *poly;
+	int box;
+	double lat1, lon1, lat2, lon2;
+	double c_lat, c_lon, maxdist, mindist;
+};
+
+/*
+ * randpos_run() - Prints `o->count` random positions from `src`. If --sort is 
+ * used, the positions are sorted along the specified curve before they're 
+ * printed, using temporary files if there are more than SORT_CHUNK 
+ * positions. With --min-separation, random positions closer than that to an 
+ * already accepted position are thrown away, and the command fails after 
+ * SEPINDEX_MAX_MISSES rejections in a row. Returns `EXIT_SUCCESS` or 
+ * `EXIT_FAILURE`.
+ */
+
+static int randpos_run(const struct Options *o, const struct randsrc *src)
+{
+	struct possort ps;
+	struct sepindex si;
+	unsigned long l, misses = 0;
+	double lat, lon;
+	int retval = EXIT_FAILURE;
+
+	if (o->sort && possort_init(&ps, o->sort, SORT_CHUNK))
+		return EXIT_FAILURE; /* gncov */
+	if (o->min_separation > 0.0) {
+		const double sep = o->min_separation * (o->km ? 1000.0 : 1.0);
+
+		if (sepindex_init(&si, sep / EARTH_RADIUS)) {
+			if (o->sort) /* gncov */
+				possort_free(&ps); /* gncov */
+			return EXIT_FAILURE; /* gncov */
 		}
-		if (mindist_d > MAX_EARTH_DISTANCE)
-			mindist_d = MAX_EARTH_DISTANCE;
-		if (maxdist_d > MAX_EARTH_DISTANCE)
-			maxdist_d = MAX_EARTH_DISTANCE;
 	}
 
 	switch (o->outpformat) {
 	case OF_DEFAULT:
+	case OF_GEOJSON:
+	case OF_MGRS:
+	case OF_UTM:
 		break;
 	case OF_GPX:
 		fputs(GPX_HEADER, stdout);
 		break;
 	case OF_SQL:
 		puts("BEGIN;");
-		puts("CREATE TABLE IF NOT EXISTS randpos (seed INTEGER,"
-		     " num INTEGER, lat REAL, lon REAL, dist REAL,"
-		     " bear REAL);");
+		printf("CREATE TABLE IF NOT EXISTS randpos (seed INTEGER,"
+		       " num INTEGER, lat REAL, lon REAL, dist REAL,"
+		       " bear REAL%s);\n", o->geohash ? ", geohash TEXT" : "");
 		break;
 	}
 
-	for (l = 1; l <= o->count; l++) {
-		double lat, lon;
-		char *name, *seedstr = NULL;
+	for (l = 1; l <= (unsigned long)o->count; l++) {
+		if (src->poly)
+			randpoly_pos(src->poly, &lat, &lon);
+		else if (src->box)
+			rand_bbox(&lat, &lon, src->lat1, src->lon1,
+			          src->lat2, src->lon2);
+		else
+			rand_pos(&lat, &lon, src->c_lat, src->c_lon,
+			         src->maxdist, src->mindist);
+		if (o->min_separation > 0.0) {
+			const int res = sepindex_add(&si, lat, lon);
 
-		if (o->seed) {
-			seedstr = allocstr(", seed %ld", o->seedval);
-			if (!seedstr) {
-				failed("allocstr()"); /* gncov */
-				return EXIT_FAILURE; /* gncov */
+			if (res < 0)
+				goto cleanup; /* gncov */
+			if (res) {
+				if (++misses == SEPINDEX_MAX_MISSES) {
+					myerror("Found room for only %lu"
+					        " positions with the minimum"
+					        " separation", l - 1);
+					goto cleanup;
+				}
+				l--;
+				continue;
 			}
+			misses = 0;
 		}
-		rand_pos(&lat, &lon, c_lat, c_lon, maxdist_d, mindist_d);
-		name = allocstr("Random %lu%s", l, seedstr ? seedstr : "");
-		if (!name) {
-			failed("allocstr()"); /* gncov */
-			free(seedstr); /* gncov */
-			return EXIT_FAILURE; /* gncov */
+		if (o->sort) {
+			if (possort_add(&ps, lat, lon, l))
+				goto cleanup; /* gncov */
+		} else if (randpos_print(o, l, lat, lon, src->c_lat,
+		                         src->c_lon)) {
+			goto cleanup;
 		}
+	}
+	if (o->sort) {
+		PointStatus st;
 
-		if (o->outpformat == OF_SQL) {
-			double dist, bear;
-			char *lat_s = NULL, *lon_s = NULL, *dist_s = NULL,
-			     *bear_s = NULL;
-
-			dist = haversine(c_lat, c_lon, lat, lon);
-			bear = initial_bearing(c_lat, c_lon, lat, lon);
-			lat_s = allocstr("%f", lat);
-			lon_s = allocstr("%f", lon);
-			dist_s = allocstr("%f", dist);
-			bear_s = allocstr("%f", bear);
-			if (!lat_s || !lon_s || !dist_s || !bear_s) {
-				failed("allocstr()"); /* gncov */
-				return EXIT_FAILURE; /* gncov */
-			}
-			trim_zeros(lat_s);
-			trim_zeros(lon_s);
-			trim_zeros(dist_s);
-			trim_zeros(bear_s);
-			if (c_lat > 90.0) {
-				printf("INSERT INTO randpos VALUES"
-				       " (%ld, %ld, %s, %s, NULL, NULL);\n",
-				       o->seedval, l, lat_s, lon_s);
-			} else {
-				printf("INSERT INTO randpos VALUES"
-				       " (%ld, %ld, %s, %s, %s, %s);\n",
-				       o->seedval, l, lat_s, lon_s, dist_s,
-				       bear_s);
-			}
-			free(lat_s);
-			free(lon_s);
-			free(dist_s);
-			free(bear_s);
-		} else {
-			print_coordinate(o, lat, lon, name, NULL);
+		if (possort_finish(&ps))
+			goto cleanup; /* gncov */
+		while ((st = possort_next(&ps, &lat, &lon, &l)) == PS_POINT) {
+			if (randpos_print(o, l, lat, lon, src->c_lat,
+			                  src->c_lon))
+				goto cleanup; /* gncov */
 		}
-
-		free(name);
-		free(seedstr);
+		if (st == PS_ERROR)
+			goto cleanup; /* gncov */
 	}
 
 	switch (o->outpformat) {
 	case OF_DEFAULT:
+	case OF_GEOJSON:
+	case OF_MGRS:
+	case OF_UTM:
 		break;
 	case OF_GPX:
 		puts("</gpx>");
@@ -801,8 +1052,3129 @@ int cmd_randpos(const struct Options *o, const char *coor,
 		puts("COMMIT;");
 		break;
 	}
+	retval = EXIT_SUCCESS;
 
-	return EXIT_SUCCESS;
+cleanup:
+	if (o->sort)
+		possort_free(&ps);
+	if (o->min_separation > 0.0)
+		sepindex_free(&si);
+
+	return retval;
+}
+
+/*
+ * cmd_randpos() - Executes the `randpos` command. Returns `EXIT_SUCCESS` or 
+ * `EXIT_FAILURE`.
+ */
+
+int cmd_randpos(const struct Options *o, const char *coor,
+                const char *maxdist, const char *mindist)
+{
+	struct randsrc src;
+
+	assert(o);
+
+	memset(&src, 0, sizeof(src));
+	src.c_lat = src.c_lon = 1000;
+	if (coor) {
+		if (parse_coordinate(coor, true, &src.c_lat, &src.c_lon)) {
+			myerror("%s: Invalid coordinate", coor);
+			return EXIT_FAILURE;
+		}
+		if (maxdist && string_to_double(maxdist, &src.maxdist)) {
+			myerror("%s: Invalid max_dist argument", maxdist);
+			return EXIT_FAILURE;
+		}
+		if (mindist && string_to_double(mindist, &src.mindist)) {
+			myerror("%s: Invalid min_dist argument", mindist);
+			return EXIT_FAILURE;
+		}
+		if (src.mindist < 0 || src.maxdist < 0) {
+			myerror("Distance cannot be negative");
+			return EXIT_FAILURE;
+		}
+		if (o->km) {
+			src.mindist *= 1000.0;
+			src.maxdist *= 1000.0;
+		}
+		if (src.mindist > MAX_EARTH_DISTANCE)
+			src.mindist = MAX_EARTH_DISTANCE;
+		if (src.maxdist > MAX_EARTH_DISTANCE)
+			src.maxdist = MAX_EARTH_DISTANCE;
+	}
+
+	return randpos_run(o, &src);
+}
+
+/*
+ * struct track - State for cmd_track(). The positions of the current segment 
+ * are collected in `lat` and `lon` until TRACK_BATCH positions are stored, 
+ * then all legs are calculated with distance_batch() and bearing_batch() and 
+ * printed by track_flush(). The last position is kept as the first position 
+ * of the next batch.
+ */
+
+struct track {
+	const struct Options *o;
+	int decimals;
+	double lat[TRACK_BATCH];
+	double lon[TRACK_BATCH];
+	double dist[TRACK_BATCH];
+	double bear[TRACK_BATCH];
+	size_t num;
+	unsigned long segnum;
+	unsigned long legnum;
+	unsigned long segpoints;
+	struct compsum seglen;
+	struct compsum total;
+	struct bbox bbox;
+	double prev_ele;
+	double first_time;
+	double last_time;
+	bool has_ele;
+	bool has_time;
+	struct compsum ascent;
+	struct compsum descent;
+	struct compsum duration;
+};
+
+/*
+ * track_flush() - Calculates and prints the legs between the positions stored 
+ * in `t`, and keeps the last position as the start of the next leg. Returns 1 
+ * if the Karney formula failed, otherwise 0.
+ */
+
+static int track_flush(struct track *t)
+{
+	char lat1_s[32], lon1_s[32], lat2_s[32], lon2_s[32], dist_s[32],
+	     bear_s[32];
+	size_t i;
+
+	assert(t);
+
+	if (t->num < 2)
+		return 0;
+	distance_batch(t->o->distformula, &t->o->ell, t->lat, t->lon, t->num,
+	               t->dist);
+	bearing_batch(t->o->distformula, &t->o->ell, t->lat, t->lon, t->num,
+	              t->bear);
+
+	for (i = 0; i < t->num - 1; i++) {
+		const double dist = t->dist[i], bear = t->bear[i];
+		const bool has_bear = bear >= 0.0;
+
+		t->legnum++;
+		if (isnan(dist)) {
+			myerror("Formula did not converge in segment %lu,"
+			        " leg %lu, antipodal points",
+			        t->segnum, t->legnum);
+			return 1;
+		}
+		compsum_add(&t->seglen, dist);
+		compsum_add(&t->total, dist);
+		switch (t->o->outpformat) {
+		case OF_SQL:
+			format_number(lat1_s, sizeof(lat1_s), t->lat[i], 6);
+			format_number(lon1_s, sizeof(lon1_s), t->lon[i], 6);
+			format_number(lat2_s, sizeof(lat2_s), t->lat[i + 1],
+			              6);
+			format_number(lon2_s, sizeof(lon2_s), t->lon[i + 1],
+			              6);
+			format_number(dist_s, sizeof(dist_s), dist,
+			              t->decimals);
+			if (has_bear) {
+				format_number(bear_s, sizeof(bear_s), bear,
+				              t->decimals);
+			} else {
+				strcpy(bear_s, "NULL");
+			}
+			printf("INSERT INTO track_leg VALUES (%lu, %lu, %s,"
+			       " %s, %s, %s, %s, %s);\n",
+			       t->segnum, t->legnum, lat1_s, lon1_s, lat2_s,
+			       lon2_s, dist_s, bear_s);
+			break;
+		default:
+			format_number(dist_s, sizeof(dist_s),
+			              t->o->km ? dist / 1000.0 : dist,
+			              t->decimals);
+			if (has_bear) {
+				format_number(bear_s, sizeof(bear_s), bear,
+				              t->decimals);
+			} else {
+				strcpy(bear_s, "-");
+			}
+			printf("leg %lu %lu %s %s\n",
+			       t->segnum, t->legnum, dist_s, bear_s);
+			break;
+		}
+	}
+
+	t->lat[0] = t->lat[t->num - 1];
+	t->lon[0] = t->lon[t->num - 1];
+	t->num = 1;
+
+	return 0;
+}
+
+/*
+ * track_end_segment() - Prints the length of the current segment in `t` if it 
+ * contains any positions, and prepares for the next segment. Returns 1 if 
+ * track_flush() failed, otherwise 0.
+ */
+
+static int track_end_segment(struct track *t)
+{
+	char len_s[32];
+	double len;
+
+	assert(t);
+
+	if (track_flush(t))
+		return 1;
+	t->num = 0;
+	if (!isnan(t->first_time))
+		compsum_add(&t->duration, t->last_time - t->first_time);
+	t->prev_ele = t->first_time = t->last_time = NAN;
+	if (!t->segpoints)
+		return 0;
+
+	len = compsum_result(&t->seglen);
+	if (t->o->outpformat == OF_DEFAULT) {
+		format_number(len_s, sizeof(len_s),
+		              t->o->km ? len / 1000.0 : len, t->decimals);
+		printf("segment %lu %lu %s\n", t->segnum, t->segpoints, len_s);
+	}
+	t->segnum++;
+	t->legnum = 0;
+	t->segpoints = 0;
+	compsum_init(&t->seglen);
+
+	return 0;
+}
+
+/*
+ * track_summary() - Prints the total length, the number of positions and 
+ * segments, and the bounding box of the whole track in `t`. If any positions 
+ * contain elevation or time, the total ascent and descent and the sum of the 
+ * duration of all segments are also printed. Returns nothing.
+ */
+
+static void track_summary(const struct track *t)
+{
+	char len_s[32], south_s[32], west_s[32], north_s[32], east_s[32],
+	     ascent_s[32] = "NULL", descent_s[32] = "NULL",
+	     duration_s[32] = "NULL";
+	unsigned long segments;
+	double len, west, east, div;
+	bool empty;
+
+	assert(t);
+
+	segments = t->segnum - 1;
+	len = compsum_result(&t->total);
+	empty = bbox_lon(&t->bbox, &west, &east);
+	if (!empty) {
+		format_number(south_s, sizeof(south_s), t->bbox.minlat, 6);
+		format_number(west_s, sizeof(west_s), west, 6);
+		format_number(north_s, sizeof(north_s), t->bbox.maxlat, 6);
+		format_number(east_s, sizeof(east_s), east, 6);
+	}
+	div = t->o->km && t->o->outpformat != OF_SQL ? 1000.0 : 1.0;
+	if (t->has_ele) {
+		format_number(ascent_s, sizeof(ascent_s),
+		              compsum_result(&t->ascent) / div, t->decimals);
+		format_number(descent_s, sizeof(descent_s),
+		              compsum_result(&t->descent) / div, t->decimals);
+	}
+	if (t->has_time) {
+		format_number(duration_s, sizeof(duration_s),
+		              compsum_result(&t->duration), 6);
+	}
+
+	if (t->o->outpformat == OF_SQL) {
+		format_number(len_s, sizeof(len_s), len, t->decimals);
+		puts("CREATE TABLE IF NOT EXISTS track (points INTEGER,"
+		     " segments INTEGER, dist REAL, south REAL, west REAL,"
+		     " north REAL, east REAL, ascent REAL, descent REAL,"
+		     " duration REAL);");
+		if (empty) {
+			printf("INSERT INTO track VALUES (0, 0, 0, NULL, NULL,"
+			       " NULL, NULL, NULL, NULL, NULL);\n");
+		} else {
+			printf("INSERT INTO track VALUES (%lu, %lu, %s, %s,"
+			       " %s, %s, %s, %s, %s, %s);\n",
+			       t->bbox.count, segments, len_s, south_s,
+			       west_s, north_s, east_s, ascent_s, descent_s,
+			       duration_s);
+		}
+		return;
+	}
+
+	format_number(len_s, sizeof(len_s), len / div, t->decimals);
+	printf("length %s\n", len_s);
+	printf("points %lu\n", t->bbox.count);
+	printf("segments %lu\n", segments);
+	if (!empty)
+		printf("bbox %s,%s %s,%s\n", south_s, west_s, north_s, east_s);
+	if (t->has_ele) {
+		printf("ascent %s\n", ascent_s);
+		printf("descent %s\n", descent_s);
+	}
+	if (t->has_time)
+		printf("duration %s\n", duration_s);
+}
+
+/*
+ * track_extra() - Adds the elevation `ele` and the time `time` of a position 
+ * to the ascent, descent and duration in `t`. NaN values are ignored. Returns 
+ * nothing.
+ */
+
+static void track_extra(struct track *t, const double ele, const double time)
+{
+	if (!isnan(ele)) {
+		if (!isnan(t->prev_ele)) {
+			const double diff = ele - t->prev_ele;
+
+			if (diff > 0.0)
+				compsum_add(&t->ascent, diff);
+			else
+				compsum_add(&t->descent, -diff);
+		}
+		t->prev_ele = ele;
+		t->has_ele = true;
+	}
+	if (!isnan(time)) {
+		if (isnan(t->first_time))
+			t->first_time = time;
+		t->last_time = time;
+		t->has_time = true;
+	}
+}
+
+/*
+ * cmd_track() - Executes the `track` command. Reads positions from the file 
+ * `fname`, or stdin if `fname` is NULL or "-", and prints the distance and 
+ * initial bearing of every leg, the length of every segment, the total length 
+ * and the bounding box. The positions are read one at a time and the lengths 
+ * are added with compensated summation, so tracks of any size can be 
+ * processed without losing accuracy. Returns `EXIT_SUCCESS` or 
+ * `EXIT_FAILURE`.
+ */
+
+int cmd_track(const struct Options *o, const char *fname)
+{
+	struct pointreader pr;
+	struct track *t;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+
+	msg(7, "%s(\"%s\")", __func__, no_null(fname));
+
+	t = malloc(sizeof(struct track));
+	if (!t) {
+		failed("malloc()"); /* gncov */
+		return EXIT_FAILURE; /* gncov */
+	}
+	t->o = o;
+	t->decimals = o->distformula == FRM_KARNEY ? KARNEY_DECIMALS
+	                                           : HAVERSINE_DECIMALS;
+	t->num = 0;
+	t->segnum = 1;
+	t->legnum = 0;
+	t->segpoints = 0;
+	compsum_init(&t->seglen);
+	compsum_init(&t->total);
+	bbox_init(&t->bbox);
+	t->prev_ele = t->first_time = t->last_time = NAN;
+	t->has_ele = t->has_time = false;
+	compsum_init(&t->ascent);
+	compsum_init(&t->descent);
+	compsum_init(&t->duration);
+
+	if (pointreader_open(&pr, fname, o->inpformat)) {
+		free(t);
+		return EXIT_FAILURE;
+	}
+
+	if (o->outpformat == OF_SQL) {
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS track_leg (segment INTEGER,"
+		     " leg INTEGER, lat1 REAL, lon1 REAL, lat2 REAL,"
+		     " lon2 REAL, dist REAL, bear REAL);");
+	}
+
+	while (1) {
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK) {
+			if (track_end_segment(t))
+				goto cleanup;
+			continue;
+		}
+		if (t->num == TRACK_BATCH && track_flush(t))
+			goto cleanup;
+		t->lat[t->num] = lat;
+		t->lon[t->num] = lon;
+		t->num++;
+		t->segpoints++;
+		bbox_add(&t->bbox, lat, lon);
+		track_extra(t, pr.ele, pr.time);
+	}
+	if (track_end_segment(t))
+		goto cleanup;
+
+	track_summary(t);
+	if (o->outpformat == OF_SQL)
+		puts("COMMIT;");
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+	free(t);
+
+	return retval;
+}
+
+/*
+ * struct simplify - State for cmd_simplify(). The positions of the current 
+ * segment are collected in a window of SIMPLIFY_WINDOW positions. When the 
+ * window is full, it's simplified and printed, and the last position is kept 
+ * as the first position of the next window, so tracks of any size can be 
+ * simplified. `stack` contains the index ranges that haven't been checked yet 
+ * by simplify_window(). It never needs more entries than the number of 
+ * positions, since the ranges don't overlap.
+ */
+
+struct simplify {
+	const struct Options *o;
+	double tolerance;
+	double lat[SIMPLIFY_WINDOW];
+	double lon[SIMPLIFY_WINDOW];
+	double radius[SIMPLIFY_WINDOW];
+	struct vec3 vec[SIMPLIFY_WINDOW];
+	unsigned long num[SIMPLIFY_WINDOW];
+	bool keep[SIMPLIFY_WINDOW];
+	size_t stack[SIMPLIFY_WINDOW][2];
+	size_t n;
+	unsigned long segnum;
+	unsigned long segpoints;
+	bool seg_started;
+};
+
+/*
+ * simplify_window() - Marks the positions in the window of `s` that are kept 
+ * after simplification with the Douglas-Peucker algorithm. The algorithm 
+ * uses an explicit stack instead of recursion, so long tracks can't overflow 
+ * the call stack. The distance from every position to the arc between the 
+ * first and last position of a range is measured with arc_angle(), and the 
+ * position with the largest distance is kept if the distance is larger than 
+ * the tolerance. Returns nothing.
+ */
+
+static void simplify_window(struct simplify *s)
+{
+	size_t sp = 0, i;
+
+	for (i = 0; i < s->n; i++)
+		s->keep[i] = false;
+	s->keep[0] = s->keep[s->n - 1] = true;
+	s->stack[sp][0] = 0;
+	s->stack[sp++][1] = s->n - 1;
+
+	while (sp) {
+		size_t first, last, maxidx = 0;
+		double maxdist = -1.0;
+		struct arc arc;
+
+		sp--;
+		first = s->stack[sp][0];
+		last = s->stack[sp][1];
+		if (last - first < 2)
+			continue;
+		arc_init(&arc, &s->vec[first], &s->vec[last]);
+		for (i = first + 1; i < last; i++) {
+			const double d = arc_angle(&arc, &s->vec[i])
+			                 * s->radius[i];
+
+			if (d > maxdist) {
+				maxdist = d;
+				maxidx = i;
+			}
+		}
+		if (maxdist <= s->tolerance)
+			continue;
+		s->keep[maxidx] = true;
+		s->stack[sp][0] = first;
+		s->stack[sp++][1] = maxidx;
+		s->stack[sp][0] = maxidx;
+		s->stack[sp++][1] = last;
+	}
+}
+
+/*
+ * simplify_print() - Prints the position with index `i` in the window of `s`. 
+ * Returns nothing.
+ */
+
+static void simplify_print(const struct simplify *s, const size_t i)
+{
+	char lat_s[32], lon_s[32];
+
+	format_number(lat_s, sizeof(lat_s), s->lat[i], 6);
+	format_number(lon_s, sizeof(lon_s), s->lon[i], 6);
+	switch (s->o->outpformat) {
+	case OF_GPX:
+		printf("      <trkpt lat=\"%s\" lon=\"%s\">\n"
+		       "      </trkpt>\n", lat_s, lon_s);
+		break;
+	case OF_SQL:
+		printf("INSERT INTO simplify VALUES (%lu, %lu, %s, %s);\n",
+		       s->segnum, s->num[i], lat_s, lon_s);
+		break;
+	default:
+		printf("%s,%s\n", lat_s, lon_s);
+		break;
+	}
+}
+
+/*
+ * simplify_flush() - Simplifies and prints the positions in the window of 
+ * `s`. If `final` is false, the last position is kept as the first position 
+ * of the next window, otherwise the segment is ended. Returns nothing.
+ */
+
+static void simplify_flush(struct simplify *s, const bool final)
+{
+	size_t i, last;
+
+	if (!s->n)
+		return;
+	if (!s->seg_started) {
+		if (s->o->outpformat == OF_GPX)
+			puts("    <trkseg>");
+		else if (s->o->outpformat == OF_DEFAULT && s->segnum > 1)
+			puts("");
+		s->seg_started = true;
+	}
+
+	simplify_window(s);
+	last = final ? s->n : s->n - 1;
+	for (i = 0; i < last; i++) {
+		if (s->keep[i])
+			simplify_print(s, i);
+	}
+
+	if (!final) {
+		s->lat[0] = s->lat[s->n - 1];
+		s->lon[0] = s->lon[s->n - 1];
+		s->radius[0] = s->radius[s->n - 1];
+		s->vec[0] = s->vec[s->n - 1];
+		s->num[0] = s->num[s->n - 1];
+		s->n = 1;
+		return;
+	}
+	if (s->o->outpformat == OF_GPX)
+		puts("    </trkseg>");
+	s->n = 0;
+	s->segnum++;
+	s->segpoints = 0;
+	s->seg_started = false;
+}
+
+/*
+ * cmd_simplify() - Executes the `simplify` command. Reads positions from the 
+ * file `fname`, or stdin if `fname` is NULL or "-", and prints the positions 
+ * that are needed to keep the track within `tolerance_s` meters of the 
+ * original track. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_simplify(const struct Options *o, const char *tolerance_s,
+                 const char *fname)
+{
+	struct pointreader pr;
+	struct simplify *s;
+	double tolerance;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+	assert(tolerance_s);
+
+	msg(7, "%s(\"%s\", \"%s\")", __func__, tolerance_s, no_null(fname));
+
+	if (string_to_double(tolerance_s, &tolerance)
+	    || !isfinite(tolerance)) {
+		myerror("%s: Invalid tolerance", tolerance_s);
+		return EXIT_FAILURE;
+	}
+	if (tolerance < 0.0) {
+		myerror("%s: Tolerance cannot be negative", tolerance_s);
+		return EXIT_FAILURE;
+	}
+
+	s = malloc(sizeof(struct simplify));
+	if (!s) {
+		failed("malloc()"); /* gncov */
+		return EXIT_FAILURE; /* gncov */
+	}
+	s->o = o;
+	s->tolerance = o->km ? tolerance * 1000.0 : tolerance;
+	s->n = 0;
+	s->segnum = 1;
+	s->segpoints = 0;
+	s->seg_started = false;
+
+	if (pointreader_open(&pr, fname, o->inpformat)) {
+		free(s);
+		return EXIT_FAILURE;
+	}
+
+	switch (o->outpformat) {
+	case OF_GPX:
+		fputs(GPX_HEADER, stdout);
+		puts("  <trk>");
+		break;
+	case OF_SQL:
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS simplify (segment INTEGER,"
+		     " num INTEGER, lat REAL, lon REAL);");
+		break;
+	default:
+		break;
+	}
+
+	while (1) {
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK) {
+			simplify_flush(s, true);
+			continue;
+		}
+		if (s->n == SIMPLIFY_WINDOW)
+			simplify_flush(s, false);
+		s->lat[s->n] = lat;
+		s->lon[s->n] = lon;
+		s->radius[s->n] = o->distformula == FRM_KARNEY
+		                  ? gaussian_radius(&o->ell, lat)
+		                  : EARTH_RADIUS;
+		pos_to_vec3(lat, lon, &s->vec[s->n]);
+		s->num[s->n] = ++s->segpoints;
+		s->n++;
+	}
+	simplify_flush(s, true);
+
+	switch (o->outpformat) {
+	case OF_GPX:
+		puts("  </trk>");
+		puts("</gpx>");
+		break;
+	case OF_SQL:
+		puts("COMMIT;");
+		break;
+	default:
+		break;
+	}
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+	free(s);
+
+	return retval;
+}
+
+/*
+ * struct xtrack - State for cmd_xtrack(). The positions are collected in 
+ * `lat` and `lon` until XTRACK_BATCH positions are stored, then the distances 
+ * to the route are calculated with polyline_batch() and printed by 
+ * xtrack_flush().
+ */
+
+struct xtrack {
+	const struct Options *o;
+	double lat[XTRACK_BATCH];
+	double lon[XTRACK_BATCH];
+	double xtrack[XTRACK_BATCH];
+	double atrack[XTRACK_BATCH];
+	size_t leg[XTRACK_BATCH];
+	size_t n;
+	unsigned long num;
+};
+
+/*
+ * xtrack_flush() - Calculates and prints the distances from the positions 
+ * stored in `x` to the route in `pl`. Returns nothing.
+ */
+
+static void xtrack_flush(struct xtrack *x, const struct polyline *pl)
+{
+	char lat_s[32], lon_s[32], xtrack_s[32], atrack_s[32];
+	const double div = x->o->km && x->o->outpformat != OF_SQL ? 1000.0
+	                                                           : 1.0;
+	size_t i;
+
+	polyline_batch(pl, x->lat, x->lon, x->n, x->xtrack, x->atrack,
+	               x->leg);
+	for (i = 0; i < x->n; i++) {
+		format_number(xtrack_s, sizeof(xtrack_s), x->xtrack[i] / div,
+		              HAVERSINE_DECIMALS);
+		format_number(atrack_s, sizeof(atrack_s), x->atrack[i] / div,
+		              HAVERSINE_DECIMALS);
+		x->num++;
+		if (x->o->outpformat == OF_SQL) {
+			format_number(lat_s, sizeof(lat_s), x->lat[i], 6);
+			format_number(lon_s, sizeof(lon_s), x->lon[i], 6);
+			printf("INSERT INTO xtrack VALUES (%lu, %s, %s, %s,"
+			       " %s, %zu);\n",
+			       x->num, lat_s, lon_s, xtrack_s, atrack_s,
+			       x->leg[i] + 1);
+		} else {
+			printf("%s %s %zu\n",
+			       xtrack_s, atrack_s, x->leg[i] + 1);
+		}
+	}
+	x->n = 0;
+}
+
+/*
+ * xtrack_read_route() - Reads the route from the file `fname` into `pl`. An 
+ * empty line or a segment break in the file starts a new segment, and no leg 
+ * is created between the segments. Returns 0 if the route contains at least 
+ * one leg, otherwise 1.
+ */
+
+static int xtrack_read_route(const struct Options *o, const char *fname,
+                             struct polyline *pl)
+{
+	struct pointreader pr;
+	int retval = 1;
+
+	if (pointreader_open(&pr, fname, o->inpformat))
+		return 1;
+
+	while (1) {
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK) {
+			polyline_break(pl);
+			continue;
+		}
+		if (polyline_add(pl, lat, lon))
+			goto cleanup; /* gncov */
+	}
+	if (!pl->n) {
+		myerror("%s: The route must contain at least one leg",
+		        pr.name);
+		goto cleanup;
+	}
+	retval = 0;
+
+cleanup:
+	pointreader_close(&pr);
+
+	return retval;
+}
+
+/*
+ * cmd_xtrack() - Executes the `xtrack` command. Reads a route from the file 
+ * `route`, then reads positions from the file `fname`, or stdin if `fname` is 
+ * NULL or "-", and prints the cross-track distance, the along-track distance 
+ * and the number of the nearest leg of the route for every position. Returns 
+ * `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_xtrack(const struct Options *o, const char *route, const char *fname)
+{
+	struct pointreader pr;
+	struct polyline pl;
+	struct xtrack *x;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+	assert(route);
+
+	msg(7, "%s(\"%s\", \"%s\")", __func__, route, no_null(fname));
+
+	if (!strcmp(route, "-") && (!fname || !strcmp(fname, "-"))) {
+		myerror("The route and the positions cannot both be read from"
+		        " stdin");
+		return EXIT_FAILURE;
+	}
+
+	polyline_init(&pl);
+	if (xtrack_read_route(o, route, &pl)) {
+		polyline_free(&pl);
+		return EXIT_FAILURE;
+	}
+
+	x = malloc(sizeof(struct xtrack));
+	if (!x) {
+		failed("malloc()"); /* gncov */
+		polyline_free(&pl); /* gncov */
+		return EXIT_FAILURE; /* gncov */
+	}
+	x->o = o;
+	x->n = 0;
+	x->num = 0;
+
+	if (pointreader_open(&pr, fname, o->inpformat)) {
+		free(x);
+		polyline_free(&pl);
+		return EXIT_FAILURE;
+	}
+
+	if (o->outpformat == OF_SQL) {
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS xtrack (num INTEGER,"
+		     " lat REAL, lon REAL, xtrack REAL, atrack REAL,"
+		     " leg INTEGER);");
+	}
+
+	while (1) {
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK)
+			continue;
+		if (x->n == XTRACK_BATCH)
+			xtrack_flush(x, &pl);
+		x->lat[x->n] = lat;
+		x->lon[x->n] = lon;
+		x->n++;
+	}
+	xtrack_flush(x, &pl);
+
+	if (o->outpformat == OF_SQL)
+		puts("COMMIT;");
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+	free(x);
+	polyline_free(&pl);
+
+	return retval;
+}
+
+/*
+ * struct fences - The fences read by fence_read(). The positions of the 
+ * current fence are collected in `lat` and `lon` until the fence is complete.
+ */
+
+struct fences {
+	const char *name;
+	struct polygon *polys;
+	size_t num;
+	size_t alloc;
+	double *lat;
+	double *lon;
+	size_t n;
+	size_t nalloc;
+};
+
+/*
+ * fence_add_pos() - Adds the position `lat,lon` to the current fence in `f`. 
+ * Returns 1 if the memory allocation failed, otherwise 0.
+ */
+
+static int fence_add_pos(struct fences *f, const double lat, const double lon)
+{
+	if (f->n == f->nalloc) {
+		const size_t alloc = f->nalloc ? f->nalloc * 2 : 64;
+		double *p;
+
+		p = realloc(f->lat, alloc * sizeof(double));
+		if (!p) {
+			failed("realloc()"); /* gncov */
+			return 1; /* gncov */
+		}
+		f->lat = p;
+		p = realloc(f->lon, alloc * sizeof(double));
+		if (!p) {
+			failed("realloc()"); /* gncov */
+			return 1; /* gncov */
+		}
+		f->lon = p;
+		f->nalloc = alloc;
+	}
+	f->lat[f->n] = lat;
+	f->lon[f->n] = lon;
+	f->n++;
+
+	return 0;
+}
+
+/*
+ * fence_end() - Creates a polygon from the positions of the current fence in 
+ * `f`, if there are any. Returns 1 if the fence has less than 3 positions, if 
+ * it's larger than a hemisphere, or if the memory allocation failed. 
+ * Otherwise, it returns 0.
+ */
+
+static int fence_end(struct fences *f)
+{
+	struct polygon *pg;
+
+	if (!f->n)
+		return 0;
+	if (f->num == f->alloc) {
+		const size_t alloc = f->alloc ? f->alloc * 2 : 64;
+
+		pg = realloc(f->polys, alloc * sizeof(struct polygon));
+		if (!pg) {
+			failed("realloc()"); /* gncov */
+			return 1; /* gncov */
+		}
+		f->polys = pg;
+		f->alloc = alloc;
+	}
+
+	pg = &f->polys[f->num];
+	if (polygon_init(pg, f->lat, f->lon, f->n))
+		return 1; /* gncov */
+	f->num++;
+	f->n = 0;
+	if (pg->n < 3) {
+		myerror("%s: Fence %zu has less than 3 positions",
+		        f->name, f->num);
+		return 1;
+	}
+	if (!(pg->cap.radius < M_PI / 2.0)) {
+		myerror("%s: Fence %zu is larger than a hemisphere",
+		        f->name, f->num);
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * fence_read() - Reads the fences from the file `fname` into `f`. Every 
+ * segment in the file is a fence, where the last position is connected to the 
+ * first. Returns 0 if the file contains at least one fence, otherwise 1.
+ */
+
+static int fence_read(const struct Options *o, const char *fname,
+                      struct fences *f)
+{
+	struct pointreader pr;
+	int retval = 1;
+
+	if (pointreader_open(&pr, fname, o->inpformat))
+		return 1;
+	f->name = pr.name;
+
+	while (1) {
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK) {
+			if (fence_end(f))
+				goto cleanup;
+			continue;
+		}
+		if (fence_add_pos(f, lat, lon))
+			goto cleanup; /* gncov */
+	}
+	if (fence_end(f))
+		goto cleanup;
+	if (!f->num) {
+		myerror("%s: No fences found", f->name);
+		goto cleanup;
+	}
+	retval = 0;
+
+cleanup:
+	pointreader_close(&pr);
+
+	return retval;
+}
+
+/*
+ * fence_print() - Prints that the position number `num` at `lat,lon` is inside 
+ * the fence with index `fence`. Returns nothing.
+ */
+
+static void fence_print(const struct Options *o, const unsigned long num,
+                        const double lat, const double lon,
+                        const size_t fence)
+{
+	char lat_s[32], lon_s[32];
+
+	if (o->outpformat == OF_SQL) {
+		format_number(lat_s, sizeof(lat_s), lat, 6);
+		format_number(lon_s, sizeof(lon_s), lon, 6);
+		printf("INSERT INTO fence VALUES (%lu, %s, %s, %zu);\n",
+		       num, lat_s, lon_s, fence + 1);
+	} else {
+		printf("%lu %zu\n", num, fence + 1);
+	}
+}
+
+/*
+ * cmd_fence() - Executes the `fence` command. Reads polygons from the file 
+ * `fences`, then reads positions from the file `fname`, or stdin if `fname` is 
+ * NULL or "-", and prints the number of the position and the number of the 
+ * fence for every fence that contains a position. The fences are stored in a 
+ * spatial index, so every position is only tested against the fences close to 
+ * it. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_fence(const struct Options *o, const char *fences, const char *fname)
+{
+	struct pointreader pr;
+	struct fences f;
+	struct polyindex idx;
+	size_t *found = NULL, i;
+	unsigned long num = 0;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+	assert(fences);
+
+	msg(7, "%s(\"%s\", \"%s\")", __func__, fences, no_null(fname));
+
+	if (!strcmp(fences, "-") && (!fname || !strcmp(fname, "-"))) {
+		myerror("The fences and the positions cannot both be read from"
+		        " stdin");
+		return EXIT_FAILURE;
+	}
+
+	memset(&f, 0, sizeof(f));
+	memset(&idx, 0, sizeof(idx));
+	if (fence_read(o, fences, &f))
+		goto free_fences;
+	if (polyindex_init(&idx, f.polys, f.num))
+		goto free_fences; /* gncov */
+	found = malloc(f.num * sizeof(size_t));
+	if (!found) {
+		failed("malloc()"); /* gncov */
+		goto free_fences; /* gncov */
+	}
+	if (pointreader_open(&pr, fname, o->inpformat))
+		goto free_fences;
+
+	if (o->outpformat == OF_SQL) {
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS fence (num INTEGER,"
+		     " lat REAL, lon REAL, fence INTEGER);");
+	}
+
+	while (1) {
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+		size_t count;
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK)
+			continue;
+		num++;
+		count = polyindex_search(&idx, lat, lon, found);
+		for (i = 0; i < count; i++)
+			fence_print(o, num, lat, lon, found[i]);
+	}
+
+	if (o->outpformat == OF_SQL)
+		puts("COMMIT;");
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+free_fences:
+	free(found);
+	polyindex_free(&idx);
+	for (i = 0; i < f.num; i++)
+		polygon_free(&f.polys[i]);
+	free(f.polys);
+	free(f.lon);
+	free(f.lat);
+
+	return retval;
+}
+
+/*
+ * cmd_geohash() - Executes the `geohash` command. Reads positions from the 
+ * file `fname`, or stdin if `fname` is NULL or "-", and prints the geohash of 
+ * every position with the length specified by --geohash, or GEOHASH_MAX_LEN 
+ * characters if it isn't used. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_geohash(const struct Options *o, const char *fname)
+{
+	struct pointreader pr;
+	const size_t len = o->geohash ? o->geohash : GEOHASH_MAX_LEN;
+	unsigned long num = 0;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+
+	msg(7, "%s(\"%s\")", __func__, no_null(fname));
+
+	if (pointreader_open(&pr, fname, o->inpformat))
+		return EXIT_FAILURE;
+
+	if (o->outpformat == OF_SQL) {
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS geohash (num INTEGER,"
+		     " lat REAL, lon REAL, geohash TEXT);");
+	}
+
+	while (1) {
+		char hash[GEOHASH_MAX_LEN + 1], lat_s[32], lon_s[32];
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK)
+			continue;
+		num++;
+		geohash_encode(lat, lon, len, hash);
+		if (o->outpformat == OF_SQL) {
+			format_number(lat_s, sizeof(lat_s), lat, 6);
+			format_number(lon_s, sizeof(lon_s), lon, 6);
+			printf("INSERT INTO geohash VALUES (%lu, %s, %s,"
+			       " '%s');\n", num, lat_s, lon_s, hash);
+		} else {
+			puts(hash);
+		}
+	}
+
+	if (o->outpformat == OF_SQL)
+		puts("COMMIT;");
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+
+	return retval;
+}
+
+/*
+ * cmd_sort() - Executes the `sort` command. Reads positions from the file 
+ * `fname`, or stdin if `fname` is NULL or "-", and prints them sorted along 
+ * the curve specified by --sort, or the Hilbert curve if it isn't used. 
+ * Segment breaks are ignored. If there are more than SORT_CHUNK positions, 
+ * they're sorted in runs that are stored in temporary files and merged, so 
+ * files larger than the available memory can be sorted. Returns 
+ * `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_sort(const struct Options *o, const char *fname)
+{
+	struct pointreader pr;
+	struct possort ps;
+	unsigned long num = 0;
+	double lat, lon;
+	PointStatus st;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+
+	msg(7, "%s(\"%s\")", __func__, no_null(fname));
+
+	if (possort_init(&ps, o->sort ? o->sort : SO_HILBERT, SORT_CHUNK))
+		return EXIT_FAILURE; /* gncov */
+	if (pointreader_open(&pr, fname, o->inpformat))
+		goto free_sort;
+	while ((st = pointreader_next(&pr, &lat, &lon)) != PS_EOF) {
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_POINT && possort_add(&ps, lat, lon, ++num))
+			goto cleanup; /* gncov */
+	}
+	if (possort_finish(&ps))
+		goto cleanup; /* gncov */
+
+	if (o->outpformat == OF_SQL) {
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS sort (num INTEGER,"
+		     " lat REAL, lon REAL);");
+	}
+	while ((st = possort_next(&ps, &lat, &lon, &num)) == PS_POINT) {
+		char lat_s[32], lon_s[32];
+
+		format_number(lat_s, sizeof(lat_s), lat, 6);
+		format_number(lon_s, sizeof(lon_s), lon, 6);
+		if (o->outpformat == OF_SQL) {
+			printf("INSERT INTO sort VALUES (%lu, %s, %s);\n",
+			       num, lat_s, lon_s);
+		} else {
+			printf("%s,%s\n", lat_s, lon_s);
+		}
+	}
+	if (st == PS_ERROR)
+		goto cleanup; /* gncov */
+	if (o->outpformat == OF_SQL)
+		puts("COMMIT;");
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+free_sort:
+	possort_free(&ps);
+
+	return retval;
+}
+
+/*
+ * struct posarray - The positions read by posarray_read().
+ */
+
+struct posarray {
+	double *lat;
+	double *lon;
+	size_t n;
+	size_t alloc;
+};
+
+/*
+ * posarray_read() - Reads the positions from the file `fname`, or stdin if 
+ * `fname` is NULL or "-", into `pa`. Segment breaks are ignored. If `required` 
+ * is true, the file must contain at least one position. Returns 1 if anything 
+ * failed, otherwise 0.
+ */
+
+static int posarray_read(const struct Options *o, const char *fname,
+                         struct posarray *pa, const bool required)
+{
+	struct pointreader pr;
+	int retval = 1;
+
+	if (pointreader_open(&pr, fname, o->inpformat))
+		return 1;
+
+	while (1) {
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK)
+			continue;
+		if (pa->n == pa->alloc) {
+			const size_t alloc = pa->alloc ? pa->alloc * 2 : 64;
+			double *p;
+
+			p = realloc(pa->lat, alloc * sizeof(double));
+			if (!p) {
+				failed("realloc()"); /* gncov */
+				goto cleanup; /* gncov */
+			}
+			pa->lat = p;
+			p = realloc(pa->lon, alloc * sizeof(double));
+			if (!p) {
+				failed("realloc()"); /* gncov */
+				goto cleanup; /* gncov */
+			}
+			pa->lon = p;
+			pa->alloc = alloc;
+		}
+		pa->lat[pa->n] = lat;
+		pa->lon[pa->n] = lon;
+		pa->n++;
+	}
+	if (required && !pa->n) {
+		myerror("%s: No positions found", pr.name);
+		goto cleanup;
+	}
+	retval = 0;
+
+cleanup:
+	pointreader_close(&pr);
+
+	return retval;
+}
+
+/*
+ * join_print() - Prints the pair consisting of the position number `num` at 
+ * `lat,lon` and the position with index `ref` in `pa`, with the distance 
+ * `dist` between them. Returns nothing.
+ */
+
+static void join_print(const struct Options *o, const struct posarray *pa,
+                       const unsigned long num,
+                       const double lat, const double lon,
+                       const size_t ref, const double dist)
+{
+	char lat_s[32], lon_s[32], rlat_s[32], rlon_s[32], dist_s[32];
+	const double div = o->km && o->outpformat != OF_SQL ? 1000.0 : 1.0;
+
+	format_number(lat_s, sizeof(lat_s), lat, 6);
+	format_number(lon_s, sizeof(lon_s), lon, 6);
+	format_number(rlat_s, sizeof(rlat_s), pa->lat[ref], 6);
+	format_number(rlon_s, sizeof(rlon_s), pa->lon[ref], 6);
+	format_number(dist_s, sizeof(dist_s), dist / div,
+	              o->distformula == FRM_KARNEY ? KARNEY_DECIMALS
+	                                           : HAVERSINE_DECIMALS);
+	switch (o->outpformat) {
+	case OF_GPX:
+		printf("    <trkseg>\n"
+		       "      <trkpt lat=\"%s\" lon=\"%s\">\n"
+		       "      </trkpt>\n"
+		       "      <trkpt lat=\"%s\" lon=\"%s\">\n"
+		       "      </trkpt>\n"
+		       "    </trkseg>\n",
+		       lat_s, lon_s, rlat_s, rlon_s);
+		break;
+	case OF_SQL:
+		printf("INSERT INTO pairs VALUES (%lu, %s, %s, %zu, %s, %s,"
+		       " %s);\n",
+		       num, lat_s, lon_s, ref + 1, rlat_s, rlon_s, dist_s);
+		break;
+	default:
+		printf("%lu %zu %s\n", num, ref + 1, dist_s);
+		break;
+	}
+}
+
+/*
+ * cmd_join() - Executes the `join` command. Reads positions from the file 
+ * `points` and stores them in a spatial index, then reads positions from the 
+ * file `fname`, or stdin if `fname` is NULL or "-", and prints every pair of 
+ * positions that are within `maxdist_s` meters of each other. If --nearest is 
+ * used, only the nearest position is printed. The index is searched with a 
+ * radius that is JOIN_MARGIN times larger than the maximum distance to allow 
+ * for the ellipsoid, and the distances of the candidates are calculated with 
+ * the selected formula. An approximate formula from --approx is only used if 
+ * the search radius is within the range of its error bound, and candidates 
+ * near `maxdist_s` are recalculated with the exact formula, so the same pairs 
+ * are found. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_join(const struct Options *o, const char *points,
+             const char *maxdist_s, const char *fname)
+{
+	struct pointreader pr;
+	struct posarray pts;
+	struct pointindex idx;
+	size_t *found = NULL, i;
+	unsigned long num = 0;
+	double maxdist;
+	DistFormula formula = o->distformula;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+	assert(points);
+	assert(maxdist_s);
+
+	msg(7, "%s(\"%s\", \"%s\", \"%s\")",
+	    __func__, points, maxdist_s, no_null(fname));
+
+	if (string_to_double(maxdist_s, &maxdist) || !isfinite(maxdist)) {
+		myerror("%s: Invalid distance", maxdist_s);
+		return EXIT_FAILURE;
+	}
+	if (maxdist < 0.0) {
+		myerror("%s: Distance cannot be negative", maxdist_s);
+		return EXIT_FAILURE;
+	}
+	if (o->km)
+		maxdist *= 1000.0;
+	if (!strcmp(points, "-") && (!fname || !strcmp(fname, "-"))) {
+		myerror("The points and the positions cannot both be read from"
+		        " stdin");
+		return EXIT_FAILURE;
+	}
+
+	if ((maxdist * JOIN_MARGIN + 1.0) * JOIN_MARGIN > APPROX_MAX_DIST)
+		approx_error(o->distformula, &formula);
+
+	memset(&pts, 0, sizeof(pts));
+	memset(&idx, 0, sizeof(idx));
+	if (posarray_read(o, points, &pts, true))
+		goto free_points;
+	if (pointindex_init(&idx, pts.lat, pts.lon, pts.n,
+	                    (maxdist * JOIN_MARGIN + 1.0) / EARTH_RADIUS))
+		goto free_points; /* gncov */
+	found = malloc(pts.n * sizeof(size_t));
+	if (!found) {
+		failed("malloc()"); /* gncov */
+		goto free_points; /* gncov */
+	}
+	if (pointreader_open(&pr, fname, o->inpformat))
+		goto free_points;
+
+	switch (o->outpformat) {
+	case OF_GPX:
+		fputs(GPX_HEADER, stdout);
+		puts("  <trk>");
+		break;
+	case OF_SQL:
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS pairs (num INTEGER,"
+		     " lat REAL, lon REAL, ref INTEGER, ref_lat REAL,"
+		     " ref_lon REAL, dist REAL);");
+		break;
+	default:
+		break;
+	}
+
+	while (1) {
+		double lat, lon, bestdist = INFINITY;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+		size_t count, best = 0;
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK)
+			continue;
+		num++;
+		count = pointindex_search(&idx, lat, lon, found);
+		for (i = 0; i < count; i++) {
+			const size_t ref = found[i];
+			const double dist = threshold_distance(formula,
+			                                       &o->ell,
+			                                       lat, lon,
+			                                       pts.lat[ref],
+			                                       pts.lon[ref],
+			                                       maxdist);
+
+			if (!(dist <= maxdist))
+				continue;
+			if (!o->nearest) {
+				join_print(o, &pts, num, lat, lon, ref, dist);
+			} else if (dist < bestdist) {
+				bestdist = dist;
+				best = ref;
+			}
+		}
+		if (o->nearest && isfinite(bestdist))
+			join_print(o, &pts, num, lat, lon, best, bestdist);
+	}
+
+	switch (o->outpformat) {
+	case OF_GPX:
+		puts("  </trk>");
+		puts("</gpx>");
+		break;
+	case OF_SQL:
+		puts("COMMIT;");
+		break;
+	default:
+		break;
+	}
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+free_points:
+	free(found);
+	pointindex_free(&idx);
+	free(pts.lon);
+	free(pts.lat);
+
+	return retval;
+}
+
+/*
+ * cluster_print() - Prints the centroids of the `numclusters` clusters found 
+ * by dbscan(), calculated from the positions in `pa` and the cluster numbers 
+ * in `cluster`. The centroid is the normalized sum of the unit vectors of the 
+ * positions in the cluster. Returns 1 if anything failed, otherwise 0.
+ */
+
+static int cluster_print(const struct Options *o, const struct posarray *pa,
+                         const unsigned long *cluster,
+                         const unsigned long numclusters)
+{
+	struct vec3 *sum;
+	size_t *count, i;
+	int retval = 1;
+
+	sum = calloc(numclusters + 1, sizeof(struct vec3));
+	count = calloc(numclusters + 1, sizeof(size_t));
+	if (!sum || !count) {
+		failed("calloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	for (i = 0; i < pa->n; i++) {
+		struct vec3 v;
+
+		pos_to_vec3(pa->lat[i], pa->lon[i], &v);
+		sum[cluster[i]].x += v.x;
+		sum[cluster[i]].y += v.y;
+		sum[cluster[i]].z += v.z;
+		count[cluster[i]]++;
+	}
+
+	for (i = 1; i <= numclusters; i++) {
+		char lat_s[32], lon_s[32], *name, *cmt;
+		double lat, lon;
+		int res;
+
+		vec3_to_pos(&sum[i], &lat, &lon);
+		format_number(lat_s, sizeof(lat_s), lat, 6);
+		format_number(lon_s, sizeof(lon_s), lon, 6);
+		switch (o->outpformat) {
+		case OF_GPX:
+			name = allocstr("Cluster %zu", i);
+			cmt = allocstr("%zu positions", count[i]);
+			res = !name || !cmt
+			      || print_coordinate(o, lat, lon, name, cmt);
+			free(cmt);
+			free(name);
+			if (res) {
+				failed("print_coordinate()"); /* gncov */
+				goto cleanup; /* gncov */
+			}
+			break;
+		case OF_SQL:
+			printf("INSERT INTO cluster_centroid VALUES (%zu, %s,"
+			       " %s, %zu);\n", i, lat_s, lon_s, count[i]);
+			break;
+		default:
+			printf("cluster %zu %s,%s %zu\n",
+			       i, lat_s, lon_s, count[i]);
+			break;
+		}
+	}
+	retval = 0;
+
+cleanup:
+	free(count);
+	free(sum);
+
+	return retval;
+}
+
+/*
+ * cmd_cluster() - Executes the `cluster` command. Reads positions from the 
+ * file `fname`, or stdin if `fname` is NULL or "-", and finds clusters with 
+ * dbscan(), where positions within `eps_s` meters of each other are 
+ * neighbours and a cluster needs at least `minpts_s` neighbouring positions. 
+ * Prints the cluster number of every position, where 0 is noise, followed by 
+ * the centroid and the number of positions of every cluster. Returns 
+ * `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_cluster(const struct Options *o, const char *eps_s,
+                const char *minpts_s, const char *fname)
+{
+	struct posarray pts;
+	unsigned long *cluster = NULL;
+	double eps, minpts;
+	long numclusters;
+	size_t i;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+	assert(eps_s);
+	assert(minpts_s);
+
+	msg(7, "%s(\"%s\", \"%s\", \"%s\")",
+	    __func__, eps_s, minpts_s, no_null(fname));
+
+	if (string_to_double(eps_s, &eps) || !isfinite(eps)) {
+		myerror("%s: Invalid distance", eps_s);
+		return EXIT_FAILURE;
+	}
+	if (eps < 0.0) {
+		myerror("%s: Distance cannot be negative", eps_s);
+		return EXIT_FAILURE;
+	}
+	if (string_to_double(minpts_s, &minpts) || minpts < 1.0
+	    || minpts > 1e9 || minpts != floor(minpts)) {
+		myerror("%s: Invalid number of positions", minpts_s);
+		return EXIT_FAILURE;
+	}
+	if (o->km)
+		eps *= 1000.0;
+
+	memset(&pts, 0, sizeof(pts));
+	if (posarray_read(o, fname, &pts, false))
+		goto cleanup;
+	cluster = malloc((pts.n ? pts.n : 1) * sizeof(unsigned long));
+	if (!cluster) {
+		failed("malloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	numclusters = dbscan(pts.lat, pts.lon, pts.n, eps / EARTH_RADIUS,
+	                     (size_t)minpts, cluster);
+	if (numclusters < 0)
+		goto cleanup; /* gncov */
+
+	switch (o->outpformat) {
+	case OF_GPX:
+		fputs(GPX_HEADER, stdout);
+		break;
+	case OF_SQL:
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS cluster (num INTEGER,"
+		     " lat REAL, lon REAL, cluster INTEGER);");
+		puts("CREATE TABLE IF NOT EXISTS cluster_centroid"
+		     " (cluster INTEGER, lat REAL, lon REAL, count INTEGER);");
+		break;
+	default:
+		break;
+	}
+	for (i = 0; i < pts.n && o->outpformat != OF_GPX; i++) {
+		char lat_s[32], lon_s[32];
+
+		if (o->outpformat == OF_SQL) {
+			format_number(lat_s, sizeof(lat_s), pts.lat[i], 6);
+			format_number(lon_s, sizeof(lon_s), pts.lon[i], 6);
+			printf("INSERT INTO cluster VALUES (%zu, %s, %s,"
+			       " %lu);\n", i + 1, lat_s, lon_s, cluster[i]);
+		} else {
+			printf("point %zu %lu\n", i + 1, cluster[i]);
+		}
+	}
+	if (cluster_print(o, &pts, cluster, (unsigned long)numclusters))
+		goto cleanup; /* gncov */
+	switch (o->outpformat) {
+	case OF_GPX:
+		puts("</gpx>");
+		break;
+	case OF_SQL:
+		puts("COMMIT;");
+		break;
+	default:
+		break;
+	}
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	free(cluster);
+	free(pts.lon);
+	free(pts.lat);
+
+	return retval;
+}
+
+/*
+ * cmd_centroid() - Executes the `centroid` command. Reads positions from the 
+ * file `fname`, or stdin if `fname` is NULL or "-", and prints the centroid 
+ * of the positions, the number of positions, the total weight, the length of 
+ * the mean vector and the dispersion. With --weighted, every position has a 
+ * weight after the coordinate. The positions are read in one pass and aren't 
+ * stored. The dispersion is the circular standard deviation of the positions, 
+ * which is close to the root mean square distance from the centroid when the 
+ * positions are close to each other. Returns `EXIT_SUCCESS` or 
+ * `EXIT_FAILURE`.
+ */
+
+int cmd_centroid(const struct Options *o, const char *fname)
+{
+	struct pointreader pr;
+	struct centroid c;
+	char lat_s[32], lon_s[32], weight_s[32], res_s[32], disp_s[32], *cmt;
+	const double div = o->km && o->outpformat != OF_SQL ? 1000.0 : 1.0;
+	double lat, lon, resultant, dispersion;
+	PointStatus st;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+
+	msg(7, "%s(\"%s\")", __func__, no_null(fname));
+
+	if (pointreader_open(&pr, fname, o->inpformat))
+		return EXIT_FAILURE;
+	if (o->weighted && pr.format == IF_GPX) {
+		myerror("%s: --weighted is not supported with GPX input",
+		        pr.name);
+		goto cleanup;
+	}
+	pr.weighted = o->weighted;
+
+	centroid_init(&c);
+	while ((st = pointreader_next(&pr, &lat, &lon)) != PS_EOF) {
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_POINT)
+			centroid_add(&c, lat, lon, pr.weight);
+	}
+	if (!c.count) {
+		myerror("%s: No positions found", pr.name);
+		goto cleanup;
+	}
+	if (centroid_result(&c, &lat, &lon, &resultant, &dispersion)) {
+		myerror("%s: The centroid is undefined", pr.name);
+		goto cleanup;
+	}
+
+	format_number(lat_s, sizeof(lat_s), lat, 6);
+	format_number(lon_s, sizeof(lon_s), lon, 6);
+	format_number(weight_s, sizeof(weight_s), compsum_result(&c.weight),
+	              6);
+	format_number(res_s, sizeof(res_s), resultant, 9);
+	format_number(disp_s, sizeof(disp_s), dispersion * EARTH_RADIUS / div,
+	              HAVERSINE_DECIMALS);
+	switch (o->outpformat) {
+	case OF_GPX:
+		cmt = allocstr("%lu positions", c.count);
+		if (!cmt) {
+			failed("allocstr()"); /* gncov */
+			goto cleanup; /* gncov */
+		}
+		fputs(GPX_HEADER, stdout);
+		if (print_coordinate(o, lat, lon, "Centroid", cmt)) {
+			free(cmt); /* gncov */
+			goto cleanup; /* gncov */
+		}
+		free(cmt);
+		puts("</gpx>");
+		break;
+	case OF_SQL:
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS centroid (lat REAL, lon REAL,"
+		     " points INTEGER, weight REAL, resultant REAL,"
+		     " dispersion REAL);");
+		printf("INSERT INTO centroid VALUES (%s, %s, %lu, %s, %s,"
+		       " %s);\n", lat_s, lon_s, c.count, weight_s, res_s,
+		       disp_s);
+		puts("COMMIT;");
+		break;
+	default:
+		printf("centroid %s,%s\n", lat_s, lon_s);
+		printf("points %lu\n", c.count);
+		printf("weight %s\n", weight_s);
+		printf("resultant %s\n", res_s);
+		printf("dispersion %s\n", disp_s);
+		break;
+	}
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+
+	return retval;
+}
+
+/*
+ * parse_arc() - Parses the coordinates `coor1` and `coor2` and prepares the 
+ * arc between them in `dest`. Returns 1 if a coordinate is invalid, otherwise 
+ * 0.
+ */
+
+static int parse_arc(const char *coor1, const char *coor2, struct arc *dest)
+{
+	double lat1, lon1, lat2, lon2;
+	struct vec3 a, b;
+
+	if (parse_coordinate(coor1, true, &lat1, &lon1)) {
+		myerror("%s: Invalid coordinate", coor1);
+		return 1;
+	}
+	if (parse_coordinate(coor2, true, &lat2, &lon2)) {
+		myerror("%s: Invalid coordinate", coor2);
+		return 1;
+	}
+	pos_to_vec3(lat1, lon1, &a);
+	pos_to_vec3(lat2, lon2, &b);
+	arc_init(dest, &a, &b);
+
+	return 0;
+}
+
+/*
+ * cmd_intersect() - Executes the `intersect` command with four coordinates. 
+ * Prints the intersection of the great circles through the segments 
+ * `coor1`-`coor2` and `coor3`-`coor4` that is closest to the first segment, 
+ * the signed along-track distances to it from `coor1` and `coor3`, and 1 if 
+ * the segments cross, otherwise 0. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_intersect(const struct Options *o, const char *coor1,
+                  const char *coor2, const char *coor3, const char *coor4)
+{
+	struct arc a1, a2;
+	struct vec3 x;
+	char lat_s[32], lon_s[32], dist1_s[32], dist2_s[32];
+	const double div = o->km && o->outpformat != OF_SQL ? 1000.0 : 1.0;
+	double lat, lon;
+	int crossing;
+
+	assert(o);
+	assert(coor1);
+	assert(coor2);
+	assert(coor3);
+	assert(coor4);
+
+	msg(7, "%s(\"%s\", \"%s\", \"%s\", \"%s\")",
+	       __func__, coor1, coor2, coor3, coor4);
+
+	if (parse_arc(coor1, coor2, &a1) || parse_arc(coor3, coor4, &a2))
+		return EXIT_FAILURE;
+	crossing = arc_intersect(&a1, &a2, &x);
+	if (crossing < 0) {
+		myerror("The intersection is undefined");
+		return EXIT_FAILURE;
+	}
+
+	vec3_to_pos(&x, &lat, &lon);
+	format_number(lat_s, sizeof(lat_s), lat, 6);
+	format_number(lon_s, sizeof(lon_s), lon, 6);
+	format_number(dist1_s, sizeof(dist1_s),
+	              arc_along_track(&a1, &x) * EARTH_RADIUS / div,
+	              HAVERSINE_DECIMALS);
+	format_number(dist2_s, sizeof(dist2_s),
+	              arc_along_track(&a2, &x) * EARTH_RADIUS / div,
+	              HAVERSINE_DECIMALS);
+	switch (o->outpformat) {
+	case OF_GPX:
+		fputs(GPX_HEADER, stdout);
+		if (print_coordinate(o, lat, lon, "Intersection",
+		                     crossing ? "The segments cross"
+		                              : "The segments don't cross"))
+			return EXIT_FAILURE; /* gncov */
+		puts("</gpx>");
+		break;
+	case OF_SQL:
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS intersection (lat REAL,"
+		     " lon REAL, dist1 REAL, dist2 REAL, crossing INTEGER);");
+		printf("INSERT INTO intersection VALUES (%s, %s, %s, %s,"
+		       " %d);\n", lat_s, lon_s, dist1_s, dist2_s, crossing);
+		puts("COMMIT;");
+		break;
+	default:
+		printf("intersection %s,%s\n", lat_s, lon_s);
+		printf("dist1 %s\n", dist1_s);
+		printf("dist2 %s\n", dist2_s);
+		printf("crossing %d\n", crossing);
+		break;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * struct crossings - State for cmd_intersect_file(). The positions of the 
+ * current segment are collected in `lat` and `lon` until INTERSECT_BATCH 
+ * positions are stored, then the crossings are found with intersect_batch() 
+ * and printed by crossings_flush(). `first` is the number of the position in 
+ * `lat[0]` and `lon[0]`, starting at 1.
+ */
+
+struct crossings {
+	const struct Options *o;
+	struct arc arc;
+	double lat[INTERSECT_BATCH];
+	double lon[INTERSECT_BATCH];
+	double xlat[INTERSECT_BATCH];
+	double xlon[INTERSECT_BATCH];
+	double atrack[INTERSECT_BATCH];
+	size_t leg[INTERSECT_BATCH];
+	size_t n;
+	unsigned long first;
+	unsigned long count;
+};
+
+/*
+ * crossings_flush() - Finds and prints the crossings between the arc and the 
+ * legs between the positions stored in `c`. If `keep_last` is true, the last 
+ * position is kept as the first position of the next batch, so the leg 
+ * between the batches isn't lost. Returns 1 if anything failed, otherwise 0.
+ */
+
+static int crossings_flush(struct crossings *c, const bool keep_last)
+{
+	const struct Options *o = c->o;
+	const double div = o->km && o->outpformat != OF_SQL ? 1000.0 : 1.0;
+	size_t i, found;
+
+	found = intersect_batch(&c->arc, c->lat, c->lon, c->n, c->xlat,
+	                        c->xlon, c->atrack, c->leg);
+	for (i = 0; i < found; i++) {
+		char lat_s[32], lon_s[32], dist_s[32], *name;
+		const unsigned long num = c->first + c->leg[i];
+		int res;
+
+		c->count++;
+		format_number(lat_s, sizeof(lat_s), c->xlat[i], 6);
+		format_number(lon_s, sizeof(lon_s), c->xlon[i], 6);
+		format_number(dist_s, sizeof(dist_s), c->atrack[i] / div,
+		              HAVERSINE_DECIMALS);
+		switch (o->outpformat) {
+		case OF_GPX:
+			name = allocstr("Crossing %lu", c->count);
+			res = !name || print_coordinate(o, c->xlat[i],
+			                                c->xlon[i], name,
+			                                NULL);
+			free(name);
+			if (res) {
+				failed("print_coordinate()"); /* gncov */
+				return 1; /* gncov */
+			}
+			break;
+		case OF_SQL:
+			printf("INSERT INTO crossing VALUES (%lu, %s, %s,"
+			       " %s);\n", num, lat_s, lon_s, dist_s);
+			break;
+		default:
+			printf("%lu %s,%s %s\n", num, lat_s, lon_s, dist_s);
+			break;
+		}
+	}
+
+	if (keep_last && c->n) {
+		c->first += c->n - 1;
+		c->lat[0] = c->lat[c->n - 1];
+		c->lon[0] = c->lon[c->n - 1];
+		c->n = 1;
+	} else {
+		c->first += c->n;
+		c->n = 0;
+	}
+
+	return 0;
+}
+
+/*
+ * cmd_intersect_file() - Executes the `intersect` command with two 
+ * coordinates. Reads a track from the file `fname`, or stdin if `fname` is 
+ * NULL or "-", and prints the number of the position at the start of the leg, 
+ * the position and the along-track distance from `coor1` for every leg that 
+ * crosses the segment `coor1`-`coor2`. No leg is created across segment 
+ * breaks. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_intersect_file(const struct Options *o, const char *coor1,
+                       const char *coor2, const char *fname)
+{
+	struct pointreader pr;
+	struct crossings *c;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+	assert(coor1);
+	assert(coor2);
+
+	msg(7, "%s(\"%s\", \"%s\", \"%s\")",
+	       __func__, coor1, coor2, no_null(fname));
+
+	c = malloc(sizeof(struct crossings));
+	if (!c) {
+		failed("malloc()"); /* gncov */
+		return EXIT_FAILURE; /* gncov */
+	}
+	c->o = o;
+	c->n = 0;
+	c->first = 1;
+	c->count = 0;
+	if (parse_arc(coor1, coor2, &c->arc)) {
+		free(c);
+		return EXIT_FAILURE;
+	}
+	if (c->arc.degenerate) {
+		myerror("The intersection is undefined");
+		free(c);
+		return EXIT_FAILURE;
+	}
+
+	if (pointreader_open(&pr, fname, o->inpformat)) {
+		free(c);
+		return EXIT_FAILURE;
+	}
+
+	if (o->outpformat == OF_GPX) {
+		fputs(GPX_HEADER, stdout);
+	} else if (o->outpformat == OF_SQL) {
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS crossing (num INTEGER,"
+		     " lat REAL, lon REAL, dist REAL);");
+	}
+
+	while (1) {
+		double lat, lon;
+		const PointStatus st = pointreader_next(&pr, &lat, &lon);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if (st == PS_BREAK) {
+			if (crossings_flush(c, false))
+				goto cleanup; /* gncov */
+			continue;
+		}
+		if (c->n == INTERSECT_BATCH && crossings_flush(c, true))
+			goto cleanup; /* gncov */
+		c->lat[c->n] = lat;
+		c->lon[c->n] = lon;
+		c->n++;
+	}
+	if (crossings_flush(c, false))
+		goto cleanup; /* gncov */
+
+	if (o->outpformat == OF_GPX)
+		puts("</gpx>");
+	else if (o->outpformat == OF_SQL)
+		puts("COMMIT;");
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+	free(c);
+
+	return retval;
+}
+
+/*
+ * parse_mover() - Parses the start position `coor`, the bearing `bearing_s` 
+ * and the speed `speed_s` in meters per second, or kilometers per second with 
+ * --km, and prepares the moving object in `dest`. Returns 1 if any of the 
+ * values are invalid, otherwise 0.
+ */
+
+static int parse_mover(const struct Options *o, const char *coor,
+                       const char *bearing_s, const char *speed_s,
+                       struct mover *dest)
+{
+	double lat, lon, bearing, speed;
+
+	if (parse_coordinate(coor, true, &lat, &lon)) {
+		myerror("%s: Invalid coordinate", coor);
+		return 1;
+	}
+	if (string_to_double(bearing_s, &bearing)) {
+		myerror("%s: Invalid bearing", bearing_s);
+		return 1;
+	}
+	if (bearing < 0.0 || bearing > 360.0) {
+		myerror("%s: Bearing out of range", bearing_s);
+		return 1;
+	}
+	if (string_to_double(speed_s, &speed) || !isfinite(speed)) {
+		myerror("%s: Invalid speed", speed_s);
+		return 1;
+	}
+	if (speed < 0.0) {
+		myerror("%s: Speed cannot be negative", speed_s);
+		return 1;
+	}
+	if (o->km)
+		speed *= 1000.0;
+	mover_init(dest, lat, lon, bearing, speed);
+
+	return 0;
+}
+
+/*
+ * cmd_cpa() - Executes the `cpa` command. Two objects start at `coor1` and 
+ * `coor2` and move along great circles with the initial bearings `bear1_s` 
+ * and `bear2_s` and the speeds `speed1_s` and `speed2_s`. Prints the time in 
+ * seconds until they are closest to each other, the distance at that time 
+ * and the positions of the objects. Returns `EXIT_SUCCESS` or 
+ * `EXIT_FAILURE`.
+ */
+
+int cmd_cpa(const struct Options *o,
+            const char *coor1, const char *bear1_s, const char *speed1_s,
+            const char *coor2, const char *bear2_s, const char *speed2_s)
+{
+	struct mover m1, m2;
+	struct vec3 v1, v2;
+	char time_s[32], dist_s[32], lat1_s[32], lon1_s[32], lat2_s[32],
+	     lon2_s[32], *cmt;
+	const double div = o->km && o->outpformat != OF_SQL ? 1000.0 : 1.0;
+	double t, angle, lat1, lon1, lat2, lon2;
+	int res;
+
+	assert(o);
+	assert(coor1);
+	assert(bear1_s);
+	assert(speed1_s);
+	assert(coor2);
+	assert(bear2_s);
+	assert(speed2_s);
+
+	msg(7, "%s(\"%s\", \"%s\", \"%s\", \"%s\", \"%s\", \"%s\")",
+	       __func__, coor1, bear1_s, speed1_s, coor2, bear2_s, speed2_s);
+
+	if (parse_mover(o, coor1, bear1_s, speed1_s, &m1)
+	    || parse_mover(o, coor2, bear2_s, speed2_s, &m2))
+		return EXIT_FAILURE;
+	t = closest_approach(&m1, &m2, &angle);
+	if (t < 0.0) {
+		myerror("No closest approach found");
+		return EXIT_FAILURE;
+	}
+
+	mover_pos(&m1, t, &v1);
+	mover_pos(&m2, t, &v2);
+	vec3_to_pos(&v1, &lat1, &lon1);
+	vec3_to_pos(&v2, &lat2, &lon2);
+	format_number(time_s, sizeof(time_s), t, 3);
+	format_number(dist_s, sizeof(dist_s), angle * EARTH_RADIUS / div,
+	              HAVERSINE_DECIMALS);
+	format_number(lat1_s, sizeof(lat1_s), lat1, 6);
+	format_number(lon1_s, sizeof(lon1_s), lon1, 6);
+	format_number(lat2_s, sizeof(lat2_s), lat2, 6);
+	format_number(lon2_s, sizeof(lon2_s), lon2, 6);
+	switch (o->outpformat) {
+	case OF_GPX:
+		cmt = allocstr("Closest approach after %s seconds", time_s);
+		if (!cmt) {
+			failed("allocstr()"); /* gncov */
+			return EXIT_FAILURE; /* gncov */
+		}
+		fputs(GPX_HEADER, stdout);
+		res = print_coordinate(o, lat1, lon1, "Object 1", cmt)
+		      || print_coordinate(o, lat2, lon2, "Object 2", cmt);
+		free(cmt);
+		if (res)
+			return EXIT_FAILURE; /* gncov */
+		puts("</gpx>");
+		break;
+	case OF_SQL:
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS cpa (time REAL, dist REAL,"
+		     " lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL);");
+		printf("INSERT INTO cpa VALUES (%s, %s, %s, %s, %s, %s);\n",
+		       time_s, dist_s, lat1_s, lon1_s, lat2_s, lon2_s);
+		puts("COMMIT;");
+		break;
+	default:
+		printf("time %s\n", time_s);
+		printf("dist %s\n", dist_s);
+		printf("pos1 %s,%s\n", lat1_s, lon1_s);
+		printf("pos2 %s,%s\n", lat2_s, lon2_s);
+		break;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * area_decimals() - Returns the number of decimals to use for the area `x`, 
+ * so it has at most 15 significant digits, which is what a double can hold, 
+ * and at most `maxdec` decimals. The area of the Earth has 15 digits before 
+ * the decimal point, so the result is never negative. Used by cmd_area().
+ */
+
+static int area_decimals(const double x, const int maxdec)
+{
+	double dec;
+
+	if (x == 0.0)
+		return maxdec;
+	dec = 14.0 - floor(log10(fabs(x)));
+
+	return dec < maxdec ? (int)dec : maxdec;
+}
+
+/*
+ * cmd_area() - Executes the `area` command. Reads polygons from the file 
+ * `fname`, or stdin if `fname` is NULL or "-", where every segment is a ring 
+ * that is closed automatically, and prints the total signed area, the total 
+ * perimeter, and the number of positions and rings. Rings listed 
+ * counterclockwise have a positive area, so holes can be subtracted by 
+ * listing them clockwise. The positions are read in one pass and aren't 
+ * stored. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_area(const struct Options *o, const char *fname)
+{
+	struct pointreader pr;
+	struct polyarea pa;
+	char area_s[32], perim_s[32];
+	const double div = o->km && o->outpformat != OF_SQL ? 1000.0 : 1.0;
+	const int decimals = o->distformula == FRM_KARNEY ? KARNEY_DECIMALS
+	                                                  : HAVERSINE_DECIMALS;
+	double lat, lon, area, perimeter;
+	PointStatus st;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+
+	msg(7, "%s(\"%s\")", __func__, no_null(fname));
+
+	if (pointreader_open(&pr, fname, o->inpformat))
+		return EXIT_FAILURE;
+
+	polyarea_init(&pa, o->distformula, &o->ell);
+	while ((st = pointreader_next(&pr, &lat, &lon)) != PS_EOF) {
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_BREAK)
+			polyarea_close(&pa);
+		else
+			polyarea_add(&pa, lat, lon);
+	}
+	polyarea_close(&pa);
+	if (!pa.count) {
+		myerror("%s: No positions found", pr.name);
+		goto cleanup;
+	}
+	if (polyarea_result(&pa, &area, &perimeter)) {
+		myerror("Formula did not converge, antipodal points");
+		goto cleanup;
+	}
+
+	area /= div * div;
+	format_number(area_s, sizeof(area_s), area,
+	              area_decimals(area, decimals));
+	format_number(perim_s, sizeof(perim_s), perimeter / div, decimals);
+	if (o->outpformat == OF_SQL) {
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS area (area REAL,"
+		     " perimeter REAL, points INTEGER, rings INTEGER);");
+		printf("INSERT INTO area VALUES (%s, %s, %lu, %lu);\n",
+		       area_s, perim_s, pa.count, pa.rings);
+		puts("COMMIT;");
+	} else {
+		printf("area %s\n", area_s);
+		printf("perimeter %s\n", perim_s);
+		printf("points %lu\n", pa.count);
+		printf("rings %lu\n", pa.rings);
+	}
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+
+	return retval;
+}
+
+/*
+ * grid_print() - Used by grid_run(). Prints the grid position number `num` at 
+ * `lat, lon`, where `c_lat, c_lon` is the center of the cap, or the latitude 
+ * is larger than 90 if the grid covers the whole Earth. Returns 1 if anything 
+ * failed, otherwise 0.
+ */
+
+static int grid_print(const struct Options *o, const unsigned long num,
+                      const double lat, const double lon,
+                      const double c_lat, const double c_lon)
+{
+	char *name;
+	int res;
+
+	if (o->outpformat == OF_SQL) {
+		char lat_s[32], lon_s[32], dist_s[32], bear_s[32],
+		     hash[GEOHASH_MAX_LEN + 5];
+		double nlat = lat, nlon = lon;
+
+		round_number(&nlat, 6);
+		round_number(&nlon, 6);
+		format_number(lat_s, sizeof(lat_s), lat, 6);
+		format_number(lon_s, sizeof(lon_s), lon, 6);
+		geohash_column(o, hash, nlat, nlon);
+		if (c_lat > 90.0) {
+			printf("INSERT INTO grid VALUES (%lu, %s, %s, NULL,"
+			       " NULL%s);\n", num, lat_s, lon_s, hash);
+			return 0;
+		}
+		format_number(dist_s, sizeof(dist_s),
+		              haversine(c_lat, c_lon, lat, lon), 6);
+		format_number(bear_s, sizeof(bear_s),
+		              initial_bearing(c_lat, c_lon, lat, lon), 6);
+		printf("INSERT INTO grid VALUES (%lu, %s, %s, %s, %s%s);\n",
+		       num, lat_s, lon_s, dist_s, bear_s, hash);
+		return 0;
+	}
+
+	name = allocstr("Grid %lu", num);
+	if (!name) {
+		failed("allocstr()"); /* gncov */
+		return 1; /* gncov */
+	}
+	res = print_coordinate(o, lat, lon, name, NULL);
+	free(name);
+
+	return res;
+}
+
+/*
+ * grid_run() - Used by cmd_grid() and cmd_grid_cap(). Prints the positions of 
+ * the Fibonacci lattice in `g`, or only the part selected with --shard. 
+ * `c_lat, c_lon` is the center, or the latitude is larger than 90 if the grid 
+ * covers the whole Earth. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+static int grid_run(const struct Options *o, const struct fibgrid *g,
+                    const double c_lat, const double c_lon)
+{
+	unsigned long i, first = 0, last = g->n;
+	double lat, lon;
+
+	if (o->shard) {
+		first = (unsigned long)((unsigned long long)g->n
+		                        * (unsigned long long)(o->shard - 1)
+		                        / (unsigned long long)o->shards);
+		last = (unsigned long)((unsigned long long)g->n
+		                       * (unsigned long long)o->shard
+		                       / (unsigned long long)o->shards);
+	}
+
+	switch (o->outpformat) {
+	case OF_GPX:
+		fputs(GPX_HEADER, stdout);
+		break;
+	case OF_SQL:
+		puts("BEGIN;");
+		printf("CREATE TABLE IF NOT EXISTS grid (num INTEGER,"
+		       " lat REAL, lon REAL, dist REAL, bear REAL%s);\n",
+		       o->geohash ? ", geohash TEXT" : "");
+		break;
+	default:
+		break;
+	}
+	for (i = first; i < last; i++) {
+		fibgrid_point(g, i, &lat, &lon);
+		if (grid_print(o, i + 1, lat, lon, c_lat, c_lon))
+			return EXIT_FAILURE;
+	}
+	switch (o->outpformat) {
+	case OF_GPX:
+		puts("</gpx>");
+		break;
+	case OF_SQL:
+		puts("COMMIT;");
+		break;
+	default:
+		break;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ * cmd_grid() - Executes the `grid` command with one argument. Prints `num_s` 
+ * positions in a Fibonacci lattice that covers the whole Earth, where every 
+ * position has the same share of the area. Returns `EXIT_SUCCESS` or 
+ * `EXIT_FAILURE`.
+ */
+
+int cmd_grid(const struct Options *o, const char *num_s)
+{
+	struct fibgrid g;
+	double num;
+
+	assert(o);
+	assert(num_s);
+
+	msg(7, "%s(\"%s\")", __func__, num_s);
+
+	if (string_to_double(num_s, &num) || num < 1.0
+	    || num > FIBGRID_MAX_POINTS || num != floor(num)) {
+		myerror("%s: Invalid number of positions", num_s);
+		return EXIT_FAILURE;
+	}
+	fibgrid_init(&g, 90.0, 0.0, M_PI, (unsigned long)num);
+
+	return grid_run(o, &g, 1000.0, 1000.0);
+}
+
+/*
+ * cmd_grid_cap() - Executes the `grid` command with three arguments. Prints 
+ * the positions in a Fibonacci lattice within `maxdist_s` meters from 
+ * `coor`, where the distance between neighbouring positions is about 
+ * `spacing_s` meters. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_grid_cap(const struct Options *o, const char *coor,
+                 const char *maxdist_s, const char *spacing_s)
+{
+	struct fibgrid g;
+	double c_lat, c_lon, maxdist, spacing, num;
+
+	assert(o);
+	assert(coor);
+	assert(maxdist_s);
+	assert(spacing_s);
+
+	msg(7, "%s(\"%s\", \"%s\", \"%s\")",
+	       __func__, coor, maxdist_s, spacing_s);
+
+	if (parse_coordinate(coor, true, &c_lat, &c_lon)) {
+		myerror("%s: Invalid coordinate", coor);
+		return EXIT_FAILURE;
+	}
+	if (string_to_double(maxdist_s, &maxdist) || !isfinite(maxdist)) {
+		myerror("%s: Invalid distance", maxdist_s);
+		return EXIT_FAILURE;
+	}
+	if (maxdist < 0.0) {
+		myerror("%s: Distance cannot be negative", maxdist_s);
+		return EXIT_FAILURE;
+	}
+	if (string_to_double(spacing_s, &spacing) || !isfinite(spacing)
+	    || spacing <= 0.0) {
+		myerror("%s: Invalid spacing", spacing_s);
+		return EXIT_FAILURE;
+	}
+	if (o->km) {
+		maxdist *= 1000.0;
+		spacing *= 1000.0;
+	}
+	maxdist = fmin(maxdist, MAX_EARTH_DISTANCE);
+	num = fibgrid_count(maxdist / EARTH_RADIUS, spacing / EARTH_RADIUS);
+	if (num > FIBGRID_MAX_POINTS) {
+		myerror("Too many positions, the spacing is too small");
+		return EXIT_FAILURE;
+	}
+	fibgrid_init(&g, c_lat, c_lon, maxdist / EARTH_RADIUS,
+	             (unsigned long)num);
+
+	return grid_run(o, &g, c_lat, c_lon);
+}
+
+/*
+ * cmd_randbox() - Executes the `randbox` command. Prints random positions 
+ * inside the box between the latitudes of `coor1` and `coor2`, going east 
+ * from the longitude of `coor1` to the longitude of `coor2`. Returns 
+ * `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_randbox(const struct Options *o, const char *coor1,
+                const char *coor2)
+{
+	struct randsrc src;
+
+	assert(o);
+	assert(coor1);
+	assert(coor2);
+
+	msg(7, "%s(\"%s\", \"%s\")", __func__, coor1, coor2);
+
+	memset(&src, 0, sizeof(src));
+	src.box = 1;
+	src.c_lat = src.c_lon = 1000;
+	if (parse_coordinate(coor1, true, &src.lat1, &src.lon1)) {
+		myerror("%s: Invalid coordinate", coor1);
+		return EXIT_FAILURE;
+	}
+	if (parse_coordinate(coor2, true, &src.lat2, &src.lon2)) {
+		myerror("%s: Invalid coordinate", coor2);
+		return EXIT_FAILURE;
+	}
+
+	return randpos_run(o, &src);
+}
+
+/*
+ * cmd_randpoly() - Executes the `randpoly` command. Reads polygons from the 
+ * file `fname` in the same way as the fences in cmd_fence(), and prints 
+ * uniformly distributed random positions inside them. Clockwise polygons are 
+ * holes. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_randpoly(const struct Options *o, const char *fname)
+{
+	struct fences f;
+	struct randpoly rp;
+	struct randsrc src;
+	size_t i;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+
+	msg(7, "%s(\"%s\")", __func__, no_null(fname));
+
+	memset(&f, 0, sizeof(f));
+	memset(&rp, 0, sizeof(rp));
+	if (fence_read(o, fname, &f))
+		goto cleanup;
+	if (randpoly_init(&rp, f.polys, f.num))
+		goto cleanup; /* gncov */
+	if (!(rp.area > 0.0)) {
+		myerror("%s: No counterclockwise polygons with an area found",
+		        f.name);
+		goto cleanup;
+	}
+
+	memset(&src, 0, sizeof(src));
+	src.poly = &rp;
+	src.c_lat = src.c_lon = 1000;
+	retval = randpos_run(o, &src);
+
+cleanup:
+	randpoly_free(&rp);
+	for (i = 0; i < f.num; i++)
+		polygon_free(&f.polys[i]);
+	free(f.polys);
+	free(f.lon);
+	free(f.lat);
+
+	return retval;
+}
+
+/*
+ * Prepared data for the `ring` command. The sines and cosines of the bearings 
+ * of the `n` vertices on every arc are calculated once and used for all 
+ * centers, and `lat` and `lon` have room for the vertices of one polygon.
+ */
+
+struct ring {
+	const struct Options *o;
+	double *sin_b;
+	double *cos_b;
+	size_t n;
+	double outer;
+	double inner;
+	double *lat;
+	double *lon;
+};
+
+/*
+ * ring_init() - Prepares `r` for polygons with `n` vertices on every arc, 
+ * with the radius `outer` and the inner radius `inner` in radians, where 0 
+ * means no inner ring. Without --sector, the bearings go counterclockwise 
+ * around the circle starting at north. With --sector, they go from the end 
+ * bearing of the sector counterclockwise to the start bearing. Returns 1 if 
+ * the memory allocation failed, otherwise 0.
+ */
+
+static int ring_init(struct ring *r, const struct Options *o, const size_t n,
+                     const double outer, const double inner)
+{
+	double width = 360.0;
+	size_t i;
+
+	r->o = o;
+	r->n = n;
+	r->outer = outer;
+	r->inner = inner;
+	r->sin_b = malloc(n * sizeof(double));
+	r->cos_b = malloc(n * sizeof(double));
+	r->lat = malloc((2 * n + 2) * sizeof(double));
+	r->lon = malloc((2 * n + 2) * sizeof(double));
+	if (!r->sin_b || !r->cos_b || !r->lat || !r->lon) {
+		failed("malloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+
+	if (o->sector)
+		width = fmod(o->sector_to - o->sector_from + 360.0, 360.0);
+	for (i = 0; i < n; i++) {
+		double bear;
+
+		if (o->sector) {
+			bear = o->sector_to
+			       - width * (double)i / (double)(n - 1);
+		} else {
+			bear = -360.0 * (double)i / (double)n;
+		}
+		bear *= M_PI / 180.0;
+		r->sin_b[i] = sin(bear);
+		r->cos_b[i] = cos(bear);
+	}
+
+	return 0;
+}
+
+/*
+ * ring_free() - Deallocates the memory used by `r`. Returns nothing.
+ */
+
+static void ring_free(struct ring *r)
+{
+	free(r->lon);
+	free(r->lat);
+	free(r->cos_b);
+	free(r->sin_b);
+}
+
+/*
+ * ring_print_part() - Prints the `n` vertices in `r->lat` and `r->lon` 
+ * starting at index `start` as part number `part` of the polygon number 
+ * `num`, where part 1 is the outer ring and part 2 is the hole. The first 
+ * vertex is repeated at the end to close the ring. Returns nothing.
+ */
+
+static void ring_print_part(const struct ring *r, const unsigned long num,
+                            const unsigned long part, const size_t start,
+                            const size_t n)
+{
+	char lat_s[32], lon_s[32];
+	size_t i;
+
+	switch (r->o->outpformat) {
+	case OF_DEFAULT:
+	case OF_MGRS:
+	case OF_UTM:
+		if (part > 1)
+			puts("");
+		break;
+	case OF_GEOJSON:
+		printf("%s[", part > 1 ? ", " : "");
+		break;
+	case OF_GPX:
+		puts("    <trkseg>");
+		break;
+	case OF_SQL:
+		break;
+	}
+	for (i = 0; i <= n; i++) {
+		const size_t v = start + (i < n ? i : 0);
+
+		format_number(lat_s, sizeof(lat_s), r->lat[v], 6);
+		format_number(lon_s, sizeof(lon_s), r->lon[v], 6);
+		switch (r->o->outpformat) {
+		case OF_DEFAULT:
+		case OF_MGRS:
+		case OF_UTM:
+			printf("%s,%s\n", lat_s, lon_s);
+			break;
+		case OF_GEOJSON:
+			printf("%s[%s, %s]", i ? ", " : "", lon_s, lat_s);
+			break;
+		case OF_GPX:
+			printf("      <trkpt lat=\"%s\" lon=\"%s\">\n"
+			       "      </trkpt>\n", lat_s, lon_s);
+			break;
+		case OF_SQL:
+			printf("INSERT INTO ring VALUES (%lu, %lu, %zu, %s,"
+			       " %s);\n", num, part, i + 1, lat_s, lon_s);
+			break;
+		}
+	}
+	switch (r->o->outpformat) {
+	case OF_DEFAULT:
+	case OF_MGRS:
+	case OF_UTM:
+	case OF_SQL:
+		break;
+	case OF_GEOJSON:
+		printf("]");
+		break;
+	case OF_GPX:
+		puts("    </trkseg>");
+		break;
+	}
+}
+
+/*
+ * ring_print() - Calculates and prints the polygon number `num` around 
+ * `lat,lon` from the prepared bearings in `r`. Returns nothing.
+ */
+
+static void ring_print(struct ring *r, const unsigned long num,
+                       const double lat, const double lon)
+{
+	struct origin org;
+	const size_t n = r->n;
+	size_t count = n, i;
+
+	origin_init(&org, lat, lon);
+	origin_positions(&org, r->sin_b, r->cos_b, n, r->outer, r->lat,
+	                 r->lon);
+	if (r->inner > 0.0) {
+		/* The inner arc goes the other way */
+		origin_positions(&org, r->sin_b, r->cos_b, n, r->inner,
+		                 r->lat + n, r->lon + n);
+		for (i = 0; i < n / 2; i++) {
+			double t = r->lat[n + i];
+
+			r->lat[n + i] = r->lat[2 * n - 1 - i];
+			r->lat[2 * n - 1 - i] = t;
+			t = r->lon[n + i];
+			r->lon[n + i] = r->lon[2 * n - 1 - i];
+			r->lon[2 * n - 1 - i] = t;
+		}
+	}
+	if (r->o->sector && r->inner > 0.0) {
+		count = 2 * n;
+	} else if (r->o->sector) {
+		r->lat[n] = lat;
+		r->lon[n] = lon;
+		count = n + 1;
+	}
+
+	switch (r->o->outpformat) {
+	case OF_DEFAULT:
+	case OF_MGRS:
+	case OF_UTM:
+		if (num > 1)
+			puts("");
+		break;
+	case OF_GEOJSON:
+		printf("%s{\"type\": \"Feature\","
+		       " \"properties\": {\"num\": %lu},"
+		       " \"geometry\": {\"type\": \"Polygon\","
+		       " \"coordinates\": [", num > 1 ? ",\n" : "", num);
+		break;
+	case OF_GPX:
+		printf("  <trk>\n"
+		       "    <name>Ring %lu</name>\n", num);
+		break;
+	case OF_SQL:
+		break;
+	}
+	ring_print_part(r, num, 1, 0, count);
+	if (r->inner > 0.0 && !r->o->sector)
+		ring_print_part(r, num, 2, n, n);
+	switch (r->o->outpformat) {
+	case OF_DEFAULT:
+	case OF_MGRS:
+	case OF_UTM:
+	case OF_SQL:
+		break;
+	case OF_GEOJSON:
+		printf("]}}");
+		break;
+	case OF_GPX:
+		puts("  </trk>");
+		break;
+	}
+}
+
+/*
+ * cmd_ring() - Executes the `ring` command. Reads center positions from the 
+ * file `fname`, or stdin if `fname` is NULL or "-", and prints a polygon with 
+ * `vertices_s` vertices on a circle with the radius `radius_s` meters around 
+ * every center. With --inner, the polygon is an annulus, and with --sector, 
+ * it's the sector between the two bearings. The outer rings go 
+ * counterclockwise and the holes clockwise, as in the area, randpoly and 
+ * GeoJSON formats. Returns `EXIT_SUCCESS` or `EXIT_FAILURE`.
+ */
+
+int cmd_ring(const struct Options *o, const char *radius_s,
+             const char *vertices_s, const char *fname)
+{
+	struct pointreader pr;
+	struct ring r;
+	char *endptr;
+	double radius, inner, lat, lon;
+	long vertices;
+	unsigned long num = 0;
+	PointStatus st;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+	assert(radius_s);
+	assert(vertices_s);
+
+	msg(7, "%s(\"%s\", \"%s\", \"%s\")",
+	       __func__, radius_s, vertices_s, no_null(fname));
+
+	if (string_to_double(radius_s, &radius) || !isfinite(radius)
+	    || radius <= 0.0) {
+		myerror("%s: Invalid radius", radius_s);
+		return EXIT_FAILURE;
+	}
+	vertices = strtol(vertices_s, &endptr, 10);
+	if (errno || endptr == vertices_s || *endptr || vertices < 3
+	    || vertices > RING_MAX_VERTICES) {
+#if defined(__FreeBSD__)
+		if (endptr == vertices_s && errno == EINVAL)
+			errno = 0;
+#endif
+		myerror("%s: Invalid number of vertices, must be 3-%d",
+		        vertices_s, RING_MAX_VERTICES);
+		return EXIT_FAILURE;
+	}
+	inner = o->inner;
+	if (o->km) {
+		radius *= 1000.0;
+		inner *= 1000.0;
+	}
+	radius = fmin(radius, MAX_EARTH_DISTANCE);
+	if (inner >= radius) {
+		myerror("The inner radius must be smaller than the radius");
+		return EXIT_FAILURE;
+	}
+
+	memset(&r, 0, sizeof(r));
+	if (ring_init(&r, o, (size_t)vertices, radius / EARTH_RADIUS,
+	              inner / EARTH_RADIUS))
+		goto free_ring; /* gncov */
+	if (pointreader_open(&pr, fname, o->inpformat))
+		goto free_ring;
+
+	switch (o->outpformat) {
+	case OF_DEFAULT:
+	case OF_MGRS:
+	case OF_UTM:
+		break;
+	case OF_GEOJSON:
+		puts("{\"type\": \"FeatureCollection\", \"features\": [");
+		break;
+	case OF_GPX:
+		fputs(GPX_HEADER, stdout);
+		break;
+	case OF_SQL:
+		puts("BEGIN;");
+		puts("CREATE TABLE IF NOT EXISTS ring (num INTEGER,"
+		     " part INTEGER, vertex INTEGER, lat REAL, lon REAL);");
+		break;
+	}
+
+	while ((st = pointreader_next(&pr, &lat, &lon)) != PS_EOF) {
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_POINT)
+			ring_print(&r, ++num, lat, lon);
+	}
+
+	switch (o->outpformat) {
+	case OF_DEFAULT:
+	case OF_MGRS:
+	case OF_UTM:
+		break;
+	case OF_GEOJSON:
+		if (num)
+			puts("");
+		puts("]}");
+		break;
+	case OF_GPX:
+		puts("</gpx>");
+		break;
+	case OF_SQL:
+		puts("COMMIT;");
+		break;
+	}
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+free_ring:
+	ring_free(&r);
+
+	return retval;
+}
+
+/*
+ * struct convert - State for cmd_convert(). The coordinates are collected in 
+ * `a`, `b` and `c` until CONVERT_BATCH records are stored, then they're 
+ * converted in place by convert_flush() and printed. The distances in the 
+ * input are multiplied by `mul` and the distances in the output are divided 
+ * by `div` to get meters or kilometers. `num` is the number of the last 
+ * record that was printed.
+ */
+
+struct convert {
+	const struct Options *o;
+	CoorSystem from;
+	CoorSystem to;
+	struct enuframe frame;
+	struct tmerc tm;
+	double mul;
+	double div;
+	double a[CONVERT_BATCH];
+	double b[CONVERT_BATCH];
+	double c[CONVERT_BATCH];
+	double easting[CONVERT_BATCH];
+	double northing[CONVERT_BATCH];
+	int zone[CONVERT_BATCH];
+	size_t n;
+	unsigned long num;
+};
+
+/*
+ * coor_system() - Converts the coordinate system name in `s` to a 
+ * `CoorSystem` value and stores it in `dest`. Returns 0 if ok, or 1 if the 
+ * name is unknown.
+ */
+
+static int coor_system(const char *s, CoorSystem *dest)
+{
+	assert(s);
+	assert(dest);
+
+	if (!strcmp(s, "ecef"))
+		*dest = CS_ECEF;
+	else if (!strcmp(s, "enu"))
+		*dest = CS_ENU;
+	else if (!strcmp(s, "geo"))
+		*dest = CS_GEODETIC;
+	else if (!strcmp(s, "mgrs"))
+		*dest = CS_MGRS;
+	else if (!strcmp(s, "utm"))
+		*dest = CS_UTM;
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * convert_print_utm() - Used by convert_flush(). Prints record number `i` of 
+ * the current batch, which has been converted to UTM, as UTM coordinates or 
+ * an MGRS reference followed by the height. Returns 1 if the position is 
+ * outside the UTM area, otherwise 0.
+ */
+
+static int convert_print_utm(struct convert *cv, const size_t i)
+{
+	char e_s[32], n_s[32], h_s[32], utm[64];
+	const int len_dec = cv->div == 1.0 ? 3 : 6;
+	const bool mgrs = cv->to == CS_MGRS;
+
+	cv->num++;
+	if (!cv->zone[i] || !format_utm(utm, sizeof(utm), mgrs, cv->a[i],
+	                                cv->zone[i], cv->easting[i],
+	                                cv->northing[i], cv->div)) {
+		myerror("Position %lu is outside the UTM area", cv->num);
+		return 1;
+	}
+	format_number(h_s, sizeof(h_s), cv->c[i] / cv->div, len_dec);
+	if (cv->o->outpformat != OF_SQL) {
+		printf("%s,%s\n", utm, h_s);
+		return 0;
+	}
+	if (mgrs) {
+		printf("INSERT INTO mgrs VALUES (%lu, '%s', %s);\n", cv->num,
+		       utm, h_s);
+		return 0;
+	}
+	format_number(e_s, sizeof(e_s), cv->easting[i] / cv->div, len_dec);
+	format_number(n_s, sizeof(n_s), cv->northing[i] / cv->div, len_dec);
+	printf("INSERT INTO utm VALUES (%lu, %d, '%c', %s, %s, %s);\n",
+	       cv->num, cv->zone[i], utm_band(cv->a[i]), e_s, n_s, h_s);
+
+	return 0;
+}
+
+/*
+ * convert_flush() - Converts the `cv->n` stored records from `cv->from` to 
+ * `cv->to` via ECEF with the batch functions, and prints them. UTM and MGRS 
+ * are found from the geodetic coordinates with utm_forward_batch(). Returns 
+ * 1 if a position can't be printed, otherwise 0.
+ */
+
+static int convert_flush(struct convert *cv)
+{
+	const int ang_dec = KARNEY_DECIMALS;
+	const int len_dec = cv->div == 1.0 ? 3 : 6;
+	const CoorSystem to = cv->to == CS_MGRS || cv->to == CS_UTM
+	                      ? CS_GEODETIC : cv->to;
+	double *a = cv->a, *b = cv->b, *c = cv->c;
+	size_t i, n = cv->n;
+
+	cv->n = 0;
+	for (i = 0; i < n; i++) {
+		if (cv->from != CS_GEODETIC) {
+			a[i] *= cv->mul;
+			b[i] *= cv->mul;
+		}
+		c[i] *= cv->mul;
+	}
+	if (cv->from != to) {
+		if (cv->from == CS_GEODETIC)
+			geodetic_to_ecef_batch(&cv->o->ell, a, b, c, n,
+			                       a, b, c);
+		else if (cv->from == CS_ENU)
+			enu_to_ecef_batch(&cv->frame, a, b, c, n, a, b, c);
+		if (to == CS_GEODETIC)
+			ecef_to_geodetic_batch(&cv->o->ell, a, b, c, n,
+			                       a, b, c);
+		else if (to == CS_ENU)
+			ecef_to_enu_batch(&cv->frame, a, b, c, n, a, b, c);
+	}
+	if (to != cv->to) {
+		utm_forward_batch(&cv->tm, a, b, n, cv->zone, cv->easting,
+		                  cv->northing);
+		for (i = 0; i < n; i++) {
+			if (convert_print_utm(cv, i))
+				return 1;
+		}
+		return 0;
+	}
+
+	for (i = 0; i < n; i++) {
+		char a_s[32], b_s[32], c_s[32];
+		const int ab_dec = to == CS_GEODETIC ? ang_dec : len_dec;
+		const double ab_div = to == CS_GEODETIC ? 1.0 : cv->div;
+
+		format_number(a_s, sizeof(a_s), a[i] / ab_div, ab_dec);
+		format_number(b_s, sizeof(b_s), b[i] / ab_div, ab_dec);
+		format_number(c_s, sizeof(c_s), c[i] / cv->div, len_dec);
+		cv->num++;
+		switch (cv->o->outpformat) {
+		case OF_DEFAULT:
+		case OF_MGRS:
+		case OF_UTM:
+		case OF_GEOJSON:
+		case OF_GPX:
+			printf("%s,%s,%s\n", a_s, b_s, c_s);
+			break;
+		case OF_SQL:
+			printf("INSERT INTO %s VALUES (%lu, %s, %s, %s);\n",
+			       to == CS_GEODETIC ? "geodetic"
+			       : to == CS_ECEF ? "ecef" : "enu",
+			       cv->num, a_s, b_s, c_s);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * cmd_convert() - Executes the `convert` command. Reads coordinates in the 
+ * coordinate system `from_s` from the file `fname`, or stdin if `fname` is 
+ * NULL or "-", and prints them in the coordinate system `to_s`. The systems 
+ * are "geo" (latitude, longitude and height above the WGS84 ellipsoid), 
+ * "ecef" (Earth-centered, Earth-fixed) and "enu" (East-North-Up from the 
+ * position in --origin). "utm" and "mgrs" can only be used as the output 
+ * system. The coordinates are converted in batches via ECEF, and the local 
+ * frame and the UTM projection are prepared once. Returns `EXIT_SUCCESS` or 
+ * `EXIT_FAILURE`.
+ */
+
+int cmd_convert(const struct Options *o, const char *from_s,
+                const char *to_s, const char *fname)
+{
+	struct pointreader pr;
+	struct convert *cv;
+	CoorSystem from, to;
+	int retval = EXIT_FAILURE;
+
+	assert(o);
+	assert(from_s);
+	assert(to_s);
+
+	msg(7, "%s(\"%s\", \"%s\", \"%s\")",
+	       __func__, from_s, to_s, no_null(fname));
+
+	if (coor_system(from_s, &from)) {
+		myerror("%s: Unknown coordinate system, must be ecef, enu,"
+		        " geo, mgrs or utm", from_s);
+		return EXIT_FAILURE;
+	}
+	if (coor_system(to_s, &to)) {
+		myerror("%s: Unknown coordinate system, must be ecef, enu,"
+		        " geo, mgrs or utm", to_s);
+		return EXIT_FAILURE;
+	}
+	if (from == CS_MGRS || from == CS_UTM) {
+		myerror("%s can only be used as the output system", from_s);
+		return EXIT_FAILURE;
+	}
+	if ((from == CS_ENU || to == CS_ENU) != o->origin) {
+		myerror(o->origin ? "--origin is only used with enu"
+		                  : "enu needs the position in --origin");
+		return EXIT_FAILURE;
+	}
+
+	cv = malloc(sizeof(struct convert));
+	if (!cv) {
+		failed("malloc()"); /* gncov */
+		return EXIT_FAILURE; /* gncov */
+	}
+	cv->o = o;
+	cv->from = from;
+	cv->to = to;
+	cv->mul = o->km ? 1000.0 : 1.0;
+	cv->div = o->km && o->outpformat != OF_SQL ? 1000.0 : 1.0;
+	cv->n = 0;
+	cv->num = 0;
+	utm_init(&cv->tm, &o->ell);
+	enuframe_init(&cv->frame, &o->ell, o->origin_lat, o->origin_lon,
+	              o->origin_h * cv->mul);
+
+	if (pointreader_open(&pr, fname, o->inpformat)) {
+		free(cv);
+		return EXIT_FAILURE;
+	}
+	if (pr.format == IF_GPX && from != CS_GEODETIC) {
+		myerror("%s: GPX input is only supported with geo", pr.name);
+		goto cleanup;
+	}
+
+	if (o->outpformat == OF_SQL) {
+		puts("BEGIN;");
+		switch (to) {
+		case CS_GEODETIC:
+			puts("CREATE TABLE IF NOT EXISTS geodetic"
+			     " (num INTEGER, lat REAL, lon REAL,"
+			     " height REAL);");
+			break;
+		case CS_ECEF:
+			puts("CREATE TABLE IF NOT EXISTS ecef (num INTEGER,"
+			     " x REAL, y REAL, z REAL);");
+			break;
+		case CS_ENU:
+			puts("CREATE TABLE IF NOT EXISTS enu (num INTEGER,"
+			     " east REAL, north REAL, up REAL);");
+			break;
+		case CS_MGRS:
+			puts("CREATE TABLE IF NOT EXISTS mgrs (num INTEGER,"
+			     " mgrs TEXT, height REAL);");
+			break;
+		case CS_UTM:
+			puts("CREATE TABLE IF NOT EXISTS utm (num INTEGER,"
+			     " zone INTEGER, band TEXT, easting REAL,"
+			     " northing REAL, height REAL);");
+			break;
+		}
+	}
+
+	while (1) {
+		double rec[3];
+		PointStatus st;
+
+		st = pointreader_next_xyz(&pr, rec, from == CS_GEODETIC);
+
+		if (st == PS_ERROR)
+			goto cleanup;
+		if (st == PS_EOF)
+			break;
+		if ((st == PS_BREAK || cv->n == CONVERT_BATCH)
+		    && convert_flush(cv))
+			goto cleanup;
+		if (st == PS_BREAK) {
+			if (o->outpformat == OF_DEFAULT)
+				puts("");
+			continue;
+		}
+		cv->a[cv->n] = rec[0];
+		cv->b[cv->n] = rec[1];
+		cv->c[cv->n] = rec[2];
+		cv->n++;
+	}
+	if (convert_flush(cv))
+		goto cleanup;
+
+	if (o->outpformat == OF_SQL)
+		puts("COMMIT;");
+	retval = EXIT_SUCCESS;
+
+cleanup:
+	pointreader_close(&pr);
+	free(cv);
+
+	return retval;
+}
+
+/*
+ * bench_cheapruler() - Used by cmd_bench(). Returns the distance from 
+ * cheapruler_distance() on the WGS84 ellipsoid, so it has the same signature 
+ * as the other benchmarked functions.
+ */
+
+static double bench_cheapruler(const double lat1, const double lon1,
+                               const double lat2, const double lon2)
+{
+	return cheapruler_distance(&WGS84, lat1, lon1, lat2, lon2);
 }
 
 /*
@@ -898,7 +4270,7 @@ static int cmd_bench_cmp_rounds(const void *s1, const void *s2)
 int cmd_bench(const struct Options *o, const char *seconds)
 {
 	time_t secs = seconds ? atoi(seconds) : BENCH_LOOP_SECS;
-	struct bench_result br[2];
+	struct bench_result br[5];
 	const size_t arrsize = sizeof(br) / sizeof(br[0]);
 	size_t i;
 	int r = 0;
@@ -920,6 +4292,11 @@ int cmd_bench(const struct Options *o, const char *seconds)
 	/* Note: Update `br` size when new benchmarks are added/removed */
 	r += bench_dist_func("haversine", haversine, secs, &br[0]);
 	r += bench_dist_func("karney_distance", karney_distance, secs, &br[1]);
+	r += bench_dist_func("equirect_distance", equirect_distance, secs,
+	                     &br[2]);
+	r += bench_dist_func("cheapruler_distance", bench_cheapruler, secs,
+	                     &br[3]);
+	r += bench_dist_func("haversine32", haversine32, secs, &br[4]);
 	fputs("\n", stderr);
 
 	for (i = 0; i < arrsize; i++)
@@ -0,0 +1,761 @@
+/*
+ * fuzz.c 
+ * File ID: ae83a322-c9dc-11f1-ab7c-02fc00000001
+ *
+ * (C)opyleft 2024- Øyvind A. Holm <sunny@sunbase.org>
+ *
+ * This program is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the Free 
+ * Software Foundation; either version 2 of the License, or (at your option) 
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT 
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for 
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with 
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Fuzz targets for the functions that handle untrusted text. Every target 
+ * runs the function used by the program and a frozen reference copy of the 
+ * original implementation in this file, and aborts if the results differ. 
+ * This makes it possible to rewrite the functions for speed and verify that 
+ * the behavior is unchanged. The reference functions MUST NOT be changed 
+ * unless the behavior of the program is changed on purpose.
+ *
+ * The first byte of the input selects the function to test:
+ *
+ * 'c' - parse_coordinate() without range validation. Input in the other 
+ *       formats that the reference doesn't understand is checked for sane 
+ *       results, and the latitude and longitude must match the hemisphere 
+ *       letters and the order of the values in the input
+ * 'C' - parse_coordinate() with range validation
+ * 'd' - string_to_double()
+ * 't' - trim_zeros()
+ * 'x' - xml_escape_string()
+ * 'r' - str_replace(), the rest of the input is split into `s`, `s1` and `s2` 
+ *       at null bytes
+ * 'g' - gpx_next(), the rest of the input is read as a GPX file. There is no 
+ *       reference implementation, instead the results are compared with the 
+ *       results when the file is read 1 byte at a time, to check that the 
+ *       parser state survives every possible chunk boundary
+ *
+ * Other values select a function from the byte value, to let the fuzzer reach 
+ * all targets.
+ *
+ * When compiled with -DFUZZ_LIBFUZZER, only LLVMFuzzerTestOneInput() is 
+ * defined, for use with "clang -fsanitize=fuzzer". Otherwise, a main() 
+ * function is included that replays all files and directories specified on 
+ * the command line. That version can also be used with AFL by compiling it 
+ * with afl-cc and using "@@" as the file argument.
+ */
+
+#include "geocalc.h"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define FUZZ_TARGETS  "cCdtxrg"
+
+static const char *progname = "fuzz";
+static bool quiet = false;
+
+/*
+ * myerror() - Replacement for the function in geocalc.c, which can't be 
+ * linked into the fuzz programs. Prints the message to stderr, unless `quiet` 
+ * is set by a target where errors are expected. Returns the number of 
+ * characters printed.
+ */
+
+int myerror(const char *format, ...)
+{
+	va_list ap;
+	int retval;
+
+	assert(format);
+
+	if (quiet)
+		return 0;
+	retval = fprintf(stderr, "%s: ", progname);
+	va_start(ap, format);
+	retval += vfprintf(stderr, format, ap);
+	va_end(ap);
+	retval += fprintf(stderr, "\n");
+
+	return retval;
+}
+
+/******************************************************************************
+                          Reference implementations
+******************************************************************************/
+
+/*
+ * ref_string_to_double() - Reference copy of string_to_double().
+ */
+
+static int ref_string_to_double(const char *s, double *dest)
+{
+	char *endptr;
+
+	*dest = strtod(s, &endptr);
+
+	if (errno == ERANGE)
+		return 1;
+	if (endptr == s) {
+		errno = EINVAL;
+		return 1;
+	}
+	while (*endptr != '\0') {
+		if (*endptr != ',' && !isspace((unsigned char)*endptr)) {
+			errno = EINVAL;
+			return 1;
+		}
+		endptr++;
+	}
+	if (isnan(*dest)) {
+		errno = EINVAL;
+		return 1;
+	}
+	if (isinf(*dest)) {
+		errno = ERANGE;
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * ref_trim_zeros() - Reference copy of trim_zeros().
+ */
+
+static char *ref_trim_zeros(char *s)
+{
+	char *p;
+	double d;
+
+	if (!s || !*s)
+		return s;
+	if (!strchr(s, '.'))
+		return s;
+	if (ref_string_to_double(s, &d))
+		return s;
+	for (p = s; *p; p++) {
+		if (!strchr("0123456789+-.", *p))
+			return s;
+	}
+
+	p--;
+	while (p > s + 1 && *p == '0' && *(p - 1) != '.')
+		*p-- = '\0';
+
+	return s;
+}
+
+/*
+ * ref_xml_escape_string() - Reference copy of xml_escape_string().
+ */
+
+static char *ref_xml_escape_string(const char *text)
+{
+	char *retval, *destp;
+	const char *p;
+
+	if (!text)
+		return NULL;
+
+	retval = malloc(strlen(text) * 5 + 1);
+	if (!retval)
+		return NULL;
+
+	destp = retval;
+	for (p = text; *p; p++) {
+		switch (*p) {
+		case '&':
+			strcpy(destp, "&amp;");
+			destp += 5;
+			break;
+		case '<':
+			strcpy(destp, "&lt;");
+			destp += 4;
+			break;
+		case '>':
+			strcpy(destp, "&gt;");
+			destp += 4;
+			break;
+		default:
+			*destp++ = *p;
+			break;
+		}
+	}
+	*destp = '\0';
+
+	return retval;
+}
+
+/*
+ * ref_count_substr() - Reference copy of count_substr().
+ */
+
+static size_t ref_count_substr(const char *s, const char *substr)
+{
+	size_t count = 0, len_ss;
+	const char *p = s;
+
+	if (!s || !substr || !*s || !*substr)
+		return 0;
+
+	len_ss = strlen(substr);
+	while ((p = strstr(p, substr)) != NULL) {
+		count++;
+		p += len_ss;
+	}
+
+	return count;
+}
+
+/*
+ * ref_str_replace() - Reference copy of str_replace().
+ */
+
+static char *ref_str_replace(const char *s, const char *s1, const char *s2)
+{
+	size_t len_s1, len_s2, count, new_len;
+	const char *tmp, *src;
+	char *buf, *dest;
+
+	if (!s || !s1 || !s2)
+		return NULL;
+
+	len_s1 = strlen(s1);
+	len_s2 = strlen(s2);
+	count = ref_count_substr(s, s1);
+
+	if (!*s || !*s1 || !count)
+		return mystrdup(s);
+
+	new_len = strlen(s) + count * (len_s2 - len_s1);
+	buf = malloc(new_len + 1);
+	if (!buf)
+		return NULL;
+
+	dest = buf;
+	src = s;
+	while ((tmp = strstr(src, s1)) != NULL) {
+		size_t len_before = (size_t)(tmp - src);
+
+		memcpy(dest, src, len_before);
+		dest += len_before;
+		memcpy(dest, s2, len_s2);
+		dest += len_s2;
+		src = tmp + len_s1;
+	}
+	strcpy(dest, src);
+
+	return buf;
+}
+
+/*
+ * ref_parse_coordinate() - Reference copy of parse_coordinate().
+ */
+
+static int ref_parse_coordinate(const char *s, bool validate,
+                                double *dest_lat, double *dest_lon)
+{
+	char *comma, *sd;
+	double lat, lon;
+	int retval = 0;
+
+	if (!s || !dest_lat || !dest_lon)
+		return 1;
+	if (!strchr(s, ','))
+		return 1;
+	sd = mystrdup(s);
+	if (!sd)
+		return 1;
+	comma = strchr(sd, ',');
+	if (ref_string_to_double(comma + 1, &lon)) {
+		retval = 1;
+		goto cleanup;
+	}
+	*comma = '\0';
+	if (ref_string_to_double(sd, &lat)) {
+		retval = 1;
+		goto cleanup;
+	}
+	*dest_lat = lat;
+	*dest_lon = lon;
+
+	if (validate && (fabs(lat) > 90.0 || fabs(lon) > 180.0))
+		retval = 1;
+
+cleanup:
+	free(sd);
+
+	return retval;
+}
+
+/******************************************************************************
+                                Fuzz targets
+******************************************************************************/
+
+/*
+ * mismatch() - Prints an error message about different results for the 
+ * function `func` with the input `input` and aborts the program. Returns 
+ * nothing.
+ */
+
+static void mismatch(const char *func, const char *input)
+{
+	myerror("%s(): Result differs from the reference implementation,"
+	        " input = \"%s\"", func, input);
+	abort();
+}
+
+/*
+ * same_double() - Returns true if `a` and `b` have identical bit patterns, or 
+ * both are NaN. Otherwise, it returns false.
+ */
+
+static bool same_double(const double a, const double b)
+{
+	return (isnan(a) && isnan(b)) || !memcmp(&a, &b, sizeof(a));
+}
+
+/*
+ * same_str() - Returns true if the strings `a` and `b` are identical or both 
+ * are NULL. Otherwise, it returns false.
+ */
+
+static bool same_str(const char *a, const char *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	return !strcmp(a, b);
+}
+
+/*
+ * fuzz_string_to_double() - Compares string_to_double() with the reference 
+ * implementation, including the value of `errno`. Returns nothing.
+ */
+
+static void fuzz_string_to_double(const char *s)
+{
+	double got = 0.0, exp = 0.0;
+	int got_ret, exp_ret, got_errno, exp_errno;
+
+	errno = 0;
+	got_ret = string_to_double(s, &got);
+	got_errno = errno;
+	errno = 0;
+	exp_ret = ref_string_to_double(s, &exp);
+	exp_errno = errno;
+	errno = 0;
+
+	if (got_ret != exp_ret || got_errno != exp_errno
+	    || !same_double(got, exp))
+		mismatch("string_to_double", s);
+}
+
+/*
+ * labels_ok() - Used by fuzz_parse_coordinate() when parse_coordinate() 
+ * accepted `s` as `lat,lon` in a format the reference doesn't understand. 
+ * Finds the hemisphere letters outside the numbers in `s`, where the numbers 
+ * are skipped with strtod() like the parser does, so an `E` in an exponent 
+ * isn't counted. There must be no letters or one N/S and one E/W, and the 
+ * signs must match the letters. The first number is the degrees of the first 
+ * value, which is the latitude without letters, so the absolute value of that 
+ * angle must be at least that number and less than one degree more, since 
+ * minutes and seconds are below 60. This catches swapped axes. Returns true 
+ * if everything matches, otherwise false.
+ */
+
+static bool labels_ok(const char *s, const double lat, const double lon)
+{
+	const char *p = s;
+	char letter[2] = { 0, 0 };
+	double first = NAN, lead;
+	int n = 0, ns;
+
+	while (*p) {
+		char *end;
+		const double d = strtod(p, &end);
+
+		if (end > p) {
+			if (isnan(first))
+				first = fabs(d);
+			p = end;
+			continue;
+		}
+		if (*p == 'N' || *p == 'S' || *p == 'E' || *p == 'W') {
+			if (n == 2)
+				return false;
+			letter[n++] = *p;
+		}
+		p++;
+	}
+	if (n == 1 || isnan(first))
+		return false;
+	if (!n) {
+		lead = lat;
+	} else {
+		ns = letter[0] == 'N' || letter[0] == 'S' ? 0 : 1;
+		if ((letter[ns] != 'N' && letter[ns] != 'S')
+		    || (letter[!ns] != 'E' && letter[!ns] != 'W')
+		    || !signbit(lat) != (letter[ns] == 'N')
+		    || !signbit(lon) != (letter[!ns] == 'E'))
+			return false;
+		lead = ns ? lon : lat;
+	}
+
+	return fabs(lead) >= first && fabs(lead) - first < 61.0 / 60.0;
+}
+
+/*
+ * fuzz_parse_coordinate() - Compares parse_coordinate() with the reference 
+ * implementation. The reference only understands decimal degrees separated by 
+ * a comma, so when it rejects the syntax, parse_coordinate() is allowed to 
+ * accept the input in one of the other formats, but the result must be a 
+ * finite coordinate, inside the valid range if `validate` is true, and agree 
+ * with labels_ok(). Returns nothing.
+ */
+
+static void fuzz_parse_coordinate(const char *s, const bool validate)
+{
+	double got_lat = NAN, got_lon = NAN, exp_lat = NAN, exp_lon = NAN;
+	int got_ret, exp_ret;
+
+	errno = 0;
+	got_ret = parse_coordinate(s, validate, &got_lat, &got_lon);
+	errno = 0;
+	exp_ret = ref_parse_coordinate(s, validate, &exp_lat, &exp_lon);
+	errno = 0;
+
+	if (exp_ret && isnan(exp_lat)) {
+		if (isnan(got_lat) && isnan(got_lon))
+			return;
+		if (!isfinite(got_lat) || !isfinite(got_lon)
+		    || (validate && !got_ret && (fabs(got_lat) > 90.0
+		                                 || fabs(got_lon) > 180.0))
+		    || (got_ret && (!validate || (fabs(got_lat) <= 90.0
+		                                  && fabs(got_lon) <= 180.0)))
+		    || (!got_ret && !labels_ok(s, got_lat, got_lon)))
+			mismatch("parse_coordinate", s);
+		return;
+	}
+	if (got_ret != exp_ret || !same_double(got_lat, exp_lat)
+	    || !same_double(got_lon, exp_lon))
+		mismatch("parse_coordinate", s);
+}
+
+/*
+ * fuzz_trim_zeros() - Compares trim_zeros() with the reference 
+ * implementation. Returns nothing.
+ */
+
+static void fuzz_trim_zeros(const char *s)
+{
+	char *got = mystrdup(s), *exp = mystrdup(s);
+
+	if (!got || !exp) {
+		failed("mystrdup()");
+		abort();
+	}
+	errno = 0;
+	if (trim_zeros(got) != got)
+		mismatch("trim_zeros", s);
+	errno = 0;
+	ref_trim_zeros(exp);
+	errno = 0;
+	if (strcmp(got, exp))
+		mismatch("trim_zeros", s);
+	free(exp);
+	free(got);
+}
+
+/*
+ * fuzz_xml_escape_string() - Compares xml_escape_string() with the reference 
+ * implementation. Returns nothing.
+ */
+
+static void fuzz_xml_escape_string(const char *s)
+{
+	char *got = xml_escape_string(s), *exp = ref_xml_escape_string(s);
+
+	if (!same_str(got, exp))
+		mismatch("xml_escape_string", s);
+	free(exp);
+	free(got);
+}
+
+/*
+ * fuzz_str_replace() - Compares str_replace() with the reference 
+ * implementation. `s` contains the 3 arguments separated by null bytes, and 
+ * `size` is the total size of `s`. Missing arguments are empty strings. 
+ * Returns nothing.
+ */
+
+static void fuzz_str_replace(const char *s, const size_t size)
+{
+	const char *s1 = "", *s2 = "";
+	size_t len = strlen(s);
+	char *got, *exp;
+
+	if (len < size) {
+		s1 = s + len + 1;
+		len += strlen(s1) + 1;
+		if (len < size)
+			s2 = s + len + 1;
+	}
+	got = str_replace(s, s1, s2);
+	exp = ref_str_replace(s, s1, s2);
+	if (!same_str(got, exp))
+		mismatch("str_replace", s);
+	free(exp);
+	free(got);
+}
+
+/*
+ * fuzz_gpx() - Reads `s` with size `size` as a GPX file with gpx_next(), both 
+ * with the default chunk size and 1 byte at a time, and aborts if the 
+ * results differ or any invalid positions are returned. Returns nothing.
+ */
+
+static void fuzz_gpx(char *s, const size_t size)
+{
+	struct gpxreader g1, g2;
+	FILE *fp1, *fp2;
+	PointStatus st1, st2;
+
+	if (!size)
+		return;
+	fp1 = fmemopen(s, size, "r");
+	fp2 = fmemopen(s, size, "r");
+	if (!fp1 || !fp2 || gpx_open(&g1, fp1, "fuzz", 1)
+	    || gpx_open(&g2, fp2, "fuzz", 1)) {
+		failed("fmemopen() or gpx_open()");
+		abort();
+	}
+	g2.chunksize = 1;
+	quiet = true;
+	do {
+		double lat1 = 0.0, lon1 = 0.0, ele1 = 0.0, time1 = 0.0,
+		       lat2 = 0.0, lon2 = 0.0, ele2 = 0.0, time2 = 0.0;
+
+		st1 = gpx_next(&g1, &lat1, &lon1, &ele1, &time1);
+		st2 = gpx_next(&g2, &lat2, &lon2, &ele2, &time2);
+		if (st1 != st2 || !same_double(lat1, lat2)
+		    || !same_double(lon1, lon2) || !same_double(ele1, ele2)
+		    || !same_double(time1, time2)
+		    || g1.linenum != g2.linenum) {
+			quiet = false;
+			myerror("gpx_next(): Result differs with 1 byte"
+			        " chunks");
+			abort();
+		}
+		if (st1 == PS_POINT && (!(fabs(lat1) <= 90.0)
+		                        || !(fabs(lon1) <= 180.0))) {
+			quiet = false;
+			myerror("gpx_next(): Invalid position returned");
+			abort();
+		}
+	} while (st1 == PS_POINT || st1 == PS_BREAK);
+	quiet = false;
+	gpx_close(&g2);
+	gpx_close(&g1);
+	fclose(fp2);
+	fclose(fp1);
+}
+
+/*
+ * fuzz_one() - Runs the fuzz target selected by the first byte in `data` with 
+ * the rest of the data as input. Aborts the program if any differences are 
+ * found. Returns nothing.
+ */
+
+static void fuzz_one(const uint8_t *data, const size_t size)
+{
+	const char *targets = FUZZ_TARGETS, *sel;
+	char *s;
+
+	if (!size)
+		return;
+
+	/* Null-terminated copy, so the input can be used as a string */
+	s = malloc(size);
+	if (!s) {
+		failed("malloc()");
+		abort();
+	}
+	memcpy(s, data + 1, size - 1);
+	s[size - 1] = '\0';
+
+	sel = data[0] ? strchr(targets, data[0]) : NULL;
+	if (!sel)
+		sel = targets + data[0] % strlen(targets);
+
+	switch (*sel) {
+	case 'c':
+		fuzz_parse_coordinate(s, false);
+		break;
+	case 'C':
+		fuzz_parse_coordinate(s, true);
+		break;
+	case 'd':
+		fuzz_string_to_double(s);
+		break;
+	case 't':
+		fuzz_trim_zeros(s);
+		break;
+	case 'x':
+		fuzz_xml_escape_string(s);
+		break;
+	case 'r':
+		fuzz_str_replace(s, size - 1);
+		break;
+	case 'g':
+		fuzz_gpx(s, size - 1);
+		break;
+	}
+	free(s);
+}
+
+/*
+ * LLVMFuzzerTestOneInput() - Entry point for libFuzzer. Returns 0.
+ */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	fuzz_one(data, size);
+
+	return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+/******************************************************************************
+                                Replay driver
+******************************************************************************/
+
+/*
+ * replay_file() - Reads the file `path` with size `size` and sends the 
+ * contents to fuzz_one(). Returns 0 if ok, or 1 if the file couldn't be read.
+ */
+
+static int replay_file(const char *path, const size_t size)
+{
+	FILE *fp;
+	uint8_t *buf;
+	int retval = 0;
+
+	fp = fopen(path, "rb");
+	if (!fp) {
+		myerror("%s: Cannot open file for read: %s",
+		        path, strerror(errno));
+		return 1;
+	}
+	buf = malloc(size + 1);
+	if (!buf) {
+		failed("malloc()");
+		fclose(fp);
+		return 1;
+	}
+	if (fread(buf, 1, size, fp) != size) {
+		myerror("%s: Could not read file", path);
+		retval = 1;
+	} else {
+		fuzz_one(buf, size);
+	}
+	free(buf);
+	fclose(fp);
+
+	return retval;
+}
+
+/*
+ * replay_path() - Replays `path`. If it's a directory, all regular files in 
+ * it are replayed. Adds the number of replayed files to `count`. Returns the 
+ * number of errors.
+ */
+
+static int replay_path(const char *path, unsigned long *count)
+{
+	struct stat st;
+	struct dirent *de;
+	DIR *dir;
+	int errcount = 0;
+
+	if (stat(path, &st)) {
+		myerror("%s: %s", path, strerror(errno));
+		return 1;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		errcount += replay_file(path, (size_t)st.st_size);
+		(*count)++;
+		return errcount;
+	}
+
+	dir = opendir(path);
+	if (!dir) {
+		myerror("%s: Cannot open directory: %s",
+		        path, strerror(errno));
+		return 1;
+	}
+	while ((de = readdir(dir)) != NULL) {
+		char *file;
+
+		if (*de->d_name == '.')
+			continue;
+		file = allocstr("%s/%s", path, de->d_name);
+		if (!file) {
+			failed("allocstr()");
+			errcount++;
+			break;
+		}
+		if (!stat(file, &st) && S_ISREG(st.st_mode)) {
+			errcount += replay_file(file, (size_t)st.st_size);
+			(*count)++;
+		}
+		free(file);
+	}
+	closedir(dir);
+
+	return errcount;
+}
+
+/*
+ * main() - Replays all files and directories in `argv`. Returns 
+ * `EXIT_SUCCESS` if all files were replayed without differences, otherwise 
+ * `EXIT_FAILURE`.
+ */
+
+int main(int argc, char *argv[])
+{
+	unsigned long count = 0;
+	int i, errcount = 0;
+
+	progname = argv[0];
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s file_or_dir [...]\n", progname);
+		return EXIT_FAILURE;
+	}
+	for (i = 1; i < argc; i++)
+		errcount += replay_path(argv[i], &count);
+	printf("%s: Replayed %lu file%s, %d error%s\n", progname,
+	       count, count == 1 ? "" : "s",
+	       errcount, errcount == 1 ? "" : "s");
+
+	return errcount ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif /* ifndef FUZZ_LIBFUZZER */
+
+#undef FUZZ_TARGETS
+
+/* vim: set ts=8 sw=8 sts=8 noet fo+=w tw=79 fenc=UTF-8 : */
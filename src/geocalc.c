@@ -30,8 +30,8 @@ static struct Options opt;
 /*
  * opt_struct() - Returns a copy of `opt`. It can be used by functions outside 
  * this file who need to inspect the values of various members of `opt`. It is 
- * currently used by test_command() and te_randpos() in the test suite for use 
- * with streams_exec().
+ * currently used by test_command() and run_cmd() in the test suite for use 
+ * with streams_exec() and streams_call().
  */
 
 struct Options opt_struct(void)
@@ -78,6 +78,8 @@ const char *std_strerror(const int errnum)
 		return "Permission denied";
 	case EINVAL:
 		return "Invalid argument";
+	case ENOENT:
+		return "No such file or directory";
 	case ERANGE:
 		return "Numerical result out of range";
 	default: /* gncov */
@@ -227,21 +229,36 @@ static int usage(const struct Options *o, const int retval)
 	printf("\n");
 	printf("Commands:\n");
 	printf("\n");
-	printf("Some arguments are specified as a coordinate. One format is"
-	       " allowed, \n"
-	       "decimal degrees:\n"
+	printf("Some arguments are specified as a coordinate, and text"
+	       " input uses \n"
+	       "the same format. The standard format is decimal"
+	       " degrees:\n"
 	       "\n"
 	       "  lat,lon\n"
 	       "\n"
 	       "where `lat` and `lon` is a number in the range"
 	       " -90..90 and -180..180, \n"
 	       "separated by a comma. The decimal comma must be a period,"
-	       " '.'.\n");
+	       " '.'. The \n"
+	       "comma can also be whitespace, and degrees, minutes and"
+	       " seconds are \n"
+	       "accepted with markers or hemisphere letters, for example"
+	       " `60.3925 5.3233`, \n"
+	       "`60°23'33\"N 5°19'24\"E`, `N60 23.55 E5 19.4` or"
+	       " `60 23 33 5 19 24`.\n");
 	printf("\n");
 	printf("  anti <coor>\n"
 	       "    Print the antipodal coordinate of `coor`, i.e. the"
 	       " coordinate on the \n"
 	       "    exact opposite side of the planet.\n");
+	printf("  area [file]\n"
+	       "    Read polygons from `file` or stdin, where every segment"
+	       " is a ring, \n"
+	       "    and print the total signed area in square meters, the"
+	       " perimeter \n"
+	       "    and the number of positions and rings."
+	       " Counterclockwise rings \n"
+	       "    are positive.\n");
 	printf("  bear <coor1> <coor2>\n"
 	       "    Print initial compass bearing (0-360) between"
 	       " two points.\n");
@@ -260,13 +277,98 @@ static int usage(const struct Options *o, const int retval)
 	       "    values for the length are allowed, to make it possible"
 	       " to calculate \n"
 	       "    positions in the opposite direction of the bearing.\n");
+	printf("  centroid [file]\n"
+	       "    Read positions from `file` or stdin and print the"
+	       " centroid on the \n"
+	       "    sphere, the number of positions, the total weight, the"
+	       " length of \n"
+	       "    the mean vector (0-1) and the dispersion in meters. Use"
+	       " --weighted \n"
+	       "    to read a weight after every position.\n");
+	printf("  cluster <eps> <minpts> [file]\n"
+	       "    Read positions from `file` or stdin and find clusters"
+	       " with the \n"
+	       "    DBSCAN algorithm, where positions within `eps` meters are"
+	       " neighbours \n"
+	       "    and a cluster needs positions with at least `minpts`"
+	       " neighbours. \n"
+	       "    Print the cluster number of every position, where 0 is"
+	       " noise, and \n"
+	       "    the centroid and the number of positions of every"
+	       " cluster.\n");
+	printf("  convert <from> <to> [file]\n"
+	       "    Read coordinates from `file` or stdin and convert them"
+	       " between the \n"
+	       "    coordinate systems geo (`lat,lon[,height]` on the WGS84"
+	       " ellipsoid), \n"
+	       "    ecef (Earth-centered, Earth-fixed `x,y,z`) and enu (local"
+	       " \n"
+	       "    `east,north,up` from the position in --origin). `to` can"
+	       " also be utm \n"
+	       "    (like `32V,easting,northing,height`) or mgrs"
+	       " (`mgrs,height`).\n");
 	printf("  course <coor1> <coor2> <numpoints>\n"
 	       "    Generate a list of intermediate points on a direct line"
 	       " between two \n"
 	       "    locations.\n"
 	       "");
+	printf("  cpa <coor1> <bearing1> <speed1> <coor2> <bearing2>"
+	       " <speed2>\n"
+	       "    Two objects move along great circles from `coor1` and"
+	       " `coor2` with \n"
+	       "    the initial bearings and the speeds in meters per second."
+	       " Print \n"
+	       "    the time in seconds until they are closest to each other,"
+	       " the \n"
+	       "    distance and the positions at that time.\n");
 	printf("  dist <coor1> <coor2>\n"
 	       "    Calculate the distance between two points.\n");
+	printf("  fence <fences> [file]\n"
+	       "    Read polygons from the file `fences`, where every segment"
+	       " is a \n"
+	       "    fence, then read positions from `file` or stdin and print"
+	       " the \n"
+	       "    number of the position and the number of the fence for"
+	       " every \n"
+	       "    fence that contains a position. A fence must be smaller"
+	       " than a \n"
+	       "    hemisphere.\n");
+	printf("  geohash [file]\n"
+	       "    Read positions from `file` or stdin and print the geohash"
+	       " of every \n"
+	       "    position. The length is 12 characters, or the value of"
+	       " --geohash.\n");
+	printf("  grid <num>\n"
+	       "  grid <coor> <maxdist> <spacing>\n"
+	       "    Print `num` evenly spaced positions on the whole Earth, or"
+	       " positions \n"
+	       "    about `spacing` meters apart within `maxdist` meters from"
+	       " `coor`, \n"
+	       "    using a Fibonacci lattice.\n");
+	printf("  intersect <coor1> <coor2> <coor3> <coor4>\n"
+	       "    Print the intersection of the great circles through the"
+	       " segments \n"
+	       "    `coor1`-`coor2` and `coor3`-`coor4`, the distances to it"
+	       " from `coor1` \n"
+	       "    and `coor3`, and 1 if the segments cross, otherwise 0.\n");
+	printf("  intersect <coor1> <coor2> [file]\n"
+	       "    Read a track from `file` or stdin and print the number of"
+	       " the \n"
+	       "    position, the position and the distance from `coor1` for"
+	       " every leg \n"
+	       "    that crosses the segment `coor1`-`coor2`.\n");
+	printf("  join <points> <maxdist> [file]\n"
+	       "    Read positions from the file `points` into a spatial"
+	       " index, then \n"
+	       "    read positions from `file` or stdin and print the number"
+	       " of the \n"
+	       "    position, the number of the point and the distance for"
+	       " every point \n"
+	       "    within `maxdist` meters of a position. Use --nearest to"
+	       " print only \n"
+	       "    the nearest point. `points` should be the smaller file."
+	       " Supports \n"
+	       "    -H/--haversine and -K/--karney.\n");
 	printf("  lpos <coor1> <coor2> <fracdist>\n"
 	       "    Prints the position of a point on a straight line between"
 	       " the \n"
@@ -278,6 +380,18 @@ static int usage(const struct Options *o, const int retval)
 	       " to calculate \n"
 	       "    positions beyond `coor2` or in the opposite direction"
 	       " from `coor1`.\n");
+	printf("  randbox <coor1> <coor2>\n"
+	       "    Generate uniformly distributed random coordinates between"
+	       " the \n"
+	       "    latitudes of `coor1` and `coor2`, going east from the"
+	       " longitude of \n"
+	       "    `coor1` to the longitude of `coor2`.\n");
+	printf("  randpoly [file]\n"
+	       "    Read polygons from `file` or stdin like the fences in"
+	       " fence, and \n"
+	       "    generate uniformly distributed random coordinates inside"
+	       " them. \n"
+	       "    Clockwise polygons are holes.\n");
 	printf("  randpos [[coor maxdist] mindist]\n"
 	       "    Generate uniformly distributed random coordinates"
 	       " worldwide, \n"
@@ -294,39 +408,154 @@ static int usage(const struct Options *o, const int retval)
 	       "    `mindist` exceeds `maxdist`, the values are swapped. Use"
 	       " --count to \n"
 	       "    specify the number of coordinates to generate.\n");
+	printf("  ring <radius> <vertices> [file]\n"
+	       "    Read center positions from `file` or stdin and print a"
+	       " closed \n"
+	       "    polygon with `vertices` vertices around each of them,"
+	       " `radius` \n"
+	       "    meters from the center. Use --inner for an annulus and"
+	       " --sector for \n"
+	       "    a sector. The polygons are counterclockwise, with the"
+	       " inner ring \n"
+	       "    of an annulus as a clockwise hole.\n");
+	printf("  simplify <tolerance> [file]\n"
+	       "    Read positions from `file` or stdin and print the"
+	       " positions needed \n"
+	       "    to keep the track within `tolerance` meters of the"
+	       " original track, \n"
+	       "    using the Douglas-Peucker algorithm. The input format is"
+	       " the same \n"
+	       "    as for `track`. Supports -H/--haversine and"
+	       " -K/--karney.\n");
+	printf("  sort [file]\n"
+	       "    Read positions from `file` or stdin and print them sorted"
+	       " along a \n"
+	       "    Hilbert curve, or the curve specified with --sort. Files"
+	       " larger \n"
+	       "    than the available memory are sorted with temporary"
+	       " files.\n");
+	printf("  track [file]\n"
+	       "    Read positions from `file` or stdin and print the"
+	       " distance and \n"
+	       "    initial bearing of every leg, the length of every"
+	       " segment, the \n"
+	       "    total length and the bounding box. Every line contains"
+	       " a `lat,lon` \n"
+	       "    coordinate, and an empty line starts a new segment."
+	       " Supports \n"
+	       "    -H/--haversine and -K/--karney.\n");
+	printf("  xtrack <route> [file]\n"
+	       "    Read a route from the file `route`, then read positions"
+	       " from `file` \n"
+	       "    or stdin and print the cross-track distance to the"
+	       " nearest point on \n"
+	       "    the route, the along-track distance from the start of"
+	       " the route to \n"
+	       "    that point, and the number of the nearest leg. The"
+	       " cross-track \n"
+	       "    distance is negative if the position is to the left of"
+	       " the route.\n");
 	printf("\n");
 	printf("Options:\n");
 	printf("\n");
+	printf("  --approx <formula>\n"
+	       "    Use a fast approximate formula for dist and join."
+	       " Available formulas: \n"
+	       "    equirect (equirectangular projection, max relative error"
+	       " 5e-4), \n"
+	       "    cheapruler (flat ellipsoid approximation, max relative"
+	       " error 5e-4 \n"
+	       "    compared to -K) and haversine32 (Haversine in single"
+	       " precision, max \n"
+	       "    relative error 1e-6). The bounds are valid for distances"
+	       " up to 100 km \n"
+	       "    and latitudes up to 80 degrees. join recalculates the"
+	       " distances near \n"
+	       "    the limit with the exact formula, so the same pairs are"
+	       " found.\n");
 	printf("  --count <num>\n"
-	       "    When used with `randpos`, print `num` random points.\n");
+	       "    When used with randbox, randpoly or randpos, print `num`"
+	       " random \n"
+	       "    points. When used with --selftest, multiply the number of"
+	       " iterations \n"
+	       "    in the property tests by `num`.\n");
+	printf("  --ellipsoid <model>\n"
+	       "    Use the Earth model `model` for -K/--karney and for the"
+	       " ECEF, ENU, \n"
+	       "    UTM and MGRS coordinates. Available models: wgs84"
+	       " (default), grs80, \n"
+	       "    clarke1866, authalic (a sphere with the same area as"
+	       " WGS84), or a \n"
+	       "    custom ellipsoid as `a,invf`, where `a` is the semi-major"
+	       " axis in \n"
+	       "    meters and `invf` is the inverse flattening. An inverse"
+	       " flattening \n"
+	       "    of 0 gives a sphere with the radius `a`. The Haversine and"
+	       " rhumb line \n"
+	       "    formulas always use a sphere with a radius of 6371 km.\n");
 	printf("  -F <format>, --format <format>\n"
 	       "    Output in a specific format. Available formats:"
-	       " default, gpx, sql.\n");
+	       " default, \n"
+	       "    geojson (only for ring), gpx, mgrs, sql, utm. mgrs and"
+	       " utm print the \n"
+	       "    positions from anti, bpos, course, grid, lpos, randbox,"
+	       " randpoly and \n"
+	       "    randpos as MGRS references or UTM coordinates, like"
+	       " \n"
+	       "    `32V,easting,northing`, the same layout as convert"
+	       " uses.\n");
+	printf("  --geohash <len>\n"
+	       "    Add a geohash with `len` characters (1-12) to the"
+	       " positions from \n"
+	       "    course, grid, randbox, randpoly and randpos, and use `len`"
+	       " characters \n"
+	       "    in the geohash command.\n");
 	printf("  -H, --haversine\n"
 	       "    Use the Haversine formula (spherical Earth model) for the"
-	       " dist or \n"
-	       "    bear command. This formula is the default due to its"
-	       " compatibility \n"
-	       "    with other Geocalc commands, other software, and most GPS"
-	       " units. It \n"
-	       "    is accurate enough for most practical uses, but for"
-	       " applications \n"
-	       "    requiring sub-millimeter accuracy, use the -K/--karney"
-	       " option.\n");
+	       " area, \n"
+	       "    dist, bear, join, simplify or track command. This formula"
+	       " is the \n"
+	       "    default due to its compatibility with other Geocalc"
+	       " commands, \n"
+	       "    other software, and most GPS units. It is accurate enough"
+	       " for most \n"
+	       "    practical uses, but for applications requiring"
+	       " sub-millimeter \n"
+	       "    accuracy, use the -K/--karney option.\n");
 	printf("  -h, --help\n"
 	       "    Show this help.\n");
 	printf("  -K, --karney\n"
-	       "    Use the Karney formula for the dist or bear command. This"
-	       " formula \n"
-	       "    models the Earth as an ellipsoid and provides"
-	       " significantly higher \n"
-	       "    accuracy than the default Haversine formula, which assumes"
-	       " a \n"
-	       "    spherical Earth. It achieves an accuracy of 15 nanometers"
-	       " for \n"
-	       "    distance calculations, making it suitable for"
-	       " high-precision \n"
-	       "    applications.\n");
+	       "    Use the Karney formula for the area, dist, bear, join,"
+	       " simplify or \n"
+	       "    track command. This formula models the Earth as an"
+	       " ellipsoid and \n"
+	       "    provides significantly higher accuracy than the default"
+	       " Haversine \n"
+	       "    formula, which assumes a spherical Earth. It achieves an"
+	       " accuracy of \n"
+	       "    15 nanometers for distance calculations, making it"
+	       " suitable for \n"
+	       "    high-precision applications. The simplify command uses the"
+	       " local \n"
+	       "    radius of curvature of the ellipsoid, and the area command"
+	       " uses the \n"
+	       "    authalic sphere.\n");
+	printf("  --inner <dist>\n"
+	       "    Add an inner ring `dist` meters from the center to the"
+	       " polygons \n"
+	       "    from ring.\n");
+	printf("  --input-format <format>\n"
+	       "    Read input files in a specific format. Available formats:"
+	       " default \n"
+	       "    (one `lat,lon` coordinate per line), binary (pairs of"
+	       " `double` \n"
+	       "    values in native byte order, latitude first, where NaN,NaN"
+	       " starts a \n"
+	       "    new segment), gpx (<wpt>, <rtept> and <trkpt> elements"
+	       " with optional \n"
+	       "    <ele> and <time>). GPX is detected automatically when"
+	       " using the \n"
+	       "    default format.\n");
 	printf("  --km\n"
 	       "    Use kilometers instead of meters for input and output. An"
 	       " exception \n"
@@ -337,8 +566,34 @@ static int usage(const struct Options *o, const int retval)
 	       "    generated SQL.\n");
 	printf("  --license\n"
 	       "    Print the software license.\n");
+	printf("  --min-separation <dist>\n"
+	       "    Make all positions from randbox, randpoly or randpos at"
+	       " least `dist` \n"
+	       "    meters apart. An error is returned if no more room is"
+	       " found for new \n"
+	       "    positions.\n");
+	printf("  --nearest\n"
+	       "    Print only the nearest point for every position in the"
+	       " join \n"
+	       "    command.\n");
+	printf("  --origin <lat,lon[,height]>\n"
+	       "    Use this position as the origin of the enu coordinate"
+	       " system in the \n"
+	       "    convert command.\n");
 	printf("  -q, --quiet\n"
 	       "    Be more quiet. Can be repeated to increase silence.\n");
+	printf("  --rhumb\n"
+	       "    Use rhumb lines (loxodromes), which keep a constant"
+	       " bearing, instead \n"
+	       "    of great circles in the bear, bpos, course, dist, lpos and"
+	       " track \n"
+	       "    commands.\n");
+	printf("  --sector <bear1>/<bear2>\n"
+	       "    Make the polygons from ring cover only the sector going"
+	       " clockwise \n"
+	       "    from the bearing `bear1` to `bear2`, both in the range"
+	       " 0-360. The \n"
+	       "    bearings cannot be equal.\n");
 	printf("  --seed <seednum>\n"
 	       "    Initialize the pseudo-random number generator with the"
 	       " value \n"
@@ -352,11 +607,26 @@ static int usage(const struct Options *o, const int retval)
 	       " can contain \n"
 	       "    one or more of these strings: \"exec\" (the tests use the"
 	       " executable \n"
-	       "    file), \"func\" (runs function tests), or \"all\"."
-	       " Multiple strings \n"
-	       "    should be separated by commas. If no argument is"
-	       " specified, default \n"
-	       "    is \"all\".\n");
+	       "    file), \"func\" (runs function tests), \"prop\" (runs"
+	       " only the \n"
+	       "    randomized property tests), or \"all\". Multiple strings"
+	       " should be \n"
+	       "    separated by commas. If no argument is specified, default"
+	       " is \"all\".\n");
+	printf("  --shard <num>/<total>\n"
+	       "    Split the positions from grid into `total` equal parts and"
+	       " print \n"
+	       "    only part number `num`, starting at 1. The positions keep"
+	       " their \n"
+	       "    numbers, so the parts can be generated in parallel.\n");
+	printf("  --sort <order>\n"
+	       "    Sort the positions from randbox, randpoly or randpos along"
+	       " a \n"
+	       "    space-filling curve, and use this curve in the sort"
+	       " command. \n"
+	       "    Available orders: spatial or hilbert (Hilbert curve),"
+	       " morton \n"
+	       "    (Z-order curve).\n");
 	printf("  --valgrind [arg]\n"
 	       "    Run the built-in test suite with Valgrind memory checking."
 	       " Accepts \n"
@@ -366,6 +636,12 @@ static int usage(const struct Options *o, const int retval)
 	       "    Increase level of verbosity. Can be repeated.\n");
 	printf("  --version\n"
 	       "    Print version information.\n");
+	printf("  --weighted\n"
+	       "    Read a weight after every position in the centroid"
+	       " command, as \n"
+	       "    `lat,lon,weight`, or as a third `double` value with"
+	       " --input-format \n"
+	       "    binary.\n");
 	printf("\n");
 
 	return retval;
@@ -385,7 +661,18 @@ static int choose_opt_action(struct Options *dest,
 
 	switch (c) {
 	case 0:
-		if (!strcmp(opts->name, "count")) {
+		if (!strcmp(opts->name, "approx")) {
+			if (!strcmp(optarg, "cheapruler")) {
+				dest->distformula = FRM_CHEAPRULER;
+			} else if (!strcmp(optarg, "equirect")) {
+				dest->distformula = FRM_EQUIRECT;
+			} else if (!strcmp(optarg, "haversine32")) {
+				dest->distformula = FRM_HAVERSINE32;
+			} else {
+				myerror("%s: Unknown approximation", optarg);
+				return 1;
+			}
+		} else if (!strcmp(opts->name, "count")) {
 			char *endptr = NULL;
 			dest->count = strtol(optarg, &endptr, 10);
 			if (errno || endptr == optarg || *endptr
@@ -398,10 +685,105 @@ static int choose_opt_action(struct Options *dest,
 				        optarg);
 				return 1;
 			}
+			dest->has_count = true;
+		} else if (!strcmp(opts->name, "ellipsoid")) {
+			dest->ellipsoid = optarg;
+		} else if (!strcmp(opts->name, "geohash")) {
+			char *endptr = NULL;
+			const long l = strtol(optarg, &endptr, 10);
+
+			if (errno || endptr == optarg || *endptr || l < 1
+			    || l > GEOHASH_MAX_LEN) {
+#if defined(__FreeBSD__)
+				if (endptr == optarg && errno == EINVAL)
+					errno = 0;
+#endif
+				myerror("%s: Invalid --geohash argument, must"
+				        " be 1-%d", optarg, GEOHASH_MAX_LEN);
+				return 1;
+			}
+			dest->geohash = (size_t)l;
+		} else if (!strcmp(opts->name, "inner")) {
+			if (string_to_double(optarg, &dest->inner)
+			    || !isfinite(dest->inner) || dest->inner < 0.0) {
+				myerror("%s: Invalid --inner argument",
+				        optarg);
+				return 1;
+			}
+		} else if (!strcmp(opts->name, "input-format")) {
+			dest->input_format = optarg;
 		} else if (!strcmp(opts->name, "km")) {
 			dest->km = true;
 		} else if (!strcmp(opts->name, "license")) {
 			dest->license = true;
+		} else if (!strcmp(opts->name, "min-separation")) {
+			if (string_to_double(optarg, &dest->min_separation)
+			    || !isfinite(dest->min_separation)
+			    || dest->min_separation < 0.0) {
+				myerror("%s: Invalid --min-separation"
+				        " argument", optarg);
+				return 1;
+			}
+		} else if (!strcmp(opts->name, "nearest")) {
+			dest->nearest = true;
+		} else if (!strcmp(opts->name, "origin")) {
+			char *endptr = NULL;
+			const char *p = optarg;
+
+			dest->origin = true;
+			dest->origin_lat = strtod(p, &endptr);
+			dest->origin_lon = NAN;
+			if (!errno && endptr != p && *endptr == ',') {
+				p = endptr + 1;
+				dest->origin_lon = strtod(p, &endptr);
+				if (endptr == p)
+					dest->origin_lon = NAN;
+			}
+			if (!errno && endptr != p && *endptr == ',') {
+				p = endptr + 1;
+				dest->origin_h = strtod(p, &endptr);
+				if (endptr == p)
+					dest->origin_h = NAN;
+			}
+			if (errno || *endptr
+			    || !(fabs(dest->origin_lat) <= 90.0)
+			    || !(fabs(dest->origin_lon) <= 180.0)
+			    || !isfinite(dest->origin_h)) {
+				myerror("%s: Invalid --origin argument",
+				        optarg);
+				return 1;
+			}
+		} else if (!strcmp(opts->name, "rhumb")) {
+			dest->distformula = FRM_RHUMB;
+		} else if (!strcmp(opts->name, "sector")) {
+			char *endptr = NULL;
+
+			dest->sector = true;
+			dest->sector_from = strtod(optarg, &endptr);
+			if (!errno && endptr != optarg && *endptr == '/') {
+				const char *p = endptr + 1;
+
+				dest->sector_to = strtod(p, &endptr);
+				if (endptr == p)
+					dest->sector_to = NAN;
+			} else {
+				dest->sector_to = NAN;
+			}
+			if (errno || *endptr
+			    || !(dest->sector_from >= 0.0
+			         && dest->sector_from <= 360.0
+			         && dest->sector_to >= 0.0
+			         && dest->sector_to <= 360.0)) {
+				myerror("%s: Invalid --sector argument",
+				        optarg);
+				return 1;
+			}
+			if (fmod(dest->sector_to - dest->sector_from + 360.0,
+			         360.0) == 0.0) {
+				myerror("%s: The --sector bearings cannot be"
+				        " equal", optarg);
+				return 1;
+			}
 		} else if (!strcmp(opts->name, "seed")) {
 			char *endptr = NULL;
 			dest->seed = optarg;
@@ -415,12 +797,46 @@ static int choose_opt_action(struct Options *dest,
 				        dest->seed);
 				return 1;
 			}
+		} else if (!strcmp(opts->name, "shard")) {
+			char *endptr = NULL;
+
+			dest->shard = strtol(optarg, &endptr, 10);
+			if (!errno && endptr != optarg && *endptr == '/') {
+				const char *p = endptr + 1;
+
+				dest->shards = strtol(p, &endptr, 10);
+				if (endptr == p)
+					dest->shards = 0;
+			}
+			if (errno || *endptr || dest->shard < 1
+			    || dest->shards < dest->shard
+			    || (double)dest->shards > FIBGRID_MAX_POINTS) {
+#if defined(__FreeBSD__)
+				if (errno == EINVAL)
+					errno = 0;
+#endif
+				myerror("%s: Invalid --shard argument",
+				        optarg);
+				return 1;
+			}
+		} else if (!strcmp(opts->name, "sort")) {
+			if (!strcmp(optarg, "spatial")
+			    || !strcmp(optarg, "hilbert")) {
+				dest->sort = SO_HILBERT;
+			} else if (!strcmp(optarg, "morton")) {
+				dest->sort = SO_MORTON;
+			} else {
+				myerror("%s: Unknown --sort order", optarg);
+				return 1;
+			}
 		} else if (!strcmp(opts->name, "selftest")) {
 			dest->selftest = true;
 		} else if (!strcmp(opts->name, "valgrind")) {
 			dest->valgrind = dest->selftest = true;
 		} else if (!strcmp(opts->name, "version")) {
 			dest->version = true;
+		} else if (!strcmp(opts->name, "weighted")) {
+			dest->weighted = true;
 		}
 		break;
 	case 'F':
@@ -462,19 +878,40 @@ void init_opt(struct Options *dest)
 
 	dest->count = 1;
 	dest->distformula = FRM_HAVERSINE;
+	dest->ell = WGS84;
+	dest->ellipsoid = NULL;
 	dest->format = NULL;
+	dest->geohash = 0;
+	dest->has_count = false;
 	dest->help = false;
+	dest->inner = 0.0;
+	dest->inpformat = IF_DEFAULT;
+	dest->input_format = NULL;
 	dest->km = false;
 	dest->license = false;
+	dest->min_separation = 0.0;
+	dest->nearest = false;
+	dest->origin = false;
+	dest->origin_h = 0.0;
+	dest->origin_lat = 0.0;
+	dest->origin_lon = 0.0;
 	dest->outpformat = OF_DEFAULT;
+	dest->sector = false;
+	dest->sector_from = 0.0;
+	dest->sector_to = 0.0;
 	dest->seed = NULL;
 	dest->seedval = (long)time(NULL) ^ ((long)getpid() << 16);
 	dest->selftest = false;
+	dest->shard = 0;
+	dest->shards = 0;
+	dest->sort = SO_NONE;
 	dest->testexec = false;
 	dest->testfunc = false;
+	dest->testprop = false;
 	dest->valgrind = false;
 	dest->verbose = 0;
 	dest->version = false;
+	dest->weighted = false;
 }
 
 /*
@@ -508,19 +945,32 @@ static int parse_options(struct Options *dest,
 		int c;
 		int option_index = 0;
 		static const struct option long_options[] = {
+			{"approx", required_argument, NULL, 0},
 			{"count", required_argument, NULL, 0},
+			{"ellipsoid", required_argument, NULL, 0},
 			{"format", required_argument, NULL, 'F'},
+			{"geohash", required_argument, NULL, 0},
 			{"haversine", no_argument, NULL, 'H'},
 			{"help", no_argument, NULL, 'h'},
+			{"inner", required_argument, NULL, 0},
+			{"input-format", required_argument, NULL, 0},
 			{"karney", no_argument, NULL, 'K'},
 			{"km", no_argument, NULL, 0},
 			{"license", no_argument, NULL, 0},
+			{"min-separation", required_argument, NULL, 0},
+			{"nearest", no_argument, NULL, 0},
+			{"origin", required_argument, NULL, 0},
 			{"quiet", no_argument, NULL, 'q'},
+			{"rhumb", no_argument, NULL, 0},
+			{"sector", required_argument, NULL, 0},
 			{"seed", required_argument, NULL, 0},
 			{"selftest", no_argument, NULL, 0},
+			{"shard", required_argument, NULL, 0},
+			{"sort", required_argument, NULL, 0},
 			{"valgrind", no_argument, NULL, 0},
 			{"verbose", no_argument, NULL, 'v'},
 			{"version", no_argument, NULL, 0},
+			{"weighted", no_argument, NULL, 0},
 			{0, 0, 0, 0}
 		};
 
@@ -573,18 +1023,99 @@ static int not_compatible(const char *cmd, const struct Options *o)
 		myerror("%s(): cmd is NULL", __func__); /* gncov */
 		return 1; /* gncov */
 	}
-	if (o->distformula == FRM_KARNEY && strcmp(cmd, "dist")
-	    && strcmp(cmd, "bear")) {
+	if (o->distformula == FRM_KARNEY && strcmp(cmd, "area")
+	    && strcmp(cmd, "bear") && strcmp(cmd, "dist")
+	    && strcmp(cmd, "join") && strcmp(cmd, "simplify")
+	    && strcmp(cmd, "track")) {
 		myerror("-K/--karney is not supported by the %s command", cmd);
 		return 1;
 	}
+	if (approx_error(o->distformula, NULL) > 0.0 && strcmp(cmd, "dist")
+	    && strcmp(cmd, "join")) {
+		myerror("--approx is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->distformula == FRM_RHUMB && strcmp(cmd, "bear")
+	    && strcmp(cmd, "bpos") && strcmp(cmd, "course")
+	    && strcmp(cmd, "dist") && strcmp(cmd, "lpos")
+	    && strcmp(cmd, "track")) {
+		myerror("--rhumb is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->geohash && strcmp(cmd, "course") && strcmp(cmd, "geohash")
+	    && strcmp(cmd, "grid") && strcmp(cmd, "randbox")
+	    && strcmp(cmd, "randpoly") && strcmp(cmd, "randpos")) {
+		myerror("--geohash is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->has_count && !strcmp(cmd, "grid")) {
+		myerror("--count is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->inner > 0.0 && strcmp(cmd, "ring")) {
+		myerror("--inner is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->min_separation > 0.0 && strcmp(cmd, "randbox")
+	    && strcmp(cmd, "randpoly") && strcmp(cmd, "randpos")) {
+		myerror("--min-separation is not supported by the %s command",
+		        cmd);
+		return 1;
+	}
+	if (o->nearest && strcmp(cmd, "join")) {
+		myerror("--nearest is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->origin && strcmp(cmd, "convert")) {
+		myerror("--origin is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->weighted && strcmp(cmd, "centroid")) {
+		myerror("--weighted is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->sector && strcmp(cmd, "ring")) {
+		myerror("--sector is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->shard && strcmp(cmd, "grid")) {
+		myerror("--shard is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->sort && strcmp(cmd, "randbox") && strcmp(cmd, "randpoly")
+	    && strcmp(cmd, "randpos") && strcmp(cmd, "sort")) {
+		myerror("--sort is not supported by the %s command", cmd);
+		return 1;
+	}
+	if (o->outpformat == OF_GEOJSON && strcmp(cmd, "ring")) {
+		myerror("GeoJSON output is not supported by the %s command",
+		        cmd);
+		return 1;
+	}
+	if ((o->outpformat == OF_MGRS || o->outpformat == OF_UTM)
+	    && strcmp(cmd, "anti") && strcmp(cmd, "bpos")
+	    && strcmp(cmd, "course") && strcmp(cmd, "grid")
+	    && strcmp(cmd, "lpos") && strcmp(cmd, "randbox")
+	    && strcmp(cmd, "randpoly") && strcmp(cmd, "randpos")) {
+		myerror("%s output is not supported by the %s command",
+		        o->outpformat == OF_MGRS ? "MGRS" : "UTM", cmd);
+		return 1;
+	}
 	if (o->outpformat == OF_GPX) {
-		if (!strcmp(cmd, "bear") || !strcmp(cmd, "bench")
-		    || !strcmp(cmd, "dist")) {
+		if (!strcmp(cmd, "area") || !strcmp(cmd, "bear")
+		    || !strcmp(cmd, "bench") || !strcmp(cmd, "convert")
+		    || !strcmp(cmd, "dist")
+		    || !strcmp(cmd, "fence") || !strcmp(cmd, "geohash")
+		    || !strcmp(cmd, "sort") || !strcmp(cmd, "track")
+		    || !strcmp(cmd, "xtrack")) {
 			myerror("GPX output is not supported by the %s"
 			        " command", cmd);
 			return 1;
 		}
+		if (o->geohash) {
+			myerror("--geohash is not supported with GPX output");
+			return 1;
+		}
 	}
 
 	return 0;
@@ -612,6 +1143,20 @@ static int process_args(const struct Options *o, int argc, char *argv[])
 		if (wrong_argcount(2, numargs))
 			return EXIT_FAILURE;
 		retval = cmd_anti(o, argv[optind + 1]);
+	} else if (!strcmp(cmd, "area")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 1:
+			retval = cmd_area(o, NULL);
+			break;
+		case 2:
+			retval = cmd_area(o, argv[optind + 1]);
+			break;
+		default:
+			wrong_argcount(2, numargs);
+			return EXIT_FAILURE;
+		}
 	} else if (!strcmp(cmd, "bear") || !strcmp(cmd, "dist")) {
 		if (not_compatible(cmd, o))
 			return EXIT_FAILURE;
@@ -640,6 +1185,54 @@ static int process_args(const struct Options *o, int argc, char *argv[])
 			return EXIT_FAILURE;
 		retval = cmd_bpos(o, argv[optind + 1], argv[optind + 2],
 		                  argv[optind + 3]);
+	} else if (!strcmp(cmd, "centroid")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 1:
+			retval = cmd_centroid(o, NULL);
+			break;
+		case 2:
+			retval = cmd_centroid(o, argv[optind + 1]);
+			break;
+		default:
+			wrong_argcount(2, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "cluster")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 3:
+			retval = cmd_cluster(o, argv[optind + 1],
+			                     argv[optind + 2], NULL);
+			break;
+		case 4:
+			retval = cmd_cluster(o, argv[optind + 1],
+			                     argv[optind + 2],
+			                     argv[optind + 3]);
+			break;
+		default:
+			wrong_argcount(numargs < 3 ? 3 : 4, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "convert")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 3:
+			retval = cmd_convert(o, argv[optind + 1],
+			                     argv[optind + 2], NULL);
+			break;
+		case 4:
+			retval = cmd_convert(o, argv[optind + 1],
+			                     argv[optind + 2],
+			                     argv[optind + 3]);
+			break;
+		default:
+			wrong_argcount(numargs < 3 ? 3 : 4, numargs);
+			return EXIT_FAILURE;
+		}
 	} else if (!strcmp(cmd, "course")) {
 		if (not_compatible(cmd, o))
 			return EXIT_FAILURE;
@@ -647,6 +1240,98 @@ static int process_args(const struct Options *o, int argc, char *argv[])
 			return EXIT_FAILURE;
 		retval = cmd_course(o, argv[optind + 1], argv[optind + 2],
 		                    argv[optind + 3]);
+	} else if (!strcmp(cmd, "cpa")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		if (wrong_argcount(7, numargs))
+			return EXIT_FAILURE;
+		retval = cmd_cpa(o, argv[optind + 1], argv[optind + 2],
+		                 argv[optind + 3], argv[optind + 4],
+		                 argv[optind + 5], argv[optind + 6]);
+	} else if (!strcmp(cmd, "fence")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 2:
+			retval = cmd_fence(o, argv[optind + 1], NULL);
+			break;
+		case 3:
+			retval = cmd_fence(o, argv[optind + 1],
+			                   argv[optind + 2]);
+			break;
+		default:
+			wrong_argcount(numargs < 2 ? 2 : 3, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "geohash")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 1:
+			retval = cmd_geohash(o, NULL);
+			break;
+		case 2:
+			retval = cmd_geohash(o, argv[optind + 1]);
+			break;
+		default:
+			wrong_argcount(2, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "grid")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 2:
+			retval = cmd_grid(o, argv[optind + 1]);
+			break;
+		case 4:
+			retval = cmd_grid_cap(o, argv[optind + 1],
+			                      argv[optind + 2],
+			                      argv[optind + 3]);
+			break;
+		default:
+			wrong_argcount(numargs < 3 ? 2 : 4, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "intersect")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 3:
+			retval = cmd_intersect_file(o, argv[optind + 1],
+			                            argv[optind + 2], NULL);
+			break;
+		case 4:
+			retval = cmd_intersect_file(o, argv[optind + 1],
+			                            argv[optind + 2],
+			                            argv[optind + 3]);
+			break;
+		case 5:
+			retval = cmd_intersect(o, argv[optind + 1],
+			                       argv[optind + 2],
+			                       argv[optind + 3],
+			                       argv[optind + 4]);
+			break;
+		default:
+			wrong_argcount(numargs < 3 ? 3 : 5, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "join")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 3:
+			retval = cmd_join(o, argv[optind + 1],
+			                  argv[optind + 2], NULL);
+			break;
+		case 4:
+			retval = cmd_join(o, argv[optind + 1],
+			                  argv[optind + 2], argv[optind + 3]);
+			break;
+		default:
+			wrong_argcount(numargs < 3 ? 3 : 4, numargs);
+			return EXIT_FAILURE;
+		}
 	} else if (!strcmp(cmd, "lpos")) {
 		if (not_compatible(cmd, o))
 			return EXIT_FAILURE;
@@ -654,6 +1339,26 @@ static int process_args(const struct Options *o, int argc, char *argv[])
 			return EXIT_FAILURE;
 		retval = cmd_lpos(o, argv[optind + 1], argv[optind + 2],
 		                  argv[optind + 3]);
+	} else if (!strcmp(cmd, "randbox")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		if (wrong_argcount(3, numargs))
+			return EXIT_FAILURE;
+		retval = cmd_randbox(o, argv[optind + 1], argv[optind + 2]);
+	} else if (!strcmp(cmd, "randpoly")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 1:
+			retval = cmd_randpoly(o, NULL);
+			break;
+		case 2:
+			retval = cmd_randpoly(o, argv[optind + 1]);
+			break;
+		default:
+			wrong_argcount(2, numargs);
+			return EXIT_FAILURE;
+		}
 	} else if (!strcmp(cmd, "randpos")) {
 		if (not_compatible(cmd, o))
 			return EXIT_FAILURE;
@@ -677,6 +1382,80 @@ static int process_args(const struct Options *o, int argc, char *argv[])
 			wrong_argcount(4, numargs);
 			return EXIT_FAILURE;
 		}
+	} else if (!strcmp(cmd, "ring")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 3:
+			retval = cmd_ring(o, argv[optind + 1],
+			                  argv[optind + 2], NULL);
+			break;
+		case 4:
+			retval = cmd_ring(o, argv[optind + 1],
+			                  argv[optind + 2], argv[optind + 3]);
+			break;
+		default:
+			wrong_argcount(numargs < 3 ? 3 : 4, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "simplify")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 2:
+			retval = cmd_simplify(o, argv[optind + 1], NULL);
+			break;
+		case 3:
+			retval = cmd_simplify(o, argv[optind + 1],
+			                      argv[optind + 2]);
+			break;
+		default:
+			wrong_argcount(numargs < 2 ? 2 : 3, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "sort")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 1:
+			retval = cmd_sort(o, NULL);
+			break;
+		case 2:
+			retval = cmd_sort(o, argv[optind + 1]);
+			break;
+		default:
+			wrong_argcount(2, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "track")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 1:
+			retval = cmd_track(o, NULL);
+			break;
+		case 2:
+			retval = cmd_track(o, argv[optind + 1]);
+			break;
+		default:
+			wrong_argcount(2, numargs);
+			return EXIT_FAILURE;
+		}
+	} else if (!strcmp(cmd, "xtrack")) {
+		if (not_compatible(cmd, o))
+			return EXIT_FAILURE;
+		switch (numargs) {
+		case 2:
+			retval = cmd_xtrack(o, argv[optind + 1], NULL);
+			break;
+		case 3:
+			retval = cmd_xtrack(o, argv[optind + 1],
+			                    argv[optind + 2]);
+			break;
+		default:
+			wrong_argcount(numargs < 2 ? 2 : 3, numargs);
+			return EXIT_FAILURE;
+		}
 	} else {
 		myerror("Unknown command: %s", cmd);
 		retval = EXIT_FAILURE;
@@ -685,13 +1464,61 @@ static int process_args(const struct Options *o, int argc, char *argv[])
 	return retval;
 }
 
+/*
+ * parse_ellipsoid() - Stores the ellipsoid model specified in `s` in `dest`. 
+ * `s` is the name of a built-in model, or the semi-major axis in meters and 
+ * the inverse flattening separated by a comma. An inverse flattening of 0 
+ * gives a sphere. An empty string or "default" selects WGS84. Returns 0 if 
+ * ok, or 1 if `s` is invalid.
+ */
+
+static int parse_ellipsoid(struct ellipsoid *dest, const char *s)
+{
+	char *endptr = NULL;
+	const char *p;
+	double a, invf;
+
+	assert(dest);
+	assert(s);
+
+	if (!*s || !strcmp(s, "default")) {
+		*dest = WGS84;
+		return 0;
+	}
+	if (!strchr(s, ',')) {
+		if (ellipsoid_by_name(dest, s)) {
+			myerror("%s: Unknown ellipsoid", s);
+			return 1;
+		}
+		return 0;
+	}
+	a = strtod(s, &endptr);
+	if (errno || endptr == s || *endptr != ',')
+		goto invalid;
+	p = endptr + 1;
+	invf = strtod(p, &endptr);
+	if (errno || endptr == p || *endptr || !isfinite(invf)
+	    || (invf != 0.0 && invf <= 1.0)
+	    || ellipsoid_init(dest, a, invf != 0.0 ? 1.0 / invf : 0.0))
+		goto invalid;
+
+	return 0;
+
+invalid:
+	myerror("%s: Invalid --ellipsoid argument", s);
+	return 1;
+}
+
 /*
  * setup_options() - Makes necessary changes to `o` based on the user input.
  *
  * - Sets `o->outpformat` to the corresponding integer value of the -F/--format 
  *   argument.
- * - Parses the optional argument to --selftest and set `o->testexec` and 
- *   `o->testfunc`.
+ * - Sets `o->inpformat` to the corresponding integer value of the 
+ *   --input-format argument.
+ * - Sets `o->ell` to the ellipsoid model in the --ellipsoid argument.
+ * - Parses the optional argument to --selftest and set `o->testexec`, 
+ *   `o->testfunc` and `o->testprop`.
  *
  * Returns 0 if everything is ok, otherwise it returns 1.
  */
@@ -705,15 +1532,40 @@ static int setup_options(struct Options *o, const int argc, char *argv[])
 		msg(4, "%s(): o.format = \"%s\"", __func__, o->format);
 		if (!*o->format || !strcmp(o->format, "default")) {
 			o->outpformat = OF_DEFAULT;
+		} else if (!strcmp(o->format, "geojson")) {
+			o->outpformat = OF_GEOJSON;
 		} else if (!strcmp(o->format, "gpx")) {
 			o->outpformat = OF_GPX;
+		} else if (!strcmp(o->format, "mgrs")) {
+			o->outpformat = OF_MGRS;
 		} else if (!strcmp(o->format, "sql")) {
 			o->outpformat = OF_SQL;
+		} else if (!strcmp(o->format, "utm")) {
+			o->outpformat = OF_UTM;
 		} else {
 			myerror("%s: Unknown output format", o->format);
 			return 1;
 		}
 	}
+	if (o->input_format) {
+		msg(4, "%s(): o.input_format = \"%s\"",
+		       __func__, o->input_format);
+		if (!*o->input_format || !strcmp(o->input_format, "default")) {
+			o->inpformat = IF_DEFAULT;
+		} else if (!strcmp(o->input_format, "binary")) {
+			o->inpformat = IF_BINARY;
+		} else if (!strcmp(o->input_format, "gpx")) {
+			o->inpformat = IF_GPX;
+		} else {
+			myerror("%s: Unknown input format", o->input_format);
+			return 1;
+		}
+	}
+	if (o->ellipsoid) {
+		msg(4, "%s(): o.ellipsoid = \"%s\"", __func__, o->ellipsoid);
+		if (parse_ellipsoid(&o->ell, o->ellipsoid))
+			return 1;
+	}
 	if (o->selftest) {
 		if (optind < argc) {
 			const char *s = argv[optind];
@@ -728,6 +1580,8 @@ static int setup_options(struct Options *o, const int argc, char *argv[])
 				o->testexec = true; /* gncov */
 			if (strstr(s, "func"))
 				o->testfunc = true; /* gncov */
+			if (strstr(s, "prop"))
+				o->testprop = true;
 		} else {
 			o->testexec = o->testfunc = true;
 		}
@@ -737,10 +1591,12 @@ static int setup_options(struct Options *o, const int argc, char *argv[])
 }
 
 /*
- * main()
+ * run_program() - Parses the command line options and arguments in `argv` and 
+ * executes the requested action. Used by main() and call_main(). Returns the 
+ * exit value of the program.
  */
 
-int main(int argc, char *argv[])
+static int run_program(int argc, char *argv[])
 {
 	int retval = EXIT_SUCCESS, t;
 
@@ -784,4 +1640,48 @@ int main(int argc, char *argv[])
 	return retval;
 }
 
+/*
+ * call_main() - Executes the program in-process with the arguments in `argv`, 
+ * as if it was started from the command line. The global state (`opt`, 
+ * `progname` and the getopt_long() state) is saved and restored, so it can be 
+ * called repeatedly. Used by streams_call() to run most of the executable 
+ * tests without starting a new process every time. Returns the exit value of 
+ * the program.
+ */
+
+int call_main(int argc, char *argv[])
+{
+	const struct Options saved_opt = opt;
+	char *saved_progname = progname;
+	const int saved_optind = optind;
+	int retval;
+
+	assert(argv);
+	assert(argv[0]);
+
+#if defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) \
+    || defined(__DragonFly__) || defined(__APPLE__)
+	optreset = 1;
+	optind = 1;
+#else
+	optind = 0; /* Makes getopt_long() reinitialize itself */
+#endif
+	retval = run_program(argc, argv);
+
+	opt = saved_opt;
+	progname = saved_progname;
+	optind = saved_optind;
+
+	return retval;
+}
+
+/*
+ * main()
+ */
+
+int main(int argc, char *argv[])
+{
+	return run_program(argc, argv);
+}
+
 /* vim: set ts=8 sw=8 sts=8 noet fo+=w tw=79 fenc=UTF-8 : */
@@ -48,6 +48,14 @@
 #define PROJ_URL  "https://gitlab.com/oyvholm/geocalc"
 
 #define BENCH_LOOP_SECS  2
+#define CONVERT_BATCH  1024
+#define INTERSECT_BATCH  1024
+#define JOIN_MARGIN  1.01
+#define SIMPLIFY_WINDOW  16384
+#define RING_MAX_VERTICES  1000000
+#define SORT_CHUNK  1048576
+#define TRACK_BATCH  1024
+#define XTRACK_BATCH  1024
 
 #if 1
 #  define DEBL  msg(2, "DEBL: %s, line %u in %s()", \
@@ -88,27 +96,78 @@
 
 typedef enum {
 	OF_DEFAULT = 0,
+	OF_GEOJSON,
 	OF_GPX,
-	OF_SQL
+	OF_MGRS,
+	OF_SQL,
+	OF_UTM
 } OutputFormat;
 
+typedef enum {
+	IF_DEFAULT = 0,
+	IF_BINARY,
+	IF_GPX
+} InputFormat;
+
+typedef enum {
+	SO_NONE = 0,
+	SO_HILBERT,
+	SO_MORTON
+} SortOrder;
+
+typedef enum {
+	CS_GEODETIC = 0,
+	CS_ECEF,
+	CS_ENU,
+	CS_MGRS,
+	CS_UTM
+} CoorSystem;
+
+typedef enum {
+	PS_POINT = 0,
+	PS_BREAK,
+	PS_EOF,
+	PS_ERROR
+} PointStatus;
+
 struct Options {
 	/* sort -d -k2 */
 	long count;
 	DistFormula distformula;
+	char *ellipsoid;
+	struct ellipsoid ell;
 	char *format;
+	size_t geohash;
+	bool has_count;
 	bool help;
+	double inner;
+	InputFormat inpformat;
+	char *input_format;
 	bool km;
 	bool license;
+	double min_separation;
+	bool nearest;
+	bool origin;
+	double origin_h;
+	double origin_lat;
+	double origin_lon;
 	OutputFormat outpformat;
+	bool sector;
+	double sector_from;
+	double sector_to;
 	char *seed;
 	long seedval;
 	bool selftest;
+	long shard;
+	long shards;
+	SortOrder sort;
 	bool testexec;
 	bool testfunc;
+	bool testprop;
 	bool valgrind;
 	int verbose;
 	bool version;
+	bool weighted;
 };
 
 struct streams {
@@ -118,6 +177,40 @@ struct streams {
 	int ret;
 };
 
+struct pointreader {
+	FILE *fp;
+	const char *name;
+	InputFormat format;
+	char *line;
+	size_t linesize;
+	unsigned long recnum;
+	struct gpxreader gpx;
+	double ele;
+	double time;
+	bool weighted;
+	double weight;
+};
+
+struct sortrec {
+	uint64_t key;
+	double lat;
+	double lon;
+	unsigned long num;
+};
+
+struct possort {
+	SortOrder order;
+	struct sortrec *buf;
+	size_t chunk;
+	size_t n;
+	size_t pos;
+	FILE **runs;
+	size_t numruns;
+	struct sortrec *heads;
+	size_t *heap;
+	size_t heapsize;
+};
+
 struct bench_result {
 	const char *name;
 	struct timespec start;
@@ -144,6 +237,7 @@ const char *std_strerror(const int errnum);
 int myerror(const char *format, ...);
 void init_opt(struct Options *dest);
 void set_opt_valgrind(bool b);
+int call_main(int argc, char *argv[]);
 
 /* cmds.c */
 void round_number(double *dest, const int decimals);
@@ -158,18 +252,70 @@ int cmd_lpos(const struct Options *o, const char *coor1, const char *coor2,
              const char *fracdist_s);
 int cmd_randpos(const struct Options *o, const char *coor,
                 const char *maxdist, const char *mindist);
+int cmd_track(const struct Options *o, const char *fname);
+int cmd_simplify(const struct Options *o, const char *tolerance_s,
+                 const char *fname);
+int cmd_xtrack(const struct Options *o, const char *route,
+               const char *fname);
+int cmd_fence(const struct Options *o, const char *fences,
+              const char *fname);
+int cmd_geohash(const struct Options *o, const char *fname);
+int cmd_sort(const struct Options *o, const char *fname);
+int cmd_join(const struct Options *o, const char *points,
+             const char *maxdist_s, const char *fname);
+int cmd_cluster(const struct Options *o, const char *eps_s,
+                const char *minpts_s, const char *fname);
+int cmd_centroid(const struct Options *o, const char *fname);
+int cmd_intersect(const struct Options *o, const char *coor1,
+                  const char *coor2, const char *coor3, const char *coor4);
+int cmd_intersect_file(const struct Options *o, const char *coor1,
+                       const char *coor2, const char *fname);
+int cmd_cpa(const struct Options *o,
+            const char *coor1, const char *bear1_s, const char *speed1_s,
+            const char *coor2, const char *bear2_s, const char *speed2_s);
+int cmd_area(const struct Options *o, const char *fname);
+int cmd_grid(const struct Options *o, const char *num_s);
+int cmd_grid_cap(const struct Options *o, const char *coor,
+                 const char *maxdist_s, const char *spacing_s);
+int cmd_randbox(const struct Options *o, const char *coor1,
+                const char *coor2);
+int cmd_randpoly(const struct Options *o, const char *fname);
+int cmd_ring(const struct Options *o, const char *radius_s,
+             const char *vertices_s, const char *fname);
+int cmd_convert(const struct Options *o, const char *from_s,
+                const char *to_s, const char *fname);
 int cmd_bench(const struct Options *o, const char *seconds);
 
 /* gpx.c */
 char *xml_escape_string(const char *text);
 char *gpx_wpt(const double lat, const double lon,
               const char *name, const char *cmt);
+int gpx_open(struct gpxreader *dest, FILE *fp, const char *name,
+             const unsigned long linenum);
+void gpx_close(struct gpxreader *g);
+PointStatus gpx_next(struct gpxreader *g, double *lat, double *lon,
+                     double *ele, double *time);
 
 /* io.c */
 void streams_init(struct streams *dest);
 void streams_free(struct streams *dest);
 char *read_from_fp(FILE *fp, struct binbuf *dest);
+int pointreader_open(struct pointreader *dest, const char *fname,
+                     const InputFormat format);
+void pointreader_close(struct pointreader *pr);
+PointStatus pointreader_next(struct pointreader *pr, double *lat, double *lon);
+PointStatus pointreader_next_xyz(struct pointreader *pr, double *dest,
+                                 const bool geodetic);
+int possort_init(struct possort *dest, const SortOrder order,
+                 const size_t chunk);
+int possort_add(struct possort *ps, const double lat, const double lon,
+                const unsigned long num);
+int possort_finish(struct possort *ps);
+PointStatus possort_next(struct possort *ps, double *lat, double *lon,
+                         unsigned long *num);
+void possort_free(struct possort *ps);
 int streams_exec(const struct Options *o, struct streams *dest, char *cmd[]);
+int streams_call(const struct Options *o, struct streams *dest, char *cmd[]);
 int exec_output(const struct Options *o, struct binbuf *dest, char *cmd[]);
 
 /* selftest.c */
@@ -183,8 +329,11 @@ char *allocstr_va(const char *format, va_list ap);
 char *allocstr(const char *format, ...);
 size_t count_substr(const char *s, const char *substr);
 char *str_replace(const char *s, const char *s1, const char *s2);
+int scan_coordinate(const char *s, double *dest_lat, double *dest_lon,
+                    const char **endptr);
 int parse_coordinate(const char *s, bool validate,
                      double *dest_lat, double *dest_lon);
+int parse_datetime(const char *s, double *dest);
 
 #endif /* ifndef _GEOCALC_H */
 
@@ -23,6 +23,27 @@
 const double EARTH_RADIUS = 6371000; /* Meters */
 const double MAX_EARTH_DISTANCE = 20015086.79602057114243507385; /* Meters */
 
+/*
+ * ELLIPSOID() - Expands to the initializer of a `struct ellipsoid` with the 
+ * semi-major axis `a` in meters and the flattening `f`, so the derived 
+ * constants of the built-in models are calculated at compile time.
+ */
+
+#define ELLIPSOID(a, f)  { (a), (f), (a) * (1.0 - (f)), (f) * (2.0 - (f)), \
+                           (f) * (2.0 - (f)) / ((1.0 - (f)) * (1.0 - (f))) }
+
+const struct ellipsoid WGS84 = ELLIPSOID(6378137.0, 1.0 / 298.257223563);
+
+static const struct {
+	const char *name;
+	struct ellipsoid ell;
+} ellipsoids[] = {
+	{ "authalic", ELLIPSOID(6371007.180918474, 0.0) },
+	{ "clarke1866", ELLIPSOID(6378206.4, 1.0 / 294.978698214) },
+	{ "grs80", ELLIPSOID(6378137.0, 1.0 / 298.257222101) },
+	{ "wgs84", ELLIPSOID(6378137.0, 1.0 / 298.257223563) },
+};
+
 static const double DEG_TO_RAD = M_PI / 180.0;
 static const double RAD_TO_DEG = 180.0 / M_PI;
 #define deg2rad(a)  ((a) * DEG_TO_RAD)
@@ -96,6 +117,86 @@ void set_antipode(double *dlat, double *dlon)
 	}
 }
 
+/*
+ * origin_init() - Prepares `dest` for positions calculated from `lat,lon` 
+ * with origin_position(), so the sine and cosine of the latitude are only 
+ * calculated once. For exact pole positions (lat = ±90°), the latitude is 
+ * adjusted by ≈1 cm to avoid computational instability. Returns nothing.
+ */
+
+void origin_init(struct origin *dest, const double lat, const double lon)
+{
+	double lat_a = lat;
+
+	assert(dest);
+
+	if (fabs(lat_a) == 90.0)
+		lat_a *= 1.0 - 1e-9;
+	dest->lat = deg2rad(lat_a);
+	dest->lon = deg2rad(lon);
+	dest->sin_lat = sin(dest->lat);
+	dest->cos_lat = cos(dest->lat);
+}
+
+/*
+ * origin_position() - Calculates the position after moving from the origin 
+ * `org` along a great circle with the bearing and the angular distance given 
+ * by their sines and cosines, and stores it in `new_lat` and `new_lon`. 
+ * Returns nothing.
+ */
+
+void origin_position(const struct origin *org, const double sin_bear,
+                     const double cos_bear, const double sin_dist,
+                     const double cos_dist, double *new_lat,
+                     double *new_lon)
+{
+	/*
+	 * Rounding errors can make the value slightly outside [-1, 1] when the 
+	 * destination is one of the poles, so clamp it to avoid NaN from 
+	 * asin().
+	 */
+	const double sin_lat2 = fmax(-1.0, fmin(1.0, org->sin_lat * cos_dist
+	                                             + org->cos_lat * sin_dist
+	                                               * cos_bear));
+	const double lat2_rad = asin(sin_lat2);
+	const double lon2_rad = org->lon
+	                        + atan2(sin_bear * sin_dist * org->cos_lat,
+	                                cos_dist
+	                                - org->sin_lat * sin(lat2_rad));
+
+	assert(new_lat);
+	assert(new_lon);
+
+	*new_lat = rad2deg(lat2_rad);
+	*new_lon = rad2deg(lon2_rad);
+	normalize_longitude(new_lon);
+}
+
+/*
+ * origin_positions() - Calculates the `n` positions at the angular distance 
+ * `dist` from the origin `org`, with the bearings given by their sines and 
+ * cosines in `sin_bear` and `cos_bear`, and stores them in `new_lat` and 
+ * `new_lon`. The bearings are usually calculated once and used for many 
+ * origins. Returns nothing.
+ */
+
+void origin_positions(const struct origin *org, const double *sin_bear,
+                      const double *cos_bear, const size_t n,
+                      const double dist, double *new_lat, double *new_lon)
+{
+	const double sin_dist = sin(dist), cos_dist = cos(dist);
+	size_t i;
+
+	assert(org);
+	assert(sin_bear);
+	assert(cos_bear);
+
+	for (i = 0; i < n; i++) {
+		origin_position(org, sin_bear[i], cos_bear[i], sin_dist,
+		                cos_dist, &new_lat[i], &new_lon[i]);
+	}
+}
+
 /*
  * bearing_position() - Calculates the new geographic position after moving 
  * `dist_m` meters from the position `lat,lon` in the direction `bearing_deg` 
@@ -116,7 +217,9 @@ int bearing_position(const double lat, const double lon,
                      const double bearing_deg, const double dist_m,
                      double *new_lat, double *new_lon)
 {
-	double lat_a = lat;
+	struct origin org;
+	const double bearing_rad = deg2rad(bearing_deg);
+	const double ang_dist = dist_m / EARTH_RADIUS;
 
 	assert(new_lat);
 	assert(new_lon);
@@ -126,34 +229,36 @@ int bearing_position(const double lat, const double lon,
 		return 1;
 	}
 
-	if (fabs(lat_a) == 90.0)
-		lat_a *= 1.0 - 1e-9;
+	origin_init(&org, lat, lon);
+	origin_position(&org, sin(bearing_rad), cos(bearing_rad),
+	                sin(ang_dist), cos(ang_dist), new_lat, new_lon);
 
-	const double lat_rad = deg2rad(lat_a);
-	const double lon_rad = deg2rad(lon);
-	const double bearing_rad = deg2rad(bearing_deg);
-	const double ang_dist = dist_m / EARTH_RADIUS;
+	return 0;
+}
 
-	const double sin_lat = sin(lat_rad);
-	const double cos_lat = cos(lat_rad);
-	const double sin_ang_dist = sin(ang_dist);
-	const double cos_ang_dist = cos(ang_dist);
+/*
+ * haversine_arc() - Returns the central angle in radians between `lat1, lon1` 
+ * and `lat2, lon2`, calculated with the Haversine formula. `cos_lat1` and 
+ * `cos_lat2` are the cosines of the latitudes, they're arguments so 
+ * distance_batch() only has to calculate them once for every position. 
+ * Returns NaN if the positions are antipodal.
+ */
 
-	const double lat2_rad = asin(sin_lat * cos_ang_dist
-	                             + cos_lat * sin_ang_dist
-	                               * cos(bearing_rad));
+static double haversine_arc(const double lat1, const double lon1,
+                            const double lat2, const double lon2,
+                            const double cos_lat1, const double cos_lat2)
+{
+	const double delta_phi = deg2rad(lat2 - lat1);
+	const double delta_lambda = deg2rad(lon2 - lon1);
 
-	const double lon2_rad = lon_rad
-	                        + atan2(sin(bearing_rad) * sin_ang_dist
-	                                * cos_lat,
-	                                cos_ang_dist
-	                                - sin_lat * sin(lat2_rad));
+	const double sin_delta_phi = sin(delta_phi / 2.0);
+	const double sin_delta_lambda = sin(delta_lambda / 2.0);
 
-	*new_lat = rad2deg(lat2_rad);
-	*new_lon = rad2deg(lon2_rad);
-	normalize_longitude(new_lon);
+	const double hav = sin_delta_phi * sin_delta_phi
+	                   + cos_lat1 * cos_lat2
+	                   * sin_delta_lambda * sin_delta_lambda;
 
-	return 0;
+	return 2.0 * atan2(sqrt(hav), sqrt(1.0 - hav));
 }
 
 /*
@@ -178,19 +283,9 @@ double haversine(const double lat1, const double lon1,
 	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
 		return -1.0;
 
-	const double lat1_rad = deg2rad(lat1);
-	const double lat2_rad = deg2rad(lat2);
-	const double delta_phi = deg2rad(lat2 - lat1);
-	const double delta_lambda = deg2rad(lon2 - lon1);
-
-	const double sin_delta_phi = sin(delta_phi / 2.0);
-	const double sin_delta_lambda = sin(delta_lambda / 2.0);
-
-	const double hav = sin_delta_phi * sin_delta_phi
-	                   + cos(lat1_rad) * cos(lat2_rad)
-	                   * sin_delta_lambda * sin_delta_lambda;
-
-	const double arc = 2.0 * atan2(sqrt(hav), sqrt(1.0 - hav));
+	const double arc = haversine_arc(lat1, lon1, lat2, lon2,
+	                                 cos(deg2rad(lat1)),
+	                                 cos(deg2rad(lat2)));
 	if (isnan(arc)) {
 		/* Antipodal positions */
 		errno = 0;
@@ -201,29 +296,94 @@ double haversine(const double lat1, const double lon1,
 }
 
 /*
- * karney_distance() - Calculates the distance between 2 locations, using the 
- * Karney formula. This formula models the Earth as an ellipsoid and provides 
- * significantly higher accuracy than the default Haversine formula, which 
- * assumes a spherical Earth. It achieves an accuracy of 10-15 nanometers for 
- * distance calculations, making it suitable for high-precision applications.
- * Returns the distance in meters.
+ * ellipsoid_init() - Stores the ellipsoid with the semi-major axis `a` meters 
+ * and the flattening `f` in `dest`, together with the constants derived from 
+ * them, so the functions that use the model don't have to calculate them for 
+ * every position. A flattening of 0 gives a sphere with the radius `a`. 
+ * Returns 1 if `a` isn't a positive finite number or `f` is outside the range 
+ * [0, 1), otherwise 0.
  */
 
-double karney_distance(const double lat1, const double lon1,
-                       const double lat2, const double lon2)
+int ellipsoid_init(struct ellipsoid *dest, const double a, const double f)
+{
+	assert(dest);
+
+	if (!isfinite(a) || a <= 0.0 || !(f >= 0.0 && f < 1.0))
+		return 1;
+	dest->a = a;
+	dest->f = f;
+	dest->b = a * (1.0 - f);
+	dest->e2 = f * (2.0 - f);
+	dest->ep2 = dest->e2 / ((1.0 - f) * (1.0 - f));
+
+	return 0;
+}
+
+/*
+ * ellipsoid_by_name() - Stores the built-in ellipsoid model `name` in `dest`. 
+ * The names are "authalic" (a sphere with the same area as WGS84), 
+ * "clarke1866", "grs80" and "wgs84". Returns 1 if the name is unknown, 
+ * otherwise 0.
+ */
+
+int ellipsoid_by_name(struct ellipsoid *dest, const char *name)
+{
+	size_t i;
+
+	assert(dest);
+	assert(name);
+
+	for (i = 0; i < sizeof(ellipsoids) / sizeof(ellipsoids[0]); i++) {
+		if (!strcmp(name, ellipsoids[i].name)) {
+			*dest = ellipsoids[i].ell;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * reduced_lat() - Stores the sine and cosine of the reduced latitude of the 
+ * latitude `lat_rad` on the ellipsoid `ell` in `sin_u` and `cos_u`. Returns 
+ * nothing.
+ */
+
+static void reduced_lat(const struct ellipsoid *ell, const double lat_rad,
+                        double *sin_u, double *cos_u)
+{
+	const double u = atan((1.0 - ell->f) * tan(lat_rad));
+
+	*sin_u = sin(u);
+	*cos_u = cos(u);
+}
+
+/*
+ * geod_distance() - Calculates the distance between 2 locations on the 
+ * ellipsoid `ell`, using the Karney formula. This formula models the Earth as 
+ * an ellipsoid and provides significantly higher accuracy than the default 
+ * Haversine formula, which assumes a spherical Earth. It achieves an accuracy 
+ * of 10-15 nanometers for distance calculations, making it suitable for 
+ * high-precision applications. Returns the distance in meters, or -1.0 if 
+ * the coordinates are out of range.
+ */
+
+double geod_distance(const struct ellipsoid *ell,
+                     const double lat1, const double lon1,
+                     const double lat2, const double lon2)
 {
+	assert(ell);
+
 	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0
 	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
 		return -1.0;
 
-	const double a = 6378137.0;
-	const double f = 1.0 / 298.257223563;
-	const double b = (a * (1.0 - f));
+	const double f = ell->f;
 	const double L = deg2rad(lon2) - deg2rad(lon1);
-	const double U1 = atan((1.0 - f) * tan(deg2rad(lat1)));
-	const double U2 = atan((1.0 - f) * tan(deg2rad(lat2)));
-	const double sinU1 = sin(U1), cosU1 = cos(U1);
-	const double sinU2 = sin(U2), cosU2 = cos(U2);
+	double sinU1, cosU1, sinU2, cosU2;
+
+	reduced_lat(ell, deg2rad(lat1), &sinU1, &cosU1);
+	reduced_lat(ell, deg2rad(lat2), &sinU2, &cosU2);
 
 	double lambda = L, lambdaP;
 	double sin_lambda, cos_lambda, sin_sigma, cos_sigma, sigma, sin_alpha,
@@ -267,7 +427,7 @@ double karney_distance(const double lat1, const double lon1,
 	if (iter_limit == 0)
 		return nan(""); /* The formula did not converge */
 
-	const double u_sq = cos_sq_alpha * (a * a - b * b) / (b * b);
+	const double u_sq = cos_sq_alpha * ell->ep2;
 	const double A = 1.0 + u_sq / 16384.0
 	                       * (4096.0
 	                          + u_sq * (-768.0 + u_sq * (320.0
@@ -288,12 +448,23 @@ double karney_distance(const double lat1, const double lon1,
 	                                                + 4.0 * cos2_sigma_m
 	                                                  * cos2_sigma_m)));
 
-	return b * A * (sigma - delta_sigma);
+	return ell->b * A * (sigma - delta_sigma);
+}
+
+/*
+ * karney_distance() - Returns the distance in meters between 2 locations on 
+ * the WGS84 ellipsoid, calculated with geod_distance().
+ */
+
+double karney_distance(const double lat1, const double lon1,
+                       const double lat2, const double lon2)
+{
+	return geod_distance(&WGS84, lat1, lon1, lat2, lon2);
 }
 
 /*
- * karney_bearing() - Calculates the initial bearing from point (lat1, lon1) to 
- * point (lat2, lon2) using Karney's method on the WGS84 ellipsoid.
+ * geod_bearing() - Calculates the initial bearing from point (lat1, lon1) to 
+ * point (lat2, lon2) using Karney's method on the ellipsoid `ell`.
  * Returns bearing in degrees, 0 to 360.
  *
  * Antipodal points, including pole-to-pole (e.g., 90,0 to -90,0), return -2.0 
@@ -302,6 +473,7 @@ double karney_distance(const double lat1, const double lon1,
  * which direction to go when you're already there.
  *
  * Parameters:
+ * - ell - The ellipsoid model
  * - lat1, lon1 - First position's latitude and longitude in decimal degrees
  * - lat2, lon2 - Second position's latitude and longitude in decimal degrees
  *
@@ -311,23 +483,21 @@ double karney_distance(const double lat1, const double lon1,
  * - -2.0 if points are antipodal, coincident, or calculation fails
  */
 
-double karney_bearing(const double lat1, const double lon1,
-                      const double lat2, const double lon2)
+double geod_bearing(const struct ellipsoid *ell,
+                    const double lat1, const double lon1,
+                    const double lat2, const double lon2)
 {
-	double lat1_rad, lat2_rad;
-	const double f = 1.0 / 298.257223563, /* WGS84 flattening */
-	             eps_deg = 1e-10, eq_eps = 1e-13;
+	const double eps_deg = 1e-10, eq_eps = 1e-13;
 	double lambda, lambda_prev, sin_lambda, cos_lambda, sin_sigma,
 	       cos_sigma, sigma, sin_alpha, cos_sq_alpha, cos2_sigma_m;
 	int iter_limit;
 
+	assert(ell);
+
 	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0 || fabs(lon1) > 180.0
 	    || fabs(lon2) > 180.0)
 		return -1.0;
 
-	lat1_rad = deg2rad(lat1);
-	lat2_rad = deg2rad(lat2);
-
 	double dlon_deg = fmod((lon2 - lon1) + 540.0, 360.0) - 180.0;
 	const double L = deg2rad(dlon_deg);
 
@@ -348,10 +518,11 @@ double karney_bearing(const double lat1, const double lon1,
 		return (dlon_deg > 0.0) ? 90.0 : 270.0;
 
 	/* Vincenty/Karney inspired iteration (robust for non-antipodal) */
-	const double U1 = atan((1.0 - f) * tan(lat1_rad));
-	const double U2 = atan((1.0 - f) * tan(lat2_rad));
-	const double sinU1 = sin(U1), cosU1 = cos(U1);
-	const double sinU2 = sin(U2), cosU2 = cos(U2);
+	const double f = ell->f;
+	double sinU1, cosU1, sinU2, cosU2;
+
+	reduced_lat(ell, deg2rad(lat1), &sinU1, &cosU1);
+	reduced_lat(ell, deg2rad(lat2), &sinU2, &cosU2);
 
 	lambda = L;
 	iter_limit = 100;
@@ -401,167 +572,4349 @@ double karney_bearing(const double lat1, const double lon1,
 }
 
 /*
- * distance() - Calculates the distance between 2 locations with the formula 
- * specified in `formula`. Returns the distance in meters.
+ * karney_bearing() - Returns the initial bearing in degrees from point (lat1, 
+ * lon1) to point (lat2, lon2) on the WGS84 ellipsoid, calculated with 
+ * geod_bearing().
  */
 
-double distance(const DistFormula formula,
-                const double lat1, const double lon1,
-                const double lat2, const double lon2)
+double karney_bearing(const double lat1, const double lon1,
+                      const double lat2, const double lon2)
 {
-	switch (formula) {
-	case FRM_HAVERSINE:
-		return haversine(lat1, lon1, lat2, lon2);
-	case FRM_KARNEY:
-		return karney_distance(lat1, lon1, lat2, lon2);
-	default: /* gncov */
-		myerror("%s() received unknown formula %d", /* gncov */
-		        __func__, formula);
-		return nan(""); /* gncov */
-	}
+	return geod_bearing(&WGS84, lat1, lon1, lat2, lon2);
 }
 
 /*
- * initial_bearing() - Calculates the initial bearing from point `lat1, lon1` 
- * to point `lat2, lon2`. Returns bearing in degrees: 0 = north, 90 = east, 180 
- * = south, 270 = west.
- *
- * Returns:
- * - -1.0 if values outside the valid coordinate range are provided
- * - -2.0 if points are antipodal or coincident, answer is undefined
+ * wrap_dlon() - Returns the longitude difference `lon2 - lon1` in degrees, 
+ * reduced to the range [-180, 180], so the short way around the Earth is 
+ * used.
  */
 
-double initial_bearing(const double lat1, const double lon1,
-                       const double lat2, const double lon2)
+static double wrap_dlon(const double lon1, const double lon2)
+{
+	const double dlon = lon2 - lon1;
+
+	if (dlon > 180.0)
+		return dlon - 360.0;
+	if (dlon < -180.0)
+		return dlon + 360.0;
+
+	return dlon;
+}
+
+/*
+ * equirect_distance() - Returns the approximate distance in meters between 
+ * `lat1,lon1` and `lat2,lon2` on a sphere with the radius EARTH_RADIUS, 
+ * using the equirectangular projection at the mean latitude. Only one cos() 
+ * and one sqrt() are needed. Within APPROX_MAX_DIST and APPROX_MAX_LAT, the 
+ * relative error compared to haversine() is at most EQUIRECT_MAX_ERROR. 
+ * Returns -1.0 if the coordinates are out of range.
+ */
+
+double equirect_distance(const double lat1, const double lon1,
+                         const double lat2, const double lon2)
 {
 	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0
 	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
 		return -1.0;
 
-	if (are_antipodal(lat1, lon1, lat2, lon2)
-	    || (lat1 == lat2 && lon1 == lon2))
-		return -2.0;
+	const double x = deg2rad(wrap_dlon(lon1, lon2))
+	                 * cos(deg2rad((lat1 + lat2) / 2.0));
+	const double y = deg2rad(lat2 - lat1);
 
-	const double lat1_rad = deg2rad(lat1);
-	const double lat2_rad = deg2rad(lat2);
-	const double delta_lon = deg2rad(lon2 - lon1);
+	return EARTH_RADIUS * sqrt(x * x + y * y);
+}
 
-	const double cos_lat1 = cos(lat1_rad);
-	const double cos_lat2 = cos(lat2_rad);
+/*
+ * cheapruler_distance() - Returns the approximate distance in meters between 
+ * `lat1,lon1` and `lat2,lon2` on the ellipsoid `ell`, in the style of the 
+ * Mapbox cheap-ruler. The longitude and latitude differences are scaled with 
+ * the radii of curvature in the prime vertical and the meridian at the mean 
+ * latitude, and the distance is found in the resulting flat plane. Within 
+ * APPROX_MAX_DIST and APPROX_MAX_LAT, the relative error compared to 
+ * geod_distance() is at most CHEAPRULER_MAX_ERROR. Returns -1.0 if the 
+ * coordinates are out of range.
+ */
 
-	const double y = sin(delta_lon) * cos_lat2;
-	const double x = cos_lat1 * sin(lat2_rad)
-	                 - sin(lat1_rad) * cos_lat2 * cos(delta_lon);
+double cheapruler_distance(const struct ellipsoid *ell,
+                           const double lat1, const double lon1,
+                           const double lat2, const double lon2)
+{
+	assert(ell);
 
-	return fmod(rad2deg(atan2(y, x)) + 360.0, 360.0);
+	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0
+	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
+		return -1.0;
+
+	const double c = cos(deg2rad((lat1 + lat2) / 2.0));
+	const double w2 = 1.0 / (1.0 - ell->e2 * (1.0 - c * c));
+	const double w = sqrt(w2);
+	const double x = deg2rad(wrap_dlon(lon1, lon2)) * ell->a * w * c;
+	const double y = deg2rad(lat2 - lat1) * ell->a * w * w2
+	                 * (1.0 - ell->e2);
+
+	return sqrt(x * x + y * y);
 }
 
 /*
- * bearing() - Calculates the initial bearing at position `lat1,lon1` towards 
- * position `lat2,lon2` using the distance formula in `formula`. Returns the 
- * compass direction as a value between 0 and 360 where north is 0.
+ * haversine32() - Returns the distance in meters between `lat1,lon1` and 
+ * `lat2,lon2` like haversine(), but the trigonometry is done in single 
+ * precision. The coordinate differences are found in double precision 
+ * first, so short distances keep their relative accuracy. Within 
+ * APPROX_MAX_DIST and APPROX_MAX_LAT, the relative error compared to 
+ * haversine() is at most HAVERSINE32_MAX_ERROR. Returns -1.0 if the 
+ * coordinates are out of range.
  */
 
-double bearing(const DistFormula formula,
-               const double lat1, const double lon1,
-               const double lat2, const double lon2)
+double haversine32(const double lat1, const double lon1,
+                   const double lat2, const double lon2)
 {
-	switch (formula) {
-	case FRM_HAVERSINE:
-		return initial_bearing(lat1, lon1, lat2, lon2);
-	case FRM_KARNEY:
-		return karney_bearing(lat1, lon1, lat2, lon2);
-	default: /* gncov */
-		myerror("%s() received unknown formula %d", /* gncov */
-		        __func__, formula);
-		return nan(""); /* gncov */
-	}
+	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0
+	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
+		return -1.0;
+
+	const float s_lat = sinf((float)deg2rad(lat2 - lat1) / 2.0f);
+	const float s_lon = sinf((float)deg2rad(wrap_dlon(lon1, lon2)) / 2.0f);
+	const float hav = fminf(1.0f, s_lat * s_lat
+	                              + cosf((float)deg2rad(lat1))
+	                                * cosf((float)deg2rad(lat2))
+	                                * s_lon * s_lon);
+
+	return EARTH_RADIUS
+	       * (double)(2.0f * atan2f(sqrtf(hav), sqrtf(1.0f - hav)));
 }
 
 /*
- * rand_pos() - Generates a random position on Earth with optional distance 
- * constraints.
- *
- * If `c_lat` is larger than 90, generate a random location somewhere on Earth. 
- * Otherwise, the position is between `mindist` and `maxdist` meters from 
- * `c_lat,c_lon`.
- *
- * Parameters:
- * - dlat:    Pointer to store resulting latitude (-90 to 90 degrees)
- * - dlon:    Pointer to store resulting longitude (-180 to 180 degrees)
- * - c_lat:   Center position latitude (-90 to 90 degrees)
- * - c_lon:   Center position longitude (-180 to 180 degrees)
- * - maxdist: Maximum distance in meters from center
- * - mindist: Minimum distance in meters from center
- *
- * Returns nothing.
+ * isometric_lat() - Returns the isometric latitude of the latitude `lat_rad` 
+ * in radians, i.e. the northing of the position in the Mercator projection of 
+ * a unit sphere. A rhumb line is a straight line in this projection.
  */
 
-void rand_pos(double *dlat, double *dlon,
-              const double c_lat_p, const double c_lon_p,
-              const double maxdist_p, const double mindist_p)
+static double isometric_lat(const double lat_rad)
 {
-	double c_lat = c_lat_p, c_lon = c_lon_p,
-	       maxdist = maxdist_p, mindist = mindist_p,
-	       rand_bear, rand_dist, result;
+	return asinh(tan(lat_rad));
+}
 
-	assert(dlat);
-	assert(dlon);
+/*
+ * rhumb_leg() - Calculates the length in meters and the constant bearing in 
+ * degrees of the rhumb line from `lat1,lon1` to `lat2,lon2`, and stores them 
+ * in `dist` and `bear`. Any of them can be NULL if the value isn't needed. 
+ * `psi1` and `psi2` are the isometric latitudes of the positions, they're 
+ * arguments so distance_batch() and bearing_batch() only have to calculate 
+ * them once for every position. The shortest way around the Earth is used, 
+ * and the longitude of a pole is ignored. Returns nothing.
+ */
 
-	if (c_lat > 90.0 || (maxdist == 0.0 && mindist == 0.0)) {
-		/* No center coordinate or distances, use the whole world */
-		*dlat = rad2deg(asin(2.0 * drand48() - 1.0));
-		*dlon = rad2deg(drand48() * 2.0 * M_PI) - 180.0;
-		return;
-	}
+static void rhumb_leg(const double lat1, const double lon1,
+                      const double lat2, const double lon2,
+                      const double psi1, const double psi2,
+                      double *dist, double *bear)
+{
+	const double dphi = deg2rad(lat2 - lat1), dpsi = psi2 - psi1;
+	double dlon = deg2rad(lon2 - lon1), q;
 
-	if (mindist != 0.0 && maxdist == 0.0) {
-		set_antipode(&c_lat, &c_lon);
-		maxdist = MAX_EARTH_DISTANCE - mindist;
-		mindist = 0.0;
-	}
-	if (mindist > maxdist) {
-		double d = mindist;
-		mindist = maxdist;
-		maxdist = d;
-	}
-	do {
-		rand_bear = drand48() * 360.0;
-		rand_dist = mindist + sqrt(drand48()) * (maxdist - mindist);
-		if (rand_dist > MAX_EARTH_DISTANCE)
-			rand_dist = MAX_EARTH_DISTANCE;
+	if (fabs(dlon) > M_PI)
+		dlon -= copysign(2.0 * M_PI, dlon);
+	if (fabs(lat1) == 90.0 || fabs(lat2) == 90.0)
+		dlon = 0.0;
 
-		bearing_position(c_lat, c_lon, rand_bear, rand_dist,
-		                 dlat, dlon);
-		result = haversine(c_lat, c_lon, *dlat, *dlon);
-	} while (mindist != maxdist && (result < mindist || result > maxdist));
+	/*
+	 * The ratio between the latitude difference and the isometric 
+	 * latitude difference is the cosine of the latitude if the line 
+	 * goes east or west, which avoids dividing by zero.
+	 */
+	q = fabs(dpsi) > 1e-12 ? dphi / dpsi : cos(deg2rad(lat1));
+	if (dist)
+		*dist = EARTH_RADIUS * hypot(dphi, q * dlon);
+	if (bear)
+		*bear = fmod(rad2deg(atan2(dlon, dpsi)) + 360.0, 360.0);
 }
 
 /*
- * routepoint() - Calculates the position of a point on a straight line between 
- * `lat1, lon1` and `lat2, lon2`, where `fracdist` is a fraction that specifies 
- * how far along the line the point is, with 0 = start position, 1 = end 
- * position. `fracdist` can also take values below 0 or above 1 to calculate 
- * positions beyond `lat2, lon2` or in the opposite direction from `lat1, 
- * lon1`.
- *
- * See `bearing_position()` for information on return values.
+ * rhumb_distance() - Returns the length in meters of the rhumb line 
+ * (loxodrome) from `lat1,lon1` to `lat2,lon2`, the path with a constant 
+ * bearing. It's never shorter than the great-circle distance. Returns -1.0 if 
+ * the coordinates are outside the valid range.
  */
 
-int routepoint(const double lat1, const double lon1,
-               const double lat2, const double lon2,
-               const double fracdist,
-               double *next_lat, double *next_lon)
+double rhumb_distance(const double lat1, const double lon1,
+                      const double lat2, const double lon2)
 {
-	assert(next_lat);
-	assert(next_lon);
+	double dist;
 
-	return bearing_position(lat1, lon1,
+	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0
+	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
+		return -1.0;
+
+	rhumb_leg(lat1, lon1, lat2, lon2, isometric_lat(deg2rad(lat1)),
+	          isometric_lat(deg2rad(lat2)), &dist, NULL);
+
+	return dist;
+}
+
+/*
+ * rhumb_bearing() - Returns the constant bearing in degrees of the rhumb line 
+ * from `lat1,lon1` to `lat2,lon2`, where north is 0. Returns -1.0 if the 
+ * coordinates are outside the valid range, or -2.0 if the positions are 
+ * coincident and the bearing is undefined.
+ */
+
+double rhumb_bearing(const double lat1, const double lon1,
+                     const double lat2, const double lon2)
+{
+	double bear;
+
+	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0
+	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
+		return -1.0;
+	if (lat1 == lat2 && (lon1 == lon2 || fabs(lat1) == 90.0))
+		return -2.0;
+
+	rhumb_leg(lat1, lon1, lat2, lon2, isometric_lat(deg2rad(lat1)),
+	          isometric_lat(deg2rad(lat2)), NULL, &bear);
+
+	return bear;
+}
+
+/*
+ * rhumb_position() - Calculates the position after moving `dist_m` meters 
+ * from `lat,lon` along the rhumb line with the constant bearing `bearing_deg`, 
+ * and stores it in `new_lat` and `new_lon`. Negative distances move in the 
+ * opposite direction. The latitude changes linearly with the distance, and 
+ * the longitude linearly with the isometric latitude, so no iteration is 
+ * needed. A rhumb line that reaches a pole stops there. Returns 1 if the 
+ * values are outside the valid range, otherwise 0.
+ */
+
+int rhumb_position(const double lat, const double lon,
+                   const double bearing_deg, const double dist_m,
+                   double *new_lat, double *new_lon)
+{
+	double phi1, phi2, dphi, dpsi, q, delta, theta;
+
+	assert(new_lat);
+	assert(new_lon);
+
+	if (fabs(lat) > 90.0 || fabs(lon) > 180.0
+	    || bearing_deg < 0.0 || bearing_deg > 360.0)
+		return 1;
+
+	phi1 = deg2rad(lat);
+	theta = deg2rad(bearing_deg);
+	delta = dist_m / EARTH_RADIUS;
+	dphi = delta * cos(theta);
+	phi2 = phi1 + dphi;
+	if (fabs(phi2) >= M_PI / 2.0 || fabs(lat) == 90.0) {
+		*new_lat = fabs(phi2) >= M_PI / 2.0 ? copysign(90.0, phi2)
+		                                    : rad2deg(phi2);
+		*new_lon = lon;
+		return 0;
+	}
+	dpsi = isometric_lat(phi2) - isometric_lat(phi1);
+	q = fabs(dpsi) > 1e-12 ? dphi / dpsi : cos(phi1);
+	*new_lat = rad2deg(phi2);
+	*new_lon = lon + rad2deg(delta * sin(theta) / q);
+	normalize_longitude(new_lon);
+
+	return 0;
+}
+
+/*
+ * rhumb_point() - Stores the position at the fraction `fracdist` of the 
+ * length of the rhumb line from `lat1,lon1` to `lat2,lon2` in `next_lat` and 
+ * `next_lon`. Coincident positions return the start position. Returns 1 if 
+ * the coordinates are outside the valid range, otherwise 0.
+ */
+
+int rhumb_point(const double lat1, const double lon1,
+                const double lat2, const double lon2,
+                const double fracdist,
+                double *next_lat, double *next_lon)
+{
+	double dist, bear;
+
+	assert(next_lat);
+	assert(next_lon);
+
+	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0
+	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
+		return 1;
+
+	rhumb_leg(lat1, lon1, lat2, lon2, isometric_lat(deg2rad(lat1)),
+	          isometric_lat(deg2rad(lat2)), &dist, &bear);
+
+	return rhumb_position(lat1, lon1, bear, dist * fracdist,
+	                      next_lat, next_lon);
+}
+
+/*
+ * distance() - Calculates the distance between 2 locations with the formula 
+ * specified in `formula`. FRM_KARNEY and FRM_CHEAPRULER use the ellipsoid 
+ * `ell`, the other formulas use a sphere with the radius EARTH_RADIUS. 
+ * Returns the distance in meters.
+ */
+
+double distance(const DistFormula formula, const struct ellipsoid *ell,
+                const double lat1, const double lon1,
+                const double lat2, const double lon2)
+{
+	switch (formula) {
+	case FRM_HAVERSINE:
+		return haversine(lat1, lon1, lat2, lon2);
+	case FRM_CHEAPRULER:
+		return cheapruler_distance(ell, lat1, lon1, lat2, lon2);
+	case FRM_EQUIRECT:
+		return equirect_distance(lat1, lon1, lat2, lon2);
+	case FRM_HAVERSINE32:
+		return haversine32(lat1, lon1, lat2, lon2);
+	case FRM_KARNEY:
+		return geod_distance(ell, lat1, lon1, lat2, lon2);
+	case FRM_RHUMB:
+		return rhumb_distance(lat1, lon1, lat2, lon2);
+	default: /* gncov */
+		myerror("%s() received unknown formula %d", /* gncov */
+		        __func__, formula);
+		return nan(""); /* gncov */
+	}
+}
+
+/*
+ * approx_error() - Returns the maximum relative error of the distances from 
+ * the approximate formula `formula`, compared to the exact formula it 
+ * approximates, for positions that are at most APPROX_MAX_DIST meters apart 
+ * and within APPROX_MAX_LAT degrees of the Equator. The exact formula is 
+ * stored in `exact` if it's not NULL. Exact formulas return 0.0 and store 
+ * themselves.
+ */
+
+double approx_error(const DistFormula formula, DistFormula *exact)
+{
+	DistFormula dummy;
+
+	if (!exact)
+		exact = &dummy;
+	switch (formula) {
+	case FRM_CHEAPRULER:
+		*exact = FRM_KARNEY;
+		return CHEAPRULER_MAX_ERROR;
+	case FRM_EQUIRECT:
+		*exact = FRM_HAVERSINE;
+		return EQUIRECT_MAX_ERROR;
+	case FRM_HAVERSINE32:
+		*exact = FRM_HAVERSINE;
+		return HAVERSINE32_MAX_ERROR;
+	default:
+		*exact = formula;
+		return 0.0;
+	}
+}
+
+/*
+ * threshold_distance() - Returns the distance in meters between `lat1,lon1` 
+ * and `lat2,lon2` calculated with `formula` and the ellipsoid `ell`, for 
+ * callers that only need to know if it's within `maxdist` meters. If 
+ * `formula` is approximate, the error bound from approx_error() decides if 
+ * the approximation is on the same side of `maxdist` as the exact distance, 
+ * with an extra APPROX_ABS_ERROR meters for rounding noise near zero. 
+ * If it can't, or if a latitude is outside APPROX_MAX_LAT, the distance is 
+ * recalculated with the exact formula, so only positions near the threshold 
+ * pay for it. The caller must make sure that the positions are within 
+ * APPROX_MAX_DIST meters of each other, for example with a spatial index.
+ */
+
+double threshold_distance(const DistFormula formula,
+                          const struct ellipsoid *ell,
+                          const double lat1, const double lon1,
+                          const double lat2, const double lon2,
+                          const double maxdist)
+{
+	DistFormula exact;
+	const double err = approx_error(formula, &exact);
+	const double dist = distance(formula, ell, lat1, lon1, lat2, lon2);
+
+	if (err == 0.0)
+		return dist;
+	if (fabs(lat1) > APPROX_MAX_LAT || fabs(lat2) > APPROX_MAX_LAT
+	    || fabs(dist - maxdist) <= maxdist * err + APPROX_ABS_ERROR)
+		return distance(exact, ell, lat1, lon1, lat2, lon2);
+
+	return dist;
+}
+
+/*
+ * bearing_trig() - Returns the initial bearing in degrees from `lon1` towards 
+ * `lon2` on a sphere, where the sines and cosines of the latitudes are 
+ * calculated by the caller. Used by initial_bearing() and bearing_batch(), the 
+ * latter reuses the values for every position.
+ */
+
+static double bearing_trig(const double lon1, const double lon2,
+                           const double sin_lat1, const double cos_lat1,
+                           const double sin_lat2, const double cos_lat2)
+{
+	const double delta_lon = deg2rad(lon2 - lon1);
+
+	const double y = sin(delta_lon) * cos_lat2;
+	const double x = cos_lat1 * sin_lat2
+	                 - sin_lat1 * cos_lat2 * cos(delta_lon);
+
+	return fmod(rad2deg(atan2(y, x)) + 360.0, 360.0);
+}
+
+/*
+ * initial_bearing() - Calculates the initial bearing from point `lat1, lon1` 
+ * to point `lat2, lon2`. Returns bearing in degrees: 0 = north, 90 = east, 180 
+ * = south, 270 = west.
+ *
+ * Returns:
+ * - -1.0 if values outside the valid coordinate range are provided
+ * - -2.0 if points are antipodal or coincident, answer is undefined
+ */
+
+double initial_bearing(const double lat1, const double lon1,
+                       const double lat2, const double lon2)
+{
+	if (fabs(lat1) > 90.0 || fabs(lat2) > 90.0
+	    || fabs(lon1) > 180.0 || fabs(lon2) > 180.0)
+		return -1.0;
+
+	if (are_antipodal(lat1, lon1, lat2, lon2)
+	    || (lat1 == lat2 && lon1 == lon2))
+		return -2.0;
+
+	const double lat1_rad = deg2rad(lat1);
+	const double lat2_rad = deg2rad(lat2);
+
+	return bearing_trig(lon1, lon2, sin(lat1_rad), cos(lat1_rad),
+	                    sin(lat2_rad), cos(lat2_rad));
+}
+
+/*
+ * bearing() - Calculates the initial bearing at position `lat1,lon1` towards 
+ * position `lat2,lon2` using the distance formula in `formula`, with the 
+ * ellipsoid `ell` if it's FRM_KARNEY. Returns the compass direction as a 
+ * value between 0 and 360 where north is 0.
+ */
+
+double bearing(const DistFormula formula, const struct ellipsoid *ell,
+               const double lat1, const double lon1,
+               const double lat2, const double lon2)
+{
+	switch (formula) {
+	case FRM_HAVERSINE:
+		return initial_bearing(lat1, lon1, lat2, lon2);
+	case FRM_KARNEY:
+		return geod_bearing(ell, lat1, lon1, lat2, lon2);
+	case FRM_RHUMB:
+		return rhumb_bearing(lat1, lon1, lat2, lon2);
+	default: /* gncov */
+		myerror("%s() received unknown formula %d", /* gncov */
+		        __func__, formula);
+		return nan(""); /* gncov */
+	}
+}
+
+/*
+ * distance_batch() - Calculates the distances in meters between the `n` 
+ * consecutive positions in `lat` and `lon` with the formula in `formula` and 
+ * the ellipsoid `ell`. The `n - 1` results are stored in `dest`, where 
+ * `dest[i]` is the distance between position `i` and `i + 1`. The results are 
+ * identical to the values from distance(), but the Haversine version only 
+ * calculates the cosine of every latitude once instead of twice, and the 
+ * rhumb line version calculates the isometric latitude once. Returns nothing.
+ */
+
+void distance_batch(const DistFormula formula, const struct ellipsoid *ell,
+                    const double *lat, const double *lon, const size_t n,
+                    double *dest)
+{
+	size_t i;
+	double cos_prev, psi_prev, psi_next;
+
+	assert(lat);
+	assert(lon);
+	assert(dest || n < 2);
+
+	if (n < 2)
+		return;
+	if (formula == FRM_RHUMB) {
+		psi_prev = isometric_lat(deg2rad(lat[0]));
+		for (i = 0; i < n - 1; i++) {
+			psi_next = isometric_lat(deg2rad(lat[i + 1]));
+			if (fabs(lat[i]) > 90.0 || fabs(lat[i + 1]) > 90.0
+			    || fabs(lon[i]) > 180.0
+			    || fabs(lon[i + 1]) > 180.0) {
+				dest[i] = -1.0;
+			} else {
+				rhumb_leg(lat[i], lon[i], lat[i + 1],
+				          lon[i + 1], psi_prev, psi_next,
+				          &dest[i], NULL);
+			}
+			psi_prev = psi_next;
+		}
+		return;
+	}
+	if (formula != FRM_HAVERSINE) {
+		for (i = 0; i < n - 1; i++) {
+			dest[i] = distance(formula, ell, lat[i], lon[i],
+			                   lat[i + 1], lon[i + 1]);
+		}
+		return;
+	}
+
+	cos_prev = cos(deg2rad(lat[0]));
+	for (i = 0; i < n - 1; i++) {
+		const double cos_next = cos(deg2rad(lat[i + 1]));
+
+		if (fabs(lat[i]) > 90.0 || fabs(lat[i + 1]) > 90.0
+		    || fabs(lon[i]) > 180.0 || fabs(lon[i + 1]) > 180.0) {
+			dest[i] = -1.0;
+		} else {
+			const double arc = haversine_arc(lat[i], lon[i],
+			                                 lat[i + 1],
+			                                 lon[i + 1],
+			                                 cos_prev, cos_next);
+
+			if (isnan(arc)) {
+				errno = 0;
+				dest[i] = MAX_EARTH_DISTANCE;
+			} else {
+				dest[i] = EARTH_RADIUS * arc;
+			}
+		}
+		cos_prev = cos_next;
+	}
+}
+
+/*
+ * bearing_batch() - Calculates the initial bearings between the `n` 
+ * consecutive positions in `lat` and `lon` with the formula in `formula` and 
+ * the ellipsoid `ell`, and stores the `n - 1` results in `dest`. `dest[i]` is 
+ * the bearing at position `i` towards position `i + 1`, with the same values 
+ * as bearing() returns. The Haversine version reuses the sine and cosine of 
+ * every latitude, and the rhumb line version reuses the isometric latitude. 
+ * Returns nothing.
+ */
+
+void bearing_batch(const DistFormula formula, const struct ellipsoid *ell,
+                   const double *lat, const double *lon, const size_t n,
+                   double *dest)
+{
+	size_t i;
+	double sin_prev, cos_prev, psi_prev, psi_next;
+
+	assert(lat);
+	assert(lon);
+	assert(dest || n < 2);
+
+	if (n < 2)
+		return;
+	if (formula == FRM_RHUMB) {
+		psi_prev = isometric_lat(deg2rad(lat[0]));
+		for (i = 0; i < n - 1; i++) {
+			psi_next = isometric_lat(deg2rad(lat[i + 1]));
+			if (fabs(lat[i]) > 90.0 || fabs(lat[i + 1]) > 90.0
+			    || fabs(lon[i]) > 180.0
+			    || fabs(lon[i + 1]) > 180.0) {
+				dest[i] = -1.0;
+			} else if (lat[i] == lat[i + 1]
+			           && (lon[i] == lon[i + 1]
+			               || fabs(lat[i]) == 90.0)) {
+				dest[i] = -2.0;
+			} else {
+				rhumb_leg(lat[i], lon[i], lat[i + 1],
+				          lon[i + 1], psi_prev, psi_next,
+				          NULL, &dest[i]);
+			}
+			psi_prev = psi_next;
+		}
+		return;
+	}
+	if (formula != FRM_HAVERSINE) {
+		for (i = 0; i < n - 1; i++) {
+			dest[i] = bearing(formula, ell, lat[i], lon[i],
+			                  lat[i + 1], lon[i + 1]);
+		}
+		return;
+	}
+
+	sin_prev = sin(deg2rad(lat[0]));
+	cos_prev = cos(deg2rad(lat[0]));
+	for (i = 0; i < n - 1; i++) {
+		const double lat2_rad = deg2rad(lat[i + 1]);
+		const double sin_next = sin(lat2_rad);
+		const double cos_next = cos(lat2_rad);
+
+		if (fabs(lat[i]) > 90.0 || fabs(lat[i + 1]) > 90.0
+		    || fabs(lon[i]) > 180.0 || fabs(lon[i + 1]) > 180.0) {
+			dest[i] = -1.0;
+		} else if (are_antipodal(lat[i], lon[i],
+		                         lat[i + 1], lon[i + 1])
+		           || (lat[i] == lat[i + 1]
+		               && lon[i] == lon[i + 1])) {
+			dest[i] = -2.0;
+		} else {
+			dest[i] = bearing_trig(lon[i], lon[i + 1],
+			                       sin_prev, cos_prev,
+			                       sin_next, cos_next);
+		}
+		sin_prev = sin_next;
+		cos_prev = cos_next;
+	}
+}
+
+/*
+ * compsum_init() - Initializes the compensated sum in `s` to zero. Returns 
+ * nothing.
+ */
+
+void compsum_init(struct compsum *s)
+{
+	assert(s);
+
+	s->sum = 0.0;
+	s->comp = 0.0;
+}
+
+/*
+ * compsum_add() - Adds `x` to the compensated sum in `s`, using the Neumaier 
+ * variant of Kahan summation. The rounding error of every addition is 
+ * collected in `s->comp`, so the error of the total doesn't grow with the 
+ * number of values. Unlike the original Kahan algorithm, it also works when 
+ * `x` is larger than the sum. Returns nothing.
+ */
+
+void compsum_add(struct compsum *s, const double x)
+{
+	double t;
+
+	assert(s);
+
+	t = s->sum + x;
+	if (fabs(s->sum) >= fabs(x))
+		s->comp += (s->sum - t) + x;
+	else
+		s->comp += (x - t) + s->sum;
+	s->sum = t;
+}
+
+/*
+ * compsum_result() - Returns the value of the compensated sum in `s`.
+ */
+
+double compsum_result(const struct compsum *s)
+{
+	assert(s);
+
+	return s->sum + s->comp;
+}
+
+/*
+ * bbox_init() - Initializes the bounding box in `b` to be empty. Returns 
+ * nothing.
+ */
+
+void bbox_init(struct bbox *b)
+{
+	assert(b);
+
+	b->count = 0;
+	b->minlat = b->minlon = b->minlon360 = INFINITY;
+	b->maxlat = b->maxlon = b->maxlon360 = -INFINITY;
+}
+
+/*
+ * bbox_add() - Extends the bounding box in `b` to include the position 
+ * `lat,lon`. The longitudes are also stored in the range [0, 360), so 
+ * bbox_lon() can find the smallest box for positions that cross the 
+ * antimeridian. Returns nothing.
+ */
+
+void bbox_add(struct bbox *b, const double lat, const double lon)
+{
+	const double lon360 = lon < 0.0 ? lon + 360.0 : lon;
+
+	assert(b);
+
+	b->count++;
+	b->minlat = fmin(b->minlat, lat);
+	b->maxlat = fmax(b->maxlat, lat);
+	b->minlon = fmin(b->minlon, lon);
+	b->maxlon = fmax(b->maxlon, lon);
+	b->minlon360 = fmin(b->minlon360, lon360);
+	b->maxlon360 = fmax(b->maxlon360, lon360);
+}
+
+/*
+ * bbox_lon() - Stores the western and eastern longitude of the bounding box in 
+ * `b` in `west` and `east`. If the box is narrower when it crosses the 
+ * antimeridian, `west` is larger than `east`. Returns 1 if the box is empty, 
+ * otherwise 0.
+ */
+
+int bbox_lon(const struct bbox *b, double *west, double *east)
+{
+	assert(b);
+	assert(west);
+	assert(east);
+
+	if (!b->count)
+		return 1;
+	if (b->maxlon360 - b->minlon360 < b->maxlon - b->minlon) {
+		*west = b->minlon360 > 180.0 ? b->minlon360 - 360.0
+		                             : b->minlon360;
+		*east = b->maxlon360 > 180.0 ? b->maxlon360 - 360.0
+		                             : b->maxlon360;
+	} else {
+		*west = b->minlon;
+		*east = b->maxlon;
+	}
+
+	return 0;
+}
+
+/*
+ * pos_to_vec3() - Converts the position `lat,lon` to a unit vector in `dest`, 
+ * with the origin in the center of a spherical Earth, the x axis through 
+ * 0,0, the y axis through 0,90 and the z axis through the North Pole. Returns 
+ * nothing.
+ */
+
+void pos_to_vec3(const double lat, const double lon, struct vec3 *dest)
+{
+	const double rlat = deg2rad(lat), rlon = deg2rad(lon);
+	const double cos_lat = cos(rlat);
+
+	assert(dest);
+
+	dest->x = cos_lat * cos(rlon);
+	dest->y = cos_lat * sin(rlon);
+	dest->z = sin(rlat);
+}
+
+/*
+ * vec3_to_pos() - Converts the vector `v` to the position where it crosses 
+ * the surface of the Earth, and stores it in `lat` and `lon`. The vector 
+ * doesn't need to be a unit vector. Returns 1 if `v` is the zero vector and 
+ * the position is undefined, otherwise 0.
+ */
+
+int vec3_to_pos(const struct vec3 *v, double *lat, double *lon)
+{
+	assert(v);
+	assert(lat);
+	assert(lon);
+
+	*lat = rad2deg(atan2(v->z, hypot(v->x, v->y)));
+	*lon = rad2deg(atan2(v->y, v->x));
+
+	return !v->x && !v->y && !v->z;
+}
+
+/*
+ * vec3_chord2() - Returns the square of the straight-line distance between 
+ * the unit vectors `a` and `b`. It's used instead of the dot product when 
+ * comparing angles, as it's exact for coincident vectors and doesn't lose 
+ * precision for small angles.
+ */
+
+double vec3_chord2(const struct vec3 *a, const struct vec3 *b)
+{
+	const double dx = a->x - b->x, dy = a->y - b->y, dz = a->z - b->z;
+
+	assert(a);
+	assert(b);
+
+	return dx * dx + dy * dy + dz * dz;
+}
+
+/*
+ * vec3_dot() - Returns the dot product of the vectors `a` and `b`.
+ */
+
+static double vec3_dot(const struct vec3 *a, const struct vec3 *b)
+{
+	return a->x * b->x + a->y * b->y + a->z * b->z;
+}
+
+/*
+ * vec3_cross() - Stores the cross product of the vectors `a` and `b` in 
+ * `dest`. `dest` must not be the same as `a` or `b`. Returns nothing.
+ */
+
+static void vec3_cross(const struct vec3 *a, const struct vec3 *b,
+                       struct vec3 *dest)
+{
+	dest->x = a->y * b->z - a->z * b->y;
+	dest->y = a->z * b->x - a->x * b->z;
+	dest->z = a->x * b->y - a->y * b->x;
+}
+
+/*
+ * vec3_angle() - Returns the angle in radians between the unit vectors `a` 
+ * and `b`. atan2() is used instead of acos(), which loses precision for small 
+ * angles.
+ */
+
+double vec3_angle(const struct vec3 *a, const struct vec3 *b)
+{
+	struct vec3 c;
+
+	assert(a);
+	assert(b);
+
+	vec3_cross(a, b, &c);
+
+	return atan2(sqrt(vec3_dot(&c, &c)), vec3_dot(a, b));
+}
+
+/*
+ * geodetic_to_ecef() - Converts the position `lat,lon` with the height `h` 
+ * meters above the ellipsoid `ell` to Earth-centered, Earth-fixed (ECEF) 
+ * coordinates in meters, and stores them in `dest`. The x axis goes through 
+ * 0,0, the y axis through 0,90 and the z axis through the North Pole. Returns 
+ * nothing.
+ */
+
+void geodetic_to_ecef(const struct ellipsoid *ell, const double lat,
+                      const double lon, const double h, struct vec3 *dest)
+{
+	const double e2 = ell->e2;
+	const double rlat = deg2rad(lat), rlon = deg2rad(lon);
+	const double sin_lat = sin(rlat), cos_lat = cos(rlat);
+	const double n = ell->a / sqrt(1.0 - e2 * sin_lat * sin_lat);
+
+	assert(dest);
+
+	dest->x = (n + h) * cos_lat * cos(rlon);
+	dest->y = (n + h) * cos_lat * sin(rlon);
+	dest->z = (n * (1.0 - e2) + h) * sin_lat;
+}
+
+/*
+ * ecef_to_geodetic() - Converts the ECEF coordinates in `p` to the position 
+ * on the ellipsoid `ell`, stored in `lat` and `lon`, and the height above it 
+ * in meters, stored in `h`. This is the closed-form solution by Vermeille 
+ * (2011) in the form used by GeographicLib, so no iteration is needed. It's 
+ * accurate to a few nanometers for all positions, including the poles and 
+ * positions near the center of the Earth, where the nearest point on the 
+ * ellipsoid is ambiguous. On a sphere, the center of the Earth is returned as 
+ * 0,0 with the negative radius as height. Returns nothing.
+ */
+
+void ecef_to_geodetic(const struct ellipsoid *ell, const struct vec3 *p,
+                      double *lat, double *lon, double *h)
+{
+	const double a = ell->a, e2 = ell->e2;
+	const double e2m = (1.0 - ell->f) * (1.0 - ell->f), e4 = e2 * e2;
+	const double r_xy = hypot(p->x, p->y);
+	const double pp = (r_xy / a) * (r_xy / a);
+	const double q = e2m * (p->z / a) * (p->z / a);
+	const double r = (pp + q - e4) / 6.0;
+	double sin_lat, cos_lat, hyp;
+
+	assert(p);
+	assert(lat);
+	assert(lon);
+	assert(h);
+
+	if (e2 == 0.0 && q == 0.0 && r <= 0.0) {
+		/* The center of a sphere */
+		sin_lat = 0.0;
+		cos_lat = 1.0;
+		*h = -a;
+	} else if (!(q == 0.0 && r <= 0.0)) {
+		const double s = e4 * pp * q / 4.0, r2 = r * r, r3 = r * r2;
+		const double disc = s * (s + 2.0 * r3);
+		double u = r, v, uv, w, k, d;
+
+		if (disc >= 0.0) {
+			double t3 = s + r3, t;
+
+			t3 += t3 < 0.0 ? -sqrt(disc) : sqrt(disc);
+			t = cbrt(t3);
+			u += t + (t != 0.0 ? r2 / t : 0.0);
+		} else {
+			/* Inside the evolute of the ellipse */
+			u += 2.0 * r
+			     * cos(atan2(sqrt(-disc), -(s + r3)) / 3.0);
+		}
+		v = sqrt(u * u + e4 * q);
+		uv = u < 0.0 ? e4 * q / (v - u) : u + v;
+		w = fmax(0.0, e2 * (uv - q) / (2.0 * v));
+		k = uv / (sqrt(uv + w * w) + w);
+		d = k * r_xy / (k + e2);
+		sin_lat = p->z / k;
+		cos_lat = r_xy / (k + e2);
+		hyp = hypot(sin_lat, cos_lat);
+		sin_lat /= hyp;
+		cos_lat /= hyp;
+		*h = (1.0 - e2m / k) * hypot(d, p->z);
+	} else {
+		/* On the equatorial plane inside the evolute */
+		const double zz = sqrt((e4 - pp) / e2m), xx = sqrt(pp);
+
+		hyp = hypot(zz, xx);
+		sin_lat = copysign(zz / hyp, p->z);
+		cos_lat = xx / hyp;
+		*h = -a * e2m * hyp / e2;
+	}
+	*lat = rad2deg(atan2(sin_lat, cos_lat));
+	*lon = rad2deg(atan2(p->y, p->x));
+}
+
+/*
+ * geodetic_to_ecef_batch() - Converts the `n` positions in `lat`, `lon` and 
+ * `h` on the ellipsoid `ell` to ECEF coordinates like geodetic_to_ecef(), and 
+ * stores them in `x`, `y` and `z`. The output arrays can be the same as the 
+ * input arrays. The loop has no branches, so the compiler can vectorize it. 
+ * Returns nothing.
+ */
+
+void geodetic_to_ecef_batch(const struct ellipsoid *ell,
+                            const double *lat, const double *lon,
+                            const double *h, const size_t n,
+                            double *x, double *y, double *z)
+{
+	const double a = ell->a, e2 = ell->e2;
+	size_t i;
+
+	assert(lat);
+	assert(lon);
+	assert(h);
+	assert(x);
+	assert(y);
+	assert(z);
+
+	for (i = 0; i < n; i++) {
+		const double rlat = deg2rad(lat[i]), rlon = deg2rad(lon[i]);
+		const double sin_lat = sin(rlat), cos_lat = cos(rlat);
+		const double nr = a / sqrt(1.0 - e2 * sin_lat * sin_lat);
+		const double hi = h[i];
+
+		x[i] = (nr + hi) * cos_lat * cos(rlon);
+		y[i] = (nr + hi) * cos_lat * sin(rlon);
+		z[i] = (nr * (1.0 - e2) + hi) * sin_lat;
+	}
+}
+
+/*
+ * ecef_to_geodetic_batch() - Converts the `n` ECEF coordinates in `x`, `y` 
+ * and `z` to positions on the ellipsoid `ell` with ecef_to_geodetic(), and 
+ * stores them in `lat`, `lon` and `h`. The output arrays can be the same as 
+ * the input arrays. Returns nothing.
+ */
+
+void ecef_to_geodetic_batch(const struct ellipsoid *ell,
+                            const double *x, const double *y,
+                            const double *z, const size_t n,
+                            double *lat, double *lon, double *h)
+{
+	size_t i;
+
+	assert(x);
+	assert(y);
+	assert(z);
+	assert(lat);
+	assert(lon);
+	assert(h);
+
+	for (i = 0; i < n; i++) {
+		const struct vec3 p = { x[i], y[i], z[i] };
+
+		ecef_to_geodetic(ell, &p, &lat[i], &lon[i], &h[i]);
+	}
+}
+
+/*
+ * enuframe_init() - Prepares the local East-North-Up frame in `dest` with the 
+ * origin at `lat,lon` and the height `h` meters above the ellipsoid `ell`. 
+ * The ECEF coordinates of the origin and the rows of the rotation matrix are 
+ * calculated once, so only multiplications and additions are needed for 
+ * every position. Returns nothing.
+ */
+
+void enuframe_init(struct enuframe *dest, const struct ellipsoid *ell,
+                   const double lat, const double lon, const double h)
+{
+	const double rlat = deg2rad(lat), rlon = deg2rad(lon);
+	const double sin_lat = sin(rlat), cos_lat = cos(rlat);
+	const double sin_lon = sin(rlon), cos_lon = cos(rlon);
+
+	assert(dest);
+
+	geodetic_to_ecef(ell, lat, lon, h, &dest->origin);
+	dest->east.x = -sin_lon;
+	dest->east.y = cos_lon;
+	dest->east.z = 0.0;
+	dest->north.x = -sin_lat * cos_lon;
+	dest->north.y = -sin_lat * sin_lon;
+	dest->north.z = cos_lat;
+	dest->up.x = cos_lat * cos_lon;
+	dest->up.y = cos_lat * sin_lon;
+	dest->up.z = sin_lat;
+}
+
+/*
+ * ecef_to_enu_batch() - Converts the `n` ECEF coordinates in `x`, `y` and `z` 
+ * to the local frame `f`, and stores the east, north and up components in 
+ * meters in `e`, `nn` and `u`. The output arrays can be the same as the input 
+ * arrays. Returns nothing.
+ */
+
+void ecef_to_enu_batch(const struct enuframe *f,
+                       const double *x, const double *y, const double *z,
+                       const size_t n, double *e, double *nn, double *u)
+{
+	size_t i;
+
+	assert(f);
+	assert(x);
+	assert(y);
+	assert(z);
+	assert(e);
+	assert(nn);
+	assert(u);
+
+	for (i = 0; i < n; i++) {
+		const double dx = x[i] - f->origin.x, dy = y[i] - f->origin.y,
+		             dz = z[i] - f->origin.z;
+
+		e[i] = f->east.x * dx + f->east.y * dy;
+		nn[i] = f->north.x * dx + f->north.y * dy + f->north.z * dz;
+		u[i] = f->up.x * dx + f->up.y * dy + f->up.z * dz;
+	}
+}
+
+/*
+ * enu_to_ecef_batch() - Converts the `n` east, north and up components in 
+ * `e`, `nn` and `u` from the local frame `f` to ECEF coordinates, and stores 
+ * them in `x`, `y` and `z`. The output arrays can be the same as the input 
+ * arrays. Returns nothing.
+ */
+
+void enu_to_ecef_batch(const struct enuframe *f,
+                       const double *e, const double *nn, const double *u,
+                       const size_t n, double *x, double *y, double *z)
+{
+	size_t i;
+
+	assert(f);
+	assert(e);
+	assert(nn);
+	assert(u);
+	assert(x);
+	assert(y);
+	assert(z);
+
+	for (i = 0; i < n; i++) {
+		const double de = e[i], dn = nn[i], du = u[i];
+
+		x[i] = f->origin.x + f->east.x * de + f->north.x * dn
+		       + f->up.x * du;
+		y[i] = f->origin.y + f->east.y * de + f->north.y * dn
+		       + f->up.y * du;
+		z[i] = f->origin.z + f->north.z * dn + f->up.z * du;
+	}
+}
+
+/*
+ * tmerc_taup() - Returns tan(chi), where chi is the conformal latitude, from 
+ * `tau`, which is tan(phi) of the geodetic latitude, on an ellipsoid with the 
+ * eccentricity `e`.
+ */
+
+static double tmerc_taup(const double tau, const double e)
+{
+	const double tau1 = hypot(1.0, tau);
+	const double sig = sinh(e * atanh(e * tau / tau1));
+
+	return hypot(1.0, sig) * tau - sig * tau1;
+}
+
+/*
+ * tmerc_tau() - The inverse of tmerc_taup(). Returns tan(phi) of the geodetic 
+ * latitude from `taup`, which is tan(chi) of the conformal latitude. This is 
+ * solved with Newton's method, which converges in 2 or 3 iterations.
+ */
+
+static double tmerc_tau(const struct tmerc *tm, const double taup)
+{
+	const double stol = 1.5e-9 * fmax(1.0, fabs(taup));
+	double tau = taup / tm->e2m;
+	int i;
+
+	if (!(fabs(tau) < 1.0e8))
+		return tau; /* gncov */
+	for (i = 0; i < 5; i++) {
+		const double tp = tmerc_taup(tau, tm->e);
+		const double d = (taup - tp) * (1.0 + tm->e2m * tau * tau)
+		                 / (tm->e2m * hypot(1.0, tau)
+		                    * hypot(1.0, tp));
+
+		tau += d;
+		if (!(fabs(d) >= stol))
+			break;
+	}
+
+	return tau;
+}
+
+/*
+ * tmerc_series() - Adds the Krüger series with the coefficients `c` to the 
+ * complex number `xi + i * eta`, where the sum of c[j] * sin(2 * j * zeta) 
+ * for j = 1..TMERC_ORDER is found with Clenshaw summation in complex 
+ * arithmetic. `s0` and `c0` are sin(2 * xi) and cos(2 * xi), `sh0` and `ch0` 
+ * are sinh(2 * eta) and cosh(2 * eta), so no trigonometric functions are 
+ * needed here, regardless of the order of the series. Returns nothing.
+ */
+
+static void tmerc_series(const double *c, const double s0, const double c0,
+                         const double sh0, const double ch0,
+                         double *xi, double *eta)
+{
+	const double ar = 2.0 * c0 * ch0, ai = -2.0 * s0 * sh0;
+	double y0r = 0.0, y0i = 0.0, y1r = 0.0, y1i = 0.0;
+	int j;
+
+	for (j = TMERC_ORDER; j; j--) {
+		const double tr = ar * y0r - ai * y0i - y1r + c[j];
+		const double ti = ar * y0i + ai * y0r - y1i;
+
+		y1r = y0r;
+		y1i = y0i;
+		y0r = tr;
+		y0i = ti;
+	}
+	*xi += s0 * ch0 * y0r - c0 * sh0 * y0i;
+	*eta += s0 * ch0 * y0i + c0 * sh0 * y0r;
+}
+
+/*
+ * tmerc_init() - Prepares the transverse Mercator projection in `dest` for 
+ * the ellipsoid with the semi-major axis `a` and the flattening `f`, using 
+ * the scale factor `k0` on the central meridian. The coefficients of the 
+ * 6th order Krüger series in the third flattening n are calculated once, as 
+ * given by Karney (2011), which makes the projection accurate to a few 
+ * nanometers within 35 degrees of the central meridian. Returns nothing.
+ */
+
+void tmerc_init(struct tmerc *dest, const double a, const double f,
+                const double k0)
+{
+	const double n = f / (2.0 - f), n2 = n * n;
+
+	assert(dest);
+
+	dest->e = sqrt(f * (2.0 - f));
+	dest->e2m = (1.0 - f) * (1.0 - f);
+	dest->k0a = k0 * a / (1.0 + n)
+	            * (1.0 + n2 * (1.0 / 4.0 + n2 * (1.0 / 64.0
+	                                            + n2 / 256.0)));
+
+	dest->alp[0] = 0.0;
+	dest->alp[1] = n * (1.0 / 2.0 + n * (-2.0 / 3.0 + n * (5.0 / 16.0
+	               + n * (41.0 / 180.0 + n * (-127.0 / 288.0
+	               + n * 7891.0 / 37800.0)))));
+	dest->alp[2] = n2 * (13.0 / 48.0 + n * (-3.0 / 5.0 + n * (557.0
+	               / 1440.0 + n * (281.0 / 630.0
+	               - n * 1983433.0 / 1935360.0))));
+	dest->alp[3] = n2 * n * (61.0 / 240.0 + n * (-103.0 / 140.0
+	               + n * (15061.0 / 26880.0 + n * 167603.0 / 181440.0)));
+	dest->alp[4] = n2 * n2 * (49561.0 / 161280.0 + n * (-179.0 / 168.0
+	               + n * 6601661.0 / 7257600.0));
+	dest->alp[5] = n2 * n2 * n * (34729.0 / 80640.0
+	               - n * 3418889.0 / 1995840.0);
+	dest->alp[6] = n2 * n2 * n2 * 212378941.0 / 319334400.0;
+
+	/* Negated, since the inverse series is subtracted */
+	dest->bet[0] = 0.0;
+	dest->bet[1] = -n * (1.0 / 2.0 + n * (-2.0 / 3.0 + n * (37.0 / 96.0
+	               + n * (-1.0 / 360.0 + n * (-81.0 / 512.0
+	               + n * 96199.0 / 604800.0)))));
+	dest->bet[2] = -n2 * (1.0 / 48.0 + n * (1.0 / 15.0 + n * (-437.0
+	               / 1440.0 + n * (46.0 / 105.0
+	               - n * 1118711.0 / 3870720.0))));
+	dest->bet[3] = -n2 * n * (17.0 / 480.0 + n * (-37.0 / 840.0
+	               + n * (-209.0 / 4480.0 + n * 5569.0 / 90720.0)));
+	dest->bet[4] = -n2 * n2 * (4397.0 / 161280.0 + n * (-11.0 / 504.0
+	               - n * 830251.0 / 7257600.0));
+	dest->bet[5] = -n2 * n2 * n * (4583.0 / 161280.0
+	               - n * 108847.0 / 3991680.0);
+	dest->bet[6] = -n2 * n2 * n2 * 20648693.0 / 638668800.0;
+}
+
+/*
+ * tmerc_forward() - Projects the position `lat,lon` with the transverse 
+ * Mercator projection `tm` with the central meridian `lon0`, and stores the 
+ * easting and northing in meters relative to the intersection of the central 
+ * meridian and the Equator in `x` and `y`. The double angles used by the 
+ * series are found algebraically from the conformal coordinates, which 
+ * leaves 6 calls to libm per position. Returns nothing.
+ */
+
+void tmerc_forward(const struct tmerc *tm, const double lon0,
+                   const double lat, const double lon, double *x, double *y)
+{
+	const double phi = deg2rad(lat);
+	const double sin_phi = sin(phi), cos_phi = cos(phi);
+	const double es = tm->e * sin_phi;
+	const double ex = exp(tm->e / 2.0 * log((1.0 + es) / (1.0 - es)));
+	const double sig = (ex - 1.0 / ex) / 2.0;
+	const double taup = (sqrt(1.0 + sig * sig) * sin_phi - sig) / cos_phi;
+	double dlon = lon - lon0, lam, clam, h2, q, q1, xi, eta;
+
+	assert(tm);
+	assert(x);
+	assert(y);
+
+	if (fabs(dlon) > 180.0)
+		dlon = remainder(dlon, 360.0);
+	lam = deg2rad(dlon);
+	clam = cos(lam);
+	h2 = taup * taup + clam * clam;
+	q = sin(lam) / sqrt(h2);
+	q1 = sqrt(1.0 + q * q);
+	xi = atan2(taup, clam);
+	eta = copysign(log1p(fabs(q) + q * q / (1.0 + q1)), q);
+	tmerc_series(tm->alp, 2.0 * taup * clam / h2,
+	             (clam * clam - taup * taup) / h2, 2.0 * q * q1,
+	             1.0 + 2.0 * q * q, &xi, &eta);
+	*x = tm->k0a * eta;
+	*y = tm->k0a * xi;
+}
+
+/*
+ * tmerc_reverse() - The inverse of tmerc_forward(). Converts the easting `x` 
+ * and northing `y` of the transverse Mercator projection `tm` with the 
+ * central meridian `lon0` to a position, stored in `lat` and `lon`. Returns 
+ * nothing.
+ */
+
+void tmerc_reverse(const struct tmerc *tm, const double lon0,
+                   const double x, const double y, double *lat, double *lon)
+{
+	double xi = y / tm->k0a, eta = x / tm->k0a, s, c, r;
+
+	assert(tm);
+	assert(lat);
+	assert(lon);
+
+	tmerc_series(tm->bet, sin(2.0 * xi), cos(2.0 * xi), sinh(2.0 * eta),
+	             cosh(2.0 * eta), &xi, &eta);
+	s = sinh(eta);
+	c = fmax(0.0, cos(xi));
+	r = hypot(s, c);
+	if (r != 0.0) {
+		*lat = rad2deg(atan(tmerc_tau(tm, sin(xi) / r)));
+		*lon = remainder(lon0 + rad2deg(atan2(s, c)), 360.0);
+	} else {
+		*lat = copysign(90.0, xi);
+		*lon = remainder(lon0, 360.0);
+	}
+}
+
+/*
+ * utm_init() - Prepares the transverse Mercator projection in `dest` for UTM 
+ * on the ellipsoid `ell`. Returns nothing.
+ */
+
+void utm_init(struct tmerc *dest, const struct ellipsoid *ell)
+{
+	tmerc_init(dest, ell->a, ell->f, 0.9996);
+}
+
+/*
+ * utm_bandnum() - Returns the number of the 8 degree latitude band of the UTM 
+ * and MGRS system that contains `lat`, from 0 (C) to 19 (X). The X band is 12 
+ * degrees high. `lat` must be in the range -80..84.
+ */
+
+static int utm_bandnum(const double lat)
+{
+	const double band = floor((floor(lat) + 80.0) / 8.0);
+
+	return band > 19.0 ? 19 : (int)band;
+}
+
+/*
+ * utm_zone() - Returns the UTM zone (1..60) of the position `lat,lon`, with 
+ * the exceptions for southwestern Norway and Svalbard. Returns 0 if the 
+ * latitude is outside the UTM area, which is -80..84, or if the position is 
+ * invalid.
+ */
+
+int utm_zone(const double lat, const double lon)
+{
+	double flon;
+	int ilon, zone, band;
+
+	if (!(lat >= -80.0 && lat <= 84.0) || !(fabs(lon) <= 180.0))
+		return 0;
+	flon = floor(lon);
+	ilon = (int)flon;
+	if (ilon == 180)
+		ilon = -180;
+	zone = (ilon + 186) / 6;
+	band = utm_bandnum(lat);
+	if (band == 17 && zone == 31 && ilon >= 3)
+		zone = 32;
+	else if (band == 19 && ilon >= 0 && ilon < 42)
+		zone = 2 * ((ilon + 183) / 12) + 1;
+
+	return zone;
+}
+
+/*
+ * utm_band() - Returns the latitude band letter of `lat`, from 'C' to 'X', or 
+ * 0 if the latitude is outside the UTM area.
+ */
+
+char utm_band(const double lat)
+{
+	if (!(lat >= -80.0 && lat <= 84.0))
+		return 0;
+
+	return "CDEFGHJKLMNPQRSTUVWX"[utm_bandnum(lat)];
+}
+
+/*
+ * utm_forward() - Converts the position `lat,lon` to UTM with the projection 
+ * `tm` from utm_init(). The zone is stored in `zone`, and the easting and 
+ * northing in meters in `easting` and `northing`. The false northing of 
+ * 10000 km is used south of the Equator. Returns 1 if the position is outside 
+ * the UTM area, otherwise 0.
+ */
+
+int utm_forward(const struct tmerc *tm, const double lat, const double lon,
+                int *zone, double *easting, double *northing)
+{
+	double x, y;
+
+	assert(tm);
+	assert(zone);
+	assert(easting);
+	assert(northing);
+
+	*zone = utm_zone(lat, lon);
+	if (!*zone)
+		return 1;
+	tmerc_forward(tm, 6.0 * *zone - 183.0, lat, lon, &x, &y);
+	*easting = x + 500000.0;
+	*northing = lat < 0.0 ? y + 10000000.0 : y;
+
+	return 0;
+}
+
+/*
+ * utm_reverse() - Converts the UTM coordinates `easting` and `northing` in the 
+ * zone `zone` to a position with the projection `tm` from utm_init(), and 
+ * stores it in `lat` and `lon`. `north` is 0 for the southern hemisphere. 
+ * Returns 1 if the zone is invalid, otherwise 0.
+ */
+
+int utm_reverse(const struct tmerc *tm, const int zone, const int north,
+                const double easting, const double northing,
+                double *lat, double *lon)
+{
+	assert(tm);
+	assert(lat);
+	assert(lon);
+
+	if (zone < 1 || zone > 60)
+		return 1;
+	tmerc_reverse(tm, 6.0 * zone - 183.0, easting - 500000.0,
+	              north ? northing : northing - 10000000.0, lat, lon);
+
+	return 0;
+}
+
+/*
+ * utm_forward_batch() - Converts the `n` positions in `lat` and `lon` to UTM 
+ * like utm_forward(), and stores the zones in `zone` and the coordinates in 
+ * `easting` and `northing`. The ellipsoid constants and the series 
+ * coefficients are read from `tm` once, and the central meridian is only 
+ * recalculated when the zone changes, which is rare in typical data sets. 
+ * Positions outside the UTM area get zone 0 and NAN as coordinates. Returns 
+ * the number of such positions.
+ */
+
+size_t utm_forward_batch(const struct tmerc *tm,
+                         const double *lat, const double *lon,
+                         const size_t n, int *zone,
+                         double *easting, double *northing)
+{
+	const struct tmerc t = *tm;
+	double lon0 = 0.0;
+	int prev = 0;
+	size_t i, outside = 0;
+
+	assert(tm);
+	assert(lat);
+	assert(lon);
+	assert(zone);
+	assert(easting);
+	assert(northing);
+
+	for (i = 0; i < n; i++) {
+		const int z = utm_zone(lat[i], lon[i]);
+		double x, y;
+
+		zone[i] = z;
+		if (!z) {
+			easting[i] = northing[i] = NAN;
+			outside++;
+			continue;
+		}
+		if (z != prev) {
+			lon0 = 6.0 * z - 183.0;
+			prev = z;
+		}
+		tmerc_forward(&t, lon0, lat[i], lon[i], &x, &y);
+		easting[i] = x + 500000.0;
+		northing[i] = lat[i] < 0.0 ? y + 10000000.0 : y;
+	}
+
+	return outside;
+}
+
+/*
+ * mgrs_encode() - Stores the MGRS reference of the UTM coordinates `easting` 
+ * and `northing` in the zone `zone` in `dest`, which must have room for 
+ * MGRS_MAX_LEN + 1 bytes. `lat` is used for the latitude band. `digits` is 
+ * the number of digits of the easting and northing within the 100 km square, 
+ * 0..5, where 5 gives a precision of 1 meter. The coordinates are truncated, 
+ * as the MGRS standard requires. Returns 1 if any of the values are invalid, 
+ * otherwise 0.
+ */
+
+int mgrs_encode(const double lat, const int zone, const double easting,
+                const double northing, const int digits, char *dest)
+{
+	static const char cols[] = "ABCDEFGHJKLMNPQRSTUVWXYZ";
+	static const char rows[] = "ABCDEFGHJKLMNPQRSTUV";
+	const char band = utm_band(lat);
+	unsigned long e, nn, div = 1, col, row;
+	double fe, fn;
+	int i, len;
+
+	assert(dest);
+
+	if (!band || zone < 1 || zone > 60 || digits < 0 || digits > 5
+	    || !(easting >= 100000.0 && easting < 900000.0)
+	    || !(northing >= 0.0 && northing < 10000000.0))
+		return 1;
+	fe = floor(easting);
+	fn = floor(northing);
+	e = (unsigned long)fe;
+	nn = (unsigned long)fn;
+	col = (unsigned long)((zone - 1) % 3 * 8) + e / 100000 - 1;
+	row = (nn / 100000 + (zone % 2 ? 0 : 5)) % 20;
+	for (i = digits; i < 5; i++)
+		div *= 10;
+	len = snprintf(dest, MGRS_MAX_LEN + 1, "%02d%c%c%c", zone, band,
+	               cols[col], rows[row]);
+	if (digits)
+		snprintf(dest + len, MGRS_MAX_LEN + 1 - (size_t)len,
+		         "%0*lu%0*lu", digits, e % 100000 / div,
+		         digits, nn % 100000 / div);
+
+	return 0;
+}
+
+/*
+ * centroid_init() - Initializes the sums in `dest`, used to find the centroid 
+ * of a set of positions. Returns nothing.
+ */
+
+void centroid_init(struct centroid *dest)
+{
+	assert(dest);
+
+	compsum_init(&dest->dx);
+	compsum_init(&dest->dy);
+	compsum_init(&dest->dz);
+	compsum_init(&dest->dist2);
+	compsum_init(&dest->weight);
+	dest->count = 0;
+}
+
+/*
+ * centroid_add() - Adds the position `lat,lon` with the weight `weight` to 
+ * the centroid in `c`. The unit vector of the first position is used as a 
+ * reference, and the weighted differences from it and their squared lengths 
+ * are added with compensated summation. This way the small differences 
+ * between positions that are close to each other aren't lost, and the result 
+ * doesn't depend on the number of positions. Returns nothing.
+ */
+
+void centroid_add(struct centroid *c, const double lat, const double lon,
+                  const double weight)
+{
+	struct vec3 v, d;
+
+	assert(c);
+
+	pos_to_vec3(lat, lon, &v);
+	if (!c->count++)
+		c->ref = v;
+	d.x = v.x - c->ref.x;
+	d.y = v.y - c->ref.y;
+	d.z = v.z - c->ref.z;
+	compsum_add(&c->dx, d.x * weight);
+	compsum_add(&c->dy, d.y * weight);
+	compsum_add(&c->dz, d.z * weight);
+	compsum_add(&c->dist2, vec3_dot(&d, &d) * weight);
+	compsum_add(&c->weight, weight);
+}
+
+/*
+ * centroid_result() - Stores the centroid of the positions in `c` in `lat` 
+ * and `lon`. This is the position of the sum of the weighted unit vectors, 
+ * i.e. the position on the surface that minimizes the weighted sum of the 
+ * squared chord lengths to the positions. The length of the mean vector, 
+ * between 0 and 1, is stored in `resultant`. It's 1 if all positions are 
+ * identical, and close to 0 if they're spread evenly around the globe. The 
+ * circular standard deviation in radians, sqrt(-2 ln `resultant`), is stored 
+ * in `dispersion`. It's calculated from the differences to the reference 
+ * position, since `resultant` is too close to 1 for positions that are close 
+ * to each other. Returns 1 if the centroid is undefined because the total 
+ * weight or the mean vector is zero, otherwise 0.
+ */
+
+int centroid_result(const struct centroid *c, double *lat, double *lon,
+                    double *resultant, double *dispersion)
+{
+	struct vec3 d, v;
+	const double weight = compsum_result(&c->weight);
+	double e;
+
+	assert(c);
+	assert(lat);
+	assert(lon);
+	assert(resultant);
+	assert(dispersion);
+
+	*resultant = *dispersion = 0.0;
+	if (!(weight > 0.0))
+		return 1;
+	d.x = compsum_result(&c->dx);
+	d.y = compsum_result(&c->dy);
+	d.z = compsum_result(&c->dz);
+	v.x = c->ref.x * weight + d.x;
+	v.y = c->ref.y * weight + d.y;
+	v.z = c->ref.z * weight + d.z;
+
+	/*
+	 * weight^2 - |v|^2, expanded with ref . d_i = -|d_i|^2 / 2 to avoid 
+	 * the cancellation.
+	 */
+	e = (weight * compsum_result(&c->dist2) - vec3_dot(&d, &d))
+	    / (weight * weight);
+	e = fmax(0.0, fmin(1.0, e));
+	*resultant = sqrt(1.0 - e);
+	if (*resultant < 1e-9)
+		return 1;
+	*dispersion = sqrt(-log1p(-e));
+	vec3_to_pos(&v, lat, lon);
+
+	return 0;
+}
+
+/*
+ * authalic_q() - Returns the q function of the authalic latitude for an 
+ * ellipsoid with the eccentricity `e` at the latitude with the sine 
+ * `sin_lat`. The area between the Equator and the latitude is proportional to 
+ * this value.
+ */
+
+static double authalic_q(const double sin_lat, const double e)
+{
+	const double es = e * sin_lat;
+
+	return (1.0 - e * e) * (sin_lat / (1.0 - es * es) + atanh(es) / e);
+}
+
+/*
+ * polyarea_init() - Initializes `dest` for area and perimeter calculations of 
+ * polygons. With FRM_KARNEY, the latitudes are converted to authalic 
+ * latitudes on a sphere with the same area as the ellipsoid `ell`, and the 
+ * perimeter is calculated with geod_distance(). On a sphere, the latitudes 
+ * are used as they are. Otherwise the Haversine formula and EARTH_RADIUS is 
+ * used. `ell` must be valid as long as `dest` is in use. Returns nothing.
+ */
+
+void polyarea_init(struct polyarea *dest, const DistFormula formula,
+                   const struct ellipsoid *ell)
+{
+	assert(dest);
+
+	memset(dest, 0, sizeof(*dest));
+	dest->formula = formula;
+	dest->ell = ell;
+	dest->radius = EARTH_RADIUS;
+	if (formula == FRM_KARNEY) {
+		dest->radius = ell->a;
+		if (ell->e2 > 0.0) {
+			dest->e = sqrt(ell->e2);
+			dest->qp = authalic_q(1.0, dest->e);
+			dest->radius *= sqrt(dest->qp / 2.0);
+		}
+	}
+	compsum_init(&dest->ring);
+	compsum_init(&dest->area);
+	compsum_init(&dest->perimeter);
+}
+
+/*
+ * polyarea_edge() - Adds the edge from the previous vertex in `pa` to 
+ * `lat,lon` to the area of the current ring and to the perimeter. `tan_half` 
+ * is the tangent of half the (authalic) latitude, and `cos_lat` is the cosine 
+ * of the latitude. The signed area between the edge and the North Pole is 
+ * the longitude difference minus the spherical excess of the trapezoid 
+ * between the edge and the Equator, which is calculated with the half-angle 
+ * tangent formula. It has no cancellation problems, even for short edges. 
+ * Returns nothing.
+ */
+
+static void polyarea_edge(struct polyarea *pa,
+                          const double lat, const double lon,
+                          const double tan_half, const double cos_lat)
+{
+	double dlon = deg2rad(lon - pa->prev_lon), excess, dist;
+
+	if (dlon > M_PI)
+		dlon -= 2.0 * M_PI;
+	else if (dlon < -M_PI)
+		dlon += 2.0 * M_PI;
+	excess = 2.0 * atan2(sin(dlon / 2.0) * (pa->prev_tan + tan_half),
+	                     cos(dlon / 2.0)
+	                     * (1.0 + pa->prev_tan * tan_half));
+	compsum_add(&pa->ring, dlon - excess);
+
+	if (pa->formula == FRM_KARNEY) {
+		dist = geod_distance(pa->ell, pa->prev_lat, pa->prev_lon,
+		                     lat, lon);
+	} else {
+		dist = haversine_arc(pa->prev_lat, pa->prev_lon, lat, lon,
+		                     pa->prev_cos, cos_lat);
+		dist = isnan(dist) ? MAX_EARTH_DISTANCE
+		                   : EARTH_RADIUS * dist;
+	}
+	compsum_add(&pa->perimeter, dist);
+}
+
+/*
+ * polyarea_add() - Adds the vertex `lat,lon` to the current ring in `pa`. The 
+ * vertices aren't stored, only the first and the previous one. Returns 
+ * nothing.
+ */
+
+void polyarea_add(struct polyarea *pa, const double lat, const double lon)
+{
+	const double lat_rad = deg2rad(lat);
+	const double cos_lat = cos(lat_rad);
+	double tan_half;
+
+	assert(pa);
+
+	if (pa->e > 0.0) {
+		const double q = authalic_q(sin(lat_rad), pa->e) / pa->qp;
+
+		tan_half = tan(asin(fmax(-1.0, fmin(1.0, q))) / 2.0);
+	} else {
+		tan_half = tan(lat_rad / 2.0);
+	}
+	if (pa->ringcount) {
+		polyarea_edge(pa, lat, lon, tan_half, cos_lat);
+	} else {
+		pa->first_lat = lat;
+		pa->first_lon = lon;
+		pa->first_tan = tan_half;
+		pa->first_cos = cos_lat;
+	}
+	pa->prev_lat = lat;
+	pa->prev_lon = lon;
+	pa->prev_tan = tan_half;
+	pa->prev_cos = cos_lat;
+	pa->ringcount++;
+	pa->count++;
+}
+
+/*
+ * polyarea_close() - Closes the current ring in `pa` with an edge back to the 
+ * first vertex, and adds the area of the ring to the total area. The area is 
+ * positive if the vertices are listed counterclockwise, and it's reduced to 
+ * the range (-2π, 2π], so a ring that encloses more than half the Earth gets 
+ * the negative area of the rest of the Earth. Does nothing if the ring is 
+ * empty. Returns nothing.
+ */
+
+void polyarea_close(struct polyarea *pa)
+{
+	double area;
+
+	assert(pa);
+
+	if (!pa->ringcount)
+		return;
+	polyarea_edge(pa, pa->first_lat, pa->first_lon, pa->first_tan,
+	              pa->first_cos);
+	area = remainder(compsum_result(&pa->ring), 4.0 * M_PI);
+	if (area <= -2.0 * M_PI)
+		area += 4.0 * M_PI;
+	compsum_add(&pa->area, area);
+	compsum_init(&pa->ring);
+	pa->ringcount = 0;
+	pa->rings++;
+}
+
+/*
+ * polyarea_result() - Stores the total signed area of the closed rings in 
+ * `pa` in `area` in square meters, and the total perimeter in meters in 
+ * `perimeter`. Returns 1 if the perimeter couldn't be calculated because 
+ * geod_distance() didn't converge, otherwise 0.
+ */
+
+int polyarea_result(const struct polyarea *pa, double *area,
+                    double *perimeter)
+{
+	assert(pa);
+	assert(area);
+	assert(perimeter);
+
+	*area = compsum_result(&pa->area) * pa->radius * pa->radius;
+	*perimeter = compsum_result(&pa->perimeter);
+
+	return isnan(*perimeter) ? 1 : 0;
+}
+
+/*
+ * arc_init() - Prepares `dest` for distance calculations to the shortest 
+ * great-circle arc between the unit vectors `a` and `b`. The pole of the 
+ * great circle and the vectors used to check if a point is beside the arc 
+ * are calculated here, so arc_angle() only needs a few dot products for 
+ * every point. If `a` and `b` are coincident or antipodal, the arc has no 
+ * defined great circle, and only the distance to the endpoints is used. 
+ * Returns nothing.
+ */
+
+void arc_init(struct arc *dest, const struct vec3 *a, const struct vec3 *b)
+{
+	double len;
+
+	assert(dest);
+	assert(a);
+	assert(b);
+
+	dest->a = *a;
+	dest->b = *b;
+	vec3_cross(a, b, &dest->pole);
+	len = sqrt(vec3_dot(&dest->pole, &dest->pole));
+	dest->degenerate = len < 1e-15;
+	if (dest->degenerate)
+		return;
+	dest->pole.x /= len;
+	dest->pole.y /= len;
+	dest->pole.z /= len;
+	vec3_cross(&dest->pole, a, &dest->pole_a);
+	vec3_cross(b, &dest->pole, &dest->b_pole);
+}
+
+/*
+ * circle_angle() - Returns the signed angle in radians between the unit vector 
+ * `p` and the plane of the great circle with the pole `pole`, positive on the 
+ * same side as the pole. The length of the projection onto the plane is used 
+ * with atan2() instead of asin(), which loses precision close to the pole.
+ */
+
+static double circle_angle(const struct vec3 *pole, const struct vec3 *p)
+{
+	struct vec3 c;
+
+	vec3_cross(p, pole, &c);
+
+	return atan2(vec3_dot(p, pole), sqrt(vec3_dot(&c, &c)));
+}
+
+/*
+ * arc_beside() - Returns 1 if the unit vector `p` is between the planes 
+ * through the pole and the endpoints of the arc in `arc`, i.e. if the nearest 
+ * point on the great circle is on the arc, otherwise 0. The arc must not be 
+ * degenerate.
+ */
+
+static int arc_beside(const struct arc *arc, const struct vec3 *p)
+{
+	return vec3_dot(p, &arc->pole_a) >= 0.0
+	       && vec3_dot(p, &arc->b_pole) >= 0.0;
+}
+
+/*
+ * arc_angle() - Returns the angular distance in radians from the unit vector 
+ * `p` to the nearest point on the arc in `arc`, prepared by arc_init(). If 
+ * the point is beside the arc, this is the cross-track distance to the great 
+ * circle, otherwise it's the distance to the nearest endpoint.
+ */
+
+double arc_angle(const struct arc *arc, const struct vec3 *p)
+{
+	assert(arc);
+	assert(p);
+
+	if (!arc->degenerate && arc_beside(arc, p))
+		return fabs(circle_angle(&arc->pole, p));
+
+	return fmin(vec3_angle(p, &arc->a), vec3_angle(p, &arc->b));
+}
+
+/*
+ * arc_cross_track() - Returns the signed angular distance in radians from the 
+ * unit vector `p` to the great circle through the arc in `arc`, prepared by 
+ * arc_init(). The value is positive if `p` is to the right of the great 
+ * circle when moving from the start to the end of the arc, and negative if 
+ * it's to the left. Returns NaN if the arc is degenerate.
+ */
+
+double arc_cross_track(const struct arc *arc, const struct vec3 *p)
+{
+	assert(arc);
+	assert(p);
+
+	if (arc->degenerate)
+		return NAN;
+
+	return -circle_angle(&arc->pole, p);
+}
+
+/*
+ * arc_along_track() - Returns the signed angular distance in radians from the 
+ * start of the arc in `arc` to the point on the great circle closest to the 
+ * unit vector `p`, measured in the direction of the arc. The value is 
+ * negative if the closest point is behind the start of the arc. Returns NaN if 
+ * the arc is degenerate.
+ */
+
+double arc_along_track(const struct arc *arc, const struct vec3 *p)
+{
+	assert(arc);
+	assert(p);
+
+	if (arc->degenerate)
+		return NAN;
+
+	return atan2(vec3_dot(p, &arc->pole_a), vec3_dot(p, &arc->a));
+}
+
+/*
+ * cross_track_batch() - Calculates the cross-track and along-track distances 
+ * in meters from the `n` positions in `lat` and `lon` to the great circle 
+ * through the arc in `arc`, prepared by arc_init(). The pole of the great 
+ * circle is only calculated once, so this is a lot faster than calculating 
+ * the distances from bearings and the Haversine formula for every position. 
+ * The results are stored in `xtrack` and `atrack`, and any of them can be 
+ * NULL if the value isn't needed. Returns nothing.
+ */
+
+void cross_track_batch(const struct arc *arc,
+                       const double *lat, const double *lon, const size_t n,
+                       double *xtrack, double *atrack)
+{
+	size_t i;
+
+	assert(arc);
+	assert(lat);
+	assert(lon);
+
+	for (i = 0; i < n; i++) {
+		struct vec3 p;
+
+		pos_to_vec3(lat[i], lon[i], &p);
+		if (xtrack)
+			xtrack[i] = arc_cross_track(arc, &p) * EARTH_RADIUS;
+		if (atrack)
+			atrack[i] = arc_along_track(arc, &p) * EARTH_RADIUS;
+	}
+}
+
+/*
+ * arc_intersect() - Finds the intersection of the great circles through the 
+ * arcs `a1` and `a2`, prepared by arc_init(). The great circles intersect in 
+ * two antipodal points along the cross product of the poles, and the one 
+ * closest to the middle of `a1` is stored in `dest` as a unit vector. Since 
+ * an arc is shorter than half a great circle, this is the only one of the 
+ * points that can be on `a1`. Returns 1 if the point is on both arcs, 0 if 
+ * it's outside one of them, or -1 if an arc is degenerate or the great 
+ * circles are identical, and the intersection is undefined.
+ */
+
+int arc_intersect(const struct arc *a1, const struct arc *a2,
+                  struct vec3 *dest)
+{
+	struct vec3 mid;
+	double len;
+
+	assert(a1);
+	assert(a2);
+	assert(dest);
+
+	if (a1->degenerate || a2->degenerate)
+		return -1;
+	vec3_cross(&a1->pole, &a2->pole, dest);
+	len = sqrt(vec3_dot(dest, dest));
+	if (len < 1e-15)
+		return -1;
+	mid.x = a1->a.x + a1->b.x;
+	mid.y = a1->a.y + a1->b.y;
+	mid.z = a1->a.z + a1->b.z;
+	if (vec3_dot(dest, &mid) < 0.0)
+		len = -len;
+	dest->x /= len;
+	dest->y /= len;
+	dest->z /= len;
+
+	return arc_beside(a1, dest) && arc_beside(a2, dest);
+}
+
+/*
+ * intersect_batch() - Finds the positions where the arc in `arc`, prepared by 
+ * arc_init(), crosses the legs between the `n` consecutive positions in `lat` 
+ * and `lon`. The arc is only prepared once, so every leg needs one more 
+ * arc_init() and a few cross and dot products. For every crossing, the 
+ * position is stored in `dlat` and `dlon`, the along-track distance in meters 
+ * from the start of `arc` in `atrack`, and the index of the first position of 
+ * the leg in `leg`. The arrays must have room for `n - 1` elements. Legs 
+ * between identical or antipodal positions and legs on the same great circle 
+ * as `arc` are skipped. Returns the number of crossings.
+ */
+
+size_t intersect_batch(const struct arc *arc,
+                       const double *lat, const double *lon, const size_t n,
+                       double *dlat, double *dlon, double *atrack,
+                       size_t *leg)
+{
+	struct vec3 prev, cur;
+	size_t i, found = 0;
+
+	assert(arc);
+	assert(lat);
+	assert(lon);
+	assert(dlat);
+	assert(dlon);
+	assert(atrack);
+	assert(leg);
+
+	if (!n)
+		return 0;
+	pos_to_vec3(lat[0], lon[0], &prev);
+	for (i = 1; i < n; i++) {
+		struct arc l;
+		struct vec3 x;
+
+		pos_to_vec3(lat[i], lon[i], &cur);
+		arc_init(&l, &prev, &cur);
+		if (arc_intersect(arc, &l, &x) == 1) {
+			vec3_to_pos(&x, &dlat[found], &dlon[found]);
+			atrack[found] = arc_along_track(arc, &x)
+			                * EARTH_RADIUS;
+			leg[found++] = i - 1;
+		}
+		prev = cur;
+	}
+
+	return found;
+}
+
+/*
+ * mover_init() - Prepares `dest` for an object that starts at `lat,lon` and 
+ * moves along a great circle with the initial bearing `bearing_deg` degrees 
+ * and the speed `speed` meters per second. The direction is stored as the 
+ * unit vector pointing along the great circle at the start, so the position 
+ * at any time is a rotation of the start vector towards it. Returns nothing.
+ */
+
+void mover_init(struct mover *dest, const double lat, const double lon,
+                const double bearing_deg, const double speed)
+{
+	const double rlat = deg2rad(lat), rlon = deg2rad(lon),
+	             rbear = deg2rad(bearing_deg);
+	const double nb = cos(rbear), eb = sin(rbear);
+
+	assert(dest);
+
+	pos_to_vec3(lat, lon, &dest->pos);
+	dest->dir.x = -sin(rlat) * cos(rlon) * nb - sin(rlon) * eb;
+	dest->dir.y = -sin(rlat) * sin(rlon) * nb + cos(rlon) * eb;
+	dest->dir.z = cos(rlat) * nb;
+	dest->rate = speed / EARTH_RADIUS;
+}
+
+/*
+ * mover_pos() - Stores the unit vector of the position of the object in `m` 
+ * after `t` seconds in `dest`. Returns nothing.
+ */
+
+void mover_pos(const struct mover *m, const double t, struct vec3 *dest)
+{
+	const double c = cos(m->rate * t), s = sin(m->rate * t);
+
+	assert(m);
+	assert(dest);
+
+	dest->x = m->pos.x * c + m->dir.x * s;
+	dest->y = m->pos.y * c + m->dir.y * s;
+	dest->z = m->pos.z * c + m->dir.z * s;
+}
+
+/*
+ * cpa_slope() - Returns the derivative at the time `t` of the cosine of the 
+ * distance between two moving objects, where `c` contains the coefficients of 
+ * the sinusoids with the frequencies `diff` and `sum`, already multiplied by 
+ * the frequencies. Used by closest_approach().
+ */
+
+static double cpa_slope(const double *c, const double diff, const double sum,
+                        const double t)
+{
+	return c[1] * cos(diff * t) - c[0] * sin(diff * t)
+	       + c[3] * cos(sum * t) - c[2] * sin(sum * t);
+}
+
+/*
+ * cpa_curve() - Returns the second derivative at the time 0 of the cosine of 
+ * the distance between two moving objects, with the same arguments as 
+ * cpa_slope(). Used by closest_approach().
+ */
+
+static double cpa_curve(const double *c, const double diff, const double sum)
+{
+	return -diff * c[0] - sum * c[2];
+}
+
+/*
+ * closest_approach() - Finds the time when the objects in `m1` and `m2`, 
+ * prepared by mover_init(), are closest to each other. The dot product of 
+ * the positions, i.e. the cosine of the distance, is a sum of two sinusoids 
+ * with the difference and the sum of the angular speeds as frequencies, and 
+ * the coefficients are calculated once from the start and direction vectors. 
+ * The derivative of this sum is evaluated in steps of a quarter of the 
+ * shortest period until it changes sign, and the root is refined by 
+ * bisection. The angular distance at that time is stored in `angle`. If the 
+ * objects aren't getting closer at the start, the closest approach is now. 
+ * If the derivative is zero at the start, like for objects heading north on 
+ * parallel meridians, the sign of the second derivative decides. 
+ * Returns the time in seconds, or -1.0 if no closest approach was found 
+ * within CPA_MAX_STEPS steps.
+ */
+
+double closest_approach(const struct mover *m1, const struct mover *m2,
+                        double *angle)
+{
+	const double aa = vec3_dot(&m1->pos, &m2->pos),
+	             au = vec3_dot(&m1->pos, &m2->dir),
+	             ua = vec3_dot(&m1->dir, &m2->pos),
+	             uu = vec3_dot(&m1->dir, &m2->dir);
+	const double diff = m1->rate - m2->rate, sum = m1->rate + m2->rate;
+	const double c[4] = {
+		diff * (aa + uu) / 2.0, diff * (ua - au) / 2.0,
+		sum * (aa - uu) / 2.0, sum * (au + ua) / 2.0
+	};
+	const double slope = cpa_slope(c, diff, sum, 0.0);
+	const bool approaching = slope > 0.0
+	                         || (slope == 0.0
+	                             && cpa_curve(c, diff, sum) > 0.0);
+	double lo = 0.0, hi = 0.0, t = 0.0;
+	struct vec3 v1, v2;
+
+	assert(m1);
+	assert(m2);
+	assert(angle);
+
+	if (sum > 0.0 && approaching) {
+		const double step = M_PI / (2.0 * sum);
+		unsigned long i;
+
+		for (i = 0; i < CPA_MAX_STEPS; i++) {
+			hi = lo + step;
+			if (cpa_slope(c, diff, sum, hi) <= 0.0)
+				break;
+			lo = hi;
+		}
+		if (i == CPA_MAX_STEPS)
+			return -1.0;
+		while ((t = (lo + hi) / 2.0) > lo && t < hi) {
+			if (cpa_slope(c, diff, sum, t) > 0.0)
+				lo = t;
+			else
+				hi = t;
+		}
+	}
+
+	mover_pos(m1, t, &v1);
+	mover_pos(m2, t, &v2);
+	*angle = vec3_angle(&v1, &v2);
+
+	return t;
+}
+
+/*
+ * polyline_init() - Initializes the empty route in `dest`. Returns nothing.
+ */
+
+void polyline_init(struct polyline *dest)
+{
+	assert(dest);
+
+	dest->legs = NULL;
+	dest->blocks = NULL;
+	dest->n = dest->alloc = 0;
+	dest->has_prev = 0;
+	compsum_init(&dest->len);
+}
+
+/*
+ * polyline_free() - Deallocates the legs of the route in `pl`. Returns 
+ * nothing.
+ */
+
+void polyline_free(struct polyline *pl)
+{
+	assert(pl);
+
+	free(pl->blocks);
+	free(pl->legs);
+	polyline_init(pl);
+}
+
+/*
+ * cap_set_radius() - Sets the radius of the spherical cap `cap` to `radius` 
+ * radians, or to the whole sphere if `radius` is larger than pi. Returns 
+ * nothing.
+ */
+
+static void cap_set_radius(struct cap *cap, const double radius)
+{
+	cap->radius = fmin(radius, M_PI);
+	cap->cos_radius = cos(cap->radius);
+	cap->sin_radius = sin(cap->radius);
+}
+
+/*
+ * cap_beyond() - Returns 1 if every point in the spherical cap `cap` is 
+ * further away from the unit vector `p` than `best` radians, where `cos_best` 
+ * and `sin_best` are the cosine and sine of `best`. This is the case if the 
+ * angle between `p` and the center of the cap is larger than `best` plus the 
+ * radius of the cap. A small margin makes sure that legs at the same distance 
+ * aren't skipped because of rounding errors. Otherwise, returns 0.
+ */
+
+static int cap_beyond(const struct cap *cap, const struct vec3 *p,
+                      const double best, const double cos_best,
+                      const double sin_best)
+{
+	return best + cap->radius < M_PI
+	       && vec3_dot(p, &cap->center)
+	          < cos_best * cap->cos_radius - sin_best * cap->sin_radius
+	            - 1e-14;
+}
+
+/*
+ * polyline_grow() - Makes room for more legs in `pl`. The number of allocated 
+ * legs is always a multiple of POLYLINE_BLOCK, so the blocks are allocated 
+ * together with the legs. Returns 1 if the memory allocation failed, 
+ * otherwise 0.
+ */
+
+static int polyline_grow(struct polyline *pl)
+{
+	const size_t alloc = pl->alloc ? pl->alloc * 2 : POLYLINE_BLOCK * 2;
+	struct leg *legs;
+	struct cap *blocks;
+
+	legs = realloc(pl->legs, alloc * sizeof(*legs));
+	if (!legs) {
+		failed("realloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+	pl->legs = legs;
+	blocks = realloc(pl->blocks,
+	                 alloc / POLYLINE_BLOCK * sizeof(*blocks));
+	if (!blocks) {
+		failed("realloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+	pl->blocks = blocks;
+	pl->alloc = alloc;
+
+	return 0;
+}
+
+/*
+ * polyline_add() - Adds the position `lat,lon` to the end of the route in 
+ * `pl`. Unless it's the first position or the first position after 
+ * polyline_break(), a new leg is created from the previous position. The 
+ * great circle of the leg is prepared with arc_init(), and the smallest 
+ * spherical cap that contains the leg is stored in the leg. Every 
+ * POLYLINE_BLOCK legs are also collected in a block with a cap that contains 
+ * the caps of all legs in the block, centered on the first leg. The caps are 
+ * used by polyline_nearest() to skip legs that can't be closer than the 
+ * closest leg found so far. Returns 1 if the memory allocation failed, 
+ * otherwise 0.
+ */
+
+int polyline_add(struct polyline *pl, const double lat, const double lon)
+{
+	struct vec3 p;
+	struct leg *leg;
+	struct cap *block;
+	double len;
+
+	assert(pl);
+
+	pos_to_vec3(lat, lon, &p);
+	if (!pl->has_prev) {
+		pl->prev = p;
+		pl->has_prev = 1;
+		return 0;
+	}
+	if (pl->n == pl->alloc && polyline_grow(pl))
+		return 1; /* gncov */
+
+	leg = &pl->legs[pl->n];
+	arc_init(&leg->arc, &pl->prev, &p);
+	leg->len = vec3_angle(&pl->prev, &p);
+	leg->start = compsum_result(&pl->len);
+	compsum_add(&pl->len, leg->len);
+	leg->cap.center.x = pl->prev.x + p.x;
+	leg->cap.center.y = pl->prev.y + p.y;
+	leg->cap.center.z = pl->prev.z + p.z;
+	len = sqrt(vec3_dot(&leg->cap.center, &leg->cap.center));
+	if (len < 1e-15) {
+		/* Antipodal, the cap is the whole sphere */
+		cap_set_radius(&leg->cap, M_PI);
+	} else {
+		leg->cap.center.x /= len;
+		leg->cap.center.y /= len;
+		leg->cap.center.z /= len;
+		cap_set_radius(&leg->cap, leg->len / 2.0);
+	}
+
+	block = &pl->blocks[pl->n / POLYLINE_BLOCK];
+	if (!(pl->n % POLYLINE_BLOCK)) {
+		*block = leg->cap;
+	} else {
+		const double r = vec3_angle(&block->center, &leg->cap.center)
+		                 + leg->cap.radius;
+
+		if (r > block->radius)
+			cap_set_radius(block, r);
+	}
+	pl->n++;
+	pl->prev = p;
+
+	return 0;
+}
+
+/*
+ * polyline_break() - Ends the current segment of the route in `pl`, the next 
+ * position added with polyline_add() starts a new segment without a leg to 
+ * the previous position. Returns nothing.
+ */
+
+void polyline_break(struct polyline *pl)
+{
+	assert(pl);
+
+	pl->has_prev = 0;
+}
+
+/*
+ * leg_nearest() - Returns the angular distance in radians from the unit 
+ * vector `p` to the nearest point on the leg `leg`, and stores the angular 
+ * distance from the start of the leg to that point in `along`.
+ */
+
+static double leg_nearest(const struct leg *leg, const struct vec3 *p,
+                          double *along)
+{
+	const struct arc *arc = &leg->arc;
+	double da, db;
+
+	if (!arc->degenerate && vec3_dot(p, &arc->pole_a) >= 0.0
+	    && vec3_dot(p, &arc->b_pole) >= 0.0) {
+		*along = fmin(leg->len,
+		              fmax(0.0, arc_along_track(arc, p)));
+		return fabs(arc_cross_track(arc, p));
+	}
+
+	da = vec3_angle(p, &arc->a);
+	db = vec3_angle(p, &arc->b);
+	if (db < da) {
+		*along = leg->len;
+		return db;
+	}
+	*along = 0.0;
+
+	return da;
+}
+
+/*
+ * struct nearest - The nearest leg found so far by polyline_nearest(), with 
+ * the cosine and sine of the distance, used by cap_beyond().
+ */
+
+struct nearest {
+	size_t leg;
+	double dist;
+	double along;
+	double cos_dist;
+	double sin_dist;
+};
+
+/*
+ * nearest_legs() - Checks the legs with index `first` up to, but not 
+ * including, `end` in the route `pl`, and updates `n` if any of them are 
+ * closer to the unit vector `p` than the nearest leg so far. Legs with a cap 
+ * that is further away than the nearest leg are skipped. Returns nothing.
+ */
+
+static void nearest_legs(const struct polyline *pl, const struct vec3 *p,
+                         const size_t first, const size_t end,
+                         struct nearest *n)
+{
+	size_t i;
+
+	for (i = first; i < end; i++) {
+		const struct leg *leg = &pl->legs[i];
+		double d, along;
+
+		if (i == n->leg || cap_beyond(&leg->cap, p, n->dist,
+		                              n->cos_dist, n->sin_dist))
+			continue;
+		d = leg_nearest(leg, p, &along);
+		if (d < n->dist || (d == n->dist && i < n->leg)) {
+			n->leg = i;
+			n->dist = d;
+			n->along = along;
+			n->cos_dist = cos(d);
+			n->sin_dist = sin(d);
+		}
+	}
+}
+
+/*
+ * polyline_nearest() - Finds the point on the route in `pl` that is nearest 
+ * to the unit vector `p`. The route must contain at least one leg. The leg 
+ * with index `hint` is checked first, followed by the legs in the block with 
+ * the nearest center. This gives a short distance early, so most of the other 
+ * blocks and legs are skipped by comparing the distance to their caps with the 
+ * best distance so far. If several legs are equally close, the one with the 
+ * lowest index is used.
+ *
+ * The angular distance in radians to the nearest point is stored in `xtrack`, 
+ * positive if `p` is to the right of the leg and negative if it's to the left. 
+ * The angular distance from the start of the route along the legs to the 
+ * nearest point is stored in `atrack`. Returns the index of the nearest leg.
+ */
+
+size_t polyline_nearest(const struct polyline *pl, const struct vec3 *p,
+                        const size_t hint, double *xtrack, double *atrack)
+{
+	const struct leg *leg;
+	const size_t numblocks = (pl->n + POLYLINE_BLOCK - 1) / POLYLINE_BLOCK;
+	struct nearest n;
+	size_t b, near_b = 0;
+	double maxdot = -2.0;
+
+	assert(pl);
+	assert(pl->n);
+	assert(p);
+	assert(xtrack);
+	assert(atrack);
+
+	n.leg = hint < pl->n ? hint : 0;
+	n.dist = leg_nearest(&pl->legs[n.leg], p, &n.along);
+	n.cos_dist = cos(n.dist);
+	n.sin_dist = sin(n.dist);
+
+	for (b = 0; b < numblocks; b++) {
+		const double dot = vec3_dot(p, &pl->blocks[b].center);
+
+		if (dot > maxdot) {
+			maxdot = dot;
+			near_b = b;
+		}
+	}
+
+	for (b = near_b; b < near_b + numblocks; b++) {
+		const size_t i = b % numblocks;
+		const size_t first = i * POLYLINE_BLOCK;
+		const size_t end = first + POLYLINE_BLOCK < pl->n
+		                   ? first + POLYLINE_BLOCK : pl->n;
+
+		if (!cap_beyond(&pl->blocks[i], p, n.dist, n.cos_dist,
+		                n.sin_dist))
+			nearest_legs(pl, p, first, end, &n);
+	}
+
+	leg = &pl->legs[n.leg];
+	*xtrack = !leg->arc.degenerate && vec3_dot(p, &leg->arc.pole) > 0.0
+	          ? -n.dist : n.dist;
+	*atrack = leg->start + n.along;
+
+	return n.leg;
+}
+
+/*
+ * polyline_batch() - Calculates the distances in meters from the `n` 
+ * positions in `lat` and `lon` to the route in `pl` with polyline_nearest(). 
+ * The signed distance to the nearest point on the route is stored in 
+ * `xtrack`, the distance along the route to that point in `atrack`, and the 
+ * index of the nearest leg in `leg`. The nearest leg of every position is 
+ * used as the hint for the next position, so positions that follow the route 
+ * are processed quickly. Returns nothing.
+ */
+
+void polyline_batch(const struct polyline *pl,
+                    const double *lat, const double *lon, const size_t n,
+                    double *xtrack, double *atrack, size_t *leg)
+{
+	size_t i, hint = 0;
+
+	assert(pl);
+	assert(lat);
+	assert(lon);
+	assert(xtrack);
+	assert(atrack);
+	assert(leg);
+
+	for (i = 0; i < n; i++) {
+		struct vec3 p;
+		double x, a;
+
+		pos_to_vec3(lat[i], lon[i], &p);
+		hint = polyline_nearest(pl, &p, hint, &x, &a);
+		xtrack[i] = x * EARTH_RADIUS;
+		atrack[i] = a * EARTH_RADIUS;
+		leg[i] = hint;
+	}
+}
+
+/*
+ * polygon_init() - Prepares the polygon with the `n` vertices in `lat` and 
+ * `lon` for point-in-polygon tests with polygon_contains(). The last vertex 
+ * is connected to the first, and if it's identical to the first vertex, it's 
+ * ignored. The vertices are stored as unit vectors, and the normal of the 
+ * great circle through every edge is calculated once.
+ *
+ * A position is inside the polygon if the arc from the position to a 
+ * reference point outside the polygon crosses an odd number of edges. The 
+ * polygon is enclosed by a spherical cap centered on the average of the 
+ * vertices, and the reference point is placed outside that cap. This only 
+ * works if the cap is smaller than a hemisphere, so the caller must check that 
+ * `cap.radius` is smaller than pi / 2. The dot products between the edge 
+ * normals and the reference point are also calculated here, so only one dot 
+ * product is needed for most edges in polygon_contains().
+ *
+ * Returns 1 if the memory allocation failed, otherwise 0.
+ */
+
+int polygon_init(struct polygon *dest,
+                 const double *lat, const double *lon, const size_t n)
+{
+	struct vec3 axis, t;
+	size_t i, num = n;
+	double len, angle;
+
+	assert(dest);
+	assert(lat);
+	assert(lon);
+
+	if (num > 1 && lat[0] == lat[num - 1] && lon[0] == lon[num - 1])
+		num--;
+	dest->n = num;
+	dest->vert = malloc(num * sizeof(struct vec3));
+	dest->normal = malloc(num * sizeof(struct vec3));
+	dest->ref_dot = malloc(num * sizeof(double));
+	if (!dest->vert || !dest->normal || !dest->ref_dot) {
+		failed("malloc()"); /* gncov */
+		polygon_free(dest); /* gncov */
+		return 1; /* gncov */
+	}
+
+	dest->cap.center.x = dest->cap.center.y = dest->cap.center.z = 0.0;
+	for (i = 0; i < num; i++) {
+		pos_to_vec3(lat[i], lon[i], &dest->vert[i]);
+		dest->cap.center.x += dest->vert[i].x;
+		dest->cap.center.y += dest->vert[i].y;
+		dest->cap.center.z += dest->vert[i].z;
+	}
+	len = sqrt(vec3_dot(&dest->cap.center, &dest->cap.center));
+	if (len < 1e-15) {
+		cap_set_radius(&dest->cap, M_PI);
+		return 0;
+	}
+	dest->cap.center.x /= len;
+	dest->cap.center.y /= len;
+	dest->cap.center.z /= len;
+	angle = 0.0;
+	for (i = 0; i < num; i++) {
+		vec3_cross(&dest->vert[i], &dest->vert[(i + 1) % num],
+		           &dest->normal[i]);
+		angle = fmax(angle, vec3_angle(&dest->cap.center,
+		                               &dest->vert[i]));
+	}
+	cap_set_radius(&dest->cap, angle);
+
+	/*
+	 * Place the reference point halfway between the cap and the 
+	 * hemisphere around the center, in the direction of the coordinate 
+	 * axis that is least aligned with the center.
+	 */
+	axis.x = axis.y = axis.z = 0.0;
+	if (fabs(dest->cap.center.x) <= fabs(dest->cap.center.y)
+	    && fabs(dest->cap.center.x) <= fabs(dest->cap.center.z))
+		axis.x = 1.0;
+	else if (fabs(dest->cap.center.y) <= fabs(dest->cap.center.z))
+		axis.y = 1.0;
+	else
+		axis.z = 1.0;
+	vec3_cross(&dest->cap.center, &axis, &t);
+	len = sqrt(vec3_dot(&t, &t));
+	angle = (dest->cap.radius + M_PI / 2.0) / 2.0;
+	dest->ref.x = cos(angle) * dest->cap.center.x + sin(angle) * t.x / len;
+	dest->ref.y = cos(angle) * dest->cap.center.y + sin(angle) * t.y / len;
+	dest->ref.z = cos(angle) * dest->cap.center.z + sin(angle) * t.z / len;
+	for (i = 0; i < num; i++)
+		dest->ref_dot[i] = vec3_dot(&dest->normal[i], &dest->ref);
+
+	return 0;
+}
+
+/*
+ * polygon_free() - Deallocates the memory used by the polygon `pg`. Returns 
+ * nothing.
+ */
+
+void polygon_free(struct polygon *pg)
+{
+	assert(pg);
+
+	free(pg->ref_dot);
+	free(pg->normal);
+	free(pg->vert);
+	pg->vert = pg->normal = NULL;
+	pg->ref_dot = NULL;
+	pg->n = 0;
+}
+
+/*
+ * polygon_contains() - Returns 1 if the unit vector `p` is inside the polygon 
+ * `pg`, prepared by polygon_init(), otherwise 0. Positions outside the 
+ * bounding cap are rejected with one dot product. The crossing test is the 
+ * same as in the S2 geometry library: the arcs a-b and p-q cross if p and q 
+ * are on opposite sides of the great circle through a and b, and a and b are 
+ * on opposite sides of the great circle through p and q, with consistent 
+ * signs. Positions exactly on an edge or vertex can be reported as inside or 
+ * outside.
+ */
+
+int polygon_contains(const struct polygon *pg, const struct vec3 *p)
+{
+	struct vec3 pq;
+	size_t i;
+	int inside = 0;
+
+	assert(pg);
+	assert(p);
+
+	if (vec3_dot(p, &pg->cap.center) < pg->cap.cos_radius)
+		return 0;
+
+	vec3_cross(p, &pg->ref, &pq);
+	for (i = 0; i < pg->n; i++) {
+		const double apb = -vec3_dot(&pg->normal[i], p);
+		const double bqa = pg->ref_dot[i];
+		const size_t next = i + 1 < pg->n ? i + 1 : 0;
+
+		if (apb * bqa <= 0.0)
+			continue;
+		if (apb * -vec3_dot(&pq, &pg->vert[next]) > 0.0
+		    && apb * vec3_dot(&pq, &pg->vert[i]) > 0.0)
+			inside ^= 1;
+	}
+
+	return inside;
+}
+
+/*
+ * polyindex_cmp() - Used as comparison function for qsort() in 
+ * polyindex_init(). Sorts the entries by cell and then by polygon.
+ */
+
+static int polyindex_cmp(const void *s1, const void *s2)
+{
+	const struct polyentry *e1 = s1, *e2 = s2;
+
+	if (e1->cell != e2->cell)
+		return e1->cell < e2->cell ? -1 : 1;
+	if (e1->poly != e2->poly)
+		return e1->poly < e2->poly ? -1 : 1;
+
+	return 0; /* gncov */
+}
+
+/*
+ * double_cmp() - Used as comparison function for qsort(). Sorts doubles in 
+ * ascending order.
+ */
+
+static int double_cmp(const void *s1, const void *s2)
+{
+	const double d1 = *(const double *)s1, d2 = *(const double *)s2;
+
+	return (d1 > d2) - (d1 < d2);
+}
+
+/*
+ * cellgrid_init() - Initializes the latitude/longitude grid in `dest` with 
+ * cells of approximately `cellsize` degrees, limited to the range from 
+ * CELLGRID_MIN_CELLSIZE to CELLGRID_MAX_CELLSIZE. The size is adjusted so 
+ * the longitudes are divided into a whole number of cells. Returns nothing.
+ */
+
+static void cellgrid_init(struct cellgrid *dest, const double cellsize)
+{
+	double num;
+
+	dest->cellsize = fmax(CELLGRID_MIN_CELLSIZE,
+	                      fmin(CELLGRID_MAX_CELLSIZE, cellsize));
+	num = ceil(360.0 / dest->cellsize);
+	dest->nlon = (unsigned long)num;
+	dest->cellsize = 360.0 / num;
+	num = ceil(180.0 / dest->cellsize);
+	dest->nlat = (unsigned long)num;
+}
+
+/*
+ * cellgrid_lat() - Returns the latitude index of the cell in `grid` that 
+ * contains the latitude `lat`.
+ */
+
+static unsigned long cellgrid_lat(const struct cellgrid *grid,
+                                  const double lat)
+{
+	const double i = floor((lat + 90.0) / grid->cellsize);
+
+	if (i < 0.0)
+		return 0;
+	if (i >= (double)grid->nlat)
+		return grid->nlat - 1;
+
+	return (unsigned long)i;
+}
+
+/*
+ * cellgrid_lon() - Returns the longitude index of the cell in `grid` that 
+ * contains the longitude `lon`. Longitudes outside the -180 to 180 range are 
+ * wrapped around.
+ */
+
+static unsigned long cellgrid_lon(const struct cellgrid *grid,
+                                  const double lon)
+{
+	const double n = (double)grid->nlon;
+	double i = fmod(floor((lon + 180.0) / grid->cellsize), n);
+
+	if (i < 0.0)
+		i += n;
+
+	return (unsigned long)i % grid->nlon;
+}
+
+/*
+ * cellgrid_cells() - Finds the cells in `grid` that overlap a circle with 
+ * center at `clat,clon` and a radius of `radius` radians. The latitude 
+ * indexes are stored in `lat1` and `lat2`, and the longitude indexes in `lon1` 
+ * and `lon2`, where `lon2` can be smaller than `lon1` if the cells cross the 
+ * antimeridian. Returns the number of cells.
+ */
+
+static unsigned long cellgrid_cells(const struct cellgrid *grid,
+                                    const double clat, const double clon,
+                                    const double radius,
+                                    unsigned long *lat1, unsigned long *lat2,
+                                    unsigned long *lon1, unsigned long *lon2)
+{
+	const double r = rad2deg(radius);
+
+	*lat1 = cellgrid_lat(grid, clat - r);
+	*lat2 = cellgrid_lat(grid, clat + r);
+	if (clat + r < 90.0 && clat - r > -90.0) {
+		const double dlon = rad2deg(asin(fmin(1.0,
+		                            sin(radius)
+		                            / cos(deg2rad(clat)))));
+		const double w = floor((clon - dlon + 180.0) / grid->cellsize);
+		const double e = floor((clon + dlon + 180.0) / grid->cellsize);
+
+		if (e - w + 1.0 < (double)grid->nlon) {
+			*lon1 = cellgrid_lon(grid, clon - dlon);
+			*lon2 = cellgrid_lon(grid, clon + dlon);
+			return (*lat2 - *lat1 + 1)
+			       * ((unsigned long)(e - w) + 1);
+		}
+	}
+
+	/* The circle contains a pole or covers all longitudes */
+	*lon1 = 0;
+	*lon2 = grid->nlon - 1;
+
+	return (*lat2 - *lat1 + 1) * grid->nlon;
+}
+
+/*
+ * polyindex_cells() - Finds the grid cells in `idx` that overlap the cap 
+ * `cap`, see cellgrid_cells(). Returns the number of cells.
+ */
+
+static unsigned long polyindex_cells(const struct polyindex *idx,
+                                     const struct cap *cap,
+                                     unsigned long *lat1, unsigned long *lat2,
+                                     unsigned long *lon1, unsigned long *lon2)
+{
+	const double clat = rad2deg(asin(fmax(-1.0, fmin(1.0,
+	                                 cap->center.z))));
+	const double clon = rad2deg(atan2(cap->center.y, cap->center.x));
+
+	return cellgrid_cells(&idx->grid, clat, clon, cap->radius,
+	                      lat1, lat2, lon1, lon2);
+}
+
+/*
+ * polyindex_init() - Creates a spatial index in `dest` for the `n` polygons in 
+ * `polys`, which must exist as long as the index is used. The index is a 
+ * latitude/longitude grid where the cell size is the median diameter of the 
+ * bounding caps of the polygons, limited to the range from 
+ * CELLGRID_MIN_CELLSIZE to CELLGRID_MAX_CELLSIZE degrees. Only the cells 
+ * that overlap a polygon are stored, as a sorted array of cell/polygon pairs. 
+ * Polygons that cover more than POLYINDEX_MAX_CELLS cells are stored in a 
+ * separate list that is checked for every position. Returns 1 if the memory 
+ * allocation failed, otherwise 0.
+ */
+
+int polyindex_init(struct polyindex *dest, const struct polygon *polys,
+                   const size_t n)
+{
+	size_t i, alloc = 0;
+	double *diam;
+
+	assert(dest);
+	assert(polys || !n);
+
+	dest->polys = polys;
+	dest->numpolys = n;
+	dest->entries = NULL;
+	dest->numentries = 0;
+	dest->large = NULL;
+	dest->numlarge = 0;
+
+	diam = malloc((n ? n : 1) * sizeof(double));
+	if (!diam) {
+		failed("malloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+	for (i = 0; i < n; i++)
+		diam[i] = rad2deg(polys[i].cap.radius) * 2.0;
+	qsort(diam, n, sizeof(double), double_cmp);
+	cellgrid_init(&dest->grid, n ? diam[n / 2] : CELLGRID_MAX_CELLSIZE);
+	free(diam);
+
+	dest->large = malloc((n ? n : 1) * sizeof(size_t));
+	if (!dest->large) {
+		failed("malloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+
+	for (i = 0; i < n; i++) {
+		unsigned long lat1, lat2, lon1, lon2, la, lo, cells;
+
+		cells = polyindex_cells(dest, &polys[i].cap,
+		                        &lat1, &lat2, &lon1, &lon2);
+		if (cells > POLYINDEX_MAX_CELLS) {
+			dest->large[dest->numlarge++] = i;
+			continue;
+		}
+		if (dest->numentries + cells > alloc) {
+			struct polyentry *e;
+
+			alloc = (alloc + cells) * 2;
+			e = realloc(dest->entries, alloc * sizeof(*e));
+			if (!e) {
+				failed("realloc()"); /* gncov */
+				polyindex_free(dest); /* gncov */
+				return 1; /* gncov */
+			}
+			dest->entries = e;
+		}
+		for (la = lat1; la <= lat2; la++) {
+			lo = lon1;
+			while (1) {
+				struct polyentry *e;
+
+				e = &dest->entries[dest->numentries++];
+				e->cell = la * dest->grid.nlon + lo;
+				e->poly = i;
+				if (lo == lon2)
+					break;
+				lo = (lo + 1) % dest->grid.nlon;
+			}
+		}
+	}
+	qsort(dest->entries, dest->numentries, sizeof(struct polyentry),
+	      polyindex_cmp);
+
+	return 0;
+}
+
+/*
+ * polyindex_free() - Deallocates the memory used by the index `idx`. The 
+ * polygons are not deallocated. Returns nothing.
+ */
+
+void polyindex_free(struct polyindex *idx)
+{
+	assert(idx);
+
+	free(idx->large);
+	free(idx->entries);
+	idx->large = NULL;
+	idx->entries = NULL;
+	idx->numentries = idx->numlarge = 0;
+}
+
+/*
+ * polyindex_search() - Finds the polygons in the index `idx` that contain the 
+ * position `lat,lon`. The grid cell of the position is found with a binary 
+ * search, and only the polygons in that cell and the large polygons are 
+ * checked with polygon_contains(). The indexes of the polygons are stored in 
+ * ascending order in `dest`, which must have room for all polygons in the 
+ * index. Returns the number of polygons found.
+ */
+
+size_t polyindex_search(const struct polyindex *idx,
+                        const double lat, const double lon, size_t *dest)
+{
+	struct vec3 p;
+	unsigned long cell;
+	size_t lo = 0, hi, i, l = 0, count = 0;
+
+	assert(idx);
+	assert(dest);
+
+	pos_to_vec3(lat, lon, &p);
+	cell = cellgrid_lat(&idx->grid, lat) * idx->grid.nlon
+	       + cellgrid_lon(&idx->grid, lon);
+
+	/* Find the first entry in the cell */
+	hi = idx->numentries;
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+
+		if (idx->entries[mid].cell < cell)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* Merge the polygons in the cell with the large polygons */
+	i = lo;
+	while (1) {
+		const bool in_cell = i < idx->numentries
+		                     && idx->entries[i].cell == cell;
+		size_t poly;
+
+		if (in_cell && (l == idx->numlarge
+		                || idx->entries[i].poly < idx->large[l])) {
+			poly = idx->entries[i++].poly;
+		} else if (l < idx->numlarge) {
+			poly = idx->large[l++];
+		} else {
+			break;
+		}
+		if (polygon_contains(&idx->polys[poly], &p))
+			dest[count++] = poly;
+	}
+
+	return count;
+}
+
+/*
+ * pointentry_cmp() - Used as comparison function for qsort(). Sorts the 
+ * entries of a point index by cell and point number.
+ */
+
+static int pointentry_cmp(const void *s1, const void *s2)
+{
+	const struct pointentry *e1 = s1, *e2 = s2;
+
+	if (e1->cell != e2->cell)
+		return e1->cell < e2->cell ? -1 : 1;
+
+	return (e1->point > e2->point) - (e1->point < e2->point);
+}
+
+/*
+ * size_cmp() - Used as comparison function for qsort(). Sorts `size_t` values 
+ * in ascending order.
+ */
+
+static int size_cmp(const void *s1, const void *s2)
+{
+	const size_t i1 = *(const size_t *)s1, i2 = *(const size_t *)s2;
+
+	return (i1 > i2) - (i1 < i2);
+}
+
+/*
+ * pointindex_init() - Creates a spatial index in `dest` for the `n` positions 
+ * in the arrays `lat` and `lon`, used to find the positions within `radius` 
+ * radians of another position, compared with vec3_chord2(). The index is a 
+ * latitude/longitude grid where 
+ * the cell size is approximately the radius, and the positions are stored as a 
+ * sorted array of cell/position pairs, so the positions in neighbouring cells 
+ * are stored next to each other. Returns 1 if the memory allocation failed, 
+ * otherwise 0.
+ */
+
+int pointindex_init(struct pointindex *dest,
+                    const double *lat, const double *lon, const size_t n,
+                    const double radius)
+{
+	size_t i;
+
+	assert(dest);
+	assert((lat && lon) || !n);
+
+	cellgrid_init(&dest->grid, rad2deg(radius));
+	dest->radius = radius;
+	/* Larger than any chord if the radius covers the whole globe */
+	dest->chord2 = radius < M_PI ? pow(2.0 * sin(radius / 2.0), 2.0)
+	                             : 5.0;
+	dest->n = n;
+	dest->entries = malloc((n ? n : 1) * sizeof(struct pointentry));
+	if (!dest->entries) {
+		failed("malloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+
+	for (i = 0; i < n; i++) {
+		struct pointentry *e = &dest->entries[i];
+
+		e->cell = cellgrid_lat(&dest->grid, lat[i]) * dest->grid.nlon
+		          + cellgrid_lon(&dest->grid, lon[i]);
+		e->point = i;
+		pos_to_vec3(lat[i], lon[i], &e->v);
+	}
+	qsort(dest->entries, n, sizeof(struct pointentry), pointentry_cmp);
+
+	return 0;
+}
+
+/*
+ * pointindex_free() - Deallocates the memory used by the index `idx`. Returns 
+ * nothing.
+ */
+
+void pointindex_free(struct pointindex *idx)
+{
+	assert(idx);
+
+	free(idx->entries);
+	idx->entries = NULL;
+	idx->n = 0;
+}
+
+/*
+ * pointindex_scan() - Checks the positions in the cells from `first` to `last` 
+ * in the index `idx`, and adds the number of every position within the radius 
+ * of `p` to `dest`, where `count` numbers are already stored. The first cell 
+ * is found with a binary search. Returns the new number of stored positions.
+ */
+
+static size_t pointindex_scan(const struct pointindex *idx,
+                              const unsigned long first,
+                              const unsigned long last,
+                              const struct vec3 *p, size_t *dest,
+                              size_t count)
+{
+	size_t lo = 0, hi = idx->n;
+
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+
+		if (idx->entries[mid].cell < first)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (; lo < idx->n && idx->entries[lo].cell <= last; lo++) {
+		const struct vec3 *v = &idx->entries[lo].v;
+
+		if (vec3_chord2(v, p) <= idx->chord2)
+			dest[count++] = idx->entries[lo].point;
+	}
+
+	return count;
+}
+
+/*
+ * pointindex_search() - Finds the positions in the index `idx` that are within 
+ * the radius of the index from the position `lat,lon`. Only the cells that 
+ * overlap the circle around the position are checked, which is one or two 
+ * contiguous ranges of entries per latitude band. The numbers of the positions 
+ * are stored in ascending order in `dest`, which must have room for all 
+ * positions in the index. Returns the number of positions found.
+ */
+
+size_t pointindex_search(const struct pointindex *idx,
+                         const double lat, const double lon, size_t *dest)
+{
+	struct vec3 p;
+	unsigned long lat1, lat2, lon1, lon2, la;
+	size_t count = 0;
+
+	assert(idx);
+	assert(dest);
+
+	pos_to_vec3(lat, lon, &p);
+	cellgrid_cells(&idx->grid, lat, lon, idx->radius,
+	               &lat1, &lat2, &lon1, &lon2);
+	for (la = lat1; la <= lat2; la++) {
+		const unsigned long row = la * idx->grid.nlon;
+
+		if (lon1 <= lon2) {
+			count = pointindex_scan(idx, row + lon1, row + lon2,
+			                        &p, dest, count);
+		} else {
+			count = pointindex_scan(idx, row + lon1,
+			                        row + idx->grid.nlon - 1,
+			                        &p, dest, count);
+			count = pointindex_scan(idx, row, row + lon2,
+			                        &p, dest, count);
+		}
+	}
+	qsort(dest, count, sizeof(size_t), size_cmp);
+
+	return count;
+}
+
+/*
+ * sepindex_init() - Initializes `dest` as an empty index of positions that 
+ * must be at least `separation` radians apart. The unit vectors of the 
+ * positions are stored in a hash table of cubic cells where the side is the 
+ * chord length of `separation`, so only the 27 cells around a new position 
+ * have to be checked. Returns 1 if the allocation fails, otherwise 0.
+ */
+
+int sepindex_init(struct sepindex *dest, const double separation)
+{
+	const double chord = 2.0 * sin(fmin(separation, M_PI) / 2.0);
+	size_t i;
+
+	assert(dest);
+	assert(separation > 0.0);
+
+	memset(dest, 0, sizeof(*dest));
+	dest->chord2 = chord * chord;
+	dest->cellsize = chord;
+	dest->numcells = SEPINDEX_MIN_CELLS;
+	dest->cells = malloc(dest->numcells * sizeof(struct sepcell));
+	if (!dest->cells) {
+		failed("malloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+	for (i = 0; i < dest->numcells; i++)
+		dest->cells[i].head = 0;
+
+	return 0;
+}
+
+/*
+ * sepindex_free() - Deallocates the memory used by the index `si`. Returns 
+ * nothing.
+ */
+
+void sepindex_free(struct sepindex *si)
+{
+	assert(si);
+
+	free(si->cells);
+	free(si->next);
+	free(si->pts);
+	memset(si, 0, sizeof(*si));
+}
+
+/*
+ * sepcell_find() - Returns the slot in the hash table in `si` for the cell 
+ * `x,y,z`, which is either the slot of the cell, or the empty slot where it 
+ * should be stored. The table is never full, so an empty slot is always 
+ * found.
+ */
+
+static struct sepcell *sepcell_find(const struct sepindex *si,
+                                    const int64_t x, const int64_t y,
+                                    const int64_t z)
+{
+	uint64_t hash = (uint64_t)x * 0x9e3779b97f4a7c15ULL
+	                ^ (uint64_t)y * 0xc2b2ae3d27d4eb4fULL
+	                ^ (uint64_t)z * 0x165667b19e3779f9ULL;
+	size_t i;
+
+	hash ^= hash >> 29;
+	i = (size_t)hash & (si->numcells - 1);
+	while (si->cells[i].head
+	       && (si->cells[i].x != x || si->cells[i].y != y
+	           || si->cells[i].z != z))
+		i = (i + 1) & (si->numcells - 1);
+
+	return &si->cells[i];
+}
+
+/*
+ * sepcell_coord() - Returns the cell number of the coordinate `c` with cells 
+ * of size `cellsize`.
+ */
+
+static int64_t sepcell_coord(const double c, const double cellsize)
+{
+	const double f = floor(c / cellsize);
+
+	return (int64_t)f;
+}
+
+/*
+ * sepindex_grow() - Doubles the size of the hash table in `si` when more 
+ * than half of it is used, and doubles the room for positions when it's 
+ * full. Returns 1 if the allocation fails, otherwise 0.
+ */
+
+static int sepindex_grow(struct sepindex *si)
+{
+	if (si->n == si->alloc) {
+		const size_t alloc = si->alloc ? si->alloc * 2 : 1024;
+		struct vec3 *pts;
+		size_t *next;
+
+		pts = realloc(si->pts, alloc * sizeof(struct vec3));
+		if (!pts) {
+			failed("realloc()"); /* gncov */
+			return 1; /* gncov */
+		}
+		si->pts = pts;
+		next = realloc(si->next, alloc * sizeof(size_t));
+		if (!next) {
+			failed("realloc()"); /* gncov */
+			return 1; /* gncov */
+		}
+		si->next = next;
+		si->alloc = alloc;
+	}
+	if ((si->usedcells + 1) * 2 > si->numcells) {
+		struct sepcell *old = si->cells;
+		const size_t oldnum = si->numcells;
+		size_t i;
+
+		si->numcells *= 2;
+		si->cells = malloc(si->numcells * sizeof(struct sepcell));
+		if (!si->cells) {
+			failed("malloc()"); /* gncov */
+			si->cells = old; /* gncov */
+			si->numcells = oldnum; /* gncov */
+			return 1; /* gncov */
+		}
+		for (i = 0; i < si->numcells; i++)
+			si->cells[i].head = 0;
+		for (i = 0; i < oldnum; i++) {
+			if (old[i].head)
+				*sepcell_find(si, old[i].x, old[i].y,
+				              old[i].z) = old[i];
+		}
+		free(old);
+	}
+
+	return 0;
+}
+
+/*
+ * sepindex_add() - Adds the position `lat,lon` to the index `si` if no 
+ * position in the index is closer than the separation of the index. Returns 
+ * 0 if the position is added, 1 if it's too close to another position, or -1 
+ * if the allocation fails.
+ */
+
+int sepindex_add(struct sepindex *si, const double lat, const double lon)
+{
+	struct vec3 v;
+	struct sepcell *cell;
+	int64_t x, y, z, dx, dy, dz;
+
+	assert(si);
+
+	pos_to_vec3(lat, lon, &v);
+	x = sepcell_coord(v.x, si->cellsize);
+	y = sepcell_coord(v.y, si->cellsize);
+	z = sepcell_coord(v.z, si->cellsize);
+	for (dx = -1; dx <= 1; dx++) {
+		for (dy = -1; dy <= 1; dy++) {
+			for (dz = -1; dz <= 1; dz++) {
+				size_t i = sepcell_find(si, x + dx, y + dy,
+				                        z + dz)->head;
+
+				for (; i; i = si->next[i - 1]) {
+					if (vec3_chord2(&si->pts[i - 1], &v)
+					    < si->chord2)
+						return 1;
+				}
+			}
+		}
+	}
+
+	if (sepindex_grow(si))
+		return -1; /* gncov */
+	cell = sepcell_find(si, x, y, z);
+	if (!cell->head) {
+		cell->x = x;
+		cell->y = y;
+		cell->z = z;
+		si->usedcells++;
+	}
+	si->pts[si->n] = v;
+	si->next[si->n] = cell->head;
+	cell->head = ++si->n;
+
+	return 0;
+}
+
+/*
+ * dbscan() - Finds clusters of positions in the arrays `lat` and `lon` with 
+ * `n` positions, using the DBSCAN algorithm. Two positions are neighbours if 
+ * the angle between them is at most `eps` radians, and a position with at 
+ * least `minpts` neighbours, itself included, is a core position. A cluster 
+ * consists of core positions that are connected through neighbours, and the 
+ * positions that are neighbours of the core positions. The neighbours are 
+ * found with a point index, so only the positions in the nearby grid cells are 
+ * compared. The number of the cluster of every position is stored in 
+ * `cluster`, where the clusters are numbered from 1 in the order they're 
+ * found, and 0 means that the position is noise. Returns the number of 
+ * clusters, or -1 if the memory allocation failed.
+ */
+
+long dbscan(const double *lat, const double *lon, const size_t n,
+            const double eps, const size_t minpts, unsigned long *cluster)
+{
+	struct pointindex idx;
+	size_t *found = NULL, *queue = NULL, i;
+	bool *visited = NULL;
+	unsigned long num = 0;
+	long retval = -1;
+
+	assert((lat && lon && cluster) || !n);
+
+	if (pointindex_init(&idx, lat, lon, n, eps))
+		return -1; /* gncov */
+	found = malloc((n ? n : 1) * sizeof(size_t));
+	queue = malloc((n ? n : 1) * sizeof(size_t));
+	visited = malloc((n ? n : 1) * sizeof(bool));
+	if (!found || !queue || !visited) {
+		failed("malloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	for (i = 0; i < n; i++) {
+		cluster[i] = 0;
+		visited[i] = false;
+	}
+
+	for (i = 0; i < n; i++) {
+		size_t count, head = 0, tail = 0, j;
+
+		if (visited[i])
+			continue;
+		visited[i] = true;
+		count = pointindex_search(&idx, lat[i], lon[i], found);
+		if (count < minpts)
+			continue;
+
+		/* i is a core position, expand a new cluster from it */
+		cluster[i] = ++num;
+		while (1) {
+			for (j = 0; j < count; j++) {
+				const size_t p = found[j];
+
+				if (!cluster[p])
+					cluster[p] = num;
+				if (!visited[p]) {
+					visited[p] = true;
+					queue[tail++] = p;
+				}
+			}
+			if (head == tail)
+				break;
+			j = queue[head++];
+			count = pointindex_search(&idx, lat[j], lon[j], found);
+			if (count < minpts)
+				count = 0;
+		}
+	}
+	retval = (long)num;
+
+cleanup:
+	free(visited);
+	free(queue);
+	free(found);
+	pointindex_free(&idx);
+
+	return retval;
+}
+
+/*
+ * gaussian_radius() - Returns the Gaussian radius of curvature in meters of 
+ * the ellipsoid `ell` at the latitude `lat`. This is the radius of the sphere 
+ * that fits the ellipsoid best near the latitude, and is used to convert 
+ * short spherical distances to ellipsoidal distances.
+ */
+
+double gaussian_radius(const struct ellipsoid *ell, const double lat)
+{
+	const double e2 = ell->e2;
+	const double sin_lat = sin(deg2rad(lat));
+
+	return ell->b / (1.0 - e2 * sin_lat * sin_lat);
+}
+
+/*
+ * rand_pos() - Generates a random position on Earth with optional distance 
+ * constraints.
+ *
+ * If `c_lat` is larger than 90, generate a random location somewhere on Earth. 
+ * Otherwise, the position is between `mindist` and `maxdist` meters from 
+ * `c_lat,c_lon`.
+ *
+ * Parameters:
+ * - dlat:    Pointer to store resulting latitude (-90 to 90 degrees)
+ * - dlon:    Pointer to store resulting longitude (-180 to 180 degrees)
+ * - c_lat:   Center position latitude (-90 to 90 degrees)
+ * - c_lon:   Center position longitude (-180 to 180 degrees)
+ * - maxdist: Maximum distance in meters from center
+ * - mindist: Minimum distance in meters from center
+ *
+ * Returns nothing.
+ */
+
+void rand_pos(double *dlat, double *dlon,
+              const double c_lat_p, const double c_lon_p,
+              const double maxdist_p, const double mindist_p)
+{
+	double c_lat = c_lat_p, c_lon = c_lon_p,
+	       maxdist = maxdist_p, mindist = mindist_p,
+	       rand_bear, rand_dist, result;
+
+	assert(dlat);
+	assert(dlon);
+
+	if (c_lat > 90.0 || (maxdist == 0.0 && mindist == 0.0)) {
+		/* No center coordinate or distances, use the whole world */
+		*dlat = rad2deg(asin(2.0 * drand48() - 1.0));
+		*dlon = rad2deg(drand48() * 2.0 * M_PI) - 180.0;
+		return;
+	}
+
+	if (mindist != 0.0 && maxdist == 0.0) {
+		set_antipode(&c_lat, &c_lon);
+		maxdist = MAX_EARTH_DISTANCE - mindist;
+		mindist = 0.0;
+	}
+	if (mindist > maxdist) {
+		double d = mindist;
+		mindist = maxdist;
+		maxdist = d;
+	}
+	do {
+		rand_bear = drand48() * 360.0;
+		rand_dist = mindist + sqrt(drand48()) * (maxdist - mindist);
+		if (rand_dist > MAX_EARTH_DISTANCE)
+			rand_dist = MAX_EARTH_DISTANCE;
+
+		bearing_position(c_lat, c_lon, rand_bear, rand_dist,
+		                 dlat, dlon);
+		result = haversine(c_lat, c_lon, *dlat, *dlon);
+	} while (mindist != maxdist && (result < mindist || result > maxdist));
+}
+
+/*
+ * rand_bbox() - Stores a random position in `lat` and `lon` inside the box 
+ * between the latitudes `lat1` and `lat2`, going east from `lon1` to `lon2`. 
+ * If `lon2` is smaller than `lon1`, the box crosses the antimeridian. The 
+ * sine of the latitude is uniform, so the positions are uniform on the 
+ * sphere. Returns nothing.
+ */
+
+void rand_bbox(double *lat, double *lon, const double lat1,
+               const double lon1, const double lat2, const double lon2)
+{
+	const double s1 = sin(deg2rad(lat1)), s2 = sin(deg2rad(lat2));
+	double width = lon2 - lon1;
+
+	assert(lat);
+	assert(lon);
+
+	if (width < 0.0)
+		width += 360.0;
+	*lat = rad2deg(asin(s1 + drand48() * (s2 - s1)));
+	*lon = lon1 + drand48() * width;
+	if (*lon > 180.0)
+		*lon -= 360.0;
+}
+
+/*
+ * orient2() - Returns twice the signed area of the plane triangle `a,b,c`, 
+ * which is positive if the triangle is counterclockwise.
+ */
+
+static double orient2(const double ax, const double ay,
+                      const double bx, const double by,
+                      const double cx, const double cy)
+{
+	return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+/*
+ * Working data for the ear clipping in triangulate(). The vertices are in a 
+ * doubly linked list, and the reflex vertices are also stored in a uniform 
+ * grid, so an ear test only checks the reflex vertices near the ear.
+ */
+
+struct earclip {
+	const double *x;
+	const double *y;
+	size_t *prev;
+	size_t *next;
+	unsigned char *reflex;
+	size_t *cellhead;
+	size_t *cellnext;
+	double minx;
+	double miny;
+	double cellw;
+	double cellh;
+	size_t g;
+};
+
+/*
+ * earclip_cell() - Returns the grid column or row in `ec` of the coordinate 
+ * `v`, where `min` and `size` are the start and the size of the cells.
+ */
+
+static size_t earclip_cell(const struct earclip *ec, const double v,
+                           const double min, const double size)
+{
+	const double c = floor((v - min) / size);
+
+	if (!(c > 0.0))
+		return 0;
+	if (c >= (double)ec->g)
+		return ec->g - 1;
+
+	return (size_t)c;
+}
+
+/*
+ * earclip_is_ear() - Returns 1 if the vertex `i` in `ec` is an ear, i.e. the 
+ * triangle with its neighbours is counterclockwise and doesn't contain any 
+ * reflex vertex. Vertices on a straight line are also ears, as removing 
+ * them doesn't change the polygon. Otherwise, it returns 0.
+ */
+
+static int earclip_is_ear(const struct earclip *ec, const size_t i)
+{
+	const size_t a = ec->prev[i], c = ec->next[i];
+	const double ax = ec->x[a], ay = ec->y[a], bx = ec->x[i],
+	             by = ec->y[i], cx = ec->x[c], cy = ec->y[c];
+	const double o = orient2(ax, ay, bx, by, cx, cy);
+	size_t gx, gy, gx1, gy0, gy1;
+
+	if (o < 0.0)
+		return 0;
+	if (o == 0.0)
+		return 1;
+
+	gx = earclip_cell(ec, fmin(ax, fmin(bx, cx)), ec->minx, ec->cellw);
+	gx1 = earclip_cell(ec, fmax(ax, fmax(bx, cx)), ec->minx, ec->cellw);
+	gy0 = earclip_cell(ec, fmin(ay, fmin(by, cy)), ec->miny, ec->cellh);
+	gy1 = earclip_cell(ec, fmax(ay, fmax(by, cy)), ec->miny, ec->cellh);
+	for (; gx <= gx1; gx++) {
+		for (gy = gy0; gy <= gy1; gy++) {
+			size_t p = ec->cellhead[gx * ec->g + gy];
+
+			for (; p; p = ec->cellnext[p - 1]) {
+				const size_t v = p - 1;
+				const double px = ec->x[v], py = ec->y[v];
+
+				if (!ec->reflex[v] || v == a || v == i
+				    || v == c)
+					continue;
+				if (orient2(ax, ay, bx, by, px, py) >= 0.0
+				    && orient2(bx, by, cx, cy, px, py) >= 0.0
+				    && orient2(cx, cy, ax, ay, px, py) >= 0.0)
+					return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * triangulate() - Splits the counterclockwise plane polygon with the `n` 
+ * vertices in `x` and `y` into `n` - 2 triangles by ear clipping, and stores 
+ * the vertex indexes of the triangles in `tri`. If no ear is found during a 
+ * full round, which can happen with self-intersecting polygons, the current 
+ * vertex is clipped anyway. Returns 1 if the memory allocation failed, 
+ * otherwise 0.
+ */
+
+static int triangulate(const double *x, const double *y, const size_t n,
+                       size_t *tri)
+{
+	struct earclip ec;
+	const double side = sqrt((double)n);
+	size_t i, remaining = n, misses = 0, t = 0;
+	double maxx, maxy;
+	int retval = 1;
+
+	ec.x = x;
+	ec.y = y;
+	ec.g = (size_t)side + 1;
+	ec.prev = malloc(n * sizeof(size_t));
+	ec.next = malloc(n * sizeof(size_t));
+	ec.reflex = malloc(n);
+	ec.cellnext = malloc(n * sizeof(size_t));
+	ec.cellhead = calloc(ec.g * ec.g, sizeof(size_t));
+	if (!ec.prev || !ec.next || !ec.reflex || !ec.cellnext
+	    || !ec.cellhead) {
+		failed("malloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+
+	ec.minx = maxx = x[0];
+	ec.miny = maxy = y[0];
+	for (i = 0; i < n; i++) {
+		ec.prev[i] = i ? i - 1 : n - 1;
+		ec.next[i] = i + 1 < n ? i + 1 : 0;
+		ec.minx = fmin(ec.minx, x[i]);
+		ec.miny = fmin(ec.miny, y[i]);
+		maxx = fmax(maxx, x[i]);
+		maxy = fmax(maxy, y[i]);
+	}
+	ec.cellw = maxx > ec.minx ? (maxx - ec.minx) / (double)ec.g : 1.0;
+	ec.cellh = maxy > ec.miny ? (maxy - ec.miny) / (double)ec.g : 1.0;
+	for (i = 0; i < n; i++) {
+		const size_t a = ec.prev[i], c = ec.next[i];
+		size_t cell;
+
+		ec.reflex[i] = orient2(x[a], y[a], x[i], y[i],
+		                       x[c], y[c]) < 0.0;
+		if (!ec.reflex[i])
+			continue;
+		cell = earclip_cell(&ec, x[i], ec.minx, ec.cellw) * ec.g
+		       + earclip_cell(&ec, y[i], ec.miny, ec.cellh);
+		ec.cellnext[i] = ec.cellhead[cell];
+		ec.cellhead[cell] = i + 1;
+	}
+
+	i = 0;
+	while (remaining > 3) {
+		size_t a, c;
+
+		if (!earclip_is_ear(&ec, i) && ++misses <= remaining) {
+			i = ec.next[i];
+			continue;
+		}
+		a = ec.prev[i];
+		c = ec.next[i];
+		tri[t++] = a;
+		tri[t++] = i;
+		tri[t++] = c;
+		ec.next[a] = c;
+		ec.prev[c] = a;
+		ec.reflex[i] = 0;
+		remaining--;
+		misses = 0;
+		if (ec.reflex[a] && orient2(x[ec.prev[a]], y[ec.prev[a]],
+		                            x[a], y[a], x[c], y[c]) >= 0.0)
+			ec.reflex[a] = 0;
+		if (ec.reflex[c] && orient2(x[a], y[a], x[c], y[c],
+		                            x[ec.next[c]],
+		                            y[ec.next[c]]) >= 0.0)
+			ec.reflex[c] = 0;
+		i = c;
+	}
+	tri[t++] = ec.prev[i];
+	tri[t++] = i;
+	tri[t] = ec.next[i];
+	retval = 0;
+
+cleanup:
+	free(ec.cellhead);
+	free(ec.cellnext);
+	free(ec.reflex);
+	free(ec.next);
+	free(ec.prev);
+
+	return retval;
+}
+
+/*
+ * randtri_rmin2() - Returns the square of the smallest distance from the 
+ * origin to the counterclockwise plane triangle `t`, which is 0 if the 
+ * triangle contains the origin.
+ */
+
+static double randtri_rmin2(const struct randtri *t)
+{
+	double best = HUGE_VAL;
+	int k;
+
+	if (orient2(t->x[0], t->y[0], t->x[1], t->y[1], 0.0, 0.0) >= 0.0
+	    && orient2(t->x[1], t->y[1], t->x[2], t->y[2], 0.0, 0.0) >= 0.0
+	    && orient2(t->x[2], t->y[2], t->x[0], t->y[0], 0.0, 0.0) >= 0.0)
+		return 0.0;
+
+	for (k = 0; k < 3; k++) {
+		const double px = t->x[k], py = t->y[k];
+		const double dx = t->x[(k + 1) % 3] - px,
+		             dy = t->y[(k + 1) % 3] - py;
+		const double len2 = dx * dx + dy * dy;
+		double u = 0.0, qx, qy;
+
+		if (len2 > 0.0)
+			u = fmin(1.0, fmax(0.0, -(px * dx + py * dy) / len2));
+		qx = px + u * dx;
+		qy = py + u * dy;
+		best = fmin(best, qx * qx + qy * qy);
+	}
+
+	return best;
+}
+
+/*
+ * randframe_vec3() - Converts the point `x,y` in the gnomonic projection 
+ * around the center of `f` to a unit vector in `dest`. Returns nothing.
+ */
+
+static void randframe_vec3(const struct randframe *f, const double x,
+                           const double y, struct vec3 *dest)
+{
+	double len;
+
+	dest->x = f->center.x + x * f->east.x + y * f->north.x;
+	dest->y = f->center.y + x * f->east.y + y * f->north.y;
+	dest->z = f->center.z + x * f->east.z + y * f->north.z;
+	len = sqrt(vec3_dot(dest, dest));
+	dest->x /= len;
+	dest->y /= len;
+	dest->z /= len;
+}
+
+/*
+ * randtri_area() - Returns the area in steradians of the spherical triangle 
+ * with the corners in `t`, using the formula by Van Oosterom and Strackee.
+ */
+
+static double randtri_area(const struct randframe *f,
+                           const struct randtri *t)
+{
+	struct vec3 a, b, c, bc;
+
+	randframe_vec3(f, t->x[0], t->y[0], &a);
+	randframe_vec3(f, t->x[1], t->y[1], &b);
+	randframe_vec3(f, t->x[2], t->y[2], &c);
+	vec3_cross(&b, &c, &bc);
+
+	return 2.0 * atan2(fabs(vec3_dot(&a, &bc)),
+	                   1.0 + vec3_dot(&a, &b) + vec3_dot(&b, &c)
+	                   + vec3_dot(&c, &a));
+}
+
+/*
+ * randpoly_ring() - Projects the polygon `pg` with the gnomonic projection 
+ * around the center of its cap into the frame number `ring` in `rp`, where 
+ * great circles are straight lines. Clockwise polygons are added to the 
+ * holes, counterclockwise polygons are triangulated, and the triangles are 
+ * added to `rp->tris` with their area in `weights`. Returns 1 if the memory 
+ * allocation failed, otherwise 0.
+ */
+
+static int randpoly_ring(struct randpoly *rp, const size_t ring,
+                         double **weights)
+{
+	const struct polygon *pg = &rp->polys[ring];
+	struct randframe *f = &rp->frames[ring];
+	double *x, *y, *w, lat, lon, sum = 0.0;
+	size_t *tri = NULL, i;
+	struct randtri *tris;
+	int retval = 1;
+
+	vec3_to_pos(&pg->cap.center, &lat, &lon);
+	lat = deg2rad(lat);
+	lon = deg2rad(lon);
+	f->center = pg->cap.center;
+	f->east.x = -sin(lon);
+	f->east.y = cos(lon);
+	f->east.z = 0.0;
+	f->north.x = -sin(lat) * cos(lon);
+	f->north.y = -sin(lat) * sin(lon);
+	f->north.z = cos(lat);
+
+	x = malloc(pg->n * sizeof(double));
+	y = malloc(pg->n * sizeof(double));
+	if (!x || !y) {
+		failed("malloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	for (i = 0; i < pg->n; i++) {
+		const double d = vec3_dot(&pg->vert[i], &f->center);
+
+		x[i] = vec3_dot(&pg->vert[i], &f->east) / d;
+		y[i] = vec3_dot(&pg->vert[i], &f->north) / d;
+	}
+	for (i = 0; i < pg->n; i++) {
+		const size_t next = i + 1 < pg->n ? i + 1 : 0;
+
+		sum += orient2(0.0, 0.0, x[i], y[i], x[next], y[next]);
+	}
+	if (sum < 0.0) {
+		rp->holes[rp->numholes++] = ring;
+		retval = 0;
+		goto cleanup;
+	}
+
+	tri = malloc(3 * (pg->n - 2) * sizeof(size_t));
+	tris = realloc(rp->tris, (rp->numtris + pg->n - 2)
+	                         * sizeof(struct randtri));
+	if (!tri || !tris) {
+		failed("malloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	rp->tris = tris;
+	w = realloc(*weights, (rp->numtris + pg->n - 2) * sizeof(double));
+	if (!w) {
+		failed("realloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	*weights = w;
+	if (triangulate(x, y, pg->n, tri))
+		goto cleanup; /* gncov */
+
+	for (i = 0; i < pg->n - 2; i++) {
+		struct randtri *t = &rp->tris[rp->numtris];
+		size_t k;
+
+		for (k = 0; k < 3; k++) {
+			t->x[k] = x[tri[3 * i + k]];
+			t->y[k] = y[tri[3 * i + k]];
+		}
+		t->rmin2 = randtri_rmin2(t);
+		t->ring = ring;
+		w[rp->numtris] = randtri_area(f, t);
+		rp->area += w[rp->numtris];
+		rp->numtris++;
+	}
+	retval = 0;
+
+cleanup:
+	free(tri);
+	free(y);
+	free(x);
+
+	return retval;
+}
+
+/*
+ * randpoly_alias() - Builds the alias table in `rp` from the triangle areas 
+ * in `w` with the method by Vose, so a triangle is chosen with a probability 
+ * proportional to its area from one random number. Returns 1 if the memory 
+ * allocation failed, otherwise 0.
+ */
+
+static int randpoly_alias(struct randpoly *rp, double *w)
+{
+	const size_t n = rp->numtris;
+	size_t *stack, nsmall = 0, nlarge = n, i;
+
+	rp->prob = malloc(n * sizeof(double));
+	rp->alias = malloc(n * sizeof(size_t));
+	stack = malloc(n * sizeof(size_t));
+	if (!rp->prob || !rp->alias || !stack) {
+		failed("malloc()"); /* gncov */
+		free(stack); /* gncov */
+		return 1; /* gncov */
+	}
+
+	/* Small entries grow from the start, large ones from the end */
+	for (i = 0; i < n; i++) {
+		w[i] *= (double)n / rp->area;
+		if (w[i] < 1.0)
+			stack[nsmall++] = i;
+		else
+			stack[--nlarge] = i;
+	}
+	while (nsmall && nlarge < n) {
+		const size_t s = stack[--nsmall], l = stack[nlarge];
+
+		rp->prob[s] = w[s];
+		rp->alias[s] = l;
+		w[l] -= 1.0 - w[s];
+		if (w[l] < 1.0) {
+			nlarge++;
+			stack[nsmall++] = l;
+		}
+	}
+	while (nsmall) {
+		i = stack[--nsmall];
+		rp->prob[i] = 1.0;
+		rp->alias[i] = i;
+	}
+	for (; nlarge < n; nlarge++) {
+		i = stack[nlarge];
+		rp->prob[i] = 1.0;
+		rp->alias[i] = i;
+	}
+	free(stack);
+
+	return 0;
+}
+
+/*
+ * randpoly_init() - Prepares `dest` for random positions inside the `n` 
+ * polygons in `polys`, which must be smaller than a hemisphere. 
+ * Counterclockwise polygons are split into triangles, and an alias table of 
+ * the triangle areas is built, so the time for a position doesn't depend on 
+ * the number of vertices. Clockwise polygons are holes. `polys` must be 
+ * available until randpoly_free() is called. If the polygons have no area, 
+ * `dest->area` is 0. Returns 1 if the memory allocation failed, otherwise 0.
+ */
+
+int randpoly_init(struct randpoly *dest, const struct polygon *polys,
+                  const size_t n)
+{
+	double *w = NULL;
+	size_t i;
+	int retval = 1;
+
+	assert(dest);
+	assert(polys);
+
+	memset(dest, 0, sizeof(*dest));
+	dest->polys = polys;
+	dest->frames = malloc(n * sizeof(struct randframe));
+	dest->holes = malloc(n * sizeof(size_t));
+	if (!dest->frames || !dest->holes) {
+		failed("malloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	for (i = 0; i < n; i++) {
+		assert(polys[i].n >= 3);
+		assert(polys[i].cap.radius < M_PI / 2.0);
+		if (randpoly_ring(dest, i, &w))
+			goto cleanup; /* gncov */
+	}
+	if (dest->area > 0.0 && randpoly_alias(dest, w))
+		goto cleanup; /* gncov */
+	retval = 0;
+
+cleanup:
+	free(w);
+	if (retval)
+		randpoly_free(dest); /* gncov */
+
+	return retval;
+}
+
+/*
+ * randpoly_free() - Deallocates the memory used by `rp`. Returns nothing.
+ */
+
+void randpoly_free(struct randpoly *rp)
+{
+	assert(rp);
+
+	free(rp->alias);
+	free(rp->prob);
+	free(rp->holes);
+	free(rp->tris);
+	free(rp->frames);
+	memset(rp, 0, sizeof(*rp));
+}
+
+/*
+ * randpoly_pos() - Stores a uniformly distributed random position inside the 
+ * polygons in `rp` in `lat` and `lon`. A triangle is chosen from the alias 
+ * table, and a uniform point in the plane triangle is accepted with the 
+ * probability of the area scale of the gnomonic projection at that point 
+ * relative to the point closest to the center, so the positions are uniform 
+ * on the sphere. Positions inside a hole are thrown away. `rp->area` must 
+ * be larger than 0. Returns nothing.
+ */
+
+void randpoly_pos(const struct randpoly *rp, double *lat, double *lon)
+{
+	struct vec3 v;
+	size_t h;
+
+	assert(rp);
+	assert(rp->area > 0.0);
+	assert(lat);
+	assert(lon);
+
+	do {
+		const double r = drand48() * (double)rp->numtris;
+		size_t i = (size_t)r;
+		const struct randtri *t;
+		double u, w, x, y;
+
+		if (i >= rp->numtris)
+			i = rp->numtris - 1; /* gncov */
+		if (r - (double)i >= rp->prob[i])
+			i = rp->alias[i];
+		t = &rp->tris[i];
+		do {
+			u = drand48();
+			w = drand48();
+			if (u + w > 1.0) {
+				u = 1.0 - u;
+				w = 1.0 - w;
+			}
+			x = t->x[0] + u * (t->x[1] - t->x[0])
+			    + w * (t->x[2] - t->x[0]);
+			y = t->y[0] + u * (t->y[1] - t->y[0])
+			    + w * (t->y[2] - t->y[0]);
+		} while (drand48() > pow((1.0 + t->rmin2)
+		                         / (1.0 + x * x + y * y), 1.5));
+		randframe_vec3(&rp->frames[t->ring], x, y, &v);
+		for (h = 0; h < rp->numholes; h++) {
+			if (polygon_contains(&rp->polys[rp->holes[h]], &v))
+				break;
+		}
+	} while (h < rp->numholes);
+
+	vec3_to_pos(&v, lat, lon);
+}
+
+/*
+ * fibgrid_count() - Returns the number of positions needed to fill a cap 
+ * with the angular radius `radius` with positions about `spacing` radians 
+ * apart. Every position gets the area of a hexagon where the distance between 
+ * the centres of neighbouring hexagons is `spacing`. Returns at least 1.
+ */
+
+double fibgrid_count(const double radius, const double spacing)
+{
+	const double s = sin(fmin(radius, M_PI) / 2.0);
+	const double n = round(4.0 * M_PI * s * s
+	                       / (sqrt(3.0) / 2.0 * spacing * spacing));
+
+	return fmax(1.0, n);
+}
+
+/*
+ * fibgrid_init() - Prepares `dest` for `n` positions in a Fibonacci lattice 
+ * in the cap with the angular radius `radius` around `lat,lon`. With `radius` 
+ * set to π, the positions cover the whole Earth. Returns nothing.
+ */
+
+void fibgrid_init(struct fibgrid *dest, const double lat, const double lon,
+                  const double radius, const unsigned long n)
+{
+	const double rlat = deg2rad(lat), rlon = deg2rad(lon);
+	const double s = sin(fmin(radius, M_PI) / 2.0);
+
+	assert(dest);
+	assert(n > 0);
+
+	pos_to_vec3(lat, lon, &dest->center);
+	dest->east.x = -sin(rlon);
+	dest->east.y = cos(rlon);
+	dest->east.z = 0.0;
+	dest->north.x = -sin(rlat) * cos(rlon);
+	dest->north.y = -sin(rlat) * sin(rlon);
+	dest->north.z = cos(rlat);
+	dest->height = 2.0 * s * s;
+	dest->n = n;
+}
+
+/*
+ * fibgrid_point() - Stores position number `i` of the Fibonacci lattice in 
+ * `g` in `lat` and `lon`, where `i` is from 0 to `g->n` - 1. The positions 
+ * are placed at equal steps of height along the axis of the cap, so every 
+ * position gets the same area, and they're rotated with the golden angle 
+ * around the axis. Every position is calculated directly from `i`, so any 
+ * part of the lattice can be generated without the other positions. A lattice 
+ * with only one position has it at the center. Returns nothing.
+ */
+
+void fibgrid_point(const struct fibgrid *g, const unsigned long i,
+                   double *lat, double *lon)
+{
+	const double golden = (sqrt(5.0) - 1.0) / 2.0;
+	const double h = g->n == 1 ? 0.0
+	                 : g->height * ((double)i + 0.5) / (double)g->n;
+	const double r = sqrt(h * (2.0 - h));
+	double turn = (double)i * golden, c, s;
+	struct vec3 v;
+
+	assert(g);
+	assert(lat);
+	assert(lon);
+
+	turn -= floor(turn);
+	c = r * cos(2.0 * M_PI * turn);
+	s = r * sin(2.0 * M_PI * turn);
+	v.x = g->center.x * (1.0 - h) + c * g->east.x + s * g->north.x;
+	v.y = g->center.y * (1.0 - h) + c * g->east.y + s * g->north.y;
+	v.z = g->center.z * (1.0 - h) + c * g->east.z + s * g->north.z;
+	vec3_to_pos(&v, lat, lon);
+}
+
+/*
+ * routepoint() - Calculates the position of a point on a straight line between 
+ * `lat1, lon1` and `lat2, lon2`, where `fracdist` is a fraction that specifies 
+ * how far along the line the point is, with 0 = start position, 1 = end 
+ * position. `fracdist` can also take values below 0 or above 1 to calculate 
+ * positions beyond `lat2, lon2` or in the opposite direction from `lat1, 
+ * lon1`.
+ *
+ * See `bearing_position()` for information on return values.
+ */
+
+int routepoint(const double lat1, const double lon1,
+               const double lat2, const double lon2,
+               const double fracdist,
+               double *next_lat, double *next_lon)
+{
+	assert(next_lat);
+	assert(next_lon);
+
+	return bearing_position(lat1, lon1,
 	                        initial_bearing(lat1, lon1, lat2, lon2),
 	                        haversine(lat1, lon1, lat2, lon2) * fracdist,
 	                        next_lat, next_lon);
 }
 
+/*
+ * spread_bits() - Spreads the 32 bits of `x` to the even bit positions of a 
+ * 64-bit value, using shifts and masks instead of a loop over every bit. 
+ * Returns the spread value.
+ */
+
+static uint64_t spread_bits(const uint32_t x)
+{
+	uint64_t v = x;
+
+	v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+	v = (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+	v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	v = (v | (v << 2)) & 0x3333333333333333ULL;
+	v = (v | (v << 1)) & 0x5555555555555555ULL;
+
+	return v;
+}
+
+/*
+ * compact_bits() - The inverse of spread_bits(), collects the even bits of `v` 
+ * into a 32-bit value. Returns the collected bits.
+ */
+
+static uint32_t compact_bits(const uint64_t v)
+{
+	uint64_t x = v & 0x5555555555555555ULL;
+
+	x = (x | (x >> 1)) & 0x3333333333333333ULL;
+	x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+	x = (x | (x >> 4)) & 0x00ff00ff00ff00ffULL;
+	x = (x | (x >> 8)) & 0x0000ffff0000ffffULL;
+	x = (x | (x >> 16)) & 0x00000000ffffffffULL;
+
+	return (uint32_t)x;
+}
+
+/*
+ * morton_encode() - Interleaves the bits of `x` and `y`, with the bits from 
+ * `x` in the even positions and the bits from `y` in the odd positions. 
+ * Returns the interleaved value, also known as a Morton code or Z-order 
+ * value.
+ */
+
+uint64_t morton_encode(const uint32_t x, const uint32_t y)
+{
+	return spread_bits(x) | (spread_bits(y) << 1);
+}
+
+/*
+ * morton_decode() - The inverse of morton_encode(), stores the even bits of 
+ * `m` in `x` and the odd bits in `y`. Returns nothing.
+ */
+
+void morton_decode(const uint64_t m, uint32_t *x, uint32_t *y)
+{
+	assert(x);
+	assert(y);
+
+	*x = compact_bits(m);
+	*y = compact_bits(m >> 1);
+}
+
+static const char GEOHASH_CHARS[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+/*
+ * Values of the geohash characters plus one, 0 means invalid character. Upper 
+ * case letters are also accepted.
+ */
+
+static const unsigned char GEOHASH_VALUES[128] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6,
+	['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10, ['b'] = 11, ['B'] = 11,
+	['c'] = 12, ['C'] = 12, ['d'] = 13, ['D'] = 13, ['e'] = 14, ['E'] = 14,
+	['f'] = 15, ['F'] = 15, ['g'] = 16, ['G'] = 16, ['h'] = 17, ['H'] = 17,
+	['j'] = 18, ['J'] = 18, ['k'] = 19, ['K'] = 19, ['m'] = 20, ['M'] = 20,
+	['n'] = 21, ['N'] = 21, ['p'] = 22, ['P'] = 22, ['q'] = 23, ['Q'] = 23,
+	['r'] = 24, ['R'] = 24, ['s'] = 25, ['S'] = 25, ['t'] = 26, ['T'] = 26,
+	['u'] = 27, ['U'] = 27, ['v'] = 28, ['V'] = 28, ['w'] = 29, ['W'] = 29,
+	['x'] = 30, ['X'] = 30, ['y'] = 31, ['Y'] = 31, ['z'] = 32, ['Z'] = 32
+};
+
+/*
+ * geohash_cell() - Returns the number of the cell that contains `v` when the 
+ * range from `min` to `min + range` is divided into 2^GEOHASH_BITS cells. The 
+ * subtraction can round a value just below a cell border up to the border, 
+ * so this is corrected to make the result identical to repeated bisection, 
+ * which is how geohashes are defined.
+ */
+
+static uint32_t geohash_cell(const double v, const double min,
+                             const double range)
+{
+	const double cells = (double)(1UL << GEOHASH_BITS);
+	double q = floor((v - min) / range * cells);
+
+	if (q > cells - 1.0)
+		q = cells - 1.0;
+	if (q > 0.0 && v < min + q * (range / cells))
+		q -= 1.0;
+
+	return (uint32_t)q;
+}
+
+/*
+ * geohash_make() - Stores the first `len` characters of the geohash of the 
+ * cells `lat` and `lon` in `dest`, which must have room for `len + 1` bytes. 
+ * `lat` and `lon` are cell numbers with GEOHASH_BITS bits. Returns nothing.
+ */
+
+static void geohash_make(const uint32_t lat, const uint32_t lon,
+                         const size_t len, char *dest)
+{
+	const uint64_t m = morton_encode(lat, lon);
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		dest[i] = GEOHASH_CHARS[(m >> (GEOHASH_BITS * 2 - 5 - 5 * i))
+		                        & 31];
+	dest[len] = '\0';
+}
+
+/*
+ * geohash_encode() - Stores the geohash with `len` characters of the position 
+ * `lat, lon` in `dest`, which must have room for `len + 1` bytes. `len` must 
+ * be in the range 1..GEOHASH_MAX_LEN. Returns 1 if `len` or the position is 
+ * invalid, otherwise 0.
+ */
+
+int geohash_encode(const double lat, const double lon, const size_t len,
+                   char *dest)
+{
+	assert(dest);
+
+	if (!len || len > GEOHASH_MAX_LEN || !(fabs(lat) <= 90.0)
+	    || !(fabs(lon) <= 180.0))
+		return 1;
+	geohash_make(geohash_cell(lat, -90.0, 180.0),
+	             geohash_cell(lon, -180.0, 360.0), len, dest);
+
+	return 0;
+}
+
+/*
+ * geohash_cells() - Parses the geohash `hash` and stores the latitude cell in 
+ * `lat` and the longitude cell in `lon`, using `latbits` and `lonbits` bits. 
+ * The number of characters is stored in `len`. Returns 1 if `hash` is empty, 
+ * too long or contains invalid characters, otherwise 0.
+ */
+
+static int geohash_cells(const char *hash, uint32_t *lat, uint32_t *lon,
+                         unsigned int *latbits, unsigned int *lonbits,
+                         size_t *len)
+{
+	uint64_t m = 0;
+	unsigned int bits;
+	size_t n;
+
+	for (n = 0; hash[n]; n++) {
+		const unsigned char c = (unsigned char)hash[n];
+
+		if (n == GEOHASH_MAX_LEN || c >= 128 || !GEOHASH_VALUES[c])
+			return 1;
+		m = (m << 5) | (uint64_t)(GEOHASH_VALUES[c] - 1);
+	}
+	if (!n)
+		return 1;
+
+	bits = 5 * (unsigned int)n;
+	morton_decode(m << (GEOHASH_BITS * 2 - bits), lat, lon);
+	*latbits = bits / 2;
+	*lonbits = bits - *latbits;
+	*lat >>= GEOHASH_BITS - *latbits;
+	*lon >>= GEOHASH_BITS - *lonbits;
+	*len = n;
+
+	return 0;
+}
+
+/*
+ * geohash_decode() - Stores the center of the geohash `hash` in `lat` and 
+ * `lon`, and the distance in degrees from the center to the edges of the cell 
+ * in `lat_err` and `lon_err`. `lat_err` and `lon_err` can be NULL. Returns 1 
+ * if `hash` is invalid, otherwise 0.
+ */
+
+int geohash_decode(const char *hash, double *lat, double *lon,
+                   double *lat_err, double *lon_err)
+{
+	uint32_t la, lo;
+	unsigned int latbits, lonbits;
+	size_t len;
+	double lasize, losize;
+
+	assert(hash);
+	assert(lat);
+	assert(lon);
+
+	if (geohash_cells(hash, &la, &lo, &latbits, &lonbits, &len))
+		return 1;
+	lasize = ldexp(180.0, -(int)latbits);
+	losize = ldexp(360.0, -(int)lonbits);
+	*lat = -90.0 + ((double)la + 0.5) * lasize;
+	*lon = -180.0 + ((double)lo + 0.5) * losize;
+	if (lat_err)
+		*lat_err = lasize / 2.0;
+	if (lon_err)
+		*lon_err = losize / 2.0;
+
+	return 0;
+}
+
+/*
+ * geohash_neighbour() - Stores the geohash of the cell `dlat` cells north and 
+ * `dlon` cells east of the geohash `hash` in `dest`, which must have room for 
+ * the same number of characters as `hash`. The longitude wraps around the 
+ * antimeridian. Returns 1 if `hash` is invalid or the cell is beyond one of 
+ * the poles, otherwise 0.
+ */
+
+int geohash_neighbour(const char *hash, const long dlat, const long dlon,
+                      char *dest)
+{
+	uint32_t la, lo;
+	unsigned int latbits, lonbits;
+	size_t len;
+	long nlat;
+	unsigned long nlon;
+
+	assert(hash);
+	assert(dest);
+
+	if (geohash_cells(hash, &la, &lo, &latbits, &lonbits, &len))
+		return 1;
+	nlat = (long)la + dlat;
+	if (nlat < 0 || nlat >= 1L << latbits)
+		return 1;
+	nlon = ((unsigned long)lo + (unsigned long)dlon)
+	       & ((1UL << lonbits) - 1);
+	geohash_make((uint32_t)nlat << (GEOHASH_BITS - latbits),
+	             (uint32_t)nlon << (GEOHASH_BITS - lonbits), len, dest);
+
+	return 0;
+}
+
+/*
+ * sort_cell() - Returns the number of the cell that contains `v` when the 
+ * range from `min` to `min + range` is divided into 2^32 cells.
+ */
+
+static uint32_t sort_cell(const double v, const double min,
+                          const double range)
+{
+	const double cells = 4294967296.0; /* 2^32 */
+	const double q = floor((v - min) / range * cells);
+
+	return q > cells - 1.0 ? UINT32_MAX : (uint32_t)q;
+}
+
+/*
+ * morton_key() - Returns the position of `lat, lon` along a Z-order curve 
+ * over the latitude/longitude plane with 2^32 cells in each direction. 
+ * Positions with close keys are close to each other, but the curve makes long 
+ * jumps at the borders between the quadrants.
+ */
+
+uint64_t morton_key(const double lat, const double lon)
+{
+	return morton_encode(sort_cell(lat, -90.0, 180.0),
+	                     sort_cell(lon, -180.0, 360.0));
+}
+
+/*
+ * hilbert_key() - Returns the position of `lat, lon` along a Hilbert curve 
+ * over the latitude/longitude plane with 2^32 cells in each direction. Unlike 
+ * the Z-order curve, consecutive cells along the Hilbert curve are always 
+ * neighbours, so positions sorted by this key have better locality.
+ */
+
+uint64_t hilbert_key(const double lat, const double lon)
+{
+	uint32_t x = sort_cell(lon, -180.0, 360.0),
+	         y = sort_cell(lat, -90.0, 180.0);
+	uint64_t d = 0;
+	uint32_t s;
+
+	for (s = 1U << 31; s; s >>= 1) {
+		const uint32_t rx = (x & s) ? 1 : 0, ry = (y & s) ? 1 : 0;
+
+		d += (uint64_t)s * s * ((3 * rx) ^ ry);
+		if (!ry) {
+			uint32_t t;
+
+			if (rx) {
+				x = ~x;
+				y = ~y;
+			}
+			t = x;
+			x = y;
+			y = t;
+		}
+	}
+
+	return d;
+}
+
+#undef ELLIPSOID
 #undef deg2rad
 #undef rad2deg
 
@@ -22,47 +22,466 @@
 #define _GEOMATH_H
 
 #include <math.h>
+#include <stdint.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+#define APPROX_ABS_ERROR  1e-6
+#define APPROX_MAX_DIST  100000.0
+#define APPROX_MAX_LAT  80.0
+#define CELLGRID_MAX_CELLSIZE  10.0
+#define CELLGRID_MIN_CELLSIZE  0.01
+#define CHEAPRULER_MAX_ERROR  5e-4
+#define CPA_MAX_STEPS  1000000UL
+#define EQUIRECT_MAX_ERROR  5e-4
+#define FIBGRID_MAX_POINTS  4000000000.0
+#define GEOHASH_BITS  30
+#define GEOHASH_MAX_LEN  12
+#define HAVERSINE32_MAX_ERROR  1e-6
 #define HAVERSINE_DECIMALS  6
 #define KARNEY_DECIMALS  8
+#define MGRS_MAX_LEN  15
+#define TMERC_ORDER  6
+#define POLYINDEX_MAX_CELLS  64
+#define POLYLINE_BLOCK  32
+#define SEPINDEX_MAX_MISSES  1000000UL
+#define SEPINDEX_MIN_CELLS  1024
 
 typedef enum {
 	FRM_HAVERSINE,
-	FRM_KARNEY
+	FRM_CHEAPRULER,
+	FRM_EQUIRECT,
+	FRM_HAVERSINE32,
+	FRM_KARNEY,
+	FRM_RHUMB
 } DistFormula;
 
+struct ellipsoid {
+	double a;
+	double f;
+	double b;
+	double e2;
+	double ep2;
+};
+
+struct compsum {
+	double sum;
+	double comp;
+};
+
+struct bbox {
+	unsigned long count;
+	double minlat;
+	double maxlat;
+	double minlon;
+	double maxlon;
+	double minlon360;
+	double maxlon360;
+};
+
+struct vec3 {
+	double x;
+	double y;
+	double z;
+};
+
+struct enuframe {
+	struct vec3 origin;
+	struct vec3 east;
+	struct vec3 north;
+	struct vec3 up;
+};
+
+struct tmerc {
+	double k0a;
+	double e;
+	double e2m;
+	double alp[TMERC_ORDER + 1];
+	double bet[TMERC_ORDER + 1];
+};
+
+struct centroid {
+	struct vec3 ref;
+	struct compsum dx;
+	struct compsum dy;
+	struct compsum dz;
+	struct compsum dist2;
+	struct compsum weight;
+	unsigned long count;
+};
+
+struct polyarea {
+	DistFormula formula;
+	const struct ellipsoid *ell;
+	double e;
+	double qp;
+	double radius;
+	struct compsum ring;
+	struct compsum area;
+	struct compsum perimeter;
+	double first_lat;
+	double first_lon;
+	double first_tan;
+	double first_cos;
+	double prev_lat;
+	double prev_lon;
+	double prev_tan;
+	double prev_cos;
+	unsigned long ringcount;
+	unsigned long count;
+	unsigned long rings;
+};
+
+struct origin {
+	double lat;
+	double lon;
+	double sin_lat;
+	double cos_lat;
+};
+
+struct arc {
+	struct vec3 a;
+	struct vec3 b;
+	struct vec3 pole;
+	struct vec3 pole_a;
+	struct vec3 b_pole;
+	int degenerate;
+};
+
+struct mover {
+	struct vec3 pos;
+	struct vec3 dir;
+	double rate;
+};
+
+struct cap {
+	struct vec3 center;
+	double radius;
+	double cos_radius;
+	double sin_radius;
+};
+
+struct fibgrid {
+	struct vec3 center;
+	struct vec3 east;
+	struct vec3 north;
+	double height;
+	unsigned long n;
+};
+
+struct leg {
+	struct arc arc;
+	struct cap cap;
+	double len;
+	double start;
+};
+
+struct polyline {
+	struct leg *legs;
+	struct cap *blocks;
+	size_t n;
+	size_t alloc;
+	struct vec3 prev;
+	int has_prev;
+	struct compsum len;
+};
+
+struct polygon {
+	struct vec3 *vert;
+	struct vec3 *normal;
+	double *ref_dot;
+	size_t n;
+	struct cap cap;
+	struct vec3 ref;
+};
+
+struct cellgrid {
+	double cellsize;
+	unsigned long nlat;
+	unsigned long nlon;
+};
+
+struct polyentry {
+	unsigned long cell;
+	size_t poly;
+};
+
+struct polyindex {
+	const struct polygon *polys;
+	size_t numpolys;
+	struct cellgrid grid;
+	struct polyentry *entries;
+	size_t numentries;
+	size_t *large;
+	size_t numlarge;
+};
+
+struct pointentry {
+	unsigned long cell;
+	size_t point;
+	struct vec3 v;
+};
+
+struct pointindex {
+	struct cellgrid grid;
+	double radius;
+	double chord2;
+	struct pointentry *entries;
+	size_t n;
+};
+
+struct randframe {
+	struct vec3 center;
+	struct vec3 east;
+	struct vec3 north;
+};
+
+struct randtri {
+	double x[3];
+	double y[3];
+	double rmin2;
+	size_t ring;
+};
+
+struct randpoly {
+	const struct polygon *polys;
+	struct randframe *frames;
+	struct randtri *tris;
+	double *prob;
+	size_t *alias;
+	size_t numtris;
+	size_t *holes;
+	size_t numholes;
+	double area;
+};
+
+struct sepcell {
+	int64_t x;
+	int64_t y;
+	int64_t z;
+	size_t head;
+};
+
+struct sepindex {
+	double chord2;
+	double cellsize;
+	struct vec3 *pts;
+	size_t *next;
+	size_t n;
+	size_t alloc;
+	struct sepcell *cells;
+	size_t numcells;
+	size_t usedcells;
+};
+
+extern const double EARTH_RADIUS;
 extern const double MAX_EARTH_DISTANCE;
+extern const struct ellipsoid WGS84;
 
 int are_antipodal(const double lat1, const double lon1,
                   const double lat2, const double lon2);
 void set_antipode(double *dlat, double *dlon);
+void origin_init(struct origin *dest, const double lat, const double lon);
+void origin_position(const struct origin *org, const double sin_bear,
+                     const double cos_bear, const double sin_dist,
+                     const double cos_dist, double *new_lat,
+                     double *new_lon);
+void origin_positions(const struct origin *org, const double *sin_bear,
+                      const double *cos_bear, const size_t n,
+                      const double dist, double *new_lat, double *new_lon);
 int bearing_position(const double lat, const double lon,
                      const double bearing_deg, const double dist_m,
                      double *new_lat, double *new_lon);
 double haversine(const double lat1, const double lon1,
                  const double lat2, const double lon2);
+int ellipsoid_init(struct ellipsoid *dest, const double a, const double f);
+int ellipsoid_by_name(struct ellipsoid *dest, const char *name);
+double geod_distance(const struct ellipsoid *ell,
+                     const double lat1, const double lon1,
+                     const double lat2, const double lon2);
 double karney_distance(double lat1, double lon1, double lat2, double lon2);
+double geod_bearing(const struct ellipsoid *ell,
+                    const double lat1, const double lon1,
+                    const double lat2, const double lon2);
 double karney_bearing(const double lat1, const double lon1,
                       const double lat2, const double lon2);
-double distance(const DistFormula formula,
+double equirect_distance(const double lat1, const double lon1,
+                         const double lat2, const double lon2);
+double cheapruler_distance(const struct ellipsoid *ell,
+                           const double lat1, const double lon1,
+                           const double lat2, const double lon2);
+double haversine32(const double lat1, const double lon1,
+                   const double lat2, const double lon2);
+double rhumb_distance(const double lat1, const double lon1,
+                      const double lat2, const double lon2);
+double rhumb_bearing(const double lat1, const double lon1,
+                     const double lat2, const double lon2);
+int rhumb_position(const double lat, const double lon,
+                   const double bearing_deg, const double dist_m,
+                   double *new_lat, double *new_lon);
+int rhumb_point(const double lat1, const double lon1,
+                const double lat2, const double lon2,
+                const double fracdist,
+                double *next_lat, double *next_lon);
+double distance(const DistFormula formula, const struct ellipsoid *ell,
                 const double lat1, const double lon1,
                 const double lat2, const double lon2);
+double approx_error(const DistFormula formula, DistFormula *exact);
+double threshold_distance(const DistFormula formula,
+                          const struct ellipsoid *ell,
+                          const double lat1, const double lon1,
+                          const double lat2, const double lon2,
+                          const double maxdist);
 double initial_bearing(const double lat1, const double lon1,
                        const double lat2, const double lon2);
-double bearing(const DistFormula formula,
+double bearing(const DistFormula formula, const struct ellipsoid *ell,
                const double lat1, const double lon1,
                const double lat2, const double lon2);
+void distance_batch(const DistFormula formula, const struct ellipsoid *ell,
+                    const double *lat, const double *lon, const size_t n,
+                    double *dest);
+void bearing_batch(const DistFormula formula, const struct ellipsoid *ell,
+                   const double *lat, const double *lon, const size_t n,
+                   double *dest);
+void compsum_init(struct compsum *s);
+void compsum_add(struct compsum *s, const double x);
+double compsum_result(const struct compsum *s);
+void bbox_init(struct bbox *b);
+void bbox_add(struct bbox *b, const double lat, const double lon);
+int bbox_lon(const struct bbox *b, double *west, double *east);
+void pos_to_vec3(const double lat, const double lon, struct vec3 *dest);
+double vec3_chord2(const struct vec3 *a, const struct vec3 *b);
+int vec3_to_pos(const struct vec3 *v, double *lat, double *lon);
+double vec3_angle(const struct vec3 *a, const struct vec3 *b);
+void geodetic_to_ecef(const struct ellipsoid *ell, const double lat,
+                      const double lon, const double h, struct vec3 *dest);
+void ecef_to_geodetic(const struct ellipsoid *ell, const struct vec3 *p,
+                      double *lat, double *lon, double *h);
+void geodetic_to_ecef_batch(const struct ellipsoid *ell,
+                            const double *lat, const double *lon,
+                            const double *h, const size_t n,
+                            double *x, double *y, double *z);
+void ecef_to_geodetic_batch(const struct ellipsoid *ell,
+                            const double *x, const double *y,
+                            const double *z, const size_t n,
+                            double *lat, double *lon, double *h);
+void enuframe_init(struct enuframe *dest, const struct ellipsoid *ell,
+                   const double lat, const double lon, const double h);
+void ecef_to_enu_batch(const struct enuframe *f,
+                       const double *x, const double *y, const double *z,
+                       const size_t n, double *e, double *nn, double *u);
+void enu_to_ecef_batch(const struct enuframe *f,
+                       const double *e, const double *nn, const double *u,
+                       const size_t n, double *x, double *y, double *z);
+void tmerc_init(struct tmerc *dest, const double a, const double f,
+                const double k0);
+void tmerc_forward(const struct tmerc *tm, const double lon0,
+                   const double lat, const double lon, double *x, double *y);
+void tmerc_reverse(const struct tmerc *tm, const double lon0,
+                   const double x, const double y, double *lat, double *lon);
+void utm_init(struct tmerc *dest, const struct ellipsoid *ell);
+int utm_zone(const double lat, const double lon);
+char utm_band(const double lat);
+int utm_forward(const struct tmerc *tm, const double lat, const double lon,
+                int *zone, double *easting, double *northing);
+int utm_reverse(const struct tmerc *tm, const int zone, const int north,
+                const double easting, const double northing,
+                double *lat, double *lon);
+size_t utm_forward_batch(const struct tmerc *tm,
+                         const double *lat, const double *lon,
+                         const size_t n, int *zone,
+                         double *easting, double *northing);
+int mgrs_encode(const double lat, const int zone, const double easting,
+                const double northing, const int digits, char *dest);
+void centroid_init(struct centroid *dest);
+void centroid_add(struct centroid *c, const double lat, const double lon,
+                  const double weight);
+int centroid_result(const struct centroid *c, double *lat, double *lon,
+                    double *resultant, double *dispersion);
+void polyarea_init(struct polyarea *dest, const DistFormula formula,
+                   const struct ellipsoid *ell);
+void polyarea_add(struct polyarea *pa, const double lat, const double lon);
+void polyarea_close(struct polyarea *pa);
+int polyarea_result(const struct polyarea *pa, double *area,
+                    double *perimeter);
+void arc_init(struct arc *dest, const struct vec3 *a, const struct vec3 *b);
+double arc_angle(const struct arc *arc, const struct vec3 *p);
+double arc_cross_track(const struct arc *arc, const struct vec3 *p);
+double arc_along_track(const struct arc *arc, const struct vec3 *p);
+void cross_track_batch(const struct arc *arc,
+                       const double *lat, const double *lon, const size_t n,
+                       double *xtrack, double *atrack);
+int arc_intersect(const struct arc *a1, const struct arc *a2,
+                  struct vec3 *dest);
+size_t intersect_batch(const struct arc *arc,
+                       const double *lat, const double *lon, const size_t n,
+                       double *dlat, double *dlon, double *atrack,
+                       size_t *leg);
+void mover_init(struct mover *dest, const double lat, const double lon,
+                const double bearing_deg, const double speed);
+void mover_pos(const struct mover *m, const double t, struct vec3 *dest);
+double closest_approach(const struct mover *m1, const struct mover *m2,
+                        double *angle);
+void polyline_init(struct polyline *dest);
+void polyline_free(struct polyline *pl);
+int polyline_add(struct polyline *pl, const double lat, const double lon);
+void polyline_break(struct polyline *pl);
+size_t polyline_nearest(const struct polyline *pl, const struct vec3 *p,
+                        const size_t hint, double *xtrack, double *atrack);
+int polygon_init(struct polygon *dest,
+                 const double *lat, const double *lon, const size_t n);
+void polygon_free(struct polygon *pg);
+int polygon_contains(const struct polygon *pg, const struct vec3 *p);
+int polyindex_init(struct polyindex *dest, const struct polygon *polys,
+                   const size_t n);
+void polyindex_free(struct polyindex *idx);
+size_t polyindex_search(const struct polyindex *idx,
+                        const double lat, const double lon, size_t *dest);
+int pointindex_init(struct pointindex *dest,
+                    const double *lat, const double *lon, const size_t n,
+                    const double radius);
+void pointindex_free(struct pointindex *idx);
+size_t pointindex_search(const struct pointindex *idx,
+                         const double lat, const double lon, size_t *dest);
+int sepindex_init(struct sepindex *dest, const double separation);
+void sepindex_free(struct sepindex *si);
+int sepindex_add(struct sepindex *si, const double lat, const double lon);
+long dbscan(const double *lat, const double *lon, const size_t n,
+            const double eps, const size_t minpts, unsigned long *cluster);
+void polyline_batch(const struct polyline *pl,
+                    const double *lat, const double *lon, const size_t n,
+                    double *xtrack, double *atrack, size_t *leg);
+double gaussian_radius(const struct ellipsoid *ell, const double lat);
 void rand_pos(double *dlat, double *dlon,
               const double c_lat, const double c_lon,
               const double maxdist, const double mindist);
+void rand_bbox(double *lat, double *lon, const double lat1,
+               const double lon1, const double lat2, const double lon2);
+int randpoly_init(struct randpoly *dest, const struct polygon *polys,
+                  const size_t n);
+void randpoly_free(struct randpoly *rp);
+void randpoly_pos(const struct randpoly *rp, double *lat, double *lon);
+double fibgrid_count(const double radius, const double spacing);
+void fibgrid_init(struct fibgrid *dest, const double lat, const double lon,
+                  const double radius, const unsigned long n);
+void fibgrid_point(const struct fibgrid *g, const unsigned long i,
+                   double *lat, double *lon);
 int routepoint(const double lat1, const double lon1,
                const double lat2, const double lon2,
                const double fracdist,
                double *next_lat, double *next_lon);
+uint64_t morton_encode(const uint32_t x, const uint32_t y);
+void morton_decode(const uint64_t m, uint32_t *x, uint32_t *y);
+int geohash_encode(const double lat, const double lon, const size_t len,
+                   char *dest);
+int geohash_decode(const char *hash, double *lat, double *lon,
+                   double *lat_err, double *lon_err);
+int geohash_neighbour(const char *hash, const long dlat, const long dlon,
+                      char *dest);
+uint64_t morton_key(const double lat, const double lon);
+uint64_t hilbert_key(const double lat, const double lon);
 
 #endif /* ifndef _GEOMATH_H */
 
@@ -114,4 +114,479 @@ cleanup:
 	return retval;
 }
 
+/*
+ * gpx_open() - Prepares `dest` for reading positions from the GPX file `fp`. 
+ * `name` is used in error messages, and `linenum` is the line number of the 
+ * first byte in `fp`. Returns 0 if ok, or 1 if the buffer couldn't be 
+ * allocated.
+ */
+
+int gpx_open(struct gpxreader *dest, FILE *fp, const char *name,
+             const unsigned long linenum)
+{
+	assert(dest);
+	assert(fp);
+	assert(name);
+
+	dest->buf = malloc(GPX_BUFSIZE);
+	if (!dest->buf) {
+		failed("malloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+	dest->fp = fp;
+	dest->name = name;
+	dest->chunksize = GPX_BUFSIZE;
+	dest->pos = dest->len = 0;
+	dest->linenum = linenum;
+	dest->state = GX_TEXT;
+	dest->quote = '\0';
+	dest->endcount = 0;
+	dest->taglen = 0;
+	dest->textlen = 0;
+	dest->textelem = GE_OTHER;
+	dest->point = GE_OTHER;
+	dest->lastpoint = GE_OTHER;
+	dest->segpoints = 0;
+	dest->pending = false;
+	dest->lat = dest->lon = dest->ele = dest->time = NAN;
+
+	return 0;
+}
+
+/*
+ * gpx_close() - Deallocates the buffer used by `g`. The file is not closed. 
+ * Returns nothing.
+ */
+
+void gpx_close(struct gpxreader *g)
+{
+	assert(g);
+
+	free(g->buf);
+	g->buf = NULL;
+}
+
+/*
+ * gpx_element() - Returns the type of the element with the name `name` with 
+ * length `len`. Any namespace prefix must already be removed.
+ */
+
+static GpxElement gpx_element(const char *name, const size_t len)
+{
+	static const struct {
+		const char *name;
+		GpxElement type;
+	} elems[] = {
+		{ "ele", GE_ELE },
+		{ "rte", GE_SEGMENT },
+		{ "rtept", GE_RTEPT },
+		{ "time", GE_TIME },
+		{ "trk", GE_SEGMENT },
+		{ "trkpt", GE_TRKPT },
+		{ "trkseg", GE_SEGMENT },
+		{ "wpt", GE_WPT },
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(elems) / sizeof(elems[0]); i++) {
+		if (strlen(elems[i].name) == len
+		    && !memcmp(elems[i].name, name, len))
+			return elems[i].type;
+	}
+
+	return GE_OTHER;
+}
+
+/*
+ * gpx_point_attrs() - Parses the attributes in `p`, the part of a tag after 
+ * the element name, and stores the values of the `lat` and `lon` attributes 
+ * in `g`. The string is modified. Returns 0 if both attributes exist and 
+ * contain valid values, otherwise 1.
+ */
+
+static int gpx_point_attrs(struct gpxreader *g, char *p)
+{
+	bool has_lat = false, has_lon = false;
+
+	while (1) {
+		char *name, *val, quote;
+		size_t namelen;
+		double d;
+
+		while (isspace((unsigned char)*p))
+			p++;
+		if (!*p || *p == '/')
+			break;
+		name = p;
+		namelen = strcspn(p, "= \t\r\n/");
+		p += namelen;
+		while (isspace((unsigned char)*p))
+			p++;
+		if (*p++ != '=')
+			return 1;
+		while (isspace((unsigned char)*p))
+			p++;
+		quote = *p;
+		if (quote != '"' && quote != '\'')
+			return 1;
+		val = ++p;
+		p = strchr(p, quote);
+		if (!p)
+			return 1;
+		*p++ = '\0';
+		if (namelen != 3)
+			continue;
+		if (!memcmp(name, "lat", 3)) {
+			errno = 0;
+			if (string_to_double(val, &d) || !(fabs(d) <= 90.0))
+				return 1;
+			g->lat = d;
+			has_lat = true;
+		} else if (!memcmp(name, "lon", 3)) {
+			errno = 0;
+			if (string_to_double(val, &d) || !(fabs(d) <= 180.0))
+				return 1;
+			g->lon = d;
+			has_lon = true;
+		}
+	}
+	errno = 0;
+
+	return !(has_lat && has_lon);
+}
+
+/*
+ * gpx_end_point() - Called when the point element in `g` ends. If the type of 
+ * point differs from the previous one, for example a <trkpt> after a <wpt>, 
+ * the point is stored and a segment break is returned first. Returns PS_POINT 
+ * or PS_BREAK.
+ */
+
+static PointStatus gpx_end_point(struct gpxreader *g)
+{
+	const GpxElement type = g->point;
+
+	g->point = GE_OTHER;
+	if (g->segpoints && type != g->lastpoint) {
+		g->lastpoint = type;
+		g->segpoints = 1;
+		g->pending = true;
+		return PS_BREAK;
+	}
+	g->lastpoint = type;
+	g->segpoints++;
+
+	return PS_POINT;
+}
+
+/*
+ * gpx_end_text() - Called when the <ele> or <time> element in `g` ends, and 
+ * stores the value in `g`. Returns 0 if ok, or 1 if the value is invalid.
+ */
+
+static int gpx_end_text(struct gpxreader *g)
+{
+	const char *ename = g->textelem == GE_ELE ? "ele" : "time";
+	int res;
+
+	if (g->textlen == GPX_TEXTSIZE) {
+		myerror("%s:%lu: Value in <%s> is too long",
+		        g->name, g->linenum, ename);
+		return 1;
+	}
+	g->text[g->textlen] = '\0';
+	errno = 0;
+	if (g->textelem == GE_ELE)
+		res = string_to_double(g->text, &g->ele) || !isfinite(g->ele);
+	else
+		res = parse_datetime(g->text, &g->time);
+	g->textelem = GE_OTHER;
+	errno = 0;
+	if (res) {
+		myerror("%s:%lu: Invalid value in <%s>: %s",
+		        g->name, g->linenum, ename, g->text);
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * gpx_end_tag() - Handles the tag stored in `g` when the final '>' is found. 
+ * Returns PS_POINT if a point element ended, PS_BREAK if a new segment 
+ * started, PS_ERROR if the tag contains invalid data, or -1 if the tag 
+ * doesn't produce any results.
+ */
+
+static int gpx_end_tag(struct gpxreader *g)
+{
+	char *p = g->tag, *colon;
+	bool closing, selfclosing, overflow;
+	size_t namelen;
+	GpxElement type;
+
+	if (!g->taglen || *p == '?' || *p == '!')
+		return -1;
+	overflow = g->taglen == GPX_TAGSIZE;
+	if (overflow)
+		g->taglen--;
+	p[g->taglen] = '\0';
+	closing = *p == '/';
+	selfclosing = !closing && p[g->taglen - 1] == '/';
+	p += closing;
+	namelen = strcspn(p, " \t\r\n/");
+	colon = memchr(p, ':', namelen);
+	if (colon) {
+		namelen -= (size_t)(colon + 1 - p);
+		p = colon + 1;
+	}
+	type = gpx_element(p, namelen);
+
+	switch (type) {
+	case GE_WPT:
+	case GE_RTEPT:
+	case GE_TRKPT:
+		if (closing) {
+			if (type != g->point) {
+				myerror("%s:%lu: Unexpected end tag </%.*s>",
+				        g->name, g->linenum, (int)namelen, p);
+				return PS_ERROR;
+			}
+			return gpx_end_point(g);
+		}
+		if (g->point) {
+			myerror("%s:%lu: Nested point element <%.*s>",
+			        g->name, g->linenum, (int)namelen, p);
+			return PS_ERROR;
+		}
+		if (overflow) {
+			myerror("%s:%lu: Tag is too long",
+			        g->name, g->linenum);
+			return PS_ERROR;
+		}
+		if (gpx_point_attrs(g, p + namelen)) {
+			errno = 0;
+			myerror("%s:%lu: Missing or invalid lat/lon"
+			        " attribute in <%.*s>",
+			        g->name, g->linenum, (int)namelen, p);
+			return PS_ERROR;
+		}
+		g->point = type;
+		g->ele = g->time = NAN;
+		if (selfclosing)
+			return gpx_end_point(g);
+		break;
+	case GE_ELE:
+	case GE_TIME:
+		if (closing && g->textelem == type)
+			return gpx_end_text(g) ? PS_ERROR : -1;
+		if (!closing && !selfclosing && g->point) {
+			g->textelem = type;
+			g->textlen = 0;
+		}
+		break;
+	case GE_SEGMENT:
+		if (!closing && g->segpoints) {
+			g->segpoints = 0;
+			return PS_BREAK;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return -1;
+}
+
+/*
+ * gpx_add_text() - Adds the character `c` to the element text in `g`. If the 
+ * text is too long, `textlen` is set to GPX_TEXTSIZE, and an error is 
+ * reported at the end of the element. Returns nothing.
+ */
+
+static void gpx_add_text(struct gpxreader *g, const char c)
+{
+	if (g->textlen < GPX_TEXTSIZE - 1)
+		g->text[g->textlen++] = c;
+	else
+		g->textlen = GPX_TEXTSIZE;
+}
+
+/*
+ * gpx_skip_text() - Skips the text in the buffer of `g` up to the next '<' 
+ * with memchr() and counts the newlines. Returns true if a '<' was found, or 
+ * false if the rest of the buffer was skipped.
+ */
+
+static bool gpx_skip_text(struct gpxreader *g)
+{
+	const char *p = g->buf + g->pos, *end = g->buf + g->len, *lt, *nl;
+
+	lt = memchr(p, '<', (size_t)(end - p));
+	if (lt)
+		end = lt;
+	while ((nl = memchr(p, '\n', (size_t)(end - p)))) {
+		g->linenum++;
+		p = nl + 1;
+	}
+	g->pos = (size_t)(end - g->buf);
+	if (!lt)
+		return false;
+	g->pos++;
+
+	return true;
+}
+
+/*
+ * gpx_read_chunk() - Reads the next chunk of the file in `g` into the buffer. 
+ * Returns PS_POINT if any data was read, PS_EOF at the end of the file, or 
+ * PS_ERROR if the file ends inside a tag or a point element or can't be 
+ * read.
+ */
+
+static PointStatus gpx_read_chunk(struct gpxreader *g)
+{
+	size_t n = fread(g->buf, 1, g->chunksize, g->fp);
+
+	if (n) {
+		g->pos = 0;
+		g->len = n;
+		return PS_POINT;
+	}
+	if (ferror(g->fp)) {
+		myerror("%s: Read error", g->name); /* gncov */
+		return PS_ERROR; /* gncov */
+	}
+	if (g->state != GX_TEXT || g->point) {
+		myerror("%s:%lu: Unexpected end of file",
+		        g->name, g->linenum);
+		return PS_ERROR;
+	}
+
+	return PS_EOF;
+}
+
+/*
+ * gpx_next() - Reads the next <wpt>, <rtept> or <trkpt> element from `g` 
+ * without building any document tree. The position is stored in `lat` and 
+ * `lon`, and the values of the <ele> and <time> elements in `ele` and 
+ * `time`, where `time` is seconds since 1970-01-01T00:00:00Z. Missing values 
+ * are stored as NaN. A new segment starts at every <trk>, <trkseg> or <rte> 
+ * element and when the type of the points changes. Returns the same values 
+ * as pointreader_next().
+ */
+
+PointStatus gpx_next(struct gpxreader *g, double *lat, double *lon,
+                     double *ele, double *time)
+{
+	int st = -1;
+
+	assert(g);
+	assert(g->buf);
+	assert(lat);
+	assert(lon);
+	assert(ele);
+	assert(time);
+
+	if (g->pending) {
+		g->pending = false;
+		st = PS_POINT;
+	}
+
+	while (st == -1) {
+		char c;
+
+		if (g->pos == g->len) {
+			st = gpx_read_chunk(g);
+			if (st != PS_POINT)
+				return st;
+			st = -1;
+		}
+		if (g->state == GX_TEXT && !g->textelem) {
+			if (gpx_skip_text(g)) {
+				g->state = GX_TAG;
+				g->taglen = 0;
+				g->quote = '\0';
+			}
+			continue;
+		}
+		c = g->buf[g->pos++];
+		if (c == '\n')
+			g->linenum++;
+
+		switch (g->state) {
+		case GX_TEXT:
+			if (c == '<') {
+				g->state = GX_TAG;
+				g->taglen = 0;
+				g->quote = '\0';
+			} else {
+				gpx_add_text(g, c);
+			}
+			break;
+		case GX_TAG:
+			if (g->quote) {
+				if (c == g->quote)
+					g->quote = '\0';
+			} else if (c == '"' || c == '\'') {
+				g->quote = c;
+			} else if (c == '>') {
+				g->state = GX_TEXT;
+				st = gpx_end_tag(g);
+				break;
+			}
+			if (g->taglen < GPX_TAGSIZE - 1)
+				g->tag[g->taglen++] = c;
+			else
+				g->taglen = GPX_TAGSIZE;
+			if (g->taglen == 3 && !memcmp(g->tag, "!--", 3)) {
+				g->state = GX_COMMENT;
+				g->endcount = 0;
+			} else if (g->taglen == 8
+			           && !memcmp(g->tag, "![CDATA[", 8)) {
+				g->state = GX_CDATA;
+				g->endcount = 0;
+			}
+			break;
+		case GX_COMMENT:
+			if (c == '-') {
+				if (g->endcount < 2)
+					g->endcount++;
+			} else if (c == '>' && g->endcount == 2) {
+				g->state = GX_TEXT;
+			} else {
+				g->endcount = 0;
+			}
+			break;
+		case GX_CDATA:
+			if (c == ']') {
+				if (g->endcount < 2)
+					g->endcount++;
+				else if (g->textelem)
+					gpx_add_text(g, c);
+				break;
+			}
+			if (c == '>' && g->endcount == 2) {
+				g->state = GX_TEXT;
+				break;
+			}
+			for (; g->textelem && g->endcount; g->endcount--)
+				gpx_add_text(g, ']');
+			g->endcount = 0;
+			if (g->textelem)
+				gpx_add_text(g, c);
+			break;
+		}
+	}
+
+	if (st == PS_POINT) {
+		*lat = g->lat;
+		*lon = g->lon;
+		*ele = g->ele;
+		*time = g->time;
+	}
+
+	return (PointStatus)st;
+}
+
 /* vim: set ts=8 sw=8 sts=8 noet fo+=w tw=79 fenc=UTF-8 : */
@@ -28,6 +28,60 @@
                     " creator=\"" PROJ_NAME " - " PROJ_URL "\"" \
                     ">\n"
 
+#define GPX_BUFSIZE  65536
+#define GPX_TAGSIZE  1024
+#define GPX_TEXTSIZE  64
+
+typedef enum {
+	GX_TEXT = 0,
+	GX_TAG,
+	GX_COMMENT,
+	GX_CDATA
+} GpxState;
+
+typedef enum {
+	GE_OTHER = 0,
+	GE_WPT,
+	GE_RTEPT,
+	GE_TRKPT,
+	GE_ELE,
+	GE_TIME,
+	GE_SEGMENT
+} GpxElement;
+
+/*
+ * struct gpxreader - State for the streaming GPX parser in gpx.c. The file is 
+ * read in chunks of `chunksize` bytes into `buf`, and only the current tag 
+ * and the text of an <ele> or <time> element are stored, so the memory usage 
+ * doesn't depend on the size of the file.
+ */
+
+struct gpxreader {
+	FILE *fp;
+	const char *name;
+	char *buf;
+	size_t chunksize;
+	size_t pos;
+	size_t len;
+	unsigned long linenum;
+	GpxState state;
+	char quote;
+	int endcount;
+	char tag[GPX_TAGSIZE];
+	size_t taglen;
+	char text[GPX_TEXTSIZE];
+	size_t textlen;
+	GpxElement textelem;
+	GpxElement point;
+	GpxElement lastpoint;
+	unsigned long segpoints;
+	bool pending;
+	double lat;
+	double lon;
+	double ele;
+	double time;
+};
+
 #endif /* ifndef _GPX_H */
 
 /* vim: set ts=8 sw=8 sts=8 noet fo+=w tw=79 fenc=UTF-8 : */
@@ -90,6 +90,622 @@ char *read_from_fp(FILE *fp, struct binbuf *dest)
 	return buf.buf;
 }
 
+/*
+ * pointreader_open() - Prepares `dest` for reading positions from the file 
+ * `fname` in the format `format`. If `fname` is NULL or "-", stdin is used. 
+ * stdin is read through a new stream on a duplicate of the file descriptor, 
+ * so no data is left in the buffer of `stdin` when the program is executed 
+ * in-process by streams_call(). If `format` is IF_DEFAULT and the first 
+ * non-whitespace character is '<' or a UTF-8 byte order mark, the file is 
+ * read as GPX. Returns 0 if ok, or 1 if the file can't be opened.
+ */
+
+int pointreader_open(struct pointreader *dest, const char *fname,
+                     const InputFormat format)
+{
+	const char *mode = format == IF_BINARY ? "rb" : "r";
+
+	assert(dest);
+
+	dest->format = format;
+	dest->line = NULL;
+	dest->linesize = 0;
+	dest->recnum = 0;
+	dest->gpx.buf = NULL;
+	dest->ele = dest->time = NAN;
+	dest->weighted = false;
+	dest->weight = 1.0;
+	if (!fname || !strcmp(fname, "-")) {
+		const int fd = dup(STDIN_FILENO);
+
+		dest->name = "(stdin)";
+		dest->fp = fd == -1 ? NULL : fdopen(fd, mode);
+		if (!dest->fp) {
+			failed("fdopen()"); /* gncov */
+			if (fd != -1) /* gncov */
+				close(fd); /* gncov */
+			return 1; /* gncov */
+		}
+	} else {
+		dest->name = fname;
+		dest->fp = fopen(fname, mode);
+		if (!dest->fp) {
+			myerror("%s: Cannot open file for read", fname);
+			return 1;
+		}
+	}
+
+	if (format == IF_DEFAULT) {
+		int c;
+
+		while ((c = getc(dest->fp)) != EOF && isspace(c)) {
+			if (c == '\n')
+				dest->recnum++;
+		}
+		if (c == '<' || c == 0xef)
+			dest->format = IF_GPX;
+		if (c != EOF)
+			ungetc(c, dest->fp);
+	}
+	if (dest->format == IF_GPX
+	    && gpx_open(&dest->gpx, dest->fp, dest->name, dest->recnum + 1)) {
+		pointreader_close(dest); /* gncov */
+		return 1; /* gncov */
+	}
+
+	return 0;
+}
+
+/*
+ * pointreader_close() - Closes the file used by `pr` and deallocates the line 
+ * buffer and the GPX buffer. Returns nothing.
+ */
+
+void pointreader_close(struct pointreader *pr)
+{
+	assert(pr);
+
+	if (pr->fp)
+		fclose(pr->fp);
+	pr->fp = NULL;
+	gpx_close(&pr->gpx);
+	free(pr->line);
+	pr->line = NULL;
+	pr->linesize = 0;
+}
+
+/*
+ * read_text_line() - Reads the next line that isn't a comment from `pr` and 
+ * stores a pointer to the first non-whitespace character in `dest`. Returns 
+ * PS_POINT if a line was found, PS_BREAK if the line is empty or contains only 
+ * whitespace, PS_EOF at the end of the file, or PS_ERROR if a read error 
+ * occurred.
+ */
+
+static PointStatus read_text_line(struct pointreader *pr, char **dest)
+{
+	char *p;
+
+	do {
+		errno = 0;
+		if (getline(&pr->line, &pr->linesize, pr->fp) == -1) {
+			if (ferror(pr->fp)) {
+				myerror("%s: Read error", /* gncov */
+				        pr->name);
+				return PS_ERROR; /* gncov */
+			}
+			errno = 0;
+			return PS_EOF;
+		}
+		pr->recnum++;
+		p = pr->line;
+		while (isspace((unsigned char)*p))
+			p++;
+		if (!*p)
+			return PS_BREAK;
+	} while (*p == '#');
+	*dest = p;
+
+	return PS_POINT;
+}
+
+/*
+ * read_text_point() - Reads the next line with a coordinate from `pr`, in any 
+ * of the formats understood by scan_coordinate(). If `pr->weighted` is true, 
+ * the coordinate must be followed by the weight, `lat,lon,weight`, and the 
+ * weight, which can't be negative, is stored in `pr->weight`. Empty lines or 
+ * lines with only whitespace end the current segment, and lines starting with 
+ * '#' are ignored. The line is parsed in place without copying it, since this 
+ * is executed for every position. Returns the same values as 
+ * pointreader_next().
+ */
+
+static PointStatus read_text_point(struct pointreader *pr,
+                                   double *lat, double *lon)
+{
+	const char *end;
+	char *p;
+	PointStatus st;
+
+	st = read_text_line(pr, &p);
+	if (st != PS_POINT)
+		return st;
+
+	p[strcspn(p, "\r\n")] = '\0';
+	if (!scan_coordinate(p, lat, lon, &end)
+	    && fabs(*lat) <= 90.0 && fabs(*lon) <= 180.0) {
+		while (*end == ',' || isspace((unsigned char)*end))
+			end++;
+		if (!pr->weighted) {
+			if (!*end)
+				return PS_POINT;
+		} else if (!*end) {
+			errno = 0;
+			myerror("%s:%lu: Missing weight: %s", pr->name,
+			        pr->recnum, p);
+			return PS_ERROR;
+		} else {
+			if (!string_to_double(end, &pr->weight)
+			    && pr->weight >= 0.0 && isfinite(pr->weight))
+				return PS_POINT;
+			errno = 0;
+			myerror("%s:%lu: Invalid weight: %s", pr->name,
+			        pr->recnum, end);
+			return PS_ERROR;
+		}
+	}
+	errno = 0;
+	myerror("%s:%lu: Invalid coordinate: %s", pr->name, pr->recnum, p);
+
+	return PS_ERROR;
+}
+
+/*
+ * read_binary_point() - Reads the next position from `pr`, stored as 2 
+ * `double` values in native byte order, latitude first. If `pr->weighted` is 
+ * true, every record has a third value with the weight, which is stored in 
+ * `pr->weight`. A record where the latitude and longitude are NaN ends the 
+ * current segment. Returns the same values as 
+ * pointreader_next().
+ */
+
+static PointStatus read_binary_point(struct pointreader *pr,
+                                     double *lat, double *lon)
+{
+	double rec[3];
+	const size_t size = pr->weighted ? 3 : 2;
+	size_t n;
+
+	n = fread(rec, sizeof(double), size, pr->fp);
+	if (n != size) {
+		if (ferror(pr->fp)) {
+			myerror("%s: Read error", pr->name); /* gncov */
+			return PS_ERROR; /* gncov */
+		}
+		if (n) {
+			myerror("%s: Incomplete record after record %lu",
+			        pr->name, pr->recnum);
+			return PS_ERROR;
+		}
+		return PS_EOF;
+	}
+	pr->recnum++;
+	if (isnan(rec[0]) && isnan(rec[1]))
+		return PS_BREAK;
+	if (!(fabs(rec[0]) <= 90.0) || !(fabs(rec[1]) <= 180.0)) {
+		myerror("%s: Invalid coordinate in record %lu",
+		        pr->name, pr->recnum);
+		return PS_ERROR;
+	}
+	if (pr->weighted && !(rec[2] >= 0.0 && isfinite(rec[2]))) {
+		myerror("%s: Invalid weight in record %lu",
+		        pr->name, pr->recnum);
+		return PS_ERROR;
+	}
+	*lat = rec[0];
+	*lon = rec[1];
+	if (pr->weighted)
+		pr->weight = rec[2];
+
+	return PS_POINT;
+}
+
+/*
+ * pointreader_next() - Reads the next position from `pr` and stores it in 
+ * `lat` and `lon`. The elevation and time are stored in the `ele` and `time` 
+ * members of `pr`, or NaN if they're missing or not supported by the input 
+ * format. Only one position is kept in memory at a time, so files of any size 
+ * can be read. Returns:
+ *
+ * - PS_POINT: A valid position was read
+ * - PS_BREAK: The current segment ended
+ * - PS_EOF: No more data
+ * - PS_ERROR: Invalid data or a read error, an error message is printed
+ */
+
+PointStatus pointreader_next(struct pointreader *pr, double *lat, double *lon)
+{
+	assert(pr);
+	assert(pr->fp);
+	assert(lat);
+	assert(lon);
+
+	if (pr->format == IF_BINARY)
+		return read_binary_point(pr, lat, lon);
+	if (pr->format == IF_GPX)
+		return gpx_next(&pr->gpx, lat, lon, &pr->ele, &pr->time);
+
+	return read_text_point(pr, lat, lon);
+}
+
+/*
+ * read_text_xyz() - Reads the next line with 2 or 3 comma-separated values 
+ * from `pr` and stores them in `dest`. The third value is 0 if it's missing. 
+ * If `geodetic` is true, the line must start with a valid coordinate in any of 
+ * the formats understood by scan_coordinate(), optionally followed by the 
+ * height. Returns the same values as pointreader_next().
+ */
+
+static PointStatus read_text_xyz(struct pointreader *pr, double *dest,
+                                 const bool geodetic)
+{
+	const char *end;
+	char *p, *comma, *comma2 = NULL;
+	PointStatus st;
+
+	st = read_text_line(pr, &p);
+	if (st != PS_POINT)
+		return st;
+
+	p[strcspn(p, "\r\n")] = '\0';
+	dest[2] = 0.0;
+	if (geodetic) {
+		if (!scan_coordinate(p, &dest[0], &dest[1], &end)
+		    && fabs(dest[0]) <= 90.0 && fabs(dest[1]) <= 180.0
+		    && (!*end || (!string_to_double(end, &dest[2])
+		                  && isfinite(dest[2]))))
+			return PS_POINT;
+		goto invalid;
+	}
+	comma = strchr(p, ',');
+	if (comma)
+		comma2 = strchr(comma + 1, ',');
+	if (comma) {
+		*comma = '\0';
+		if (comma2)
+			*comma2 = '\0';
+		if (!string_to_double(p, &dest[0])
+		    && !string_to_double(comma + 1, &dest[1])
+		    && (!comma2 || !string_to_double(comma2 + 1, &dest[2]))
+		    && isfinite(dest[0]) && isfinite(dest[1])
+		    && isfinite(dest[2]))
+			return PS_POINT;
+		*comma = ',';
+		if (comma2)
+			*comma2 = ',';
+	}
+
+invalid:
+	errno = 0;
+	myerror("%s:%lu: Invalid coordinate: %s", pr->name, pr->recnum, p);
+
+	return PS_ERROR;
+}
+
+/*
+ * read_binary_xyz() - Reads the next record with 3 `double` values in native 
+ * byte order from `pr` and stores them in `dest`. A record where the first 2 
+ * values are NaN ends the current segment. If `geodetic` is true, the first 2 
+ * values must be a valid latitude and longitude. Returns the same values as 
+ * pointreader_next().
+ */
+
+static PointStatus read_binary_xyz(struct pointreader *pr, double *dest,
+                                   const bool geodetic)
+{
+	size_t n;
+
+	n = fread(dest, sizeof(double), 3, pr->fp);
+	if (n != 3) {
+		if (ferror(pr->fp)) {
+			myerror("%s: Read error", pr->name); /* gncov */
+			return PS_ERROR; /* gncov */
+		}
+		if (n) {
+			myerror("%s: Incomplete record after record %lu",
+			        pr->name, pr->recnum);
+			return PS_ERROR;
+		}
+		return PS_EOF;
+	}
+	pr->recnum++;
+	if (isnan(dest[0]) && isnan(dest[1]))
+		return PS_BREAK;
+	if (!isfinite(dest[0]) || !isfinite(dest[1]) || !isfinite(dest[2])
+	    || (geodetic && (!(fabs(dest[0]) <= 90.0)
+	                     || !(fabs(dest[1]) <= 180.0)))) {
+		myerror("%s: Invalid coordinate in record %lu",
+		        pr->name, pr->recnum);
+		return PS_ERROR;
+	}
+
+	return PS_POINT;
+}
+
+/*
+ * pointreader_next_xyz() - Reads the next record with 3 values from `pr` and 
+ * stores them in `dest`, which must have room for 3 values. This is used for 
+ * Cartesian coordinates, and for positions with a height. In the default 
+ * format, the values are separated by commas, and the third value is 0 if 
+ * it's missing. The binary format has 3 `double` values in every record, and 
+ * GPX files give the latitude, longitude and elevation, where a missing 
+ * elevation is 0. If `geodetic` is true, the first 2 values must be a valid 
+ * latitude and longitude. Returns the same values as pointreader_next().
+ */
+
+PointStatus pointreader_next_xyz(struct pointreader *pr, double *dest,
+                                 const bool geodetic)
+{
+	PointStatus st;
+
+	assert(pr);
+	assert(pr->fp);
+	assert(dest);
+
+	if (pr->format == IF_BINARY)
+		return read_binary_xyz(pr, dest, geodetic);
+	if (pr->format == IF_GPX) {
+		st = gpx_next(&pr->gpx, &dest[0], &dest[1], &pr->ele,
+		              &pr->time);
+		dest[2] = isnan(pr->ele) ? 0.0 : pr->ele;
+		return st;
+	}
+
+	return read_text_xyz(pr, dest, geodetic);
+}
+
+/*
+ * sortrec_cmp() - Used by qsort() and the merge heap in `struct possort`. 
+ * Sorts by the curve key, and by the original number if the keys are 
+ * identical, so the order is stable. Returns a negative value if `s1` comes 
+ * before `s2`, a positive value if it comes after, or 0 if they're equal.
+ */
+
+static int sortrec_cmp(const void *s1, const void *s2)
+{
+	const struct sortrec *a = s1, *b = s2;
+
+	if (a->key != b->key)
+		return a->key < b->key ? -1 : 1;
+
+	return (a->num > b->num) - (a->num < b->num);
+}
+
+/*
+ * possort_init() - Initializes `dest` to sort positions along the curve 
+ * specified by `order`. Up to `chunk` positions are kept in memory, more 
+ * positions than that are sorted in runs of `chunk` positions that are stored 
+ * in temporary files and merged by possort_next(). Returns 1 if the memory 
+ * allocation failed, otherwise 0.
+ */
+
+int possort_init(struct possort *dest, const SortOrder order,
+                 const size_t chunk)
+{
+	assert(dest);
+	assert(chunk);
+
+	memset(dest, 0, sizeof(*dest));
+	dest->order = order;
+	dest->chunk = chunk;
+	dest->buf = malloc(chunk * sizeof(struct sortrec));
+	if (!dest->buf) {
+		failed("malloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+
+	return 0;
+}
+
+/*
+ * possort_write_run() - Sorts the positions in the buffer of `ps` and writes 
+ * them to a new temporary file. Returns 1 if anything failed, otherwise 0.
+ */
+
+static int possort_write_run(struct possort *ps)
+{
+	FILE **runs, *fp;
+
+	qsort(ps->buf, ps->n, sizeof(struct sortrec), sortrec_cmp);
+	runs = realloc(ps->runs, (ps->numruns + 1) * sizeof(FILE *));
+	if (!runs) {
+		failed("realloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+	ps->runs = runs;
+	fp = tmpfile();
+	if (!fp) {
+		myerror("Cannot create temporary file"); /* gncov */
+		return 1; /* gncov */
+	}
+	ps->runs[ps->numruns++] = fp;
+	if (fwrite(ps->buf, sizeof(struct sortrec), ps->n, fp) != ps->n) {
+		myerror("Cannot write to temporary file"); /* gncov */
+		return 1; /* gncov */
+	}
+	ps->n = 0;
+
+	return 0;
+}
+
+/*
+ * possort_add() - Adds the position `lat, lon` with the number `num` to `ps`. 
+ * If the buffer is full, it's sorted and written to a temporary file first. 
+ * Returns 1 if anything failed, otherwise 0.
+ */
+
+int possort_add(struct possort *ps, const double lat, const double lon,
+                const unsigned long num)
+{
+	struct sortrec *rec;
+
+	assert(ps);
+	assert(ps->buf);
+
+	if (ps->n == ps->chunk && possort_write_run(ps))
+		return 1; /* gncov */
+	rec = &ps->buf[ps->n++];
+	rec->key = ps->order == SO_MORTON ? morton_key(lat, lon)
+	                                  : hilbert_key(lat, lon);
+	rec->lat = lat;
+	rec->lon = lon;
+	rec->num = num;
+
+	return 0;
+}
+
+/*
+ * possort_sift() - Moves the run at position `i` in the merge heap of `ps` 
+ * down until both children have larger records. Returns nothing.
+ */
+
+static void possort_sift(struct possort *ps, size_t i)
+{
+	while (1) {
+		const size_t l = 2 * i + 1, r = l + 1;
+		size_t min = i, t;
+
+		if (l < ps->heapsize
+		    && sortrec_cmp(&ps->heads[ps->heap[l]],
+		                   &ps->heads[ps->heap[min]]) < 0)
+			min = l;
+		if (r < ps->heapsize
+		    && sortrec_cmp(&ps->heads[ps->heap[r]],
+		                   &ps->heads[ps->heap[min]]) < 0)
+			min = r;
+		if (min == i)
+			return;
+		t = ps->heap[i];
+		ps->heap[i] = ps->heap[min];
+		ps->heap[min] = t;
+		i = min;
+	}
+}
+
+/*
+ * possort_finish() - Ends the input to `ps` and prepares it for 
+ * possort_next(). If all positions fit in memory, they're sorted in memory. 
+ * Otherwise, the last run is written to a temporary file, and the first 
+ * position of every run is placed in a heap for the merge. Returns 1 if 
+ * anything failed, otherwise 0.
+ */
+
+int possort_finish(struct possort *ps)
+{
+	size_t i;
+
+	assert(ps);
+	assert(ps->buf);
+
+	if (!ps->numruns) {
+		qsort(ps->buf, ps->n, sizeof(struct sortrec), sortrec_cmp);
+		ps->pos = 0;
+		return 0;
+	}
+	if (possort_write_run(ps))
+		return 1; /* gncov */
+	free(ps->buf);
+	ps->buf = NULL;
+
+	ps->heads = malloc(ps->numruns * sizeof(struct sortrec));
+	ps->heap = malloc(ps->numruns * sizeof(size_t));
+	if (!ps->heads || !ps->heap) {
+		failed("malloc()"); /* gncov */
+		return 1; /* gncov */
+	}
+	for (i = 0; i < ps->numruns; i++) {
+		rewind(ps->runs[i]);
+		if (fread(&ps->heads[i], sizeof(struct sortrec), 1,
+		          ps->runs[i]) != 1) {
+			myerror("Cannot read temporary file"); /* gncov */
+			return 1; /* gncov */
+		}
+		ps->heap[i] = i;
+	}
+	ps->heapsize = ps->numruns;
+	for (i = ps->heapsize / 2; i-- > 0;)
+		possort_sift(ps, i);
+
+	return 0;
+}
+
+/*
+ * possort_next() - Stores the next position from `ps` in sorted order in 
+ * `lat` and `lon`, and the number it was added with in `num`. possort_finish() 
+ * must be called first. Returns PS_POINT if a position was stored, PS_EOF if 
+ * there are no more positions, or PS_ERROR if a temporary file can't be read.
+ */
+
+PointStatus possort_next(struct possort *ps, double *lat, double *lon,
+                         unsigned long *num)
+{
+	const struct sortrec *rec;
+	size_t i;
+
+	assert(ps);
+	assert(lat);
+	assert(lon);
+	assert(num);
+
+	if (!ps->numruns) {
+		if (ps->pos == ps->n)
+			return PS_EOF;
+		rec = &ps->buf[ps->pos++];
+		*lat = rec->lat;
+		*lon = rec->lon;
+		*num = rec->num;
+		return PS_POINT;
+	}
+
+	if (!ps->heapsize)
+		return PS_EOF;
+	i = ps->heap[0];
+	*lat = ps->heads[i].lat;
+	*lon = ps->heads[i].lon;
+	*num = ps->heads[i].num;
+	if (fread(&ps->heads[i], sizeof(struct sortrec), 1,
+	          ps->runs[i]) != 1) {
+		if (ferror(ps->runs[i])) {
+			myerror("Cannot read temporary file"); /* gncov */
+			return PS_ERROR; /* gncov */
+		}
+		ps->heap[0] = ps->heap[--ps->heapsize];
+	}
+	possort_sift(ps, 0);
+
+	return PS_POINT;
+}
+
+/*
+ * possort_free() - Closes the temporary files and deallocates the memory used 
+ * by `ps`. Returns nothing.
+ */
+
+void possort_free(struct possort *ps)
+{
+	size_t i;
+
+	assert(ps);
+
+	for (i = 0; i < ps->numruns; i++)
+		fclose(ps->runs[i]);
+	free(ps->runs);
+	free(ps->heap);
+	free(ps->heads);
+	free(ps->buf);
+	memset(ps, 0, sizeof(*ps));
+}
+
 /*
  * prepare_valgrind_cmd() - Creates a command array for valgrind execution. 
  * Returns a new allocated array that starts with `valgrind_args` followed by 
@@ -298,6 +914,137 @@ cleanup:
 	return retval;
 }
 
+/*
+ * redirect_fd() - Saves a duplicate of file descriptor `fd` in `*saved` and 
+ * makes `fd` refer to the same file as `fp`. Returns 0 if ok, or 1 if dup() 
+ * or dup2() failed.
+ */
+
+static int redirect_fd(const int fd, FILE *fp, int *saved)
+{
+	assert(fp);
+	assert(saved);
+
+	*saved = dup(fd);
+	if (*saved == -1) {
+		failed("dup()"); /* gncov */
+		return 1; /* gncov */
+	}
+	if (dup2(fileno(fp), fd) == -1) {
+		failed("dup2()"); /* gncov */
+		return 1; /* gncov */
+	}
+
+	return 0;
+}
+
+/*
+ * restore_fd() - Restores file descriptor `fd` from the duplicate in `*saved` 
+ * created by redirect_fd() and closes the duplicate. Returns nothing.
+ */
+
+static void restore_fd(const int fd, int *saved)
+{
+	assert(saved);
+
+	if (*saved == -1)
+		return; /* gncov */
+	if (dup2(*saved, fd) == -1)
+		failed("dup2()"); /* gncov */
+	close(*saved);
+	*saved = -1;
+}
+
+/*
+ * streams_call() - Executes the program in-process with call_main() and 
+ * stores stdout, stderr and the return value into `dest`, just like 
+ * streams_exec() does with a separate process. stdin, stdout and stderr are 
+ * temporarily redirected to temporary files, and the contents of `dest->in` 
+ * is used as stdin. `cmd` is an array of arguments, and the last element must 
+ * be NULL. Returns the exit value from the program, or 1 if the redirection 
+ * failed.
+ */
+
+int streams_call(const struct Options *o, struct streams *dest, char *cmd[])
+{
+	int retval = 1, argc = 0;
+	int in_saved = -1, out_saved = -1, err_saved = -1;
+	FILE *infp = NULL, *outfp = NULL, *errfp = NULL;
+
+	assert(o);
+	assert(dest);
+	assert(cmd);
+	assert(cmd[0]);
+
+	if (o->verbose >= 10) {
+		int i = -1; /* gncov */
+
+		fprintf(stderr, "# %s(", __func__); /* gncov */
+		while (cmd[++i]) /* gncov */
+			fprintf(stderr, "%s\"%s\"", /* gncov */
+			                i ? ", " : "", cmd[i]); /* gncov */
+		fprintf(stderr, ")\n"); /* gncov */
+	}
+
+	while (cmd[argc])
+		argc++;
+
+	if (!(infp = tmpfile()) || !(outfp = tmpfile())
+	    || !(errfp = tmpfile())) {
+		failed("tmpfile()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	if (dest->in.buf && dest->in.len) {
+		if (fwrite(dest->in.buf, 1, dest->in.len, infp)
+		    != dest->in.len) {
+			failed("fwrite()"); /* gncov */
+			goto cleanup; /* gncov */
+		}
+		rewind(infp);
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	if (redirect_fd(STDIN_FILENO, infp, &in_saved)
+	    || redirect_fd(STDOUT_FILENO, outfp, &out_saved)
+	    || redirect_fd(STDERR_FILENO, errfp, &err_saved)) {
+		goto restore; /* gncov */
+	}
+	/* Discard any buffered data and make stdin read from the new file */
+	clearerr(stdin);
+	fseek(stdin, 0L, SEEK_SET);
+
+	retval = dest->ret = call_main(argc, cmd);
+
+	fflush(stdout);
+	fflush(stderr);
+
+restore:
+	restore_fd(STDERR_FILENO, &err_saved);
+	restore_fd(STDOUT_FILENO, &out_saved);
+	restore_fd(STDIN_FILENO, &in_saved);
+	clearerr(stdin);
+
+	rewind(outfp);
+	rewind(errfp);
+	read_from_fp(outfp, &dest->out);
+	read_from_fp(errfp, &dest->err);
+	msg(10, "%s():%d: dest->out.buf = \"%s\"",
+	        __func__, __LINE__, no_null(dest->out.buf));
+	msg(10, "%s():%d: dest->err.buf = \"%s\"",
+	        __func__, __LINE__, no_null(dest->err.buf));
+
+cleanup:
+	if (errfp)
+		fclose(errfp);
+	if (outfp)
+		fclose(outfp);
+	if (infp)
+		fclose(infp);
+
+	return retval;
+}
+
 /*
  * exec_output() - Executes the command stored in the NULL-terminated array 
  * `cmd` and stores stdout in `dest`. Returns the exit code from the program.
@@ -188,15 +188,37 @@
 	errno = 0; \
 } while (0)
 
+/*
+ * sc() and tc() run the command in-process with streams_call(), unless 
+ * Valgrind is used. scx() and tcx() always start the executable as a separate 
+ * process with streams_exec(), and are used for a smaller set of smoke tests 
+ * of the actual executable. sci() and tci() work like sc() and tc(), but send 
+ * a string to stdin of the command.
+ */
 #define sc(cmd, num_stdout, num_stderr, desc, ...)  \
-        sc_func(__LINE__, (cmd), (num_stdout), (num_stderr), \
+        sc_func(__LINE__, false, (cmd), (num_stdout), (num_stderr), \
+                (desc), ##__VA_ARGS__);
+#define scx(cmd, num_stdout, num_stderr, desc, ...)  \
+        sc_func(__LINE__, true, (cmd), (num_stdout), (num_stderr), \
                 (desc), ##__VA_ARGS__);
 #define tc(cmd, num_stdout, num_stderr, desc, ...)  \
-        tc_func(__LINE__, (cmd), (num_stdout), (num_stderr), \
+        tc_func(__LINE__, false, (cmd), (num_stdout), (num_stderr), \
+                (desc), ##__VA_ARGS__);
+#define tcx(cmd, num_stdout, num_stderr, desc, ...)  \
+        tc_func(__LINE__, true, (cmd), (num_stdout), (num_stderr), \
                 (desc), ##__VA_ARGS__);
 #define Tc(cmd, num_stdout, num_stderr, desc, ...) \
-        tc_func(linenum, (cmd), (num_stdout), (num_stderr), \
+        tc_func(linenum, false, (cmd), (num_stdout), (num_stderr), \
         (desc), ##__VA_ARGS__)
+#define Tcx(cmd, num_stdout, num_stderr, desc, ...) \
+        tc_func(linenum, true, (cmd), (num_stdout), (num_stderr), \
+        (desc), ##__VA_ARGS__)
+#define sci(cmd, input, num_stdout, num_stderr, desc, ...)  \
+        tci_func(__LINE__, 0, (cmd), (input), strlen(input), \
+                 (num_stdout), (num_stderr), (desc), ##__VA_ARGS__);
+#define tci(cmd, input, num_stdout, num_stderr, desc, ...)  \
+        tci_func(__LINE__, 1, (cmd), (input), strlen(input), \
+                 (num_stdout), (num_stderr), (desc), ##__VA_ARGS__);
 
 static char *execname;
 static int failcount = 0;
@@ -492,13 +514,37 @@ static int tc_cmp(const int identical, const char *got, const char *exp)
 	return !strstr(got, exp);
 }
 
+/*
+ * run_cmd() - Executes the command in `cmd` and stores stdout, stderr and the 
+ * return value in `dest`. If `exec` is true or Valgrind is used, the 
+ * executable is started as a separate process with streams_exec(). Otherwise, 
+ * the command is executed in-process with streams_call(), which is much 
+ * faster. Returns the exit value from the command.
+ */
+
+static int run_cmd(const struct Options *o, struct streams *dest, char *cmd[],
+                   const bool exec)
+{
+	assert(o);
+	assert(dest);
+	assert(cmd);
+
+	if (exec || o->valgrind)
+		return streams_exec(o, dest, cmd);
+
+	return streams_call(o, dest, cmd);
+}
+
 /*
  * test_command() - Runs the executable with arguments in `cmd` and verifies 
  * stdout, stderr and the return value against `exp_stdout`, `exp_stderr` and 
- * `exp_retval`. Returns nothing.
+ * `exp_retval`. If `exec` is false, the command is executed in-process, see 
+ * run_cmd(). Returns nothing.
  */
 
-static void test_command(const int linenum, const char identical, char *cmd[],
+static void test_command(const int linenum, const char identical,
+                         const bool exec, char *cmd[],
+                         const struct binbuf *input,
                          const char *exp_stdout, const char *exp_stderr,
                          const int exp_retval, const char *desc, va_list ap)
 {
@@ -531,7 +577,11 @@ static void test_command(const int linenum, const char identical, char *cmd[],
 		return; /* gncov */
 	}
 	streams_init(&ss);
-	streams_exec(&o, &ss, cmd);
+	if (input && input->len && !binbuf_cpy(&ss.in, input)) {
+		failed_ok("binbuf_cpy()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	run_cmd(&o, &ss, cmd, exec);
 	if (e_stdout) {
 		OK_FALSE_L(tc_cmp(identical, ss.out.buf, e_stdout), linenum,
 		         "%s (stdout)", descbuf);
@@ -546,12 +596,14 @@ static void test_command(const int linenum, const char identical, char *cmd[],
 	}
 	OK_EQUAL_L(ss.ret, exp_retval, linenum, "%s (retval)", descbuf);
 	print_gotexp_int(ss.ret, exp_retval);
-	free(descbuf);
-	free(e_stderr);
-	free(e_stdout);
 	print_gotexp_int(ss.ret, exp_retval);
 	if (valgrind_lines(ss.err.buf))
 		OK_ERROR_L(linenum, "Found valgrind output"); /* gncov */
+
+cleanup:
+	free(descbuf);
+	free(e_stderr);
+	free(e_stdout);
 	streams_free(&ss);
 }
 
@@ -563,9 +615,9 @@ static void test_command(const int linenum, const char identical, char *cmd[],
  * Returns nothing.
  */
 
-static void sc_func(const int linenum, char *cmd[], const char *exp_stdout,
-                    const char *exp_stderr, const int exp_retval,
-                    const char *desc, ...)
+static void sc_func(const int linenum, const bool exec, char *cmd[],
+                    const char *exp_stdout, const char *exp_stderr,
+                    const int exp_retval, const char *desc, ...)
 {
 	va_list ap;
 
@@ -575,8 +627,8 @@ static void sc_func(const int linenum, char *cmd[], const char *exp_stdout,
 	assert(*desc);
 
 	va_start(ap, desc);
-	test_command(linenum, 0, cmd, exp_stdout, exp_stderr, exp_retval,
-	             desc, ap);
+	test_command(linenum, 0, exec, cmd, NULL, exp_stdout, exp_stderr,
+	             exp_retval, desc, ap);
 	va_end(ap);
 }
 
@@ -588,20 +640,49 @@ static void sc_func(const int linenum, char *cmd[], const char *exp_stdout,
  * Returns nothing.
  */
 
-static void tc_func(const int linenum, char *cmd[], const char *exp_stdout,
-                    const char *exp_stderr, const int exp_retval,
-                    const char *desc, ...)
+static void tc_func(const int linenum, const bool exec, char *cmd[],
+                    const char *exp_stdout, const char *exp_stderr,
+                    const int exp_retval, const char *desc, ...)
+{
+	va_list ap;
+
+	assert(cmd);
+	assert(*cmd);
+	assert(desc);
+	assert(*desc);
+
+	va_start(ap, desc);
+	test_command(linenum, 1, exec, cmd, NULL, exp_stdout, exp_stderr,
+	             exp_retval, desc, ap);
+	va_end(ap);
+}
+
+/*
+ * tci_func() - Same as sc_func() or tc_func(), depending on `identical`, but 
+ * the `len` bytes in `input` are sent to stdin of the command. Not meant to be 
+ * called directly, but via the sci() or tci() macros that log the line number 
+ * automatically, unless the input contains null bytes. Returns nothing.
+ */
+
+static void tci_func(const int linenum, const char identical, char *cmd[],
+                     char *input, const size_t len,
+                     const char *exp_stdout, const char *exp_stderr,
+                     const int exp_retval, const char *desc, ...)
 {
 	va_list ap;
+	struct binbuf in;
 
 	assert(cmd);
 	assert(*cmd);
+	assert(input);
 	assert(desc);
 	assert(*desc);
 
+	in.buf = input;
+	in.len = in.alloc = len;
 	va_start(ap, desc);
-	test_command(linenum, 1, cmd, exp_stdout, exp_stderr, exp_retval,
-	             desc, ap);
+	test_command(linenum, identical, false, cmd, &in, exp_stdout,
+	             exp_stderr, exp_retval, desc, ap);
 	va_end(ap);
 }
 
@@ -1069,6 +1150,9 @@ static void test_bearing_position(void)
                  (exp_lon))
 
 	/* "lat,lon", bear, dist, exp_ret, exp_lat, exp_lon */
+	/* Rounding error made the asin() argument larger than 1 */
+	chk_bpos("-51.446656838068279,-108.87792605729629", 0,
+	         15728150.631227074, 0, 90, -108.877926);
 	chk_bpos("-90.000001,15", 0, 10, 1, 0, 0);
 	chk_bpos("0,0", 0, 2.5 * MAX_EARTH_DISTANCE, 0, 90, 0);
 	chk_bpos("0,0", 123.4567, -2.0 * MAX_EARTH_DISTANCE, 0, 0, 0);
@@ -1123,6 +1207,49 @@ static void test_bearing_position(void)
 #undef chk_bpos
 }
 
+/*
+ * test_origin_positions() - Tests origin_positions() against 
+ * bearing_position(). Returns nothing.
+ */
+
+static void test_origin_positions(void)
+{
+	struct origin org;
+	const double centers[][2] = {
+		{ 60.0, 10.0 }, { -33.9, 151.2 }, { 90.0, 0.0 }, { 0.0, 180.0 },
+	};
+	const double dist = 123456.0;
+	double sin_b[8], cos_b[8], lat[8], lon[8];
+	size_t c, i;
+
+	diag("Test origin_positions()");
+
+	for (i = 0; i < 8; i++) {
+		const double bear = 45.0 * (double)i;
+
+		sin_b[i] = sin(bear * M_PI / 180.0);
+		cos_b[i] = cos(bear * M_PI / 180.0);
+	}
+	for (c = 0; c < 4; c++) {
+		int equal = 0;
+
+		origin_init(&org, centers[c][0], centers[c][1]);
+		origin_positions(&org, sin_b, cos_b, 8, dist / EARTH_RADIUS,
+		                 lat, lon);
+		for (i = 0; i < 8; i++) {
+			double exp_lat, exp_lon;
+
+			bearing_position(centers[c][0], centers[c][1],
+			                 45.0 * (double)i, dist, &exp_lat,
+			                 &exp_lon);
+			equal += fabs(lat[i] - exp_lat) < 1e-9
+			         && fabs(lon[i] - exp_lon) < 1e-9;
+		}
+		OK_EQUAL(equal, 8, "origin_positions() from %f,%f matches"
+		         " bearing_position()", centers[c][0], centers[c][1]);
+	}
+}
+
 /*
  * chk_karney() - Used by test_karney_distance(). Verifies that 
  * `karney_distance(coor1, coor2)` returns the value in `exp_result`. Returns 
@@ -1391,1015 +1518,4673 @@ static void test_karney_bearing(void)
 }
 
 /*
- * chk_rand_pos() - Used by test_rand_pos(). Executes rand_pos() with the 
- * values in `coor`, `maxdist` and `mindist` and checks that they're in the 
- * range defined by `exp_maxdist` and `exp_mindist`. Returns nothing.
+ * test_approx() - Tests the approximate distance formulas, approx_error() and 
+ * threshold_distance(). The property tests verify the error bounds. Returns 
+ * nothing.
  */
 
-static void chk_rand_pos(const int linenum, const char *coor,
-                         const double maxdist, const double mindist,
-                         const double exp_maxdist, const double exp_mindist)
+static void test_approx(void)
 {
-	int errcount = 0, maxtests = 20;
-	unsigned long l, numloop = 1e+4;
-	double r_exp_max = round(exp_maxdist), r_exp_min = round(exp_mindist);
+	DistFormula exact = FRM_RHUMB;
+
+	diag("Test the approximate distance formulas");
+
+	OK_EQUAL(equirect_distance(0.0, 0.0, 0.0, 1.0), 111194.92664455874,
+	         "equirect_distance() along the Equator");
+	OK_EQUAL(cheapruler_distance(&WGS84, 0.0, 0.0, 0.0, 1.0),
+	         111319.49079327357, "cheapruler_distance() along the Equator");
+	OK_TRUE(fabs(haversine32(0.0, 0.0, 0.0, 1.0) - 111194.92578320205)
+	        < 1e-6, "haversine32() along the Equator");
+	OK_EQUAL(equirect_distance(0.0, 179.5, 0.0, -179.5),
+	         equirect_distance(0.0, 0.0, 0.0, 1.0),
+	         "equirect_distance() across the antimeridian");
+	OK_EQUAL(cheapruler_distance(&WGS84, 0.0, -179.5, 0.0, 179.5),
+	         cheapruler_distance(&WGS84, 0.0, 0.0, 0.0, 1.0),
+	         "cheapruler_distance() across the antimeridian");
+	OK_EQUAL(haversine32(0.0, 179.5, 0.0, -179.5),
+	         haversine32(0.0, 0.0, 0.0, 1.0),
+	         "haversine32() across the antimeridian");
+	OK_EQUAL(equirect_distance(60.0, 10.0, 60.0, 10.0), 0.0,
+	         "equirect_distance(): Identical positions");
+	OK_EQUAL(haversine32(60.0, 10.0, 60.0, 10.0), 0.0,
+	         "haversine32(): Identical positions");
+	OK_EQUAL(equirect_distance(91.0, 0.0, 0.0, 0.0), -1.0,
+	         "equirect_distance(): Latitude is out of range");
+	OK_EQUAL(cheapruler_distance(&WGS84, 0.0, 0.0, 0.0, 181.0), -1.0,
+	         "cheapruler_distance(): Longitude is out of range");
+	OK_EQUAL(haversine32(0.0, -181.0, 0.0, 0.0), -1.0,
+	         "haversine32(): Longitude is out of range");
+	OK_EQUAL(distance(FRM_EQUIRECT, &WGS84, 60.0, 10.0, 60.5, 10.5),
+	         equirect_distance(60.0, 10.0, 60.5, 10.5),
+	         "distance(FRM_EQUIRECT)");
+	OK_EQUAL(distance(FRM_CHEAPRULER, &WGS84, 60.0, 10.0, 60.5, 10.5),
+	         cheapruler_distance(&WGS84, 60.0, 10.0, 60.5, 10.5),
+	         "distance(FRM_CHEAPRULER)");
+	OK_EQUAL(distance(FRM_HAVERSINE32, &WGS84, 60.0, 10.0, 60.5, 10.5),
+	         haversine32(60.0, 10.0, 60.5, 10.5),
+	         "distance(FRM_HAVERSINE32)");
+
+	OK_EQUAL(approx_error(FRM_CHEAPRULER, &exact), CHEAPRULER_MAX_ERROR,
+	         "approx_error(FRM_CHEAPRULER)");
+	OK_TRUE(exact == FRM_KARNEY, "FRM_CHEAPRULER is checked with Karney");
+	OK_EQUAL(approx_error(FRM_EQUIRECT, &exact), EQUIRECT_MAX_ERROR,
+	         "approx_error(FRM_EQUIRECT)");
+	OK_TRUE(exact == FRM_HAVERSINE,
+	        "FRM_EQUIRECT is checked with Haversine");
+	OK_EQUAL(approx_error(FRM_HAVERSINE32, NULL), HAVERSINE32_MAX_ERROR,
+	         "approx_error(FRM_HAVERSINE32) with exact = NULL");
+	OK_EQUAL(approx_error(FRM_RHUMB, &exact), 0.0,
+	         "approx_error(FRM_RHUMB) is 0");
+	OK_TRUE(exact == FRM_RHUMB, "FRM_RHUMB is its own exact formula");
+
+	OK_EQUAL(threshold_distance(FRM_HAVERSINE, &WGS84, 60.0, 10.0, 60.5,
+	                            10.5, 62065.0),
+	         haversine(60.0, 10.0, 60.5, 10.5),
+	         "threshold_distance() with an exact formula");
+	OK_EQUAL(threshold_distance(FRM_EQUIRECT, &WGS84, 60.0, 10.0, 60.5,
+	                            10.5, APPROX_MAX_DIST),
+	         equirect_distance(60.0, 10.0, 60.5, 10.5),
+	         "threshold_distance(): Far from the threshold");
+	OK_EQUAL(threshold_distance(FRM_EQUIRECT, &WGS84, 60.0, 10.0, 60.5,
+	                            10.5, 62066.0),
+	         haversine(60.0, 10.0, 60.5, 10.5),
+	         "threshold_distance(): Near the threshold");
+	OK_EQUAL(threshold_distance(FRM_CHEAPRULER, &WGS84, 60.0, 10.0, 60.5,
+	                            10.5, 62210.0),
+	         karney_distance(60.0, 10.0, 60.5, 10.5),
+	         "threshold_distance(): Near the threshold, cheapruler");
+	OK_EQUAL(threshold_distance(FRM_EQUIRECT, &WGS84, 85.0, 10.0, 85.5,
+	                            10.5, APPROX_MAX_DIST),
+	         haversine(85.0, 10.0, 85.5, 10.5),
+	         "threshold_distance(): Latitude is beyond APPROX_MAX_LAT");
+	OK_EQUAL(threshold_distance(FRM_HAVERSINE32, &WGS84, 60.0, 10.0, 60.0,
+	                            10.0, 0.0),
+	         0.0, "threshold_distance(): Identical positions, maxdist is 0");
+}
 
-	for (l = 0; l < numloop; l++) {
-		double clat = 1000.0, clon = 1000.0, rlat, rlon, dist, r_dist;
-		if (coor && parse_coordinate(coor, true, &clat, &clon)) {
-			failed_ok("parse_coordinate()"); /* gncov */
-			diag("test %d: coor = \"%s\"", /* gncov */
-			     testnum, coor);
-			return; /* gncov */
-		}
-		rand_pos(&rlat, &rlon, clat, clon, maxdist, mindist);
-		if (fabs(rlat) > 90.0) {
-			OK_ERROR_L(linenum, /* gncov */
-			           "rand_pos(): Coordinate %lu:"
-			           " lat is outside [-90,90] range,"
-			           " lat = %.15f", l, rlat);
-			errcount++; /* gncov */
-		}
-		if (fabs(rlon) > 180.0) {
-			OK_ERROR_L(linenum, /* gncov */
-			           "rand_pos(): Coordinate %lu:"
-			           " lon is outside [-180,180] range,"
-			           " lon = %.15f", l, rlon);
-			errcount++; /* gncov */
-		}
-		if (errcount >= maxtests) {
-			diag("Aborting rand_pos() range test after" /* gncov */
-			     " %d errors", maxtests);
-			break; /* gncov */
-		}
-		if (!coor)
-			continue;
-		dist = haversine(clat, clon, rlat, rlon);
-		r_dist = round(dist);
-		if (r_dist < r_exp_min || r_dist > r_exp_max) {
-			errcount <= maxtests
-			? OK_ERROR_L(linenum, /* gncov */
-			             "randpos out of range (%.0f"
-			             " to %.0f m), center = %f,%f randpos ="
-			             " %f,%f dist = %f",
-			             exp_mindist, exp_maxdist, clat, clon,
-			             rlat, rlon, dist)
-			: 1; /* gncov */
-			errcount++; /* gncov */
-		}
-	}
-	OK_EQUAL_L(errcount, 0, linenum,
-	           "rand_pos(): All %lu coordinates %.0f-%.0f m are"
-	           " in range, failed = %lu (%f%%)",
-	           numloop, exp_mindist, exp_maxdist, errcount,
-	           100.0 * (double)errcount / (double)numloop);
+/*
+ * test_ellipsoid() - Tests the ellipsoid models and geod_distance() and 
+ * geod_bearing() with other models than WGS84. Returns nothing.
+ */
+
+static void test_ellipsoid(void)
+{
+	const double sq_lat[] = { 0.0, 0.0, 1.0, 1.0 };
+	const double sq_lon[] = { 0.0, 1.0, 1.0, 0.0 };
+	struct ellipsoid ell;
+	struct polyarea pa;
+	struct vec3 v;
+	double area, perim, area2, perim2, lat, lon, h;
+	int i;
+
+	diag("Test ellipsoid models");
+
+	OK_TRUE(fabs(WGS84.b - 6356752.314245) < 1e-6
+	        && fabs(WGS84.e2 - 0.00669437999014) < 1e-14
+	        && fabs(WGS84.ep2 - 0.00673949674228) < 1e-14,
+	        "WGS84 has the correct derived constants");
+	OK_SUCCESS(ellipsoid_by_name(&ell, "wgs84"), "ellipsoid_by_name(wgs84)");
+	OK_SUCCESS(memcmp(&ell, &WGS84, sizeof(ell)),
+	           "wgs84 is identical to WGS84");
+	OK_SUCCESS(ellipsoid_by_name(&ell, "grs80"), "ellipsoid_by_name(grs80)");
+	OK_TRUE(ell.a == 6378137.0 && fabs(ell.b - 6356752.314140) < 1e-6,
+	        "grs80 has the correct semi-minor axis");
+	OK_SUCCESS(ellipsoid_by_name(&ell, "clarke1866"),
+	           "ellipsoid_by_name(clarke1866)");
+	OK_TRUE(ell.a == 6378206.4 && fabs(ell.b - 6356583.8) < 0.001,
+	        "clarke1866 has the correct semi-minor axis");
+	OK_SUCCESS(ellipsoid_by_name(&ell, "authalic"),
+	           "ellipsoid_by_name(authalic)");
+	OK_TRUE(ell.f == 0.0 && ell.b == ell.a && ell.e2 == 0.0
+	        && ell.ep2 == 0.0, "authalic is a sphere");
+	OK_FAILURE(ellipsoid_by_name(&ell, "WGS84"),
+	           "ellipsoid_by_name() is case sensitive");
+	OK_FAILURE(ellipsoid_by_name(&ell, ""), "ellipsoid_by_name(\"\")");
+
+	OK_FAILURE(ellipsoid_init(&ell, 0.0, 0.0), "ellipsoid_init(): a is 0");
+	OK_FAILURE(ellipsoid_init(&ell, -1.0, 0.0),
+	           "ellipsoid_init(): a is negative");
+	OK_FAILURE(ellipsoid_init(&ell, INFINITY, 0.0),
+	           "ellipsoid_init(): a is infinite");
+	OK_FAILURE(ellipsoid_init(&ell, NAN, 0.0), "ellipsoid_init(): a is NaN");
+	OK_FAILURE(ellipsoid_init(&ell, 1.0, -0.1),
+	           "ellipsoid_init(): f is negative");
+	OK_FAILURE(ellipsoid_init(&ell, 1.0, 1.0), "ellipsoid_init(): f is 1");
+	OK_FAILURE(ellipsoid_init(&ell, 1.0, NAN), "ellipsoid_init(): f is NaN");
+	OK_SUCCESS(ellipsoid_init(&ell, 6378137.0, 1.0 / 298.257223563),
+	           "ellipsoid_init() with the WGS84 values");
+	OK_TRUE(ell.b == WGS84.b && ell.e2 == WGS84.e2 && ell.ep2 == WGS84.ep2,
+	        "ellipsoid_init() matches the built-in WGS84");
+
+	OK_SUCCESS(ellipsoid_by_name(&ell, "clarke1866"), "Use clarke1866");
+	OK_TRUE(fabs(geod_distance(&ell, 60.0, 10.0, -33.9, 18.4)
+	             - 10434870.33080674) < 1e-6,
+	        "geod_distance() with clarke1866");
+	OK_TRUE(fabs(geod_bearing(&ell, 60.0, 10.0, -33.9, 18.4)
+	             - 172.99520042) < 1e-8,
+	        "geod_bearing() with clarke1866");
+	OK_EQUAL(geod_distance(&ell, 91.0, 0.0, 0.0, 0.0), -1.0,
+	         "geod_distance(): Latitude is out of range");
+	OK_TRUE(fabs(gaussian_radius(&ell, 0.0) - ell.b) < 1e-9,
+	        "gaussian_radius() with clarke1866 at the equator");
+
+	ellipsoid_init(&ell, EARTH_RADIUS, 0.0);
+	OK_TRUE(fabs(geod_distance(&ell, 60.0, 10.0, -33.9, 18.4)
+	             - haversine(60.0, 10.0, -33.9, 18.4)) < 1e-6,
+	        "geod_distance() on a sphere is the Haversine distance");
+	OK_TRUE(fabs(geod_bearing(&ell, 60.0, 10.0, -33.9, 18.4)
+	             - initial_bearing(60.0, 10.0, -33.9, 18.4)) < 1e-9,
+	        "geod_bearing() on a sphere is the spherical bearing");
+	OK_EQUAL(gaussian_radius(&ell, 45.0), EARTH_RADIUS,
+	         "gaussian_radius() on a sphere is the radius");
+
+	v.x = v.y = v.z = 0.0;
+	ecef_to_geodetic(&ell, &v, &lat, &lon, &h);
+	OK_TRUE(lat == 0.0 && lon == 0.0 && h == -EARTH_RADIUS,
+	        "ecef_to_geodetic(): The center of a sphere");
+	geodetic_to_ecef(&ell, 45.0, 45.0, 100.0, &v);
+	ecef_to_geodetic(&ell, &v, &lat, &lon, &h);
+	OK_TRUE(fabs(lat - 45.0) < 1e-12 && fabs(lon - 45.0) < 1e-12
+	        && fabs(h - 100.0) < 1e-7,
+	        "ecef_to_geodetic() on a sphere returns the original position");
+
+	polyarea_init(&pa, FRM_KARNEY, &ell);
+	for (i = 0; i < 4; i++)
+		polyarea_add(&pa, sq_lat[i], sq_lon[i]);
+	polyarea_close(&pa);
+	OK_SUCCESS(polyarea_result(&pa, &area, &perim),
+	           "polyarea: FRM_KARNEY on a sphere");
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	for (i = 0; i < 4; i++)
+		polyarea_add(&pa, sq_lat[i], sq_lon[i]);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area2, &perim2);
+	OK_TRUE(fabs(area / area2 - 1.0) < 1e-12
+	        && fabs(perim - perim2) < 1e-6,
+	        "polyarea: FRM_KARNEY on a sphere is the Haversine area");
 }
 
 /*
- * test_rand_pos() - Tests the rand_pos() function. Returns nothing.
+ * test_distance_batch() - Tests the special cases in distance_batch() and 
+ * bearing_batch(). The property tests verify that the results are identical to 
+ * distance() and bearing(). Returns nothing.
  */
 
-static void test_rand_pos(void)
+static void test_distance_batch(void)
 {
-	double MED = MAX_EARTH_DISTANCE;
+	const double lat[] = { 12.0, -12.0, 91.0, 0.0, 0.0 };
+	const double lon[] = { 34.0, -146.0, 0.0, 0.0, 0.0 };
+	double dest[] = { 7.0, 7.0, 7.0, 7.0 };
+
+	diag("Test distance_batch() and bearing_batch()");
+
+	distance_batch(FRM_HAVERSINE, &WGS84, lat, lon, 1, dest);
+	OK_EQUAL(dest[0], 7.0, "distance_batch(): 1 position, no results");
+	bearing_batch(FRM_HAVERSINE, &WGS84, lat, lon, 0, NULL);
+	OK_EQUAL(dest[0], 7.0, "bearing_batch(): No positions");
+
+	distance_batch(FRM_HAVERSINE, &WGS84, lat, lon, 5, dest);
+	OK_EQUAL(dest[0], MAX_EARTH_DISTANCE,
+	         "distance_batch(): Antipodal positions");
+	OK_EQUAL(dest[1], -1.0, "distance_batch(): Latitude is out of range");
+	OK_EQUAL(dest[2], -1.0, "distance_batch(): Previous latitude is out"
+	                        " of range");
+	OK_EQUAL(dest[3], 0.0, "distance_batch(): Coincident positions");
+
+	bearing_batch(FRM_HAVERSINE, &WGS84, lat, lon, 5, dest);
+	OK_EQUAL(dest[0], -2.0, "bearing_batch(): Antipodal positions");
+	OK_EQUAL(dest[1], -1.0, "bearing_batch(): Latitude is out of range");
+	OK_EQUAL(dest[3], -2.0, "bearing_batch(): Coincident positions");
+}
 
-	diag("Test rand_pos()");
+/*
+ * chk_rhumb() - Tests that the rhumb line from `c1` to `c2` has the length 
+ * `exp_dist` meters and the bearing `exp_bear`, both with 6 decimals, and 
+ * that distance(), bearing() and the batch functions return the same values. 
+ * Returns nothing.
+ */
 
-#define chk_rand_pos(coor, maxdist, mindist, exp_maxdist, exp_mindist)  \
-        chk_rand_pos(__LINE__, (coor), (maxdist), (mindist), (exp_maxdist), \
-                     (exp_mindist))
+static void chk_rhumb(const int linenum, const char *c1, const char *c2,
+                      const char *exp_dist, const char *exp_bear)
+{
+	double lat[2], lon[2], dist, bear, bdist, bbear;
+	char *got_dist, *got_bear;
 
-	chk_rand_pos("-3.14,-123.45", 1e+20, 1e+20, MED, MED);
-	chk_rand_pos("-3.14,-123.45", 1e+20, 1e+7, MED, 1e+7);
-	chk_rand_pos("-3.14,-123.45", 1e+7 + 1, 1e+20, MED, 1e+7 + 1);
-	chk_rand_pos("-55.91,-107.32", 0, 2e+7, MED, 2e+7);
-	chk_rand_pos("-59.2105,44.47485", 1000.0, 1000.0, 1000.0, 1000.0);
-	chk_rand_pos("-90,0", 10.0, 0.0, 10.0, 0.0);
-	chk_rand_pos("12,34", 0.1, 0.0, 0.0, 0.0);
-	chk_rand_pos("12,34", 1.0, 0.0, 1.0, 0.0);
-	chk_rand_pos("12,34", 10.0, 20.0, 20.0, 10.0);
-	chk_rand_pos("65,7", 2000.0, 1000.0, 2000.0, 1000.0);
-	chk_rand_pos("90,0", 0.0, 1e+6, MED, 1e+6);
-	chk_rand_pos(NULL, 0.0, 0.0, MED, 0.0);
+	if (parse_coordinate(c1, true, &lat[0], &lon[0])
+	    || parse_coordinate(c2, true, &lat[1], &lon[1])) {
+		failed_ok("parse_coordinate()"); /* gncov */
+		return; /* gncov */
+	}
+	dist = rhumb_distance(lat[0], lon[0], lat[1], lon[1]);
+	bear = rhumb_bearing(lat[0], lon[0], lat[1], lon[1]);
+	got_dist = allocstr("%.6f", dist);
+	got_bear = allocstr("%.6f", bear);
+	if (!got_dist || !got_bear) {
+		failed_ok("allocstr()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	OK_STRCMP_L(got_dist, exp_dist, linenum, "rhumb_distance(): %s to %s",
+	            c1, c2);
+	print_gotexp(got_dist, exp_dist);
+	OK_STRCMP_L(got_bear, exp_bear, linenum, "rhumb_bearing(): %s to %s",
+	            c1, c2);
+	print_gotexp(got_bear, exp_bear);
+	distance_batch(FRM_RHUMB, &WGS84, lat, lon, 2, &bdist);
+	bearing_batch(FRM_RHUMB, &WGS84, lat, lon, 2, &bbear);
+	OK_TRUE_L(distance(FRM_RHUMB, &WGS84, lat[0], lon[0],
+	                   lat[1], lon[1]) == dist
+	          && bearing(FRM_RHUMB, &WGS84, lat[0], lon[0],
+	                     lat[1], lon[1]) == bear
+	          && bdist == dist && bbear == bear, linenum,
+	          "rhumb: distance(), bearing() and batch, %s to %s", c1, c2);
 
-#undef chk_rand_pos
+cleanup:
+	free(got_bear);
+	free(got_dist);
 }
 
-                                /*** gpx.c ***/
+/*
+ * test_rhumb() - Tests the rhumb_*() functions and FRM_RHUMB in the batch 
+ * functions. Returns nothing.
+ */
+
+static void test_rhumb(void)
+{
+	const double lat[] = { 12.0, 91.0, 0.0, 0.0, 90.0, 90.0 };
+	const double lon[] = { 34.0, 0.0, 0.0, 0.0, 10.0, 20.0 };
+	double dest[5], nlat, nlon;
+
+	diag("Test rhumb line functions");
+
+#define chk_rhumb(c1, c2, d, b)  chk_rhumb(__LINE__, (c1), (c2), (d), (b))
+
+	chk_rhumb("50,-5", "58,3", "1030814.555590", "30.348581");
+	chk_rhumb("0,0", "0,90", "10007543.398010", "90.000000");
+	chk_rhumb("0,179", "0,-179", "222389.853289", "90.000000");
+	chk_rhumb("60,-179", "60,179", "111194.926645", "270.000000");
+	chk_rhumb("0,0", "90,45", "10007543.398010", "0.000000");
+	chk_rhumb("-90,12", "10,-170", "11119492.664456", "0.000000");
+	chk_rhumb("51.127,1.338", "50.964,1.853", "40307.745198",
+	          "116.721860");
+
+#undef chk_rhumb
+
+	OK_EQUAL(rhumb_distance(91.0, 0.0, 0.0, 0.0), -1.0,
+	         "rhumb_distance(): Latitude is out of range");
+	OK_EQUAL(rhumb_bearing(0.0, 0.0, 0.0, 181.0), -1.0,
+	         "rhumb_bearing(): Longitude is out of range");
+	OK_EQUAL(rhumb_bearing(1.0, 2.0, 1.0, 2.0), -2.0,
+	         "rhumb_bearing(): Coincident positions");
+	OK_EQUAL(rhumb_bearing(90.0, 2.0, 90.0, 3.0), -2.0,
+	         "rhumb_bearing(): Both positions at the North Pole");
+
+	OK_SUCCESS(rhumb_position(50.0, -5.0, 30.348581, 1030814.55559, &nlat,
+	                          &nlon), "rhumb_position() succeeds");
+	OK_TRUE(fabs(nlat - 58.0) < 1e-6 && fabs(nlon - 3.0) < 1e-6,
+	        "rhumb_position(): Back to the end of the rhumb line");
+	OK_SUCCESS(rhumb_position(50.0, -5.0, 30.348581, -1030814.55559,
+	                          &nlat, &nlon),
+	           "rhumb_position() with negative distance");
+	OK_TRUE(fabs(nlat - 42.0) < 1e-6,
+	        "rhumb_position(): Negative distance moves backwards");
+	OK_SUCCESS(rhumb_position(89.0, 0.0, 45.0, 1e6, &nlat, &nlon),
+	           "rhumb_position() past the North Pole");
+	OK_TRUE(nlat == 90.0 && nlon == 0.0,
+	        "rhumb_position(): Stops at the North Pole");
+	OK_FAILURE(rhumb_position(0.0, 0.0, 361.0, 1.0, &nlat, &nlon),
+	           "rhumb_position(): Bearing is out of range");
+	OK_SUCCESS(rhumb_point(50.0, -5.0, 58.0, 3.0, 0.5, &nlat, &nlon),
+	           "rhumb_point() succeeds");
+	OK_TRUE(fabs(nlat - 54.0) < 1e-12 && fabs(nlon + 1.192712) < 1e-6,
+	        "rhumb_point(): The middle of the rhumb line");
+	OK_FAILURE(rhumb_point(0.0, 0.0, -91.0, 0.0, 0.5, &nlat, &nlon),
+	           "rhumb_point(): Latitude is out of range");
+	OK_SUCCESS(rhumb_point(1.0, 2.0, 1.0, 2.0, 0.5, &nlat, &nlon),
+	           "rhumb_point() with coincident positions");
+	OK_TRUE(nlat == 1.0 && nlon == 2.0,
+	        "rhumb_point(): Coincident positions return the start");
+
+	distance_batch(FRM_RHUMB, &WGS84, lat, lon, 6, dest);
+	OK_EQUAL(dest[0], -1.0, "distance_batch(FRM_RHUMB): Latitude is out"
+	                        " of range");
+	OK_EQUAL(dest[2], 0.0, "distance_batch(FRM_RHUMB): Coincident"
+	                       " positions");
+	bearing_batch(FRM_RHUMB, &WGS84, lat, lon, 6, dest);
+	OK_EQUAL(dest[1], -1.0, "bearing_batch(FRM_RHUMB): Previous latitude"
+	                        " is out of range");
+	OK_EQUAL(dest[2], -2.0, "bearing_batch(FRM_RHUMB): Coincident"
+	                        " positions");
+	OK_EQUAL(dest[3], 0.0, "bearing_batch(FRM_RHUMB): North to the pole");
+	OK_EQUAL(dest[4], -2.0, "bearing_batch(FRM_RHUMB): Both positions at"
+	                        " the North Pole");
+}
 
 /*
- * chk_xmlesc() - Used by test_xml_escape_string(). Verifies that 
- * xml_escape_string() converts the string `s` to `exp`. Returns nothing.
+ * test_compsum() - Tests the compsum_*() functions. Returns nothing.
  */
 
-static void chk_xmlesc(const int linenum, const char *s, const char *exp)
+static void test_compsum(void)
 {
-	char *got;
+	struct compsum cs;
+	double naive = 0.0;
+	int i;
 
-	assert(s);
-	assert(exp);
-	if (!s || !exp) {
-		OK_ERROR_L(linenum, "%s() received NULL", /* gncov */
-		                    __func__);
+	diag("Test compsum_add()");
+
+	compsum_init(&cs);
+	OK_EQUAL(compsum_result(&cs), 0.0, "compsum: Empty sum is 0");
+
+	for (i = 0; i < 10; i++) {
+		compsum_add(&cs, 0.1);
+		naive += 0.1;
+	}
+	OK_NOTEQUAL(naive, 1.0, "compsum: The naive sum of 10 × 0.1 isn't 1");
+	OK_EQUAL(compsum_result(&cs), 1.0, "compsum: 10 × 0.1 is 1");
+
+	compsum_init(&cs);
+	compsum_add(&cs, 1.0);
+	compsum_add(&cs, 1e100);
+	compsum_add(&cs, 1.0);
+	compsum_add(&cs, -1e100);
+	OK_EQUAL(compsum_result(&cs), 2.0,
+	         "compsum: Values larger than the sum are compensated");
+	print_gotexp_double(compsum_result(&cs), 2.0);
+}
+
+/*
+ * chk_bbox() - Used by test_bbox(). Adds the positions in the string `coors` 
+ * to a bounding box and verifies the result against `exp`, where the format is 
+ * "south,west north,east", or "" if the box should be empty. Returns nothing.
+ */
+
+static void chk_bbox(const int linenum, const char *coors, const char *exp)
+{
+	struct bbox b;
+	char *buf, *p, *got;
+	double west, east;
+
+	buf = mystrdup(coors);
+	if (!buf) {
+		failed_ok("mystrdup()"); /* gncov */
 		return; /* gncov */
 	}
+	bbox_init(&b);
+	for (p = strtok(buf, " "); p; p = strtok(NULL, " ")) {
+		double lat, lon;
 
-	got = xml_escape_string(s);
+		if (parse_coordinate(p, true, &lat, &lon)) {
+			OK_ERROR_L(linenum, "%s: Invalid coordinate", /* gncov */
+			           p);
+			free(buf); /* gncov */
+			return; /* gncov */
+		}
+		bbox_add(&b, lat, lon);
+	}
+	free(buf);
+
+	if (bbox_lon(&b, &west, &east))
+		got = mystrdup("");
+	else
+		got = allocstr("%g,%g %g,%g", b.minlat, west, b.maxlat, east);
 	if (!got) {
-		failed_ok("xml_escape_string()"); /* gncov */
+		failed_ok("allocstr()"); /* gncov */
 		return; /* gncov */
 	}
-	OK_STRCMP_L(got, exp, linenum, "xml escape: \"%s\"", s);
+	OK_STRCMP_L(got, exp, linenum, "bbox of \"%s\"", coors);
+	print_gotexp(got, exp);
 	free(got);
 }
 
 /*
- * test_xml_escape_string() - Tests the xml_escape_string() function. Returns 
- * nothing.
+ * test_bbox() - Tests the bbox_*() functions. Returns nothing.
  */
 
-static void test_xml_escape_string(void)
+static void test_bbox(void)
 {
-	diag("Test xml_escape_string()");
+	diag("Test bbox_add()");
 
-#define chk_xmlesc(s, exp)  chk_xmlesc(__LINE__, (s), (exp))
-	chk_xmlesc("", "");
-	chk_xmlesc("&", "&amp;");
-	chk_xmlesc("<", "&lt;");
-	chk_xmlesc(">", "&gt;");
-	chk_xmlesc("\\", "\\");
-	chk_xmlesc("a&c", "a&amp;c");
-	chk_xmlesc("a<c", "a&lt;c");
-	chk_xmlesc("a>c", "a&gt;c");
-	chk_xmlesc("abc", "abc");
-#undef chk_xmlesc
-	OK_NULL(xml_escape_string(NULL), "xml_escape_string(NULL)");
+#define chk_bbox(coors, exp)  chk_bbox(__LINE__, (coors), (exp))
+
+	chk_bbox("", "");
+	chk_bbox("0,-180 0,180", "0,180 0,180");
+	chk_bbox("0,-180 0,180 10,0", "0,0 10,180");
+	chk_bbox("0,-10 0,10", "0,-10 0,10");
+	chk_bbox("1,179 2,-179", "1,179 2,-179");
+	chk_bbox("10,170 -5,-170 0,180", "-5,170 10,-170");
+	chk_bbox("12,34", "12,34 12,34");
+	chk_bbox("60,10 61,11 61.5,-179", "60,10 61.5,-179");
+	chk_bbox("60,10 61,11 61.5,-169", "60,-169 61.5,11");
+
+#undef chk_bbox
 }
 
 /*
- * test_gpx_wpt() - Tests the gpx_wpt() function. Returns nothing.
+ * chk_arc() - Tests that the distance from the position `p` to the arc from 
+ * `a` to `b`, calculated with arc_angle() on a sphere with radius 
+ * EARTH_RADIUS, is `exp` meters with 3 decimals. Returns nothing.
  */
 
-static void test_gpx_wpt(void)
+static void chk_arc(const int linenum, const char *p, const char *a,
+                    const char *b, const char *exp)
 {
-	char *p, /* String sent to gpx_wpt() */
-	     *c, /* Converted version of `p` */
-	     *e, /* Expected string from gpx_wpt() */
-	     *s; /* Result from gpx_wpt() */
+	double plat, plon, alat, alon, blat, blon;
+	struct vec3 pv, av, bv;
+	struct arc arc;
+	char *got;
 
-	diag("Test gpx_wpt()");
+	if (parse_coordinate(p, true, &plat, &plon)
+	    || parse_coordinate(a, true, &alat, &alon)
+	    || parse_coordinate(b, true, &blat, &blon)) {
+		failed_ok("parse_coordinate()"); /* gncov */
+		return; /* gncov */
+	}
+	pos_to_vec3(plat, plon, &pv);
+	pos_to_vec3(alat, alon, &av);
+	pos_to_vec3(blat, blon, &bv);
+	arc_init(&arc, &av, &bv);
+	got = allocstr("%.3f", arc_angle(&arc, &pv) * EARTH_RADIUS);
+	if (!got) {
+		failed_ok("allocstr()"); /* gncov */
+		return; /* gncov */
+	}
+	OK_STRCMP_L(got, exp, linenum, "arc_angle(): %s to %s-%s", p, a, b);
+	print_gotexp(got, exp);
+	free(got);
+}
 
-	e = "  <wpt lat=\"12.34\" lon=\"56.78\">\n"
-	    "    <name>abc def</name>\n"
-	    "    <cmt>ghi jkl MN</cmt>\n"
-	    "  </wpt>\n";
-	s = gpx_wpt(12.34, 56.78, "abc def", "ghi jkl MN");
-	OK_STRCMP(no_null(s), e, "gpx_wpt() without special chars");
-	print_gotexp(s, e);
-	free(s);
+/*
+ * test_arc_angle() - Tests the pos_to_vec3(), vec3_to_pos(), vec3_angle(), 
+ * arc_init() and arc_angle() functions. Returns nothing.
+ */
 
-	e = "  <wpt lat=\"12.34\" lon=\"56.78\">\n"
-	    "    <name>&amp;</name>\n"
-	    "    <cmt>&amp;</cmt>\n"
-	    "  </wpt>\n";
-	s = gpx_wpt(12.34, 56.78, "&", "&");
-	OK_STRCMP(no_null(s), e, "gpx_wpt() with ampersand");
-	print_gotexp(s, e);
-	free(s);
+static void test_arc_angle(void)
+{
+	struct vec3 v;
+	double lat, lon;
 
-	e = "  <wpt lat=\"12.34\" lon=\"56.78\">\n"
-	    "    <name>&lt;</name>\n"
-	    "    <cmt>&lt;</cmt>\n"
-	    "  </wpt>\n";
-	s = gpx_wpt(12.34, 56.78, "<", "<");
-	OK_STRCMP(no_null(s), e, "gpx_wpt() with lt");
-	print_gotexp(s, e);
-	free(s);
+	diag("Test arc_angle()");
+
+	pos_to_vec3(0.0, 90.0, &v);
+	OK_TRUE(fabs(v.x) < 1e-15 && v.y == 1.0 && v.z == 0.0,
+	        "pos_to_vec3(0, 90) is 0,1,0");
+	pos_to_vec3(-90.0, 12.0, &v);
+	OK_TRUE(fabs(v.x) < 1e-15 && fabs(v.y) < 1e-15 && v.z == -1.0,
+	        "pos_to_vec3(-90, 12) is 0,0,-1");
+	pos_to_vec3(-33.86, 151.21, &v);
+	v.x *= 3.0;
+	v.y *= 3.0;
+	v.z *= 3.0;
+	OK_SUCCESS(vec3_to_pos(&v, &lat, &lon), "vec3_to_pos() with length 3");
+	OK_TRUE(fabs(lat + 33.86) < 1e-12 && fabs(lon - 151.21) < 1e-12,
+	        "vec3_to_pos() returns the original position");
+	v.x = v.y = v.z = 0.0;
+	OK_FAILURE(vec3_to_pos(&v, &lat, &lon), "vec3_to_pos() with the zero"
+	                                        " vector");
+
+#define chk_arc(p, a, b, exp)  chk_arc(__LINE__, (p), (a), (b), (exp))
+
+	chk_arc("0,0.5", "0,0", "0,1", "0.000");
+	chk_arc("1,0.5", "0,0", "0,1", "111194.927");
+	chk_arc("-1,0.5", "0,0", "0,1", "111194.927");
+	chk_arc("0,2", "0,0", "0,1", "111194.927");
+	chk_arc("0,-3", "0,0", "0,1", "333584.780");
+	chk_arc("90,0", "0,0", "0,1", "10007543.398");
+	chk_arc("0,0", "0,0", "0,1", "0.000");
+	chk_arc("11,10", "10,10", "10,10", "111194.927");
+	chk_arc("0,90", "0,0", "0,180", "10007543.398");
+	chk_arc("60.001,5.5", "60,5", "60,6", "6.150");
+
+#undef chk_arc
+
+	OK_TRUE(fabs(gaussian_radius(&WGS84, 0.0) - 6356752.314245) < 1e-6,
+	        "gaussian_radius() at the equator");
+	OK_TRUE(fabs(gaussian_radius(&WGS84, -90.0) - 6399593.625758) < 1e-6,
+	        "gaussian_radius() at the South Pole");
+}
 
-	e = "  <wpt lat=\"12.34\" lon=\"56.78\">\n"
-	    "    <name>&gt;</name>\n"
-	    "    <cmt>&gt;</cmt>\n"
-	    "  </wpt>\n";
-	s = gpx_wpt(12.34, 56.78, ">", ">");
-	OK_STRCMP(no_null(s), e, "gpx_wpt() with gt");
-	print_gotexp(s, e);
-	free(s);
+/*
+ * chk_xtrack() - Tests that the cross-track and along-track distances from 
+ * the position `p` to the great circle from `a` to `b`, calculated with 
+ * arc_cross_track() and arc_along_track() on a sphere with radius 
+ * EARTH_RADIUS, are `exp_x` and `exp_a` meters with 3 decimals. Also checks 
+ * that cross_track_batch() returns the same values. Returns nothing.
+ */
 
-	p = "asdf < & > <\" &&lt; < & abc\n"
-	    " >;;;&lt;;;åæø;abc🤘def\n"
-	    "def>/<€>;&amp;&<&gt;>&\n"
-	    "\\$e=19;\n";
-	c = "asdf &lt; &amp; &gt; &lt;\" &amp;&amp;lt; &lt; &amp; abc\n"
-	    " &gt;;;;&amp;lt;;;åæø;abc🤘def\n"
-	    "def&gt;/&lt;€&gt;;&amp;amp;&amp;&lt;&amp;gt;&gt;&amp;\n"
-	    "\\$e=19;\n";
-	e = allocstr("  <wpt lat=\"12.34\" lon=\"56.78\">\n"
-	             "    <name>%s</name>\n"
-	             "    <cmt>%s</cmt>\n"
-	             "  </wpt>\n", c, c);
-	if (!e) {
+static void chk_xtrack(const int linenum, const char *p, const char *a,
+                       const char *b, const char *exp_x, const char *exp_a)
+{
+	double plat, plon, alat, alon, blat, blon, xt, at, bxt, bat;
+	struct vec3 pv, av, bv;
+	struct arc arc;
+	char *got_x, *got_a;
+
+	if (parse_coordinate(p, true, &plat, &plon)
+	    || parse_coordinate(a, true, &alat, &alon)
+	    || parse_coordinate(b, true, &blat, &blon)) {
+		failed_ok("parse_coordinate()"); /* gncov */
+		return; /* gncov */
+	}
+	pos_to_vec3(plat, plon, &pv);
+	pos_to_vec3(alat, alon, &av);
+	pos_to_vec3(blat, blon, &bv);
+	arc_init(&arc, &av, &bv);
+	xt = arc_cross_track(&arc, &pv) * EARTH_RADIUS;
+	at = arc_along_track(&arc, &pv) * EARTH_RADIUS;
+	got_x = allocstr("%.3f", xt);
+	got_a = allocstr("%.3f", at);
+	if (!got_x || !got_a) {
 		failed_ok("allocstr()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	OK_STRCMP_L(got_x, exp_x, linenum, "arc_cross_track(): %s to %s-%s",
+	            p, a, b);
+	print_gotexp(got_x, exp_x);
+	OK_STRCMP_L(got_a, exp_a, linenum, "arc_along_track(): %s to %s-%s",
+	            p, a, b);
+	print_gotexp(got_a, exp_a);
+	cross_track_batch(&arc, &plat, &plon, 1, &bxt, &bat);
+	OK_TRUE_L(bxt == xt && bat == at, linenum,
+	          "cross_track_batch(): %s to %s-%s", p, a, b);
+
+cleanup:
+	free(got_a);
+	free(got_x);
+}
+
+/*
+ * chk_polyline() - Creates a route from the positions in `route`, separated 
+ * by spaces, where "-" starts a new segment. Tests that polyline_nearest() 
+ * with every possible hint finds the leg `exp_leg` (starting at 1) for the 
+ * position `p`, and that the cross-track and along-track distances are 
+ * `exp_x` and `exp_a` meters with 3 decimals. Returns nothing.
+ */
+
+static void chk_polyline(const int linenum, const char *p, const char *route,
+                         const size_t exp_leg, const char *exp_x,
+                         const char *exp_a)
+{
+	struct polyline pl;
+	struct vec3 pv;
+	double plat, plon;
+	char *buf, *tok, *got_x = NULL, *got_a = NULL;
+	size_t hint;
+
+	buf = mystrdup(route);
+	if (!buf) {
+		failed_ok("mystrdup()"); /* gncov */
 		return; /* gncov */
 	}
-	s = gpx_wpt(12.34, 56.78, p, p);
-	OK_STRCMP(no_null(s), e, "gpx_wpt() with amp, gt, lt, and more");
-	print_gotexp(s, e);
-	free(s);
-	free(e);
+	polyline_init(&pl);
+	for (tok = strtok(buf, " "); tok; tok = strtok(NULL, " ")) {
+		double lat, lon;
 
-	p = NULL;
-	e = NULL;
-	s = gpx_wpt(12.34, 56.78, p, p);
-	OK_NULL(s, "gpx_wpt() with NULL in name and cmt");
-	print_gotexp(s, e);
-	if (s) {
-		OK_ERROR("%s(): `s` was allocated, should not" /* gncov */
-		         " happen", __func__);
-		free(s); /* gncov */
+		if (!strcmp(tok, "-")) {
+			polyline_break(&pl);
+			continue;
+		}
+		if (parse_coordinate(tok, true, &lat, &lon)
+		    || polyline_add(&pl, lat, lon)) {
+			failed_ok("parse_coordinate()"); /* gncov */
+			goto cleanup; /* gncov */
+		}
 	}
+	if (parse_coordinate(p, true, &plat, &plon)) {
+		failed_ok("parse_coordinate()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	pos_to_vec3(plat, plon, &pv);
 
-	p = NULL;
-	e = NULL;
-	s = gpx_wpt(12.34, 56.78, p, "def");
-	OK_NULL(s, "gpx_wpt() with NULL in name");
-	print_gotexp(s, e);
-	if (s) {
-		OK_ERROR("%s(): `s` was allocated," /* gncov */
-		         " should not happen", __func__);
-		free(s); /* gncov */
+	for (hint = 0; hint <= pl.n; hint++) {
+		double xt, at;
+		const size_t leg = polyline_nearest(&pl, &pv, hint, &xt, &at);
+
+		free(got_a);
+		free(got_x);
+		got_x = allocstr("%.3f", xt * EARTH_RADIUS);
+		got_a = allocstr("%.3f", at * EARTH_RADIUS);
+		if (!got_x || !got_a) {
+			failed_ok("allocstr()"); /* gncov */
+			goto cleanup; /* gncov */
+		}
+		if (leg + 1 != exp_leg || strcmp(got_x, exp_x)
+		    || strcmp(got_a, exp_a))
+			break; /* gncov */
+	}
+	OK_TRUE_L(hint > pl.n, linenum,
+	          "polyline_nearest(): %s to %s", p, route);
+	if (hint <= pl.n) {
+		diag("hint = %zu", hint); /* gncov */
+		print_gotexp(got_x, exp_x); /* gncov */
+		print_gotexp(got_a, exp_a); /* gncov */
 	}
 
-	s = gpx_wpt(12.34, 56.78, "abc", NULL);
-	OK_NOTNULL(s, "gpx_wpt() with NULL in cmt");
-	free(s);
+cleanup:
+	free(got_a);
+	free(got_x);
+	polyline_free(&pl);
+	free(buf);
 }
 
-                              /*** strings.c ***/
+/*
+ * test_cross_track() - Tests the arc_cross_track(), arc_along_track(), 
+ * cross_track_batch() and polyline_*() functions. Returns nothing.
+ */
+
+static void test_cross_track(void)
+{
+	struct polyline pl;
+	struct vec3 a, b;
+	struct arc arc;
+	int i;
+
+	diag("Test cross-track functions");
+
+#define chk_xtrack(p, a, b, x, at)  chk_xtrack(__LINE__, (p), (a), (b), \
+                                               (x), (at))
+
+	chk_xtrack("60.5,5.6", "60,5", "61,6", "5335.180", "64486.799");
+	chk_xtrack("60.5,5.4", "60,5", "61,6", "-4489.299", "59649.038");
+	chk_xtrack("62,7", "60,5", "61,6", "-3402.825", "247096.165");
+	chk_xtrack("1,-1", "0,0", "0,1", "-111194.927", "-111194.927");
+	chk_xtrack("-1,-179", "0,0", "0,1", "111194.927", "-19903891.869");
+	chk_xtrack("-90,0", "0,0", "0,1", "10007543.398", "0.000");
+
+#undef chk_xtrack
+
+	pos_to_vec3(10.0, 20.0, &a);
+	arc_init(&arc, &a, &a);
+	OK_TRUE(isnan(arc_cross_track(&arc, &a)),
+	        "arc_cross_track() of a degenerate arc is NaN");
+	OK_TRUE(isnan(arc_along_track(&arc, &a)),
+	        "arc_along_track() of a degenerate arc is NaN");
+	pos_to_vec3(-10.0, -160.0, &b);
+	arc_init(&arc, &a, &b);
+	OK_TRUE(isnan(arc_cross_track(&arc, &a)),
+	        "arc_cross_track() of an antipodal arc is NaN");
+
+#define chk_polyline(p, r, leg, x, at)  chk_polyline(__LINE__, (p), (r), \
+                                                     (leg), (x), (at))
+
+	chk_polyline("60.5,5.6", "60,5 61,6", 1, "5335.180", "64486.799");
+	chk_polyline("62,7", "60,5 61,6", 1, "-123201.340", "123941.821");
+	chk_polyline("1,5", "0,0 0,10 - 10,10 10,20", 1, "-111194.927",
+	             "555974.633");
+	chk_polyline("5,10", "0,0 0,10 - 10,10 10,20", 1, "-555974.633",
+	             "1111949.266");
+	chk_polyline("10,15", "0,0 0,10 - 10,10 10,20", 2, "4161.253",
+	             "1659456.379");
+	chk_polyline("0,5", "0,0 0,10 0,10 0,20", 1, "0.000", "555974.633");
+	chk_polyline("0,10", "0,0 0,10 0,10 0,20", 1, "0.000",
+	             "1111949.266");
+	chk_polyline("0,15", "0,0 0,10 0,10 0,20", 3, "0.000",
+	             "1667923.900");
+	chk_polyline("0,1", "0,0 0,180 0,-179", 1, "111194.927", "0.000");
+	chk_polyline("0,-179.5", "0,0 0,180 0,-179", 2, "0.000",
+	             "20070684.259");
+	chk_polyline("45,-90", "0,0 0,180 0,-179", 2, "-9928918.707",
+	             "20126281.723");
+	chk_polyline("-1,60", "0,0 0,60 0,120 0,180 0,-120 0,-60 0,0", 1,
+	             "111194.927", "6671695.599");
+
+#undef chk_polyline
+
+	/* A route with several blocks, compared to all legs */
+	polyline_init(&pl);
+	for (i = 0; i <= 300; i++) {
+		if (polyline_add(&pl, sin(i / 10.0) * 5.0, i * 0.5 - 75.0)) {
+			failed_ok("polyline_add()"); /* gncov */
+			break; /* gncov */
+		}
+	}
+	OK_EQUAL(pl.n, 300, "The long route has 300 legs");
+	for (i = 0; i < 40; i++) {
+		double xt, at, exp = INFINITY;
+		size_t leg, j;
+
+		pos_to_vec3(i * 4.5 - 90.0, i * 9.0 - 180.0, &a);
+		leg = polyline_nearest(&pl, &a, 0, &xt, &at);
+		for (j = 0; j < pl.n; j++)
+			exp = fmin(exp, arc_angle(&pl.legs[j].arc, &a));
+		OK_TRUE(leg < pl.n && fabs(xt) == exp,
+		        "Long route, position %d", i);
+	}
+	polyline_free(&pl);
+
+	polyline_init(&pl);
+	OK_SUCCESS(polyline_add(&pl, 1.0, 2.0), "polyline_add() 1");
+	polyline_break(&pl);
+	OK_SUCCESS(polyline_add(&pl, 3.0, 4.0), "polyline_add() 2");
+	OK_EQUAL(pl.n, 0, "The segment break prevents a leg");
+	polyline_free(&pl);
+	OK_NULL(pl.legs, "polyline_free() sets legs to NULL");
+}
 
 /*
- * chk_tz() - Used by test_trim_zeros(). Verifies that the number in the string 
- * `got` equals `exp` after processing by trim_zeros(). Returns nothing.
+ * make_polygon() - Creates the polygon `dest` from the positions in `s`, 
+ * separated by spaces. If `reverse` is true, the positions are used in 
+ * reverse order. Returns 1 if anything failed, otherwise 0.
  */
 
-static void chk_tz(const int linenum, const char *got, const char *exp)
+static int make_polygon(struct polygon *dest, const char *s,
+                        const bool reverse)
 {
-	const char *res;
-	char *s;
+	double lat[16], lon[16];
+	char *buf, *tok;
+	size_t n = 0, i;
+	int retval = 1;
 
-	assert(got);
-	assert(exp);
+	buf = mystrdup(s);
+	if (!buf)
+		return 1; /* gncov */
+	for (tok = strtok(buf, " "); tok && n < 16; tok = strtok(NULL, " ")) {
+		if (parse_coordinate(tok, true, &lat[n], &lon[n]))
+			goto cleanup; /* gncov */
+		n++;
+	}
+	if (reverse) {
+		for (i = 0; i < n / 2; i++) {
+			double t = lat[i];
+
+			lat[i] = lat[n - 1 - i];
+			lat[n - 1 - i] = t;
+			t = lon[i];
+			lon[i] = lon[n - 1 - i];
+			lon[n - 1 - i] = t;
+		}
+	}
+	retval = polygon_init(dest, lat, lon, n);
 
-	s = mystrdup(got);
-	if (!s) {
-		failed_ok("mystrdup()"); /* gncov */
+cleanup:
+	free(buf);
+
+	return retval;
+}
+
+/*
+ * chk_polygon() - Tests that polygon_contains() returns `exp` for the 
+ * position `p` and the polygon with the positions in `poly`, separated by 
+ * spaces, in both directions. Returns nothing.
+ */
+
+static void chk_polygon(const int linenum, const char *p, const char *poly,
+                        const int exp)
+{
+	struct polygon pg1, pg2;
+	struct vec3 pv;
+	double lat, lon;
+
+	if (parse_coordinate(p, true, &lat, &lon)
+	    || make_polygon(&pg1, poly, false)) {
+		failed_ok("make_polygon()"); /* gncov */
 		return; /* gncov */
 	}
-	res = trim_zeros(s);
-	OK_STRCMP_L(res, exp, linenum, "trim_zeros(\"%s\"), expects \"%s\"",
-	                               got, exp);
-	print_gotexp(res, exp);
-	free(s);
+	if (make_polygon(&pg2, poly, true)) {
+		failed_ok("make_polygon()"); /* gncov */
+		polygon_free(&pg1); /* gncov */
+		return; /* gncov */
+	}
+	pos_to_vec3(lat, lon, &pv);
+	OK_EQUAL_L(polygon_contains(&pg1, &pv), exp, linenum,
+	           "polygon_contains(): %s in %s", p, poly);
+	OK_EQUAL_L(polygon_contains(&pg2, &pv), exp, linenum,
+	           "polygon_contains(): %s in %s, reversed", p, poly);
+	polygon_free(&pg2);
+	polygon_free(&pg1);
 }
 
 /*
- * test_trim_zeros() - Tests the trim_zeros() function. Returns nothing.
+ * chk_intersect() - Tests that arc_intersect() returns `exp_ret` for the arcs 
+ * `a`-`b` and `c`-`d`, and that the intersection is `exp` with 6 decimals. 
+ * `exp` isn't checked if `exp_ret` is -1. Returns nothing.
  */
 
-static void test_trim_zeros(void)
+static void chk_intersect(const int linenum, const char *a, const char *b,
+                          const char *c, const char *d, const int exp_ret,
+                          const char *exp)
 {
-	diag("Test trim_zeros()");
+	double lat[4], lon[4];
+	const char *coor[4] = { a, b, c, d };
+	struct vec3 v[4], x;
+	struct arc a1, a2;
+	int i, ret;
+	char *got;
 
-#define chk_tz(got, exp)  chk_tz(__LINE__, (got), (exp))
+	for (i = 0; i < 4; i++) {
+		if (parse_coordinate(coor[i], true, &lat[i], &lon[i])) {
+			failed_ok("parse_coordinate()"); /* gncov */
+			return; /* gncov */
+		}
+		pos_to_vec3(lat[i], lon[i], &v[i]);
+	}
+	arc_init(&a1, &v[0], &v[1]);
+	arc_init(&a2, &v[2], &v[3]);
+	ret = arc_intersect(&a1, &a2, &x);
+	OK_EQUAL_L(ret, exp_ret, linenum, "arc_intersect(): %s-%s and %s-%s"
+	           " returns %d", a, b, c, d, exp_ret);
+	if (ret != exp_ret)
+		diag("ret = %d", ret); /* gncov */
+	if (exp_ret < 0)
+		return;
+	vec3_to_pos(&x, &lat[0], &lon[0]);
+	round_number(&lat[0], 6);
+	round_number(&lon[0], 6);
+	got = allocstr("%.6f,%.6f", lat[0], lon[0]);
+	if (!got) {
+		failed_ok("allocstr()"); /* gncov */
+		return; /* gncov */
+	}
+	OK_STRCMP_L(got, exp, linenum, "arc_intersect(): %s-%s and %s-%s",
+	            a, b, c, d);
+	print_gotexp(got, exp);
+	free(got);
+}
 
-	chk_tz("", "");
-	chk_tz("+", "+");
-	chk_tz("++++++", "++++++");
-	chk_tz("++1.0", "++1.0");
-	chk_tz("+0.0000", "+0.0");
-	chk_tz("+0.29750000", "+0.2975");
-	chk_tz("+5.0", "+5.0");
-	chk_tz("+5.000", "+5.0");
-	chk_tz("-", "-");
-	chk_tz("-+0.0", "-+0.0");
-	chk_tz("---", "---");
-	chk_tz("-0.0000", "-0.0");
-	chk_tz("-7.9650", "-7.965");
-	chk_tz(".", ".");
-	chk_tz(".3000", ".3");
-	chk_tz("0", "0");
-	chk_tz("00000", "00000");
-	chk_tz("1", "1");
-	chk_tz("1.0.0", "1.0.0");
-	chk_tz("1.234 abc", "1.234 abc");
-	chk_tz("5.", "5.");
-	chk_tz("5.0", "5.0");
-	chk_tz("5.00000", "5.0");
-	chk_tz("5.1", "5.1");
-	chk_tz("5.100000", "5.1");
-	chk_tz("5.10001", "5.10001");
-	chk_tz("9.234abc", "9.234abc");
-	chk_tz("abc", "abc");
+/*
+ * test_intersect() - Tests the arc_intersect() and intersect_batch() 
+ * functions. Returns nothing.
+ */
 
-#undef chk_tz
+static void test_intersect(void)
+{
+	const double lat[] = { 0.0, 1.0, 2.0, 2.0, 3.0, 3.0 },
+	             lon[] = { 1.0, -1.0, 1.0, 1.0, 1.0, -1.0 };
+	double xlat[5], xlon[5], atrack[5];
+	size_t leg[5], n;
+	struct vec3 a, b;
+	struct arc arc;
+
+	diag("Test arc_intersect()");
+
+#define chk_intersect(a, b, c, d, ret, exp)  chk_intersect(__LINE__, (a), \
+                                                           (b), (c), (d), \
+                                                           (ret), (exp))
+
+	chk_intersect("0,0", "10,10", "0,10", "10,0", 1,
+	              "5.057515,5.000000");
+	chk_intersect("0,10", "10,0", "0,0", "10,10", 1,
+	              "5.057515,5.000000");
+	chk_intersect("0,0", "10,10", "20,10", "30,0", 0,
+	              "14.490588,14.744909");
+	chk_intersect("0,0", "0,10", "-10,5", "10,5", 1, "0.000000,5.000000");
+	chk_intersect("0,0", "0,10", "-10,15", "10,15", 0,
+	              "0.000000,15.000000");
+	chk_intersect("0,0", "0,10", "-10,-175", "10,-175", 0,
+	              "0.000000,5.000000");
+	chk_intersect("0,0", "0,10", "0,10", "10,10", 1,
+	              "0.000000,10.000000");
+	chk_intersect("60,5", "61,6", "60,6", "61,5", 1,
+	              "60.508647,5.500000");
+	chk_intersect("0,0", "0,0", "0,10", "10,10", -1, NULL);
+	chk_intersect("0,0", "0,10", "0,180", "0,-170", -1, NULL);
+	chk_intersect("0,0", "0,10", "0,20", "0,30", -1, NULL);
+
+#undef chk_intersect
+
+	pos_to_vec3(0.0, 0.0, &a);
+	pos_to_vec3(10.0, 0.0, &b);
+	arc_init(&arc, &a, &b);
+	n = intersect_batch(&arc, lat, lon, 6, xlat, xlon, atrack, leg);
+	OK_EQUAL(n, 3, "intersect_batch() finds 3 crossings");
+	OK_TRUE(leg[0] == 0 && leg[1] == 1 && leg[2] == 4,
+	        "intersect_batch(): The legs are correct");
+	OK_TRUE(fabs(xlat[0] - 0.500114) < 1e-6 && fabs(xlon[0]) < 1e-12,
+	        "intersect_batch(): The first crossing is correct");
+	OK_TRUE(fabs(atrack[2] - 333635.501407) < 1e-6,
+	        "intersect_batch(): The along-track distance is correct");
+	OK_EQUAL(intersect_batch(&arc, lat, lon, 0, xlat, xlon, atrack, leg),
+	         0, "intersect_batch() with no positions");
 }
 
 /*
- * test_mystrdup() - Tests the mystrdup() function. Returns nothing.
+ * chk_cpa() - Tests that closest_approach() finds the closest approach of 
+ * the objects at `lat1,lon1` and `lat2,lon2` with the bearings `bear1` and 
+ * `bear2` and the speeds `speed1` and `speed2` in meters per second after 
+ * `exp_t` seconds, at a distance of `exp_d` meters, both with 3 decimals. 
+ * Returns nothing.
  */
 
-static void test_mystrdup(void)
+static void chk_cpa(const int linenum,
+                    const double lat1, const double lon1,
+                    const double bear1, const double speed1,
+                    const double lat2, const double lon2,
+                    const double bear2, const double speed2,
+                    const char *exp_t, const char *exp_d)
 {
-	const char *txt = "Test string";
-	char *s;
+	struct mover m1, m2;
+	double t, angle;
+	char *got_t, *got_d;
+
+	mover_init(&m1, lat1, lon1, bear1, speed1);
+	mover_init(&m2, lat2, lon2, bear2, speed2);
+	t = closest_approach(&m1, &m2, &angle);
+	got_t = allocstr("%.3f", t);
+	got_d = allocstr("%.3f", angle * EARTH_RADIUS);
+	if (!got_t || !got_d) {
+		failed_ok("allocstr()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	OK_STRCMP_L(got_t, exp_t, linenum, "closest_approach(): Time from"
+	            " %f,%f and %f,%f", lat1, lon1, lat2, lon2);
+	print_gotexp(got_t, exp_t);
+	OK_STRCMP_L(got_d, exp_d, linenum, "closest_approach(): Distance from"
+	            " %f,%f and %f,%f", lat1, lon1, lat2, lon2);
+	print_gotexp(got_d, exp_d);
 
-	diag("Test mystrdup()");
-	OK_NULL(mystrdup(NULL), "mystrdup(NULL) == NULL");
+cleanup:
+	free(got_d);
+	free(got_t);
+}
 
-	s = mystrdup(txt);
-	if (!s) {
-		failed_ok("mystrdup()"); /* gncov */
-		return; /* gncov */
-	}
-	OK_STRCMP(s, txt, "mystrdup(): Strings are identical");
-	free(s);
+/*
+ * test_closest_approach() - Tests the mover_init(), mover_pos() and 
+ * closest_approach() functions. Returns nothing.
+ */
+
+static void test_closest_approach(void)
+{
+	struct mover m1, m2;
+	struct vec3 v;
+	double lat, lon, angle;
+
+	diag("Test closest_approach()");
+
+	mover_init(&m1, 0.0, 0.0, 90.0, 1.0);
+	mover_pos(&m1, EARTH_RADIUS * M_PI / 2.0, &v);
+	vec3_to_pos(&v, &lat, &lon);
+	OK_TRUE(fabs(lat) < 1e-12 && fabs(lon - 90.0) < 1e-12,
+	        "mover_pos(): East from 0,0 to 0,90");
+	mover_init(&m1, 60.0, 5.0, 0.0, 1.0);
+	mover_pos(&m1, EARTH_RADIUS * M_PI / 6.0, &v);
+	vec3_to_pos(&v, &lat, &lon);
+	OK_TRUE(fabs(lat - 90.0) < 1e-9, "mover_pos(): North to the pole");
+
+#define chk_cpa(lat1, lon1, b1, s1, lat2, lon2, b2, s2, t, d)  \
+        chk_cpa(__LINE__, (lat1), (lon1), (b1), (s1), \
+                (lat2), (lon2), (b2), (s2), (t), (d))
+
+	chk_cpa(0.0, 0.0, 90.0, 10.0, 0.0, 0.1, 270.0, 10.0, "555.975",
+	        "0.000");
+	chk_cpa(0.0, 0.0, 0.0, 10.0, 0.01, 0.01, 270.0, 10.0, "111.195",
+	        "0.000");
+	chk_cpa(60.0, 5.0, 45.0, 250.0, 61.0, 6.0, 180.0, 220.0, "286.031",
+	        "4694.053");
+	chk_cpa(0.0, 0.0, 90.0, 10.0, 0.0, 1.0, 90.0, 10.0, "0.000",
+	        "111194.927");
+	chk_cpa(0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, "0.000",
+	        "111194.927");
+	chk_cpa(0.0, 0.0, 90.0, 0.0, 1.0, 0.5, 180.0, 20.0, "5559.746",
+	        "55597.463");
+	chk_cpa(0.0, -1.0, 90.0, 10.0001, 0.0, 0.0, 90.0, 10.0,
+	        "1111949266.449", "0.000");
+	chk_cpa(0.0, 0.0, 0.0, 10.0, 0.0, 0.001, 0.0, 10.0, "1000754.340",
+	        "0.000");
+	chk_cpa(60.0, 10.0, 45.0, 10.0, 60.0, 10.0, 45.0, 10.0, "0.000",
+	        "0.000");
+
+#undef chk_cpa
+
+	mover_init(&m1, 0.0, -1.0, 90.0, 10.0000001);
+	mover_init(&m2, 0.0, 0.0, 90.0, 10.0);
+	OK_TRUE(closest_approach(&m1, &m2, &angle) == -1.0,
+	        "closest_approach() gives up after CPA_MAX_STEPS steps");
 }
 
 /*
- * test_allocstr() - Tests the allocstr() function. Returns nothing.
+ * test_polygon() - Tests the polygon_*() and polyindex_*() functions. Returns 
+ * nothing.
  */
 
-static void test_allocstr(void)
+static void test_polygon(void)
 {
-	const size_t bufsize = BUFSIZ * 2 + 1;
-	char *p, *p2, *p3;
-	size_t alen;
+	struct polygon pg, polys[300];
+	struct polyindex idx;
+	size_t found[300], i, count, exp_count, errcount = 0;
+
+	diag("Test polygon functions");
+
+#define chk_polygon(p, poly, exp)  chk_polygon(__LINE__, (p), (poly), (exp))
+
+	chk_polygon("0,0", "-1,-1 -1,1 1,1 1,-1", 1);
+	chk_polygon("0.999,0.999", "-1,-1 -1,1 1,1 1,-1", 1);
+	chk_polygon("1.001,0", "-1,-1 -1,1 1,1 1,-1", 0);
+	chk_polygon("0,-1.001", "-1,-1 -1,1 1,1 1,-1", 0);
+	chk_polygon("-0.5,0.5", "-1,-1 -1,1 1,1 1,-1 -1,-1", 1);
+	chk_polygon("90,0", "80,0 80,90 80,180 80,-90", 1);
+	chk_polygon("85,45", "80,0 80,90 80,180 80,-90", 1);
+	chk_polygon("79,45", "80,0 80,90 80,180 80,-90", 0);
+	chk_polygon("-90,0", "80,0 80,90 80,180 80,-90", 0);
+	chk_polygon("0,180", "-1,179 -1,-179 1,-179 1,179", 1);
+	chk_polygon("0,-179.5", "-1,179 -1,-179 1,-179 1,179", 1);
+	chk_polygon("0,0", "-1,179 -1,-179 1,-179 1,179", 0);
+	chk_polygon("0.5,1.5", "0,0 0,3 3,3 3,0 2,0 2,2 1,2 1,0", 1);
+	chk_polygon("1.5,1.5", "0,0 0,3 3,3 3,0 2,0 2,2 1,2 1,0", 0);
+	chk_polygon("1.5,2.5", "0,0 0,3 3,3 3,0 2,0 2,2 1,2 1,0", 1);
+	chk_polygon("2.5,1", "0,0 0,3 3,3 3,0 2,0 2,2 1,2 1,0", 1);
+	chk_polygon("1.5,-0.5", "0,0 0,3 3,3 3,0 2,0 2,2 1,2 1,0", 0);
+	chk_polygon("60.5,5.5", "60,5 60,6 61,6", 1);
+	chk_polygon("60.9,5.1", "60,5 60,6 61,6", 0);
+
+#undef chk_polygon
+
+	OK_SUCCESS(make_polygon(&pg, "0,0 0,1 1,1 0,0", false),
+	           "Polygon with the first position repeated at the end");
+	OK_EQUAL(pg.n, 3, "The repeated position is removed");
+	polygon_free(&pg);
+	OK_SUCCESS(make_polygon(&pg, "0,0 0,120 0,-120", false),
+	           "Polygon around the equator");
+	OK_FALSE(pg.cap.radius < M_PI / 2.0,
+	         "The polygon around the equator isn't smaller than a"
+	         " hemisphere");
+	polygon_free(&pg);
 
-	diag("Test allocstr()");
-	p = malloc(bufsize);
-	if (!p) {
-		failed_ok("malloc()"); /* gncov */
-		return; /* gncov */
+	/*
+	 * Small polygons all over the globe and some large ones, the index 
+	 * must give the same result as checking all polygons.
+	 */
+	for (i = 0; i < 300; i++) {
+		const double clat = fmod((double)i * 37.1, 170.0) - 85.0,
+		             clon = fmod((double)i * 71.3, 360.0) - 180.0,
+		             d = i % 50 ? 0.5 + fmod((double)i * 0.37, 3.0) : 40.0;
+		const double lat[4] = { clat - d, clat - d, clat + d,
+		                        clat + d };
+		const double lon[4] = { clon - d, clon + d, clon + d,
+		                        clon - d };
+		double la[4], lo[4];
+		size_t j;
+
+		for (j = 0; j < 4; j++) {
+			la[j] = fmax(-90.0, fmin(90.0, lat[j]));
+			lo[j] = lon[j];
+			if (lo[j] > 180.0)
+				lo[j] -= 360.0;
+			if (lo[j] < -180.0)
+				lo[j] += 360.0;
+		}
+		if (polygon_init(&polys[i], la, lo, 4)) {
+			failed_ok("polygon_init()"); /* gncov */
+			while (i--) /* gncov */
+				polygon_free(&polys[i]); /* gncov */
+			return; /* gncov */
+		}
 	}
-	memset(p, 'a', bufsize - 1);
-	p[bufsize - 1] = '\0';
-	p2 = allocstr("%s", p);
-	if (!p2) {
-		failed_ok("allocstr() with BUFSIZ * 2"); /* gncov */
+	if (polyindex_init(&idx, polys, 300)) {
+		failed_ok("polyindex_init()"); /* gncov */
 		goto cleanup; /* gncov */
 	}
-	alen = strlen(p2);
-	OK_EQUAL(alen, BUFSIZ * 2, "allocstr(): strlen is correct");
-	p3 = p2;
-	while (*p3) {
-		if (*p3 != 'a') {
-			p3 = NULL; /* gncov */
-			break; /* gncov */
+	OK_TRUE(idx.numlarge > 0 && idx.numlarge < 300,
+	        "Some polygons are too large for the grid");
+	for (i = 0; i < 20000; i++) {
+		const double lat = fmod((double)i * 0.731, 180.0) - 90.0,
+		             lon = fmod((double)i * 1.379, 360.0) - 180.0;
+		struct vec3 p;
+		size_t j;
+
+		pos_to_vec3(lat, lon, &p);
+		count = polyindex_search(&idx, lat, lon, found);
+		exp_count = 0;
+		for (j = 0; j < 300; j++) {
+			if (!polygon_contains(&polys[j], &p))
+				continue;
+			if (exp_count >= count || found[exp_count] != j)
+				break;
+			exp_count++;
+		}
+		if (j < 300 || exp_count != count) {
+			if (!errcount++) /* gncov */
+				diag("%.3f,%.3f: %zu polygons", /* gncov */
+				     lat, lon, count);
 		}
-		p3++;
 	}
-	OK_NOTNULL(p3, "allocstr(): Content of string is correct");
+	OK_EQUAL(errcount, 0, "polyindex_search() finds the same polygons as"
+	                      " polygon_contains()");
+	polyindex_free(&idx);
+
+	OK_SUCCESS(polyindex_init(&idx, NULL, 0), "Index without polygons");
+	OK_EQUAL(polyindex_search(&idx, 1.0, 2.0, found), 0,
+	         "Search in empty index");
+	polyindex_free(&idx);
 
 cleanup:
-	free(p2);
-	free(p);
+	for (i = 0; i < 300; i++)
+		polygon_free(&polys[i]);
 }
 
 /*
- * chk_cs() - Used by test_count_substr(). Verifies that the number of 
- * non-overlapping substrings `substr` inside string `s` is `count`. `desc` is 
- * the test description. Returns nothing.
+ * chk_pointindex() - Used by test_pointindex(). Creates a point index with 
+ * the radius `radius` radians for positions all over the globe, and checks 
+ * that pointindex_search() finds the same positions as a comparison with all 
+ * positions, both for positions spread over the globe and for positions close 
+ * to the indexed positions. Returns nothing.
  */
 
-static void chk_cs(const int linenum, const char *s, const char *substr,
-                   const size_t count, const char *desc)
+static void chk_pointindex(const int linenum, const double radius)
 {
-	size_t result;
+	double lat[2000], lon[2000];
+	struct vec3 v[2000];
+	struct pointindex idx;
+	size_t found[2000], i, count, exp_count, errcount = 0;
+
+	for (i = 0; i < 2000; i++) {
+		lat[i] = i % 100 ? fmod((double)i * 0.917, 180.0) - 90.0
+		                 : (i % 200 ? 90.0 : -90.0);
+		lon[i] = i % 7 ? fmod((double)i * 2.393, 360.0) - 180.0
+		               : (i % 2 ? 180.0 : -180.0);
+		pos_to_vec3(lat[i], lon[i], &v[i]);
+	}
+	if (pointindex_init(&idx, lat, lon, 2000, radius)) {
+		failed_ok("pointindex_init()"); /* gncov */
+		return; /* gncov */
+	}
+	for (i = 0; i < 5000; i++) {
+		const double plat = i < 3000
+		                    ? fmod((double)i * 0.611, 180.0) - 90.0
+		                    : lat[i - 3000] + 0.001,
+		             plon = i < 3000
+		                    ? fmod((double)i * 1.733, 360.0) - 180.0
+		                    : lon[i - 3000];
+		struct vec3 p;
+		size_t j;
+
+		pos_to_vec3(plat, plon, &p);
+		count = pointindex_search(&idx, plat, plon, found);
+		exp_count = 0;
+		for (j = 0; j < 2000; j++) {
+			if (vec3_chord2(&v[j], &p) > idx.chord2)
+				continue;
+			if (exp_count >= count || found[exp_count] != j)
+				break;
+			exp_count++;
+		}
+		if (j < 2000 || exp_count != count) {
+			if (!errcount++) /* gncov */
+				diag("%.3f,%.3f: %zu positions", /* gncov */
+				     plat, plon, count);
+		}
+	}
+	OK_EQUAL_L(errcount, 0, linenum, "pointindex_search() with radius %g"
+	           " finds the same positions as a full comparison", radius);
+	pointindex_free(&idx);
+}
 
-	assert(desc);
-	assert(*desc);
+/*
+ * test_pointindex() - Tests the pointindex_*() functions. Returns nothing.
+ */
 
-	result = count_substr(s, substr);
-	OK_EQUAL_L(result, count, linenum, "count_substr(): %s", desc);
-	print_gotexp_size_t(result, count);
+static void test_pointindex(void)
+{
+	struct pointindex idx;
+	double lat = 60.0, lon = 10.0;
+	size_t found[1];
+
+	diag("Test pointindex functions");
+
+#define chk_pointindex(radius)  chk_pointindex(__LINE__, (radius))
+
+	chk_pointindex(0.0001);
+	chk_pointindex(0.01);
+	chk_pointindex(0.1);
+	chk_pointindex(0.7);
+	chk_pointindex(4.0);
+
+#undef chk_pointindex
+
+	OK_SUCCESS(pointindex_init(&idx, &lat, &lon, 1, 0.0),
+	           "Point index with radius 0");
+	OK_EQUAL(pointindex_search(&idx, 60.0, 10.0, found), 1,
+	         "The position itself is found");
+	OK_EQUAL(pointindex_search(&idx, 60.000001, 10.0, found), 0,
+	         "A position 0.11 m away is not found");
+	pointindex_free(&idx);
+
+	OK_SUCCESS(pointindex_init(&idx, NULL, NULL, 0, 0.1),
+	           "Index without positions");
+	OK_EQUAL(pointindex_search(&idx, 1.0, 2.0, found), 0,
+	         "Search in empty point index");
+	pointindex_free(&idx);
 }
 
 /*
- * test_count_substr() - Tests the count_substr() function. Returns nothing.
+ * ref_dbscan() - Used by test_dbscan(). A DBSCAN implementation that compares 
+ * all positions with each other, with the same numbering of the clusters as 
+ * dbscan(). Returns the number of clusters.
  */
 
-static void test_count_substr(void)
+static unsigned long ref_dbscan(const struct vec3 *v, const size_t n,
+                                const double eps, const size_t minpts,
+                                unsigned long *cluster, bool *visited,
+                                size_t *queue)
 {
-	char *s;
-	size_t bsize = 10000;
+	const double chord2 = pow(2.0 * sin(eps / 2.0), 2.0);
+	unsigned long num = 0;
+	size_t i, j, k;
 
-	diag("Test count_substr()");
+	for (i = 0; i < n; i++) {
+		cluster[i] = 0;
+		visited[i] = false;
+	}
+	for (i = 0; i < n; i++) {
+		size_t head = 0, tail = 0;
 
-#define chk_cs(s, substr, count, desc)  chk_cs(__LINE__, (s), (substr), \
-                                               (count), (desc))
-	chk_cs("", "", 0, "s and substr are empty");
-	chk_cs("", "a", 0, "s is empty");
-	chk_cs("aaa", "", 0, "substr is empty");
+		if (visited[i])
+			continue;
+		visited[i] = true;
+		queue[tail++] = i;
+		while (head < tail) {
+			const struct vec3 *p = &v[queue[head++]];
+			size_t count = 0;
+
+			for (j = 0; j < n; j++)
+				count += vec3_chord2(p, &v[j]) <= chord2;
+			if (count < minpts)
+				continue;
+			if (head == 1)
+				cluster[i] = ++num;
+			for (k = 0; k < n; k++) {
+				if (vec3_chord2(p, &v[k]) > chord2)
+					continue;
+				if (!cluster[k])
+					cluster[k] = num;
+				if (!visited[k]) {
+					visited[k] = true;
+					queue[tail++] = k;
+				}
+			}
+		}
+	}
 
-	chk_cs("", NULL, 0, "substr is NULL");
-	chk_cs(NULL, "abcdef", 0, "s is NULL");
-	chk_cs(NULL, NULL, 0, "s and substr is NULL");
-
-	chk_cs("Abc", "abc", 0, "Case sensitivity");
-	chk_cs("a", "aa", 0, "substr is longer than s");
-	chk_cs("aaa", "a", 3, "3 \"a\" in \"aaa\"");
-	chk_cs("aaa", "aa", 1, "Non-overlapping \"aa\" in \"aaa\"");
-	chk_cs("aaabaaa", "aaa", 2, "Non-overlapping \"aaa\" split by \"b\"");
-	chk_cs("abababab", "ab", 4, "4 \"ab\" in s");
-	chk_cs("abc", "b", 1, "Single character substring");
-	chk_cs("abc", "d", 0, "Substring not found");
-	chk_cs("abcdeabc", "abc", 2, "Substring at start and end");
-	chk_cs("abcdef" "abcdef" "abcdef", "abc", 3, "3 \"abc\" in s");
-	chk_cs("abcdef", "abcdef", 1, "s and substr are identical");
-	chk_cs("zzzGHJ\nabc\nGHJ\nabcGHJ", "GHJ", 3, "s with newlines");
-	chk_cs("Ḡṹṛḡḷḗ", "ḡ", 1, "UTF-8, U+1Exx area");
-
-	s = malloc(bsize + 1);
-	if (!s) {
-		failed_ok("malloc()"); /* gncov */
-		return; /* gncov */
-	}
-	memset(s, '!', bsize);
-	s[bsize] = '\0';
-	chk_cs(s, "!!!!!!!!!!", bsize / 10, "Large buffer");
-	free(s);
-#undef chk_cs
+	return num;
 }
 
 /*
- * chk_sr() - Used by test_str_replace(). Verifies that all non-overlapping 
- * occurrences of substring `s1` are replaced with the string `s2` in the 
- * string `s`, resulting in the string `exp`. Returns nothing.
+ * test_dbscan() - Tests the dbscan() function. Returns nothing.
  */
 
-static void chk_sr(const int linenum, const char *s, const char *s1,
-                   const char *s2, const char *exp, const char *desc)
+static void test_dbscan(void)
 {
-	char *result;
-
-	assert(desc);
-	assert(*desc);
+	static double lat[1000], lon[1000];
+	static struct vec3 v[1000];
+	static unsigned long cluster[1000], exp_cluster[1000];
+	static bool visited[1000];
+	static size_t queue[1000];
+	const double eps[3] = { 1e-4, 3e-3, 0.05 };
+	const size_t minpts[3] = { 2, 4, 9 };
+	size_t i, j;
+
+	diag("Test dbscan()");
+
+	/* Groups of positions in a few places, and noise all over the globe */
+	for (i = 0; i < 1000; i++) {
+		const double c = (double)(i % 7);
+
+		if (i % 3) {
+			lat[i] = 60.0 + c * 4.0 + fmod((double)i * 0.0137, 0.3);
+			lon[i] = c * 30.0 - 90.0 + fmod((double)i * 0.0291, 0.6);
+			if (i % 7 == 6)
+				lon[i] = fmod((double)i * 0.0017, 0.2) - 0.1
+				         + (i % 2 ? 180.0 : -180.0);
+		} else {
+			lat[i] = fmod((double)i * 0.731, 180.0) - 90.0;
+			lon[i] = fmod((double)i * 1.379, 360.0) - 180.0;
+		}
+		pos_to_vec3(lat[i], lon[i], &v[i]);
+	}
+	for (i = 0; i < 3; i++) {
+		const long num = dbscan(lat, lon, 1000, eps[i], minpts[i],
+		                        cluster);
+		const unsigned long exp_num = ref_dbscan(v, 1000, eps[i],
+		                                         minpts[i], exp_cluster,
+		                                         visited, queue);
+
+		for (j = 0; j < 1000 && cluster[j] == exp_cluster[j]; j++);
+		OK_TRUE(num == (long)exp_num && j == 1000,
+		        "dbscan() with eps %g and minpts %zu finds %ld"
+		        " clusters, like the reference", eps[i], minpts[i],
+		        num);
+		OK_TRUE(num > 0, "dbscan() with eps %g finds clusters",
+		        eps[i]);
+	}
 
-	result = str_replace(s, s1, s2);
-	if (!result || !exp)
-		OK_EQUAL_L(result, exp, linenum, "str_replace(): %s", desc);
-	else
-		OK_STRCMP_L(result, exp, linenum, "str_replace(): %s", desc);
-	print_gotexp(result, exp);
-	free(result);
+	OK_EQUAL(dbscan(lat, lon, 3, 1.0, 4, cluster), 0,
+	         "dbscan() with too few positions for a cluster");
+	OK_EQUAL(cluster[0] + cluster[1] + cluster[2], 0,
+	         "All positions are noise");
+	OK_EQUAL(dbscan(NULL, NULL, 0, 0.1, 1, NULL), 0,
+	         "dbscan() without positions");
 }
 
 /*
- * test_str_replace() - Tests the str_replace() function. Returns nothing.
+ * test_ecef() - Tests the ECEF and ENU conversion functions. Returns nothing.
  */
 
-static void test_str_replace(void)
+static void test_ecef(void)
 {
-	char *s;
-	size_t bsize = 10000;
-
-	diag("Test str_replace()");
-
-#define chk_sr(s, s1, s2, exp, desc)  chk_sr(__LINE__, (s), (s1), (s2), \
-                                             (exp), (desc))
-	chk_sr("", "", "", "", "s, s1, and s2 are empty");
-	chk_sr("abc", "", "b", "abc", "s1 is empty");
-	chk_sr("", "a", "b", "", "s is empty");
-	chk_sr("", "a", "", "", "s and s2 is empty");
-
-	chk_sr(NULL, "a", "b", NULL, "s is NULL");
-	chk_sr("abc", NULL, "b", NULL, "s1 is NULL");
-	chk_sr("abc", "a", NULL, NULL, "s2 is NULL");
-	chk_sr(NULL, NULL, NULL, NULL, "s, s1, and s2 is NULL");
-
-	chk_sr("test", "test", "test", "test", "s, s1, and s2 are identical");
-	chk_sr("abc", "b", "DEF", "aDEFc", "abc, replace b with DEF");
-	chk_sr("abcabcabc", "b", "DEF", "aDEFcaDEFcaDEFc",
-	       "abcabcabc, replace all b with DEF");
-	chk_sr("abcdefgh", "defg", "", "abch", "Replace defg with nothing");
-	chk_sr("abcde", "bcd", "X", "aXe", "Replace bcd with X");
-	chk_sr("abc", "d", "X", "abc", "d not in abc");
-	chk_sr("ababab", "aba", "X", "Xbab", "Replace aba in ababab");
-	chk_sr("abc", "b", "", "ac", "Replace b with nothing");
-	chk_sr("abc", "", "X", "abc", "Replace empty with X");
-	chk_sr("Ḡṹṛḡḷḗ", "ḡ", "X", "ḠṹṛXḷḗ", "Replace UTF-8 character with X");
-
-	s = malloc(bsize + 1);
-	if (!s) {
-		failed_ok("malloc()"); /* gncov */
-		return; /* gncov */
+	const double pos[][3] = {
+		{ 0.0, 0.0, 0.0 }, { 90.0, 0.0, 0.0 }, { -90.0, 45.0, 100.0 },
+		{ 60.0, 10.0, 50.0 }, { -33.9, 151.2, -20.0 },
+		{ 12.3, -179.9, 35786000.0 }, { 45.0, 90.0, -6000000.0 },
+	};
+	const size_t n = sizeof(pos) / sizeof(pos[0]);
+	struct enuframe f;
+	struct vec3 v;
+	double lat[7], lon[7], h[7], x[7], y[7], z[7], nlat, nlon, nh;
+	size_t i;
+	int equal = 0, roundtrip = 0;
+
+	diag("Test ECEF and ENU conversions");
+
+	geodetic_to_ecef(&WGS84, 0.0, 0.0, 0.0, &v);
+	OK_TRUE(v.x == 6378137.0 && v.y == 0.0 && v.z == 0.0,
+	        "geodetic_to_ecef(): 0,0 is on the x axis");
+	geodetic_to_ecef(&WGS84, 90.0, 0.0, 10.0, &v);
+	OK_TRUE(fabs(v.x) < 1e-9 && fabs(v.z - 6356762.314245) < 1e-6,
+	        "geodetic_to_ecef(): North Pole, 10 m up");
+
+	for (i = 0; i < n; i++) {
+		lat[i] = pos[i][0];
+		lon[i] = pos[i][1];
+		h[i] = pos[i][2];
 	}
-	memset(s, '!', bsize);
-	s[bsize] = '\0';
-	chk_sr(s, "!!!!!!!!!!", "", "", "Replace all text in large buffer");
-	free(s);
-
-	s = malloc(bsize + 1);
-	if (!s) {
-		failed_ok("malloc()"); /* gncov */
-		return; /* gncov */
+	geodetic_to_ecef_batch(&WGS84, lat, lon, h, n, x, y, z);
+	for (i = 0; i < n; i++) {
+		geodetic_to_ecef(&WGS84, lat[i], lon[i], h[i], &v);
+		equal += v.x == x[i] && v.y == y[i] && v.z == z[i];
+		ecef_to_geodetic(&WGS84, &v, &nlat, &nlon, &nh);
+		roundtrip += fabs(nlat - lat[i]) < 1e-12
+		             && (fabs(lat[i]) == 90.0
+		                 || fabs(nlon - lon[i]) < 1e-12)
+		             && fabs(nh - h[i]) < 1e-7;
 	}
-	memset(s, '!', bsize);
-	s[1234] = 'y';
-	s[bsize - 1] = 'z';
-	s[bsize] = '\0';
-	chk_sr(s, "!!!!!!!!!!", "", "!!!!y!!!!z", "Large buffer with y and z");
-	free(s);
-#undef chk_sr
+	OK_EQUAL(equal, 7, "geodetic_to_ecef_batch() matches"
+	         " geodetic_to_ecef()");
+	OK_EQUAL(roundtrip, 7, "ecef_to_geodetic() returns the original"
+	         " positions");
+	ecef_to_geodetic_batch(&WGS84, x, y, z, n, x, y, z);
+	OK_TRUE(fabs(x[3] - 60.0) < 1e-12 && fabs(y[3] - 10.0) < 1e-12
+	        && fabs(z[3] - 50.0) < 1e-7,
+	        "ecef_to_geodetic_batch() with the same input and output");
+
+	v.x = v.y = v.z = 0.0;
+	ecef_to_geodetic(&WGS84, &v, &nlat, &nlon, &nh);
+	OK_TRUE(nlat == 90.0 && nlon == 0.0 && fabs(nh + 6356752.314245) < 1e-6,
+	        "ecef_to_geodetic(): The center of the Earth");
+	v.x = 1000.0;
+	ecef_to_geodetic(&WGS84, &v, &nlat, &nlon, &nh);
+	geodetic_to_ecef(&WGS84, nlat, nlon, nh, &v);
+	OK_TRUE(fabs(v.x - 1000.0) < 1e-6 && fabs(v.z) < 1e-6,
+	        "ecef_to_geodetic(): 1 km from the center on the equatorial"
+	        " plane");
+	v.x = 1000.0;
+	v.y = 0.0;
+	v.z = 100.0;
+	ecef_to_geodetic(&WGS84, &v, &nlat, &nlon, &nh);
+	geodetic_to_ecef(&WGS84, nlat, nlon, nh, &v);
+	OK_TRUE(fabs(v.x - 1000.0) < 1e-6 && fabs(v.z - 100.0) < 1e-6,
+	        "ecef_to_geodetic(): Inside the evolute, 1 km from the"
+	        " center");
+
+	enuframe_init(&f, &WGS84, 60.0, 10.0, 50.0);
+	lat[0] = 60.0;
+	lon[0] = 10.0;
+	h[0] = 150.0;
+	lat[1] = 60.001;
+	lon[1] = 10.0;
+	h[1] = 50.0;
+	geodetic_to_ecef_batch(&WGS84, lat, lon, h, 2, x, y, z);
+	ecef_to_enu_batch(&f, x, y, z, 2, lat, lon, h);
+	OK_TRUE(fabs(lat[0]) < 1e-8 && fabs(lon[0]) < 1e-8
+	        && fabs(h[0] - 100.0) < 1e-8,
+	        "ecef_to_enu_batch(): 100 m straight up");
+	OK_TRUE(fabs(lat[1]) < 1e-8 && fabs(lon[1] - 111.4135) < 1e-3
+	        && h[1] < 0.0 && h[1] > -0.01,
+	        "ecef_to_enu_batch(): 0.001° north is north and a bit down");
+	enu_to_ecef_batch(&f, lat, lon, h, 2, lat, lon, h);
+	OK_TRUE(fabs(lat[1] - x[1]) < 1e-8 && fabs(lon[1] - y[1]) < 1e-8
+	        && fabs(h[1] - z[1]) < 1e-8,
+	        "enu_to_ecef_batch() returns the original ECEF coordinates");
 }
 
 /*
- * chk_coor() - Tries to parse the coordinate in `s` with `parse_coordinate()` 
- * and tests that `parse_coordinate()` returns the expected values.
- * Returns nothing.
+ * test_utm() - Tests the transverse Mercator, UTM and MGRS functions. Returns 
+ * nothing.
  */
 
-static void chk_coor(const int linenum, const char *s, const int exp_ret,
-                     const double exp_lat, const double exp_lon)
+static void test_utm(void)
 {
-	double lat, lon;
-	int result;
-
-	result = parse_coordinate(s, true, &lat, &lon);
-	OK_EQUAL_L(result, exp_ret, linenum,
-	           "parse_coordinate(\"%s\"), expected to %s",
-	           s, exp_ret ? "fail" : "succeed");
-
-	if (result)
-		return;
-
-	OK_EQUAL_L(lat, exp_lat, linenum,
-	           "parse_coordinate(\"%s\"): lat is ok", s);
-	print_gotexp_double(lat, exp_lat);
-	OK_EQUAL_L(lon, exp_lon, linenum,
-	           "parse_coordinate(\"%s\"): lon is ok", s);
-	print_gotexp_double(lon, exp_lon);
+	const double lat[] = { 33.3, -33.8568, 60.0, 85.0, 0.0 };
+	const double lon[] = { 44.4, 151.2153, 10.0, 0.0, 9.0 };
+	struct tmerc tm;
+	double e[5], n[5], ne, nn, nlat, nlon, x1, y1, x2, y2, la, lo;
+	char buf[MGRS_MAX_LEN + 1];
+	int zone[5], z, i, equal = 0, roundtrip = 0, count = 0;
+
+	diag("Test UTM and MGRS functions");
+
+	OK_EQUAL(utm_zone(60.0, 2.9), 31, "utm_zone(): 60,2.9 is in zone 31");
+	OK_EQUAL(utm_zone(60.0, 5.3), 32, "utm_zone(): The Norway exception");
+	OK_EQUAL(utm_zone(78.0, 8.0), 31, "utm_zone(): Svalbard, zone 31");
+	OK_EQUAL(utm_zone(78.0, 10.0), 33, "utm_zone(): Svalbard, zone 33");
+	OK_EQUAL(utm_zone(0.0, 180.0), 1, "utm_zone(): 0,180 is in zone 1");
+	OK_EQUAL(utm_zone(-80.0, 0.0), 31, "utm_zone(): -80 is included");
+	OK_EQUAL(utm_zone(84.1, 0.0), 0, "utm_zone(): North of 84");
+	OK_EQUAL(utm_zone(0.0, 180.1), 0, "utm_zone(): Invalid longitude");
+	OK_EQUAL(utm_band(84.0), 'X', "utm_band(): 84 is in band X");
+	OK_EQUAL(utm_band(-80.0), 'C', "utm_band(): -80 is in band C");
+	OK_EQUAL(utm_band(0.0), 'N', "utm_band(): 0 is in band N");
+	OK_EQUAL(utm_band(-80.1), 0, "utm_band(): South of -80");
+
+	utm_init(&tm, &WGS84);
+	OK_SUCCESS(utm_forward(&tm, 33.3, 44.4, &z, &ne, &nn),
+	           "utm_forward(): 33.3,44.4");
+	OK_TRUE(z == 38 && fabs(ne - 444140.5449) < 1e-4
+	        && fabs(nn - 3684706.3556) < 1e-4,
+	        "utm_forward(): 33.3,44.4 is 38 444140.54 3684706.36");
+	OK_SUCCESS(utm_forward(&tm, 0.0, 9.0, &z, &ne, &nn),
+	           "utm_forward(): 0,9");
+	OK_TRUE(z == 32 && ne == 500000.0 && nn == 0.0,
+	        "utm_forward(): 0,9 is the origin of zone 32");
+	OK_FAILURE(utm_forward(&tm, 85.0, 0.0, &z, &ne, &nn),
+	           "utm_forward(): 85,0 is outside the UTM area");
+	OK_FAILURE(utm_reverse(&tm, 61, 1, 500000.0, 0.0, &la, &lo),
+	           "utm_reverse(): Zone 61 is invalid");
+
+	OK_EQUAL(utm_forward_batch(&tm, lat, lon, 5, zone, e, n), 1,
+	         "utm_forward_batch(): One position is outside");
+	for (i = 0; i < 5; i++) {
+		if (utm_forward(&tm, lat[i], lon[i], &z, &ne, &nn))
+			equal += !zone[i] && isnan(e[i]) && isnan(n[i]);
+		else
+			equal += z == zone[i] && ne == e[i] && nn == n[i];
+	}
+	OK_EQUAL(equal, 5, "utm_forward_batch() matches utm_forward()");
+	utm_reverse(&tm, zone[1], 0, e[1], n[1], &la, &lo);
+	OK_TRUE(fabs(la - lat[1]) < 1e-13 && fabs(lo - lon[1]) < 1e-13,
+	        "utm_reverse(): Southern hemisphere");
+
+	equal = 0;
+	for (la = -80.0; la <= 84.0; la += 4.1) {
+		for (lo = -3.5; lo <= 3.5; lo += 0.7) {
+			tmerc_forward(&tm, 0.0, la, lo, &x1, &y1);
+			tmerc_forward(&tm, 0.0, la, -lo, &x2, &y2);
+			equal += x1 == -x2 && y1 == y2;
+			tmerc_forward(&tm, 9.0, la, 9.0 + lo, &x1, &y1);
+			tmerc_reverse(&tm, 9.0, x1, y1, &nlat, &nlon);
+			roundtrip += fabs(nlat - la) < 1e-13
+			             && fabs(nlon - 9.0 - lo) < 1e-13;
+			count++;
+		}
+	}
+	OK_EQUAL(equal, count, "tmerc_forward() is symmetric around the"
+	         " central meridian");
+	OK_EQUAL(roundtrip, count, "tmerc_reverse() returns the original"
+	         " positions");
+	tmerc_forward(&tm, 177.0, 10.0, -177.0, &x1, &y1);
+	tmerc_forward(&tm, 0.0, 10.0, 6.0, &x2, &y2);
+	OK_TRUE(fabs(x1 - x2) < 1e-9 && fabs(y1 - y2) < 1e-9,
+	        "tmerc_forward(): Across the antimeridian");
+	tmerc_forward(&tm, 0.0, 90.0, 0.0, &x1, &y1);
+	tmerc_reverse(&tm, 0.0, x1, y1, &nlat, &nlon);
+	OK_TRUE(nlat == 90.0 && nlon == 0.0, "tmerc_reverse(): North Pole");
+	tmerc_init(&tm, 6378137.0, 0.0, 1.0);
+	tmerc_forward(&tm, 0.0, 0.0, 1.0, &x1, &y1);
+	OK_TRUE(fabs(x1 - 6378137.0 * atanh(sin(M_PI / 180.0))) < 1e-6
+	        && y1 == 0.0, "tmerc_forward(): Sphere");
+
+	OK_SUCCESS(mgrs_encode(33.3, 38, 444140.5449, 3684706.3556, 5, buf),
+	           "mgrs_encode(): 33.3,44.4");
+	OK_STRCMP(buf, "38SMB4414084706", "mgrs_encode(): 1 m precision");
+	mgrs_encode(33.3, 38, 444140.5449, 3684706.3556, 2, buf);
+	OK_STRCMP(buf, "38SMB4484", "mgrs_encode(): 1 km precision");
+	mgrs_encode(33.3, 38, 444140.5449, 3684706.3556, 0, buf);
+	OK_STRCMP(buf, "38SMB", "mgrs_encode(): 100 km precision");
+	mgrs_encode(lat[2], zone[2], e[2], n[2], 5, buf);
+	OK_STRCMP(buf, "32VNM5577651832", "mgrs_encode(): Even zone");
+	mgrs_encode(lat[1], zone[1], e[1], n[1], 5, buf);
+	OK_STRCMP(buf, "56HLH3490052288", "mgrs_encode(): Southern"
+	          " hemisphere");
+	OK_FAILURE(mgrs_encode(33.3, 38, 444140.0, 3684706.0, 6, buf),
+	           "mgrs_encode(): 6 digits");
+	OK_FAILURE(mgrs_encode(33.3, 0, 444140.0, 3684706.0, 5, buf),
+	           "mgrs_encode(): Zone 0");
+	OK_FAILURE(mgrs_encode(85.0, 38, 444140.0, 3684706.0, 5, buf),
+	           "mgrs_encode(): Latitude outside the UTM area");
+	OK_FAILURE(mgrs_encode(33.3, 38, 50000.0, 3684706.0, 5, buf),
+	           "mgrs_encode(): Easting out of range");
 }
 
 /*
- * test_parse_coordinate() - Various tests for `parse_coordinate()`. Returns 
- * nothing.
+ * test_centroid() - Tests the centroid_*() functions. Returns nothing.
  */
 
-static void test_parse_coordinate(void) {
-	diag("Test parse_coordinate()");
-
-#define chk_coor(s, exp_ret, exp_lat, exp_lon)  \
-	chk_coor(__LINE__, (s), (exp_ret), (exp_lat), (exp_lon))
-
-	chk_coor("12.34,56.78", 0, 12.34, 56.78);
-	chk_coor("12.34", 1, 0, 0);
-	chk_coor("", 1, 0, 0);
-	chk_coor("995.456,,456.345", 1, 0, 0);
-	chk_coor("56,78", 0, 56, 78);
-	chk_coor("-56,-78", 0, -56, -78);
-	chk_coor("-56.234,-78.345", 0, -56.234, -78.345);
-	chk_coor(" -56.234,-78.345", 0, -56.234, -78.345);
-	chk_coor("-56.234, -78.345", 0, -56.234, -78.345);
-	chk_coor("56.2r4,-78.345", 1, 0, 0);
-	chk_coor("+56.24,-78.345", 0, 56.24, -78.345);
-	chk_coor(NULL, 1, 0, 0);
+static void test_centroid(void)
+{
+	struct centroid c;
+	double lat, lon, res, disp;
+	int i;
 
-#undef chk_coor
+	diag("Test centroid functions");
+
+	centroid_init(&c);
+	OK_FAILURE(centroid_result(&c, &lat, &lon, &res, &disp),
+	           "centroid: Undefined without positions");
+
+	centroid_add(&c, 60.0, 10.0, 1.0);
+	OK_SUCCESS(centroid_result(&c, &lat, &lon, &res, &disp),
+	           "centroid: One position");
+	OK_TRUE(fabs(lat - 60.0) < 1e-12 && fabs(lon - 10.0) < 1e-12
+	        && res == 1.0
+	        && disp == 0.0, "centroid: One position is its own centroid");
+
+	/* Two positions 1.11 m apart, the dispersion is half the distance */
+	centroid_add(&c, 60.00001, 10.0, 1.0);
+	OK_SUCCESS(centroid_result(&c, &lat, &lon, &res, &disp),
+	           "centroid: Two positions");
+	OK_TRUE(fabs(lat - 60.000005) < 1e-12 && fabs(lon - 10.0) < 1e-12,
+	        "centroid: The centroid is between the positions");
+	OK_TRUE(fabs(disp * EARTH_RADIUS
+	             - haversine(60.0, 10.0, 60.00001, 10.0) / 2.0) < 1e-7,
+	        "centroid: The dispersion of two close positions is accurate");
+
+	/* The weighted centroid is about 3/4 of the way to the second one */
+	centroid_init(&c);
+	centroid_add(&c, 0.0, 10.0, 1.0);
+	centroid_add(&c, 0.0, 11.0, 3.0);
+	centroid_add(&c, 45.0, 45.0, 0.0);
+	OK_SUCCESS(centroid_result(&c, &lat, &lon, &res, &disp),
+	           "centroid: Weighted positions");
+	OK_TRUE(fabs(lat) < 1e-12 && fabs(lon - 10.750004759737802) < 1e-12,
+	        "centroid: The weighted centroid is correct");
+	OK_EQUAL(c.count, 3, "centroid: Positions with weight 0 are counted");
+
+	/* Positions evenly spread along the equator */
+	centroid_init(&c);
+	for (i = 0; i < 36; i++)
+		centroid_add(&c, 0.0, (double)i * 10.0 - 180.0, 1.0);
+	OK_FAILURE(centroid_result(&c, &lat, &lon, &res, &disp),
+	           "centroid: Undefined for positions around the equator");
+	OK_TRUE(res < 1e-9, "centroid: The mean vector is close to zero");
+
+	centroid_init(&c);
+	centroid_add(&c, 1.0, 2.0, 0.0);
+	OK_FAILURE(centroid_result(&c, &lat, &lon, &res, &disp),
+	           "centroid: Undefined with total weight 0");
 }
 
-/******************************************************************************
-                           Test the executable file
-******************************************************************************/
+/*
+ * test_polyarea() - Tests the polyarea_*() functions. Returns nothing.
+ */
 
-                         /****** Option tests ******/
+static void test_polyarea(void)
+{
+	struct polyarea pa;
+	double area, perim, area2, perim2;
+	int i;
 
-                             /*** --valgrind ***/
+	diag("Test polyarea functions");
+
+	/* The Equator, counterclockwise seen from the North Pole */
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	for (i = 0; i < 4; i++)
+		polyarea_add(&pa, 0.0, (double)i * 90.0 - 180.0);
+	polyarea_close(&pa);
+	OK_SUCCESS(polyarea_result(&pa, &area, &perim),
+	           "polyarea: The Equator");
+	OK_TRUE(fabs(area / (2.0 * M_PI * EARTH_RADIUS * EARTH_RADIUS) - 1.0)
+	        < 1e-14, "polyarea: The northern hemisphere");
+	OK_TRUE(fabs(perim - 2.0 * M_PI * EARTH_RADIUS) < 1e-6,
+	        "polyarea: The perimeter is the length of the Equator");
+	OK_EQUAL(pa.count, 4, "polyarea: 4 positions");
+	OK_EQUAL(pa.rings, 1, "polyarea: 1 ring");
+
+	/* Westwards, the area of a hemisphere is positive */
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	for (i = 0; i < 4; i++)
+		polyarea_add(&pa, 0.0, 180.0 - (double)i * 90.0);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area2, &perim2);
+	OK_TRUE(area2 == area, "polyarea: The Equator westwards");
+
+	polyarea_init(&pa, FRM_KARNEY, &WGS84);
+	for (i = 0; i < 4; i++)
+		polyarea_add(&pa, 0.0, (double)i * 90.0 - 180.0);
+	polyarea_close(&pa);
+	OK_SUCCESS(polyarea_result(&pa, &area, &perim),
+	           "polyarea: The Equator with FRM_KARNEY");
+	OK_TRUE(fabs(area - 255032810862044.25) < 1.0,
+	        "polyarea: Half the area of the WGS84 ellipsoid");
+	OK_TRUE(fabs(perim - 40075016.68557849) < 1e-4,
+	        "polyarea: The length of the Equator on the ellipsoid");
+
+	/* 1x1 degree squares in both directions and across the date line */
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	polyarea_add(&pa, 60.0, 0.0);
+	polyarea_add(&pa, 60.0, 1.0);
+	polyarea_add(&pa, 61.0, 1.0);
+	polyarea_add(&pa, 61.0, 0.0);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area, &perim);
+	OK_TRUE(fabs(area - 6088204459.05) < 0.01,
+	        "polyarea: Counterclockwise square is positive");
+
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	polyarea_add(&pa, 60.0, 179.5);
+	polyarea_add(&pa, 61.0, 179.5);
+	polyarea_add(&pa, 61.0, -179.5);
+	polyarea_add(&pa, 60.0, -179.5);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area2, &perim2);
+	OK_TRUE(fabs(area + area2) < 1e-3 && fabs(perim - perim2) < 1e-6,
+	        "polyarea: Clockwise square across the date line is negative");
+
+	/* A ring around the North Pole, and the same ring with a hole */
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	for (i = 0; i < 4; i++)
+		polyarea_add(&pa, 80.0, (double)i * 90.0 - 180.0);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area, &perim);
+	OK_TRUE(fabs(area - 2485422814483.3) < 1.0,
+	        "polyarea: Ring around the North Pole");
+	polyarea_add(&pa, 85.0, 0.0);
+	polyarea_add(&pa, 85.0, -90.0);
+	polyarea_add(&pa, 85.0, 180.0);
+	polyarea_add(&pa, 85.0, 90.0);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area2, &perim2);
+	OK_TRUE(area2 > 0.0 && area2 < area && perim2 > perim,
+	        "polyarea: Clockwise hole is subtracted");
+	OK_EQUAL(pa.count, 8, "polyarea: 8 positions in 2 rings");
+	OK_EQUAL(pa.rings, 2, "polyarea: 2 rings");
+
+	/* The longitude of a vertex at the pole doesn't matter */
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	polyarea_add(&pa, 89.0, 0.0);
+	polyarea_add(&pa, 89.0, 90.0);
+	polyarea_add(&pa, 90.0, 123.0);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area, &perim);
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	polyarea_add(&pa, 89.0, 0.0);
+	polyarea_add(&pa, 89.0, 90.0);
+	polyarea_add(&pa, 90.0, -45.0);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area2, &perim2);
+	OK_TRUE(fabs(area - area2) < 0.1 && fabs(perim - perim2) < 1e-6,
+	        "polyarea: Vertex at the North Pole");
+
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	polyarea_close(&pa);
+	polyarea_add(&pa, 1.0, 2.0);
+	polyarea_add(&pa, 3.0, 4.0);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area, &perim);
+	OK_TRUE(area == 0.0 && fabs(perim - 2.0 * haversine(1.0, 2.0, 3.0, 4.0))
+	        < 1e-6, "polyarea: Ring with 2 positions has no area");
+	OK_EQUAL(pa.rings, 1, "polyarea: Empty rings aren't counted");
+
+	polyarea_init(&pa, FRM_KARNEY, &WGS84);
+	polyarea_add(&pa, 37.0, 7.0);
+	polyarea_add(&pa, -37.0, -173.0);
+	polyarea_close(&pa);
+	OK_FAILURE(polyarea_result(&pa, &area, &perim),
+	           "polyarea: Karney fails with antipodal positions");
+}
 
 /*
- * test_valgrind_option() - Tests the --valgrind command line option. Returns 
- * nothing.
+ * chk_rand_pos() - Used by test_rand_pos(). Executes rand_pos() with the 
+ * values in `coor`, `maxdist` and `mindist` and checks that they're in the 
+ * range defined by `exp_maxdist` and `exp_mindist`. Returns nothing.
  */
 
-static void test_valgrind_option(const struct Options *o)
+static void chk_rand_pos(const int linenum, const char *coor,
+                         const double maxdist, const double mindist,
+                         const double exp_maxdist, const double exp_mindist)
 {
-	struct streams ss;
-
-	assert(o);
-	diag("Test --valgrind");
-
-	if (o->valgrind) {
-		struct Options mod_opt = *o; /* gncov */
+	int errcount = 0, maxtests = 20;
+	unsigned long l, numloop = 1e+4;
+	double r_exp_max = round(exp_maxdist), r_exp_min = round(exp_mindist);
 
-		mod_opt.valgrind = false; /* gncov */
-		streams_init(&ss); /* gncov */
-		streams_exec(&mod_opt, &ss, chp{ "valgrind", /* gncov */
-		                                 "--version", NULL });
-		if (!strstr(ss.out.buf, "valgrind-")) { /* gncov */
-			OK_ERROR("Valgrind is not installed," /* gncov */
-			         " disabling Valgrind checks");
-			set_opt_valgrind(false); /* gncov */
-		} else {
-			OK_SUCCESS(0, "Valgrind is installed"); /* gncov */
+	for (l = 0; l < numloop; l++) {
+		double clat = 1000.0, clon = 1000.0, rlat, rlon, dist, r_dist;
+		if (coor && parse_coordinate(coor, true, &clat, &clon)) {
+			failed_ok("parse_coordinate()"); /* gncov */
+			diag("test %d: coor = \"%s\"", /* gncov */
+			     testnum, coor);
+			return; /* gncov */
+		}
+		rand_pos(&rlat, &rlon, clat, clon, maxdist, mindist);
+		if (fabs(rlat) > 90.0) {
+			OK_ERROR_L(linenum, /* gncov */
+			           "rand_pos(): Coordinate %lu:"
+			           " lat is outside [-90,90] range,"
+			           " lat = %.15f", l, rlat);
+			errcount++; /* gncov */
+		}
+		if (fabs(rlon) > 180.0) {
+			OK_ERROR_L(linenum, /* gncov */
+			           "rand_pos(): Coordinate %lu:"
+			           " lon is outside [-180,180] range,"
+			           " lon = %.15f", l, rlon);
+			errcount++; /* gncov */
+		}
+		if (errcount >= maxtests) {
+			diag("Aborting rand_pos() range test after" /* gncov */
+			     " %d errors", maxtests);
+			break; /* gncov */
+		}
+		if (!coor)
+			continue;
+		dist = haversine(clat, clon, rlat, rlon);
+		r_dist = round(dist);
+		if (r_dist < r_exp_min || r_dist > r_exp_max) {
+			errcount <= maxtests
+			? OK_ERROR_L(linenum, /* gncov */
+			             "randpos out of range (%.0f"
+			             " to %.0f m), center = %f,%f randpos ="
+			             " %f,%f dist = %f",
+			             exp_mindist, exp_maxdist, clat, clon,
+			             rlat, rlon, dist)
+			: 1; /* gncov */
+			errcount++; /* gncov */
 		}
-		streams_free(&ss); /* gncov */
 	}
-
-	sc((chp{ execname, "--valgrind", "-h", NULL }),
-	   "Show this",
-	   "",
-	   EXIT_SUCCESS,
-	   "--valgrind -h");
+	OK_EQUAL_L(errcount, 0, linenum,
+	           "rand_pos(): All %lu coordinates %.0f-%.0f m are"
+	           " in range, failed = %lu (%f%%)",
+	           numloop, exp_mindist, exp_maxdist, errcount,
+	           100.0 * (double)errcount / (double)numloop);
 }
 
-                          /*** Standard options ***/
-
 /*
- * test_standard_options() - Tests the various generic options available in 
- * most programs. Returns nothing.
+ * test_rand_pos() - Tests the rand_pos() function. Returns nothing.
  */
 
-static void test_standard_options(void)
+static void test_rand_pos(void)
 {
-	char *s;
+	double MED = MAX_EARTH_DISTANCE;
 
-	diag("Test standard options");
+	diag("Test rand_pos()");
 
-	diag("Test -h/--help");
-	sc((chp{ execname, "-h", NULL }),
-	   "  Show this help",
-	   "",
-	   EXIT_SUCCESS,
-	   "-h");
-	sc((chp{ execname, "--help", NULL }),
-	   "  Show this help",
-	   "",
-	   EXIT_SUCCESS,
-	   "--help");
+#define chk_rand_pos(coor, maxdist, mindist, exp_maxdist, exp_mindist)  \
+        chk_rand_pos(__LINE__, (coor), (maxdist), (mindist), (exp_maxdist), \
+                     (exp_mindist))
 
-	diag("Test -v/--verbose");
-	sc((chp{ execname, "-h", "--verbose", NULL }),
-	   "  Show this help",
-	   "",
-	   EXIT_SUCCESS,
-	   "-hv: Help text is displayed");
-	sc((chp{ execname, "-hv", NULL }),
-	   EXEC_VERSION,
-	   "",
-	   EXIT_SUCCESS,
-	   "-hv: Version number is printed along with the help text");
-	sc((chp{ execname, "-vvv", "--verbose", "--help", NULL }),
-	   "  Show this help",
-	   EXECSTR ": main(): Using verbose level 4\n",
-	   EXIT_SUCCESS,
-	   "-vvv --verbose: Using correct verbose level");
-	sc((chp{ execname, "-vvvvq", "-v", "--verbose", "--help", NULL }),
-	   "  Show this help",
-	   EXECSTR ": main(): Using verbose level 5\n",
-	   EXIT_SUCCESS,
-	   "--verbose: One -q reduces the verbosity level");
+	chk_rand_pos("-3.14,-123.45", 1e+20, 1e+20, MED, MED);
+	chk_rand_pos("-3.14,-123.45", 1e+20, 1e+7, MED, 1e+7);
+	chk_rand_pos("-3.14,-123.45", 1e+7 + 1, 1e+20, MED, 1e+7 + 1);
+	chk_rand_pos("-55.91,-107.32", 0, 2e+7, MED, 2e+7);
+	chk_rand_pos("-59.2105,44.47485", 1000.0, 1000.0, 1000.0, 1000.0);
+	chk_rand_pos("-90,0", 10.0, 0.0, 10.0, 0.0);
+	chk_rand_pos("12,34", 0.1, 0.0, 0.0, 0.0);
+	chk_rand_pos("12,34", 1.0, 0.0, 1.0, 0.0);
+	chk_rand_pos("12,34", 10.0, 20.0, 20.0, 10.0);
+	chk_rand_pos("65,7", 2000.0, 1000.0, 2000.0, 1000.0);
+	chk_rand_pos("90,0", 0.0, 1e+6, MED, 1e+6);
+	chk_rand_pos(NULL, 0.0, 0.0, MED, 0.0);
 
-	diag("Test --version");
-	s = allocstr("%s %s (%s)\n", execname, EXEC_VERSION, EXEC_DATE);
-	if (s) {
-		sc((chp{ execname, "--version", NULL }),
-		   s,
-		   "",
-		   EXIT_SUCCESS,
-		   "--version");
-		free(s);
-	} else {
-		failed_ok("allocstr()"); /* gncov */
+#undef chk_rand_pos
+}
+
+/*
+ * test_sepindex() - Tests the sepindex_*() functions. Returns nothing.
+ */
+
+static void test_sepindex(void)
+{
+	struct sepindex si;
+	const double sep = 1000.0 / EARTH_RADIUS;
+	unsigned int i, j, added = 0;
+
+	diag("Test sepindex functions");
+
+	OK_SUCCESS(sepindex_init(&si, sep), "sepindex_init()");
+	OK_EQUAL(sepindex_add(&si, 60.0, 10.0), 0, "sepindex: first position");
+	OK_EQUAL(sepindex_add(&si, 60.0, 10.0), 1,
+	         "sepindex: same position again");
+	OK_EQUAL(sepindex_add(&si, 60.008, 10.0), 1, "sepindex: 890 m north");
+	OK_EQUAL(sepindex_add(&si, 60.0091, 10.0), 0,
+	         "sepindex: 1012 m north");
+	OK_EQUAL(sepindex_add(&si, 60.0, 10.0185), 0, "sepindex: 1028 m east");
+	sepindex_free(&si);
+
+	OK_SUCCESS(sepindex_init(&si, sep), "sepindex_init() again");
+	for (i = 0; i < 200; i++) {
+		for (j = 0; j < 200; j++) {
+			if (!sepindex_add(&si, i * 0.0045, j * 0.0045))
+				added++;
+		}
 	}
-	tc((chp{ execname, "--version", "-q", NULL }),
-	   EXEC_VERSION "\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--version with -q shows only the version number");
+	OK_EQUAL(si.n, added, "sepindex: n matches the added positions");
+	OK_TRUE(added > 5000 && added <= 10000,
+	        "sepindex: %u of 40000 positions in a 500 m grid are added",
+	        added);
+	OK_TRUE(si.numcells > SEPINDEX_MIN_CELLS,
+	        "sepindex: the hash table has grown to %zu cells",
+	        si.numcells);
+	sepindex_free(&si);
+
+	OK_SUCCESS(sepindex_init(&si, 4.0), "sepindex_init() with 4 radians");
+	OK_EQUAL(sepindex_add(&si, 0.0, 0.0), 0, "sepindex: first of 2");
+	OK_EQUAL(sepindex_add(&si, 0.0, 90.0), 1,
+	         "sepindex: 90° away is too close with separation > π");
+	OK_EQUAL(sepindex_add(&si, 0.0, 180.0), 0,
+	         "sepindex: separation is limited to π");
+	sepindex_free(&si);
+}
 
-	diag("Test --license");
-	sc((chp{ execname, "--license", NULL }),
-	   "GNU General Public License",
-	   "",
-	   EXIT_SUCCESS,
-	   "--license: It's GPL");
-	sc((chp{ execname, "--license", NULL }),
-	   "either version 2 of the License",
-	   "",
-	   EXIT_SUCCESS,
-	   "--license: It's version 2 of the GPL");
+/*
+ * test_randpoly() - Tests randpoly_*() and rand_bbox(). Returns nothing.
+ */
 
-	diag("Unknown option");
-	sc((chp{ execname, "--gurgle", NULL }),
-	   "",
-	   OPTION_ERROR_STR,
-	   EXIT_FAILURE,
-	   "Unknown option: \"Option error\" message is printed");
+static void test_randpoly(void)
+{
+	const double comb[][2] = {
+		{ 0, 0 }, { 0, 10 }, { 5, 10 }, { 5, 8 }, { 2, 8 }, { 2, 6 },
+		{ 5, 6 }, { 5, 4 }, { 2, 4 }, { 2, 2 }, { 5, 2 }, { 5, 0 }
+	};
+	struct polygon pg[3];
+	struct polyarea pa;
+	struct randpoly rp;
+	double area, perimeter, lat, lon, clat[12], clon[12];
+	unsigned int i;
+	int inside = 0, north = 0;
+
+	diag("Test randpoly functions");
+
+	OK_SUCCESS(make_polygon(&pg[0], "0,0 0,40 20,40 20,20 45,20 45,0",
+	                        false), "randpoly: outer polygon");
+	OK_SUCCESS(make_polygon(&pg[1], "10,5 30,5 30,15 10,15", false),
+	           "randpoly: hole");
+	OK_SUCCESS(make_polygon(&pg[2], "30,0 30,20 45,20 45,0", true),
+	           "randpoly: north part");
+	OK_SUCCESS(randpoly_init(&rp, pg, 2), "randpoly_init()");
+	OK_EQUAL(rp.numtris, 4, "randpoly: 4 triangles");
+	OK_EQUAL(rp.numholes, 1, "randpoly: 1 hole");
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	polyarea_add(&pa, 0, 0);
+	polyarea_add(&pa, 0, 40);
+	polyarea_add(&pa, 20, 40);
+	polyarea_add(&pa, 20, 20);
+	polyarea_add(&pa, 45, 20);
+	polyarea_add(&pa, 45, 0);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area, &perimeter);
+	OK_TRUE(fabs(rp.area * EARTH_RADIUS * EARTH_RADIUS / area - 1.0)
+	        < 1e-12, "randpoly: The triangles have the area of the"
+	        " polygon");
+
+	srand48(1);
+	for (i = 0; i < 10000; i++) {
+		struct vec3 v;
+
+		randpoly_pos(&rp, &lat, &lon);
+		pos_to_vec3(lat, lon, &v);
+		inside += polygon_contains(&pg[0], &v)
+		          && !polygon_contains(&pg[1], &v);
+		north += polygon_contains(&pg[2], &v);
+	}
+	OK_EQUAL(inside, 10000, "randpoly: All positions are inside the"
+	         " polygon and outside the hole");
+	OK_TRUE(north > 2100 && north < 2500,
+	        "randpoly: %d of 10000 positions in the north part, expected"
+	        " about 2318", north);
+	randpoly_free(&rp);
+	OK_NULL(rp.tris, "randpoly_free() sets tris to NULL");
+	polygon_free(&pg[0]);
+
+	OK_SUCCESS(make_polygon(&pg[0], "0,0 0,10 0,20 0,30", false),
+	           "randpoly: positions on a line");
+	OK_SUCCESS(randpoly_init(&rp, pg, 1), "randpoly_init() on a line");
+	OK_TRUE(rp.area == 0.0, "randpoly: A line has no area");
+	randpoly_free(&rp);
+	polygon_free(&pg[0]);
+
+	for (i = 0; i < 12; i++) {
+		clat[i] = comb[i][0];
+		clon[i] = comb[i][1];
+	}
+	OK_SUCCESS(polygon_init(&pg[0], clat, clon, 12),
+	           "randpoly: comb polygon");
+	polyarea_init(&pa, FRM_HAVERSINE, &WGS84);
+	for (i = 0; i < 12; i++)
+		polyarea_add(&pa, clat[i], clon[i]);
+	polyarea_close(&pa);
+	polyarea_result(&pa, &area, &perimeter);
+	OK_SUCCESS(randpoly_init(&rp, pg, 1), "randpoly_init() on a comb");
+	OK_EQUAL(rp.numtris, 10, "randpoly: The comb has 10 triangles");
+	OK_TRUE(fabs(rp.area * EARTH_RADIUS * EARTH_RADIUS / area - 1.0)
+	        < 1e-12, "randpoly: The comb triangles don't overlap");
+	randpoly_free(&rp);
+
+	inside = 0;
+	for (i = 0; i < 1000; i++) {
+		rand_bbox(&lat, &lon, 10.0, 170.0, -10.0, -170.0);
+		inside += lat >= -10.0 && lat <= 10.0
+		          && (lon >= 170.0 || lon <= -170.0);
+	}
+	OK_EQUAL(inside, 1000, "rand_bbox(): Positions across the"
+	         " antimeridian");
+	polygon_free(&pg[2]);
+	polygon_free(&pg[1]);
+	polygon_free(&pg[0]);
 }
 
-                             /*** -F/--format ***/
+/*
+ * test_fibgrid() - Tests the fibgrid_*() functions. Returns nothing.
+ */
+
+static void test_fibgrid(void)
+{
+	struct fibgrid g;
+	const double n = fibgrid_count(10000.0 / EARTH_RADIUS,
+	                               500.0 / EARTH_RADIUS);
+	double lat, lon, lat2, lon2, maxdist = 0.0;
+	unsigned long i, north = 0;
+
+	diag("Test fibgrid functions");
+
+	OK_EQUAL(fibgrid_count(M_PI, 0.1), 1451.0, "fibgrid_count(π, 0.1)");
+	OK_EQUAL(fibgrid_count(M_PI, 4.0), 1.0,
+	         "fibgrid_count(): At least 1 position");
+	OK_EQUAL(fibgrid_count(4.0, 0.1), fibgrid_count(M_PI, 0.1),
+	         "fibgrid_count(): The radius is limited to π");
+	OK_EQUAL(fibgrid_count(1000.0 / EARTH_RADIUS, 300.0 / EARTH_RADIUS),
+	         40.0, "fibgrid_count(): 300 m spacing within 1 km");
+
+	/* The whole Earth, every position has the same share of the area */
+	fibgrid_init(&g, 90.0, 0.0, M_PI, 1000);
+	for (i = 0; i < g.n; i++) {
+		fibgrid_point(&g, i, &lat, &lon);
+		if (lat > 0.0)
+			north++;
+	}
+	OK_EQUAL(north, 500, "fibgrid: Half the positions are in the north");
+	fibgrid_point(&g, 0, &lat, &lon);
+	fibgrid_point(&g, 999, &lat2, &lon2);
+	OK_TRUE(fabs(lat + lat2) < 1e-12, "fibgrid: The first and last"
+	        " positions are symmetric");
+	OK_TRUE(fabs(lat - asin(0.999) * 180.0 / M_PI) < 1e-12,
+	        "fibgrid: The first position is at the equal-area height");
+
+	/* A cap with the radius 10 km */
+	fibgrid_init(&g, -33.9, 18.4, 10000.0 / EARTH_RADIUS, (unsigned long)n);
+	OK_EQUAL(g.n, 1451, "fibgrid: 1451 positions in the cap");
+	for (i = 0; i < g.n; i++) {
+		fibgrid_point(&g, i, &lat, &lon);
+		maxdist = fmax(maxdist, haversine(-33.9, 18.4, lat, lon));
+	}
+	OK_TRUE(maxdist < 10000.0 && maxdist > 9990.0,
+	        "fibgrid: All positions are inside the cap");
+	fibgrid_point(&g, 1000, &lat, &lon);
+	fibgrid_init(&g, -33.9, 18.4, 10000.0 / EARTH_RADIUS, 1451);
+	fibgrid_point(&g, 1000, &lat2, &lon2);
+	OK_TRUE(lat == lat2 && lon == lon2,
+	        "fibgrid: Positions are calculated independently");
+
+	fibgrid_init(&g, -33.9, 18.4, 10000.0 / EARTH_RADIUS, 1);
+	fibgrid_point(&g, 0, &lat, &lon);
+	OK_TRUE(fabs(lat + 33.9) < 1e-12 && fabs(lon - 18.4) < 1e-12,
+	        "fibgrid: A single position is at the center");
+}
 
 /*
- * test_format_option() - Tests the -F/--format option. Returns nothing.
+ * chk_geohash() - Used by test_geohash(). Verifies that geohash_encode() 
+ * creates the geohash `exp` with the same length from the position `coor`, 
+ * and that geohash_decode() returns a cell around `coor`. Returns nothing.
  */
 
-static void test_format_option(void)
+static void chk_geohash(const int linenum, const char *coor, const char *exp)
 {
-	diag("Test -F/--format");
-	sc((chp{ execname, "-vvvv", "-F", "FoRmAt", NULL }),
-	   "",
-	   EXECSTR ": setup_options(): o.format = \"FoRmAt\"\n",
-	   EXIT_FAILURE,
-	   "-vvvv -F FoRmAt: o.format is correct");
-	sc((chp{ execname, "-vvvv", "--format", "FoRmAt", NULL }),
-	   "",
-	   EXECSTR ": setup_options(): o.format = \"FoRmAt\"\n",
-	   EXIT_FAILURE,
-	   "-vvvv --format FoRmAt: o.format is correct");
-	sc((chp{ execname, "-vvvv", "-F", "FoRmAt", NULL }),
-	   NULL,
-	   EXECSTR ": FoRmAt: Unknown output format\n",
-	   EXIT_FAILURE,
-	   "-vvvv -F FoRmAt: It says it's unknown");
-	tc((chp{ execname, "-vvvv", "-F", "", "lpos", "54,7", "12,22",
-	         "0.23", NULL }),
-	   "44.531328,12.14587\n",
-	   NULL,
-	   EXIT_SUCCESS,
-	   "-F with an empty argument");
+	char hash[GEOHASH_MAX_LEN + 1];
+	double lat, lon, clat, clon, lat_err, lon_err;
+
+	if (parse_coordinate(coor, true, &lat, &lon)) {
+		failed_ok("parse_coordinate()"); /* gncov */
+		return; /* gncov */
+	}
+	OK_SUCCESS_L(geohash_encode(lat, lon, strlen(exp), hash), linenum,
+	             "geohash_encode(%s, %zu)", coor, strlen(exp));
+	OK_STRCMP_L(hash, exp, linenum, "geohash_encode(%s) is %s", coor, exp);
+	OK_SUCCESS_L(geohash_decode(exp, &clat, &clon, &lat_err, &lon_err),
+	             linenum, "geohash_decode(\"%s\")", exp);
+	OK_TRUE_L(lat >= clat - lat_err && lat <= clat + lat_err
+	          && lon >= clon - lon_err && lon <= clon + lon_err,
+	          linenum, "%s is inside the cell of %s", coor, exp);
 }
 
-                           /*** -H/--haversine ***/
+/*
+ * chk_neighbour() - Used by test_geohash(). Verifies that geohash_neighbour() 
+ * of `hash` with the offsets `dlat` and `dlon` returns `exp_ret` and stores 
+ * `exp`. Returns nothing.
+ */
+
+static void chk_neighbour(const int linenum, const char *hash,
+                          const long dlat, const long dlon,
+                          const int exp_ret, const char *exp)
+{
+	char res[GEOHASH_MAX_LEN + 1] = "";
+
+	OK_EQUAL_L(geohash_neighbour(hash, dlat, dlon, res), exp_ret, linenum,
+	           "geohash_neighbour(\"%s\", %ld, %ld) returns %d",
+	           hash, dlat, dlon, exp_ret);
+	if (!exp_ret) {
+		OK_STRCMP_L(res, exp, linenum,
+		            "geohash_neighbour(\"%s\", %ld, %ld) is %s",
+		            hash, dlat, dlon, exp);
+	}
+}
 
 /*
- * test_haversine_option() - Tests the -H/--haversine option. Returns nothing.
+ * test_geohash() - Tests morton_encode(), morton_decode() and the geohash_*() 
+ * functions. Returns nothing.
  */
 
-static void test_haversine_option(void)
+static void test_geohash(void)
 {
-	diag("Test -H/--haversine");
+	char hash[GEOHASH_MAX_LEN + 1];
+	double lat, lon, lat_err, lon_err;
+	uint32_t x, y;
+
+	diag("Test geohash functions");
+
+	OK_EQUAL(morton_encode(0, 0), 0, "morton_encode(0, 0)");
+	OK_EQUAL(morton_encode(1, 0), 1, "morton_encode(1, 0)");
+	OK_EQUAL(morton_encode(0, 1), 2, "morton_encode(0, 1)");
+	OK_EQUAL(morton_encode(5, 3), 27, "morton_encode(5, 3)");
+	OK_TRUE(morton_encode(0xffffffff, 0xffffffff) == UINT64_MAX,
+	        "morton_encode() with all bits set");
+	morton_decode(0xa5a5a5a5a5a5a5a5ULL, &x, &y);
+	OK_TRUE(x == 0x3333 * 0x10001U && y == 0xcccc * 0x10001U,
+	        "morton_decode(0xa5a5a5a5a5a5a5a5)");
+	morton_decode(morton_encode(0x12345678, 0x9abcdef0), &x, &y);
+	OK_TRUE(x == 0x12345678 && y == 0x9abcdef0,
+	        "morton_decode() is the inverse of morton_encode()");
+
+#define chk_geohash(coor, exp)  chk_geohash(__LINE__, (coor), (exp))
+
+	chk_geohash("57.64911,10.40744", "u4pruydqqvj");
+	chk_geohash("42.6,-5.6", "ezs42");
+	chk_geohash("60.393,5.324", "u4");
+	chk_geohash("0,0", "s00000000000");
+	chk_geohash("-0.000001,-0.000001", "7zzzzzzzzz");
+	chk_geohash("90,180", "zzzzzzzzzzzz");
+	chk_geohash("-90,-180", "000000000000");
+	chk_geohash("-33.8567844,151.2152967", "r3gx2ux9gvcw");
+	chk_geohash("45,90", "y0000");
+	chk_geohash("45,-90", "f0000");
+
+#undef chk_geohash
+
+	OK_FAILURE(geohash_encode(0.0, 0.0, 0, hash), "geohash_encode() with"
+	           " length 0");
+	OK_FAILURE(geohash_encode(0.0, 0.0, GEOHASH_MAX_LEN + 1, hash),
+	           "geohash_encode() with too long length");
+	OK_FAILURE(geohash_encode(90.1, 0.0, 5, hash),
+	           "geohash_encode() with invalid latitude");
+	OK_FAILURE(geohash_encode(0.0, NAN, 5, hash),
+	           "geohash_encode() with NaN longitude");
+
+	OK_SUCCESS(geohash_decode("U4PRUYDQQVJ", &lat, &lon, NULL, NULL),
+	           "geohash_decode() with upper case and NULL errors");
+	OK_TRUE(fabs(lat - 57.64911) < 1e-5 && fabs(lon - 10.40744) < 1e-5,
+	        "geohash_decode(\"U4PRUYDQQVJ\") is close to the original");
+	OK_SUCCESS(geohash_decode("s", &lat, &lon, &lat_err, &lon_err),
+	           "geohash_decode(\"s\")");
+	OK_TRUE(lat == 22.5 && lon == 22.5 && lat_err == 22.5
+	        && lon_err == 22.5, "geohash_decode(\"s\") is 22.5,22.5");
+	OK_FAILURE(geohash_decode("", &lat, &lon, NULL, NULL),
+	           "geohash_decode() with empty string");
+	OK_FAILURE(geohash_decode("u4a", &lat, &lon, NULL, NULL),
+	           "geohash_decode() with invalid character");
+	OK_FAILURE(geohash_decode("u4\xc3\xa6", &lat, &lon, NULL, NULL),
+	           "geohash_decode() with non-ASCII character");
+	OK_FAILURE(geohash_decode("u4pruydqqvj80", &lat, &lon, NULL, NULL),
+	           "geohash_decode() with too long string");
+
+#define chk_neighbour(hash, dlat, dlon, exp_ret, exp)  \
+        chk_neighbour(__LINE__, (hash), (dlat), (dlon), (exp_ret), (exp))
+
+	chk_neighbour("u4pruyd", 1, 0, 0, "u4pruyf");
+	chk_neighbour("u4pruyd", -1, 0, 0, "u4pruy6");
+	chk_neighbour("u4pruyd", 0, 1, 0, "u4pruye");
+	chk_neighbour("u4pruyd", 0, -1, 0, "u4pruy9");
+	chk_neighbour("u4pruyd", 1, 1, 0, "u4pruyg");
+	chk_neighbour("u4pruyd", 0, 0, 0, "u4pruyd");
+	chk_neighbour("ezs42", 1, 0, 0, "ezs48");
+	chk_neighbour("ezs42", -1, -1, 0, "ezefp");
+	chk_neighbour("zzzz", 0, 1, 0, "bpbp");
+	chk_neighbour("b", 0, -1, 0, "z");
+	chk_neighbour("zzzz", 1, 0, 1, "");
+	chk_neighbour("0000", -1, 0, 1, "");
+	chk_neighbour("0000", 1, 0, 0, "0001");
+	chk_neighbour("u4a", 1, 0, 1, "");
+
+#undef chk_neighbour
+}
 
-	tc((chp{ execname, "-H", "dist", "13.389820,-71.453489",
-	         "-24.171099,-162.897613", NULL }),
-	   "10755873.395009\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "-H dist 13.389820,-71.453489 -24.171099,-162.897613");
+/*
+ * test_curve_keys() - Tests morton_key() and hilbert_key(). Returns nothing.
+ */
 
-	tc((chp{ execname, "--haversine", "dist", "-51.548124,19.706076",
-	         "-35.721304,13.064358", NULL }),
-	   "1837351.151434\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--haversine dist -51.548124,19.706076 -35.721304,13.064358");
+static void test_curve_keys(void)
+{
+	diag("Test morton_key() and hilbert_key()");
+
+	OK_TRUE(morton_key(-90.0, -180.0) == 0, "morton_key(-90, -180)");
+	OK_TRUE(morton_key(90.0, 180.0) == UINT64_MAX, "morton_key(90, 180)");
+	OK_TRUE(morton_key(0.0, 0.0) == 3ULL << 62, "morton_key(0, 0)");
+	OK_TRUE(morton_key(-45.0, -90.0) < morton_key(45.0, -90.0)
+	        && morton_key(45.0, -90.0) < morton_key(-45.0, 90.0)
+	        && morton_key(-45.0, 90.0) < morton_key(45.0, 90.0),
+	        "morton_key() visits the quadrants SW, NW, SE, NE");
+
+	OK_TRUE(hilbert_key(-90.0, -180.0) == 0, "hilbert_key(-90, -180)");
+	OK_TRUE(hilbert_key(-90.0, 180.0) == UINT64_MAX,
+	        "hilbert_key(-90, 180)");
+	OK_TRUE(hilbert_key(-45.0, -90.0) < hilbert_key(45.0, -90.0)
+	        && hilbert_key(45.0, -90.0) < hilbert_key(45.0, 90.0)
+	        && hilbert_key(45.0, 90.0) < hilbert_key(-45.0, 90.0),
+	        "hilbert_key() visits the quadrants SW, NW, NE, SE");
+	OK_TRUE(hilbert_key(-67.5, -135.0) < hilbert_key(-67.5, -45.0)
+	        && hilbert_key(-67.5, -45.0) < hilbert_key(-22.5, -45.0)
+	        && hilbert_key(-22.5, -45.0) < hilbert_key(-22.5, -135.0),
+	        "hilbert_key() visits the subquadrants of SW in the"
+	        " transposed order");
 }
 
-                             /*** -K/--karney ***/
+                                /*** gpx.c ***/
 
 /*
- * test_karney_option() - Tests the -K/--karney option. Returns nothing.
+ * chk_xmlesc() - Used by test_xml_escape_string(). Verifies that 
+ * xml_escape_string() converts the string `s` to `exp`. Returns nothing.
  */
 
-static void test_karney_option(void)
+static void chk_xmlesc(const int linenum, const char *s, const char *exp)
 {
-	diag("Test -K/--karney");
+	char *got;
 
-                                /*** bear ***/
+	assert(s);
+	assert(exp);
+	if (!s || !exp) {
+		OK_ERROR_L(linenum, "%s() received NULL", /* gncov */
+		                    __func__);
+		return; /* gncov */
+	}
 
-	tc((chp{ execname, "-K", "bear", "13.389820,-71.453489",
-	         "-24.171099,-162.897613", NULL }),
-	   "246.80807199\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "-K bear 13.389820,-71.453489 -24.171099,-162.897613");
+	got = xml_escape_string(s);
+	if (!got) {
+		failed_ok("xml_escape_string()"); /* gncov */
+		return; /* gncov */
+	}
+	OK_STRCMP_L(got, exp, linenum, "xml escape: \"%s\"", s);
+	free(got);
+}
 
-	tc((chp{ execname, "--karney", "bear", "-51.548124,19.706076",
-	         "-35.721304,13.064358", NULL }),
-	   "340.66682175\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--karney bear -51.548124,19.706076 -35.721304,13.064358");
+/*
+ * test_xml_escape_string() - Tests the xml_escape_string() function. Returns 
+ * nothing.
+ */
 
-	tc((chp{ execname, "-K", "bear", "12.34,56.789", "12.34,56.789",
-	         NULL }),
-	   "",
-	   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
-	   EXIT_FAILURE,
-	   "-K bear: Coincident points");
+static void test_xml_escape_string(void)
+{
+	diag("Test xml_escape_string()");
 
-	tc((chp{ execname, "-K", "bear", "37,7", "-37,-173", NULL }),
-	   "",
-	   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
-	   EXIT_FAILURE,
-	   "--karney bear: Antipodal points");
+#define chk_xmlesc(s, exp)  chk_xmlesc(__LINE__, (s), (exp))
+	chk_xmlesc("", "");
+	chk_xmlesc("&", "&amp;");
+	chk_xmlesc("<", "&lt;");
+	chk_xmlesc(">", "&gt;");
+	chk_xmlesc("\\", "\\");
+	chk_xmlesc("a&c", "a&amp;c");
+	chk_xmlesc("a<c", "a&lt;c");
+	chk_xmlesc("a>c", "a&gt;c");
+	chk_xmlesc("abc", "abc");
+#undef chk_xmlesc
+	OK_NULL(xml_escape_string(NULL), "xml_escape_string(NULL)");
+}
 
-                                /*** dist ***/
+/*
+ * test_gpx_wpt() - Tests the gpx_wpt() function. Returns nothing.
+ */
 
-	tc((chp{ execname, "-K", "dist", "13.389820,-71.453489",
-	         "-24.171099,-162.897613", NULL }),
-	   "10759030.9440929\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "-K dist 13.389820,-71.453489 -24.171099,-162.897613");
+static void test_gpx_wpt(void)
+{
+	char *p, /* String sent to gpx_wpt() */
+	     *c, /* Converted version of `p` */
+	     *e, /* Expected string from gpx_wpt() */
+	     *s; /* Result from gpx_wpt() */
 
-	tc((chp{ execname, "--karney", "dist", "-51.548124,19.706076",
-	         "-35.721304,13.064358", NULL }),
-	   "1836406.16934653\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--karney dist -51.548124,19.706076 -35.721304,13.064358");
+	diag("Test gpx_wpt()");
 
-	tc((chp{ execname, "-K", "dist", "12.34,56.789", "12.34,56.789",
-	         NULL }),
-	   "0.0\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "-K dist: Coincident points");
+	e = "  <wpt lat=\"12.34\" lon=\"56.78\">\n"
+	    "    <name>abc def</name>\n"
+	    "    <cmt>ghi jkl MN</cmt>\n"
+	    "  </wpt>\n";
+	s = gpx_wpt(12.34, 56.78, "abc def", "ghi jkl MN");
+	OK_STRCMP(no_null(s), e, "gpx_wpt() without special chars");
+	print_gotexp(s, e);
+	free(s);
 
-	tc((chp{ execname, "-K", "dist", "37,7", "-37,-173", NULL }),
-	   "",
-	   EXECSTR ": Formula did not converge, antipodal points\n",
-	   EXIT_FAILURE,
-	   "--karney dist: Antipodal points");
+	e = "  <wpt lat=\"12.34\" lon=\"56.78\">\n"
+	    "    <name>&amp;</name>\n"
+	    "    <cmt>&amp;</cmt>\n"
+	    "  </wpt>\n";
+	s = gpx_wpt(12.34, 56.78, "&", "&");
+	OK_STRCMP(no_null(s), e, "gpx_wpt() with ampersand");
+	print_gotexp(s, e);
+	free(s);
 
-	tc((chp{ execname, "--karney", "dist", "90.00001,0", "10,0",
-	         NULL }),
-	   "",
-	   EXECSTR ": 90.00001,0: Invalid coordinate\n",
-	   EXIT_FAILURE,
-	   "--karney dist: lat1 out of range (90.00001)");
+	e = "  <wpt lat=\"12.34\" lon=\"56.78\">\n"
+	    "    <name>&lt;</name>\n"
+	    "    <cmt>&lt;</cmt>\n"
+	    "  </wpt>\n";
+	s = gpx_wpt(12.34, 56.78, "<", "<");
+	OK_STRCMP(no_null(s), e, "gpx_wpt() with lt");
+	print_gotexp(s, e);
+	free(s);
 
-	tc((chp{ execname, "--karney", "dist", "-90.0000001,0", "10,0",
-	         NULL }),
-	   "",
-	   EXECSTR ": -90.0000001,0: Invalid coordinate\n",
-	   EXIT_FAILURE,
-	   "--karney dist: lat1 out of range (-90.0000001)");
+	e = "  <wpt lat=\"12.34\" lon=\"56.78\">\n"
+	    "    <name>&gt;</name>\n"
+	    "    <cmt>&gt;</cmt>\n"
+	    "  </wpt>\n";
+	s = gpx_wpt(12.34, 56.78, ">", ">");
+	OK_STRCMP(no_null(s), e, "gpx_wpt() with gt");
+	print_gotexp(s, e);
+	free(s);
 
-	tc((chp{ execname, "--karney", "dist", "10,180.000000001", "10,0",
-	         NULL }),
-	   "",
-	   EXECSTR ": 10,180.000000001: Invalid coordinate\n",
-	   EXIT_FAILURE,
-	   "--karney dist: lon1 out of range (180.000000001)");
+	p = "asdf < & > <\" &&lt; < & abc\n"
+	    " >;;;&lt;;;åæø;abc🤘def\n"
+	    "def>/<€>;&amp;&<&gt;>&\n"
+	    "\\$e=19;\n";
+	c = "asdf &lt; &amp; &gt; &lt;\" &amp;&amp;lt; &lt; &amp; abc\n"
+	    " &gt;;;;&amp;lt;;;åæø;abc🤘def\n"
+	    "def&gt;/&lt;€&gt;;&amp;amp;&amp;&lt;&amp;gt;&gt;&amp;\n"
+	    "\\$e=19;\n";
+	e = allocstr("  <wpt lat=\"12.34\" lon=\"56.78\">\n"
+	             "    <name>%s</name>\n"
+	             "    <cmt>%s</cmt>\n"
+	             "  </wpt>\n", c, c);
+	if (!e) {
+		failed_ok("allocstr()"); /* gncov */
+		return; /* gncov */
+	}
+	s = gpx_wpt(12.34, 56.78, p, p);
+	OK_STRCMP(no_null(s), e, "gpx_wpt() with amp, gt, lt, and more");
+	print_gotexp(s, e);
+	free(s);
+	free(e);
 
-	tc((chp{ execname, "--karney", "dist", "10,-180.000000001", "10,0",
-	         NULL }),
-	   "",
-	   EXECSTR ": 10,-180.000000001: Invalid coordinate\n",
-	   EXIT_FAILURE,
-	   "--karney dist: lon1 out of range (-180.000000001)");
+	p = NULL;
+	e = NULL;
+	s = gpx_wpt(12.34, 56.78, p, p);
+	OK_NULL(s, "gpx_wpt() with NULL in name and cmt");
+	print_gotexp(s, e);
+	if (s) {
+		OK_ERROR("%s(): `s` was allocated, should not" /* gncov */
+		         " happen", __func__);
+		free(s); /* gncov */
+	}
 
-	tc((chp{ execname, "--karney", "dist", "10,10.123", "h,0",
-	         NULL }),
-	   "",
-	   EXECSTR ": h,0: Invalid coordinate: Invalid argument\n",
-	   EXIT_FAILURE,
-	   "--karney dist: lat2 is not a number");
+	p = NULL;
+	e = NULL;
+	s = gpx_wpt(12.34, 56.78, p, "def");
+	OK_NULL(s, "gpx_wpt() with NULL in name");
+	print_gotexp(s, e);
+	if (s) {
+		OK_ERROR("%s(): `s` was allocated," /* gncov */
+		         " should not happen", __func__);
+		free(s); /* gncov */
+	}
 
-	tc((chp{ execname, "--karney", "dist", "10,10.123", "9,1..2",
-	         NULL }),
-	   "",
-	   EXECSTR ": 9,1..2: Invalid coordinate: Invalid argument\n",
-	   EXIT_FAILURE,
-	   "--karney dist: lat2 has 2 periods");
+	s = gpx_wpt(12.34, 56.78, "abc", NULL);
+	OK_NOTNULL(s, "gpx_wpt() with NULL in cmt");
+	free(s);
 }
 
-                               /*** --seed ***/
+                                /*** io.c ***/
 
 /*
- * test_seed_option() - Tests the --seed option. Returns nothing.
+ * chk_possort() - Used by test_possort(). Adds the positions in `coors`, 
+ * separated by spaces, to a `struct possort` with `chunk` positions in memory 
+ * and verifies that the numbers of the positions in sorted order are `exp`, 
+ * separated by spaces. Returns nothing.
  */
 
-static void test_seed_option(const struct Options *o)
+static void chk_possort(const int linenum, const SortOrder order,
+                        const size_t chunk, const char *coors,
+                        const char *exp)
 {
-	struct binbuf bb1, bb2, bb3;
-
-	assert(o);
-	diag("Test --seed");
-
-	binbuf_init(&bb1);
-	binbuf_init(&bb2);
-	binbuf_init(&bb3);
-	exec_output(o, &bb1, (chp{ execname, "--seed", "64738",
-	                           "--count", "20", "randpos", NULL }));
-	exec_output(o, &bb2, (chp{ execname, "--seed", "64739",
-	                           "--count", "20", "randpos", NULL }));
-	exec_output(o, &bb3, (chp{ execname, "--seed", "64738",
-	                           "--count", "20", "randpos", NULL }));
-	OK_NOTNULL(strcmp(bb1.buf, bb2.buf),
-	           "randpos with seed 64738 and 64739 are different");
-	OK_STRCMP(bb3.buf, bb1.buf,
-	          "randpos with seed 64738 is identical to the first");
-	binbuf_free(&bb3);
-	binbuf_free(&bb2);
-	binbuf_free(&bb1);
-
-	tc((chp{ execname, "--seed", "-29271", "--count", "10", "randpos",
-	         NULL }),
-	   "56.398026,65.672317\n"
-	   "-62.545731,39.973376\n"
-	   "-12.953591,-109.219631\n"
-	   "71.625404,10.907732\n"
-	   "-49.720325,-97.898594\n"
-	   "-9.863466,161.067034\n"
-	   "-21.125676,-179.454884\n"
-	   "-20.152272,-58.45828\n"
-	   "11.179247,79.685331\n"
-	   "-47.058531,149.678499\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--seed -29271 --count 10 randpos");
+	struct possort ps;
+	char *buf, *tok, res[256] = "";
+	double lat, lon;
+	unsigned long num = 0;
 
-	tc((chp{ execname, "--seed", "29271", "--count", "10", "randpos",
-	         NULL }),
-	   "-8.603169,114.257108\n"
-	   "-46.646685,-133.238413\n"
-	   "32.233828,-45.004903\n"
-	   "-10.383696,-105.396018\n"
-	   "14.981908,-85.632935\n"
-	   "-2.55139,93.617273\n"
-	   "-45.194786,6.814725\n"
-	   "-4.49135,-102.252955\n"
-	   "-54.462817,-25.117826\n"
-	   "-23.940993,-89.915442\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--seed 29271 --count 10 randpos");
+	buf = mystrdup(coors);
+	if (!buf || possort_init(&ps, order, chunk)) {
+		failed_ok("possort_init()"); /* gncov */
+		free(buf); /* gncov */
+		return; /* gncov */
+	}
+	for (tok = strtok(buf, " "); tok; tok = strtok(NULL, " ")) {
+		if (parse_coordinate(tok, true, &lat, &lon)
+		    || possort_add(&ps, lat, lon, ++num)) {
+			failed_ok("possort_add()"); /* gncov */
+			goto cleanup; /* gncov */
+		}
+	}
+	if (possort_finish(&ps)) {
+		failed_ok("possort_finish()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	while (possort_next(&ps, &lat, &lon, &num) == PS_POINT) {
+		sprintf(res + strlen(res), "%s%lu", *res ? " " : "", num);
+		if (strlen(res) > sizeof(res) - 32)
+			break; /* gncov */
+	}
+	OK_STRCMP_L(res, exp, linenum, "possort, chunk %zu: %s", chunk, coors);
+	OK_EQUAL_L(possort_next(&ps, &lat, &lon, &num), PS_EOF, linenum,
+	           "possort_next() after the end, chunk %zu: %s",
+	           chunk, coors);
 
-	tc((chp{ execname, "--format", "gpx", "--seed", "19999",
-	         "--count", "4", "randpos", NULL }),
-	   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-	   "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\""
-	   " version=\"1.1\" creator=\"Geocalc -"
-	   " https://gitlab.com/oyvholm/geocalc\">\n"
-	   "  <wpt lat=\"-17.91477\" lon=\"127.6547\">\n"
-	   "    <name>Random 1, seed 19999</name>\n"
-	   "  </wpt>\n"
-	   "  <wpt lat=\"-27.493377\" lon=\"115.562443\">\n"
-	   "    <name>Random 2, seed 19999</name>\n"
-	   "  </wpt>\n"
-	   "  <wpt lat=\"-22.699248\" lon=\"152.244953\">\n"
-	   "    <name>Random 3, seed 19999</name>\n"
-	   "  </wpt>\n"
-	   "  <wpt lat=\"-52.359745\" lon=\"-142.81243\">\n"
-	   "    <name>Random 4, seed 19999</name>\n"
-	   "  </wpt>\n"
-	   "</gpx>\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--format gpx --seed 19999 --count 4 randpos");
+cleanup:
+	possort_free(&ps);
+	free(buf);
+}
 
-	tc((chp{ execname, "--seed", "", "randpos", NULL }),
-	   "",
-	   EXECSTR ": : Invalid --seed argument\n"
-	   OPTION_ERROR_STR,
-	   EXIT_FAILURE,
-	   "Empty argument to --seed");
+/*
+ * test_possort() - Tests the possort_*() functions. Returns nothing.
+ */
 
-	tc((chp{ execname, "--seed", "9.14", "randpos", NULL }),
-	   "",
-	   EXECSTR ": 9.14: Invalid --seed argument\n"
-	   OPTION_ERROR_STR,
-	   EXIT_FAILURE,
-	   "--seed 9.14 randpos");
+static void test_possort(void)
+{
+	diag("Test possort_*()");
+
+#define chk_possort(order, chunk, coors, exp)  \
+        chk_possort(__LINE__, (order), (chunk), (coors), (exp))
+
+	chk_possort(SO_HILBERT, 10, "", "");
+	chk_possort(SO_HILBERT, 1, "", "");
+	chk_possort(SO_HILBERT, 10, "1,2", "1");
+	chk_possort(SO_HILBERT, 10, "60,5 -60,-5 60,-5 -60,5 0,0 10,10",
+	            "2 3 5 6 1 4");
+	chk_possort(SO_HILBERT, 3, "60,5 -60,-5 60,-5 -60,5 0,0 10,10",
+	            "2 3 5 6 1 4");
+	chk_possort(SO_HILBERT, 4, "60,5 -60,-5 60,-5 -60,5 0,0 10,10",
+	            "2 3 5 6 1 4");
+	chk_possort(SO_HILBERT, 1, "60,5 -60,-5 60,-5 -60,5 0,0 10,10",
+	            "2 3 5 6 1 4");
+	chk_possort(SO_MORTON, 10, "60,5 -60,-5 60,-5 -60,5 0,0 10,10",
+	            "2 3 4 5 6 1");
+	chk_possort(SO_MORTON, 2, "60,5 -60,-5 60,-5 -60,5 0,0 10,10",
+	            "2 3 4 5 6 1");
+	chk_possort(SO_HILBERT, 2, "1,1 1,1 0,0 1,1 0,0", "3 5 1 2 4");
+
+#undef chk_possort
 }
 
-                         /****** Command tests ******/
-
-                                /*** anti ***/
+                              /*** strings.c ***/
 
 /*
- * chk_ca() - Used by test_cmd_anti(). Verifies that the coordinate `coor` 
- * results in the output `exp_stdout` on stdout. If `exp_stdout` is empty, an 
- * "Invalid coordinate" error message is expected on stderr, and an exit status 
- * of EXIT_FAILURE. If `exp_stdout` is "inv", it expects an "Invalid 
- * coordinate" error message followed by "Invalid argument". Returns nothing.
+ * chk_tz() - Used by test_trim_zeros(). Verifies that the number in the string 
+ * `got` equals `exp` after processing by trim_zeros(). Returns nothing.
  */
 
-static void chk_ca(const int linenum, char *coor, const char *exp_stdout)
+static void chk_tz(const int linenum, const char *got, const char *exp)
 {
-	char *e_stderr;
-	const char *e_stdout = exp_stdout;
-	int e_ret;
+	const char *res;
+	char *s;
 
-	assert(coor);
-	assert(exp_stdout);
+	assert(got);
+	assert(exp);
 
-	if (!*exp_stdout) {
-		e_stderr = allocstr("%s: %s: Invalid coordinate\n",
-		                    execname, coor);
-		e_ret = EXIT_FAILURE;
-	} else if (!strcmp(exp_stdout, "inv")) {
-		e_stderr = allocstr("%s: %s: Invalid coordinate:"
-		                    " Invalid argument\n", execname, coor);
-		e_stdout = "";
-		e_ret = EXIT_FAILURE;
-	} else {
-		e_stderr = mystrdup("");
-		e_ret = EXIT_SUCCESS;
-	}
-	if (!e_stderr) {
-		failed_ok("allocstr() or mystrdup()"); /* gncov */
+	s = mystrdup(got);
+	if (!s) {
+		failed_ok("mystrdup()"); /* gncov */
+		return; /* gncov */
+	}
+	res = trim_zeros(s);
+	OK_STRCMP_L(res, exp, linenum, "trim_zeros(\"%s\"), expects \"%s\"",
+	                               got, exp);
+	print_gotexp(res, exp);
+	free(s);
+}
+
+/*
+ * test_trim_zeros() - Tests the trim_zeros() function. Returns nothing.
+ */
+
+static void test_trim_zeros(void)
+{
+	diag("Test trim_zeros()");
+
+#define chk_tz(got, exp)  chk_tz(__LINE__, (got), (exp))
+
+	chk_tz("", "");
+	chk_tz("+", "+");
+	chk_tz("++++++", "++++++");
+	chk_tz("++1.0", "++1.0");
+	chk_tz("+0.0000", "+0.0");
+	chk_tz("+0.29750000", "+0.2975");
+	chk_tz("+5.0", "+5.0");
+	chk_tz("+5.000", "+5.0");
+	chk_tz("-", "-");
+	chk_tz("-+0.0", "-+0.0");
+	chk_tz("---", "---");
+	chk_tz("-0.0000", "-0.0");
+	chk_tz("-7.9650", "-7.965");
+	chk_tz(".", ".");
+	chk_tz(".3000", ".3");
+	chk_tz("0", "0");
+	chk_tz("00000", "00000");
+	chk_tz("1", "1");
+	chk_tz("1.0.0", "1.0.0");
+	chk_tz("1.234 abc", "1.234 abc");
+	chk_tz("5.", "5.");
+	chk_tz("5.0", "5.0");
+	chk_tz("5.00000", "5.0");
+	chk_tz("5.1", "5.1");
+	chk_tz("5.100000", "5.1");
+	chk_tz("5.10001", "5.10001");
+	chk_tz("9.234abc", "9.234abc");
+	chk_tz("abc", "abc");
+
+#undef chk_tz
+}
+
+/*
+ * test_mystrdup() - Tests the mystrdup() function. Returns nothing.
+ */
+
+static void test_mystrdup(void)
+{
+	const char *txt = "Test string";
+	char *s;
+
+	diag("Test mystrdup()");
+	OK_NULL(mystrdup(NULL), "mystrdup(NULL) == NULL");
+
+	s = mystrdup(txt);
+	if (!s) {
+		failed_ok("mystrdup()"); /* gncov */
+		return; /* gncov */
+	}
+	OK_STRCMP(s, txt, "mystrdup(): Strings are identical");
+	free(s);
+}
+
+/*
+ * test_allocstr() - Tests the allocstr() function. Returns nothing.
+ */
+
+static void test_allocstr(void)
+{
+	const size_t bufsize = BUFSIZ * 2 + 1;
+	char *p, *p2, *p3;
+	size_t alen;
+
+	diag("Test allocstr()");
+	p = malloc(bufsize);
+	if (!p) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	memset(p, 'a', bufsize - 1);
+	p[bufsize - 1] = '\0';
+	p2 = allocstr("%s", p);
+	if (!p2) {
+		failed_ok("allocstr() with BUFSIZ * 2"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	alen = strlen(p2);
+	OK_EQUAL(alen, BUFSIZ * 2, "allocstr(): strlen is correct");
+	p3 = p2;
+	while (*p3) {
+		if (*p3 != 'a') {
+			p3 = NULL; /* gncov */
+			break; /* gncov */
+		}
+		p3++;
+	}
+	OK_NOTNULL(p3, "allocstr(): Content of string is correct");
+
+cleanup:
+	free(p2);
+	free(p);
+}
+
+/*
+ * chk_cs() - Used by test_count_substr(). Verifies that the number of 
+ * non-overlapping substrings `substr` inside string `s` is `count`. `desc` is 
+ * the test description. Returns nothing.
+ */
+
+static void chk_cs(const int linenum, const char *s, const char *substr,
+                   const size_t count, const char *desc)
+{
+	size_t result;
+
+	assert(desc);
+	assert(*desc);
+
+	result = count_substr(s, substr);
+	OK_EQUAL_L(result, count, linenum, "count_substr(): %s", desc);
+	print_gotexp_size_t(result, count);
+}
+
+/*
+ * test_count_substr() - Tests the count_substr() function. Returns nothing.
+ */
+
+static void test_count_substr(void)
+{
+	char *s;
+	size_t bsize = 10000;
+
+	diag("Test count_substr()");
+
+#define chk_cs(s, substr, count, desc)  chk_cs(__LINE__, (s), (substr), \
+                                               (count), (desc))
+	chk_cs("", "", 0, "s and substr are empty");
+	chk_cs("", "a", 0, "s is empty");
+	chk_cs("aaa", "", 0, "substr is empty");
+
+	chk_cs("", NULL, 0, "substr is NULL");
+	chk_cs(NULL, "abcdef", 0, "s is NULL");
+	chk_cs(NULL, NULL, 0, "s and substr is NULL");
+
+	chk_cs("Abc", "abc", 0, "Case sensitivity");
+	chk_cs("a", "aa", 0, "substr is longer than s");
+	chk_cs("aaa", "a", 3, "3 \"a\" in \"aaa\"");
+	chk_cs("aaa", "aa", 1, "Non-overlapping \"aa\" in \"aaa\"");
+	chk_cs("aaabaaa", "aaa", 2, "Non-overlapping \"aaa\" split by \"b\"");
+	chk_cs("abababab", "ab", 4, "4 \"ab\" in s");
+	chk_cs("abc", "b", 1, "Single character substring");
+	chk_cs("abc", "d", 0, "Substring not found");
+	chk_cs("abcdeabc", "abc", 2, "Substring at start and end");
+	chk_cs("abcdef" "abcdef" "abcdef", "abc", 3, "3 \"abc\" in s");
+	chk_cs("abcdef", "abcdef", 1, "s and substr are identical");
+	chk_cs("zzzGHJ\nabc\nGHJ\nabcGHJ", "GHJ", 3, "s with newlines");
+	chk_cs("Ḡṹṛḡḷḗ", "ḡ", 1, "UTF-8, U+1Exx area");
+
+	s = malloc(bsize + 1);
+	if (!s) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	memset(s, '!', bsize);
+	s[bsize] = '\0';
+	chk_cs(s, "!!!!!!!!!!", bsize / 10, "Large buffer");
+	free(s);
+#undef chk_cs
+}
+
+/*
+ * chk_sr() - Used by test_str_replace(). Verifies that all non-overlapping 
+ * occurrences of substring `s1` are replaced with the string `s2` in the 
+ * string `s`, resulting in the string `exp`. Returns nothing.
+ */
+
+static void chk_sr(const int linenum, const char *s, const char *s1,
+                   const char *s2, const char *exp, const char *desc)
+{
+	char *result;
+
+	assert(desc);
+	assert(*desc);
+
+	result = str_replace(s, s1, s2);
+	if (!result || !exp)
+		OK_EQUAL_L(result, exp, linenum, "str_replace(): %s", desc);
+	else
+		OK_STRCMP_L(result, exp, linenum, "str_replace(): %s", desc);
+	print_gotexp(result, exp);
+	free(result);
+}
+
+/*
+ * test_str_replace() - Tests the str_replace() function. Returns nothing.
+ */
+
+static void test_str_replace(void)
+{
+	char *s;
+	size_t bsize = 10000;
+
+	diag("Test str_replace()");
+
+#define chk_sr(s, s1, s2, exp, desc)  chk_sr(__LINE__, (s), (s1), (s2), \
+                                             (exp), (desc))
+	chk_sr("", "", "", "", "s, s1, and s2 are empty");
+	chk_sr("abc", "", "b", "abc", "s1 is empty");
+	chk_sr("", "a", "b", "", "s is empty");
+	chk_sr("", "a", "", "", "s and s2 is empty");
+
+	chk_sr(NULL, "a", "b", NULL, "s is NULL");
+	chk_sr("abc", NULL, "b", NULL, "s1 is NULL");
+	chk_sr("abc", "a", NULL, NULL, "s2 is NULL");
+	chk_sr(NULL, NULL, NULL, NULL, "s, s1, and s2 is NULL");
+
+	chk_sr("test", "test", "test", "test", "s, s1, and s2 are identical");
+	chk_sr("abc", "b", "DEF", "aDEFc", "abc, replace b with DEF");
+	chk_sr("abcabcabc", "b", "DEF", "aDEFcaDEFcaDEFc",
+	       "abcabcabc, replace all b with DEF");
+	chk_sr("abcdefgh", "defg", "", "abch", "Replace defg with nothing");
+	chk_sr("abcde", "bcd", "X", "aXe", "Replace bcd with X");
+	chk_sr("abc", "d", "X", "abc", "d not in abc");
+	chk_sr("ababab", "aba", "X", "Xbab", "Replace aba in ababab");
+	chk_sr("abc", "b", "", "ac", "Replace b with nothing");
+	chk_sr("abc", "", "X", "abc", "Replace empty with X");
+	chk_sr("Ḡṹṛḡḷḗ", "ḡ", "X", "ḠṹṛXḷḗ", "Replace UTF-8 character with X");
+
+	s = malloc(bsize + 1);
+	if (!s) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	memset(s, '!', bsize);
+	s[bsize] = '\0';
+	chk_sr(s, "!!!!!!!!!!", "", "", "Replace all text in large buffer");
+	free(s);
+
+	s = malloc(bsize + 1);
+	if (!s) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	memset(s, '!', bsize);
+	s[1234] = 'y';
+	s[bsize - 1] = 'z';
+	s[bsize] = '\0';
+	chk_sr(s, "!!!!!!!!!!", "", "!!!!y!!!!z", "Large buffer with y and z");
+	free(s);
+#undef chk_sr
+}
+
+/*
+ * chk_coor() - Tries to parse the coordinate in `s` with `parse_coordinate()` 
+ * and tests that `parse_coordinate()` returns the expected values.
+ * Returns nothing.
+ */
+
+static void chk_coor(const int linenum, const char *s, const int exp_ret,
+                     const double exp_lat, const double exp_lon)
+{
+	double lat, lon;
+	int result;
+
+	result = parse_coordinate(s, true, &lat, &lon);
+	OK_EQUAL_L(result, exp_ret, linenum,
+	           "parse_coordinate(\"%s\"), expected to %s",
+	           s, exp_ret ? "fail" : "succeed");
+
+	if (result)
+		return;
+
+	OK_EQUAL_L(lat, exp_lat, linenum,
+	           "parse_coordinate(\"%s\"): lat is ok", s);
+	print_gotexp_double(lat, exp_lat);
+	OK_EQUAL_L(lon, exp_lon, linenum,
+	           "parse_coordinate(\"%s\"): lon is ok", s);
+	print_gotexp_double(lon, exp_lon);
+}
+
+/*
+ * test_parse_coordinate() - Various tests for `parse_coordinate()`. Returns 
+ * nothing.
+ */
+
+static void test_parse_coordinate(void) {
+	diag("Test parse_coordinate()");
+
+#define chk_coor(s, exp_ret, exp_lat, exp_lon)  \
+	chk_coor(__LINE__, (s), (exp_ret), (exp_lat), (exp_lon))
+
+	chk_coor("12.34,56.78", 0, 12.34, 56.78);
+	chk_coor("12.34", 1, 0, 0);
+	chk_coor("", 1, 0, 0);
+	chk_coor("995.456,,456.345", 1, 0, 0);
+	chk_coor("56,78", 0, 56, 78);
+	chk_coor("-56,-78", 0, -56, -78);
+	chk_coor("-56.234,-78.345", 0, -56.234, -78.345);
+	chk_coor(" -56.234,-78.345", 0, -56.234, -78.345);
+	chk_coor("-56.234, -78.345", 0, -56.234, -78.345);
+	chk_coor("56.2r4,-78.345", 1, 0, 0);
+	chk_coor("+56.24,-78.345", 0, 56.24, -78.345);
+	chk_coor(NULL, 1, 0, 0);
+
+	diag("Other formats");
+	chk_coor("60.5 5.25", 0, 60.5, 5.25);
+	chk_coor(" -60.5\t-5.25 ", 0, -60.5, -5.25);
+	chk_coor("60.5 5.25 1", 1, 0, 0);
+	chk_coor("60-5", 1, 0, 0);
+	chk_coor("60 23 5 19", 0, 60 + 23 / 60.0, 5 + 19 / 60.0);
+	chk_coor("-60 23 33 -5 19 24", 0, -(60 + 23 / 60.0 + 33 / 3600.0),
+	         -(5 + 19 / 60.0 + 24 / 3600.0));
+	chk_coor("60 23 33 5 19 24 1", 1, 0, 0);
+	chk_coor("60°23'33\"N 5°19'24\"E", 0,
+	         60 + 23 / 60.0 + 33 / 3600.0, 5 + 19 / 60.0 + 24 / 3600.0);
+	chk_coor("60°23′33″S, 5°19′24″W", 0,
+	         -(60 + 23 / 60.0 + 33 / 3600.0),
+	         -(5 + 19 / 60.0 + 24 / 3600.0));
+	chk_coor("60º23'33'' 5º19'24''", 0,
+	         60 + 23 / 60.0 + 33 / 3600.0, 5 + 19 / 60.0 + 24 / 3600.0);
+	chk_coor("60°23.5' 5°", 0, 60 + 23.5 / 60.0, 5);
+	chk_coor("60°30\" 5°", 0, 60 + 30 / 3600.0, 5);
+	chk_coor("-60°30',-5°30'", 0, -60.5, -5.5);
+	chk_coor("N60 E5", 0, 60, 5);
+	chk_coor("S 60 30, W 5 30", 0, -60.5, -5.5);
+	chk_coor("60 30 N 5 30 E", 0, 60.5, 5.5);
+	chk_coor("5.5W 60.5N", 0, 60.5, -5.5);
+	chk_coor("E5 S60", 0, -60, 5);
+	chk_coor("60N,5E,, ", 0, 60, 5);
+	chk_coor("60N 5N", 1, 0, 0);
+	chk_coor("60E 5W", 1, 0, 0);
+	chk_coor("-60N 5E", 1, 0, 0);
+	chk_coor("N60 5E", 1, 0, 0);
+	chk_coor("N60 E5 W", 1, 0, 0);
+	chk_coor("60N", 1, 0, 0);
+	chk_coor("60N 5E 1", 1, 0, 0);
+	chk_coor("60,5N", 1, 0, 0);
+	chk_coor("60,5E", 1, 0, 0);
+	chk_coor("N60,5", 1, 0, 0);
+	chk_coor("60°N 5°", 1, 0, 0);
+	chk_coor("60 30 N 5 30", 1, 0, 0);
+	chk_coor("60° 5", 1, 0, 0);
+	chk_coor("60 ° 5°", 1, 0, 0);
+	chk_coor("60°° 5°", 1, 0, 0);
+	chk_coor("60°60' 5°", 1, 0, 0);
+	chk_coor("60.5°30' 5°", 1, 0, 0);
+	chk_coor("60°-30' 5°", 1, 0, 0);
+	chk_coor("60' 5°", 1, 0, 0);
+	chk_coor("60°30 5°", 1, 0, 0);
+	chk_coor("60 30, 5", 1, 0, 0);
+	chk_coor("60°30'15\" 5° 1", 1, 0, 0);
+	chk_coor("60°30' 5°1'2\" 3", 1, 0, 0);
+	chk_coor("60° 5° 1°", 1, 0, 0);
+	chk_coor("60° 5°,1", 1, 0, 0);
+	chk_coor("60, 5 N", 1, 0, 0);
+	chk_coor(",60,5", 1, 0, 0);
+	chk_coor("60 5 x", 1, 0, 0);
+	chk_coor("90.5 0", 1, 0, 0);
+	chk_coor("1 2 3 4 5 6 7", 1, 0, 0);
+
+#undef chk_coor
+}
+
+/*
+ * test_scan_coordinate() - Tests the end pointer and `errno` from 
+ * scan_coordinate(). Returns nothing.
+ */
+
+static void test_scan_coordinate(void)
+{
+	const char *end = NULL;
+	double lat = 0.0, lon = 0.0;
+
+	diag("Test scan_coordinate()");
+
+	OK_SUCCESS(scan_coordinate("60,5,7", &lat, &lon, &end),
+	           "scan_coordinate(\"60,5,7\")");
+	OK_STRCMP(end, "7", "scan_coordinate(\"60,5,7\"): end is ok");
+	OK_SUCCESS(scan_coordinate("60N 5E  ,7", &lat, &lon, &end),
+	           "scan_coordinate(\"60N 5E  ,7\")");
+	OK_STRCMP(end, "7", "scan_coordinate(\"60N 5E  ,7\"): end is ok");
+	OK_SUCCESS(scan_coordinate("60N 5E 7", &lat, &lon, &end),
+	           "scan_coordinate(\"60N 5E 7\")");
+	OK_STRCMP(end, "7", "scan_coordinate(\"60N 5E 7\"): end is ok");
+	OK_SUCCESS(scan_coordinate("60 5", &lat, &lon, &end),
+	           "scan_coordinate(\"60 5\")");
+	OK_STRCMP(end, "", "scan_coordinate(\"60 5\"): end is ok");
+	errno = 0;
+	OK_FAILURE(scan_coordinate("1e999 5", &lat, &lon, &end),
+	           "scan_coordinate(\"1e999 5\")");
+	OK_EQUAL(errno, ERANGE,
+	         "scan_coordinate(\"1e999 5\"): errno is ERANGE");
+	errno = 0;
+	OK_FAILURE(scan_coordinate("60 5 1", &lat, &lon, &end),
+	           "scan_coordinate(\"60 5 1\")");
+	OK_EQUAL(errno, EINVAL,
+	         "scan_coordinate(\"60 5 1\"): errno is EINVAL");
+	errno = 0;
+}
+
+/*
+ * chk_datetime() - Parses the timestamp in `s` with parse_datetime() and 
+ * tests that the return value and the number of seconds are as expected. 
+ * Returns nothing.
+ */
+
+static void chk_datetime(const int linenum, const char *s, const int exp_ret,
+                         const double exp_secs)
+{
+	double secs = 0.0;
+	int result;
+
+	errno = 0;
+	result = parse_datetime(s, &secs);
+	OK_EQUAL_L(result, exp_ret, linenum,
+	           "parse_datetime(\"%s\"), expected to %s",
+	           s, exp_ret ? "fail" : "succeed");
+	if (result) {
+		OK_EQUAL_L(errno, EINVAL, linenum,
+		           "parse_datetime(\"%s\"): errno is EINVAL", s);
+		errno = 0;
+		return;
+	}
+	OK_EQUAL_L(secs, exp_secs, linenum,
+	           "parse_datetime(\"%s\"): Number of seconds is ok", s);
+	print_gotexp_double(secs, exp_secs);
+}
+
+/*
+ * test_parse_datetime() - Tests the parse_datetime() function. Returns 
+ * nothing.
+ */
+
+static void test_parse_datetime(void)
+{
+	diag("Test parse_datetime()");
+
+#define chk_datetime(s, exp_ret, exp_secs)  \
+	chk_datetime(__LINE__, (s), (exp_ret), (exp_secs))
+
+	chk_datetime("1970-01-01T00:00:00Z", 0, 0.0);
+	chk_datetime("1969-12-31T23:59:59Z", 0, -1.0);
+	chk_datetime("2000-02-29T12:00:00Z", 0, 951825600.0);
+	chk_datetime("2024-12-31T23:59:60Z", 0, 1735689600.0);
+	chk_datetime("2038-01-19T03:14:08Z", 0, 2147483648.0);
+	chk_datetime("0000-03-01T00:00:00Z", 0, -62162035200.0);
+	chk_datetime("2024-01-02T03:04:05", 0, 1704164645.0);
+	chk_datetime(" 2024-01-02t03:04:05z\n", 0, 1704164645.0);
+	chk_datetime("2024-01-02T03:04:05.25Z", 0, 1704164645.25);
+	chk_datetime("2024-01-02T03:04:05+01:30", 0, 1704159245.0);
+	chk_datetime("2024-01-02T03:04:05-10:00", 0, 1704200645.0);
+	chk_datetime("", 1, 0.0);
+	chk_datetime("2024-01-02", 1, 0.0);
+	chk_datetime("2024-01-02 03:04:05Z", 1, 0.0);
+	chk_datetime("2024-01-02T03:04", 1, 0.0);
+	chk_datetime("24-01-02T03:04:05Z", 1, 0.0);
+	chk_datetime("2024-1-02T03:04:05Z", 1, 0.0);
+	chk_datetime("2024-01-02T03:04:05.Z", 1, 0.0);
+	chk_datetime("2024-01-02T03:04:05+0100", 1, 0.0);
+	chk_datetime("2024-01-02T03:04:05+24:00", 1, 0.0);
+	chk_datetime("2024-01-02T03:04:05+01:60", 1, 0.0);
+	chk_datetime("2024-01-02T03:04:05Z x", 1, 0.0);
+	chk_datetime("2024-00-02T03:04:05Z", 1, 0.0);
+	chk_datetime("2024-13-02T03:04:05Z", 1, 0.0);
+	chk_datetime("2024-01-00T03:04:05Z", 1, 0.0);
+	chk_datetime("2024-04-31T03:04:05Z", 1, 0.0);
+	chk_datetime("2023-02-29T03:04:05Z", 1, 0.0);
+	chk_datetime("1900-02-29T03:04:05Z", 1, 0.0);
+	chk_datetime("2024-01-02T24:00:00Z", 1, 0.0);
+	chk_datetime("2024-01-02T03:60:05Z", 1, 0.0);
+	chk_datetime("2024-01-02T03:04:61Z", 1, 0.0);
+
+#undef chk_datetime
+}
+
+/******************************************************************************
+                               Property tests
+******************************************************************************/
+
+/*
+ * The property tests check invariants in the geomath.c functions against a 
+ * large number of pseudo-random input values. Each property consists of a 
+ * generator that creates `numvals` input values and a check function that 
+ * returns 1 if the property doesn't hold for those values. Input values that 
+ * don't satisfy the preconditions of the property are accepted by the check 
+ * function.
+ *
+ * When a property fails, the input values are shrunk to simpler values that 
+ * still make it fail, to make it easier to find the cause. The random values 
+ * are generated from the --seed value, so failing runs can be repeated.
+ */
+
+#define PROP_ITERATIONS  20000
+#define PROP_MAXVALS  8
+
+struct Property {
+	const char *desc;
+	size_t numvals;
+	long divisor; /* Reduces the number of iterations for slow functions */
+	void (*gen)(unsigned short *xsubi, double *v);
+	int (*check)(const double *v);
+};
+
+/*
+ * prop_rand() - Returns a pseudo-random number in the range [min, max) from 
+ * the erand48() state in `xsubi`. In 1 of 16 cases, `min`, `max` or 0 is 
+ * returned instead if it's inside the range, since edge values often reveal 
+ * errors that random values don't.
+ */
+
+static double prop_rand(unsigned short *xsubi, const double min,
+                        const double max)
+{
+	assert(xsubi);
+
+	if (erand48(xsubi) < 1.0 / 16.0) {
+		const double edge = erand48(xsubi);
+
+		if (edge < 1.0 / 3.0)
+			return min;
+		if (edge < 2.0 / 3.0 || min > 0.0 || max < 0.0)
+			return max;
+		return 0.0;
+	}
+
+	return min + erand48(xsubi) * (max - min);
+}
+
+/*
+ * prop_lat() - Returns a pseudo-random latitude from the erand48() state in 
+ * `xsubi`, uniformly distributed on the sphere.
+ */
+
+static double prop_lat(unsigned short *xsubi)
+{
+	assert(xsubi);
+
+	return asin(prop_rand(xsubi, -1.0, 1.0)) * 180.0 / M_PI;
+}
+
+/*
+ * prop_lon() - Returns a pseudo-random longitude from the erand48() state in 
+ * `xsubi`.
+ */
+
+static double prop_lon(unsigned short *xsubi)
+{
+	assert(xsubi);
+
+	return prop_rand(xsubi, -180.0, 180.0);
+}
+
+/*
+ * angle_diff() - Returns the absolute difference in degrees between the angles 
+ * `a` and `b`, in the range [0, 180].
+ */
+
+static double angle_diff(const double a, const double b)
+{
+	double d = fmod(fabs(a - b), 360.0);
+
+	return d > 180.0 ? 360.0 - d : d;
+}
+
+/*
+ * gen_2pos() - Generates 2 random positions. Returns nothing.
+ */
+
+static void gen_2pos(unsigned short *xsubi, double *v)
+{
+	v[0] = prop_lat(xsubi);
+	v[1] = prop_lon(xsubi);
+	v[2] = prop_lat(xsubi);
+	v[3] = prop_lon(xsubi);
+}
+
+/*
+ * gen_3pos() - Generates 3 random positions. Returns nothing.
+ */
+
+static void gen_3pos(unsigned short *xsubi, double *v)
+{
+	gen_2pos(xsubi, v);
+	v[4] = prop_lat(xsubi);
+	v[5] = prop_lon(xsubi);
+}
+
+/*
+ * gen_4pos() - Generates 4 random positions. Returns nothing.
+ */
+
+static void gen_4pos(unsigned short *xsubi, double *v)
+{
+	gen_3pos(xsubi, v);
+	v[6] = prop_lat(xsubi);
+	v[7] = prop_lon(xsubi);
+}
+
+/*
+ * gen_pos() - Generates 1 random position. Returns nothing.
+ */
+
+static void gen_pos(unsigned short *xsubi, double *v)
+{
+	v[0] = prop_lat(xsubi);
+	v[1] = prop_lon(xsubi);
+}
+
+/*
+ * gen_pos_bear_dist() - Generates a random position, a bearing and a distance 
+ * up to 1 km less than MAX_EARTH_DISTANCE. Haversine calculations are 
+ * ill-conditioned close to the antipode. Returns nothing.
+ */
+
+static void gen_pos_bear_dist(unsigned short *xsubi, double *v)
+{
+	v[0] = prop_lat(xsubi);
+	v[1] = prop_lon(xsubi);
+	v[2] = prop_rand(xsubi, 0.0, 360.0);
+	v[3] = prop_rand(xsubi, 0.0, MAX_EARTH_DISTANCE - 1000.0);
+}
+
+/*
+ * gen_pos_2dist() - Generates a random position and 2 distances. Returns 
+ * nothing.
+ */
+
+static void gen_pos_2dist(unsigned short *xsubi, double *v)
+{
+	v[0] = prop_lat(xsubi);
+	v[1] = prop_lon(xsubi);
+	v[2] = prop_rand(xsubi, 0.0, MAX_EARTH_DISTANCE);
+	v[3] = prop_rand(xsubi, 0.0, MAX_EARTH_DISTANCE);
+}
+
+/*
+ * gen_approx() - Generates a random position within APPROX_MAX_LAT of the 
+ * Equator, a bearing, a distance up to APPROX_MAX_DIST and a threshold 
+ * distance up to APPROX_MAX_DIST. Returns nothing.
+ */
+
+static void gen_approx(unsigned short *xsubi, double *v)
+{
+	v[0] = prop_rand(xsubi, -APPROX_MAX_LAT, APPROX_MAX_LAT);
+	v[1] = prop_lon(xsubi);
+	v[2] = prop_rand(xsubi, 0.0, 360.0);
+	v[3] = prop_rand(xsubi, 0.0, APPROX_MAX_DIST);
+	v[4] = prop_rand(xsubi, 0.0, APPROX_MAX_DIST);
+}
+
+/*
+ * gen_cell_border() - Generates a random position where the latitude and 
+ * longitude are moved to a border between geohash cells in half of the cases, 
+ * or just below it, and a random geohash length. Returns nothing.
+ */
+
+static void gen_cell_border(unsigned short *xsubi, double *v)
+{
+	v[0] = prop_lat(xsubi);
+	v[1] = prop_lon(xsubi);
+	if (erand48(xsubi) < 0.5) {
+		const int bits = 1 + (int)(erand48(xsubi) * GEOHASH_BITS);
+		const double lasize = ldexp(180.0, -bits),
+		             losize = ldexp(360.0, -bits);
+
+		v[0] = -90.0 + round((v[0] + 90.0) / lasize) * lasize;
+		v[1] = -180.0 + round((v[1] + 180.0) / losize) * losize;
+		if (erand48(xsubi) < 0.5) {
+			v[0] = nextafter(v[0], -90.0);
+			v[1] = nextafter(v[1], -180.0);
+		}
+	}
+	v[2] = floor(prop_rand(xsubi, 1.0, GEOHASH_MAX_LEN + 1.0));
+}
+
+/*
+ * valid_2pos() - Returns true if the 2 positions in `v` are neither antipodal, 
+ * coincident or closer to the antipode than 1 km. Otherwise, it returns false.
+ */
+
+static bool valid_2pos(const double *v)
+{
+	if (are_antipodal(v[0], v[1], v[2], v[3])
+	    || (v[0] == v[2] && v[1] == v[3]))
+		return false;
+
+	return haversine(v[0], v[1], v[2], v[3])
+	       <= MAX_EARTH_DISTANCE - 1000.0;
+}
+
+/*
+ * prop_haversine_sym() - haversine(a, b) is equal to haversine(b, a).
+ */
+
+static int prop_haversine_sym(const double *v)
+{
+	return fabs(haversine(v[0], v[1], v[2], v[3])
+	            - haversine(v[2], v[3], v[0], v[1])) > 1e-9;
+}
+
+/*
+ * prop_karney_sym() - karney_distance(a, b) is equal to karney_distance(b, 
+ * a).
+ */
+
+static int prop_karney_sym(const double *v)
+{
+	return fabs(karney_distance(v[0], v[1], v[2], v[3])
+	            - karney_distance(v[2], v[3], v[0], v[1])) > 1e-6;
+}
+
+/*
+ * prop_antipode_twice() - set_antipode() applied twice returns the original 
+ * position. The longitude at the poles and ±180 are ambiguous, so the 
+ * positions are compared by distance.
+ */
+
+static int prop_antipode_twice(const double *v)
+{
+	double lat = v[0], lon = v[1];
+
+	set_antipode(&lat, &lon);
+	set_antipode(&lat, &lon);
+
+	return haversine(lat, lon, v[0], v[1]) > 1e-6;
+}
+
+/*
+ * prop_antipode_dist() - The distance to the antipode is MAX_EARTH_DISTANCE. 
+ * The Haversine formula is ill-conditioned close to the antipode, with errors 
+ * up to ≈0.2 m.
+ */
+
+static int prop_antipode_dist(const double *v)
+{
+	double lat = v[0], lon = v[1];
+
+	set_antipode(&lat, &lon);
+
+	return fabs(haversine(v[0], v[1], lat, lon) - MAX_EARTH_DISTANCE)
+	       > 0.5;
+}
+
+/*
+ * pole_tolerance() - Returns the allowed error in meters for a calculated 
+ * position at latitude `lat`. asin() in bearing_position() is ill-conditioned 
+ * close to the poles, with errors up to ≈0.15 m.
+ */
+
+static double pole_tolerance(const double lat)
+{
+	return fabs(lat) > 89.99 ? 0.5 : 1e-3;
+}
+
+/*
+ * prop_bpos_dist() - The distance from the start position to the position 
+ * calculated by bearing_position() is the distance that was used. 
+ * bearing_position() moves exact pole positions ≈1 cm, so they're not checked 
+ * here.
+ */
+
+static int prop_bpos_dist(const double *v)
+{
+	double lat, lon;
+
+	if (fabs(v[0]) == 90.0 || v[3] < 0.0
+	    || v[3] > MAX_EARTH_DISTANCE - 1000.0)
+		return 0;
+	if (bearing_position(v[0], v[1], v[2], v[3], &lat, &lon))
+		return 1; /* gncov */
+
+	return fabs(haversine(v[0], v[1], lat, lon) - v[3])
+	       > pole_tolerance(lat);
+}
+
+/*
+ * prop_bpos_bear() - The initial bearing from the start position towards the 
+ * position calculated by bearing_position() is the bearing that was used. The 
+ * bearing is undefined at the poles, and it's imprecise for very short 
+ * distances.
+ */
+
+static int prop_bpos_bear(const double *v)
+{
+	double lat, lon;
+
+	if (fabs(v[0]) > 89.99 || v[3] < 1.0
+	    || v[3] > MAX_EARTH_DISTANCE - 1000.0)
+		return 0;
+	if (bearing_position(v[0], v[1], v[2], v[3], &lat, &lon))
+		return 1; /* gncov */
+
+	return angle_diff(initial_bearing(v[0], v[1], lat, lon), v[2]) > 1e-6;
+}
+
+/*
+ * prop_routepoint_0() - routepoint() with `fracdist` 0 returns the start 
+ * position.
+ */
+
+static int prop_routepoint_0(const double *v)
+{
+	double lat, lon;
+
+	if (!valid_2pos(v))
+		return 0;
+	if (routepoint(v[0], v[1], v[2], v[3], 0.0, &lat, &lon))
+		return 1; /* gncov */
+
+	return haversine(lat, lon, v[0], v[1]) > 1e-3;
+}
+
+/*
+ * prop_routepoint_1() - routepoint() with `fracdist` 1 returns the end 
+ * position. Routes that start at the exact poles aren't checked, the longitude 
+ * calculation after the ≈1 cm adjustment in bearing_position() has errors up 
+ * to ≈1 m.
+ */
+
+static int prop_routepoint_1(const double *v)
+{
+	double lat, lon;
+
+	if (!valid_2pos(v) || fabs(v[0]) == 90.0)
+		return 0;
+	if (routepoint(v[0], v[1], v[2], v[3], 1.0, &lat, &lon))
+		return 1; /* gncov */
+
+	return haversine(lat, lon, v[2], v[3]) > pole_tolerance(v[2]);
+}
+
+/*
+ * prop_rand_pos() - rand_pos() returns a position inside the distance range. 
+ * The order of the distances doesn't matter. If the distances are equal, 
+ * rand_pos() uses bearing_position() directly without checking the distance, 
+ * so a small error is allowed.
+ */
+
+static int prop_rand_pos(const double *v)
+{
+	const double maxdist = fmax(v[2], v[3]), mindist = fmin(v[2], v[3]);
+	const double tolerance = mindist == maxdist ? 0.5 : 0.0;
+	double lat, lon, dist;
+
+	if (fabs(v[0]) > 90.0 || fabs(v[1]) > 180.0 || mindist <= 0.0
+	    || maxdist > MAX_EARTH_DISTANCE)
+		return 0;
+	rand_pos(&lat, &lon, v[0], v[1], v[2], v[3]);
+	dist = haversine(v[0], v[1], lat, lon);
+
+	return dist < mindist - tolerance || dist > maxdist + tolerance;
+}
+
+/*
+ * same_double() - Returns true if `a` and `b` are identical, NaN is equal to 
+ * NaN. Otherwise, it returns false.
+ */
+
+static bool same_double(const double a, const double b)
+{
+	return a == b || (isnan(a) && isnan(b));
+}
+
+/*
+ * batch_differs() - Returns 1 if distance_batch() or bearing_batch() with 
+ * `formula` return different values than distance() and bearing() for the 
+ * route from the first position in `v` to the second one and back again. 
+ * Otherwise, it returns 0.
+ */
+
+static int batch_differs(const DistFormula formula, const double *v)
+{
+	const double lat[3] = { v[0], v[2], v[0] };
+	const double lon[3] = { v[1], v[3], v[1] };
+	double dist[2], bear[2];
+	size_t i;
+
+	distance_batch(formula, &WGS84, lat, lon, 3, dist);
+	bearing_batch(formula, &WGS84, lat, lon, 3, bear);
+	for (i = 0; i < 2; i++) {
+		if (!same_double(dist[i], distance(formula, &WGS84,
+		                                   lat[i], lon[i],
+		                                   lat[i + 1], lon[i + 1]))
+		    || !same_double(bear[i],
+		                    bearing(formula, &WGS84, lat[i], lon[i],
+		                            lat[i + 1], lon[i + 1])))
+			return 1; /* gncov */
+	}
+
+	return 0;
+}
+
+/*
+ * prop_haversine_batch() - distance_batch() and bearing_batch() return 
+ * exactly the same values as haversine() and initial_bearing().
+ */
+
+static int prop_haversine_batch(const double *v)
+{
+	return batch_differs(FRM_HAVERSINE, v);
+}
+
+/*
+ * prop_karney_batch() - distance_batch() and bearing_batch() return exactly 
+ * the same values as karney_distance() and karney_bearing().
+ */
+
+static int prop_karney_batch(const double *v)
+{
+	return batch_differs(FRM_KARNEY, v);
+}
+
+/*
+ * approx_exceeds() - Used by the property tests of the approximate distance 
+ * formulas. Moves `v[3]` meters from `v[0],v[1]` in the direction `v[2]` and 
+ * returns 1 if the relative error of `formula` compared to the exact formula 
+ * is larger than its bound from approx_error() plus APPROX_ABS_ERROR meters. 
+ * Returns 0 if it's within the bound, or if the positions are outside the 
+ * range where the bound is valid.
+ */
+
+static int approx_exceeds(const DistFormula formula, const double *v)
+{
+	DistFormula exact;
+	const double err = approx_error(formula, &exact);
+	double lat, lon, dist;
+
+	if (bearing_position(v[0], v[1], v[2], v[3], &lat, &lon))
+		return 1; /* gncov */
+	dist = distance(exact, &WGS84, v[0], v[1], lat, lon);
+	if (fabs(lat) > APPROX_MAX_LAT || dist > APPROX_MAX_DIST)
+		return 0;
+
+	return fabs(distance(formula, &WGS84, v[0], v[1], lat, lon) - dist)
+	       > err * dist + APPROX_ABS_ERROR;
+}
+
+/*
+ * prop_equirect_error() - The relative error of equirect_distance() is 
+ * within EQUIRECT_MAX_ERROR.
+ */
+
+static int prop_equirect_error(const double *v)
+{
+	return approx_exceeds(FRM_EQUIRECT, v);
+}
+
+/*
+ * prop_cheapruler_error() - The relative error of cheapruler_distance() is 
+ * within CHEAPRULER_MAX_ERROR.
+ */
+
+static int prop_cheapruler_error(const double *v)
+{
+	return approx_exceeds(FRM_CHEAPRULER, v);
+}
+
+/*
+ * prop_haversine32_error() - The relative error of haversine32() is within 
+ * HAVERSINE32_MAX_ERROR.
+ */
+
+static int prop_haversine32_error(const double *v)
+{
+	return approx_exceeds(FRM_HAVERSINE32, v);
+}
+
+/*
+ * prop_threshold() - threshold_distance() with an approximate formula is on 
+ * the same side of the threshold `v[4]` as the exact distance.
+ */
+
+static int prop_threshold(const double *v)
+{
+	const DistFormula f[] = { FRM_CHEAPRULER, FRM_EQUIRECT,
+	                          FRM_HAVERSINE32 };
+	double lat, lon;
+	size_t i;
+
+	if (bearing_position(v[0], v[1], v[2], v[3], &lat, &lon))
+		return 1; /* gncov */
+	for (i = 0; i < sizeof(f) / sizeof(f[0]); i++) {
+		DistFormula exact;
+		double dist;
+
+		approx_error(f[i], &exact);
+		dist = distance(exact, &WGS84, v[0], v[1], lat, lon);
+		if (dist > APPROX_MAX_DIST)
+			continue;
+		if ((threshold_distance(f[i], &WGS84, v[0], v[1], lat, lon,
+		                        v[4]) <= v[4]) != (dist <= v[4]))
+			return 1; /* gncov */
+	}
+
+	return 0;
+}
+
+/*
+ * prop_arc_midpoint() - arc_angle() of the midpoint of an arc, calculated 
+ * with routepoint(), is 0. Arcs that start at the exact poles aren't checked, 
+ * see prop_routepoint_1().
+ */
+
+static int prop_arc_midpoint(const double *v)
+{
+	struct vec3 a, b, p;
+	struct arc arc;
+	double lat, lon;
+
+	if (!valid_2pos(v) || fabs(v[0]) == 90.0)
+		return 0;
+	if (routepoint(v[0], v[1], v[2], v[3], 0.5, &lat, &lon))
+		return 1; /* gncov */
+	pos_to_vec3(v[0], v[1], &a);
+	pos_to_vec3(v[2], v[3], &b);
+	pos_to_vec3(lat, lon, &p);
+	arc_init(&arc, &a, &b);
+
+	return arc_angle(&arc, &p) * EARTH_RADIUS > pole_tolerance(lat);
+}
+
+/*
+ * prop_arc_endpoints() - arc_angle() is never larger than the distance to the 
+ * nearest endpoint of the arc.
+ */
+
+static int prop_arc_endpoints(const double *v)
+{
+	struct vec3 a, b, p;
+	struct arc arc;
+	double ang;
+
+	pos_to_vec3(v[0], v[1], &a);
+	pos_to_vec3(v[2], v[3], &b);
+	pos_to_vec3(v[4], v[5], &p);
+	arc_init(&arc, &a, &b);
+	ang = arc_angle(&arc, &p);
+
+	return !(ang >= 0.0)
+	       || ang > fmin(vec3_angle(&p, &a), vec3_angle(&p, &b)) + 1e-15;
+}
+
+/*
+ * prop_polyline_nearest() - The distance from polyline_nearest() is the 
+ * smallest arc_angle() of all legs in a route with 2 legs, regardless of the 
+ * hint. The route is the first 3 positions, the 4th position is the position 
+ * that is checked.
+ */
+
+static int prop_polyline_nearest(const double *v)
+{
+	struct polyline pl;
+	struct vec3 p;
+	double xt0, at0, xt1, at1, exp, len;
+	size_t leg0, leg1;
+
+	polyline_init(&pl);
+	if (polyline_add(&pl, v[0], v[1]) || polyline_add(&pl, v[2], v[3])
+	    || polyline_add(&pl, v[4], v[5])) {
+		polyline_free(&pl); /* gncov */
+		return 1; /* gncov */
+	}
+	pos_to_vec3(v[6], v[7], &p);
+	leg0 = polyline_nearest(&pl, &p, 0, &xt0, &at0);
+	leg1 = polyline_nearest(&pl, &p, 1, &xt1, &at1);
+	exp = fmin(arc_angle(&pl.legs[0].arc, &p),
+	           arc_angle(&pl.legs[1].arc, &p));
+	len = compsum_result(&pl.len);
+	polyline_free(&pl);
+
+	return leg0 != leg1 || !same_double(xt0, xt1)
+	       || !same_double(at0, at1) || fabs(xt0) != exp
+	       || at0 < 0.0 || at0 > len + 1e-15;
+}
+
+/*
+ * prop_polygon_order() - polygon_contains() gives the same result for a 
+ * triangle regardless of the order of the vertices. Triangles larger than a 
+ * hemisphere are skipped. Returns 0 if ok, otherwise 1.
+ */
+
+static int prop_polygon_order(const double *v)
+{
+	const double lat[3] = { v[0], v[2], v[4] },
+	             lon[3] = { v[1], v[3], v[5] },
+	             rlat[3] = { v[2], v[0], v[4] },
+	             rlon[3] = { v[3], v[1], v[5] };
+	struct polygon pg1, pg2;
+	struct vec3 p;
+	int retval;
+
+	if (polygon_init(&pg1, lat, lon, 3))
+		return 1; /* gncov */
+	if (polygon_init(&pg2, rlat, rlon, 3)) {
+		polygon_free(&pg1); /* gncov */
+		return 1; /* gncov */
+	}
+	pos_to_vec3(v[6], v[7], &p);
+	retval = pg1.cap.radius < M_PI / 2.0
+	         && polygon_contains(&pg1, &p) != polygon_contains(&pg2, &p);
+	polygon_free(&pg2);
+	polygon_free(&pg1);
+
+	return retval;
+}
+
+/*
+ * bisect_geohash() - Reference implementation of the geohash of `lat, lon` 
+ * with `len` characters, one bit at a time by repeated bisection as in the 
+ * original definition. Returns nothing.
+ */
+
+static void bisect_geohash(const double lat, const double lon,
+                           const size_t len, char *dest)
+{
+	static const char chars[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+	double range[2][2] = { { -180.0, 180.0 }, { -90.0, 90.0 } };
+	const double val[2] = { lon, lat };
+	size_t i, bit = 0;
+
+	for (i = 0; i < len; i++) {
+		int c = 0, j;
+
+		for (j = 0; j < 5; j++, bit++) {
+			double *r = range[bit % 2];
+			const double mid = (r[0] + r[1]) / 2.0;
+
+			c <<= 1;
+			if (val[bit % 2] >= mid) {
+				c |= 1;
+				r[0] = mid;
+			} else {
+				r[1] = mid;
+			}
+		}
+		dest[i] = chars[c];
+	}
+	dest[len] = '\0';
+}
+
+/*
+ * prop_geohash_bisect() - geohash_encode() is identical to repeated 
+ * bisection.
+ */
+
+static int prop_geohash_bisect(const double *v)
+{
+	char hash[GEOHASH_MAX_LEN + 1], exp[GEOHASH_MAX_LEN + 1];
+	const size_t len = (size_t)v[2];
+
+	if (len < 1 || len > GEOHASH_MAX_LEN)
+		return 0;
+	if (geohash_encode(v[0], v[1], len, hash))
+		return 1; /* gncov */
+	bisect_geohash(v[0], v[1], len, exp);
+
+	return !!strcmp(hash, exp);
+}
+
+/*
+ * prop_geohash_neighbour() - Going one cell north-east and then one cell 
+ * south-west with geohash_neighbour() returns to the same geohash, unless 
+ * the first cell is beyond the North Pole.
+ */
+
+static int prop_geohash_neighbour(const double *v)
+{
+	char hash[GEOHASH_MAX_LEN + 1], ne[GEOHASH_MAX_LEN + 1],
+	     back[GEOHASH_MAX_LEN + 1];
+	const size_t len = (size_t)v[2];
+
+	if (len < 1 || len > GEOHASH_MAX_LEN)
+		return 0;
+	if (geohash_encode(v[0], v[1], len, hash))
+		return 1; /* gncov */
+	if (geohash_neighbour(hash, 1, 1, ne))
+		return 0;
+	if (geohash_neighbour(ne, -1, -1, back))
+		return 1; /* gncov */
+
+	return !!strcmp(hash, back);
+}
+
+/*
+ * num_decimals() - Returns the number of decimals needed to represent `x`, or 
+ * 16 if `x` needs more than 15 decimals.
+ */
+
+static int num_decimals(const double x)
+{
+	double mult = 1.0;
+	int i;
+
+	for (i = 0; i <= 15; i++) {
+		if (round(x * mult) / mult == x)
+			return i;
+		mult *= 10.0;
+	}
+
+	return 16;
+}
+
+/*
+ * simpler_value() - Returns true if `a` is simpler than `b`, i.e. it has fewer 
+ * decimals, or the same number of decimals and a smaller absolute value. 
+ * Otherwise, it returns false.
+ */
+
+static bool simpler_value(const double a, const double b)
+{
+	const int da = num_decimals(a), db = num_decimals(b);
+
+	return da < db || (da == db && fabs(a) < fabs(b));
+}
+
+/*
+ * shrink_value() - Returns candidate number `n` (0-8) for a simpler version of 
+ * `x`. The candidates are ordered from the simplest to the most complex: 0, 
+ * the integer part, `x` rounded to 1-6 decimals, and `x` divided by 2.
+ */
+
+static double shrink_value(const double x, const int n)
+{
+	double mult;
+
+	if (n == 0)
+		return 0.0;
+	if (n == 1)
+		return trunc(x);
+	if (n <= 7) {
+		mult = pow(10.0, n - 1);
+		return round(x * mult) / mult;
+	}
+
+	return x / 2.0;
+}
+
+/*
+ * shrink_input() - Replaces the values in `v` with simpler values as long as 
+ * the check function of property `p` still fails. Since every step makes a 
+ * value simpler according to simpler_value(), it always terminates. Returns 
+ * the number of successful shrinking steps.
+ */
+
+static unsigned int shrink_input(const struct Property *p, double *v)
+{
+	unsigned int steps = 0;
+	bool progress = true;
+
+	assert(p);
+	assert(v);
+
+	while (progress) {
+		size_t i;
+
+		progress = false;
+		for (i = 0; i < p->numvals && !progress; i++) {
+			const double orig = v[i];
+			int n;
+
+			for (n = 0; n <= 8; n++) {
+				const double cand = shrink_value(orig, n);
+
+				if (!simpler_value(cand, orig))
+					continue;
+				v[i] = cand;
+				if (p->check(v)) {
+					progress = true;
+					steps++;
+					break;
+				}
+				v[i] = orig;
+			}
+		}
+	}
+
+	return steps;
+}
+
+/*
+ * values_str() - Returns an allocated string with the first `num` values in 
+ * `v`, separated by ", ". The values are printed with 15 significant digits 
+ * if that's enough to recreate the exact value, otherwise 17 digits are used. 
+ * Returns NULL if allocstr() fails.
+ */
+
+static char *values_str(const double *v, const size_t num)
+{
+	char *s = mystrdup(""), *p, buf[32];
+	size_t i;
+
+	for (i = 0; i < num && s; i++) {
+		snprintf(buf, sizeof(buf), "%.15g", v[i]);
+		if (strtod(buf, NULL) != v[i])
+			snprintf(buf, sizeof(buf), "%.17g", v[i]);
+		p = allocstr("%s%s%s", s, i ? ", " : "", buf);
+		free(s);
+		s = p;
+	}
+
+	return s;
+}
+
+/*
+ * run_property() - Checks the property `p` with pseudo-random input values. 
+ * The random sequence is created from `seed` and `propnum`, the number of the 
+ * property, so every property gets its own sequence. `iterations` is divided 
+ * by the `divisor` member of `p`. If the property fails, the input values are 
+ * shrunk and printed. Returns 0 if the property held for all input values, 
+ * otherwise 1.
+ */
+
+static int run_property(const int linenum, const struct Property *p,
+                        const long seed, const size_t propnum,
+                        const long iterations)
+{
+	unsigned short xsubi[3];
+	double v[PROP_MAXVALS], orig[PROP_MAXVALS];
+	long l, num = iterations / p->divisor;
+
+	assert(p);
+	assert(p->numvals <= PROP_MAXVALS);
+
+	xsubi[0] = (unsigned short)(0x330e + propnum);
+	xsubi[1] = (unsigned short)(seed & 0xffff);
+	xsubi[2] = (unsigned short)((seed >> 16) & 0xffff);
+	srand48(seed + (long)propnum);
+
+	for (l = 0; l < num; l++) {
+		p->gen(xsubi, v);
+		if (p->check(v)) {
+			char *s1, *s2; /* gncov */
+			unsigned int steps; /* gncov */
+
+			memcpy(orig, v, sizeof(v)); /* gncov */
+			steps = shrink_input(p, v); /* gncov */
+			s1 = values_str(orig, p->numvals); /* gncov */
+			s2 = values_str(v, p->numvals); /* gncov */
+			OK_ERROR_L(linenum, "Property: %s, failed after" /* gncov */
+			           " %ld of %ld iterations", p->desc, l + 1,
+			           num);
+			diag("Repeat with --seed %ld", seed); /* gncov */
+			diag("input = %s", no_null(s1)); /* gncov */
+			diag("shrunk input (%u steps) = %s", /* gncov */
+			     steps, no_null(s2));
+			free(s2); /* gncov */
+			free(s1); /* gncov */
+			return 1; /* gncov */
+		}
+	}
+
+	return OK_SUCCESS_L(0, linenum, "Property: %s (%ld iterations)",
+	                    p->desc, num);
+}
+
+/*
+ * fail_above_100() - Check function used by test_shrink_input(), fails if 
+ * any of the values are above 100.
+ */
+
+static int fail_above_100(const double *v)
+{
+	return v[0] > 100.0 || v[1] > 100.0;
+}
+
+/*
+ * test_shrink_input() - Tests the shrink_input() function. Returns nothing.
+ */
+
+static void test_shrink_input(void)
+{
+	const struct Property p = {
+		"values are at most 100", 2, 1, gen_pos, fail_above_100
+	};
+	double v[2];
+	char *s;
+
+	diag("Test shrink_input()");
+
+	v[0] = 1234.5678;
+	v[1] = 98.7654321;
+	OK_TRUE(shrink_input(&p, v) > 0, "shrink_input(): Values are shrunk");
+	s = values_str(v, 2);
+	OK_STRCMP(no_null(s), "617, 0", "shrink_input(): Result is correct");
+	free(s);
+
+	v[0] = 12.3;
+	v[1] = 45.6;
+	OK_EQUAL(shrink_input(&p, v), 0,
+	         "shrink_input(): Passing values aren't shrunk");
+
+	OK_EQUAL(num_decimals(12.345), 3, "num_decimals(12.345)");
+	OK_EQUAL(num_decimals(1.0 / 3.0), 16, "num_decimals(1.0 / 3.0)");
+	v[0] = 0.1 + 0.2;
+	v[1] = -1.5;
+	s = values_str(v, 2);
+	OK_STRCMP(no_null(s), "0.30000000000000004, -1.5",
+	          "values_str() uses 17 digits when needed");
+	free(s);
+}
+
+/*
+ * test_properties() - Runs the property tests. The number of iterations for 
+ * each property is PROP_ITERATIONS multiplied by the --count value. Returns 
+ * nothing.
+ */
+
+static void test_properties(const struct Options *o)
+{
+	const struct Property props[] = {
+		{ "haversine() is symmetric",
+		  4, 1, gen_2pos, prop_haversine_sym },
+		{ "karney_distance() is symmetric",
+		  4, 20, gen_2pos, prop_karney_sym },
+		{ "set_antipode() twice returns the original position",
+		  2, 1, gen_pos, prop_antipode_twice },
+		{ "Distance to the antipode is MAX_EARTH_DISTANCE",
+		  2, 1, gen_pos, prop_antipode_dist },
+		{ "Distance to bearing_position() is the used distance",
+		  4, 1, gen_pos_bear_dist, prop_bpos_dist },
+		{ "Bearing to bearing_position() is the used bearing",
+		  4, 1, gen_pos_bear_dist, prop_bpos_bear },
+		{ "routepoint() at 0 is the start position",
+		  4, 1, gen_2pos, prop_routepoint_0 },
+		{ "routepoint() at 1 is the end position",
+		  4, 1, gen_2pos, prop_routepoint_1 },
+		{ "rand_pos() is inside the distance range",
+		  4, 20, gen_pos_2dist, prop_rand_pos },
+		{ "Haversine batch functions are identical to scalar ones",
+		  4, 1, gen_2pos, prop_haversine_batch },
+		{ "Karney batch functions are identical to scalar ones",
+		  4, 20, gen_2pos, prop_karney_batch },
+		{ "equirect_distance() is within EQUIRECT_MAX_ERROR",
+		  5, 1, gen_approx, prop_equirect_error },
+		{ "cheapruler_distance() is within CHEAPRULER_MAX_ERROR",
+		  5, 20, gen_approx, prop_cheapruler_error },
+		{ "haversine32() is within HAVERSINE32_MAX_ERROR",
+		  5, 1, gen_approx, prop_haversine32_error },
+		{ "threshold_distance() agrees with the exact distance",
+		  5, 20, gen_approx, prop_threshold },
+		{ "arc_angle() of the midpoint of an arc is 0",
+		  4, 1, gen_2pos, prop_arc_midpoint },
+		{ "arc_angle() isn't larger than the distance to the endpoints",
+		  6, 1, gen_3pos, prop_arc_endpoints },
+		{ "polyline_nearest() is the nearest leg of a route",
+		  8, 1, gen_4pos, prop_polyline_nearest },
+		{ "polygon_contains() doesn't depend on the vertex order",
+		  8, 1, gen_4pos, prop_polygon_order },
+		{ "geohash_encode() is identical to repeated bisection",
+		  3, 1, gen_cell_border, prop_geohash_bisect },
+		{ "geohash_neighbour() north-east and back is the same cell",
+		  3, 1, gen_cell_border, prop_geohash_neighbour },
+	};
+	size_t i;
+
+	assert(o);
+
+	if (!o->testfunc && !o->testprop)
+		return; /* gncov */
+
+	diag("Property tests, seed = %ld", o->seedval);
+	test_shrink_input();
+	for (i = 0; i < sizeof(props) / sizeof(props[0]); i++)
+		run_property(__LINE__, &props[i], o->seedval, i,
+		             PROP_ITERATIONS * o->count);
+}
+
+/******************************************************************************
+                           Test the executable file
+******************************************************************************/
+
+                         /****** Option tests ******/
+
+                             /*** --valgrind ***/
+
+/*
+ * test_valgrind_option() - Tests the --valgrind command line option. Returns 
+ * nothing.
+ */
+
+static void test_valgrind_option(const struct Options *o)
+{
+	struct streams ss;
+
+	assert(o);
+	diag("Test --valgrind");
+
+	if (o->valgrind) {
+		struct Options mod_opt = *o; /* gncov */
+
+		mod_opt.valgrind = false; /* gncov */
+		streams_init(&ss); /* gncov */
+		streams_exec(&mod_opt, &ss, chp{ "valgrind", /* gncov */
+		                                 "--version", NULL });
+		if (!strstr(ss.out.buf, "valgrind-")) { /* gncov */
+			OK_ERROR("Valgrind is not installed," /* gncov */
+			         " disabling Valgrind checks");
+			set_opt_valgrind(false); /* gncov */
+		} else {
+			OK_SUCCESS(0, "Valgrind is installed"); /* gncov */
+		}
+		streams_free(&ss); /* gncov */
+	}
+
+	scx((chp{ execname, "--valgrind", "-h", NULL }),
+	   "Show this",
+	   "",
+	   EXIT_SUCCESS,
+	   "--valgrind -h");
+}
+
+                          /*** Standard options ***/
+
+/*
+ * test_standard_options() - Tests the various generic options available in 
+ * most programs. Returns nothing.
+ */
+
+static void test_standard_options(void)
+{
+	char *s;
+
+	diag("Test standard options");
+
+	diag("Test -h/--help");
+	scx((chp{ execname, "-h", NULL }),
+	   "  Show this help",
+	   "",
+	   EXIT_SUCCESS,
+	   "-h");
+	sc((chp{ execname, "--help", NULL }),
+	   "  Show this help",
+	   "",
+	   EXIT_SUCCESS,
+	   "--help");
+
+	diag("Test -v/--verbose");
+	sc((chp{ execname, "-h", "--verbose", NULL }),
+	   "  Show this help",
+	   "",
+	   EXIT_SUCCESS,
+	   "-hv: Help text is displayed");
+	sc((chp{ execname, "-hv", NULL }),
+	   EXEC_VERSION,
+	   "",
+	   EXIT_SUCCESS,
+	   "-hv: Version number is printed along with the help text");
+	sc((chp{ execname, "-vvv", "--verbose", "--help", NULL }),
+	   "  Show this help",
+	   EXECSTR ": run_program(): Using verbose level 4\n",
+	   EXIT_SUCCESS,
+	   "-vvv --verbose: Using correct verbose level");
+	sc((chp{ execname, "-vvvvq", "-v", "--verbose", "--help", NULL }),
+	   "  Show this help",
+	   EXECSTR ": run_program(): Using verbose level 5\n",
+	   EXIT_SUCCESS,
+	   "--verbose: One -q reduces the verbosity level");
+
+	diag("Test --version");
+	s = allocstr("%s %s (%s)\n", execname, EXEC_VERSION, EXEC_DATE);
+	if (s) {
+		scx((chp{ execname, "--version", NULL }),
+		   s,
+		   "",
+		   EXIT_SUCCESS,
+		   "--version");
+		free(s);
+	} else {
+		failed_ok("allocstr()"); /* gncov */
+	}
+	tc((chp{ execname, "--version", "-q", NULL }),
+	   EXEC_VERSION "\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--version with -q shows only the version number");
+
+	diag("Test --license");
+	scx((chp{ execname, "--license", NULL }),
+	   "GNU General Public License",
+	   "",
+	   EXIT_SUCCESS,
+	   "--license: It's GPL");
+	sc((chp{ execname, "--license", NULL }),
+	   "either version 2 of the License",
+	   "",
+	   EXIT_SUCCESS,
+	   "--license: It's version 2 of the GPL");
+
+	diag("Unknown option");
+	scx((chp{ execname, "--gurgle", NULL }),
+	   "",
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "Unknown option: \"Option error\" message is printed");
+}
+
+                               /*** --approx ***/
+
+/*
+ * test_approx_option() - Tests the --approx option. Returns nothing.
+ */
+
+static void test_approx_option(void)
+{
+	diag("Test --approx");
+	tc((chp{ execname, "--approx", "equirect", "dist", "60,10",
+	         "60.5,10.5", NULL }),
+	   "62066.066221\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--approx equirect dist");
+	tc((chp{ execname, "--approx", "cheapruler", "dist", "60,10",
+	         "60.5,10.5", NULL }),
+	   "62210.161224\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--approx cheapruler dist");
+	tc((chp{ execname, "--approx", "haversine32", "dist", "60,10",
+	         "60.5,10.5", NULL }),
+	   "62065.636147\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--approx haversine32 dist");
+	tc((chp{ execname, "--approx", "xyz", "dist", "60,10", "60.5,10.5",
+	         NULL }),
+	   "",
+	   EXECSTR ": xyz: Unknown approximation\n" OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--approx xyz");
+	tc((chp{ execname, "--approx", "", "dist", "60,10", "60.5,10.5",
+	         NULL }),
+	   "",
+	   EXECSTR ": : Unknown approximation\n" OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--approx with an empty argument");
+	tc((chp{ execname, "--approx", "equirect", "bear", "60,10",
+	         "60.5,10.5", NULL }),
+	   "",
+	   EXECSTR ": --approx is not supported by the bear command\n",
+	   EXIT_FAILURE,
+	   "--approx equirect bear");
+}
+
+                              /*** --ellipsoid ***/
+
+/*
+ * test_ellipsoid_option() - Tests the --ellipsoid option. Returns nothing.
+ */
+
+static void test_ellipsoid_option(void)
+{
+	diag("Test --ellipsoid");
+	sc((chp{ execname, "-vvvv", "--ellipsoid", "EllIpsoid", NULL }),
+	   "",
+	   EXECSTR ": setup_options(): o.ellipsoid = \"EllIpsoid\"\n",
+	   EXIT_FAILURE,
+	   "-vvvv --ellipsoid EllIpsoid: o.ellipsoid is correct");
+	tc((chp{ execname, "--ellipsoid", "EllIpsoid", "-K", "dist", "60,10",
+	         "-33.9,18.4", NULL }),
+	   "",
+	   EXECSTR ": EllIpsoid: Unknown ellipsoid\n",
+	   EXIT_FAILURE,
+	   "--ellipsoid EllIpsoid");
+	tc((chp{ execname, "--ellipsoid", "", "-K", "dist", "60,10",
+	         "-33.9,18.4", NULL }),
+	   "10435269.07584792\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--ellipsoid with an empty argument uses WGS84");
+	tc((chp{ execname, "--ellipsoid", "default", "-K", "dist", "60,10",
+	         "-33.9,18.4", NULL }),
+	   "10435269.07584792\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--ellipsoid default");
+	tc((chp{ execname, "--ellipsoid", "grs80", "-K", "dist", "60,10",
+	         "-33.9,18.4", NULL }),
+	   "10435269.07562199\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--ellipsoid grs80 -K dist");
+	tc((chp{ execname, "--ellipsoid", "clarke1866", "-K", "bear", "60,10",
+	         "-33.9,18.4", NULL }),
+	   "172.99520042\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--ellipsoid clarke1866 -K bear");
+	tc((chp{ execname, "--ellipsoid", "authalic", "-K", "bear", "60,10",
+	         "-33.9,18.4", NULL }),
+	   "173.01725981\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--ellipsoid authalic -K bear is the spherical bearing");
+	tc((chp{ execname, "--ellipsoid", "6371000,0", "dist", "60,10",
+	         "-33.9,18.4", NULL }),
+	   "10469637.863603\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--ellipsoid doesn't affect the Haversine formula");
+	tc((chp{ execname, "--ellipsoid", "6371000,0", "-K", "dist", "60,10",
+	         "-33.9,18.4", NULL }),
+	   "10469637.86360273\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--ellipsoid 6371000,0 -K dist");
+	tci((chp{ execname, "--ellipsoid", "6378388,297", "convert", "geo",
+	          "ecef", NULL }),
+	    "60,10,100\n",
+	    "3148740.102,555207.835,5500682.183\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--ellipsoid 6378388,297 convert geo ecef");
+	tci((chp{ execname, "--ellipsoid", "authalic", "convert", "geo",
+	          "ecef", NULL }),
+	    "90,0\n",
+	    "0.0,0.0,6371007.181\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--ellipsoid authalic convert geo ecef");
+	tci((chp{ execname, "--ellipsoid", "clarke1866", "convert", "geo",
+	          "utm", NULL }),
+	    "60,10\n",
+	    "32V,555778.435,6651626.188,0.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--ellipsoid clarke1866 convert geo utm");
+	tc((chp{ execname, "--ellipsoid", "6378137", "-K", "dist", "0,0",
+	         "1,1", NULL }),
+	   "",
+	   EXECSTR ": 6378137: Unknown ellipsoid\n",
+	   EXIT_FAILURE,
+	   "--ellipsoid 6378137: The flattening is missing");
+	tc((chp{ execname, "--ellipsoid", "x,298", "-K", "dist", "0,0", "1,1",
+	         NULL }),
+	   "",
+	   EXECSTR ": x,298: Invalid --ellipsoid argument\n",
+	   EXIT_FAILURE,
+	   "--ellipsoid x,298");
+	tc((chp{ execname, "--ellipsoid", "0,298", "-K", "dist", "0,0", "1,1",
+	         NULL }),
+	   "",
+	   EXECSTR ": 0,298: Invalid --ellipsoid argument\n",
+	   EXIT_FAILURE,
+	   "--ellipsoid 0,298: The semi-major axis is 0");
+	tc((chp{ execname, "--ellipsoid", "6378137,1", "-K", "dist", "0,0",
+	         "1,1", NULL }),
+	   "",
+	   EXECSTR ": 6378137,1: Invalid --ellipsoid argument\n",
+	   EXIT_FAILURE,
+	   "--ellipsoid 6378137,1: The inverse flattening is 1");
+	tc((chp{ execname, "--ellipsoid", "6378137,298,", "-K", "dist",
+	         "0,0", "1,1", NULL }),
+	   "",
+	   EXECSTR ": 6378137,298,: Invalid --ellipsoid argument\n",
+	   EXIT_FAILURE,
+	   "--ellipsoid 6378137,298,");
+	tc((chp{ execname, "--ellipsoid", "6378137,", "-K", "dist", "0,0",
+	         "1,1", NULL }),
+	   "",
+	   EXECSTR ": 6378137,: Invalid --ellipsoid argument\n",
+	   EXIT_FAILURE,
+	   "--ellipsoid 6378137,");
+	tc((chp{ execname, "--ellipsoid", "6378137,1e999", "-K", "dist",
+	         "0,0", "1,1", NULL }),
+	   "",
+	   EXECSTR ": 6378137,1e999: Invalid --ellipsoid argument: "
+	   "Numerical result out of range\n",
+	   EXIT_FAILURE,
+	   "--ellipsoid 6378137,1e999");
+}
+
+                             /*** -F/--format ***/
+
+/*
+ * test_format_option() - Tests the -F/--format option. Returns nothing.
+ */
+
+static void test_format_option(void)
+{
+	diag("Test -F/--format");
+	sc((chp{ execname, "-vvvv", "-F", "FoRmAt", NULL }),
+	   "",
+	   EXECSTR ": setup_options(): o.format = \"FoRmAt\"\n",
+	   EXIT_FAILURE,
+	   "-vvvv -F FoRmAt: o.format is correct");
+	sc((chp{ execname, "-vvvv", "--format", "FoRmAt", NULL }),
+	   "",
+	   EXECSTR ": setup_options(): o.format = \"FoRmAt\"\n",
+	   EXIT_FAILURE,
+	   "-vvvv --format FoRmAt: o.format is correct");
+	sc((chp{ execname, "-vvvv", "-F", "FoRmAt", NULL }),
+	   NULL,
+	   EXECSTR ": FoRmAt: Unknown output format\n",
+	   EXIT_FAILURE,
+	   "-vvvv -F FoRmAt: It says it's unknown");
+	tc((chp{ execname, "-vvvv", "-F", "", "lpos", "54,7", "12,22",
+	         "0.23", NULL }),
+	   "44.531328,12.14587\n",
+	   NULL,
+	   EXIT_SUCCESS,
+	   "-F with an empty argument");
+}
+
+                           /*** -H/--haversine ***/
+
+/*
+ * test_haversine_option() - Tests the -H/--haversine option. Returns nothing.
+ */
+
+static void test_haversine_option(void)
+{
+	diag("Test -H/--haversine");
+
+	tc((chp{ execname, "-H", "dist", "13.389820,-71.453489",
+	         "-24.171099,-162.897613", NULL }),
+	   "10755873.395009\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-H dist 13.389820,-71.453489 -24.171099,-162.897613");
+
+	tc((chp{ execname, "--haversine", "dist", "-51.548124,19.706076",
+	         "-35.721304,13.064358", NULL }),
+	   "1837351.151434\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--haversine dist -51.548124,19.706076 -35.721304,13.064358");
+}
+
+                             /*** -K/--karney ***/
+
+/*
+ * test_karney_option() - Tests the -K/--karney option. Returns nothing.
+ */
+
+static void test_karney_option(void)
+{
+	diag("Test -K/--karney");
+
+                                /*** bear ***/
+
+	tc((chp{ execname, "-K", "bear", "13.389820,-71.453489",
+	         "-24.171099,-162.897613", NULL }),
+	   "246.80807199\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-K bear 13.389820,-71.453489 -24.171099,-162.897613");
+
+	tc((chp{ execname, "--karney", "bear", "-51.548124,19.706076",
+	         "-35.721304,13.064358", NULL }),
+	   "340.66682175\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--karney bear -51.548124,19.706076 -35.721304,13.064358");
+
+	tc((chp{ execname, "-K", "bear", "12.34,56.789", "12.34,56.789",
+	         NULL }),
+	   "",
+	   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
+	   EXIT_FAILURE,
+	   "-K bear: Coincident points");
+
+	tc((chp{ execname, "-K", "bear", "37,7", "-37,-173", NULL }),
+	   "",
+	   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
+	   EXIT_FAILURE,
+	   "--karney bear: Antipodal points");
+
+                                /*** dist ***/
+
+	tc((chp{ execname, "-K", "dist", "13.389820,-71.453489",
+	         "-24.171099,-162.897613", NULL }),
+	   "10759030.9440929\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-K dist 13.389820,-71.453489 -24.171099,-162.897613");
+
+	tc((chp{ execname, "--karney", "dist", "-51.548124,19.706076",
+	         "-35.721304,13.064358", NULL }),
+	   "1836406.16934653\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--karney dist -51.548124,19.706076 -35.721304,13.064358");
+
+	tc((chp{ execname, "-K", "dist", "-47.225588,-71.608730",
+	         "86.003517,7.605826", NULL }),
+	   "15134956.9936404\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-K dist -47.225588,-71.608730 86.003517,7.605826");
+
+	tc((chp{ execname, "-K", "dist", "16.680938,-64.790861",
+	         "-24.488084,-67.438562", NULL }),
+	   "4563415.8525995\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-K dist 16.680938,-64.790861 -24.488084,-67.438562");
+
+	tc((chp{ execname, "-K", "dist", "12.34,56.789", "12.34,56.789",
+	         NULL }),
+	   "0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-K dist: Coincident points");
+
+	tc((chp{ execname, "-K", "dist", "37,7", "-37,-173", NULL }),
+	   "",
+	   EXECSTR ": Formula did not converge, antipodal points\n",
+	   EXIT_FAILURE,
+	   "--karney dist: Antipodal points");
+
+	tc((chp{ execname, "--karney", "dist", "90.00001,0", "10,0",
+	         NULL }),
+	   "",
+	   EXECSTR ": 90.00001,0: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "--karney dist: lat1 out of range (90.00001)");
+
+	tc((chp{ execname, "--karney", "dist", "-90.0000001,0", "10,0",
+	         NULL }),
+	   "",
+	   EXECSTR ": -90.0000001,0: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "--karney dist: lat1 out of range (-90.0000001)");
+
+	tc((chp{ execname, "--karney", "dist", "10,180.000000001", "10,0",
+	         NULL }),
+	   "",
+	   EXECSTR ": 10,180.000000001: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "--karney dist: lon1 out of range (180.000000001)");
+
+	tc((chp{ execname, "--karney", "dist", "10,-180.000000001", "10,0",
+	         NULL }),
+	   "",
+	   EXECSTR ": 10,-180.000000001: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "--karney dist: lon1 out of range (-180.000000001)");
+
+	tc((chp{ execname, "--karney", "dist", "10,10.123", "h,0",
+	         NULL }),
+	   "",
+	   EXECSTR ": h,0: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "--karney dist: lat2 is not a number");
+
+	tc((chp{ execname, "--karney", "dist", "10,10.123", "9,1..2",
+	         NULL }),
+	   "",
+	   EXECSTR ": 9,1..2: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "--karney dist: lat2 has 2 periods");
+}
+
+                               /*** --rhumb ***/
+
+/*
+ * test_rhumb_option() - Tests the --rhumb option. Returns nothing.
+ */
+
+static void test_rhumb_option(void)
+{
+	char input[] = "60,-179\n60,179\n";
+
+	diag("Test --rhumb");
+
+	tc((chp{ execname, "--rhumb", "bear", "50,-5", "58,3", NULL }),
+	   "30.348581\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb bear 50,-5 58,3");
+
+	tc((chp{ execname, "--rhumb", "bear", "1,1", "1,1", NULL }),
+	   "",
+	   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
+	   EXIT_FAILURE,
+	   "--rhumb bear: Coincident points");
+
+	tc((chp{ execname, "--rhumb", "dist", "50,-5", "58,3", NULL }),
+	   "1030814.55559\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb dist 50,-5 58,3");
+
+	tc((chp{ execname, "--rhumb", "-F", "sql", "dist", "50,-5", "58,3",
+	         NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS dist (lat1 REAL, lon1 REAL,"
+	   " lat2 REAL, lon2 REAL, dist REAL, bear REAL);\n"
+	   "INSERT INTO dist VALUES (50.0, -5.0, 58.0, 3.0, 1030814.55559038,"
+	   " 30.34858072);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb -F sql dist 50,-5 58,3");
+
+	tc((chp{ execname, "--rhumb", "--km", "dist", "50,-5", "58,3", NULL }),
+	   "1030.814556\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb --km dist 50,-5 58,3");
+
+	tc((chp{ execname, "-K", "--rhumb", "dist", "50,-5", "58,3", NULL }),
+	   "1030814.55559\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-K --rhumb dist: The last option wins");
+
+	tc((chp{ execname, "--rhumb", "bpos", "50,-5", "45", "100000", NULL }),
+	   "50.635916,-4.004068\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb bpos 50,-5 45 100000");
+
+	tc((chp{ execname, "--rhumb", "-F", "sql", "bpos", "50,-5", "45",
+	         "100000", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS bpos (lat1 REAL, lon1 REAL,"
+	   " lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
+	   "INSERT INTO bpos VALUES (50.0, -5.0, 50.635916, -4.004068, 45.0,"
+	   " 100000.0);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb -F sql bpos 50,-5 45 100000");
+
+	tc((chp{ execname, "--rhumb", "bpos", "89,0", "0", "200000", NULL }),
+	   "90.0,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb bpos: Stops at the North Pole");
+
+	tc((chp{ execname, "--rhumb", "lpos", "50,-5", "58,3", "0.5", NULL }),
+	   "54.0,-1.192712\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb lpos 50,-5 58,3 0.5");
+
+	tc((chp{ execname, "--rhumb", "-F", "sql", "lpos", "50,-5", "58,3",
+	         "0.5", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS lpos (lat1 REAL, lon1 REAL,"
+	   " lat2 REAL, lon2 REAL, frac REAL, dlat REAL, dlon REAL,"
+	   " dist REAL, bear REAL);\n"
+	   "INSERT INTO lpos VALUES (50.0, -5.0, 58.0, 3.0, 0.5, 54.0,"
+	   " -1.192712, 515407.277795, 30.348581);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb -F sql lpos 50,-5 58,3 0.5");
+
+	tc((chp{ execname, "--rhumb", "lpos", "0,0", "0,180", "0.5", NULL }),
+	   "0.0,90.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb lpos: Antipodal points along the Equator");
+
+	tc((chp{ execname, "--rhumb", "course", "50,-5", "58,3", "3", NULL }),
+	   "50.0,-5.0\n"
+	   "52.0,-3.138909\n"
+	   "54.0,-1.192712\n"
+	   "56.0,0.849359\n"
+	   "58.0,3.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--rhumb course 50,-5 58,3 3");
+
+	tci((chp{ execname, "--rhumb", "track", NULL }),
+	    input,
+	    "leg 1 1 111194.926645 270.0\n"
+	    "segment 1 2 111194.926645\n"
+	    "length 111194.926645\n"
+	    "points 2\n"
+	    "segments 1\n"
+	    "bbox 60.0,179.0 60.0,-179.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--rhumb track: Westwards across the date line");
+
+	tc((chp{ execname, "--rhumb", "join", "a", "b", NULL }),
+	   "",
+	   EXECSTR ": --rhumb is not supported by the join command\n",
+	   EXIT_FAILURE,
+	   "--rhumb join: Not supported");
+}
+
+                               /*** --seed ***/
+
+/*
+ * test_seed_option() - Tests the --seed option. Returns nothing.
+ */
+
+static void test_seed_option(const struct Options *o)
+{
+	struct binbuf bb1, bb2, bb3;
+
+	assert(o);
+	diag("Test --seed");
+
+	binbuf_init(&bb1);
+	binbuf_init(&bb2);
+	binbuf_init(&bb3);
+	exec_output(o, &bb1, (chp{ execname, "--seed", "64738",
+	                           "--count", "20", "randpos", NULL }));
+	exec_output(o, &bb2, (chp{ execname, "--seed", "64739",
+	                           "--count", "20", "randpos", NULL }));
+	exec_output(o, &bb3, (chp{ execname, "--seed", "64738",
+	                           "--count", "20", "randpos", NULL }));
+	OK_NOTNULL(strcmp(bb1.buf, bb2.buf),
+	           "randpos with seed 64738 and 64739 are different");
+	OK_STRCMP(bb3.buf, bb1.buf,
+	          "randpos with seed 64738 is identical to the first");
+	binbuf_free(&bb3);
+	binbuf_free(&bb2);
+	binbuf_free(&bb1);
+
+	tc((chp{ execname, "--seed", "-29271", "--count", "10", "randpos",
+	         NULL }),
+	   "56.398026,65.672317\n"
+	   "-62.545731,39.973376\n"
+	   "-12.953591,-109.219631\n"
+	   "71.625404,10.907732\n"
+	   "-49.720325,-97.898594\n"
+	   "-9.863466,161.067034\n"
+	   "-21.125676,-179.454884\n"
+	   "-20.152272,-58.45828\n"
+	   "11.179247,79.685331\n"
+	   "-47.058531,149.678499\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--seed -29271 --count 10 randpos");
+
+	tc((chp{ execname, "--seed", "29271", "--count", "10", "randpos",
+	         NULL }),
+	   "-8.603169,114.257108\n"
+	   "-46.646685,-133.238413\n"
+	   "32.233828,-45.004903\n"
+	   "-10.383696,-105.396018\n"
+	   "14.981908,-85.632935\n"
+	   "-2.55139,93.617273\n"
+	   "-45.194786,6.814725\n"
+	   "-4.49135,-102.252955\n"
+	   "-54.462817,-25.117826\n"
+	   "-23.940993,-89.915442\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--seed 29271 --count 10 randpos");
+
+	tc((chp{ execname, "--format", "gpx", "--seed", "19999",
+	         "--count", "4", "randpos", NULL }),
+	   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	   "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\""
+	   " version=\"1.1\" creator=\"Geocalc -"
+	   " https://gitlab.com/oyvholm/geocalc\">\n"
+	   "  <wpt lat=\"-17.91477\" lon=\"127.6547\">\n"
+	   "    <name>Random 1, seed 19999</name>\n"
+	   "  </wpt>\n"
+	   "  <wpt lat=\"-27.493377\" lon=\"115.562443\">\n"
+	   "    <name>Random 2, seed 19999</name>\n"
+	   "  </wpt>\n"
+	   "  <wpt lat=\"-22.699248\" lon=\"152.244953\">\n"
+	   "    <name>Random 3, seed 19999</name>\n"
+	   "  </wpt>\n"
+	   "  <wpt lat=\"-52.359745\" lon=\"-142.81243\">\n"
+	   "    <name>Random 4, seed 19999</name>\n"
+	   "  </wpt>\n"
+	   "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--format gpx --seed 19999 --count 4 randpos");
+
+	tc((chp{ execname, "--seed", "", "randpos", NULL }),
+	   "",
+	   EXECSTR ": : Invalid --seed argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "Empty argument to --seed");
+
+	tc((chp{ execname, "--seed", "9.14", "randpos", NULL }),
+	   "",
+	   EXECSTR ": 9.14: Invalid --seed argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--seed 9.14 randpos");
+}
+
+                             /*** --selftest ***/
+
+/*
+ * test_selftest_option() - Tests the --selftest option. The test suite uses 
+ * global variables, so these tests must use the executable. Returns nothing.
+ */
+
+static void test_selftest_option(void)
+{
+	diag("Test --selftest");
+
+	scx((chp{ execname, "--count", "0", "--selftest", "prop", NULL }),
+	    "Property: haversine() is symmetric (0 iterations)\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--count 0 --selftest prop");
+}
+
+                         /****** Command tests ******/
+
+                                /*** anti ***/
+
+/*
+ * chk_ca() - Used by test_cmd_anti(). Verifies that the coordinate `coor` 
+ * results in the output `exp_stdout` on stdout. If `exp_stdout` is empty, an 
+ * "Invalid coordinate" error message is expected on stderr, and an exit status 
+ * of EXIT_FAILURE. If `exp_stdout` is "inv", it expects an "Invalid 
+ * coordinate" error message followed by "Invalid argument". Returns nothing.
+ */
+
+static void chk_ca(const int linenum, char *coor, const char *exp_stdout)
+{
+	char *e_stderr;
+	const char *e_stdout = exp_stdout;
+	int e_ret;
+
+	assert(coor);
+	assert(exp_stdout);
+
+	if (!*exp_stdout) {
+		e_stderr = allocstr("%s: %s: Invalid coordinate\n",
+		                    execname, coor);
+		e_ret = EXIT_FAILURE;
+	} else if (!strcmp(exp_stdout, "inv")) {
+		e_stderr = allocstr("%s: %s: Invalid coordinate:"
+		                    " Invalid argument\n", execname, coor);
+		e_stdout = "";
+		e_ret = EXIT_FAILURE;
+	} else {
+		e_stderr = mystrdup("");
+		e_ret = EXIT_SUCCESS;
+	}
+	if (!e_stderr) {
+		failed_ok("allocstr() or mystrdup()"); /* gncov */
 		return; /* gncov */
 	}
 
@@ -2409,1222 +6194,4493 @@ static void chk_ca(const int linenum, char *coor, const char *exp_stdout)
 	   e_ret,
 	   "anti %s", coor);
 
-	free(e_stderr);
+	free(e_stderr);
+}
+
+/*
+ * test_cmd_anti() - Tests the `anti` command. Returns nothing.
+ */
+
+static void test_cmd_anti(void)
+{
+	diag("Test anti command");
+
+#define chk_ca(coor, exp_stdout)  chk_ca(__LINE__, (coor), (exp_stdout))
+	chk_ca("90,0", "-90.0,0.0\n");
+	chk_ca("-90,0", "90.0,0.0\n");
+	chk_ca("0,0", "0.0,180.0\n");
+	chk_ca("0,180", "0.0,0.0\n");
+	chk_ca("0,-180", "0.0,0.0\n");
+	chk_ca("90,78", "-90.0,0.0\n");
+	chk_ca("-90,-32.4", "90.0,0.0\n");
+	chk_ca("10,10", "-10.0,-170.0\n");
+	chk_ca("12.345678,-87.654321", "-12.345678,92.345679\n");
+	chk_ca("60°23'33\"N 5°19'24\"E", "-60.3925,-174.676667\n");
+	chk_ca("S 10 30 W 20 15", "10.5,159.75\n");
+	chk_ca("90.000001,0", "");
+	chk_ca("-90.000001,0", "");
+	chk_ca("0,180.000001", "");
+	chk_ca("0,-180.000001", "");
+	chk_ca("a,0", "inv");
+	chk_ca("0,b", "inv");
+	chk_ca("0,,1", "inv");
+	chk_ca("1.2,3..4", "inv");
+#undef chk_ca
+
+	tc((chp{ execname, "--format", "sql", "anti", "-14.861893,-69.128489",
+	         NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS anti (lat REAL, lon REAL, a_lat REAL, a_lon REAL);\n"
+	   "INSERT INTO anti VALUES (-14.861893, -69.128489, 14.861893, 110.871511);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--format sql anti -14.861893,-69.128489");
+
+	tc((chp{ execname, "-F", "sql", "anti", "80,70", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS anti (lat REAL, lon REAL, a_lat REAL, a_lon REAL);\n"
+	   "INSERT INTO anti VALUES (80.0, 70.0, -80.0, -110.0);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql anti 80,70");
+
+	tc((chp{ execname, "-F", "gpx", "anti", "-61.859515,84.219729",
+	         NULL }),
+	   GPX_HEADER
+	   "  <wpt lat=\"61.859515\" lon=\"-95.780271\">\n"
+	   "    <name>anti</name>\n"
+	   "    <cmt>anti -61.859515,84.219729</cmt>\n"
+	   "  </wpt>\n"
+	   "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F gpx anti -61.859515,84.219729");
+
+	tc((chp{ execname, "anti", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "anti, missing coor argument");
+
+	tc((chp{ execname, "anti", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "anti, 1 extra argument");
+
+	tc((chp{ execname, "--karney", "anti", "1,2", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the anti command\n",
+	   EXIT_FAILURE,
+	   "--karney anti");
+}
+
+                                /*** bench ***/
+
+/*
+ * test_cmd_bench() - Tests the `bench` command. Returns nothing.
+ */
+
+static void test_cmd_bench(void)
+{
+	diag("Test bench command");
+	scx((chp{ execname, "bench", "0", NULL }),
+	   " haversine\n",
+	   "\nLooping haversine() for ",
+	   EXIT_SUCCESS,
+	   "bench 0");
+	tc((chp{ execname, "bench", "0", "0", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "bench has 1 extra argument");
+	sc((chp{ execname, "--format", "sql", "bench", "0", NULL }),
+	   "INSERT INTO bench VALUES ",
+	   "Looping haversine() for ",
+	   EXIT_SUCCESS,
+	   "--format sql bench");
+	tc((chp{ execname, "--format", "gpx", "bench", "0", NULL }),
+	   "",
+	   EXECSTR ": GPX output is not supported by the bench command\n",
+	   EXIT_FAILURE,
+	   "--format gpx bench");
+}
+
+                                /*** bpos ***/
+
+/*
+ * test_cmd_bpos() - Tests the `bpos` command. Returns nothing.
+ */
+
+static void test_cmd_bpos(void)
+{
+	diag("Test bpos command");
+	tcx((chp{ execname, "bpos", "45,0", "45", "1000", NULL }),
+	   "45.006359,0.008994\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "bpos 45,0 45 1000");
+	tc((chp{ execname, "--km", "bpos", "45,0", "45", "1", NULL }),
+	   "45.006359,0.008994\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--km bpos 45,0 45 1");
+	tc((chp{ execname, "bpos", "0,0", "90.0000001", "1", NULL }),
+	   "0.0,0.000009\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "bpos: No negative zero in lat");
+	tc((chp{ execname, "bpos", "0,0", "359.9999999", "1", NULL }),
+	   "0.000009,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "bpos: No negative zero in lon");
+	tc((chp{ execname, "--km", "bpos", "-34,179", "2", "19716", NULL }),
+	   "36.688059,-1.117018\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "bpos: Longitude is normalized");
+	tc((chp{ execname, "--km", "bpos", "90,0", "180", "20000", NULL }),
+	   "-89.864321,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "bpos: North Pole, point is moved 1 cm");
+	tc((chp{ execname, "bpos", "90,97.97", "180", "1234567.89", NULL }),
+	   "78.897264,97.97\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "bpos: North Pole, longitude is kept");
+	tc((chp{ execname, "--km", "bpos", "-90,0", "359", "7000", NULL }),
+	   "-27.047487,-1.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "bpos: South Pole, bearing 359");
+	tc((chp{ execname, "bpos", "1,2", "360.0000000001", "1000", NULL }),
+	   "",
+	   EXECSTR ": 360.0000000001: Bearing out of range\n",
+	   EXIT_FAILURE,
+	   "bpos: bearing is larger than 360 degrees");
+	tc((chp{ execname, "bpos", "1,2", "-0.0000000001", "1000", NULL }),
+	   "",
+	   EXECSTR ": -0.0000000001: Bearing out of range\n",
+	   EXIT_FAILURE,
+	   "bpos: bearing is negative");
+	tc((chp{ execname, "bpos", "1,2", "r", "1000", NULL }),
+	   "",
+	   EXECSTR ": r: Invalid bearing: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "bpos: bearing is not a number");
+	tc((chp{ execname, "bpos", "1,2w", "3", "4", NULL }),
+	   "",
+	   EXECSTR ": 1,2w: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "bpos: lon has trailing letter");
+	tc((chp{ execname, "bpos", "90.0000000001,2", "3", "4", NULL }),
+	   "",
+	   EXECSTR ": 90.0000000001,2: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "bpos: lat is out of range");
+	tc((chp{ execname, "bpos", "1,2", "b", "4", NULL }),
+	   "",
+	   EXECSTR ": b: Invalid bearing: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "bpos: Invalid bearing");
+	tc((chp{ execname, "bpos", "1,2", "nan", "4", NULL }),
+	   "",
+	   EXECSTR ": nan: Invalid bearing: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "bpos: Bearing is NaN");
+	tc((chp{ execname, "bpos", "1,2", "3", "1e-400", NULL }),
+	   "",
+	   EXECSTR ": 1e-400: Invalid distance: Numerical result out of"
+	   " range\n",
+	   EXIT_FAILURE,
+	   "bpos: Distance underflows");
+	tc((chp{ execname, "bpos", "1,2", "3", "d", NULL }),
+	   "",
+	   EXECSTR ": d: Invalid distance: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "bpos: Invalid distance");
+	tc((chp{ execname, "bpos", "1,2", "3", "4", "5", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "bpos: 1 extra argument");
+	tc((chp{ execname, "-F", "default", "bpos", "40.80542,-73.96546",
+	         "188.7", "4817.84", NULL }),
+	   "40.76259,-73.974113\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F default bpos");
+	tc((chp{ execname, "--format", "gpx", "bpos", "40.80542,-73.96546",
+	         "188.7", "4817.84", NULL }),
+	         GPX_HEADER
+	         "  <wpt lat=\"40.76259\" lon=\"-73.974113\">\n"
+	         "    <name>bpos</name>\n"
+	         "    <cmt>bpos 40.80542,-73.96546 188.7 4817.84</cmt>\n"
+	         "  </wpt>\n"
+	         "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--format gpx bpos");
+	tc((chp{ execname, "-K", "bpos", "1,2", "3", "4", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the bpos command\n",
+	   EXIT_FAILURE,
+	   "-K bpos");
+
+	diag("--format sql bpos");
+	tc((chp{ execname, "-F", "sql", "bpos", "0,0", "90", "1000", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS bpos (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
+	   "INSERT INTO bpos VALUES (0.0, 0.0, 0.0, 0.008993, 90.0, 1000.0);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql bpos 0,0 90 1000");
+	tc((chp{ execname, "-F", "sql", "--km", "bpos", "0,0", "90", "1",
+	         NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS bpos (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
+	   "INSERT INTO bpos VALUES (0.0, 0.0, 0.0, 0.008993, 90.0, 1000.0);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql --km bpos 0,0 90 1");
+	tc((chp{ execname, "-F", "sql", "--km", "bpos",
+	         "76.2379187,-134.9876543", "43.99999", "15000", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS bpos (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
+	   "INSERT INTO bpos VALUES (76.237919, -134.987654, -34.358442, 8.42343, 43.99999, 15000000.0);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql --km bpos: dist = 15000 km");
+}
+
+                               /*** course ***/
+
+/*
+ * test_cmd_course() - Tests the `course` command. Returns nothing.
+ */
+
+static void test_cmd_course(void)
+{
+	char *exp_stdout;
+
+	diag("Test course command");
+	tcx((chp{ execname, "course", "45,0", "45,180", "1", NULL }),
+	   "45.0,0.0\n"
+	   "90.0,0.0\n"
+	   "45.0,180.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "course: Across the North Pole");
+	tc((chp{ execname, "course", "0,0", "0,180", "7", NULL }),
+	   "",
+	   EXECSTR ": Antipodal points, answer is undefined\n",
+	   EXIT_FAILURE,
+	   "course 0,0 0,180 7");
+	tc((chp{ execname, "course", "90,0", "0,0", "3", NULL }),
+	   "90.0,0.0\n"
+	   "67.5,0.0\n"
+	   "45.0,0.0\n"
+	   "22.5,0.0\n"
+	   "0.0,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "course 90,0 0,0 3");
+	exp_stdout = "60.39299,5.32415\n"
+	             "66.169926,16.700678\n"
+	             "70.664233,33.818071\n"
+	             "72.834329,57.579125\n"
+	             "71.826607,82.903321\n"
+	             "68.075305,102.664288\n"
+	             "62.689678,115.951619\n"
+	             "56.44951,124.8845\n"
+	             "49.752575,131.21524\n"
+	             "42.795549,135.979229\n"
+	             "35.681389,139.766944\n";
+	tc((chp{ execname, "course", "60.39299,5.32415",
+	         "35.681389,139.766944", "9", NULL }),
+	   exp_stdout,
+	   "",
+	   EXIT_SUCCESS,
+	   "course: From Bergen to Tokyo");
+	tc((chp{ execname, "--km", "course", "60.39299,5.32415",
+	         "35.681389,139.766944", "9", NULL }),
+	   exp_stdout,
+	   "",
+	   EXIT_SUCCESS,
+	   "--km course: From Bergen to Tokyo");
+	tc((chp{ execname, "course", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "course: Missing 1 argument");
+	tc((chp{ execname, "course", "1,2", "3,4", "5", "6", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "course: 1 argument too much");
+	tc((chp{ execname, "course", "90.00001,0", "12,34", "1", NULL }),
+	   "",
+	   EXECSTR ": 90.00001,0: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "course: lat1 is outside range");
+	tc((chp{ execname, "course", "17,0", "12,34", "-1", NULL }),
+	   "",
+	   EXECSTR ": -1: Number of intermediate points cannot be negative\n",
+	   EXIT_FAILURE,
+	   "course: numpoints is -1");
+	tc((chp{ execname, "course", "17,6", "12,34", "-0.5", NULL }),
+	   "",
+	   EXECSTR ": -0.5: Number of intermediate points cannot be negative\n",
+	   EXIT_FAILURE,
+	   "course: numpoints is -0.5");
+	tc((chp{ execname, "course", "22,33", "44,55", "0", NULL }),
+	   "22.0,33.0\n"
+	   "44.0,55.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "course: numpoints is 0");
+	tc((chp{ execname, "course", "17,6%", "12,34", "-1", NULL }),
+	   "",
+	   EXECSTR ": 17,6%: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "course: lon1 is invalid number");
+	tc((chp{ execname, "course", "1,2", "xxx", "4", NULL }),
+	   "",
+	   EXECSTR ": xxx: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "course: coor2 is invalid");
+	tc((chp{ execname, "course", "1,2", "3,4", "r", NULL }),
+	   "",
+	   EXECSTR ": r: Invalid number of points: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "course: Invalid value in number of points");
+	tc((chp{ execname, "-F", "default", "course",
+	         "52.3731,4.891", "35.681,139.767", "5", NULL }),
+	   "52.3731,4.891\n"
+	   "62.68586,22.57978\n"
+	   "68.869393,53.549146\n"
+	   "67.245712,91.173953\n"
+	   "59.021383,116.487394\n"
+	   "47.913547,130.771879\n"
+	   "35.681,139.767\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F default course, Amsterdam to Tokyo");
+	tc((chp{ execname, "-F", "gpx", "course",
+	         "52.3731,4.891", "35.681,139.767", "5", NULL }),
+	   GPX_HEADER
+	   "  <rte>\n"
+	   "    <rtept lat=\"52.3731\" lon=\"4.891\">\n"
+	   "    </rtept>\n"
+	   "    <rtept lat=\"62.68586\" lon=\"22.57978\">\n"
+	   "    </rtept>\n"
+	   "    <rtept lat=\"68.869393\" lon=\"53.549146\">\n"
+	   "    </rtept>\n"
+	   "    <rtept lat=\"67.245712\" lon=\"91.173953\">\n"
+	   "    </rtept>\n"
+	   "    <rtept lat=\"59.021383\" lon=\"116.487394\">\n"
+	   "    </rtept>\n"
+	   "    <rtept lat=\"47.913547\" lon=\"130.771879\">\n"
+	   "    </rtept>\n"
+	   "    <rtept lat=\"35.681\" lon=\"139.767\">\n"
+	   "    </rtept>\n"
+	   "  </rte>\n"
+	   "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F gpx course, Amsterdam to Tokyo");
+	tc((chp{ execname, "--karney", "course", "1,2", "3,4", "5", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the course command\n",
+	   EXIT_FAILURE,
+	   "--karney course");
+
+	diag("--format sql course");
+	tc((chp{ execname, "-F", "sql", "course", "-45,-123", "45,-123", "5",
+	         NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS course (num INTEGER, lat REAL, lon REAL, dist REAL, frac REAL, bear REAL);\n"
+	   "INSERT INTO course VALUES (0, -45.0, -123.0, 0.0, 0.0, 0.0);\n"
+	   "INSERT INTO course VALUES (1, -30.0, -123.0, 1667923.899668, 0.166667, 0.0);\n"
+	   "INSERT INTO course VALUES (2, -15.0, -123.0, 3335847.799337, 0.333333, 0.0);\n"
+	   "INSERT INTO course VALUES (3, 0.0, -123.0, 5003771.699005, 0.5, 0.0);\n"
+	   "INSERT INTO course VALUES (4, 15.0, -123.0, 6671695.598674, 0.666667, 0.0);\n"
+	   "INSERT INTO course VALUES (5, 30.0, -123.0, 8339619.498342, 0.833333, 0.0);\n"
+	   "INSERT INTO course VALUES (6, 45.0, -123.0, 10007543.39801, 1.0, NULL);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql course -45,-123 45,-123 5");
+	tc((chp{ execname, "-F", "sql", "course", "60,5", "-35,135", "5",
+	         NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS course (num INTEGER, lat REAL, lon REAL, dist REAL, frac REAL, bear REAL);\n"
+	   "INSERT INTO course VALUES (0, 60.0, 5.0, 0.0, 0.0, 74.908926);\n"
+	   "INSERT INTO course VALUES (1, 57.898298, 50.808536, 2584622.088993, 0.166667, 114.711921);\n"
+	   "INSERT INTO course VALUES (2, 43.683265, 80.527411, 5169244.094446, 0.333333, 138.121194);\n"
+	   "INSERT INTO course VALUES (3, 24.968228, 97.421916, 7753866.163712, 0.5, 147.823758);\n"
+	   "INSERT INTO course VALUES (4, 4.878069, 109.598447, 10338488.288345, 0.666667, 151.019525);\n"
+	   "INSERT INTO course VALUES (5, -15.417397, 121.038906, 12923110.365395, 0.833333, 149.948567);\n"
+	   "INSERT INTO course VALUES (6, -35.0, 135.0, 15507732.39972, 1.0, NULL);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql course 60,5 -35,135 5");
+}
+
+                                /*** lpos ***/
+
+/*
+ * test_cmd_lpos() - Tests the `lpos` command. Returns nothing.
+ */
+
+static void test_cmd_lpos(void)
+{
+	diag("Test lpos command");
+	tcx((chp{ execname, "lpos", "45,0", "45,180", "0.5", NULL }),
+	   "90.0,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "lpos: At the North Pole");
+	tc((chp{ execname, "--km", "lpos", "45,0", "45,180", "0.5", NULL }),
+	   "90.0,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--km lpos: At the North Pole");
+	tc((chp{ execname, "--format", "gpx", "lpos", "45,0", "45,180",
+	         "0.5", NULL }),
+	             GPX_HEADER
+	             "  <wpt lat=\"90.0\" lon=\"0.0\">\n"
+	             "    <name>lpos</name>\n"
+	             "    <cmt>lpos 45,0 45,180 0.5</cmt>\n"
+	             "  </wpt>\n"
+	             "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--format gpx lpos: At the North Pole");
+	tc((chp{ execname, "lpos", "0,0", "-0.0000001,0", "1", NULL }),
+	   "0.0,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "lpos: No negative zero in lat");
+	tc((chp{ execname, "lpos", "0,0", "0,-0.0000001", "1", NULL }),
+	   "0.0,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "lpos: No negative zero in lon");
+	tc((chp{ execname, "--km", "lpos", "-24.598059,178.290755",
+	         "-12.500692,163.651473", "9.8", NULL }),
+	   "24.508273,-1.833156\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "lpos: Longitude is normalized");
+	tc((chp{ execname, "lpos", "90,0", "0,0", "0.5", NULL }),
+	   "45.0,0.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "lpos: Point is moved 1 cm");
+	tc((chp{ execname, "lpos", "-90,0", "90,0", "3", NULL }),
+	   "",
+	   EXECSTR ": Antipodal points, answer is undefined\n",
+	   EXIT_FAILURE,
+	   "lpos: South Pole to the North Pole");
+	tc((chp{ execname, "lpos", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "lpos: Missing 1 argument");
+	tc((chp{ execname, "lpos", "1,2", "3,4", "5", "6", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "lpos: 1 argument too much");
+	tc((chp{ execname, "lpos", "-90.00001,0", "12,34", "1", NULL }),
+	   "",
+	   EXECSTR ": -90.00001,0: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "lpos: lat1 is outside range");
+	tc((chp{ execname, "lpos", "17,6%", "12,34", "-1", NULL }),
+	   "",
+	   EXECSTR ": 17,6%: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "lpos: lon1 is invalid number");
+	tc((chp{ execname, "lpos", "17,6", "12%,34", "-1", NULL }),
+	   "",
+	   EXECSTR ": 12%,34: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "lpos: lat in coor1 is invalid number");
+	tc((chp{ execname, "lpos", "1,2", "3,4", "0", NULL }),
+	   "1.0,2.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "lpos: fracdist is 0");
+	tc((chp{ execname, "lpos", "11.231,-34.55", "29.97777,47.311001",
+	         "1", NULL }),
+	   "29.97777,47.311001\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "lpos: fracdist is 1");
+	tc((chp{ execname, "--km", "lpos", "11.231,-34.55",
+	         "29.97777,47.311001", "1", NULL }),
+	   "29.97777,47.311001\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--km lpos: fracdist is 1");
+	tc((chp{ execname, "lpos", "1,2", "3,4", "INF", NULL }),
+	   "",
+	   EXECSTR ": INF: Invalid fraction: Numerical result out of range\n",
+	   EXIT_FAILURE,
+	   "lpos: fracdist is INF");
+	tc((chp{ execname, "lpos", "0,0", "0,180", "0.5", NULL }),
+	   "",
+	   EXECSTR ": Antipodal points, answer is undefined\n",
+	   EXIT_FAILURE,
+	   "lpos: Antipodal positions, 0,0 and 0,180");
+	tc((chp{ execname, "lpos", "90,0", "-90,0", "0.5", NULL }),
+	   "",
+	   EXECSTR ": Antipodal points, answer is undefined\n",
+	   EXIT_FAILURE,
+	   "lpos: Antipodal positions, 90,0 and -90,0");
+	tc((chp{ execname, "--karney", "lpos", "1,2", "3,4", "0.2", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the lpos command\n",
+	   EXIT_FAILURE,
+	   "--karney lpos");
+	tc((chp{ execname, "-F", "sql", "lpos", "1,2", "87.188,-130.77", "0.2",
+	         NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS lpos (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, frac REAL, dlat REAL, dlon REAL, dist REAL, bear REAL);\n"
+	   "INSERT INTO lpos VALUES (1.0, 2.0, 87.188, -130.77, 0.2, 19.169669, 1.31824, 2021740.468082, 357.935874);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql lpos");
+}
+
+                            /*** bear and dist ***/
+
+/*
+ * test_multiple() - Tests the `bear` or `dist` command. Returns nothing.
+ */
+
+static void test_multiple(const int linenum, char *cmd)
+{
+	assert(cmd);
+	assert(!strcmp(cmd, "bear") || !strcmp(cmd, "dist"));
+	if (!cmd) {
+		OK_ERROR_L(linenum, "%s(): cmd is NULL", __func__); /* gncov */
+		return; /* gncov */
+	}
+
+	diag("Test %s command", !strcmp(cmd, "bear") ? "bear" : "dist");
+
+	Tc((chp{ execname, "-vv", cmd, NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "%s with no arguments", cmd);
+	Tc((chp{ execname, cmd, "1,2", "3", NULL }),
+	   "",
+	   EXECSTR ": 3: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "%s: Argument 2 is not a coordinate", cmd);
+	Tcx((chp{ execname, cmd, "1,2", "3,4", NULL }),
+	   !strcmp(cmd, "bear") ? "44.951998\n" : "314402.951024\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "%s 1,2 3,4", cmd);
+	if (!strcmp(cmd, "bear")) {
+		Tc((chp{ execname, "bear", "12,34", "-12,-146", NULL }),
+		   "",
+		   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
+		   EXIT_FAILURE,
+		   "bear 12,34 -12,-146 - antipodal points");
+		Tc((chp{ execname, "bear", "12,34", "12,34", NULL }),
+		   "",
+		   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
+		   EXIT_FAILURE,
+		   "bear 12,34 -12,34 - coincident points");
+	} else {
+		Tc((chp{ execname, "dist", "12,34", "-12,-146", NULL }),
+		   "20015086.796021\n",
+		   "",
+		   EXIT_SUCCESS,
+		   "dist 12,34 -12,-146 - antipodal points");
+		Tc((chp{ execname, "dist", "12,34", "12,34", NULL }),
+		   "0.0\n",
+		   "",
+		   EXIT_SUCCESS,
+		   "dist 12,34 12,34 - coincident points");
+	}
+	Tc((chp{ execname, cmd, "1,2", "3,4", "5", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "%s with 1 argument too much", cmd);
+	Tc((chp{ execname, cmd, "1,2", "3,1e+900", NULL }),
+	   "",
+	   EXECSTR ": 3,1e+900: Invalid coordinate: Numerical result out of range\n",
+	   EXIT_FAILURE,
+	   "%s with 1 number too large", cmd);
+	Tc((chp{ execname, cmd, "1,2", "urgh,4", NULL }),
+	   "",
+	   EXECSTR ": urgh,4: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "%s with 1 non-number", cmd);
+	Tc((chp{ execname, cmd, "1,2.9y", "3,4", NULL }),
+	   "",
+	   EXECSTR ": 1,2.9y: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "%s with non-digit after number", cmd);
+	Tc((chp{ execname, cmd, "1,2 g", "3,4", NULL }),
+	   "",
+	   EXECSTR ": 1,2 g: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "%s with whitespace and non-digit after number", cmd);
+	Tc((chp{ execname, cmd, "10,2,", "3,4", NULL }),
+	   !strcmp(cmd, "bear") ? "164.027619\n" : "809080.682265\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "%s with comma after number", cmd);
+	Tc((chp{ execname, cmd, "1,2", "3,NAN", NULL }),
+	   "",
+	   EXECSTR ": 3,NAN: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "%s with NAN", cmd);
+	Tc((chp{ execname, cmd, "1,2", "3,INF", NULL }),
+	   "",
+	   EXECSTR ": 3,INF: Invalid coordinate: Numerical result out of range\n",
+	   EXIT_FAILURE,
+	   "%s with INF", cmd);
+	Tc((chp{ execname, cmd, "1,2", "", NULL }),
+	   "",
+	   EXECSTR ": : Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "%s with empty argument", cmd);
+	Tc((chp{ execname, cmd, "1,180.001", "3,4", NULL }),
+	   "",
+	   EXECSTR ": 1,180.001: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "%s: lon1 out of range", cmd);
+	if (!strcmp(cmd, "bear")) {
+		Tc((chp{ execname, "bear", "90,0", "-90,0", NULL }),
+		   "",
+		   EXECSTR ": Antipodal or coincident points, answer is"
+		   " undefined\n",
+		   EXIT_FAILURE,
+		   "bear 90,0 -90,0");
+		Tc((chp{ execname, "--km", cmd, "90,0", "-90,0", NULL }),
+		   "",
+		   EXECSTR ": Antipodal or coincident points, answer is"
+		   " undefined\n",
+		   EXIT_FAILURE,
+		   "--km bear 90,0 -90,0");
+	} else {
+		Tc((chp{ execname, "dist", "90,0", "-90,0", NULL }),
+		   "20015086.796021\n",
+		   "",
+		   EXIT_SUCCESS,
+		   "dist 90,0 -90,0");
+		Tc((chp{ execname, "--km", cmd, "90,0", "-90,0", NULL }),
+		   "20015.086796\n",
+		   "",
+		   EXIT_SUCCESS,
+		   "--km dist 90,0 -90,0");
+	}
+	Tc((chp{ execname, "-F", "default", cmd, "34,56", "-78,9", NULL }),
+	   !strcmp(cmd, "bear") ? "189.693136\n" : "12835310.777042\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F default %s", cmd);
+	Tc((chp{ execname, "--format", "gpx", cmd, "34,56", "-78,9", NULL }),
+	   "",
+	   !strcmp(cmd, "bear")
+	       ? EXECSTR ": GPX output is not supported by the bear command\n"
+	       : EXECSTR ": GPX output is not supported by the dist command\n",
+	   EXIT_FAILURE,
+	   "--format gpx %s", cmd);
+
+	diag("--format sql %s", cmd);
+	if (!strcmp(cmd, "bear")) {
+		Tc((chp{ execname, "--format", "sql", cmd, "34,56", "-78,9",
+		         NULL }),
+		   "BEGIN;\n"
+		   "CREATE TABLE IF NOT EXISTS bear (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
+		   "INSERT INTO bear VALUES (34.0, 56.0, -78.0, 9.0, 189.693136, 12835310.777042);\n"
+		   "COMMIT;\n",
+		   "",
+		   EXIT_SUCCESS,
+		   "--format sql %s", cmd);
+	} else {
+		Tc((chp{ execname, "--format", "sql", cmd, "34,56", "-78,9",
+		         NULL }),
+		   "BEGIN;\n"
+		   "CREATE TABLE IF NOT EXISTS dist (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, dist REAL, bear REAL);\n"
+		   "INSERT INTO dist VALUES (34.0, 56.0, -78.0, 9.0, 12835310.77704204, 189.69313615);\n"
+		   "COMMIT;\n",
+		   "",
+		   EXIT_SUCCESS,
+		   "--format sql %s", cmd);
+	}
+}
+
+                               /*** randpos ***/
+
+/*
+ * verify_coor_dist() - Verifies that the distance between `coor` and all 
+ * "\n"-separated coordinates in `str` are in the range `mindist`-`maxdist` 
+ * meters. Returns nothing.
+ */
+
+static void verify_coor_dist(const int linenum, const char *str,
+                             const char *coor, const double mindist,
+                             const double maxdist)
+{
+	int errcount = 0;
+	char *s, *p;
+	double clat, clon,
+	       mindist_r = round(mindist), maxdist_r = round(maxdist);
+	unsigned long coorcount = 0;
+
+	assert(str);
+	assert(coor);
+	if (!str || !coor) {
+		OK_ERROR_L(linenum, /* gncov */
+		           "%s(): `str` or `coor` is NULL", __func__);
+		return; /* gncov */
+	}
+	if (!strchr(str, '\n')) {
+		OK_ERROR_L(linenum, /* gncov */
+		           "%s(): No '\\n' found in `str`", __func__);
+		return; /* gncov */
+	}
+	if (parse_coordinate(coor, true, &clat, &clon)) {
+		failed_ok("parse_coordinate()"); /* gncov */
+		diag("%s(): coor = \"%s\"", __func__, coor); /* gncov */
+		return; /* gncov */
+	}
+
+	s = mystrdup(str);
+	if (!s) {
+		failed_ok("mystrdup()"); /* gncov */
+		return; /* gncov */
+	}
+	p = strtok(s, "\n");
+	while (p) {
+		double lat, lon, dist;
+		coorcount++;
+		if (parse_coordinate(p, true, &lat, &lon)) {
+			failed_ok("parse_coordinate()"); /* gncov */
+			diag("%s(): p = \"%s\"", __func__, p); /* gncov */
+			errcount++; /* gncov */
+			goto next; /* gncov */
+		}
+		dist = haversine(clat, clon, lat, lon);
+		if (dist == -1.0) {
+			OK_ERROR_L(linenum, /* gncov */
+			           "%s(): haversine() failed, values out of"
+			           " range", __func__);
+			diag("%s(): coor = \"%s\", lat = %f," /* gncov */
+			     " lon = %f", __func__, coor, lat, lon);
+			errcount++; /* gncov */
+			goto next; /* gncov */
+		}
+		dist = round(dist);
+		if (dist < mindist_r || dist > maxdist_r) {
+			errcount < 11
+			? OK_ERROR_L(linenum, /* gncov */
+			             "Coordinate out of range (%f"
+			             " to %f m). center: %f,%f, coor = %f,%f,"
+			             " dist = %f",
+			             mindist, maxdist,
+			             clat, clon, lat, lon, dist)
+			: 1; /* gncov */
+			errcount++; /* gncov */
+		}
+next:
+		if (errcount >= 10) {
+			OK_ERROR_L(linenum, /* gncov */
+			           "Aborting this test after 10 errors");
+			break; /* gncov */
+		}
+		p = strtok(NULL, "\n");
+	}
+	OK_EQUAL_L(errcount, 0, linenum,
+	          "randpos: All %lu coordinates were inside range of"
+	          " %.0f to %.0f meters", coorcount, mindist, maxdist);
+	free(s);
+}
+
+/*
+ * chk_coor_outp() - Verifies the output from the randpos command. Returns 1 if 
+ * any error, 0 if everything is ok.
+ */
+
+static int chk_coor_outp(const int linenum, const OutputFormat format,
+                         const char *output, const unsigned int num,
+                         const char *coor, const double mindist,
+                         const double maxdist)
+{
+	int errcount = 0;
+	regex_t regex;
+	char *regstr, *pattern;
+	static int count = 0;
+
+	assert(output);
+
+	count++;
+	if (format == OF_DEFAULT && coor)
+		verify_coor_dist(linenum, output, coor, mindist, maxdist);
+
+	switch (format) {
+	case OF_DEFAULT:
+		regstr = "^(-?[0-9]+\\.[0-9]+"
+		         ","
+		         "-?[0-9]+\\.[0-9]+\n){%u}$";
+		break;
+	case OF_GPX:
+		regstr = "^<\\?xml version=\"1\\.0\" encoding=\"UTF-8\"\\?>\n"
+		         "<gpx"
+		         " xmlns=\"http://www\\.topografix\\.com/GPX/1/1\""
+		         " version=\"1\\.1\""
+		         " creator=\"" PROJ_NAME " - " PROJ_URL "\""
+		         ">\n"
+		         "("
+		         "  <wpt"
+		         " lat=\"-?[0-9]+\\.[0-9]+\""
+		         " lon=\"-?[0-9]+\\.[0-9]+\""
+		         ">\n"
+		         "    <name>Random [0-9]+</name>\n"
+		         "  </wpt>\n"
+		         "){%u}"
+		         "</gpx>\n$";
+		break;
+	default: /* gncov */
+		regstr = "NON-EXISTENT VALUE"; /* gncov */
+		break; /* gncov */
+	}
+
+	pattern = allocstr(regstr, num);
+	if (!pattern) {
+		failed_ok("allocstr()"); /* gncov */
+		return 1; /* gncov */
+	}
+
+	if (regcomp(&regex, pattern, REG_EXTENDED)) {
+		failed_ok("regcomp()"); /* gncov */
+		errcount++; /* gncov */
+		goto cleanup; /* gncov */
+	}
+
+	OK_SUCCESS_L(regexec(&regex, output, 0, NULL, 0), linenum,
+	             "Regexp matches, count = %d", count);
+	regfree(&regex);
+
+cleanup:
+	free(pattern);
+
+	return !!errcount;
 }
 
 /*
- * test_cmd_anti() - Tests the `anti` command. Returns nothing.
+ * te_randpos() - Executes `cmd` and verifies that all coordinates are valid 
+ * and inside the various ranges specified. Returns nothing.
  */
 
-static void test_cmd_anti(void)
+static void te_randpos(const int linenum, const OutputFormat format,
+                       char **cmd, const unsigned int num, const char *coor,
+                       const double mindist, const double maxdist,
+                       const char *desc)
 {
-	diag("Test anti command");
+	struct streams ss;
+	struct Options o = opt_struct();
 
-#define chk_ca(coor, exp_stdout)  chk_ca(__LINE__, (coor), (exp_stdout))
-	chk_ca("90,0", "-90.0,0.0\n");
-	chk_ca("-90,0", "90.0,0.0\n");
-	chk_ca("0,0", "0.0,180.0\n");
-	chk_ca("0,180", "0.0,0.0\n");
-	chk_ca("0,-180", "0.0,0.0\n");
-	chk_ca("90,78", "-90.0,0.0\n");
-	chk_ca("-90,-32.4", "90.0,0.0\n");
-	chk_ca("10,10", "-10.0,-170.0\n");
-	chk_ca("12.345678,-87.654321", "-12.345678,92.345679\n");
-	chk_ca("90.000001,0", "");
-	chk_ca("-90.000001,0", "");
-	chk_ca("0,180.000001", "");
-	chk_ca("0,-180.000001", "");
-	chk_ca("a,0", "inv");
-	chk_ca("0,b", "inv");
-	chk_ca("0,,1", "inv");
-	chk_ca("1.2,3..4", "inv");
-#undef chk_ca
+	assert(cmd);
+	assert(*cmd);
+	assert(desc);
+	assert(*desc);
 
-	tc((chp{ execname, "--format", "sql", "anti", "-14.861893,-69.128489",
-	         NULL }),
-	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS anti (lat REAL, lon REAL, a_lat REAL, a_lon REAL);\n"
-	   "INSERT INTO anti VALUES (-14.861893, -69.128489, 14.861893, 110.871511);\n"
-	   "COMMIT;\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--format sql anti -14.861893,-69.128489");
+	streams_init(&ss);
+	run_cmd(&o, &ss, cmd, false);
+	OK_SUCCESS_L(chk_coor_outp(linenum, format, ss.out.buf, num, coor,
+	                           mindist, maxdist), linenum,
+	             desc);
+	streams_free(&ss);
+}
 
-	tc((chp{ execname, "-F", "sql", "anti", "80,70", NULL }),
-	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS anti (lat REAL, lon REAL, a_lat REAL, a_lon REAL);\n"
-	   "INSERT INTO anti VALUES (80.0, 70.0, -80.0, -110.0);\n"
-	   "COMMIT;\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "-F sql anti 80,70");
+#define te_randpos(format, cmd, num, coor, mindist, maxdist, desc)  \
+        te_randpos(__LINE__, (format), (cmd), (num), (coor), (mindist), \
+                   (maxdist), (desc))
 
-	tc((chp{ execname, "-F", "gpx", "anti", "-61.859515,84.219729",
-	         NULL }),
-	   GPX_HEADER
-	   "  <wpt lat=\"61.859515\" lon=\"-95.780271\">\n"
-	   "    <name>anti</name>\n"
-	   "    <cmt>anti -61.859515,84.219729</cmt>\n"
-	   "  </wpt>\n"
-	   "</gpx>\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "-F gpx anti -61.859515,84.219729");
+/*
+ * test_randpos_dist_max() - Tests the randpos command with only the maximum 
+ * distance. Returns nothing.
+ */
 
-	tc((chp{ execname, "anti", NULL }),
-	   "",
-	   EXECSTR ": Missing arguments\n",
-	   EXIT_FAILURE,
-	   "anti, missing coor argument");
+static void test_randpos_dist_max(void)
+{
+	char **as;
 
-	tc((chp{ execname, "anti", "1,2", "3,4", NULL }),
-	   "",
-	   EXECSTR ": Too many arguments\n",
-	   EXIT_FAILURE,
-	   "anti, 1 extra argument");
+	diag("randpos with max_dist");
+
+	as =(chp{ execname, "--count", "50", "randpos", "1.234,5.6789", "100",
+	          NULL });
+	te_randpos(OF_DEFAULT, as, 50, "1.234,5.6789", 0.0, 100.0,
+	           "randpos: 50 pos inside a radius of 100m");
+
+	as =(chp{ execname, "--count", "51", "randpos", "1.234,5.6789",
+	          "100000000", NULL });
+	te_randpos(OF_DEFAULT, as, 51, "1.234,5.6789", 0.0,
+	           MAX_EARTH_DISTANCE,
+	           "randpos: max_dist is larger than MAX_EARTH_DISTANCE");
+
+	as =(chp{ execname, "--count", "52", "randpos", "1.234,5.6789", "0",
+	          "100000000", NULL });
+	te_randpos(OF_DEFAULT, as, 52, "1.234,5.6789", 0.0,
+	           MAX_EARTH_DISTANCE,
+	           "randpos: min_dist is larger than MAX_EARTH_DISTANCE");
+
+	as =(chp{ execname, "--count", "53", "randpos", "1.234,5.67",
+	          "100000000", "100000000", NULL });
+	te_randpos(OF_DEFAULT, as, 53, "1.234,5.67", MAX_EARTH_DISTANCE,
+	           MAX_EARTH_DISTANCE,
+	           "randpos: min_dist and max_dist are larger than"
+	           " MAX_EARTH_DISTANCE, stdout looks ok");
+
+	as =(chp{ execname, "-F", "gpx", "--count", "14", "randpos",
+	          "19.63,-19.70", "25", NULL });
+	te_randpos(OF_GPX, as, 14, NULL, 0, 0,
+	           "-F gpx --count 14 randpos 19.63,-19.70 25");
+
+	as =(chp{ execname, "--km", "--count", "50", "randpos",
+	          "1.234,5.6789", "100", NULL });
+	te_randpos(OF_DEFAULT, as, 50,
+	           "1.234,5.6789", 0.0, 100000.0,
+	           "--km randpos: 50 pos inside a radius of 100km,"
+	           " stdout looks ok");
+
+	as =(chp{ execname, "--km", "--count", "50", "randpos",
+	          "1.234,5.6789", "100000", NULL });
+	te_randpos(OF_DEFAULT, as, 50,
+	           "1.234,5.6789", 0.0, MAX_EARTH_DISTANCE,
+	           "--km randpos: max_dist is larger than MAX_EARTH_DISTANCE,"
+	           " stdout looks ok");
+}
+
+/*
+ * test_randpos_dist_minmax() - Tests the randpos command with both maximum and 
+ * minimum distance. Returns nothing.
+ */
+
+static void test_randpos_dist_minmax(void)
+{
+	char **as;
+
+	diag("randpos with max_dist and min_dist");
+
+	as = (chp{ execname, "randpos", "12.34,56.78", "100", "200", NULL });
+	te_randpos(OF_DEFAULT, as, 1, "12.34,56.78", 100.0, 200.0,
+	           "randpos: min_dist is larger than max_dist");
+
+	as = (chp{ execname, "--count", "27", "randpos", "1.234,5.6789",
+	           "2000", "2000", NULL });
+	te_randpos(OF_DEFAULT, as, 27, "1.234,5.6789", 2000.0, 2000.0,
+	           "randpos: max_dist is equal to min_dist, stdout looks ok");
+
+	as = (chp{ execname, "-F", "gpx", "--count", "21", "randpos",
+	           "90,0", "7741", "7777", NULL });
+	te_randpos(OF_GPX, as, 21, "90,0", 7741, 7777,
+	           "randpos, North Pole, 25 pos as GPX, dists swapped");
+
+	as = (chp{ execname, "--count", "33", "randpos", "90,0", "10000",
+	           NULL });
+	te_randpos(OF_DEFAULT, as, 33, "90,0", 0.0, 10000.0,
+	           "randpos: Exactly at the North Pole");
 
-	tc((chp{ execname, "--karney", "anti", "1,2", NULL }),
-	   "",
-	   EXECSTR ": -K/--karney is not supported by the anti command\n",
-	   EXIT_FAILURE,
-	   "--karney anti");
+	as = (chp{ execname, "--count", "34", "randpos", "-90,0", "10001",
+	           NULL });
+	te_randpos(OF_DEFAULT, as, 34, "-90,0", 0.0, 10001.0,
+	           "randpos: Exactly at the South Pole");
 }
 
-                                /*** bench ***/
+/*
+ * test_randpos_dist() - Tests the randpos command with maximum and minimum 
+ * distance. Returns nothing.
+ */
+
+static void test_randpos_dist(void)
+{
+	test_randpos_dist_max();
+	test_randpos_dist_minmax();
+}
 
 /*
- * test_cmd_bench() - Tests the `bench` command. Returns nothing.
+ * test_cmd_randpos() - Tests the randpos command. Returns nothing.
  */
 
-static void test_cmd_bench(void)
+static void test_cmd_randpos(const struct Options *o)
 {
-	diag("Test bench command");
-	sc((chp{ execname, "bench", "0", NULL }),
-	   " haversine\n",
-	   "\nLooping haversine() for ",
-	   EXIT_SUCCESS,
-	   "bench 0");
-	tc((chp{ execname, "bench", "0", "0", NULL }),
+	int res;
+	struct streams ss;
+	double lat, lon;
+	char **as;
+
+	assert(o);
+	diag("Test randpos command");
+
+	tc((chp{ execname, "randpos", "1,2", "100", "90", "5", NULL }),
 	   "",
 	   EXECSTR ": Too many arguments\n",
 	   EXIT_FAILURE,
-	   "bench has 1 extra argument");
-	sc((chp{ execname, "--format", "sql", "bench", "0", NULL }),
-	   "INSERT INTO bench VALUES ",
-	   "Looping haversine() for ",
-	   EXIT_SUCCESS,
-	   "--format sql bench");
-	tc((chp{ execname, "--format", "gpx", "bench", "0", NULL }),
-	   "",
-	   EXECSTR ": GPX output is not supported by the bench command\n",
-	   EXIT_FAILURE,
-	   "--format gpx bench");
-}
+	   "randpos with 1 extra argument");
 
-                                /*** bpos ***/
+	streams_init(&ss);
+	streams_exec(o, &ss, (chp{ execname, "randpos", NULL }));
+	lat = lon = 0;
+	res = parse_coordinate(ss.out.buf, true, &lat, &lon);
+	OK_SUCCESS(res, "randpos: Coordinate is valid");
+	OK_TRUE(fabs(lat) <= 90, "randpos: lat is in range");
+	OK_TRUE(fabs(lat) <= 180, "randpos: lon is in range");
+	streams_free(&ss);
 
-/*
- * test_cmd_bpos() - Tests the `bpos` command. Returns nothing.
- */
+	as = (chp{ execname, "--count", "5", "randpos", NULL });
+	te_randpos(OF_DEFAULT, as, 5, NULL, 0, 0,
+	           "--count 5 randpos, stdout is ok");
 
-static void test_cmd_bpos(void)
-{
-	diag("Test bpos command");
-	tc((chp{ execname, "bpos", "45,0", "45", "1000", NULL }),
-	   "45.006359,0.008994\n",
+	as = (chp{ execname, "-F", "gpx", "--count", "9", "randpos", NULL });
+	te_randpos(OF_GPX, as, 9, NULL, 0, 0,
+	           "-F gpx --count 9 randpos, stdout is ok");
+
+	diag("--count with invalid argument");
+	tc((chp{ execname, "--count", "", "randpos", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "bpos 45,0 45 1000");
-	tc((chp{ execname, "--km", "bpos", "45,0", "45", "1", NULL }),
-	   "45.006359,0.008994\n",
+	   EXECSTR ": : Invalid --count argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "Empty argument to --count");
+	tc((chp{ execname, "--count", "g", "randpos", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "--km bpos 45,0 45 1");
-	tc((chp{ execname, "bpos", "0,0", "90.0000001", "1", NULL }),
-	   "0.0,0.000009\n",
+	   EXECSTR ": g: Invalid --count argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--count receives non-number");
+	tc((chp{ execname, "--count", "11y", "randpos", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "bpos: No negative zero in lat");
-	tc((chp{ execname, "bpos", "0,0", "359.9999999", "1", NULL }),
-	   "0.000009,0.0\n",
+	   EXECSTR ": 11y: Invalid --count argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--count 11y");
+	tc((chp{ execname, "--count", "11.3", "randpos", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "bpos: No negative zero in lon");
-	tc((chp{ execname, "--km", "bpos", "-34,179", "2", "19716", NULL }),
-	   "36.688059,-1.117018\n",
+	   EXECSTR ": 11.3: Invalid --count argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--count 11.3");
+	tc((chp{ execname, "--count", "-2", "randpos", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "bpos: Longitude is normalized");
-	tc((chp{ execname, "--km", "bpos", "90,0", "180", "20000", NULL }),
-	   "-89.864321,0.0\n",
+	   EXECSTR ": -2: Invalid --count argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--count -2");
+
+	diag("--count 0");
+	tc((chp{ execname, "--count", "0", "randpos", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "bpos: North Pole, point is moved 1 cm");
-	tc((chp{ execname, "bpos", "90,97.97", "180", "1234567.89", NULL }),
-	   "78.897264,97.97\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "bpos: North Pole, longitude is kept");
-	tc((chp{ execname, "--km", "bpos", "-90,0", "359", "7000", NULL }),
-	   "-27.047487,-1.0\n",
+	   "--count 0");
+	tc((chp{ execname, "-F", "gpx", "--count", "0", "randpos", NULL }),
+	   GPX_HEADER "</gpx>\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "bpos: South Pole, bearing 359");
-	tc((chp{ execname, "bpos", "1,2", "360.0000000001", "1000", NULL }),
-	   "",
-	   EXECSTR ": 360.0000000001: Bearing out of range\n",
-	   EXIT_FAILURE,
-	   "bpos: bearing is larger than 360 degrees");
-	tc((chp{ execname, "bpos", "1,2", "-0.0000000001", "1000", NULL }),
-	   "",
-	   EXECSTR ": -0.0000000001: Bearing out of range\n",
-	   EXIT_FAILURE,
-	   "bpos: bearing is negative");
-	tc((chp{ execname, "bpos", "1,2", "r", "1000", NULL }),
+	   "-F gpx --count 0");
+	tc((chp{ execname, "-F", "sql", "--count", "10", "--seed", "1000",
+	         "randpos", "20,20", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER, lat REAL, lon REAL, dist REAL, bear REAL);\n"
+	   "INSERT INTO randpos VALUES (1000, 1, 71.13329, -57.468159, 7458038.290706, 339.955948);\n"
+	   "INSERT INTO randpos VALUES (1000, 2, 4.810956, -39.143396, 6605679.37255, 263.597432);\n"
+	   "INSERT INTO randpos VALUES (1000, 3, 31.762576, 91.243012, 7126548.517582, 63.514344);\n"
+	   "INSERT INTO randpos VALUES (1000, 4, -55.576794, -166.832537, 16018000.848656, 173.421528);\n"
+	   "INSERT INTO randpos VALUES (1000, 5, -3.788815, 152.508528, 14567412.13215, 77.097274);\n"
+	   "INSERT INTO randpos VALUES (1000, 6, 12.619138, 169.426644, 15080928.93906, 45.214445);\n"
+	   "INSERT INTO randpos VALUES (1000, 7, 32.292105, -106.309325, 11866448.651468, 314.66247);\n"
+	   "INSERT INTO randpos VALUES (1000, 8, 65.299565, 16.899777, 5042230.856845, 358.179425);\n"
+	   "INSERT INTO randpos VALUES (1000, 9, -4.673171, -44.745272, 7581105.91409, 256.164898);\n"
+	   "INSERT INTO randpos VALUES (1000, 10, 20.935854, 18.624757, 177068.647935, 306.231896);\n"
+	   "COMMIT;\n",
 	   "",
-	   EXECSTR ": r: Invalid bearing: Invalid argument\n",
-	   EXIT_FAILURE,
-	   "bpos: bearing is not a number");
-	tc((chp{ execname, "bpos", "1,2w", "3", "4", NULL }),
+	   EXIT_SUCCESS,
+	   "-F sql with coordinate and no distances");
+
+	test_randpos_dist();
+
+	diag("randpos with max_dist, invalid arguments");
+
+	tc((chp{ execname, "randpos", "12.34,56.34y", "10", NULL }),
 	   "",
-	   EXECSTR ": 1,2w: Invalid coordinate: Invalid argument\n",
+	   EXECSTR ": 12.34,56.34y: Invalid coordinate: Invalid argument\n",
 	   EXIT_FAILURE,
-	   "bpos: lon has trailing letter");
-	tc((chp{ execname, "bpos", "90.0000000001,2", "3", "4", NULL }),
+	   "randpos with error in coordinate");
+
+	tc((chp{ execname, "randpos", "12.34,56.34", "10y", NULL }),
 	   "",
-	   EXECSTR ": 90.0000000001,2: Invalid coordinate\n",
+	   EXECSTR ": 10y: Invalid max_dist argument: Invalid argument\n",
 	   EXIT_FAILURE,
-	   "bpos: lat is out of range");
-	tc((chp{ execname, "bpos", "1,2", "b", "4", NULL }),
+	   "randpos with error in max_dist");
+
+	tc((chp{ execname, "randpos", "12.34,56.34", "-17.9", NULL }),
 	   "",
-	   EXECSTR ": b: Invalid bearing: Invalid argument\n",
+	   EXECSTR ": Distance cannot be negative\n",
 	   EXIT_FAILURE,
-	   "bpos: Invalid bearing");
-	tc((chp{ execname, "bpos", "1,2", "3", "d", NULL }),
+	   "randpos with negative max_dist");
+
+	diag("randpos with max_dist and min_dist, invalid arguments");
+
+	tc((chp{ execname, "randpos", "12.34,56.34", "10", "3y", NULL }),
 	   "",
-	   EXECSTR ": d: Invalid distance: Invalid argument\n",
+	   EXECSTR ": 3y: Invalid min_dist argument: Invalid argument\n",
 	   EXIT_FAILURE,
-	   "bpos: Invalid distance");
-	tc((chp{ execname, "bpos", "1,2", "3", "4", "5", NULL }),
+	   "randpos with error in min_dist");
+
+	tc((chp{ execname, "randpos", "12.34,56.34", "9", "-2", NULL }),
 	   "",
-	   EXECSTR ": Too many arguments\n",
+	   EXECSTR ": Distance cannot be negative\n",
 	   EXIT_FAILURE,
-	   "bpos: 1 extra argument");
-	tc((chp{ execname, "-F", "default", "bpos", "40.80542,-73.96546",
-	         "188.7", "4817.84", NULL }),
-	   "40.76259,-73.974113\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "-F default bpos");
-	tc((chp{ execname, "--format", "gpx", "bpos", "40.80542,-73.96546",
-	         "188.7", "4817.84", NULL }),
-	         GPX_HEADER
-	         "  <wpt lat=\"40.76259\" lon=\"-73.974113\">\n"
-	         "    <name>bpos</name>\n"
-	         "    <cmt>bpos 40.80542,-73.96546 188.7 4817.84</cmt>\n"
-	         "  </wpt>\n"
-	         "</gpx>\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--format gpx bpos");
-	tc((chp{ execname, "-K", "bpos", "1,2", "3", "4", NULL }),
+	   "randpos with negative min_dist");
+
+	tc((chp{ execname, "--karney", "randpos", "1,2", "200", "100", NULL }),
 	   "",
-	   EXECSTR ": -K/--karney is not supported by the bpos command\n",
+	   EXECSTR ": -K/--karney is not supported by the randpos command\n",
 	   EXIT_FAILURE,
-	   "-K bpos");
+	   "--karney randpos");
 
-	diag("--format sql bpos");
-	tc((chp{ execname, "-F", "sql", "bpos", "0,0", "90", "1000", NULL }),
+	diag("--format sql randpos");
+	tc((chp{ execname, "--format", "sql", "--seed", "19", "--count", "20",
+	         "randpos", NULL }),
 	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS bpos (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
-	   "INSERT INTO bpos VALUES (0.0, 0.0, 0.0, 0.008993, 90.0, 1000.0);\n"
+	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER, lat REAL, lon REAL, dist REAL, bear REAL);\n"
+	   "INSERT INTO randpos VALUES (19, 1, 25.603688, -130.636512, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 2, -48.27306, 77.529775, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 3, -17.1173, 140.106483, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 4, -52.240484, -115.036322, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 5, 3.344781, 17.095447, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 6, 16.755787, 9.521758, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 7, -19.490223, 12.660125, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 8, 69.69621, 156.752235, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 9, 52.694091, 90.355201, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 10, -6.44931, -117.03235, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 11, 13.210432, -169.948761, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 12, -22.225278, 129.713413, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 13, -1.595068, -106.917102, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 14, -22.137051, -55.379762, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 15, 0.672918, -35.768761, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 16, 8.184838, -1.136274, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 17, -57.901507, 155.489707, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 18, 14.890397, 131.859757, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 19, 31.066093, -2.976285, NULL, NULL);\n"
+	   "INSERT INTO randpos VALUES (19, 20, 31.66207, 0.677547, NULL, NULL);\n"
 	   "COMMIT;\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "-F sql bpos 0,0 90 1000");
-	tc((chp{ execname, "-F", "sql", "--km", "bpos", "0,0", "90", "1",
-	         NULL }),
+	   "--format sql randpos without coordinate or dists");
+	tc((chp{ execname, "-F", "sql", "--seed", "19", "--count", "20",
+	         "randpos", "1,2", "200", "100", NULL }),
 	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS bpos (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
-	   "INSERT INTO bpos VALUES (0.0, 0.0, 0.0, 0.008993, 90.0, 1000.0);\n"
+	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER, lat REAL, lon REAL, dist REAL, bear REAL);\n"
+	   "INSERT INTO randpos VALUES (19, 1, 0.999739, 1.998795, 137.029826, 257.785884);\n"
+	   "INSERT INTO randpos VALUES (19, 2, 1.00116, 2.001187, 184.578986, 45.661444);\n"
+	   "INSERT INTO randpos VALUES (19, 3, 0.998948, 2.001395, 194.296589, 127.020796);\n"
+	   "INSERT INTO randpos VALUES (19, 4, 1.001014, 2.000784, 142.479955, 37.694182);\n"
+	   "INSERT INTO randpos VALUES (19, 5, 0.998461, 1.999715, 173.992388, 190.501973);\n"
+	   "INSERT INTO randpos VALUES (19, 6, 0.999042, 1.998779, 172.556828, 231.892738);\n"
+	   "INSERT INTO randpos VALUES (19, 7, 0.999223, 2.00135, 173.15511, 119.94372);\n"
+	   "INSERT INTO randpos VALUES (19, 8, 1.001736, 1.999657, 196.717262, 348.815877);\n"
+	   "INSERT INTO randpos VALUES (19, 9, 1.001344, 1.998994, 186.659487, 323.173976);\n"
+	   "INSERT INTO randpos VALUES (19, 10, 0.998803, 2.000441, 141.822259, 159.781653);\n"
+	   "INSERT INTO randpos VALUES (19, 11, 0.999209, 1.999309, 116.709311, 221.135064);\n"
+	   "INSERT INTO randpos VALUES (19, 12, 0.999353, 2.001608, 192.753169, 111.915138);\n"
+	   "INSERT INTO randpos VALUES (19, 13, 0.9987, 2.000114, 145.056415, 174.989594);\n"
+	   "INSERT INTO randpos VALUES (19, 14, 0.999461, 2.001323, 158.835986, 112.1718);\n"
+	   "INSERT INTO randpos VALUES (19, 15, 0.998532, 1.999946, 163.296314, 182.113987);\n"
+	   "INSERT INTO randpos VALUES (19, 16, 0.998618, 1.999337, 170.48714, 205.626063);\n"
+	   "INSERT INTO randpos VALUES (19, 17, 1.001568, 2.000817, 196.535789, 27.515539);\n"
+	   "INSERT INTO randpos VALUES (19, 18, 0.998799, 1.998745, 193.074008, 226.254748);\n"
+	   "INSERT INTO randpos VALUES (19, 19, 1.000077, 1.998472, 170.123644, 272.884771);\n"
+	   "INSERT INTO randpos VALUES (19, 20, 1.00012, 1.998468, 170.843636, 274.483494);\n"
 	   "COMMIT;\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "-F sql --km bpos 0,0 90 1");
-	tc((chp{ execname, "-F", "sql", "--km", "bpos",
-	         "76.2379187,-134.9876543", "43.99999", "15000", NULL }),
+	   "-F sql randpos with maxdist and mindist");
+
+	diag("randpos --min-separation");
+	tc((chp{ execname, "-F", "sql", "--seed", "5", "--count", "5",
+	         "--min-separation", "3", "--km", "randpos", "60,10", "10",
+	         NULL }),
 	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS bpos (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
-	   "INSERT INTO bpos VALUES (76.237919, -134.987654, -34.358442, 8.42343, 43.99999, 15000000.0);\n"
+	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER, lat REAL, lon REAL, dist REAL, bear REAL);\n"
+	   "INSERT INTO randpos VALUES (5, 1, 59.953594, 9.985417, 5223.545747, 188.942249);\n"
+	   "INSERT INTO randpos VALUES (5, 2, 60.009589, 9.922272, 4450.49708, 283.895809);\n"
+	   "INSERT INTO randpos VALUES (5, 3, 59.916875, 9.980919, 9303.964352, 186.563877);\n"
+	   "INSERT INTO randpos VALUES (5, 4, 60.030164, 10.108656, 6907.281086, 60.90155);\n"
+	   "INSERT INTO randpos VALUES (5, 5, 59.996317, 10.16575, 9224.899983, 92.472969);\n"
 	   "COMMIT;\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "-F sql --km bpos: dist = 15000 km");
+	   "-F sql randpos --min-separation 3 --km");
+	tc((chp{ execname, "--seed", "5", "--count", "3", "--min-separation",
+	         "1000", "--sort", "hilbert", "randpos", NULL }),
+	   "35.253771,-108.695073\n"
+	   "2.847578,-81.772451\n"
+	   "2.08981,131.62951\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "randpos --min-separation with --sort");
+	tc((chp{ execname, "--seed", "2", "--count", "3", "--min-separation",
+	         "30000", "--km", "randpos", NULL }),
+	   "55.574838,-122.730153\n",
+	   EXECSTR ": Found room for only 1 positions with the minimum"
+	   " separation\n",
+	   EXIT_FAILURE,
+	   "randpos --min-separation larger than the Earth");
+	tc((chp{ execname, "--min-separation", "-1", "randpos", NULL }),
+	   "",
+	   EXECSTR ": -1: Invalid --min-separation argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--min-separation -1");
+	tc((chp{ execname, "--min-separation", "1x", "randpos", NULL }),
+	   "",
+	   EXECSTR ": 1x: Invalid --min-separation argument: Invalid"
+	   " argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--min-separation 1x");
+	tc((chp{ execname, "--min-separation", "10", "grid", "100", NULL }),
+	   "",
+	   EXECSTR ": --min-separation is not supported by the grid"
+	   " command\n",
+	   EXIT_FAILURE,
+	   "--min-separation is not supported by grid");
 }
 
-                               /*** course ***/
+#undef te_randpos
+
+                                /*** track ***/
 
 /*
- * test_cmd_course() - Tests the `course` command. Returns nothing.
+ * test_cmd_track() - Tests the `track` command. Returns nothing.
  */
 
-static void test_cmd_course(void)
+static void test_cmd_track(void)
 {
-	char *exp_stdout;
+	char *input = "60,10\n60.1,10.2\n\n# Comment\n\n"
+	              "61,11\n61,11\n61.5,-179\n";
+	double bin[] = { 60.0, 10.0, 60.1, 10.2, NAN, NAN, 61.0, 11.0 };
+	char *buf, *p;
+	int i;
 
-	diag("Test course command");
-	tc((chp{ execname, "course", "45,0", "45,180", "1", NULL }),
-	   "45.0,0.0\n"
-	   "90.0,0.0\n"
-	   "45.0,180.0\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "course: Across the North Pole");
-	tc((chp{ execname, "course", "0,0", "0,180", "7", NULL }),
-	   "",
-	   EXECSTR ": Antipodal points, answer is undefined\n",
+	diag("Test track command");
+
+	tci((chp{ execname, "track", NULL }),
+	    input,
+	    "leg 1 1 15713.441434 44.870042\n"
+	    "segment 1 2 15713.441434\n"
+	    "leg 2 1 0.0 -\n"
+	    "leg 2 2 6367124.704356 5.653159\n"
+	    "segment 2 3 6367124.704356\n"
+	    "length 6382838.14579\n"
+	    "points 5\n"
+	    "segments 2\n"
+	    "bbox 60.0,10.0 61.5,-179.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: 2 segments from stdin");
+	tci((chp{ execname, "--km", "track", "-", NULL }),
+	    input,
+	    "leg 1 1 15.713441 44.870042\n"
+	    "segment 1 2 15.713441\n"
+	    "leg 2 1 0.0 -\n"
+	    "leg 2 2 6367.124704 5.653159\n"
+	    "segment 2 3 6367.124704\n"
+	    "length 6382.838146\n"
+	    "points 5\n"
+	    "segments 2\n"
+	    "bbox 60.0,10.0 61.5,-179.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km track -");
+	tci((chp{ execname, "-K", "-F", "sql", "track", NULL }),
+	    input,
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS track_leg (segment INTEGER,"
+	    " leg INTEGER, lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL,"
+	    " dist REAL, bear REAL);\n"
+	    "INSERT INTO track_leg VALUES (1, 1, 60.0, 10.0, 60.1, 10.2,"
+	    " 15757.48664918, 44.91812332);\n"
+	    "INSERT INTO track_leg VALUES (2, 1, 61.0, 11.0, 61.0, 11.0,"
+	    " 0.0, NULL);\n"
+	    "INSERT INTO track_leg VALUES (2, 2, 61.0, 11.0, 61.5, -179.0,"
+	    " 6390549.54640561, 5.65240767);\n"
+	    "CREATE TABLE IF NOT EXISTS track (points INTEGER,"
+	    " segments INTEGER, dist REAL, south REAL, west REAL,"
+	    " north REAL, east REAL, ascent REAL, descent REAL,"
+	    " duration REAL);\n"
+	    "INSERT INTO track VALUES (5, 2, 6406307.03305479, 60.0, 10.0,"
+	    " 61.5, -179.0, NULL, NULL, NULL);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-K -F sql track");
+	tci((chp{ execname, "track", NULL }),
+	    "",
+	    "length 0.0\n"
+	    "points 0\n"
+	    "segments 0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: Empty input");
+	tci((chp{ execname, "-F", "sql", "track", NULL }),
+	    "\n\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS track_leg (segment INTEGER,"
+	    " leg INTEGER, lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL,"
+	    " dist REAL, bear REAL);\n"
+	    "CREATE TABLE IF NOT EXISTS track (points INTEGER,"
+	    " segments INTEGER, dist REAL, south REAL, west REAL,"
+	    " north REAL, east REAL, ascent REAL, descent REAL,"
+	    " duration REAL);\n"
+	    "INSERT INTO track VALUES (0, 0, 0, NULL, NULL, NULL, NULL, NULL,"
+	    " NULL, NULL);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F sql track: Only empty lines");
+	tci((chp{ execname, "track", NULL }),
+	    "  0 , 0 \r\n",
+	    "segment 1 1 0.0\n"
+	    "length 0.0\n"
+	    "points 1\n"
+	    "segments 1\n"
+	    "bbox 0.0,0.0 0.0,0.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: 1 position with whitespace and CRLF");
+	tci((chp{ execname, "track", NULL }),
+	    "0,0\n0,180\n",
+	    "leg 1 1 20015086.796021 -\n"
+	    "segment 1 2 20015086.796021\n"
+	    "length 20015086.796021\n"
+	    "points 2\n"
+	    "segments 1\n"
+	    "bbox 0.0,0.0 0.0,180.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: Antipodal positions, bearing is undefined");
+	tci((chp{ execname, "-K", "track", NULL }),
+	    "0,0\n0,180\n",
+	    "",
+	    EXECSTR ": Formula did not converge in segment 1, leg 1,"
+	    " antipodal points\n",
+	    EXIT_FAILURE,
+	    "-K track: Antipodal positions");
+	tci((chp{ execname, "-K", "track", NULL }),
+	    "0,0\n0,180\n\n",
+	    "",
+	    EXECSTR ": Formula did not converge in segment 1, leg 1,"
+	    " antipodal points\n",
+	    EXIT_FAILURE,
+	    "-K track: Antipodal positions before empty line");
+	tci((chp{ execname, "track", NULL }),
+	    "0,0\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "track: Latitude out of range");
+	tci((chp{ execname, "track", NULL }),
+	    "0,0\n\n1,2,3\r\n",
+	    "segment 1 1 0.0\n",
+	    EXECSTR ": (stdin):3: Invalid coordinate: 1,2,3\n",
+	    EXIT_FAILURE,
+	    "track: Too many values on a line");
+	tci((chp{ execname, "track", NULL }),
+	    "abc\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: abc\n",
+	    EXIT_FAILURE,
+	    "track: No comma");
+	tc((chp{ execname, "track", "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
 	   EXIT_FAILURE,
-	   "course 0,0 0,180 7");
-	tc((chp{ execname, "course", "90,0", "0,0", "3", NULL }),
-	   "90.0,0.0\n"
-	   "67.5,0.0\n"
-	   "45.0,0.0\n"
-	   "22.5,0.0\n"
-	   "0.0,0.0\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "course 90,0 0,0 3");
-	exp_stdout = "60.39299,5.32415\n"
-	             "66.169926,16.700678\n"
-	             "70.664233,33.818071\n"
-	             "72.834329,57.579125\n"
-	             "71.826607,82.903321\n"
-	             "68.075305,102.664288\n"
-	             "62.689678,115.951619\n"
-	             "56.44951,124.8845\n"
-	             "49.752575,131.21524\n"
-	             "42.795549,135.979229\n"
-	             "35.681389,139.766944\n";
-	tc((chp{ execname, "course", "60.39299,5.32415",
-	         "35.681389,139.766944", "9", NULL }),
-	   exp_stdout,
-	   "",
-	   EXIT_SUCCESS,
-	   "course: From Bergen to Tokyo");
-	tc((chp{ execname, "--km", "course", "60.39299,5.32415",
-	         "35.681389,139.766944", "9", NULL }),
-	   exp_stdout,
+	   "track: File doesn't exist");
+	tc((chp{ execname, "--input-format", "default", "track", "/dev/null",
+	         NULL }),
+	   "length 0.0\n"
+	   "points 0\n"
+	   "segments 0\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "--km course: From Bergen to Tokyo");
-	tc((chp{ execname, "course", "1,2", "3,4", NULL }),
-	   "",
-	   EXECSTR ": Missing arguments\n",
-	   EXIT_FAILURE,
-	   "course: Missing 1 argument");
-	tc((chp{ execname, "course", "1,2", "3,4", "5", "6", NULL }),
+	   "--input-format default track /dev/null");
+	tc((chp{ execname, "track", "a", "b", NULL }),
 	   "",
 	   EXECSTR ": Too many arguments\n",
 	   EXIT_FAILURE,
-	   "course: 1 argument too much");
-	tc((chp{ execname, "course", "90.00001,0", "12,34", "1", NULL }),
+	   "track: Too many arguments");
+	tc((chp{ execname, "-F", "gpx", "track", NULL }),
 	   "",
-	   EXECSTR ": 90.00001,0: Invalid coordinate\n",
+	   EXECSTR ": GPX output is not supported by the track command\n",
 	   EXIT_FAILURE,
-	   "course: lat1 is outside range");
-	tc((chp{ execname, "course", "17,0", "12,34", "-1", NULL }),
+	   "-F gpx track");
+	tc((chp{ execname, "--input-format", "abc", "track", NULL }),
 	   "",
-	   EXECSTR ": -1: Number of intermediate points cannot be negative\n",
+	   EXECSTR ": abc: Unknown input format\n",
 	   EXIT_FAILURE,
-	   "course: numpoints is -1");
-	tc((chp{ execname, "course", "17,6", "12,34", "-0.5", NULL }),
-	   "",
-	   EXECSTR ": -0.5: Number of intermediate points cannot be negative\n",
+	   "--input-format abc");
+
+	tci_func(__LINE__, 1, (chp{ execname, "--input-format", "binary",
+	                            "track", NULL }),
+	         (char *)bin, sizeof(bin),
+	         "leg 1 1 15713.441434 44.870042\n"
+	         "segment 1 2 15713.441434\n"
+	         "segment 2 1 0.0\n"
+	         "length 15713.441434\n"
+	         "points 3\n"
+	         "segments 2\n"
+	         "bbox 60.0,10.0 61.0,11.0\n",
+	         "",
+	         EXIT_SUCCESS,
+	         "--input-format binary track");
+	tci_func(__LINE__, 1, (chp{ execname, "--input-format", "binary",
+	                            "track", NULL }),
+	         (char *)bin, sizeof(bin) - sizeof(double),
+	         "leg 1 1 15713.441434 44.870042\n"
+	         "segment 1 2 15713.441434\n",
+	         EXECSTR ": (stdin): Incomplete record after record 3\n",
+	         EXIT_FAILURE,
+	         "--input-format binary track: Incomplete record");
+	bin[1] = 180.5;
+	tci_func(__LINE__, 1, (chp{ execname, "--input-format", "binary",
+	                            "track", NULL }),
+	         (char *)bin, sizeof(bin),
+	         "",
+	         EXECSTR ": (stdin): Invalid coordinate in record 1\n",
+	         EXIT_FAILURE,
+	         "--input-format binary track: Longitude out of range");
+
+	/* More positions than TRACK_BATCH */
+	buf = malloc(3000 * 16 + 1);
+	if (!buf) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	for (i = 0, p = buf; i < 3000; i++)
+		p += sprintf(p, "0,%d.%03d\n", i / 1000, i % 1000);
+	sci((chp{ execname, "track", NULL }),
+	    buf,
+	    "leg 1 1024 111.194927 90.0\n"
+	    "leg 1 1025 111.194927 90.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: Legs are continuous across batches");
+	sci((chp{ execname, "track", NULL }),
+	    buf,
+	    "\nsegment 1 3000 333473.585007\n"
+	    "length 333473.585007\n"
+	    "points 3000\n"
+	    "segments 1\n"
+	    "bbox 0.0,0.0 0.0,2.999\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: 3000 positions");
+	for (i = 0, p = buf; i < TRACK_BATCH + 1; i++)
+		p += sprintf(p, "0,%d\n", i ? 180 : 0);
+	tci((chp{ execname, "-K", "track", NULL }),
+	    buf,
+	    "",
+	    EXECSTR ": Formula did not converge in segment 1, leg 1,"
+	    " antipodal points\n",
+	    EXIT_FAILURE,
+	    "-K track: Antipodal positions in a full batch");
+	free(buf);
+}
+
+/*
+ * test_cmd_track_gpx() - Tests the `track` command with GPX input. Returns 
+ * nothing.
+ */
+
+static void test_cmd_track_gpx(void)
+{
+	char *gpx = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	            "<!-- <trkpt lat=\"1\" lon=\"2\"> -- -> -->\n"
+	            "<gpx xmlns=\"http://www.topografix.com/GPX/1/1\">\n"
+	            "<metadata><time>2000</time></metadata>\n"
+	            "<trk><name><![CDATA[<trkseg>]]]]></name>\n"
+	            "<trkseg>\n"
+	            "<trkpt lat=\"60\" lon=\"10\">"
+	            "<ele>100</ele><time>2024-01-02T03:04:05Z</time>"
+	            "</trkpt>\n"
+	            "<trkpt lon = '10' lat = '60.01'>"
+	            "<ele><![CDATA[ 110.5 ]]></ele>"
+	            "<time>2024-01-02T04:04:35.5+01:00</time>"
+	            "</trkpt>\n"
+	            "<trkpt lat=\"60.02\" lon=\"10\"><ele>90</ele></trkpt>\n"
+	            "</trkseg>\n"
+	            "<trkseg>\n"
+	            "<gpx:trkpt lat=\"61\" lon=\"11\" />\n"
+	            "<trkpt lat=\"61.01\" lon=\"11\">"
+	            "<time>2024-01-02T03:00:00Z</time></trkpt>\n"
+	            "<trkpt lat=\"61.02\" lon=\"11\">"
+	            "<time>2024-01-02T04:00:00Z</time></trkpt>\n"
+	            "</trkseg>\n"
+	            "</trk>\n"
+	            "</gpx>\n";
+	char *buf, *p;
+	int i;
+
+	diag("Test track command with GPX input");
+
+	tci((chp{ execname, "track", NULL }),
+	    gpx,
+	    "leg 1 1 1111.949266 0.0\n"
+	    "leg 1 2 1111.949266 0.0\n"
+	    "segment 1 3 2223.898533\n"
+	    "leg 2 1 1111.949266 0.0\n"
+	    "leg 2 2 1111.949266 0.0\n"
+	    "segment 2 3 2223.898533\n"
+	    "length 4447.797066\n"
+	    "points 6\n"
+	    "segments 2\n"
+	    "bbox 60.0,10.0 61.02,11.0\n"
+	    "ascent 10.5\n"
+	    "descent 20.5\n"
+	    "duration 3630.5\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: GPX is detected automatically");
+	tci((chp{ execname, "--km", "--input-format", "gpx", "track", NULL }),
+	    gpx,
+	    "leg 1 1 1.111949 0.0\n"
+	    "leg 1 2 1.111949 0.0\n"
+	    "segment 1 3 2.223899\n"
+	    "leg 2 1 1.111949 0.0\n"
+	    "leg 2 2 1.111949 0.0\n"
+	    "segment 2 3 2.223899\n"
+	    "length 4.447797\n"
+	    "points 6\n"
+	    "segments 2\n"
+	    "bbox 60.0,10.0 61.02,11.0\n"
+	    "ascent 0.0105\n"
+	    "descent 0.0205\n"
+	    "duration 3630.5\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km --input-format gpx track");
+	tci((chp{ execname, "-F", "sql", "--km", "track", NULL }),
+	    gpx,
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS track_leg (segment INTEGER,"
+	    " leg INTEGER, lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL,"
+	    " dist REAL, bear REAL);\n"
+	    "INSERT INTO track_leg VALUES (1, 1, 60.0, 10.0, 60.01, 10.0,"
+	    " 1111.949266, 0.0);\n"
+	    "INSERT INTO track_leg VALUES (1, 2, 60.01, 10.0, 60.02, 10.0,"
+	    " 1111.949266, 0.0);\n"
+	    "INSERT INTO track_leg VALUES (2, 1, 61.0, 11.0, 61.01, 11.0,"
+	    " 1111.949266, 0.0);\n"
+	    "INSERT INTO track_leg VALUES (2, 2, 61.01, 11.0, 61.02, 11.0,"
+	    " 1111.949266, 0.0);\n"
+	    "CREATE TABLE IF NOT EXISTS track (points INTEGER,"
+	    " segments INTEGER, dist REAL, south REAL, west REAL,"
+	    " north REAL, east REAL, ascent REAL, descent REAL,"
+	    " duration REAL);\n"
+	    "INSERT INTO track VALUES (6, 2, 4447.797066, 60.0, 10.0, 61.02,"
+	    " 11.0, 10.5, 20.5, 3630.5);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F sql --km track: GPX with ele and time");
+	tci((chp{ execname, "track", NULL }),
+	    "\xef\xbb\xbf<gpx><wpt lat=\"1\" lon=\"2\" id=\"a\"/>"
+	    "<wpt lat=\"1\" lon=\"3\"></wpt><rte><rtept lat=\"4\""
+	    " lon=\"5\"/></rte><trkpt lat=\"6\" lon=\"7\"/></gpx>",
+	    "leg 1 1 111177.990689 89.991274\n"
+	    "segment 1 2 111177.990689\n"
+	    "segment 2 1 0.0\n"
+	    "segment 3 1 0.0\n"
+	    "length 111177.990689\n"
+	    "points 4\n"
+	    "segments 3\n"
+	    "bbox 1.0,2.0 6.0,7.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: GPX with BOM, new segment when the point type changes");
+	tci((chp{ execname, "--input-format", "gpx", "track", NULL }),
+	    "",
+	    "length 0.0\n"
+	    "points 0\n"
+	    "segments 0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--input-format gpx track: Empty input");
+	tci((chp{ execname, "track", NULL }),
+	    " \n\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):3: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "track: Line number after whitespace is correct");
+
+	tci((chp{ execname, "track", NULL }),
+	    "\n\n<gpx>\n<wpt lat=\"1\">\n</wpt></gpx>\n",
+	    "",
+	    EXECSTR ": (stdin):4: Missing or invalid lat/lon attribute in"
+	    " <wpt>\n",
+	    EXIT_FAILURE,
+	    "track: GPX, lon is missing");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><trkpt lat=\"1\"\nlon=\"180.1\"/></gpx>",
+	    "",
+	    EXECSTR ": (stdin):2: Missing or invalid lat/lon attribute in"
+	    " <trkpt>\n",
+	    EXIT_FAILURE,
+	    "track: GPX, lon is out of range");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><trkpt lat=\"abc\" lon=\"1\"/></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Missing or invalid lat/lon attribute in"
+	    " <trkpt>\n",
+	    EXIT_FAILURE,
+	    "track: GPX, lat is invalid");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><trkpt lat=1 lon=2/></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Missing or invalid lat/lon attribute in"
+	    " <trkpt>\n",
+	    EXIT_FAILURE,
+	    "track: GPX, attribute values without quotes");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><trkpt lat lon=\"2\"/></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Missing or invalid lat/lon attribute in"
+	    " <trkpt>\n",
+	    EXIT_FAILURE,
+	    "track: GPX, attribute without value");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><trkpt \"lat=\"/></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Missing or invalid lat/lon attribute in"
+	    " <trkpt>\n",
+	    EXIT_FAILURE,
+	    "track: GPX, quote in attribute name");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"><ele>12 m</ele></wpt></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid value in <ele>: 12 m\n",
+	    EXIT_FAILURE,
+	    "track: GPX, invalid elevation");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"><ele><![CDATA[5]]]></ele>"
+	    "</wpt></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid value in <ele>: 5]\n",
+	    EXIT_FAILURE,
+	    "track: GPX, ']' before the end of CDATA");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"><ele><![CDATA[5]]x]]></ele>"
+	    "</wpt></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid value in <ele>: 5]]x\n",
+	    EXIT_FAILURE,
+	    "track: GPX, \"]]\" inside CDATA");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"><ele>"
+	    "1234567890123456789012345678901234567890"
+	    "12345678901234567890123456789</ele></wpt></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Value in <ele> is too long\n",
+	    EXIT_FAILURE,
+	    "track: GPX, value is too long");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\">\n"
+	    "<time>2024-02-30T00:00:00Z</time></wpt></gpx>",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid value in <time>:"
+	    " 2024-02-30T00:00:00Z\n",
+	    EXIT_FAILURE,
+	    "track: GPX, invalid time");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"></trkpt></gpx>",
+	    "",
+	    EXECSTR ": (stdin):1: Unexpected end tag </trkpt>\n",
+	    EXIT_FAILURE,
+	    "track: GPX, wrong end tag");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"><wpt lat=\"1\" lon=\"2\">",
+	    "",
+	    EXECSTR ": (stdin):1: Nested point element <wpt>\n",
+	    EXIT_FAILURE,
+	    "track: GPX, nested point elements");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\">\n",
+	    "",
+	    EXECSTR ": (stdin):2: Unexpected end of file\n",
+	    EXIT_FAILURE,
+	    "track: GPX, end of file inside a point");
+	tci((chp{ execname, "track", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"/><!-- >",
+	    "",
+	    EXECSTR ": (stdin):1: Unexpected end of file\n",
+	    EXIT_FAILURE,
+	    "track: GPX, end of file inside a comment");
+
+	buf = malloc(GPX_TAGSIZE + 100);
+	if (!buf) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	p = buf + sprintf(buf, "<gpx><wpt lat=\"1\" lon=\"2\" name=\"");
+	memset(p, 'x', GPX_TAGSIZE);
+	strcpy(p + GPX_TAGSIZE, "\"/></gpx>");
+	tci((chp{ execname, "track", NULL }),
+	    buf,
+	    "",
+	    EXECSTR ": (stdin):1: Tag is too long\n",
+	    EXIT_FAILURE,
+	    "track: GPX, tag is too long");
+	free(buf);
+
+	/* More data than GPX_BUFSIZE */
+	buf = malloc(3000 * 48 + 100);
+	if (!buf) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	p = buf + sprintf(buf, "<gpx><trk><trkseg>\n");
+	for (i = 0; i < 3000; i++) {
+		p += sprintf(p, "<trkpt lat=\"0\" lon=\"%d.%03d\"></trkpt>\n",
+		             i / 1000, i % 1000);
+	}
+	strcpy(p, "</trkseg></trk></gpx>\n");
+	sci((chp{ execname, "track", NULL }),
+	    buf,
+	    "\nsegment 1 3000 333473.585007\n"
+	    "length 333473.585007\n"
+	    "points 3000\n"
+	    "segments 1\n"
+	    "bbox 0.0,0.0 0.0,2.999\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "track: GPX with 3000 positions");
+	free(buf);
+}
+
+                               /*** simplify ***/
+
+/*
+ * test_cmd_simplify() - Tests the `simplify` command. Returns nothing.
+ */
+
+static void test_cmd_simplify(void)
+{
+	char *zigzag = "0,0\n0.001,1\n0,2\n0.0005,3\n0,4\n";
+	char *input = "60,5\n60.1,5.1\n60.2,5.2\n60.5,5.4\n61,6\n\n\n"
+	              "60,5\n60.001,5.5\n60,6\n\n10,10\n";
+	char *buf, *p;
+	int i;
+
+	diag("Test simplify command");
+
+	tci((chp{ execname, "simplify", "3000", NULL }),
+	    input,
+	    "60.0,5.0\n"
+	    "60.5,5.4\n"
+	    "61.0,6.0\n"
+	    "\n"
+	    "60.0,5.0\n"
+	    "60.0,6.0\n"
+	    "\n"
+	    "10.0,10.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "simplify 3000");
+	tci((chp{ execname, "simplify", "0", "-", NULL }),
+	    zigzag,
+	    "0.0,0.0\n"
+	    "0.001,1.0\n"
+	    "0.0,2.0\n"
+	    "0.0005,3.0\n"
+	    "0.0,4.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "simplify 0 -");
+	tci((chp{ execname, "simplify", "60", NULL }),
+	    zigzag,
+	    "0.0,0.0\n"
+	    "0.001,1.0\n"
+	    "0.0,2.0\n"
+	    "0.0,4.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "simplify 60");
+	tci((chp{ execname, "simplify", "100", NULL }),
+	    zigzag,
+	    "0.0,0.0\n"
+	    "0.001,1.0\n"
+	    "0.0,4.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "simplify 100");
+	tci((chp{ execname, "-K", "-F", "sql", "simplify", "6.16", NULL }),
+	    input,
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS simplify (segment INTEGER,"
+	    " num INTEGER, lat REAL, lon REAL);\n"
+	    "INSERT INTO simplify VALUES (1, 1, 60.0, 5.0);\n"
+	    "INSERT INTO simplify VALUES (1, 2, 60.1, 5.1);\n"
+	    "INSERT INTO simplify VALUES (1, 3, 60.2, 5.2);\n"
+	    "INSERT INTO simplify VALUES (1, 4, 60.5, 5.4);\n"
+	    "INSERT INTO simplify VALUES (1, 5, 61.0, 6.0);\n"
+	    "INSERT INTO simplify VALUES (2, 1, 60.0, 5.0);\n"
+	    "INSERT INTO simplify VALUES (2, 2, 60.001, 5.5);\n"
+	    "INSERT INTO simplify VALUES (2, 3, 60.0, 6.0);\n"
+	    "INSERT INTO simplify VALUES (3, 1, 10.0, 10.0);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-K -F sql simplify 6.16");
+	tci((chp{ execname, "simplify", "6.16", NULL }),
+	    "60,5\n60.001,5.5\n60,6\n",
+	    "60.0,5.0\n"
+	    "60.0,6.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "simplify 6.16, the spherical distance is shorter");
+	tci((chp{ execname, "--km", "-F", "gpx", "simplify", "100", NULL }),
+	    input,
+	    GPX_HEADER
+	    "  <trk>\n"
+	    "    <trkseg>\n"
+	    "      <trkpt lat=\"60.0\" lon=\"5.0\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"61.0\" lon=\"6.0\">\n"
+	    "      </trkpt>\n"
+	    "    </trkseg>\n"
+	    "    <trkseg>\n"
+	    "      <trkpt lat=\"60.0\" lon=\"5.0\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"60.0\" lon=\"6.0\">\n"
+	    "      </trkpt>\n"
+	    "    </trkseg>\n"
+	    "    <trkseg>\n"
+	    "      <trkpt lat=\"10.0\" lon=\"10.0\">\n"
+	    "      </trkpt>\n"
+	    "    </trkseg>\n"
+	    "  </trk>\n"
+	    "</gpx>\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km -F gpx simplify 100");
+	tci((chp{ execname, "-F", "gpx", "simplify", "1", NULL }),
+	    "",
+	    GPX_HEADER
+	    "  <trk>\n"
+	    "  </trk>\n"
+	    "</gpx>\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F gpx simplify: Empty input");
+	tci((chp{ execname, "simplify", "1", NULL }),
+	    "0,0\n0,0\n0,0\n",
+	    "0.0,0.0\n"
+	    "0.0,0.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "simplify: Coincident positions");
+	tci((chp{ execname, "simplify", "1", NULL }),
+	    "0,0\n0,1\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):3: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "simplify: Invalid coordinate");
+	tc((chp{ execname, "simplify", "abc", NULL }),
+	   "",
+	   EXECSTR ": abc: Invalid tolerance: Invalid argument\n",
 	   EXIT_FAILURE,
-	   "course: numpoints is -0.5");
-	tc((chp{ execname, "course", "22,33", "44,55", "0", NULL }),
-	   "22.0,33.0\n"
-	   "44.0,55.0\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "course: numpoints is 0");
-	tc((chp{ execname, "course", "17,6%", "12,34", "-1", NULL }),
+	   "simplify: Invalid tolerance");
+	tc((chp{ execname, "simplify", "inf", NULL }),
 	   "",
-	   EXECSTR ": 17,6%: Invalid coordinate: Invalid argument\n",
+	   EXECSTR ": inf: Invalid tolerance: Numerical result out of range\n",
 	   EXIT_FAILURE,
-	   "course: lon1 is invalid number");
-	tc((chp{ execname, "course", "1,2", "xxx", "4", NULL }),
+	   "simplify: Infinite tolerance");
+	tc((chp{ execname, "simplify", "-1", NULL }),
 	   "",
-	   EXECSTR ": xxx: Invalid coordinate\n",
+	   EXECSTR ": -1: Tolerance cannot be negative\n",
 	   EXIT_FAILURE,
-	   "course: coor2 is invalid");
-	tc((chp{ execname, "course", "1,2", "3,4", "r", NULL }),
+	   "simplify: Negative tolerance");
+	tc((chp{ execname, "simplify", "1", "/nonexistent/file", NULL }),
 	   "",
-	   EXECSTR ": r: Invalid number of points: Invalid argument\n",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
 	   EXIT_FAILURE,
-	   "course: Invalid value in number of points");
-	tc((chp{ execname, "-F", "default", "course",
-	         "52.3731,4.891", "35.681,139.767", "5", NULL }),
-	   "52.3731,4.891\n"
-	   "62.68586,22.57978\n"
-	   "68.869393,53.549146\n"
-	   "67.245712,91.173953\n"
-	   "59.021383,116.487394\n"
-	   "47.913547,130.771879\n"
-	   "35.681,139.767\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "-F default course, Amsterdam to Tokyo");
-	tc((chp{ execname, "-F", "gpx", "course",
-	         "52.3731,4.891", "35.681,139.767", "5", NULL }),
-	   GPX_HEADER
-	   "  <rte>\n"
-	   "    <rtept lat=\"52.3731\" lon=\"4.891\">\n"
-	   "    </rtept>\n"
-	   "    <rtept lat=\"62.68586\" lon=\"22.57978\">\n"
-	   "    </rtept>\n"
-	   "    <rtept lat=\"68.869393\" lon=\"53.549146\">\n"
-	   "    </rtept>\n"
-	   "    <rtept lat=\"67.245712\" lon=\"91.173953\">\n"
-	   "    </rtept>\n"
-	   "    <rtept lat=\"59.021383\" lon=\"116.487394\">\n"
-	   "    </rtept>\n"
-	   "    <rtept lat=\"47.913547\" lon=\"130.771879\">\n"
-	   "    </rtept>\n"
-	   "    <rtept lat=\"35.681\" lon=\"139.767\">\n"
-	   "    </rtept>\n"
-	   "  </rte>\n"
-	   "</gpx>\n",
+	   "simplify: File doesn't exist");
+	tc((chp{ execname, "simplify", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "-F gpx course, Amsterdam to Tokyo");
-	tc((chp{ execname, "--karney", "course", "1,2", "3,4", "5", NULL }),
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "simplify: Missing arguments");
+	tc((chp{ execname, "simplify", "1", "a", "b", NULL }),
 	   "",
-	   EXECSTR ": -K/--karney is not supported by the course command\n",
+	   EXECSTR ": Too many arguments\n",
 	   EXIT_FAILURE,
-	   "--karney course");
+	   "simplify: Too many arguments");
 
-	diag("--format sql course");
-	tc((chp{ execname, "-F", "sql", "course", "-45,-123", "45,-123", "5",
-	         NULL }),
-	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS course (num INTEGER, lat REAL, lon REAL, dist REAL, frac REAL, bear REAL);\n"
-	   "INSERT INTO course VALUES (0, -45.0, -123.0, 0.0, 0.0, 0.0);\n"
-	   "INSERT INTO course VALUES (1, -30.0, -123.0, 1667923.899668, 0.166667, 0.0);\n"
-	   "INSERT INTO course VALUES (2, -15.0, -123.0, 3335847.799337, 0.333333, 0.0);\n"
-	   "INSERT INTO course VALUES (3, 0.0, -123.0, 5003771.699005, 0.5, 0.0);\n"
-	   "INSERT INTO course VALUES (4, 15.0, -123.0, 6671695.598674, 0.666667, 0.0);\n"
-	   "INSERT INTO course VALUES (5, 30.0, -123.0, 8339619.498342, 0.833333, 0.0);\n"
-	   "INSERT INTO course VALUES (6, 45.0, -123.0, 10007543.39801, 1.0, NULL);\n"
-	   "COMMIT;\n",
+	/* More positions than SIMPLIFY_WINDOW */
+	buf = malloc((SIMPLIFY_WINDOW + 1000) * 16 + 1);
+	if (!buf) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	for (i = 0, p = buf; i < SIMPLIFY_WINDOW + 1000; i++)
+		p += sprintf(p, "0,%d.%04d\n", i / 10000, i % 10000);
+	tci((chp{ execname, "simplify", "0.001", NULL }),
+	    buf,
+	    "0.0,0.0\n"
+	    "0.0,1.6383\n"
+	    "0.0,1.7383\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "simplify: The window boundary is kept");
+	free(buf);
+}
+
+/*** xtrack ***/
+
+/*
+ * create_tmpfile() - Creates a temporary file with the contents `s`. Returns 
+ * an allocated string with the name of the file, or NULL if anything failed.
+ */
+
+static char *create_tmpfile(const char *s)
+{
+	char *fname;
+	FILE *fp;
+	int fd;
+
+	fname = mystrdup("/tmp/geocalc-selftest-XXXXXX");
+	if (!fname)
+		return NULL; /* gncov */
+	fd = mkstemp(fname);
+	if (fd == -1) {
+		free(fname); /* gncov */
+		return NULL; /* gncov */
+	}
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		close(fd); /* gncov */
+		unlink(fname); /* gncov */
+		free(fname); /* gncov */
+		return NULL; /* gncov */
+	}
+	if (fputs(s, fp) == EOF) {
+		fclose(fp); /* gncov */
+		unlink(fname); /* gncov */
+		free(fname); /* gncov */
+		return NULL; /* gncov */
+	}
+	if (fclose(fp) == EOF) {
+		unlink(fname); /* gncov */
+		free(fname); /* gncov */
+		return NULL; /* gncov */
+	}
+
+	return fname;
+}
+
+/*
+ * test_cmd_xtrack() - Tests the `xtrack` command. Returns nothing.
+ */
+
+static void test_cmd_xtrack(void)
+{
+	char *route, *seg, *single, *buf, *p, *errmsg = NULL;
+	int i;
+
+	diag("Test xtrack command");
+
+	route = create_tmpfile("60,5\n61,6\n");
+	seg = create_tmpfile("0,0\n0,10\n\n10,10\n10,20\n");
+	single = create_tmpfile("# Only one position\n60,5\n\n61,6\n");
+	if (!route || !seg || !single) {
+		failed_ok("create_tmpfile()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+
+	tci((chp{ execname, "xtrack", route, NULL }),
+	    "60.5,5.6\n60.5,5.4\n\n59,4\n62,7\n",
+	    "5335.180205 64486.798829 1\n"
+	    "-4489.298719 59649.037512 1\n"
+	    "-124693.460161 0.0 1\n"
+	    "-123201.340477 123941.820518 1\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "xtrack");
+	tci((chp{ execname, "--km", "xtrack", seg, "-", NULL }),
+	    "1,5\n-1,5\n5,10\n10,15\n11,25\n",
+	    "-111.194927 555.974633 1\n"
+	    "111.194927 555.974633 1\n"
+	    "-555.974633 1111.949266 1\n"
+	    "4.161253 1659.456379 2\n"
+	    "-557.845883 2206.963491 2\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km xtrack, route with 2 segments");
+	tci((chp{ execname, "--km", "-F", "sql", "xtrack", seg, NULL }),
+	    "1,5\n10,15\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS xtrack (num INTEGER, lat REAL,"
+	    " lon REAL, xtrack REAL, atrack REAL, leg INTEGER);\n"
+	    "INSERT INTO xtrack VALUES (1, 1.0, 5.0, -111194.926645,"
+	    " 555974.633223, 1);\n"
+	    "INSERT INTO xtrack VALUES (2, 10.0, 15.0, 4161.252845,"
+	    " 1659456.378741, 2);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km -F sql xtrack");
+	tci((chp{ execname, "xtrack", route, NULL }),
+	    "",
+	    "",
+	    "",
+	    EXIT_SUCCESS,
+	    "xtrack: No positions");
+	tci((chp{ execname, "xtrack", "-", route, NULL }),
+	    "0,0\n0,1\n",
+	    "-6680652.11726 111194.926645 1\n"
+	    "-6796321.123222 111194.926645 1\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "xtrack: Route from stdin");
+	tci((chp{ execname, "xtrack", "-", NULL }),
+	    "",
+	    "",
+	    EXECSTR ": The route and the positions cannot both be read"
+	    " from stdin\n",
+	    EXIT_FAILURE,
+	    "xtrack: Both from stdin");
+	tc((chp{ execname, "xtrack", "-", "-", NULL }),
+	   "",
+	   EXECSTR ": The route and the positions cannot both be read"
+	   " from stdin\n",
+	   EXIT_FAILURE,
+	   "xtrack - -");
+	tci((chp{ execname, "xtrack", "-", route, NULL }),
+	    "60,5\n",
+	    "",
+	    EXECSTR ": (stdin): The route must contain at least one leg\n",
+	    EXIT_FAILURE,
+	    "xtrack: The route has only one position");
+	errmsg = allocstr("%s: %s: The route must contain at least one leg\n",
+	                  EXECSTR, single);
+	if (!errmsg) {
+		failed_ok("allocstr()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	tci((chp{ execname, "xtrack", single, NULL }),
+	    "60,5\n",
+	    "",
+	    errmsg,
+	    EXIT_FAILURE,
+	    "xtrack: Segments with only one position");
+	tci((chp{ execname, "xtrack", "-", route, NULL }),
+	    "60,5\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "xtrack: Invalid coordinate in the route");
+	tci((chp{ execname, "xtrack", route, NULL }),
+	    "60,5\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "xtrack: Invalid coordinate in the positions");
+	tc((chp{ execname, "xtrack", "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "xtrack: Route file doesn't exist");
+	tc((chp{ execname, "xtrack", route, "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "xtrack: Position file doesn't exist");
+	tc((chp{ execname, "-F", "gpx", "xtrack", route, NULL }),
+	   "",
+	   EXECSTR ": GPX output is not supported by the xtrack command\n",
+	   EXIT_FAILURE,
+	   "-F gpx xtrack");
+	tc((chp{ execname, "-K", "xtrack", route, NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "-F sql course -45,-123 45,-123 5");
-	tc((chp{ execname, "-F", "sql", "course", "60,5", "-35,135", "5",
-	         NULL }),
-	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS course (num INTEGER, lat REAL, lon REAL, dist REAL, frac REAL, bear REAL);\n"
-	   "INSERT INTO course VALUES (0, 60.0, 5.0, 0.0, 0.0, 74.908926);\n"
-	   "INSERT INTO course VALUES (1, 57.898298, 50.808536, 2584622.088993, 0.166667, 114.711921);\n"
-	   "INSERT INTO course VALUES (2, 43.683265, 80.527411, 5169244.094446, 0.333333, 138.121194);\n"
-	   "INSERT INTO course VALUES (3, 24.968228, 97.421916, 7753866.163712, 0.5, 147.823758);\n"
-	   "INSERT INTO course VALUES (4, 4.878069, 109.598447, 10338488.288345, 0.666667, 151.019525);\n"
-	   "INSERT INTO course VALUES (5, -15.417397, 121.038906, 12923110.365395, 0.833333, 149.948567);\n"
-	   "INSERT INTO course VALUES (6, -35.0, 135.0, 15507732.39972, 1.0, NULL);\n"
-	   "COMMIT;\n",
+	   EXECSTR ": -K/--karney is not supported by the xtrack command\n",
+	   EXIT_FAILURE,
+	   "-K xtrack");
+	tc((chp{ execname, "xtrack", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "-F sql course 60,5 -35,135 5");
-}
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "xtrack: Missing arguments");
+	tc((chp{ execname, "xtrack", "a", "b", "c", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "xtrack: Too many arguments");
 
-                                /*** lpos ***/
+	/* More positions than XTRACK_BATCH */
+	buf = malloc((XTRACK_BATCH + 1) * 8 + 1);
+	if (!buf) {
+		failed_ok("malloc()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	for (i = 0, p = buf; i < XTRACK_BATCH + 1; i++)
+		p += sprintf(p, "%s\n", i < XTRACK_BATCH ? "60,5" : "61,6");
+	sci((chp{ execname, "-F", "sql", "xtrack", route, NULL }),
+	    buf,
+	    "INSERT INTO xtrack VALUES (1024, 60.0, 5.0, 0.0, 0.0, 1);\n"
+	    "INSERT INTO xtrack VALUES (1025, 61.0, 6.0, 0.0,"
+	    " 123941.820518, 1);\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "xtrack: More positions than XTRACK_BATCH");
+	free(buf);
+
+cleanup:
+	free(errmsg);
+	if (single) {
+		unlink(single);
+		free(single);
+	}
+	if (seg) {
+		unlink(seg);
+		free(seg);
+	}
+	if (route) {
+		unlink(route);
+		free(route);
+	}
+}
 
 /*
- * test_cmd_lpos() - Tests the `lpos` command. Returns nothing.
+ * test_cmd_fence() - Tests the `fence` command. Returns nothing.
  */
 
-static void test_cmd_lpos(void)
+static void test_cmd_fence(void)
 {
-	diag("Test lpos command");
-	tc((chp{ execname, "lpos", "45,0", "45,180", "0.5", NULL }),
-	   "90.0,0.0\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "lpos: At the North Pole");
-	tc((chp{ execname, "--km", "lpos", "45,0", "45,180", "0.5", NULL }),
-	   "90.0,0.0\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "--km lpos: At the North Pole");
-	tc((chp{ execname, "--format", "gpx", "lpos", "45,0", "45,180",
-	         "0.5", NULL }),
-	             GPX_HEADER
-	             "  <wpt lat=\"90.0\" lon=\"0.0\">\n"
-	             "    <name>lpos</name>\n"
-	             "    <cmt>lpos 45,0 45,180 0.5</cmt>\n"
-	             "  </wpt>\n"
-	             "</gpx>\n",
+	char *fences, *short_fence, *hemisphere, *empty, *many, *buf, *p,
+	     *errmsg = NULL;
+	int i;
+
+	diag("Test fence command");
+
+	fences = create_tmpfile("0,0\n0,3\n3,3\n3,0\n\n# Second fence\n"
+	                        "1,1\n1,5\n5,5\n5,1\n1,1\n");
+	short_fence = create_tmpfile("0,0\n0,1\n\n");
+	hemisphere = create_tmpfile("0,0\n0,120\n0,-120\n");
+	empty = create_tmpfile("# No fences here\n\n");
+	buf = malloc(200 * 40 + 1);
+	if (!fences || !short_fence || !hemisphere || !empty || !buf) {
+		failed_ok("create_tmpfile()"); /* gncov */
+		many = NULL; /* gncov */
+		goto cleanup; /* gncov */
+	}
+	for (i = 0, p = buf; i < 200; i++) {
+		p += sprintf(p, "%d,%d\n%d,%d\n%d,%d\n\n", i % 80, i - 100,
+		             i % 80, i - 99, i % 80 + 1, i - 100);
+	}
+	many = create_tmpfile(buf);
+	if (!many) {
+		failed_ok("create_tmpfile()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+
+	tci((chp{ execname, "fence", fences, NULL }),
+	    "2,2\n0.5,0.5\n4,4\n10,10\n\n",
+	    "1 1\n"
+	    "1 2\n"
+	    "2 1\n"
+	    "3 2\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "fence");
+	tci((chp{ execname, "-F", "sql", "fence", fences, "-", NULL }),
+	    "2,2\n10,10\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS fence (num INTEGER, lat REAL,"
+	    " lon REAL, fence INTEGER);\n"
+	    "INSERT INTO fence VALUES (1, 2.0, 2.0, 1);\n"
+	    "INSERT INTO fence VALUES (1, 2.0, 2.0, 2);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F sql fence");
+	tci((chp{ execname, "fence", fences, NULL }),
+	    "",
+	    "",
+	    "",
+	    EXIT_SUCCESS,
+	    "fence: No positions");
+	tci((chp{ execname, "fence", "-", fences, NULL }),
+	    "-1,-1\n-1,10\n10,10\n10,-1\n",
+	    "1 1\n2 1\n3 1\n4 1\n5 1\n6 1\n7 1\n8 1\n9 1\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "fence: Fences from stdin");
+	tci((chp{ execname, "fence", many, NULL }),
+	    "79.1,-20.9\n0.1,-19.9\n0.1,60.1\n0.9,60.9\n45,45\n",
+	    "1 80\n"
+	    "2 81\n"
+	    "3 161\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "fence: 200 fences");
+	tci((chp{ execname, "fence", "-", NULL }),
+	    "",
+	    "",
+	    EXECSTR ": The fences and the positions cannot both be read"
+	    " from stdin\n",
+	    EXIT_FAILURE,
+	    "fence: Both from stdin");
+	tc((chp{ execname, "fence", "-", "-", NULL }),
+	   "",
+	   EXECSTR ": The fences and the positions cannot both be read"
+	   " from stdin\n",
+	   EXIT_FAILURE,
+	   "fence - -");
+	tci((chp{ execname, "fence", "-", fences, NULL }),
+	    "1,1\n",
+	    "",
+	    EXECSTR ": (stdin): Fence 1 has less than 3 positions\n",
+	    EXIT_FAILURE,
+	    "fence: Fence with only one position");
+	errmsg = allocstr("%s: %s: Fence 1 has less than 3 positions\n",
+	                  EXECSTR, short_fence);
+	if (!errmsg) {
+		failed_ok("allocstr()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	tc((chp{ execname, "fence", short_fence, NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "--format gpx lpos: At the North Pole");
-	tc((chp{ execname, "lpos", "0,0", "-0.0000001,0", "1", NULL }),
-	   "0.0,0.0\n",
+	   errmsg,
+	   EXIT_FAILURE,
+	   "fence: Fence with two positions");
+	free(errmsg);
+	errmsg = allocstr("%s: %s: Fence 1 is larger than a hemisphere\n",
+	                  EXECSTR, hemisphere);
+	if (!errmsg) {
+		failed_ok("allocstr()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	tc((chp{ execname, "fence", hemisphere, NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "lpos: No negative zero in lat");
-	tc((chp{ execname, "lpos", "0,0", "0,-0.0000001", "1", NULL }),
-	   "0.0,0.0\n",
+	   errmsg,
+	   EXIT_FAILURE,
+	   "fence: Fence larger than a hemisphere");
+	free(errmsg);
+	errmsg = allocstr("%s: %s: No fences found\n", EXECSTR, empty);
+	if (!errmsg) {
+		failed_ok("allocstr()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+	tc((chp{ execname, "fence", empty, NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "lpos: No negative zero in lon");
-	tc((chp{ execname, "--km", "lpos", "-24.598059,178.290755",
-	         "-12.500692,163.651473", "9.8", NULL }),
-	   "24.508273,-1.833156\n",
+	   errmsg,
+	   EXIT_FAILURE,
+	   "fence: No fences in file");
+	tci((chp{ execname, "fence", "-", fences, NULL }),
+	    "0,0\n0,1\n1,1\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):4: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "fence: Invalid coordinate in the fences");
+	tci((chp{ execname, "fence", fences, NULL }),
+	    "1,1\n91,0\n",
+	    "1 1\n",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "fence: Invalid coordinate in the positions");
+	tc((chp{ execname, "fence", "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "fence: Fence file doesn't exist");
+	tc((chp{ execname, "fence", fences, "/nonexistent/file", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "lpos: Longitude is normalized");
-	tc((chp{ execname, "lpos", "90,0", "0,0", "0.5", NULL }),
-	   "45.0,0.0\n",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "fence: Position file doesn't exist");
+	tc((chp{ execname, "-F", "gpx", "fence", fences, NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "lpos: Point is moved 1 cm");
-	tc((chp{ execname, "lpos", "-90,0", "90,0", "3", NULL }),
+	   EXECSTR ": GPX output is not supported by the fence command\n",
+	   EXIT_FAILURE,
+	   "-F gpx fence");
+	tc((chp{ execname, "-K", "fence", fences, NULL }),
 	   "",
-	   EXECSTR ": Antipodal points, answer is undefined\n",
+	   EXECSTR ": -K/--karney is not supported by the fence command\n",
 	   EXIT_FAILURE,
-	   "lpos: South Pole to the North Pole");
-	tc((chp{ execname, "lpos", "1,2", "3,4", NULL }),
+	   "-K fence");
+	tc((chp{ execname, "fence", NULL }),
 	   "",
 	   EXECSTR ": Missing arguments\n",
 	   EXIT_FAILURE,
-	   "lpos: Missing 1 argument");
-	tc((chp{ execname, "lpos", "1,2", "3,4", "5", "6", NULL }),
+	   "fence: Missing arguments");
+	tc((chp{ execname, "fence", "a", "b", "c", NULL }),
 	   "",
 	   EXECSTR ": Too many arguments\n",
 	   EXIT_FAILURE,
-	   "lpos: 1 argument too much");
-	tc((chp{ execname, "lpos", "-90.00001,0", "12,34", "1", NULL }),
+	   "fence: Too many arguments");
+
+cleanup:
+	free(errmsg);
+	free(buf);
+	if (many) {
+		unlink(many);
+		free(many);
+	}
+	if (empty) {
+		unlink(empty);
+		free(empty);
+	}
+	if (hemisphere) {
+		unlink(hemisphere);
+		free(hemisphere);
+	}
+	if (short_fence) {
+		unlink(short_fence);
+		free(short_fence);
+	}
+	if (fences) {
+		unlink(fences);
+		free(fences);
+	}
+}
+
+/*
+ * test_cmd_geohash() - Tests the `geohash` command and the --geohash option. 
+ * Returns nothing.
+ */
+
+static void test_cmd_geohash(void)
+{
+	diag("Test geohash command");
+
+	tci((chp{ execname, "geohash", NULL }),
+	    "57.64911,10.40744\n\n# Comment\n42.6,-5.6\n90,180\n",
+	    "u4pruydqqvj8\n"
+	    "ezs42e44yx96\n"
+	    "zzzzzzzzzzzz\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "geohash");
+	tci((chp{ execname, "--geohash", "5", "geohash", "-", NULL }),
+	    "57.64911,10.40744\n42.6,-5.6\n",
+	    "u4pru\n"
+	    "ezs42\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--geohash 5 geohash -");
+	tci((chp{ execname, "--geohash", "7", "-F", "sql", "geohash", NULL }),
+	    "42.6,-5.6\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS geohash (num INTEGER, lat REAL,"
+	    " lon REAL, geohash TEXT);\n"
+	    "INSERT INTO geohash VALUES (1, 42.6, -5.6, 'ezs42e4');\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--geohash 7 -F sql geohash");
+	tci((chp{ execname, "geohash", NULL }),
+	    "42.6,-5.6\n91,0\n",
+	    "ezs42e44yx96\n",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "geohash: Invalid coordinate");
+	tc((chp{ execname, "geohash", "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "geohash: File doesn't exist");
+	tc((chp{ execname, "geohash", "a", "b", NULL }),
 	   "",
-	   EXECSTR ": -90.00001,0: Invalid coordinate\n",
+	   EXECSTR ": Too many arguments\n",
 	   EXIT_FAILURE,
-	   "lpos: lat1 is outside range");
-	tc((chp{ execname, "lpos", "17,6%", "12,34", "-1", NULL }),
+	   "geohash: Too many arguments");
+	tc((chp{ execname, "-F", "gpx", "geohash", NULL }),
 	   "",
-	   EXECSTR ": 17,6%: Invalid coordinate: Invalid argument\n",
+	   EXECSTR ": GPX output is not supported by the geohash command\n",
 	   EXIT_FAILURE,
-	   "lpos: lon1 is invalid number");
-	tc((chp{ execname, "lpos", "17,6", "12%,34", "-1", NULL }),
+	   "-F gpx geohash");
+	tc((chp{ execname, "-K", "geohash", NULL }),
 	   "",
-	   EXECSTR ": 12%,34: Invalid coordinate: Invalid argument\n",
+	   EXECSTR ": -K/--karney is not supported by the geohash command\n",
 	   EXIT_FAILURE,
-	   "lpos: lat in coor1 is invalid number");
-	tc((chp{ execname, "lpos", "1,2", "3,4", "0", NULL }),
-	   "1.0,2.0\n",
+	   "-K geohash");
+
+	tc((chp{ execname, "--geohash", "5", "course", "60,5", "61,6", "1",
+	         NULL }),
+	   "60.0,5.0 u4et3\n"
+	   "60.500935,5.492287 u4gbh\n"
+	   "61.0,6.0 u4u70\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "lpos: fracdist is 0");
-	tc((chp{ execname, "lpos", "11.231,-34.55", "29.97777,47.311001",
-	         "1", NULL }),
-	   "29.97777,47.311001\n",
+	   "--geohash 5 course");
+	tc((chp{ execname, "--geohash", "5", "-F", "sql", "course", "60,5",
+	         "61,6", "1", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS course (num INTEGER, lat REAL,"
+	   " lon REAL, dist REAL, frac REAL, bear REAL, geohash TEXT);\n"
+	   "INSERT INTO course VALUES (0, 60.0, 5.0, 0.0, 0.0, 25.782389,"
+	   " 'u4et3');\n"
+	   "INSERT INTO course VALUES (1, 60.500935, 5.492287, 61970.918595,"
+	   " 0.5, 26.209828, 'u4gbh');\n"
+	   "INSERT INTO course VALUES (2, 61.0, 6.0, 123941.820518, 1.0,"
+	   " NULL, 'u4u70');\n"
+	   "COMMIT;\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "lpos: fracdist is 1");
-	tc((chp{ execname, "--km", "lpos", "11.231,-34.55",
-	         "29.97777,47.311001", "1", NULL }),
-	   "29.97777,47.311001\n",
+	   "--geohash 5 -F sql course");
+	tc((chp{ execname, "--geohash", "7", "--seed", "1", "--count", "2",
+	         "randpos", NULL }),
+	   "-66.453952,-16.38272 5shmgnq\n"
+	   "42.038857,-59.045029 dxqp0ku\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "--km lpos: fracdist is 1");
-	tc((chp{ execname, "lpos", "1,2", "3,4", "INF", NULL }),
+	   "--geohash 7 randpos");
+	tc((chp{ execname, "--geohash", "7", "-F", "sql", "--seed", "1",
+	         "--count", "2", "randpos", "60,5", "1000", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER,"
+	   " lat REAL, lon REAL, dist REAL, bear REAL, geohash TEXT);\n"
+	   "INSERT INTO randpos VALUES (1, 1, 60.005857, 5.003136,"
+	   " 674.160548, 14.986924, 'u4et3ge');\n"
+	   "INSERT INTO randpos VALUES (1, 2, 60.002648, 4.991019,"
+	   " 579.64302, 300.534199, 'u4et3e4');\n"
+	   "COMMIT;\n",
 	   "",
-	   EXECSTR ": INF: Invalid fraction: Numerical result out of range\n",
+	   EXIT_SUCCESS,
+	   "--geohash 7 -F sql randpos with center");
+	tc((chp{ execname, "--geohash", "3", "-F", "sql", "--seed", "1",
+	         "randpos", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER,"
+	   " lat REAL, lon REAL, dist REAL, bear REAL, geohash TEXT);\n"
+	   "INSERT INTO randpos VALUES (1, 1, -66.453952, -16.38272, NULL,"
+	   " NULL, '5sh');\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--geohash 3 -F sql randpos");
+	tc((chp{ execname, "--geohash", "5", "-F", "gpx", "randpos", NULL }),
+	   "",
+	   EXECSTR ": --geohash is not supported with GPX output\n",
 	   EXIT_FAILURE,
-	   "lpos: fracdist is INF");
-	tc((chp{ execname, "lpos", "0,0", "0,180", "0.5", NULL }),
+	   "--geohash 5 -F gpx randpos");
+	tc((chp{ execname, "--geohash", "5", "dist", "1,2", "3,4", NULL }),
 	   "",
-	   EXECSTR ": Antipodal points, answer is undefined\n",
+	   EXECSTR ": --geohash is not supported by the dist command\n",
 	   EXIT_FAILURE,
-	   "lpos: Antipodal positions, 0,0 and 0,180");
-	tc((chp{ execname, "lpos", "90,0", "-90,0", "0.5", NULL }),
+	   "--geohash 5 dist");
+	tc((chp{ execname, "--geohash", "5", "simplify", "10", NULL }),
 	   "",
-	   EXECSTR ": Antipodal points, answer is undefined\n",
+	   EXECSTR ": --geohash is not supported by the simplify command\n",
 	   EXIT_FAILURE,
-	   "lpos: Antipodal positions, 90,0 and -90,0");
-	tc((chp{ execname, "--karney", "lpos", "1,2", "3,4", "0.2", NULL }),
+	   "--geohash 5 simplify");
+	tc((chp{ execname, "--geohash", "0", "geohash", NULL }),
 	   "",
-	   EXECSTR ": -K/--karney is not supported by the lpos command\n",
+	   EXECSTR ": 0: Invalid --geohash argument, must be 1-12\n"
+	   OPTION_ERROR_STR,
 	   EXIT_FAILURE,
-	   "--karney lpos");
-	tc((chp{ execname, "-F", "sql", "lpos", "1,2", "87.188,-130.77", "0.2",
-	         NULL }),
-	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS lpos (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, frac REAL, dlat REAL, dlon REAL, dist REAL, bear REAL);\n"
-	   "INSERT INTO lpos VALUES (1.0, 2.0, 87.188, -130.77, 0.2, 19.169669, 1.31824, 2021740.468082, 357.935874);\n"
-	   "COMMIT;\n",
+	   "--geohash 0");
+	tc((chp{ execname, "--geohash", "13", "geohash", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "-F sql lpos");
+	   EXECSTR ": 13: Invalid --geohash argument, must be 1-12\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--geohash 13");
+	tc((chp{ execname, "--geohash", "5x", "geohash", NULL }),
+	   "",
+	   EXECSTR ": 5x: Invalid --geohash argument, must be 1-12\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--geohash 5x");
 }
 
-                            /*** bear and dist ***/
-
 /*
- * test_multiple() - Tests the `bear` or `dist` command. Returns nothing.
+ * test_cmd_join() - Tests the `join` command and the --nearest option. 
+ * Returns nothing.
  */
 
-static void test_multiple(const int linenum, char *cmd)
+static void test_cmd_join(void)
 {
-	assert(cmd);
-	assert(!strcmp(cmd, "bear") || !strcmp(cmd, "dist"));
-	if (!cmd) {
-		OK_ERROR_L(linenum, "%s(): cmd is NULL", __func__); /* gncov */
-		return; /* gncov */
-	}
+	char *points, *empty, *errmsg = NULL;
+	char input[] = "60.005,10\n59,10.001\n0,0\n-89.9995,170\n"
+	               "0,-179.9999\n";
 
-	diag("Test %s command", !strcmp(cmd, "bear") ? "bear" : "dist");
+	diag("Test join command");
 
-	Tc((chp{ execname, "-vv", cmd, NULL }),
+	points = create_tmpfile("60,10\n60.01,10\n\n59,10\n-89.999,0\n"
+	                        "0,179.9999\n");
+	empty = create_tmpfile("# No positions here\n\n");
+	if (!points || !empty) {
+		failed_ok("create_tmpfile()"); /* gncov */
+		goto cleanup; /* gncov */
+	}
+
+	tci((chp{ execname, "join", points, "1000", NULL }),
+	    input,
+	    "1 1 555.974633\n"
+	    "1 2 555.974633\n"
+	    "2 3 57.269621\n"
+	    "4 4 166.228336\n"
+	    "5 5 22.238985\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "join");
+	tci((chp{ execname, "-K", "--km", "join", points, "0.6", "-",
+	          NULL }),
+	    input,
+	    "1 1 0.55706165\n"
+	    "1 2 0.55706207\n"
+	    "2 3 0.0574753\n"
+	    "4 4 0.16697438\n"
+	    "5 5 0.0222639\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-K --km join");
+	tci((chp{ execname, "--approx", "haversine32", "join", points, "1000",
+	          NULL }),
+	    input,
+	    "1 1 555.97462\n"
+	    "1 2 555.97462\n"
+	    "2 3 57.26962\n"
+	    "4 4 166.228336\n"
+	    "5 5 22.238985\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--approx haversine32 join");
+	tci((chp{ execname, "--approx", "equirect", "join", points, "556",
+	          NULL }),
+	    input,
+	    "1 1 555.974633\n"
+	    "1 2 555.974633\n"
+	    "2 3 57.269621\n"
+	    "4 4 166.228336\n"
+	    "5 5 22.238985\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--approx equirect join, exact distance near the threshold");
+	tci((chp{ execname, "--approx", "cheapruler", "--km", "join", points,
+	          "100", NULL }),
+	    input,
+	    "1 1 0.557062\n"
+	    "1 2 0.557062\n"
+	    "2 3 0.057475\n"
+	    "4 4 0.166974\n"
+	    "5 5 0.022264\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--approx cheapruler join beyond APPROX_MAX_DIST uses Karney");
+	tci((chp{ execname, "-K", "--nearest", "join", points, "1000",
+	          NULL }),
+	    input,
+	    "1 1 557.06164972\n"
+	    "2 3 57.47529945\n"
+	    "4 4 166.9743838\n"
+	    "5 5 22.26389732\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-K --nearest join");
+	tci((chp{ execname, "--km", "-F", "sql", "join", points, "0.06",
+	          NULL }),
+	    input,
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS pairs (num INTEGER, lat REAL,"
+	    " lon REAL, ref INTEGER, ref_lat REAL, ref_lon REAL,"
+	    " dist REAL);\n"
+	    "INSERT INTO pairs VALUES (2, 59.0, 10.001, 3, 59.0, 10.0,"
+	    " 57.269621);\n"
+	    "INSERT INTO pairs VALUES (5, 0.0, -179.9999, 5, 0.0, 179.9999,"
+	    " 22.238985);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km -F sql join");
+	tci((chp{ execname, "-F", "gpx", "--nearest", "join", points, "100",
+	          NULL }),
+	    input,
+	    GPX_HEADER
+	    "  <trk>\n"
+	    "    <trkseg>\n"
+	    "      <trkpt lat=\"59.0\" lon=\"10.001\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"59.0\" lon=\"10.0\">\n"
+	    "      </trkpt>\n"
+	    "    </trkseg>\n"
+	    "    <trkseg>\n"
+	    "      <trkpt lat=\"0.0\" lon=\"-179.9999\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"0.0\" lon=\"179.9999\">\n"
+	    "      </trkpt>\n"
+	    "    </trkseg>\n"
+	    "  </trk>\n"
+	    "</gpx>\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F gpx --nearest join");
+	tci((chp{ execname, "join", points, "0", NULL }),
+	    "60,10\n\n60.0001,10\n",
+	    "1 1 0.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "join: Distance 0");
+	tci((chp{ execname, "join", points, "1000", NULL }),
+	    "59.009,10\n59.008,10\n",
+	    "2 3 889.559413\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "join: Position just outside the distance");
+	tci((chp{ execname, "join", "-", "10", points, NULL }),
+	    "60.01,10.0001\n",
+	    "2 1 5.558066\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "join: Points from stdin");
+	tc((chp{ execname, "join", points, "abc", NULL }),
+	   "",
+	   EXECSTR ": abc: Invalid distance: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "join: Invalid distance");
+	tc((chp{ execname, "join", points, "inf", NULL }),
 	   "",
-	   EXECSTR ": Missing arguments\n",
+	   EXECSTR ": inf: Invalid distance: Numerical result out of range\n",
 	   EXIT_FAILURE,
-	   "%s with no arguments", cmd);
-	Tc((chp{ execname, cmd, "1,2", "3", NULL }),
+	   "join: Infinite distance");
+	tc((chp{ execname, "join", points, "-1", NULL }),
 	   "",
-	   EXECSTR ": 3: Invalid coordinate\n",
+	   EXECSTR ": -1: Distance cannot be negative\n",
 	   EXIT_FAILURE,
-	   "%s: Argument 2 is not a coordinate", cmd);
-	Tc((chp{ execname, cmd, "1,2", "3,4", NULL }),
-	   !strcmp(cmd, "bear") ? "44.951998\n" : "314402.951024\n",
+	   "join: Negative distance");
+	tc((chp{ execname, "join", "-", "1", "-", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "%s 1,2 3,4", cmd);
-	if (!strcmp(cmd, "bear")) {
-		Tc((chp{ execname, "bear", "12,34", "-12,-146", NULL }),
-		   "",
-		   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
-		   EXIT_FAILURE,
-		   "bear 12,34 -12,-146 - antipodal points");
-		Tc((chp{ execname, "bear", "12,34", "12,34", NULL }),
-		   "",
-		   EXECSTR ": Antipodal or coincident points, answer is undefined\n",
-		   EXIT_FAILURE,
-		   "bear 12,34 -12,34 - coincident points");
-	} else {
-		Tc((chp{ execname, "dist", "12,34", "-12,-146", NULL }),
-		   "20015086.796021\n",
-		   "",
-		   EXIT_SUCCESS,
-		   "dist 12,34 -12,-146 - antipodal points");
-		Tc((chp{ execname, "dist", "12,34", "12,34", NULL }),
-		   "0.0\n",
-		   "",
-		   EXIT_SUCCESS,
-		   "dist 12,34 12,34 - coincident points");
+	   EXECSTR ": The points and the positions cannot both be read"
+	   " from stdin\n",
+	   EXIT_FAILURE,
+	   "join - 1 -");
+	errmsg = allocstr("%s: %s: No positions found\n", EXECSTR, empty);
+	if (!errmsg) {
+		failed_ok("allocstr()"); /* gncov */
+		goto cleanup; /* gncov */
 	}
-	Tc((chp{ execname, cmd, "1,2", "3,4", "5", NULL }),
+	tc((chp{ execname, "join", empty, "1", NULL }),
 	   "",
-	   EXECSTR ": Too many arguments\n",
+	   errmsg,
 	   EXIT_FAILURE,
-	   "%s with 1 argument too much", cmd);
-	Tc((chp{ execname, cmd, "1,2", "3,1e+900", NULL }),
+	   "join: No positions in the points file");
+	tci((chp{ execname, "join", "-", "1", points, NULL }),
+	    "0,0\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "join: Invalid coordinate in the points");
+	tci((chp{ execname, "join", points, "1", NULL }),
+	    "60,10\n91,0\n",
+	    "1 1 0.0\n",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "join: Invalid coordinate in the positions");
+	tc((chp{ execname, "join", points, "1", "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "join: Position file doesn't exist");
+	tc((chp{ execname, "join", "/nonexistent/file", "1", NULL }),
 	   "",
-	   EXECSTR ": 3,1e+900: Invalid coordinate: Numerical result out of range\n",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
 	   EXIT_FAILURE,
-	   "%s with 1 number too large", cmd);
-	Tc((chp{ execname, cmd, "1,2", "urgh,4", NULL }),
+	   "join: Points file doesn't exist");
+	tc((chp{ execname, "--geohash", "5", "join", points, "1", NULL }),
 	   "",
-	   EXECSTR ": urgh,4: Invalid coordinate: Invalid argument\n",
+	   EXECSTR ": --geohash is not supported by the join command\n",
+	   EXIT_FAILURE,
+	   "--geohash 5 join");
+	tc((chp{ execname, "--nearest", "dist", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": --nearest is not supported by the dist command\n",
+	   EXIT_FAILURE,
+	   "--nearest dist");
+	tc((chp{ execname, "join", "a", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "join: Missing arguments");
+	tc((chp{ execname, "join", "a", "b", "c", "d", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "join: Too many arguments");
+
+cleanup:
+	free(errmsg);
+	if (empty) {
+		unlink(empty);
+		free(empty);
+	}
+	if (points) {
+		unlink(points);
+		free(points);
+	}
+}
+
+/*
+ * test_cmd_cluster() - Tests the `cluster` command. Returns nothing.
+ */
+
+static void test_cmd_cluster(void)
+{
+	char input[] = "60,10\n60.0001,10\n60.0002,10\n\n61,10\n"
+	               "0,179.99999\n0,-179.99999\n0,179.99998\n";
+
+	diag("Test cluster command");
+
+	tci((chp{ execname, "cluster", "20", "3", NULL }),
+	    input,
+	    "point 1 1\n"
+	    "point 2 1\n"
+	    "point 3 1\n"
+	    "point 4 0\n"
+	    "point 5 2\n"
+	    "point 6 2\n"
+	    "point 7 2\n"
+	    "cluster 1 60.0001,10.0 3\n"
+	    "cluster 2 0.0,179.999993 3\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "cluster");
+	tci((chp{ execname, "--km", "-F", "sql", "cluster", "0.02", "3", "-",
+	          NULL }),
+	    input,
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS cluster (num INTEGER, lat REAL,"
+	    " lon REAL, cluster INTEGER);\n"
+	    "CREATE TABLE IF NOT EXISTS cluster_centroid (cluster INTEGER,"
+	    " lat REAL, lon REAL, count INTEGER);\n"
+	    "INSERT INTO cluster VALUES (1, 60.0, 10.0, 1);\n"
+	    "INSERT INTO cluster VALUES (2, 60.0001, 10.0, 1);\n"
+	    "INSERT INTO cluster VALUES (3, 60.0002, 10.0, 1);\n"
+	    "INSERT INTO cluster VALUES (4, 61.0, 10.0, 0);\n"
+	    "INSERT INTO cluster VALUES (5, 0.0, 179.99999, 2);\n"
+	    "INSERT INTO cluster VALUES (6, 0.0, -179.99999, 2);\n"
+	    "INSERT INTO cluster VALUES (7, 0.0, 179.99998, 2);\n"
+	    "INSERT INTO cluster_centroid VALUES (1, 60.0001, 10.0, 3);\n"
+	    "INSERT INTO cluster_centroid VALUES (2, 0.0, 179.999993, 3);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km -F sql cluster");
+	tci((chp{ execname, "-F", "gpx", "cluster", "20", "2", NULL }),
+	    input,
+	    GPX_HEADER
+	    "  <wpt lat=\"60.0001\" lon=\"10.0\">\n"
+	    "    <name>Cluster 1</name>\n"
+	    "    <cmt>3 positions</cmt>\n"
+	    "  </wpt>\n"
+	    "  <wpt lat=\"0.0\" lon=\"179.999993\">\n"
+	    "    <name>Cluster 2</name>\n"
+	    "    <cmt>3 positions</cmt>\n"
+	    "  </wpt>\n"
+	    "</gpx>\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F gpx cluster");
+	tci((chp{ execname, "cluster", "0", "1", NULL }),
+	    "1,2\n1,2\n1,2.000001\n",
+	    "point 1 1\n"
+	    "point 2 1\n"
+	    "point 3 2\n"
+	    "cluster 1 1.0,2.0 2\n"
+	    "cluster 2 1.0,2.000001 1\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "cluster: eps 0 only joins identical positions");
+	tci((chp{ execname, "cluster", "1", "1", NULL }),
+	    "",
+	    "",
+	    "",
+	    EXIT_SUCCESS,
+	    "cluster: No positions");
+	tc((chp{ execname, "cluster", "abc", "1", NULL }),
+	   "",
+	   EXECSTR ": abc: Invalid distance: Invalid argument\n",
 	   EXIT_FAILURE,
-	   "%s with 1 non-number", cmd);
-	Tc((chp{ execname, cmd, "1,2.9y", "3,4", NULL }),
+	   "cluster: Invalid eps");
+	tc((chp{ execname, "cluster", "inf", "1", NULL }),
 	   "",
-	   EXECSTR ": 1,2.9y: Invalid coordinate: Invalid argument\n",
+	   EXECSTR ": inf: Invalid distance: Numerical result out of range\n",
 	   EXIT_FAILURE,
-	   "%s with non-digit after number", cmd);
-	Tc((chp{ execname, cmd, "1,2 g", "3,4", NULL }),
+	   "cluster: Infinite eps");
+	tc((chp{ execname, "cluster", "-1", "1", NULL }),
 	   "",
-	   EXECSTR ": 1,2 g: Invalid coordinate: Invalid argument\n",
+	   EXECSTR ": -1: Distance cannot be negative\n",
 	   EXIT_FAILURE,
-	   "%s with whitespace and non-digit after number", cmd);
-	Tc((chp{ execname, cmd, "10,2,", "3,4", NULL }),
-	   !strcmp(cmd, "bear") ? "164.027619\n" : "809080.682265\n",
-	   "",
-	   EXIT_SUCCESS,
-	   "%s with comma after number", cmd);
-	Tc((chp{ execname, cmd, "1,2", "3,NAN", NULL }),
+	   "cluster: Negative eps");
+	tc((chp{ execname, "cluster", "1", "abc", NULL }),
 	   "",
-	   EXECSTR ": 3,NAN: Invalid coordinate: Invalid argument\n",
+	   EXECSTR ": abc: Invalid number of positions: Invalid argument\n",
 	   EXIT_FAILURE,
-	   "%s with NAN", cmd);
-	Tc((chp{ execname, cmd, "1,2", "3,INF", NULL }),
+	   "cluster: Invalid minpts");
+	tc((chp{ execname, "cluster", "1", "0", NULL }),
 	   "",
-	   EXECSTR ": 3,INF: Invalid coordinate: Numerical result out of range\n",
+	   EXECSTR ": 0: Invalid number of positions\n",
 	   EXIT_FAILURE,
-	   "%s with INF", cmd);
-	Tc((chp{ execname, cmd, "1,2", "", NULL }),
+	   "cluster: minpts is 0");
+	tc((chp{ execname, "cluster", "1", "2.5", NULL }),
 	   "",
-	   EXECSTR ": : Invalid coordinate\n",
+	   EXECSTR ": 2.5: Invalid number of positions\n",
 	   EXIT_FAILURE,
-	   "%s with empty argument", cmd);
-	Tc((chp{ execname, cmd, "1,180.001", "3,4", NULL }),
+	   "cluster: minpts is not an integer");
+	tc((chp{ execname, "cluster", "1", "1e10", NULL }),
 	   "",
-	   EXECSTR ": 1,180.001: Invalid coordinate\n",
+	   EXECSTR ": 1e10: Invalid number of positions\n",
 	   EXIT_FAILURE,
-	   "%s: lon1 out of range", cmd);
-	if (!strcmp(cmd, "bear")) {
-		Tc((chp{ execname, "bear", "90,0", "-90,0", NULL }),
-		   "",
-		   EXECSTR ": Antipodal or coincident points, answer is"
-		   " undefined\n",
-		   EXIT_FAILURE,
-		   "bear 90,0 -90,0");
-		Tc((chp{ execname, "--km", cmd, "90,0", "-90,0", NULL }),
-		   "",
-		   EXECSTR ": Antipodal or coincident points, answer is"
-		   " undefined\n",
-		   EXIT_FAILURE,
-		   "--km bear 90,0 -90,0");
-	} else {
-		Tc((chp{ execname, "dist", "90,0", "-90,0", NULL }),
-		   "20015086.796021\n",
-		   "",
-		   EXIT_SUCCESS,
-		   "dist 90,0 -90,0");
-		Tc((chp{ execname, "--km", cmd, "90,0", "-90,0", NULL }),
-		   "20015.086796\n",
-		   "",
-		   EXIT_SUCCESS,
-		   "--km dist 90,0 -90,0");
-	}
-	Tc((chp{ execname, "-F", "default", cmd, "34,56", "-78,9", NULL }),
-	   !strcmp(cmd, "bear") ? "189.693136\n" : "12835310.777042\n",
+	   "cluster: minpts is too large");
+	tci((chp{ execname, "cluster", "1", "1", NULL }),
+	    "1,2\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "cluster: Invalid coordinate");
+	tc((chp{ execname, "-K", "cluster", "1", "1", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the cluster command\n",
+	   EXIT_FAILURE,
+	   "-K cluster");
+	tc((chp{ execname, "cluster", "1", NULL }),
 	   "",
-	   EXIT_SUCCESS,
-	   "-F default %s", cmd);
-	Tc((chp{ execname, "--format", "gpx", cmd, "34,56", "-78,9", NULL }),
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "cluster: Missing arguments");
+	tc((chp{ execname, "cluster", "1", "2", "3", "4", NULL }),
 	   "",
-	   !strcmp(cmd, "bear")
-	       ? EXECSTR ": GPX output is not supported by the bear command\n"
-	       : EXECSTR ": GPX output is not supported by the dist command\n",
+	   EXECSTR ": Too many arguments\n",
 	   EXIT_FAILURE,
-	   "--format gpx %s", cmd);
-
-	diag("--format sql %s", cmd);
-	if (!strcmp(cmd, "bear")) {
-		Tc((chp{ execname, "--format", "sql", cmd, "34,56", "-78,9",
-		         NULL }),
-		   "BEGIN;\n"
-		   "CREATE TABLE IF NOT EXISTS bear (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, bear REAL, dist REAL);\n"
-		   "INSERT INTO bear VALUES (34.0, 56.0, -78.0, 9.0, 189.693136, 12835310.777042);\n"
-		   "COMMIT;\n",
-		   "",
-		   EXIT_SUCCESS,
-		   "--format sql %s", cmd);
-	} else {
-		Tc((chp{ execname, "--format", "sql", cmd, "34,56", "-78,9",
-		         NULL }),
-		   "BEGIN;\n"
-		   "CREATE TABLE IF NOT EXISTS dist (lat1 REAL, lon1 REAL, lat2 REAL, lon2 REAL, dist REAL, bear REAL);\n"
-		   "INSERT INTO dist VALUES (34.0, 56.0, -78.0, 9.0, 12835310.77704204, 189.69313615);\n"
-		   "COMMIT;\n",
-		   "",
-		   EXIT_SUCCESS,
-		   "--format sql %s", cmd);
-	}
+	   "cluster: Too many arguments");
 }
 
-                               /*** randpos ***/
-
 /*
- * verify_coor_dist() - Verifies that the distance between `coor` and all 
- * "\n"-separated coordinates in `str` are in the range `mindist`-`maxdist` 
- * meters. Returns nothing.
+ * test_cmd_centroid() - Tests the `centroid` command and the --weighted 
+ * option. Returns nothing.
  */
 
-static void verify_coor_dist(const int linenum, const char *str,
-                             const char *coor, const double mindist,
-                             const double maxdist)
+static void test_cmd_centroid(void)
 {
-	int errcount = 0;
-	char *s, *p;
-	double clat, clon,
-	       mindist_r = round(mindist), maxdist_r = round(maxdist);
-	unsigned long coorcount = 0;
-
-	assert(str);
-	assert(coor);
-	if (!str || !coor) {
-		OK_ERROR_L(linenum, /* gncov */
-		           "%s(): `str` or `coor` is NULL", __func__);
-		return; /* gncov */
-	}
-	if (!strchr(str, '\n')) {
-		OK_ERROR_L(linenum, /* gncov */
-		           "%s(): No '\\n' found in `str`", __func__);
-		return; /* gncov */
-	}
-	if (parse_coordinate(coor, true, &clat, &clon)) {
-		failed_ok("parse_coordinate()"); /* gncov */
-		diag("%s(): coor = \"%s\"", __func__, coor); /* gncov */
-		return; /* gncov */
-	}
-
-	s = mystrdup(str);
-	if (!s) {
-		failed_ok("mystrdup()"); /* gncov */
-		return; /* gncov */
-	}
-	p = strtok(s, "\n");
-	while (p) {
-		double lat, lon, dist;
-		coorcount++;
-		if (parse_coordinate(p, true, &lat, &lon)) {
-			failed_ok("parse_coordinate()"); /* gncov */
-			diag("%s(): p = \"%s\"", __func__, p); /* gncov */
-			errcount++; /* gncov */
-			goto next; /* gncov */
-		}
-		dist = haversine(clat, clon, lat, lon);
-		if (dist == -1.0) {
-			OK_ERROR_L(linenum, /* gncov */
-			           "%s(): haversine() failed, values out of"
-			           " range", __func__);
-			diag("%s(): coor = \"%s\", lat = %f," /* gncov */
-			     " lon = %f", __func__, coor, lat, lon);
-			errcount++; /* gncov */
-			goto next; /* gncov */
-		}
-		dist = round(dist);
-		if (dist < mindist_r || dist > maxdist_r) {
-			errcount < 11
-			? OK_ERROR_L(linenum, /* gncov */
-			             "Coordinate out of range (%f"
-			             " to %f m). center: %f,%f, coor = %f,%f,"
-			             " dist = %f",
-			             mindist, maxdist,
-			             clat, clon, lat, lon, dist)
-			: 1; /* gncov */
-			errcount++; /* gncov */
-		}
-next:
-		if (errcount >= 10) {
-			OK_ERROR_L(linenum, /* gncov */
-			           "Aborting this test after 10 errors");
-			break; /* gncov */
-		}
-		p = strtok(NULL, "\n");
-	}
-	OK_EQUAL_L(errcount, 0, linenum,
-	          "randpos: All %lu coordinates were inside range of"
-	          " %.0f to %.0f meters", coorcount, mindist, maxdist);
-	free(s);
+	char input[] = "60,10\n60.001,10\n\n60,10.002\n";
+	double bin[] = { 60.0, 10.0, 1.0, 60.001, 10.0, 3.0, NAN, NAN, 0.0 },
+	       badbin[] = { 60.0, 10.0, -1.0 };
+
+	diag("Test centroid command");
+
+	tci((chp{ execname, "centroid", NULL }),
+	    input,
+	    "centroid 60.000333,10.000667\n"
+	    "points 3\n"
+	    "weight 3.0\n"
+	    "resultant 1.0\n"
+	    "dispersion 74.129671\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "centroid");
+	tci((chp{ execname, "--km", "centroid", "-", NULL }),
+	    input,
+	    "centroid 60.000333,10.000667\n"
+	    "points 3\n"
+	    "weight 3.0\n"
+	    "resultant 1.0\n"
+	    "dispersion 0.07413\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km centroid");
+	tci((chp{ execname, "-F", "sql", "--weighted", "centroid", NULL }),
+	    "60,10,1\n60.001,10,3\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS centroid (lat REAL, lon REAL,"
+	    " points INTEGER, weight REAL, resultant REAL,"
+	    " dispersion REAL);\n"
+	    "INSERT INTO centroid VALUES (60.00075, 10.0, 2, 4.0, 1.0,"
+	    " 48.148816);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F sql --weighted centroid");
+	tci((chp{ execname, "centroid", NULL }),
+	    "60 0 0 10 0 0\n60°0.06' 10°\n\n60°N 10°0.12'E,,\n",
+	    "centroid 60.000333,10.000667\n"
+	    "points 3\n"
+	    "weight 3.0\n"
+	    "resultant 1.0\n"
+	    "dispersion 74.129671\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "centroid with degrees, minutes and seconds");
+	tci((chp{ execname, "--weighted", "centroid", NULL }),
+	    "60N 10E, 1\n60.001N 10E 3\n",
+	    "centroid 60.00075,10.0\n"
+	    "points 2\n"
+	    "weight 4.0\n"
+	    "resultant 1.0\n"
+	    "dispersion 48.148816\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--weighted centroid with hemisphere letters");
+	tci((chp{ execname, "-F", "gpx", "centroid", NULL }),
+	    input,
+	    GPX_HEADER
+	    "  <wpt lat=\"60.000333\" lon=\"10.000667\">\n"
+	    "    <name>Centroid</name>\n"
+	    "    <cmt>3 positions</cmt>\n"
+	    "  </wpt>\n"
+	    "</gpx>\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F gpx centroid");
+	tci_func(__LINE__, 1, (chp{ execname, "--input-format", "binary",
+	                            "--weighted", "centroid", NULL }),
+	         (char *)bin, sizeof(bin),
+	         "centroid 60.00075,10.0\n"
+	         "points 2\n"
+	         "weight 4.0\n"
+	         "resultant 1.0\n"
+	         "dispersion 48.148816\n",
+	         "",
+	         EXIT_SUCCESS,
+	         "--input-format binary --weighted centroid");
+	tci_func(__LINE__, 1, (chp{ execname, "--input-format", "binary",
+	                            "--weighted", "centroid", NULL }),
+	         (char *)badbin, sizeof(badbin),
+	         "",
+	         EXECSTR ": (stdin): Invalid weight in record 1\n",
+	         EXIT_FAILURE,
+	         "--input-format binary --weighted centroid: Negative"
+	         " weight");
+	tci((chp{ execname, "--weighted", "centroid", NULL }),
+	    "60,10,1\n60,10\n",
+	    "",
+	    EXECSTR ": (stdin):2: Missing weight: 60,10\n",
+	    EXIT_FAILURE,
+	    "--weighted centroid: Missing weight");
+	tci((chp{ execname, "--weighted", "centroid", NULL }),
+	    "60,10,-1\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid weight: -1\n",
+	    EXIT_FAILURE,
+	    "--weighted centroid: Negative weight");
+	tci((chp{ execname, "--weighted", "centroid", NULL }),
+	    "60,10,inf\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid weight: inf\n",
+	    EXIT_FAILURE,
+	    "--weighted centroid: Infinite weight");
+	tci((chp{ execname, "--weighted", "centroid", NULL }),
+	    "60,10,2\n60,11,abc\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid weight: abc\n",
+	    EXIT_FAILURE,
+	    "--weighted centroid: Weight is not a number");
+	tci((chp{ execname, "--weighted", "centroid", NULL }),
+	    "91,10,1\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: 91,10,1\n",
+	    EXIT_FAILURE,
+	    "--weighted centroid: Invalid latitude with a valid weight");
+	tci((chp{ execname, "centroid", NULL }),
+	    "60,10,1\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: 60,10,1\n",
+	    EXIT_FAILURE,
+	    "centroid: Weight without --weighted");
+	tci((chp{ execname, "--weighted", "centroid", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"/></gpx>\n",
+	    "",
+	    EXECSTR ": (stdin): --weighted is not supported with GPX"
+	    " input\n",
+	    EXIT_FAILURE,
+	    "--weighted centroid: GPX input");
+	tci((chp{ execname, "centroid", NULL }),
+	    "# Only a comment\n",
+	    "",
+	    EXECSTR ": (stdin): No positions found\n",
+	    EXIT_FAILURE,
+	    "centroid: No positions");
+	tci((chp{ execname, "centroid", NULL }),
+	    "0,0\n0,180\n",
+	    "",
+	    EXECSTR ": (stdin): The centroid is undefined\n",
+	    EXIT_FAILURE,
+	    "centroid: Antipodal positions");
+	tc((chp{ execname, "centroid", "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "centroid: File doesn't exist");
+	tc((chp{ execname, "--weighted", "dist", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": --weighted is not supported by the dist command\n",
+	   EXIT_FAILURE,
+	   "--weighted dist");
+	tc((chp{ execname, "-K", "centroid", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the centroid command\n",
+	   EXIT_FAILURE,
+	   "-K centroid");
+	tc((chp{ execname, "centroid", "a", "b", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "centroid: Too many arguments");
 }
 
 /*
- * chk_coor_outp() - Verifies the output from the randpos command. Returns 1 if 
- * any error, 0 if everything is ok.
+ * test_cmd_intersect() - Tests the `intersect` command. Returns nothing.
  */
 
-static int chk_coor_outp(const int linenum, const OutputFormat format,
-                         const char *output, const unsigned int num,
-                         const char *coor, const double mindist,
-                         const double maxdist)
+static void test_cmd_intersect(void)
 {
-	int errcount = 0;
-	regex_t regex;
-	char *regstr, *pattern;
-	static int count = 0;
-
-	assert(output);
-
-	count++;
-	if (format == OF_DEFAULT && coor)
-		verify_coor_dist(linenum, output, coor, mindist, maxdist);
+	char input[] = "0,1\n1,-1\n2,1\n\n3,1\n3,-1\n4,-1\n", *buf, *p;
+	int i;
 
-	switch (format) {
-	case OF_DEFAULT:
-		regstr = "^(-?[0-9]+\\.[0-9]+"
-		         ","
-		         "-?[0-9]+\\.[0-9]+\n){%u}$";
-		break;
-	case OF_GPX:
-		regstr = "^<\\?xml version=\"1\\.0\" encoding=\"UTF-8\"\\?>\n"
-		         "<gpx"
-		         " xmlns=\"http://www\\.topografix\\.com/GPX/1/1\""
-		         " version=\"1\\.1\""
-		         " creator=\"" PROJ_NAME " - " PROJ_URL "\""
-		         ">\n"
-		         "("
-		         "  <wpt"
-		         " lat=\"-?[0-9]+\\.[0-9]+\""
-		         " lon=\"-?[0-9]+\\.[0-9]+\""
-		         ">\n"
-		         "    <name>Random [0-9]+</name>\n"
-		         "  </wpt>\n"
-		         "){%u}"
-		         "</gpx>\n$";
-		break;
-	default: /* gncov */
-		regstr = "NON-EXISTENT VALUE"; /* gncov */
-		break; /* gncov */
-	}
+	diag("Test intersect command");
 
-	pattern = allocstr(regstr, num);
-	if (!pattern) {
-		failed_ok("allocstr()"); /* gncov */
-		return 1; /* gncov */
-	}
+	tc((chp{ execname, "intersect", "0,0", "10,10", "0,10", "10,0",
+	         NULL }),
+	   "intersection 5.057515,5.0\n"
+	   "dist1 790293.719789\n"
+	   "dist2 790293.719789\n"
+	   "crossing 1\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "intersect");
+	tc((chp{ execname, "--km", "intersect", "0,0", "10,10", "0,10",
+	         "10,0", NULL }),
+	   "intersection 5.057515,5.0\n"
+	   "dist1 790.29372\n"
+	   "dist2 790.29372\n"
+	   "crossing 1\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--km intersect");
+	tc((chp{ execname, "-F", "sql", "intersect", "0,0", "10,10", "20,10",
+	         "30,0", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS intersection (lat REAL, lon REAL,"
+	   " dist1 REAL, dist2 REAL, crossing INTEGER);\n"
+	   "INSERT INTO intersection VALUES (14.490588, 14.744909,"
+	   " 2286168.286348, -793058.887145, 0);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql intersect, the segments don't cross");
+	tc((chp{ execname, "-F", "gpx", "intersect", "0,0", "10,10", "0,10",
+	         "10,0", NULL }),
+	   GPX_HEADER
+	   "  <wpt lat=\"5.057515\" lon=\"5.0\">\n"
+	   "    <name>Intersection</name>\n"
+	   "    <cmt>The segments cross</cmt>\n"
+	   "  </wpt>\n"
+	   "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F gpx intersect");
+	tc((chp{ execname, "intersect", "1,2", "1,2", "5,6", "7,8", NULL }),
+	   "",
+	   EXECSTR ": The intersection is undefined\n",
+	   EXIT_FAILURE,
+	   "intersect: Identical positions");
+	tc((chp{ execname, "intersect", "0,0", "0,10", "0,20", "0,30", NULL }),
+	   "",
+	   EXECSTR ": The intersection is undefined\n",
+	   EXIT_FAILURE,
+	   "intersect: Identical great circles");
+	tc((chp{ execname, "intersect", "a", "3,4", "5,6", "7,8", NULL }),
+	   "",
+	   EXECSTR ": a: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "intersect: Invalid first coordinate");
+	tc((chp{ execname, "intersect", "1,2", "3,4", "5,6", "b", NULL }),
+	   "",
+	   EXECSTR ": b: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "intersect: Invalid fourth coordinate");
+
+	tci((chp{ execname, "intersect", "0,0", "10,0", NULL }),
+	    input,
+	    "1 0.500114,0.0 55610.166901\n"
+	    "2 1.500343,0.0 166830.492962\n"
+	    "4 3.000456,0.0 333635.501407\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "intersect with track");
+	tci((chp{ execname, "--km", "intersect", "0,0", "10,0", "-", NULL }),
+	    input,
+	    "1 0.500114,0.0 55.610167\n"
+	    "2 1.500343,0.0 166.830493\n"
+	    "4 3.000456,0.0 333.635501\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km intersect with track from stdin");
+	tci((chp{ execname, "-F", "sql", "intersect", "0,0", "10,0", NULL }),
+	    input,
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS crossing (num INTEGER, lat REAL,"
+	    " lon REAL, dist REAL);\n"
+	    "INSERT INTO crossing VALUES (1, 0.500114, 0.0,"
+	    " 55610.166901);\n"
+	    "INSERT INTO crossing VALUES (2, 1.500343, 0.0,"
+	    " 166830.492962);\n"
+	    "INSERT INTO crossing VALUES (4, 3.000456, 0.0,"
+	    " 333635.501407);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F sql intersect with track");
+	tci((chp{ execname, "-F", "gpx", "intersect", "10,0", "0,0", NULL }),
+	    "0,1\n1,-1\n",
+	    GPX_HEADER
+	    "  <wpt lat=\"0.500114\" lon=\"0.0\">\n"
+	    "    <name>Crossing 1</name>\n"
+	    "  </wpt>\n"
+	    "</gpx>\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F gpx intersect with track");
+	tci((chp{ execname, "intersect", "1,2", "1,2", NULL }),
+	    input,
+	    "",
+	    EXECSTR ": The intersection is undefined\n",
+	    EXIT_FAILURE,
+	    "intersect with track: Identical positions");
+	tci((chp{ execname, "intersect", "1,2", "a", NULL }),
+	    input,
+	    "",
+	    EXECSTR ": a: Invalid coordinate: Invalid argument\n",
+	    EXIT_FAILURE,
+	    "intersect with track: Invalid coordinate");
+	tci((chp{ execname, "intersect", "0,0", "10,0", NULL }),
+	    "0,1\n1,1,1\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 1,1,1\n",
+	    EXIT_FAILURE,
+	    "intersect with track: Invalid input");
+	tc((chp{ execname, "intersect", "1,2", "3,4", "/nonexistent/file",
+	         NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "intersect: File doesn't exist");
+	tc((chp{ execname, "-K", "intersect", "1,2", "3,4", "5,6", "7,8",
+	         NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the intersect"
+	   " command\n",
+	   EXIT_FAILURE,
+	   "-K intersect");
+	tc((chp{ execname, "intersect", "1,2", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "intersect: Missing arguments");
+	tc((chp{ execname, "intersect", "1,2", "3,4", "5,6", "7,8", "9",
+	         NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "intersect: Too many arguments");
 
-	if (regcomp(&regex, pattern, REG_EXTENDED)) {
-		failed_ok("regcomp()"); /* gncov */
-		errcount++; /* gncov */
-		goto cleanup; /* gncov */
+	/* A crossing between two batches */
+	buf = malloc((INTERSECT_BATCH + 1) * 5 + 1);
+	if (!buf) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
 	}
-
-	OK_SUCCESS_L(regexec(&regex, output, 0, NULL, 0), linenum,
-	             "Regexp matches, count = %d", count);
-	regfree(&regex);
-
-cleanup:
-	free(pattern);
-
-	return !!errcount;
+	for (i = 0, p = buf; i < INTERSECT_BATCH + 1; i++)
+		p += sprintf(p, "%s\n", i < INTERSECT_BATCH ? "5,1" : "5,-1");
+	tci((chp{ execname, "intersect", "0,0", "10,0", NULL }),
+	    buf,
+	    "1024 5.000758,0.0 556058.894338\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "intersect: Crossing between two batches");
+	free(buf);
 }
 
 /*
- * te_randpos() - Executes `cmd` and verifies that all coordinates are valid 
- * and inside the various ranges specified. Returns nothing.
+ * test_cmd_cpa() - Tests the `cpa` command. Returns nothing.
  */
 
-static void te_randpos(const int linenum, const OutputFormat format,
-                       char **cmd, const unsigned int num, const char *coor,
-                       const double mindist, const double maxdist,
-                       const char *desc)
+static void test_cmd_cpa(void)
 {
-	struct streams ss;
-	struct Options o = opt_struct();
-
-	assert(cmd);
-	assert(*cmd);
-	assert(desc);
-	assert(*desc);
+	diag("Test cpa command");
 
-	streams_init(&ss);
-	streams_exec(&o, &ss, cmd);
-	OK_SUCCESS_L(chk_coor_outp(linenum, format, ss.out.buf, num, coor,
-	                           mindist, maxdist), linenum,
-	             desc);
-	streams_free(&ss);
+	tc((chp{ execname, "cpa", "60,5", "45", "250", "61,6", "180", "220",
+	         NULL }),
+	   "time 286.031\n"
+	   "dist 4694.05288\n"
+	   "pos1 60.451556,5.922095\n"
+	   "pos2 60.434085,6.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "cpa");
+	tc((chp{ execname, "--km", "cpa", "60,5", "45", "0.25", "61,6", "180",
+	         "0.22", NULL }),
+	   "time 286.031\n"
+	   "dist 4.694053\n"
+	   "pos1 60.451556,5.922095\n"
+	   "pos2 60.434085,6.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--km cpa");
+	tc((chp{ execname, "-F", "sql", "cpa", "60,5", "45", "250", "61,6",
+	         "180", "220", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS cpa (time REAL, dist REAL, lat1 REAL,"
+	   " lon1 REAL, lat2 REAL, lon2 REAL);\n"
+	   "INSERT INTO cpa VALUES (286.031, 4694.05288, 60.451556,"
+	   " 5.922095, 60.434085, 6.0);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql cpa");
+	tc((chp{ execname, "-F", "gpx", "cpa", "60,5", "45", "250", "61,6",
+	         "180", "220", NULL }),
+	   GPX_HEADER
+	   "  <wpt lat=\"60.451556\" lon=\"5.922095\">\n"
+	   "    <name>Object 1</name>\n"
+	   "    <cmt>Closest approach after 286.031 seconds</cmt>\n"
+	   "  </wpt>\n"
+	   "  <wpt lat=\"60.434085\" lon=\"6.0\">\n"
+	   "    <name>Object 2</name>\n"
+	   "    <cmt>Closest approach after 286.031 seconds</cmt>\n"
+	   "  </wpt>\n"
+	   "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F gpx cpa");
+	tc((chp{ execname, "cpa", "0,0", "90", "10", "0,1", "90", "10",
+	         NULL }),
+	   "time 0.0\n"
+	   "dist 111194.926645\n"
+	   "pos1 0.0,0.0\n"
+	   "pos2 0.0,1.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "cpa: Parallel objects");
+	tc((chp{ execname, "cpa", "0,-1", "90", "10.0000001", "0,0", "90",
+	         "10", NULL }),
+	   "",
+	   EXECSTR ": No closest approach found\n",
+	   EXIT_FAILURE,
+	   "cpa: No closest approach found");
+	tc((chp{ execname, "cpa", "a", "0", "1", "3,4", "0", "1", NULL }),
+	   "",
+	   EXECSTR ": a: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "cpa: Invalid coordinate");
+	tc((chp{ execname, "cpa", "1,2", "0", "1", "3,4", "b", "1", NULL }),
+	   "",
+	   EXECSTR ": b: Invalid bearing: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "cpa: Invalid bearing");
+	tc((chp{ execname, "cpa", "1,2", "361", "1", "3,4", "0", "1", NULL }),
+	   "",
+	   EXECSTR ": 361: Bearing out of range\n",
+	   EXIT_FAILURE,
+	   "cpa: Bearing out of range");
+	tc((chp{ execname, "cpa", "1,2", "0", "a", "3,4", "0", "1", NULL }),
+	   "",
+	   EXECSTR ": a: Invalid speed: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "cpa: Invalid speed");
+	tc((chp{ execname, "cpa", "1,2", "0", "1", "3,4", "0", "inf", NULL }),
+	   "",
+	   EXECSTR ": inf: Invalid speed: Numerical result out of range\n",
+	   EXIT_FAILURE,
+	   "cpa: Infinite speed");
+	tc((chp{ execname, "cpa", "1,2", "0", "-1", "3,4", "0", "1", NULL }),
+	   "",
+	   EXECSTR ": -1: Speed cannot be negative\n",
+	   EXIT_FAILURE,
+	   "cpa: Negative speed");
+	tc((chp{ execname, "-K", "cpa", "1,2", "0", "1", "3,4", "0", "1",
+	         NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the cpa command\n",
+	   EXIT_FAILURE,
+	   "-K cpa");
+	tc((chp{ execname, "cpa", "1,2", "0", "1", "3,4", "0", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "cpa: Missing arguments");
 }
 
-#define te_randpos(format, cmd, num, coor, mindist, maxdist, desc)  \
-        te_randpos(__LINE__, (format), (cmd), (num), (coor), (mindist), \
-                   (maxdist), (desc))
-
 /*
- * test_randpos_dist_max() - Tests the randpos command with only the maximum 
- * distance. Returns nothing.
+ * test_cmd_area() - Tests the `area` command. Returns nothing.
  */
 
-static void test_randpos_dist_max(void)
+static void test_cmd_area(void)
 {
-	char **as;
-
-	diag("randpos with max_dist");
-
-	as =(chp{ execname, "--count", "50", "randpos", "1.234,5.6789", "100",
-	          NULL });
-	te_randpos(OF_DEFAULT, as, 50, "1.234,5.6789", 0.0, 100.0,
-	           "randpos: 50 pos inside a radius of 100m");
-
-	as =(chp{ execname, "--count", "51", "randpos", "1.234,5.6789",
-	          "100000000", NULL });
-	te_randpos(OF_DEFAULT, as, 51, "1.234,5.6789", 0.0,
-	           MAX_EARTH_DISTANCE,
-	           "randpos: max_dist is larger than MAX_EARTH_DISTANCE");
-
-	as =(chp{ execname, "--count", "52", "randpos", "1.234,5.6789", "0",
-	          "100000000", NULL });
-	te_randpos(OF_DEFAULT, as, 52, "1.234,5.6789", 0.0,
-	           MAX_EARTH_DISTANCE,
-	           "randpos: min_dist is larger than MAX_EARTH_DISTANCE");
-
-	as =(chp{ execname, "--count", "53", "randpos", "1.234,5.67",
-	          "100000000", "100000000", NULL });
-	te_randpos(OF_DEFAULT, as, 53, "1.234,5.67", MAX_EARTH_DISTANCE,
-	           MAX_EARTH_DISTANCE,
-	           "randpos: min_dist and max_dist are larger than"
-	           " MAX_EARTH_DISTANCE, stdout looks ok");
-
-	as =(chp{ execname, "-F", "gpx", "--count", "14", "randpos",
-	          "19.63,-19.70", "25", NULL });
-	te_randpos(OF_GPX, as, 14, NULL, 0, 0,
-	           "-F gpx --count 14 randpos 19.63,-19.70 25");
-
-	as =(chp{ execname, "--km", "--count", "50", "randpos",
-	          "1.234,5.6789", "100", NULL });
-	te_randpos(OF_DEFAULT, as, 50,
-	           "1.234,5.6789", 0.0, 100000.0,
-	           "--km randpos: 50 pos inside a radius of 100km,"
-	           " stdout looks ok");
-
-	as =(chp{ execname, "--km", "--count", "50", "randpos",
-	          "1.234,5.6789", "100000", NULL });
-	te_randpos(OF_DEFAULT, as, 50,
-	           "1.234,5.6789", 0.0, MAX_EARTH_DISTANCE,
-	           "--km randpos: max_dist is larger than MAX_EARTH_DISTANCE,"
-	           " stdout looks ok");
+	char input[] = "60,10\n60,11\n61,11\n61,10\n\n"
+	               "60.2,10.2\n60.8,10.2\n60.8,10.8\n60.2,10.8\n";
+
+	diag("Test area command");
+
+	tci((chp{ execname, "area", NULL }),
+	    input,
+	    "area 3896387741.88765\n"
+	    "perimeter 531033.419968\n"
+	    "points 8\n"
+	    "rings 2\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "area: Counterclockwise ring with a clockwise hole");
+	tci((chp{ execname, "--km", "area", "-", NULL }),
+	    input,
+	    "area 3896.387742\n"
+	    "perimeter 531.03342\n"
+	    "points 8\n"
+	    "rings 2\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--km area -");
+	tci((chp{ execname, "-K", "area", NULL }),
+	    input,
+	    "area 3918619807.31981\n"
+	    "perimeter 532398.65218627\n"
+	    "points 8\n"
+	    "rings 2\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-K area");
+	tci((chp{ execname, "-F", "sql", "--km", "area", NULL }),
+	    input,
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS area (area REAL, perimeter REAL,"
+	    " points INTEGER, rings INTEGER);\n"
+	    "INSERT INTO area VALUES (3896387741.88765, 531033.419968, 8,"
+	    " 2);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-F sql --km area");
+	tci((chp{ execname, "area", NULL }),
+	    "61,10\n61,11\n60,11\n60,10\n",
+	    "area -6088204459.04682\n"
+	    "perimeter 331894.634112\n"
+	    "points 4\n"
+	    "rings 1\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "area: Clockwise ring is negative");
+	tci((chp{ execname, "-K", "area", NULL }),
+	    "60,10\n61,10\n",
+	    "area 0.0\n"
+	    "perimeter 222841.45573928\n"
+	    "points 2\n"
+	    "rings 1\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "-K area: A ring with only two positions has no area");
+	tci((chp{ execname, "-K", "area", NULL }),
+	    "37,7\n-37,-173\n",
+	    "",
+	    EXECSTR ": Formula did not converge, antipodal points\n",
+	    EXIT_FAILURE,
+	    "-K area: Antipodal positions");
+	tci((chp{ execname, "area", NULL }),
+	    "# Only a comment\n",
+	    "",
+	    EXECSTR ": (stdin): No positions found\n",
+	    EXIT_FAILURE,
+	    "area: No positions");
+	tci((chp{ execname, "area", NULL }),
+	    "60,10\n91,10\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,10\n",
+	    EXIT_FAILURE,
+	    "area: Invalid coordinate");
+	tc((chp{ execname, "area", "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "area: File doesn't exist");
+	tc((chp{ execname, "-F", "gpx", "area", NULL }),
+	   "",
+	   EXECSTR ": GPX output is not supported by the area command\n",
+	   EXIT_FAILURE,
+	   "-F gpx area");
+	tc((chp{ execname, "area", "a", "b", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "area: Too many arguments");
 }
 
 /*
- * test_randpos_dist_minmax() - Tests the randpos command with both maximum and 
- * minimum distance. Returns nothing.
+ * test_cmd_grid() - Tests the `grid` command. Returns nothing.
  */
 
-static void test_randpos_dist_minmax(void)
+static void test_cmd_grid(void)
 {
-	char **as;
-
-	diag("randpos with max_dist and min_dist");
-
-	as = (chp{ execname, "randpos", "12.34,56.78", "100", "200", NULL });
-	te_randpos(OF_DEFAULT, as, 1, "12.34,56.78", 100.0, 200.0,
-	           "randpos: min_dist is larger than max_dist");
-
-	as = (chp{ execname, "--count", "27", "randpos", "1.234,5.6789",
-	           "2000", "2000", NULL });
-	te_randpos(OF_DEFAULT, as, 27, "1.234,5.6789", 2000.0, 2000.0,
-	           "randpos: max_dist is equal to min_dist, stdout looks ok");
-
-	as = (chp{ execname, "-F", "gpx", "--count", "21", "randpos",
-	           "90,0", "7741", "7777", NULL });
-	te_randpos(OF_GPX, as, 21, "90,0", 7741, 7777,
-	           "randpos, North Pole, 25 pos as GPX, dists swapped");
-
-	as = (chp{ execname, "--count", "33", "randpos", "90,0", "10000",
-	           NULL });
-	te_randpos(OF_DEFAULT, as, 33, "90,0", 0.0, 10000.0,
-	           "randpos: Exactly at the North Pole");
+	diag("Test grid command");
 
-	as = (chp{ execname, "--count", "34", "randpos", "-90,0", "10001",
-	           NULL });
-	te_randpos(OF_DEFAULT, as, 34, "-90,0", 0.0, 10001.0,
-	           "randpos: Exactly at the South Pole");
+	tc((chp{ execname, "grid", "5", NULL }),
+	   "53.130102,90.0\n"
+	   "23.578178,-47.507764\n"
+	   "0.0,174.984472\n"
+	   "-23.578178,37.476708\n"
+	   "-53.130102,-100.031056\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "grid 5");
+	tc((chp{ execname, "-F", "sql", "grid", "3", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS grid (num INTEGER, lat REAL,"
+	   " lon REAL, dist REAL, bear REAL);\n"
+	   "INSERT INTO grid VALUES (1, 41.810315, 90.0, NULL, NULL);\n"
+	   "INSERT INTO grid VALUES (2, 0.0, -47.507764, NULL, NULL);\n"
+	   "INSERT INTO grid VALUES (3, -41.810315, 174.984472, NULL,"
+	   " NULL);\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F sql grid 3");
+	tc((chp{ execname, "-F", "gpx", "--shard", "2/2", "grid", "3",
+	         NULL }),
+	   GPX_HEADER
+	   "  <wpt lat=\"0.0\" lon=\"-47.507764\">\n"
+	   "    <name>Grid 2</name>\n"
+	   "  </wpt>\n"
+	   "  <wpt lat=\"-41.810315\" lon=\"174.984472\">\n"
+	   "    <name>Grid 3</name>\n"
+	   "  </wpt>\n"
+	   "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F gpx --shard 2/2 grid 3");
+	tc((chp{ execname, "--shard", "1/5", "grid", "3", NULL }),
+	   "",
+	   "",
+	   EXIT_SUCCESS,
+	   "--shard 1/5 grid 3: Empty part");
+	tc((chp{ execname, "--geohash", "4", "grid", "2", NULL }),
+	   "30.0,90.0 wj24\n"
+	   "-30.0,-47.507764 6fwj\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--geohash 4 grid 2");
+	tc((chp{ execname, "--km", "grid", "60,10", "0.3", "0.2", NULL }),
+	   "60.0,10.001349\n"
+	   "59.999211,9.998277\n"
+	   "60.001502,10.000264\n"
+	   "59.998584,10.002171\n"
+	   "60.000352,9.996015\n"
+	   "60.001201,10.003775\n"
+	   "59.997651,9.998737\n"
+	   "60.002318,9.997592\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--km grid 60,10 0.3 0.2");
+	tc((chp{ execname, "grid", "60,10", "1000", "5000", NULL }),
+	   "60.0,10.0\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "grid 60,10 1000 5000: One position at the center");
+	tc((chp{ execname, "--count", "3", "grid", "60,10", "1000", "100",
+	         NULL }),
+	   "",
+	   EXECSTR ": --count is not supported by the grid command\n",
+	   EXIT_FAILURE,
+	   "--count grid 60,10 1000 100");
+	tc((chp{ execname, "--count", "1", "grid", "5", NULL }),
+	   "",
+	   EXECSTR ": --count is not supported by the grid command\n",
+	   EXIT_FAILURE,
+	   "--count 1 grid 5");
+	tc((chp{ execname, "--geohash", "5", "-F", "sql", "--shard", "3/3",
+	         "grid", "60,10", "1000", "600", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS grid (num INTEGER, lat REAL,"
+	   " lon REAL, dist REAL, bear REAL, geohash TEXT);\n"
+	   "INSERT INTO grid VALUES (7, 59.992998, 9.996236, 806.225775,"
+	   " 195.046584, 'u4xj7');\n"
+	   "INSERT INTO grid VALUES (8, 60.006912, 9.992819, 866.025404,"
+	   " 332.554348, 'u4xj7');\n"
+	   "INSERT INTO grid VALUES (9, 59.997155, 10.015575, 921.954446,"
+	   " 110.062112, 'u4xj7');\n"
+	   "INSERT INTO grid VALUES (10, 59.996654, 9.983797, 974.679434,"
+	   " 247.569876, 'u4xj7');\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "--geohash 5 -F sql --shard 3/3 grid 60,10 1000 600");
+	tc((chp{ execname, "grid", "1.5", NULL }),
+	   "",
+	   EXECSTR ": 1.5: Invalid number of positions\n",
+	   EXIT_FAILURE,
+	   "grid: Number of positions is not an integer");
+	tc((chp{ execname, "grid", "4000000001", NULL }),
+	   "",
+	   EXECSTR ": 4000000001: Invalid number of positions\n",
+	   EXIT_FAILURE,
+	   "grid: Too many positions");
+	tc((chp{ execname, "grid", "91,0", "1", "1", NULL }),
+	   "",
+	   EXECSTR ": 91,0: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "grid: Invalid coordinate");
+	tc((chp{ execname, "grid", "60,10", "x", "1", NULL }),
+	   "",
+	   EXECSTR ": x: Invalid distance: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "grid: Invalid distance");
+	tc((chp{ execname, "grid", "60,10", "-1", "1", NULL }),
+	   "",
+	   EXECSTR ": -1: Distance cannot be negative\n",
+	   EXIT_FAILURE,
+	   "grid: Negative distance");
+	tc((chp{ execname, "grid", "60,10", "1", "0", NULL }),
+	   "",
+	   EXECSTR ": 0: Invalid spacing\n",
+	   EXIT_FAILURE,
+	   "grid: Spacing is zero");
+	tc((chp{ execname, "grid", "60,10", "100000", "0.001", NULL }),
+	   "",
+	   EXECSTR ": Too many positions, the spacing is too small\n",
+	   EXIT_FAILURE,
+	   "grid: Spacing is too small");
+	tc((chp{ execname, "grid", "1", "2", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "grid: Missing arguments");
+	tc((chp{ execname, "grid", "1", "2", "3", "4", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "grid: Too many arguments");
+	tc((chp{ execname, "--shard", "0/2", "grid", "3", NULL }),
+	   "",
+	   EXECSTR ": 0/2: Invalid --shard argument\n"
+	   EXECSTR ": Option error\n"
+	   EXECSTR ": Type \"" EXECSTR " --help\" for help screen."
+	   " Returning with value 1.\n",
+	   EXIT_FAILURE,
+	   "--shard 0/2");
+	tc((chp{ execname, "--shard", "3/2", "grid", "3", NULL }),
+	   "",
+	   EXECSTR ": 3/2: Invalid --shard argument\n"
+	   EXECSTR ": Option error\n"
+	   EXECSTR ": Type \"" EXECSTR " --help\" for help screen."
+	   " Returning with value 1.\n",
+	   EXIT_FAILURE,
+	   "--shard 3/2");
+	tc((chp{ execname, "--shard", "1/", "grid", "3", NULL }),
+	   "",
+	   EXECSTR ": 1/: Invalid --shard argument\n"
+	   EXECSTR ": Option error\n"
+	   EXECSTR ": Type \"" EXECSTR " --help\" for help screen."
+	   " Returning with value 1.\n",
+	   EXIT_FAILURE,
+	   "--shard 1/");
+	tc((chp{ execname, "--shard", "1", "grid", "3", NULL }),
+	   "",
+	   EXECSTR ": 1: Invalid --shard argument\n"
+	   EXECSTR ": Option error\n"
+	   EXECSTR ": Type \"" EXECSTR " --help\" for help screen."
+	   " Returning with value 1.\n",
+	   EXIT_FAILURE,
+	   "--shard 1");
+	tc((chp{ execname, "--shard", "1/2", "randpos", NULL }),
+	   "",
+	   EXECSTR ": --shard is not supported by the randpos command\n",
+	   EXIT_FAILURE,
+	   "--shard randpos");
+	tc((chp{ execname, "-K", "grid", "3", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the grid command\n",
+	   EXIT_FAILURE,
+	   "-K grid");
 }
 
 /*
- * test_randpos_dist() - Tests the randpos command with maximum and minimum 
- * distance. Returns nothing.
+ * test_cmd_randpoly() - Tests the `randbox` and `randpoly` commands. Returns 
+ * nothing.
  */
 
-static void test_randpos_dist(void)
+static void test_cmd_randpoly(void)
 {
-	test_randpos_dist_max();
-	test_randpos_dist_minmax();
+	char *lshape = "0,0\n0,40\n20,40\n20,20\n45,20\n45,0\n\n"
+	               "10,5\n30,5\n30,15\n10,15\n";
+
+	diag("Test randbox and randpoly commands");
+
+	tc((chp{ execname, "-F", "sql", "--seed", "3", "--count", "2",
+	         "--geohash", "5", "randbox", "10,170", "-10,-170", NULL }),
+	   "BEGIN;\n"
+	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER,"
+	   " lat REAL, lon REAL, dist REAL, bear REAL, geohash TEXT);\n"
+	   "INSERT INTO randpos VALUES (3, 1, -5.645112, -172.726533, NULL,"
+	   " NULL, '2nvpv');\n"
+	   "INSERT INTO randpos VALUES (3, 2, 3.749419, 175.340553, NULL,"
+	   " NULL, 'xbstm');\n"
+	   "COMMIT;\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "randbox across the antimeridian");
+	tc((chp{ execname, "-F", "gpx", "--seed", "3", "--count", "2",
+	         "--sort", "hilbert", "randbox", "59,10", "60,11", NULL }),
+	   GPX_HEADER
+	   "  <wpt lat=\"59.780696\" lon=\"10.863673\">\n"
+	   "    <name>Random 1, seed 3</name>\n"
+	   "  </wpt>\n"
+	   "  <wpt lat=\"59.30855\" lon=\"10.267028\">\n"
+	   "    <name>Random 2, seed 3</name>\n"
+	   "  </wpt>\n"
+	   "</gpx>\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "randbox with GPX output and --sort");
+	tc((chp{ execname, "randbox", "91,0", "1,1", NULL }),
+	   "",
+	   EXECSTR ": 91,0: Invalid coordinate\n",
+	   EXIT_FAILURE,
+	   "randbox with invalid first coordinate");
+	tc((chp{ execname, "randbox", "1,1", "x", NULL }),
+	   "",
+	   EXECSTR ": x: Invalid coordinate: Invalid argument\n",
+	   EXIT_FAILURE,
+	   "randbox with invalid second coordinate");
+	tc((chp{ execname, "-K", "randbox", "1,1", "2,2", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the randbox command\n",
+	   EXIT_FAILURE,
+	   "-K randbox");
+	tc((chp{ execname, "randbox", "1,2", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "randbox with 1 argument");
+
+	tci((chp{ execname, "--seed", "3", "--count", "4", "randpoly", "-",
+	          NULL }),
+	    lshape,
+	    "37.552618,2.393994\n"
+	    "0.855364,31.793872\n"
+	    "6.700176,14.540354\n"
+	    "7.15108,36.683319\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "randpoly with a hole");
+	tci((chp{ execname, "--seed", "3", "--count", "3", "--km",
+	          "--min-separation", "1000", "randpoly", NULL }),
+	    lshape,
+	    "37.552618,2.393994\n"
+	    "0.855364,31.793872\n"
+	    "6.700176,14.540354\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "randpoly --min-separation");
+	tci((chp{ execname, "randpoly", NULL }),
+	    "0,0\n0,10\n0,20\n",
+	    "",
+	    EXECSTR ": (stdin): No counterclockwise polygons with an area"
+	    " found\n",
+	    EXIT_FAILURE,
+	    "randpoly with positions on a line");
+	tci((chp{ execname, "randpoly", NULL }),
+	    "0,0\n0,10\n",
+	    "",
+	    EXECSTR ": (stdin): Fence 1 has less than 3 positions\n",
+	    EXIT_FAILURE,
+	    "randpoly with 2 positions");
+	tc((chp{ execname, "randpoly", "a", "b", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "randpoly with 2 arguments");
+	tc((chp{ execname, "--rhumb", "randpoly", NULL }),
+	   "",
+	   EXECSTR ": --rhumb is not supported by the randpoly command\n",
+	   EXIT_FAILURE,
+	   "--rhumb randpoly");
 }
 
 /*
- * test_cmd_randpos() - Tests the randpos command. Returns nothing.
+ * test_cmd_ring() - Tests the `ring` command and the --inner and --sector 
+ * options. Returns nothing.
  */
 
-static void test_cmd_randpos(const struct Options *o)
+static void test_cmd_ring(void)
 {
-	int res;
-	struct streams ss;
-	double lat, lon;
-	char **as;
-
-	assert(o);
-	diag("Test randpos command");
-
-	tc((chp{ execname, "randpos", "1,2", "100", "90", "5", NULL }),
+	diag("Test ring command");
+
+	tci((chp{ execname, "--inner", "500", "ring", "1000", "3", NULL }),
+	    "60,10\n\n0,0\n",
+	    "60.008993,10.0\n"
+	    "59.995502,9.984425\n"
+	    "59.995502,10.015575\n"
+	    "60.008993,10.0\n"
+	    "\n"
+	    "59.997751,10.007788\n"
+	    "59.997751,9.992212\n"
+	    "60.004497,10.0\n"
+	    "59.997751,10.007788\n"
+	    "\n"
+	    "0.008993,0.0\n"
+	    "-0.004497,-0.007788\n"
+	    "-0.004497,0.007788\n"
+	    "0.008993,0.0\n"
+	    "\n"
+	    "-0.002248,0.003894\n"
+	    "-0.002248,-0.003894\n"
+	    "0.004497,0.0\n"
+	    "-0.002248,0.003894\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "ring --inner with 2 centers");
+	tci((chp{ execname, "--sector", "0/90", "ring", "1000", "3", "-",
+	          NULL }),
+	    "60,10\n",
+	    "59.999999,10.017986\n"
+	    "60.006359,10.012721\n"
+	    "60.008993,10.0\n"
+	    "60.0,10.0\n"
+	    "59.999999,10.017986\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "ring --sector");
+	tci((chp{ execname, "-F", "sql", "--km", "--sector", "350/10",
+	          "--inner", "0.5", "ring", "1", "3", NULL }),
+	    "0,0\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS ring (num INTEGER, part INTEGER,"
+	    " vertex INTEGER, lat REAL, lon REAL);\n"
+	    "INSERT INTO ring VALUES (1, 1, 1, 0.008857, 0.001562);\n"
+	    "INSERT INTO ring VALUES (1, 1, 2, 0.008993, 0.0);\n"
+	    "INSERT INTO ring VALUES (1, 1, 3, 0.008857, -0.001562);\n"
+	    "INSERT INTO ring VALUES (1, 1, 4, 0.004428, -0.000781);\n"
+	    "INSERT INTO ring VALUES (1, 1, 5, 0.004497, 0.0);\n"
+	    "INSERT INTO ring VALUES (1, 1, 6, 0.004428, 0.000781);\n"
+	    "INSERT INTO ring VALUES (1, 1, 7, 0.008857, 0.001562);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "ring with sql, --km, --sector across north and --inner");
+	tci((chp{ execname, "-F", "geojson", "ring", "1000", "3", NULL }),
+	    "60,10\n0,0\n",
+	    "{\"type\": \"FeatureCollection\", \"features\": [\n"
+	    "{\"type\": \"Feature\", \"properties\": {\"num\": 1},"
+	    " \"geometry\": {\"type\": \"Polygon\", \"coordinates\":"
+	    " [[[10.0, 60.008993], [9.984425, 59.995502],"
+	    " [10.015575, 59.995502], [10.0, 60.008993]]]}},\n"
+	    "{\"type\": \"Feature\", \"properties\": {\"num\": 2},"
+	    " \"geometry\": {\"type\": \"Polygon\", \"coordinates\":"
+	    " [[[0.0, 0.008993], [-0.007788, -0.004497],"
+	    " [0.007788, -0.004497], [0.0, 0.008993]]]}}\n"
+	    "]}\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "ring with GeoJSON output");
+	tci((chp{ execname, "-F", "geojson", "ring", "1000", "3", NULL }),
+	    "",
+	    "{\"type\": \"FeatureCollection\", \"features\": [\n"
+	    "]}\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "ring with GeoJSON output and no centers");
+	tci((chp{ execname, "-F", "gpx", "--inner", "500", "ring", "1000",
+	          "3", NULL }),
+	    "60,10\n",
+	    GPX_HEADER
+	    "  <trk>\n"
+	    "    <name>Ring 1</name>\n"
+	    "    <trkseg>\n"
+	    "      <trkpt lat=\"60.008993\" lon=\"10.0\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"59.995502\" lon=\"9.984425\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"59.995502\" lon=\"10.015575\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"60.008993\" lon=\"10.0\">\n"
+	    "      </trkpt>\n"
+	    "    </trkseg>\n"
+	    "    <trkseg>\n"
+	    "      <trkpt lat=\"59.997751\" lon=\"10.007788\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"59.997751\" lon=\"9.992212\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"60.004497\" lon=\"10.0\">\n"
+	    "      </trkpt>\n"
+	    "      <trkpt lat=\"59.997751\" lon=\"10.007788\">\n"
+	    "      </trkpt>\n"
+	    "    </trkseg>\n"
+	    "  </trk>\n"
+	    "</gpx>\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "ring with GPX output and --inner");
+	tci((chp{ execname, "--km", "ring", "100000", "3", NULL }),
+	    "90,0\n",
+	    "-90.0,0.0\n"
+	    "-90.0,-90.0\n"
+	    "-90.0,90.0\n"
+	    "-90.0,0.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "ring with a radius larger than the Earth");
+	tci((chp{ execname, "ring", "1000", "3", NULL }),
+	    "x\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: x\n",
+	    EXIT_FAILURE,
+	    "ring with invalid center");
+	tc((chp{ execname, "ring", "1", "3", "/nonexistent", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent: Cannot open file for read: No such file"
+	   " or directory\n",
+	   EXIT_FAILURE,
+	   "ring with missing file");
+	tc((chp{ execname, "ring", "0", "3", NULL }),
+	   "",
+	   EXECSTR ": 0: Invalid radius\n",
+	   EXIT_FAILURE,
+	   "ring with radius 0");
+	tc((chp{ execname, "ring", "1", "2", NULL }),
+	   "",
+	   EXECSTR ": 2: Invalid number of vertices, must be 3-1000000\n",
+	   EXIT_FAILURE,
+	   "ring with 2 vertices");
+	tc((chp{ execname, "ring", "1", "1000001", NULL }),
+	   "",
+	   EXECSTR ": 1000001: Invalid number of vertices, must be"
+	   " 3-1000000\n",
+	   EXIT_FAILURE,
+	   "ring with too many vertices");
+	tc((chp{ execname, "ring", "1", "3x", NULL }),
+	   "",
+	   EXECSTR ": 3x: Invalid number of vertices, must be 3-1000000\n",
+	   EXIT_FAILURE,
+	   "ring with trailing garbage after vertices");
+	tc((chp{ execname, "--inner", "5", "ring", "5", "3", NULL }),
+	   "",
+	   EXECSTR ": The inner radius must be smaller than the radius\n",
+	   EXIT_FAILURE,
+	   "ring with --inner equal to the radius");
+	tc((chp{ execname, "--inner", "-1", "ring", "5", "3", NULL }),
+	   "",
+	   EXECSTR ": -1: Invalid --inner argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--inner with negative value");
+	tc((chp{ execname, "--sector", "5", "ring", "5", "3", NULL }),
+	   "",
+	   EXECSTR ": 5: Invalid --sector argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--sector without slash");
+	tc((chp{ execname, "--sector", "5/361", "ring", "5", "3", NULL }),
+	   "",
+	   EXECSTR ": 5/361: Invalid --sector argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--sector with bearing above 360");
+	tc((chp{ execname, "--sector", "1/", "ring", "5", "3", NULL }),
+	   "",
+	   EXECSTR ": 1/: Invalid --sector argument\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--sector without second bearing");
+	tc((chp{ execname, "--sector", "90/90", "ring", "1000", "5", NULL }),
+	   "",
+	   EXECSTR ": 90/90: The --sector bearings cannot be equal\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--sector with equal bearings");
+	tc((chp{ execname, "--sector", "360/0", "ring", "1000", "5", NULL }),
+	   "",
+	   EXECSTR ": 360/0: The --sector bearings cannot be equal\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--sector 360/0 is a sector with equal bearings");
+	tc((chp{ execname, "--inner", "1", "bear", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": --inner is not supported by the bear command\n",
+	   EXIT_FAILURE,
+	   "--inner bear");
+	tc((chp{ execname, "--sector", "1/2", "bear", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": --sector is not supported by the bear command\n",
+	   EXIT_FAILURE,
+	   "--sector bear");
+	tc((chp{ execname, "-F", "geojson", "bear", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": GeoJSON output is not supported by the bear command\n",
+	   EXIT_FAILURE,
+	   "-F geojson bear");
+	tc((chp{ execname, "-K", "ring", "1", "3", NULL }),
+	   "",
+	   EXECSTR ": -K/--karney is not supported by the ring command\n",
+	   EXIT_FAILURE,
+	   "-K ring");
+	tc((chp{ execname, "ring", "1", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "ring with 1 argument");
+	tc((chp{ execname, "ring", "1", "3", "a", "b", NULL }),
 	   "",
 	   EXECSTR ": Too many arguments\n",
 	   EXIT_FAILURE,
-	   "randpos with 1 extra argument");
-
-	streams_init(&ss);
-	streams_exec(o, &ss, (chp{ execname, "randpos", NULL }));
-	lat = lon = 0;
-	res = parse_coordinate(ss.out.buf, true, &lat, &lon);
-	OK_SUCCESS(res, "randpos: Coordinate is valid");
-	OK_TRUE(fabs(lat) <= 90, "randpos: lat is in range");
-	OK_TRUE(fabs(lat) <= 180, "randpos: lon is in range");
-	streams_free(&ss);
+	   "ring with 4 arguments");
+}
 
-	as = (chp{ execname, "--count", "5", "randpos", NULL });
-	te_randpos(OF_DEFAULT, as, 5, NULL, 0, 0,
-	           "--count 5 randpos, stdout is ok");
+/*
+ * test_cmd_convert() - Tests the `convert` command and the --origin option. 
+ * Returns nothing.
+ */
 
-	as = (chp{ execname, "-F", "gpx", "--count", "9", "randpos", NULL });
-	te_randpos(OF_GPX, as, 9, NULL, 0, 0,
-	           "-F gpx --count 9 randpos, stdout is ok");
+static void test_cmd_convert(void)
+{
+	double bin[] = { 60.0, 10.0, 50.0, NAN, NAN, 0.0, 0.0, 0.0, 0.0 };
+	char *buf, *p;
+	int i;
 
-	diag("--count with invalid argument");
-	tc((chp{ execname, "--count", "", "randpos", NULL }),
+	diag("Test convert command");
+
+	tci((chp{ execname, "convert", "geo", "ecef", NULL }),
+	    "0,0\n90,0\n\n# Comment\n60,10,50\n",
+	    "6378137.0,0.0,0.0\n"
+	    "0.0,0.0,6356752.314\n"
+	    "\n"
+	    "3148558.005,555175.727,5500520.435\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert geo ecef");
+	tci((chp{ execname, "convert", "geo", "ecef", NULL }),
+	    "60°N 5°E,100\n60 30 N 5 30 E 10\n",
+	    "3184988.448,278650.383,5500563.736\n"
+	    "3134247.625,301793.721,5528129.106\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert geo ecef with hemisphere letters and height");
+	tci((chp{ execname, "convert", "geo", "ecef", NULL }),
+	    "60 5,100\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: 60 5,100\n",
+	    EXIT_FAILURE,
+	    "convert geo ecef: Minutes without marker before comma");
+	tci((chp{ execname, "convert", "ecef", "geo", "-", NULL }),
+	    "6378137,0,0\n0,0,0\n-4643931.481,2553022.936,-3537234.193\n",
+	    "0.0,0.0,0.0\n"
+	    "90.0,0.0,-6356752.314\n"
+	    "-33.9,151.2,-20.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert ecef geo");
+	tci((chp{ execname, "--origin", "60,10,50", "convert", "geo", "enu",
+	          NULL }),
+	    "60,10,50\n60.001,10,50\n60,10.001,150\n",
+	    "0.0,0.0,0.0\n"
+	    "0.0,111.413,-0.001\n"
+	    "55.801,0.0,100.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert geo enu");
+	tci((chp{ execname, "--km", "-F", "sql", "--origin", "60,10,0.05",
+	          "convert", "enu", "ecef", NULL }),
+	    "0,0,0\n0,0.111413,0\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS ecef (num INTEGER, x REAL, y REAL,"
+	    " z REAL);\n"
+	    "INSERT INTO ecef VALUES (1, 3148558.005, 555175.727,"
+	    " 5500520.435);\n"
+	    "INSERT INTO ecef VALUES (2, 3148462.984, 555158.972,"
+	    " 5500576.142);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert enu ecef with --km and sql");
+	tci((chp{ execname, "--km", "--origin", "60,10", "convert", "enu",
+	          "geo", NULL }),
+	    "0.055801,0,0.1\n",
+	    "60.0,10.001,0.1\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert enu geo with --km");
+	tci((chp{ execname, "-F", "sql", "--origin", "0,0", "convert", "enu",
+	          "enu", NULL }),
+	    "1,2,3\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS enu (num INTEGER, east REAL,"
+	    " north REAL, up REAL);\n"
+	    "INSERT INTO enu VALUES (1, 1.0, 2.0, 3.0);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert enu enu with sql");
+	tci((chp{ execname, "-F", "sql", "convert", "geo", "geo", NULL }),
+	    "1,2\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS geodetic (num INTEGER, lat REAL,"
+	    " lon REAL, height REAL);\n"
+	    "INSERT INTO geodetic VALUES (1, 1.0, 2.0, 0.0);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert geo geo with sql");
+	tci((chp{ execname, "convert", "geo", "ecef", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"><ele>5</ele></wpt>"
+	    "<wpt lat=\"1\" lon=\"2\"/></gpx>\n",
+	    "6373292.276,222560.27,110568.862\n"
+	    "6373287.28,222560.096,110568.775\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert geo ecef with GPX input");
+	tci_func(__LINE__, 1, (chp{ execname, "--input-format", "binary",
+	                            "convert", "geo", "ecef", NULL }),
+	         (char *)bin, sizeof(bin) - sizeof(double),
+	         "3148558.005,555175.727,5500520.435\n"
+	         "\n",
+	         EXECSTR ": (stdin): Incomplete record after record 2\n",
+	         EXIT_FAILURE,
+	         "convert with binary input and an incomplete record");
+	bin[6] = 91.0;
+	tci_func(__LINE__, 1, (chp{ execname, "--input-format", "binary",
+	                            "convert", "geo", "ecef", NULL }),
+	         (char *)bin, sizeof(bin),
+	         "3148558.005,555175.727,5500520.435\n"
+	         "\n",
+	         EXECSTR ": (stdin): Invalid coordinate in record 3\n",
+	         EXIT_FAILURE,
+	         "convert with binary input and an invalid latitude");
+	tci_func(__LINE__, 1, (chp{ execname, "--input-format", "binary",
+	                            "convert", "ecef", "ecef", NULL }),
+	         (char *)bin, sizeof(bin),
+	         "60.0,10.0,50.0\n"
+	         "\n"
+	         "91.0,0.0,0.0\n",
+	         "",
+	         EXIT_SUCCESS,
+	         "convert ecef ecef with binary input");
+	tci((chp{ execname, "convert", "ecef", "geo", NULL }),
+	    "<gpx><wpt lat=\"1\" lon=\"2\"/></gpx>\n",
+	    "",
+	    EXECSTR ": (stdin): GPX input is only supported with geo\n",
+	    EXIT_FAILURE,
+	    "convert ecef with GPX input");
+	tci((chp{ execname, "convert", "geo", "ecef", NULL }),
+	    "91,2\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: 91,2\n",
+	    EXIT_FAILURE,
+	    "convert geo with invalid latitude");
+	tci((chp{ execname, "convert", "ecef", "geo", NULL }),
+	    "1,2,3,4\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: 1,2,3,4\n",
+	    EXIT_FAILURE,
+	    "convert with 4 values");
+	tci((chp{ execname, "convert", "ecef", "geo", NULL }),
+	    "1\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: 1\n",
+	    EXIT_FAILURE,
+	    "convert with 1 value");
+	tci((chp{ execname, "convert", "ecef", "geo", NULL }),
+	    "1,inf,3\n",
+	    "",
+	    EXECSTR ": (stdin):1: Invalid coordinate: 1,inf,3\n",
+	    EXIT_FAILURE,
+	    "convert with infinite value");
+	tc((chp{ execname, "convert", "geo", "ecef", "/nonexistent", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent: Cannot open file for read: No such file"
+	   " or directory\n",
+	   EXIT_FAILURE,
+	   "convert with missing file");
+	tc((chp{ execname, "convert", "abc", "geo", NULL }),
 	   "",
-	   EXECSTR ": : Invalid --count argument\n"
-	   OPTION_ERROR_STR,
+	   EXECSTR ": abc: Unknown coordinate system, must be ecef, enu,"
+	   " geo, mgrs or utm\n",
 	   EXIT_FAILURE,
-	   "Empty argument to --count");
-	tc((chp{ execname, "--count", "g", "randpos", NULL }),
+	   "convert from unknown system");
+	tc((chp{ execname, "convert", "geo", "xyz", NULL }),
 	   "",
-	   EXECSTR ": g: Invalid --count argument\n"
+	   EXECSTR ": xyz: Unknown coordinate system, must be ecef, enu,"
+	   " geo, mgrs or utm\n",
+	   EXIT_FAILURE,
+	   "convert to unknown system");
+	tc((chp{ execname, "convert", "geo", "enu", NULL }),
+	   "",
+	   EXECSTR ": enu needs the position in --origin\n",
+	   EXIT_FAILURE,
+	   "convert geo enu without --origin");
+	tc((chp{ execname, "--origin", "1,2", "convert", "geo", "ecef",
+	         NULL }),
+	   "",
+	   EXECSTR ": --origin is only used with enu\n",
+	   EXIT_FAILURE,
+	   "convert geo ecef with --origin");
+	tc((chp{ execname, "--origin", "1", "convert", "geo", "enu", NULL }),
+	   "",
+	   EXECSTR ": 1: Invalid --origin argument\n"
 	   OPTION_ERROR_STR,
 	   EXIT_FAILURE,
-	   "--count receives non-number");
-	tc((chp{ execname, "--count", "11y", "randpos", NULL }),
+	   "--origin without longitude");
+	tc((chp{ execname, "--origin", "1,", "convert", "geo", "enu", NULL }),
 	   "",
-	   EXECSTR ": 11y: Invalid --count argument\n"
+	   EXECSTR ": 1,: Invalid --origin argument\n"
 	   OPTION_ERROR_STR,
 	   EXIT_FAILURE,
-	   "--count 11y");
-	tc((chp{ execname, "--count", "11.3", "randpos", NULL }),
+	   "--origin with empty longitude");
+	tc((chp{ execname, "--origin", "1,2,", "convert", "geo", "enu",
+	         NULL }),
 	   "",
-	   EXECSTR ": 11.3: Invalid --count argument\n"
+	   EXECSTR ": 1,2,: Invalid --origin argument\n"
 	   OPTION_ERROR_STR,
 	   EXIT_FAILURE,
-	   "--count 11.3");
-	tc((chp{ execname, "--count", "-2", "randpos", NULL }),
+	   "--origin with empty height");
+	tc((chp{ execname, "--origin", "91,2", "convert", "geo", "enu",
+	         NULL }),
 	   "",
-	   EXECSTR ": -2: Invalid --count argument\n"
+	   EXECSTR ": 91,2: Invalid --origin argument\n"
 	   OPTION_ERROR_STR,
 	   EXIT_FAILURE,
-	   "--count -2");
+	   "--origin with invalid latitude");
+	tc((chp{ execname, "--origin", "1,2", "bear", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": --origin is not supported by the bear command\n",
+	   EXIT_FAILURE,
+	   "--origin bear");
+	tci((chp{ execname, "convert", "geo", "utm", NULL }),
+	    "60,10,100\n\n-33.8568,151.2153\n",
+	    "32V,555776.267,6651832.735,100.0\n"
+	    "\n"
+	    "56H,334900.57,6252288.753,0.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert geo utm");
+	tci((chp{ execname, "-F", "sql", "convert", "geo", "mgrs", NULL }),
+	    "60,10,100\n-33.8568,151.2153\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS mgrs (num INTEGER, mgrs TEXT,"
+	    " height REAL);\n"
+	    "INSERT INTO mgrs VALUES (1, '32VNM5577651832', 100.0);\n"
+	    "INSERT INTO mgrs VALUES (2, '56HLH3490052288', 0.0);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert geo mgrs with sql");
+	tci((chp{ execname, "--km", "-F", "sql", "--origin", "60,10",
+	          "convert", "enu", "utm", NULL }),
+	    "0.0558,0.111413,0.1\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS utm (num INTEGER, zone INTEGER,"
+	    " band TEXT, easting REAL, northing REAL, height REAL);\n"
+	    "INSERT INTO utm VALUES (1, 32, 'V', 555830.356, 6651944.937,"
+	    " 100.001);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert enu utm with --km and sql");
+	tci((chp{ execname, "convert", "geo", "mgrs", NULL }),
+	    "1,2\n85,0\n\n",
+	    "31NCB8873610547,0.0\n",
+	    EXECSTR ": Position 2 is outside the UTM area\n",
+	    EXIT_FAILURE,
+	    "convert geo mgrs, outside the UTM area before a blank line");
+	tci((chp{ execname, "convert", "geo", "utm", NULL }),
+	    "1,2\n85,0\n",
+	    "31N,388736.188,110547.106,0.0\n",
+	    EXECSTR ": Position 2 is outside the UTM area\n",
+	    EXIT_FAILURE,
+	    "convert geo utm, outside the UTM area");
+	tc((chp{ execname, "convert", "mgrs", "geo", NULL }),
+	   "",
+	   EXECSTR ": mgrs can only be used as the output system\n",
+	   EXIT_FAILURE,
+	   "convert from mgrs");
+	tc((chp{ execname, "-F", "utm", "convert", "geo", "ecef", NULL }),
+	   "",
+	   EXECSTR ": UTM output is not supported by the convert command\n",
+	   EXIT_FAILURE,
+	   "-F utm convert");
+	tc((chp{ execname, "-F", "gpx", "convert", "geo", "ecef", NULL }),
+	   "",
+	   EXECSTR ": GPX output is not supported by the convert command\n",
+	   EXIT_FAILURE,
+	   "-F gpx convert");
+	tc((chp{ execname, "convert", "geo", NULL }),
+	   "",
+	   EXECSTR ": Missing arguments\n",
+	   EXIT_FAILURE,
+	   "convert with 1 argument");
+	tc((chp{ execname, "convert", "geo", "ecef", "a", "b", NULL }),
+	   "",
+	   EXECSTR ": Too many arguments\n",
+	   EXIT_FAILURE,
+	   "convert with 4 arguments");
 
-	diag("--count 0");
-	tc((chp{ execname, "--count", "0", "randpos", NULL }),
+	/* More positions than CONVERT_BATCH */
+	buf = malloc((CONVERT_BATCH + 1) * 5 + 1);
+	if (!buf) {
+		failed_ok("malloc()"); /* gncov */
+		return; /* gncov */
+	}
+	for (i = 0, p = buf; i < CONVERT_BATCH + 1; i++)
+		p += sprintf(p, "%s\n", i < CONVERT_BATCH ? "0,0" : "90,0");
+	sci((chp{ execname, "convert", "geo", "ecef", NULL }),
+	    buf,
+	    "6378137.0,0.0,0.0\n"
+	    "0.0,0.0,6356752.314\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert: More positions than CONVERT_BATCH");
+	free(buf);
+}
+
+/*
+ * test_format_utm() - Tests the utm and mgrs output formats. Returns nothing.
+ */
+
+static void test_format_utm(void)
+{
+	diag("Test -F utm and -F mgrs");
+
+	tc((chp{ execname, "-F", "utm", "anti", "12,34", NULL }),
+	   "6L,608864.173,8673248.829\n",
+	   "",
+	   EXIT_SUCCESS,
+	   "-F utm anti");
+	tci((chp{ execname, "convert", "geo", "utm", NULL }),
+	    "-12,-146\n",
+	    "6L,608864.173,8673248.829,0.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "convert geo utm uses the same layout as -F utm");
+	tc((chp{ execname, "-F", "mgrs", "bpos", "60,10", "45", "1000",
+	         NULL }),
+	   "32VNM5647452551\n",
 	   "",
+	   EXIT_SUCCESS,
+	   "-F mgrs bpos");
+	tc((chp{ execname, "-F", "utm", "lpos", "0,0", "0,1", "0.5", NULL }),
+	   "31N,221723.683,0.0\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "--count 0");
-	tc((chp{ execname, "-F", "gpx", "--count", "0", "randpos", NULL }),
-	   GPX_HEADER "</gpx>\n",
+	   "-F utm lpos on the Equator");
+	tc((chp{ execname, "-F", "utm", "--geohash", "7", "course", "60,5",
+	         "60,12", "2", NULL }),
+	   "32V,276979.926,6658157.202 u4et3f8\n"
+	   "32V,407105.254,6657165.274 u4tjwf5\n"
+	   "32V,537192.496,6656181.639 u4wvefp\n"
+	   "33V,332705.179,6655205.484 u68t34d\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "-F gpx --count 0");
-	tc((chp{ execname, "-F", "sql", "--count", "10", "--seed", "1000",
-	         "randpos", "20,20", NULL }),
-	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER, lat REAL, lon REAL, dist REAL, bear REAL);\n"
-	   "INSERT INTO randpos VALUES (1000, 1, 71.13329, -57.468159, 7458038.290706, 339.955948);\n"
-	   "INSERT INTO randpos VALUES (1000, 2, 4.810956, -39.143396, 6605679.37255, 263.597432);\n"
-	   "INSERT INTO randpos VALUES (1000, 3, 31.762576, 91.243012, 7126548.517582, 63.514344);\n"
-	   "INSERT INTO randpos VALUES (1000, 4, -55.576794, -166.832537, 16018000.848656, 173.421528);\n"
-	   "INSERT INTO randpos VALUES (1000, 5, -3.788815, 152.508528, 14567412.13215, 77.097274);\n"
-	   "INSERT INTO randpos VALUES (1000, 6, 12.619138, 169.426644, 15080928.93906, 45.214445);\n"
-	   "INSERT INTO randpos VALUES (1000, 7, 32.292105, -106.309325, 11866448.651468, 314.66247);\n"
-	   "INSERT INTO randpos VALUES (1000, 8, 65.299565, 16.899777, 5042230.856845, 358.179425);\n"
-	   "INSERT INTO randpos VALUES (1000, 9, -4.673171, -44.745272, 7581105.91409, 256.164898);\n"
-	   "INSERT INTO randpos VALUES (1000, 10, 20.935854, 18.624757, 177068.647935, 306.231896);\n"
-	   "COMMIT;\n",
+	   "-F utm --geohash course");
+	tc((chp{ execname, "-F", "mgrs", "course", "60,5", "60,12", "1",
+	         NULL }),
+	   "32VKM7697958157\n"
+	   "32VMM7215056672\n"
+	   "33VUG3270555205\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "-F sql with coordinate and no distances");
-
-	test_randpos_dist();
-
-	diag("randpos with max_dist, invalid arguments");
-
-	tc((chp{ execname, "randpos", "12.34,56.34y", "10", NULL }),
+	   "-F mgrs course");
+	tc((chp{ execname, "-F", "utm", "course", "60,5", "89,5", "1", NULL }),
+	   "32V,276979.926,6658157.202\n"
+	   "31X,559649.216,8268824.514\n",
+	   EXECSTR ": 89.0,5.0: Position is outside the UTM area\n",
+	   EXIT_FAILURE,
+	   "-F utm course to 89,5");
+	tc((chp{ execname, "-F", "utm", "grid", "3", NULL }),
+	   "46T,250797.793,4633067.566\n"
+	   "23M,220858.908,10000000.0\n"
+	   "60G,332580.044,5369320.371\n",
 	   "",
-	   EXECSTR ": 12.34,56.34y: Invalid coordinate: Invalid argument\n",
+	   EXIT_SUCCESS,
+	   "-F utm grid");
+	tc((chp{ execname, "-F", "utm", "grid", "90,0", "100000", "200000",
+	         NULL }),
+	   "",
+	   EXECSTR ": 90.0,0.0: Position is outside the UTM area\n",
 	   EXIT_FAILURE,
-	   "randpos with error in coordinate");
-
-	tc((chp{ execname, "randpos", "12.34,56.34", "10y", NULL }),
+	   "-F utm grid around the North Pole");
+	tc((chp{ execname, "-F", "mgrs", "--count", "2", "--seed", "3",
+	         "randbox", "10,10", "11,11", NULL }),
+	   "32PQS0377592601\n"
+	   "32PPS3873640112\n",
 	   "",
-	   EXECSTR ": 10y: Invalid max_dist argument: Invalid argument\n",
+	   EXIT_SUCCESS,
+	   "-F mgrs randbox");
+	tc((chp{ execname, "-F", "utm", "--count", "2", "--seed", "3",
+	         "randbox", "86,10", "88,11", NULL }),
+	   "",
+	   EXECSTR ": 87.430845,10.863673: Position is outside the UTM"
+	   " area\n",
 	   EXIT_FAILURE,
-	   "randpos with error in max_dist");
-
-	tc((chp{ execname, "randpos", "12.34,56.34", "-17.9", NULL }),
+	   "-F utm randbox north of the UTM area");
+	tc((chp{ execname, "-F", "mgrs", "anti", "85,0", NULL }),
 	   "",
-	   EXECSTR ": Distance cannot be negative\n",
+	   EXECSTR ": -85.0,180.0: Position is outside the UTM area\n",
 	   EXIT_FAILURE,
-	   "randpos with negative max_dist");
+	   "-F mgrs anti outside the UTM area");
+	tc((chp{ execname, "-F", "utm", "dist", "1,2", "3,4", NULL }),
+	   "",
+	   EXECSTR ": UTM output is not supported by the dist command\n",
+	   EXIT_FAILURE,
+	   "-F utm dist");
+	tc((chp{ execname, "-F", "mgrs", "ring", "1000", "8", "-", NULL }),
+	   "",
+	   EXECSTR ": MGRS output is not supported by the ring command\n",
+	   EXIT_FAILURE,
+	   "-F mgrs ring");
+}
 
-	diag("randpos with max_dist and min_dist, invalid arguments");
+/*
+ * test_cmd_sort() - Tests the `sort` command and the --sort option. Returns 
+ * nothing.
+ */
 
-	tc((chp{ execname, "randpos", "12.34,56.34", "10", "3y", NULL }),
+static void test_cmd_sort(void)
+{
+	diag("Test sort command");
+
+	tci((chp{ execname, "sort", NULL }),
+	    "60,5\n-60,-5\n60,-5\n\n# Comment\n-60,5\n0,0\n10,10\n",
+	    "-60.0,-5.0\n"
+	    "60.0,-5.0\n"
+	    "0.0,0.0\n"
+	    "10.0,10.0\n"
+	    "60.0,5.0\n"
+	    "-60.0,5.0\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "sort");
+	tci((chp{ execname, "--sort", "morton", "-F", "sql", "sort", "-",
+	          NULL }),
+	    "60,5\n-60,-5\n60,-5\n-60,5\n0,0\n10,10\n",
+	    "BEGIN;\n"
+	    "CREATE TABLE IF NOT EXISTS sort (num INTEGER, lat REAL,"
+	    " lon REAL);\n"
+	    "INSERT INTO sort VALUES (2, -60.0, -5.0);\n"
+	    "INSERT INTO sort VALUES (3, 60.0, -5.0);\n"
+	    "INSERT INTO sort VALUES (4, -60.0, 5.0);\n"
+	    "INSERT INTO sort VALUES (5, 0.0, 0.0);\n"
+	    "INSERT INTO sort VALUES (6, 10.0, 10.0);\n"
+	    "INSERT INTO sort VALUES (1, 60.0, 5.0);\n"
+	    "COMMIT;\n",
+	    "",
+	    EXIT_SUCCESS,
+	    "--sort morton -F sql sort -");
+	tci((chp{ execname, "--sort", "hilbert", "sort", NULL }),
+	    "",
+	    "",
+	    "",
+	    EXIT_SUCCESS,
+	    "--sort hilbert sort, no positions");
+	tci((chp{ execname, "sort", NULL }),
+	    "60,5\n91,0\n",
+	    "",
+	    EXECSTR ": (stdin):2: Invalid coordinate: 91,0\n",
+	    EXIT_FAILURE,
+	    "sort: Invalid coordinate");
+	tc((chp{ execname, "sort", "/nonexistent/file", NULL }),
+	   "",
+	   EXECSTR ": /nonexistent/file: Cannot open file for read:"
+	   " No such file or directory\n",
+	   EXIT_FAILURE,
+	   "sort: File doesn't exist");
+	tc((chp{ execname, "sort", "a", "b", NULL }),
 	   "",
-	   EXECSTR ": 3y: Invalid min_dist argument: Invalid argument\n",
+	   EXECSTR ": Too many arguments\n",
 	   EXIT_FAILURE,
-	   "randpos with error in min_dist");
-
-	tc((chp{ execname, "randpos", "12.34,56.34", "9", "-2", NULL }),
+	   "sort: Too many arguments");
+	tc((chp{ execname, "-F", "gpx", "sort", NULL }),
 	   "",
-	   EXECSTR ": Distance cannot be negative\n",
+	   EXECSTR ": GPX output is not supported by the sort command\n",
 	   EXIT_FAILURE,
-	   "randpos with negative min_dist");
-
-	tc((chp{ execname, "--karney", "randpos", "1,2", "200", "100", NULL }),
+	   "-F gpx sort");
+	tc((chp{ execname, "-K", "sort", NULL }),
 	   "",
-	   EXECSTR ": -K/--karney is not supported by the randpos command\n",
+	   EXECSTR ": -K/--karney is not supported by the sort command\n",
 	   EXIT_FAILURE,
-	   "--karney randpos");
+	   "-K sort");
 
-	diag("--format sql randpos");
-	tc((chp{ execname, "--format", "sql", "--seed", "19", "--count", "20",
-	         "randpos", NULL }),
+	tc((chp{ execname, "--seed", "1", "--count", "5", "--sort", "spatial",
+	         "-F", "sql", "randpos", NULL }),
 	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER, lat REAL, lon REAL, dist REAL, bear REAL);\n"
-	   "INSERT INTO randpos VALUES (19, 1, 25.603688, -130.636512, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 2, -48.27306, 77.529775, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 3, -17.1173, 140.106483, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 4, -52.240484, -115.036322, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 5, 3.344781, 17.095447, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 6, 16.755787, 9.521758, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 7, -19.490223, 12.660125, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 8, 69.69621, 156.752235, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 9, 52.694091, 90.355201, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 10, -6.44931, -117.03235, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 11, 13.210432, -169.948761, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 12, -22.225278, 129.713413, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 13, -1.595068, -106.917102, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 14, -22.137051, -55.379762, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 15, 0.672918, -35.768761, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 16, 8.184838, -1.136274, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 17, -57.901507, 155.489707, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 18, 14.890397, 131.859757, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 19, 31.066093, -2.976285, NULL, NULL);\n"
-	   "INSERT INTO randpos VALUES (19, 20, 31.66207, 0.677547, NULL, NULL);\n"
+	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER,"
+	   " lat REAL, lon REAL, dist REAL, bear REAL);\n"
+	   "INSERT INTO randpos VALUES (1, 1, -66.453952, -16.38272, NULL,"
+	   " NULL);\n"
+	   "INSERT INTO randpos VALUES (1, 3, 7.526157, -179.363912, NULL,"
+	   " NULL);\n"
+	   "INSERT INTO randpos VALUES (1, 2, 42.038857, -59.045029, NULL,"
+	   " NULL);\n"
+	   "INSERT INTO randpos VALUES (1, 5, 30.065802, -48.14149, NULL,"
+	   " NULL);\n"
+	   "INSERT INTO randpos VALUES (1, 4, -38.669048, 176.556269, NULL,"
+	   " NULL);\n"
 	   "COMMIT;\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "--format sql randpos without coordinate or dists");
-	tc((chp{ execname, "-F", "sql", "--seed", "19", "--count", "20",
-	         "randpos", "1,2", "200", "100", NULL }),
-	   "BEGIN;\n"
-	   "CREATE TABLE IF NOT EXISTS randpos (seed INTEGER, num INTEGER, lat REAL, lon REAL, dist REAL, bear REAL);\n"
-	   "INSERT INTO randpos VALUES (19, 1, 0.999739, 1.998795, 137.029826, 257.785884);\n"
-	   "INSERT INTO randpos VALUES (19, 2, 1.00116, 2.001187, 184.578986, 45.661444);\n"
-	   "INSERT INTO randpos VALUES (19, 3, 0.998948, 2.001395, 194.296589, 127.020796);\n"
-	   "INSERT INTO randpos VALUES (19, 4, 1.001014, 2.000784, 142.479955, 37.694182);\n"
-	   "INSERT INTO randpos VALUES (19, 5, 0.998461, 1.999715, 173.992388, 190.501973);\n"
-	   "INSERT INTO randpos VALUES (19, 6, 0.999042, 1.998779, 172.556828, 231.892738);\n"
-	   "INSERT INTO randpos VALUES (19, 7, 0.999223, 2.00135, 173.15511, 119.94372);\n"
-	   "INSERT INTO randpos VALUES (19, 8, 1.001736, 1.999657, 196.717262, 348.815877);\n"
-	   "INSERT INTO randpos VALUES (19, 9, 1.001344, 1.998994, 186.659487, 323.173976);\n"
-	   "INSERT INTO randpos VALUES (19, 10, 0.998803, 2.000441, 141.822259, 159.781653);\n"
-	   "INSERT INTO randpos VALUES (19, 11, 0.999209, 1.999309, 116.709311, 221.135064);\n"
-	   "INSERT INTO randpos VALUES (19, 12, 0.999353, 2.001608, 192.753169, 111.915138);\n"
-	   "INSERT INTO randpos VALUES (19, 13, 0.9987, 2.000114, 145.056415, 174.989594);\n"
-	   "INSERT INTO randpos VALUES (19, 14, 0.999461, 2.001323, 158.835986, 112.1718);\n"
-	   "INSERT INTO randpos VALUES (19, 15, 0.998532, 1.999946, 163.296314, 182.113987);\n"
-	   "INSERT INTO randpos VALUES (19, 16, 0.998618, 1.999337, 170.48714, 205.626063);\n"
-	   "INSERT INTO randpos VALUES (19, 17, 1.001568, 2.000817, 196.535789, 27.515539);\n"
-	   "INSERT INTO randpos VALUES (19, 18, 0.998799, 1.998745, 193.074008, 226.254748);\n"
-	   "INSERT INTO randpos VALUES (19, 19, 1.000077, 1.998472, 170.123644, 272.884771);\n"
-	   "INSERT INTO randpos VALUES (19, 20, 1.00012, 1.998468, 170.843636, 274.483494);\n"
-	   "COMMIT;\n",
+	   "--sort spatial -F sql randpos");
+	tc((chp{ execname, "--seed", "1", "--count", "3", "--sort", "morton",
+	         "randpos", "60,5", "1000", NULL }),
+	   "60.002648,4.991019\n"
+	   "59.999654,4.999698\n"
+	   "60.005857,5.003136\n",
 	   "",
 	   EXIT_SUCCESS,
-	   "-F sql randpos with maxdist and mindist");
+	   "--sort morton randpos with center");
+	tc((chp{ execname, "--sort", "abc", "sort", NULL }),
+	   "",
+	   EXECSTR ": abc: Unknown --sort order\n"
+	   OPTION_ERROR_STR,
+	   EXIT_FAILURE,
+	   "--sort abc");
+	tc((chp{ execname, "--sort", "spatial", "course", "1,2", "3,4", "1",
+	         NULL }),
+	   "",
+	   EXECSTR ": --sort is not supported by the course command\n",
+	   EXIT_FAILURE,
+	   "--sort spatial course");
 }
 
-#undef te_randpos
-
 /******************************************************************************
                         Top-level --selftest functions
 ******************************************************************************/
@@ -3659,14 +10715,40 @@ static void test_functions(const struct Options *o)
 	/* geomath.c */
 	test_are_antipodal();
 	test_bearing_position();
+	test_origin_positions();
 	test_karney_distance();
 	test_karney_bearing();
+	test_approx();
+	test_ellipsoid();
+	test_distance_batch();
+	test_rhumb();
+	test_compsum();
+	test_bbox();
+	test_arc_angle();
+	test_cross_track();
+	test_intersect();
+	test_closest_approach();
+	test_polygon();
+	test_pointindex();
+	test_dbscan();
+	test_ecef();
+	test_utm();
+	test_centroid();
+	test_polyarea();
 	test_rand_pos();
+	test_sepindex();
+	test_randpoly();
+	test_fibgrid();
+	test_geohash();
+	test_curve_keys();
 
 	/* gpx.c */
 	test_xml_escape_string();
 	test_gpx_wpt();
 
+	/* io.c */
+	test_possort();
+
 	/* strings.c */
 	test_trim_zeros();
 	test_mystrdup();
@@ -3674,6 +10756,8 @@ static void test_functions(const struct Options *o)
 	test_count_substr();
 	test_str_replace();
 	test_parse_coordinate();
+	test_scan_coordinate();
+	test_parse_datetime();
 }
 
 /*
@@ -3690,7 +10774,7 @@ static void test_executable(const struct Options *o)
 	diag("Test the executable");
 	test_valgrind_option(o);
 	print_version_info(o);
-	tc((chp{ execname, NULL }),
+	tcx((chp{ execname, NULL }),
 	   "",
 	   EXECSTR ": No arguments specified\n" TYPE_HELP_STR,
 	   EXIT_FAILURE,
@@ -3701,10 +10785,14 @@ static void test_executable(const struct Options *o)
 	   EXIT_FAILURE,
 	   "Unknown command");
 	test_standard_options();
+	test_approx_option();
+	test_ellipsoid_option();
 	test_format_option();
 	test_haversine_option();
 	test_karney_option();
+	test_rhumb_option();
 	test_seed_option(o);
+	test_selftest_option();
 	test_cmd_anti();
 	test_cmd_bench();
 	test_cmd_bpos();
@@ -3713,6 +10801,24 @@ static void test_executable(const struct Options *o)
 	test_multiple(__LINE__, "bear");
 	test_multiple(__LINE__, "dist");
 	test_cmd_randpos(o);
+	test_cmd_track();
+	test_cmd_track_gpx();
+	test_cmd_simplify();
+	test_cmd_xtrack();
+	test_cmd_fence();
+	test_cmd_geohash();
+	test_cmd_join();
+	test_cmd_cluster();
+	test_cmd_centroid();
+	test_cmd_intersect();
+	test_cmd_cpa();
+	test_cmd_area();
+	test_cmd_grid();
+	test_cmd_randpoly();
+	test_cmd_ring();
+	test_cmd_convert();
+	test_format_utm();
+	test_cmd_sort();
 	print_version_info(o);
 }
 
@@ -3734,6 +10840,7 @@ int opt_selftest(char *main_execname, const struct Options *o)
 
 	test_ok_macros();
 	test_functions(o);
+	test_properties(o);
 	test_executable(o);
 
 	printf("1..%d\n", testnum);
@@ -3773,8 +10880,11 @@ int opt_selftest(char *main_execname, const struct Options *o)
 #undef OK_TRUE
 #undef OK_TRUE_L
 #undef OPTION_ERROR_STR
+#undef PROP_ITERATIONS
+#undef PROP_MAXVALS
 #undef TYPE_HELP_STR
 #undef Tc
+#undef Tcx
 #undef chp
 #undef diag_errno
 #undef failed_ok
@@ -3784,6 +10894,10 @@ int opt_selftest(char *main_execname, const struct Options *o)
 #undef print_gotexp_size_t
 #undef print_gotexp_ulong
 #undef sc
+#undef sci
+#undef scx
 #undef tc
+#undef tci
+#undef tcx
 
 /* vim: set ts=8 sw=8 sts=8 noet fo+=w tw=79 fenc=UTF-8 : */
@@ -262,14 +262,303 @@ char *str_replace(const char *s, const char *s1, const char *s2)
 	return buf;
 }
 
+/*
+ * fast_strtod() - Converts the number at `s` like strtod() and stores the 
+ * address of the first character after it in `endptr`. Plain decimal numbers 
+ * with at most 15 digits and no exponent are converted by dividing the 
+ * integer value by a power of 10. Both values are exact, and the division is 
+ * correctly rounded, so the result is identical to strtod(), just faster. 
+ * Everything else is passed to strtod(). Returns the converted value.
+ */
+
+static double fast_strtod(const char *s, const char **endptr)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15
+	};
+	const char *p = s;
+	char *end;
+	double d;
+	uint64_t m = 0;
+	int digits = 0, decimals = 0;
+	bool neg = false;
+
+	if (*p == '-' || *p == '+')
+		neg = *p++ == '-';
+	while (isdigit((unsigned char)*p) && digits < 16) {
+		m = m * 10 + (uint64_t)(*p++ - '0');
+		digits++;
+	}
+	if (*p == '.') {
+		p++;
+		while (isdigit((unsigned char)*p) && digits < 16) {
+			m = m * 10 + (uint64_t)(*p++ - '0');
+			digits++;
+			decimals++;
+		}
+	}
+	if (!digits || digits > 15 || isdigit((unsigned char)*p)
+	    || *p == 'x' || *p == 'X'
+	    || ((*p == 'e' || *p == 'E')
+	        && (isdigit((unsigned char)p[1])
+	            || ((p[1] == '-' || p[1] == '+')
+	                && isdigit((unsigned char)p[2]))))) {
+		d = strtod(s, &end);
+		*endptr = end;
+		return d;
+	}
+	*endptr = p;
+
+	return neg ? -((double)m / pow10[decimals])
+	           : (double)m / pow10[decimals];
+}
+
+/*
+ * scan_coordinate() - Parses the geographic coordinate at the start of `s` 
+ * and stores latitude and longitude in `dest_lat` and `dest_lon`. The string 
+ * is read in a single pass without any allocations, since this is used for 
+ * every line in the input files. These formats are understood:
+ *
+ * - Decimal degrees separated by a comma, `60.3925,5.3233`
+ * - Decimal degrees separated by whitespace, `60.3925 5.3233`
+ * - Degrees, minutes and seconds with markers, `60°23'33"N 5°19'24"E`. The 
+ *   seconds can also be written as `''`, and the Unicode prime (′) and double 
+ *   prime (″) are accepted as well as the ordinal indicator (º) for degrees.
+ * - Degrees, minutes and seconds separated by whitespace, `60 23 33 5 19 24`. 
+ *   Without markers, hemisphere letters or commas, 2 numbers are degrees, 4 
+ *   are degrees and minutes, and 6 are degrees, minutes and seconds. If the 
+ *   coordinate has markers or commas, minutes and seconds without markers 
+ *   are only allowed together with a hemisphere letter, `60 23 33 N`, to 
+ *   avoid guessing.
+ *
+ * The hemisphere can be specified with `N`, `S`, `E` or `W` before or after 
+ * every value instead of a sign, and if the letters say so, longitude can be 
+ * written before latitude. The letters must be used on both values or on 
+ * none of them. Minutes and seconds must be in the range [0, 60), 
+ * and only the last value of every angle can have decimals.
+ *
+ * `*endptr` is set to the first character after the coordinate, and after the 
+ * comma if the coordinate is followed by one, to make it possible to read 
+ * more values from the same line. The range isn't checked, that's up to the 
+ * caller. Returns 0 if ok, or 1 if the syntax is invalid, and `errno` is set 
+ * to EINVAL, or ERANGE if a number is too large or small.
+ */
+
+int scan_coordinate(const char *s, double *dest_lat, double *dest_lon,
+                    const char **endptr)
+{
+	double num[6], val[2];
+	int unit[6], comp[6], hemi[2] = { 0, 0 }, axis[2];
+	bool sign[6], mark[6], marked = false, after_num = false,
+	     comma_ok = false;
+	int n = 0, c = 0, last = -1, i, k;
+	const char *p = s;
+
+	assert(s);
+	assert(dest_lat);
+	assert(dest_lon);
+	assert(endptr);
+
+	while (c < 2) {
+		const unsigned char ch = (unsigned char)*p;
+		int u = -1, len = 0;
+
+		if (!ch)
+			break;
+		if (isspace(ch)) {
+			after_num = false;
+			p++;
+			continue;
+		}
+		if (ch == ',') {
+			/* Separates latitude and longitude, or ends it */
+			if (last >= 0) {
+				c++;
+				last = -1;
+				marked = true;
+			} else if (comma_ok) {
+				comma_ok = false;
+			} else {
+				goto invalid;
+			}
+			after_num = false;
+			p++;
+			continue;
+		}
+		if (ch == 'N' || ch == 'S' || ch == 'E' || ch == 'W') {
+			if (last >= 0 && !hemi[c]) {
+				/* Suffix, ends the current value */
+				hemi[c++] = ch;
+				last = -1;
+				comma_ok = true;
+			} else if (last >= 0 && !c) {
+				/* Prefix, and the first value has one */
+				hemi[++c] = ch;
+				last = -1;
+			} else if (last < 0 && !hemi[c]) {
+				hemi[c] = ch;
+				comma_ok = false;
+			} else {
+				goto invalid;
+			}
+			marked = true;
+			after_num = false;
+			p++;
+			continue;
+		}
+
+		/* Degree, minute and second markers after a number */
+		if (ch == 0xc2 && (p[1] == '\xb0' || p[1] == '\xba')) {
+			u = 0;
+			len = 2;
+		} else if (ch == 0xe2 && p[1] == '\x80'
+		           && (p[2] == '\xb2' || p[2] == '\xb3')) {
+			u = p[2] == '\xb2' ? 1 : 2;
+			len = 3;
+		} else if (ch == '\'') {
+			u = p[1] == '\'' ? 2 : 1;
+			len = u;
+		} else if (ch == '"') {
+			u = 2;
+			len = 1;
+		}
+		if (u < 0) {
+			/* Anything else must be a number */
+			const char *end;
+
+			if (after_num || n == 6)
+				goto invalid;
+			if (last == 2) {
+				/* Seconds were the last value, new angle */
+				if (c)
+					goto invalid;
+				c = 1;
+				last = -1;
+			}
+			errno = 0;
+			num[n] = fast_strtod(p, &end);
+			if (errno == ERANGE)
+				return 1;
+			if (end == p || isnan(num[n])) {
+				errno = EINVAL;
+				return 1;
+			}
+			if (isinf(num[n])) {
+				errno = ERANGE;
+				return 1;
+			}
+			sign[n] = ch == '+' || ch == '-';
+			mark[n] = false;
+			unit[n] = ++last;
+			comp[n++] = c;
+			after_num = true;
+			comma_ok = false;
+			p = end;
+			continue;
+		}
+
+		if (!after_num)
+			goto invalid;
+		i = n - 1;
+		if (u != unit[i]) {
+			if (i && comp[i - 1] == comp[i] && u <= unit[i - 1]) {
+				/* Smaller marker than before, new angle */
+				if (c)
+					goto invalid;
+				comp[i] = c = 1;
+			}
+			unit[i] = last = u;
+		}
+		mark[i] = marked = true;
+		after_num = false;
+		p += len;
+	}
+
+	if (c == 2) {
+		/* Ended with a hemisphere letter, skip the separator */
+		while (isspace((unsigned char)*p))
+			p++;
+		if (*p == ',' && comma_ok)
+			p++;
+	} else if (!marked) {
+		/* Only numbers, split them in 2 equal halves */
+		if (n != 2 && n != 4 && n != 6)
+			goto invalid;
+		for (i = 0; i < n; i++) {
+			comp[i] = i >= n / 2;
+			unit[i] = i % (n / 2);
+		}
+	} else if (c != 1 || last < 0) {
+		goto invalid;
+	}
+
+	for (k = 0; k < 2; k++) {
+		int first = -1, prev = -1;
+		bool neg;
+
+		for (i = 0; i < n; i++) {
+			if (comp[i] != k)
+				continue;
+			if (first < 0) {
+				if (unit[i])
+					goto invalid;
+				first = i;
+				val[k] = fabs(num[i]);
+			} else {
+				if (sign[i] || unit[i] <= unit[prev]
+				    || (marked && !mark[i] && !hemi[k])
+				    || num[i] >= 60.0
+				    || num[prev] != floor(num[prev]))
+					goto invalid;
+				val[k] += num[i] / (unit[i] == 1 ? 60.0
+				                                  : 3600.0);
+			}
+			prev = i;
+		}
+		if (first < 0)
+			goto invalid; /* gncov */
+		neg = signbit(num[first]);
+		if (hemi[k]) {
+			if (sign[first])
+				goto invalid;
+			neg = hemi[k] == 'S' || hemi[k] == 'W';
+		}
+		if (neg)
+			val[k] = -val[k];
+	}
+
+	/*
+	 * Use the hemisphere letters to find out which one is latitude. A 
+	 * letter on only one value is rejected, since a missing or wrong 
+	 * letter would otherwise swap the axes without any error.
+	 */
+	if (!hemi[0] != !hemi[1])
+		goto invalid;
+	axis[0] = !hemi[0] ? 0 : hemi[0] == 'N' || hemi[0] == 'S' ? 1 : 2;
+	axis[1] = !hemi[1] ? 0 : hemi[1] == 'N' || hemi[1] == 'S' ? 1 : 2;
+	if (axis[0] && axis[0] == axis[1])
+		goto invalid;
+	k = axis[0] == 2 || axis[1] == 1;
+	*dest_lat = val[k];
+	*dest_lon = val[!k];
+	*endptr = p;
+
+	return 0;
+
+invalid:
+	errno = EINVAL;
+	return 1;
+}
+
 /*
  * parse_coordinate() - Parses the geographic coordinate in `s` and stores 
- * latitude and longitude in `dest_lat` and `dest_lon`. The coordinate must be 
- * in the format `[-]dd.dddddd,[-]ddd.dddddd` (lat,lon) where the numbers are 
- * in the range -90..90 and -180..180.
+ * latitude and longitude in `dest_lat` and `dest_lon`. All formats understood 
+ * by scan_coordinate() are accepted, and only whitespace and commas are 
+ * allowed after the coordinate.
  *
  * If `validate` is `true`, it validates the coordinate range and returns 1 if 
- * the values are outside the valid range.
+ * the values are outside the valid range, -90..90 and -180..180.
  *
  * If it's not a valid coordinate or if anything fails, the function returns 1. 
  * If successful, it returns 0.
@@ -278,42 +567,135 @@ char *str_replace(const char *s, const char *s1, const char *s2)
 int parse_coordinate(const char *s, bool validate,
                      double *dest_lat, double *dest_lon)
 {
-	char *comma, *sd;
+	const char *p;
 	double lat, lon;
-	int retval = 0;
 
 	assert(dest_lat);
 	assert(dest_lon);
 
 	if (!s || !dest_lat || !dest_lon)
 		return 1;
-	if (!strchr(s, ','))
+	if (scan_coordinate(s, &lat, &lon, &p))
+		return 1;
+	while (*p == ',' || isspace((unsigned char)*p))
+		p++;
+	if (*p) {
+		errno = EINVAL;
 		return 1;
-	sd = mystrdup(s);
-	if (!sd) {
-		failed("mystrdup()"); /* gncov */
-		return 1; /* gncov */
-	}
-	comma = strchr(sd, ',');
-	if (string_to_double(comma + 1, &lon)) {
-		retval = 1;
-		goto cleanup;
-	}
-	*comma = '\0';
-	if (string_to_double(sd, &lat)) {
-		retval = 1;
-		goto cleanup;
 	}
 	*dest_lat = lat;
 	*dest_lon = lon;
 
 	if (validate && (fabs(lat) > 90.0 || fabs(lon) > 180.0))
-		retval = 1;
+		return 1;
 
-cleanup:
-	free(sd);
+	return 0;
+}
 
-	return retval;
+/*
+ * parse_digits() - Parses exactly `num` decimal digits at `*s` and stores the 
+ * value in `dest`. `*s` is moved past the digits. Returns 0 if ok, or 1 if 
+ * any of the characters isn't a digit.
+ */
+
+static int parse_digits(const char **s, const int num, int *dest)
+{
+	int i;
+
+	*dest = 0;
+	for (i = 0; i < num; i++) {
+		if (!isdigit((unsigned char)**s))
+			return 1;
+		*dest = *dest * 10 + (**s - '0');
+		(*s)++;
+	}
+
+	return 0;
+}
+
+/*
+ * days_from_civil() - Returns the number of days from 1970-01-01 to the date 
+ * `y`-`m`-`d` in the proleptic Gregorian calendar.
+ */
+
+static long days_from_civil(long y, const int m, const int d)
+{
+	long era, yoe, doy;
+
+	y -= m <= 2;
+	era = (y >= 0 ? y : y - 399) / 400;
+	yoe = y - era * 400;
+	doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+
+	return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+/*
+ * parse_datetime() - Parses the ISO 8601 timestamp in `s`, in the format 
+ * `YYYY-MM-DDThh:mm:ss` with optional decimals after the seconds and an 
+ * optional time zone, `Z` or `+hh:mm`/`-hh:mm`. Timestamps without time zone 
+ * are assumed to be UTC. Whitespace around the timestamp is allowed. The 
+ * number of seconds since 1970-01-01T00:00:00Z is stored in `dest`. Returns 0 
+ * if ok, or 1 if the timestamp is invalid, and `errno` is set to EINVAL.
+ */
+
+int parse_datetime(const char *s, double *dest)
+{
+	static const int mdays[] = {
+		31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+	};
+	int year, mon, day, hour, min, sec, tzh = 0, tzm = 0, sign = 0;
+	double frac = 0.0, scale = 0.1;
+	long days;
+
+	assert(s);
+	assert(dest);
+
+	while (isspace((unsigned char)*s))
+		s++;
+	if (parse_digits(&s, 4, &year) || *s++ != '-'
+	    || parse_digits(&s, 2, &mon) || *s++ != '-'
+	    || parse_digits(&s, 2, &day) || (*s != 'T' && *s != 't'))
+		goto invalid;
+	s++;
+	if (parse_digits(&s, 2, &hour) || *s++ != ':'
+	    || parse_digits(&s, 2, &min) || *s++ != ':'
+	    || parse_digits(&s, 2, &sec))
+		goto invalid;
+	if (*s == '.') {
+		s++;
+		if (!isdigit((unsigned char)*s))
+			goto invalid;
+		while (isdigit((unsigned char)*s)) {
+			frac += (*s++ - '0') * scale;
+			scale /= 10.0;
+		}
+	}
+	if (*s == 'Z' || *s == 'z') {
+		s++;
+	} else if (*s == '+' || *s == '-') {
+		sign = *s++ == '-' ? -1 : 1;
+		if (parse_digits(&s, 2, &tzh) || *s++ != ':'
+		    || parse_digits(&s, 2, &tzm) || tzh > 23 || tzm > 59)
+			goto invalid;
+	}
+	while (isspace((unsigned char)*s))
+		s++;
+	if (*s || mon < 1 || mon > 12 || day < 1 || day > mdays[mon - 1]
+	    || (mon == 2 && day == 29
+	        && (year % 4 || (!(year % 100) && year % 400)))
+	    || hour > 23 || min > 59 || sec > 60)
+		goto invalid;
+
+	days = days_from_civil(year, mon, day);
+	*dest = (double)days * 86400.0 + hour * 3600 + min * 60 + sec
+	        - sign * (tzh * 3600 + tzm * 60) + frac;
+
+	return 0;
+
+invalid:
+	errno = EINVAL;
+	return 1;
 }
 
 /* vim: set ts=8 sw=8 sts=8 noet fo+=w tw=79 fenc=UTF-8 : */